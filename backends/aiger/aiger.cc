@@ -0,0 +1,383 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/cellaigs.h"
+#include "kernel/utils.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct AigerWriter
+{
+	Module *module;
+	SigMap sigmap;
+	AigManager mgr;
+	bool zinit_mode;
+
+	vector<pair<SigBit, string>> inputs;
+	vector<pair<SigBit, string>> outputs;
+
+	struct latch_t {
+		SigBit q, d;
+		State init;
+		string name;
+	};
+	vector<latch_t> latches;
+
+	// AigManager literals of the inputs, latch outputs, outputs and latch inputs
+	vector<int> input_lits, latch_q_lits, output_lits, latch_d_lits;
+
+	// AIGER literals for the AigManager nodes, and the AND nodes in output order
+	dict<int, int> node_vars;
+	vector<int> and_nodes;
+
+	static string bit_name(SigBit bit)
+	{
+		if (bit.wire == nullptr)
+			return string();
+		if (GetSize(bit.wire) == 1)
+			return log_id(bit.wire);
+		return stringf("%s[%d]", log_id(bit.wire), bit.offset);
+	}
+
+	AigerWriter(Module *module, bool zinit_mode) : module(module), sigmap(module), mgr(sigmap), zinit_mode(zinit_mode)
+	{
+		dict<SigBit, State> init_map;
+		for (auto wire : module->wires()) {
+			if (wire->attributes.count("\\init")) {
+				Const init = wire->attributes.at("\\init");
+				for (int i = 0; i < GetSize(wire) && i < GetSize(init); i++)
+					init_map[sigmap(SigBit(wire, i))] = init.bits[i];
+			}
+		}
+
+		SigBit clock_bit;
+		bool clock_pol = true, found_clock = false;
+		vector<Cell*> comb_cells;
+
+		for (auto cell : module->cells())
+		{
+			if (cell->type.in("$_DFF_P_", "$_DFF_N_", "$dff"))
+			{
+				SigSpec sig_clk = cell->getPort(cell->type == "$dff" ? "\\CLK" : "\\C");
+				bool pol = cell->type == "$dff" ? cell->getParam("\\CLK_POLARITY").as_bool() : cell->type == "$_DFF_P_";
+
+				if (!found_clock) {
+					clock_bit = sigmap(sig_clk[0]);
+					clock_pol = pol;
+					found_clock = true;
+				} else if (clock_bit != sigmap(sig_clk[0]) || clock_pol != pol)
+					log_error("Module %s has more than one clock domain, AIGER only supports a single implicit clock.\n", log_id(module));
+
+				SigSpec sig_d = cell->getPort("\\D");
+				SigSpec sig_q = cell->getPort("\\Q");
+
+				for (int i = 0; i < GetSize(sig_q); i++) {
+					latch_t latch;
+					latch.q = sigmap(sig_q[i]);
+					latch.d = sig_d[i];
+					latch.init = init_map.count(latch.q) ? init_map.at(latch.q) : State::Sx;
+					latch.name = bit_name(sig_q[i]);
+					latches.push_back(latch);
+				}
+				continue;
+			}
+
+			comb_cells.push_back(cell);
+		}
+
+		for (auto wire : module->wires()) {
+			if (wire->port_input)
+				for (int i = 0; i < GetSize(wire); i++)
+					inputs.push_back(make_pair(sigmap(SigBit(wire, i)), bit_name(SigBit(wire, i))));
+			if (wire->port_output)
+				for (int i = 0; i < GetSize(wire); i++)
+					outputs.push_back(make_pair(SigBit(wire, i), bit_name(SigBit(wire, i))));
+		}
+
+		// the AIG inputs are created first, so that they cannot be
+		// resolved to a cell output that drives the same net
+		for (auto &it : inputs)
+			input_lits.push_back(mgr.lit_input(it.first));
+		for (auto &latch : latches)
+			latch_q_lits.push_back(mgr.lit_input(latch.q));
+
+		// add the combinational cells in topological order
+		dict<SigBit, int> bit_drivers;
+		vector<Aig> aigs;
+		for (int i = 0; i < GetSize(comb_cells); i++) {
+			Cell *cell = comb_cells[i];
+			aigs.push_back(Aig(cell));
+			if (aigs.back().name.empty())
+				log_error("Unsupported cell type %s (%s) in module %s, map it to logic first (e.g. with techmap).\n",
+						log_id(cell->type), log_id(cell), log_id(module));
+			for (auto &conn : cell->connections())
+				if (cell->output(conn.first))
+					for (auto bit : sigmap(conn.second))
+						if (bit.wire != nullptr)
+							bit_drivers[bit] = i;
+		}
+
+		TopoSort<int> toposort;
+		for (int i = 0; i < GetSize(comb_cells); i++) {
+			toposort.node(i);
+			for (auto &conn : comb_cells[i]->connections())
+				if (comb_cells[i]->input(conn.first))
+					for (auto bit : sigmap(conn.second))
+						if (bit_drivers.count(bit))
+							toposort.edge(bit_drivers.at(bit), i);
+		}
+		toposort.analyze_loops = false;
+		if (!toposort.sort())
+			log_error("Module %s contains combinational loops.\n", log_id(module));
+
+		vector<pair<SigBit, int>> cell_outputs;
+		for (int i : toposort.sorted)
+			mgr.add_cell(comb_cells[i], aigs[i], cell_outputs);
+
+		for (auto &it : outputs)
+			output_lits.push_back(mgr.lit_input(it.first));
+		for (auto &latch : latches)
+			latch_d_lits.push_back(mgr.lit_input(latch.d));
+	}
+
+	int aiger_lit(int lit) const
+	{
+		if (mgr.is_const(lit))
+			return lit;
+		return 2*node_vars.at(lit >> 1) + (lit & 1);
+	}
+
+	void number_nodes(vector<pair<SigBit, string>> &extra_inputs)
+	{
+		vector<bool> used(GetSize(mgr.nodes));
+
+		for (int lit : output_lits)
+			used[lit >> 1] = true;
+		for (int lit : latch_d_lits)
+			used[lit >> 1] = true;
+
+		for (int i = GetSize(mgr.nodes)-1; i > 0; i--)
+			if (used[i] && mgr.nodes[i].left >= 0) {
+				used[mgr.nodes[i].left >> 1] = true;
+				used[mgr.nodes[i].right >> 1] = true;
+			}
+
+		int next_var = 1;
+		vector<pair<SigBit, string>> port_inputs;
+		port_inputs.swap(inputs);
+
+		for (int i = 0; i < GetSize(port_inputs); i++) {
+			int node = input_lits[i] >> 1;
+			if (mgr.is_const(input_lits[i]) || node_vars.count(node))
+				continue;
+			node_vars[node] = next_var++;
+			inputs.push_back(port_inputs[i]);
+		}
+
+		pool<int> latch_nodes;
+		for (int lit : latch_q_lits)
+			latch_nodes.insert(lit >> 1);
+
+		for (int i = 1; i < GetSize(mgr.nodes); i++)
+			if (used[i] && mgr.nodes[i].left < 0 && !node_vars.count(i) && !latch_nodes.count(i)) {
+				node_vars[i] = next_var++;
+				inputs.push_back(make_pair(mgr.nodes[i].bit, bit_name(mgr.nodes[i].bit)));
+				extra_inputs.push_back(inputs.back());
+			}
+
+		for (int i = 0; i < GetSize(latches); i++) {
+			int node = latch_q_lits[i] >> 1;
+			if (mgr.is_const(latch_q_lits[i]) || node_vars.count(node))
+				log_error("Latch output %s in module %s is also driven or used by something else.\n", log_signal(latches[i].q), log_id(module));
+			node_vars[node] = next_var++;
+		}
+
+		for (int i = 1; i < GetSize(mgr.nodes); i++)
+			if (used[i] && mgr.nodes[i].left >= 0) {
+				node_vars[i] = next_var++;
+				and_nodes.push_back(i);
+			}
+	}
+
+	static void write_varint(std::ostream &f, unsigned int x)
+	{
+		while (x & ~0x7f) {
+			f.put(char((x & 0x7f) | 0x80));
+			x >>= 7;
+		}
+		f.put(char(x));
+	}
+
+	void write(std::ostream &f, bool ascii_mode, bool symbols_mode)
+	{
+		vector<pair<SigBit, string>> extra_inputs;
+		number_nodes(extra_inputs);
+
+		for (auto &it : extra_inputs)
+			log_warning("Treating undriven signal %s in module %s as AIGER input.\n", log_signal(it.first), log_id(module));
+
+		int num_inputs = GetSize(inputs), num_latches = GetSize(latches);
+		int num_outputs = GetSize(outputs), num_ands = GetSize(and_nodes);
+
+		f << stringf("%s %d %d %d %d %d\n", ascii_mode ? "aag" : "aig", num_inputs + num_latches + num_ands,
+				num_inputs, num_latches, num_outputs, num_ands);
+
+		if (ascii_mode)
+			for (int i = 0; i < num_inputs; i++)
+				f << stringf("%d\n", 2*(i+1));
+
+		for (int i = 0; i < num_latches; i++)
+		{
+			auto &latch = latches[i];
+			int q_lit = 2*(num_inputs+i+1);
+			int d_lit = aiger_lit(latch_d_lits[i]);
+
+			if (ascii_mode)
+				f << stringf("%d ", q_lit);
+			f << stringf("%d", d_lit);
+
+			if (latch.init == State::S1)
+				f << " 1";
+			else if (latch.init != State::S0 && !zinit_mode)
+				f << stringf(" %d", q_lit);
+			f << "\n";
+		}
+
+		for (int lit : output_lits)
+			f << stringf("%d\n", aiger_lit(lit));
+
+		for (int node : and_nodes)
+		{
+			int lhs = 2*node_vars.at(node);
+			int rhs0 = aiger_lit(mgr.nodes[node].left);
+			int rhs1 = aiger_lit(mgr.nodes[node].right);
+			if (rhs0 < rhs1)
+				std::swap(rhs0, rhs1);
+
+			if (ascii_mode) {
+				f << stringf("%d %d %d\n", lhs, rhs0, rhs1);
+			} else {
+				log_assert(lhs > rhs0 && rhs0 >= rhs1);
+				write_varint(f, lhs - rhs0);
+				write_varint(f, rhs0 - rhs1);
+			}
+		}
+
+		if (symbols_mode) {
+			for (int i = 0; i < num_inputs; i++)
+				if (!inputs[i].second.empty())
+					f << stringf("i%d %s\n", i, inputs[i].second.c_str());
+			for (int i = 0; i < num_latches; i++)
+				if (!latches[i].name.empty())
+					f << stringf("l%d %s\n", i, latches[i].name.c_str());
+			for (int i = 0; i < num_outputs; i++)
+				if (!outputs[i].second.empty())
+					f << stringf("o%d %s\n", i, outputs[i].second.c_str());
+		}
+
+		f << stringf("c\nGenerated by %s\n", yosys_version_str);
+
+		log("Wrote AIG with %d inputs, %d latches, %d outputs and %d AND gates.\n",
+				num_inputs, num_latches, num_outputs, num_ands);
+	}
+};
+
+struct AigerBackend : public Backend {
+	AigerBackend() : Backend("aiger", "write design to AIGER file") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    write_aiger [options] [filename]\n");
+		log("\n");
+		log("Write the top module (or the only selected module) as an And-Inverter-Graph in\n");
+		log("AIGER format. All logic cells that have an AIG model (see 'aigmap') are\n");
+		log("supported, as well as $_DFF_P_, $_DFF_N_ and $dff cells of a single clock\n");
+		log("domain, which are written as AIGER latches. The clock itself is implicit in\n");
+		log("AIGER and is not written. Latch initial values are taken from the 'init'\n");
+		log("attributes, latches without initial value are marked as uninitialized.\n");
+		log("\n");
+		log("    -ascii\n");
+		log("        write ASCII (aag) format instead of the binary (aig) format\n");
+		log("\n");
+		log("    -zinit\n");
+		log("        initialize latches without initial value to zero\n");
+		log("\n");
+		log("    -nosymbols\n");
+		log("        do not write the symbol table with the port and latch names\n");
+		log("\n");
+		log("    -top <module>\n");
+		log("        write the specified module\n");
+		log("\n");
+	}
+	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
+	{
+		bool ascii_mode = false;
+		bool zinit_mode = false;
+		bool symbols_mode = true;
+		std::string top_module_name;
+
+		log_header("Executing AIGER backend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-ascii") {
+				ascii_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-zinit") {
+				zinit_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-nosymbols") {
+				symbols_mode = false;
+				continue;
+			}
+			if (args[argidx] == "-top" && argidx+1 < args.size()) {
+				top_module_name = RTLIL::escape_id(args[++argidx]);
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx);
+
+		Module *top_module = nullptr;
+
+		if (!top_module_name.empty()) {
+			top_module = design->module(top_module_name);
+			if (top_module == nullptr)
+				log_cmd_error("Can't find module %s.\n", top_module_name.c_str());
+		} else {
+			top_module = design->top_module();
+			if (top_module == nullptr)
+				log_cmd_error("Can't determine top module, use -top or select exactly one module.\n");
+		}
+
+		log("Writing module %s.\n", log_id(top_module));
+
+		AigerWriter writer(top_module, zinit_mode);
+		writer.write(*f, ascii_mode, symbols_mode);
+	}
+} AigerBackend;
+
+PRIVATE_NAMESPACE_END
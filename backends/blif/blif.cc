@@ -26,6 +26,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
+#include "kernel/utils.h"
 #include <string>
 
 USING_YOSYS_NAMESPACE
@@ -86,15 +87,20 @@ struct BlifDumper
 	}
 
 	vector<shared_str> cstr_buf;
+	IdStringNames names;
 
-	const char *cstr(RTLIL::IdString id)
+	static std::string make_name(RTLIL::IdString id)
 	{
 		std::string str = RTLIL::unescape_id(id);
 		for (size_t i = 0; i < str.size(); i++)
 			if (str[i] == '#' || str[i] == '=')
 				str[i] = '?';
-		cstr_buf.push_back(str);
-		return cstr_buf.back().c_str();
+		return str;
+	}
+
+	const char *cstr(RTLIL::IdString id)
+	{
+		return names.get(id, make_name).c_str();
 	}
 
 	const char *cstr(RTLIL::SigBit sig)
@@ -105,15 +111,10 @@ struct BlifDumper
 			return config->undef_type == "-" ? config->undef_out.c_str() : "$undef";
 		}
 
-		std::string str = RTLIL::unescape_id(sig.wire->name);
-		for (size_t i = 0; i < str.size(); i++)
-			if (str[i] == '#' || str[i] == '=')
-				str[i] = '?';
-
-		if (sig.wire->width != 1)
-			str += stringf("[%d]", sig.offset);
+		if (sig.wire->width == 1)
+			return cstr(sig.wire->name);
 
-		cstr_buf.push_back(str);
+		cstr_buf.push_back(stringf("%s[%d]", cstr(sig.wire->name), sig.offset));
 		return cstr_buf.back().c_str();
 	}
 
@@ -38,11 +38,12 @@ struct BtorDumperConfig
 	bool subckt_mode;
 	bool conn_mode;
 	bool impltf_mode;
+	bool verbose;
 
 	std::string buf_type, buf_in, buf_out;
 	std::string true_type, true_out, false_type, false_out;
 
-	BtorDumperConfig() : subckt_mode(false), conn_mode(false), impltf_mode(false) { }
+	BtorDumperConfig() : subckt_mode(false), conn_mode(false), impltf_mode(false), verbose(false) { }
 };
 
 struct WireInfo
@@ -61,6 +62,9 @@ struct WireInfoOrder
 	}
 };
 
+// the trace messages for each dumped object are only written with -v
+#define btor_log(...) do { if (config->verbose) log(__VA_ARGS__); } while (0)
+
 struct BtorDumper
 {
 	std::ostream &f;
@@ -71,11 +75,15 @@ struct BtorDumper
 
 	SigMap sigmap;
 	std::map<RTLIL::IdString, std::set<WireInfo,WireInfoOrder>> inter_wire_map;//<wire, dependency list> for mapping the intermediate wires that are output of some cell
-	std::map<RTLIL::IdString, int> line_ref;//mapping of ids to line_num of the btor file
-	std::map<RTLIL::SigSpec, int> sig_ref;//mapping of sigspec to the line_num of the btor file
+	dict<RTLIL::IdString, int> line_ref;//mapping of ids to line_num of the btor file
+	dict<RTLIL::SigSpec, int> sig_ref;//mapping of sigspec to the line_num of the btor file
+	dict<std::string, int> const_ref;//mapping of constant values to the line_num of the btor file
+	dict<std::tuple<int, int, int>, int> slice_ref;//<line, upper, lower> of the dumped slices
+	dict<std::pair<int, int>, int> concat_ref;//<upper line, lower line> of the dumped concats
+	dict<int, int> zero_ref;//width of the dumped zero constants
 	int line_num;//last line number of btor file
 	std::string str;//temp string for writing file
-	std::map<RTLIL::IdString, bool> basic_wires;//input wires and registers
+	dict<RTLIL::IdString, bool> basic_wires;//input wires and registers
 	RTLIL::IdString curr_cell; //current cell being dumped
 	std::map<std::string, std::string> cell_type_translation, s_cell_type_translation; //RTLIL to BTOR translation
         std::map<int, std::set<std::pair<int,int>>> mem_next; // memory (line_number)'s set of condition and write
@@ -167,25 +175,61 @@ struct BtorDumper
 		return cstr_buf.back().c_str();
 	}
 
+	// slices, concatenations and zero constants are shared by all their users
+	int dump_slice(int l, int upper, int lower, const char *tag)
+	{
+		auto key = std::make_tuple(l, upper, lower);
+		auto it = slice_ref.find(key);
+		if (it != slice_ref.end())
+			return it->second;
+		++line_num;
+		f << stringf("%d slice %d %d %d %d;%s\n", line_num, upper-lower+1, l, upper, lower, tag);
+		slice_ref[key] = line_num;
+		return line_num;
+	}
+
+	int dump_concat(int width, int l_upper, int l_lower)
+	{
+		auto key = std::make_pair(l_upper, l_lower);
+		auto it = concat_ref.find(key);
+		if (it != concat_ref.end())
+			return it->second;
+		++line_num;
+		f << stringf("%d concat %d %d %d\n", line_num, width, l_upper, l_lower);
+		concat_ref[key] = line_num;
+		return line_num;
+	}
+
+	int dump_zero(int width)
+	{
+		auto it = zero_ref.find(width);
+		if (it != zero_ref.end())
+			return it->second;
+		++line_num;
+		f << stringf("%d zero %d\n", line_num, width);
+		zero_ref[width] = line_num;
+		return line_num;
+	}
+
 	int dump_wire(RTLIL::Wire* wire)
 	{
 		if(basic_wires[wire->name])
 		{
-			log("writing wire %s\n", cstr(wire->name));
+			btor_log("writing wire %s\n", cstr(wire->name));
 			auto it = line_ref.find(wire->name);
 			if(it==std::end(line_ref))
 			{
 				++line_num;
 				line_ref[wire->name]=line_num;
 				str = stringf("%d var %d %s", line_num, wire->width, cstr(wire->name));
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				return line_num;
 			}
 			else return it->second;
 		}
 		else // case when the wire is not basic wire
 		{
-			log("case of non-basic wire - %s\n", cstr(wire->name));
+			btor_log("case of non-basic wire - %s\n", cstr(wire->name));
 			auto it = line_ref.find(wire->name);
 			if(it==std::end(line_ref))
 			{
@@ -197,7 +241,7 @@ struct BtorDumper
 					RTLIL::IdString cell_id = dep_set_it->cell_name;
 					if(cell_id == curr_cell)
 						break;
-					log(" -- found cell %s\n", cstr(cell_id));
+					btor_log(" -- found cell %s\n", cstr(cell_id));
 					RTLIL::Cell* cell = module->cells_.at(cell_id);
 					const RTLIL::SigSpec* cell_output = get_cell_output(cell);
 					int cell_line = dump_cell(cell);
@@ -217,25 +261,17 @@ struct BtorDumper
 							if(cell_output->chunks().at(j).wire->name == wire->name)
 							{
 								prev_wire_line = wire_line;
-								wire_line = ++line_num;
-								str = stringf("%d slice %d %d %d %d;1", line_num, cell_output->chunks().at(j).width,
-									cell_line, start_bit-1, start_bit-cell_output->chunks().at(j).width);
-								f << stringf("%s\n", str.c_str());
+								wire_line = dump_slice(cell_line, start_bit-1, start_bit-cell_output->chunks().at(j).width, "1");
 								wire_width += cell_output->chunks().at(j).width;
 								if(prev_wire_line!=0)
-								{
-									++line_num;
-									str = stringf("%d concat %d %d %d", line_num, wire_width, wire_line, prev_wire_line);
-									f << stringf("%s\n", str.c_str());
-									wire_line = line_num;
-								}
+									wire_line = dump_concat(wire_width, wire_line, prev_wire_line);
 							}
 						}
 					}
 				}
 				if(dep_set.size()==0)
 				{
-					log(" - checking sigmap\n");
+					btor_log(" - checking sigmap\n");
 					RTLIL::SigSpec s = RTLIL::SigSpec(wire);
 					wire_line = dump_sigspec(&s, s.size());
 					line_ref[wire->name]=wire_line;
@@ -245,7 +281,7 @@ struct BtorDumper
 			}
 			else
 			{
-				log(" -- already processed wire\n");
+				btor_log(" -- already processed wire\n");
 				return it->second;
 			}
 		}
@@ -255,7 +291,7 @@ struct BtorDumper
 
 	int dump_memory(const RTLIL::Memory* memory)
 	{
-		log("writing memory %s\n", cstr(memory->name));
+		btor_log("writing memory %s\n", cstr(memory->name));
 		auto it = line_ref.find(memory->name);
 		if(it==std::end(line_ref))
 		{
@@ -263,7 +299,7 @@ struct BtorDumper
 			int address_bits = ceil_log2(memory->size);
 			str = stringf("%d array %d %d", line_num, memory->width, address_bits);
 			line_ref[memory->name]=line_num;
-			f << stringf("%s\n", str.c_str());
+			f << str << "\n";
 			return line_num;
 		}
 		else return it->second;
@@ -291,17 +327,17 @@ struct BtorDumper
 		  auto it=cond_list.begin();
 		  ++line_num;
 		  str = stringf("%d acond %d %d %d %d %d", line_num, memory->width, address_bits, it->first, it->second, mem_it->second);
-		  f << stringf("%s\n", str.c_str());
+		  f << str << "\n";
 		  ++it;
 		  for(; it!=cond_list.end(); ++it)
 		    {
 		      ++line_num;
 		      str = stringf("%d acond %d %d %d %d %d", line_num, memory->width, address_bits, it->first, it->second, line_num-1);
-		      f << stringf("%s\n", str.c_str());
+		      f << str << "\n";
 		    }
 		  ++line_num;
 		  str = stringf("%d anext %d %d %d %d", line_num, memory->width, address_bits, mem_it->second, line_num-1);
-		  f << stringf("%s\n", str.c_str());
+		  f << str << "\n";
 		  return 1;
 		}
 	      return 0;
@@ -310,7 +346,7 @@ struct BtorDumper
 
 	int dump_const(const RTLIL::Const* data, int width, int offset)
 	{
-		log("writing const \n");
+		btor_log("writing const \n");
 		if((data->flags & RTLIL::CONST_FLAG_STRING) == 0)
 		{
 			if(width<0)
@@ -320,9 +356,14 @@ struct BtorDumper
 			//if(offset > 0)
 				data_str = data_str.substr(offset, width);
 
+			auto it = const_ref.find(data_str);
+			if (it != const_ref.end())
+				return it->second;
+
 			++line_num;
 			str = stringf("%d const %d %s", line_num, width, data_str.c_str());
-			f << stringf("%s\n", str.c_str());
+			f << str << "\n";
+			const_ref[data_str] = line_num;
 			return line_num;
 		}
 		else
@@ -333,7 +374,7 @@ struct BtorDumper
 
 	int dump_sigchunk(const RTLIL::SigChunk* chunk)
 	{
-		log("writing sigchunk\n");
+		btor_log("writing sigchunk\n");
 		int l=-1;
 		if(chunk->wire == NULL)
 		{
@@ -348,11 +389,7 @@ struct BtorDumper
 			{
 				int wire_line_num = dump_wire(chunk->wire);
 				log_assert(wire_line_num>0);
-				++line_num;
-				str = stringf("%d slice %d %d %d %d;2", line_num, chunk->width, wire_line_num,
-					chunk->width + chunk->offset - 1, chunk->offset);
-				f << stringf("%s\n", str.c_str());
-				l = line_num;
+				l = dump_slice(wire_line_num, chunk->width + chunk->offset - 1, chunk->offset, "2");
 			}
 		}
 		return l;
@@ -360,7 +397,7 @@ struct BtorDumper
 
 	int dump_sigspec(const RTLIL::SigSpec* sig, int expected_width)
 	{
-		log("writing sigspec\n");
+		btor_log("writing sigspec\n");
 		RTLIL::SigSpec s = sigmap(*sig);
 		int l = -1;
 		auto it = sig_ref.find(s);
@@ -381,13 +418,10 @@ struct BtorDumper
 					l2 = dump_sigchunk(&s.chunks().at(i));
 					log_assert(l2>0);
 					w2 = s.chunks().at(i).width;
-					++line_num;
-					str = stringf("%d concat %d %d %d", line_num, w1+w2, l2, l1);
-					f << stringf("%s\n", str.c_str());
-					l1=line_num;
+					l1 = dump_concat(w1+w2, l2, l1);
 					w1+=w2;
 				}
-				l = line_num;
+				l = l1;
 			}
 			sig_ref[s] = l;
 		}
@@ -398,25 +432,17 @@ struct BtorDumper
 
 		if (expected_width != s.size())
 		{
-			log(" - changing width of sigspec\n");
+			btor_log(" - changing width of sigspec\n");
 			//TODO: this block may not be needed anymore, due to explicit type conversion by "splice" command
 			if(expected_width > s.size())
 			{
 				//TODO: case the signal is signed
-				++line_num;
-				str = stringf ("%d zero %d", line_num, expected_width - s.size());
-				f << stringf("%s\n", str.c_str());
-				++line_num;
-				str = stringf ("%d concat %d %d %d", line_num, expected_width, line_num-1, l);
-				f << stringf("%s\n", str.c_str());
-				l = line_num;
+				int zero_line = dump_zero(expected_width - s.size());
+				l = dump_concat(expected_width, zero_line, l);
 			}
 			else if(expected_width < s.size())
 			{
-				++line_num;
-				str = stringf ("%d slice %d %d %d %d;3", line_num, expected_width, l, expected_width-1, 0);
-				f << stringf("%s\n", str.c_str());
-				l = line_num;
+				l = dump_slice(l, expected_width-1, 0, "3");
 			}
 		}
 		log_assert(l>0);
@@ -432,7 +458,7 @@ struct BtorDumper
 			//assert cell
 			if(cell->type == "$assert")
 			{
-				log("writing assert cell - %s\n", cstr(cell->type));
+				btor_log("writing assert cell - %s\n", cstr(cell->type));
 				const RTLIL::SigSpec* expr = &cell->getPort(RTLIL::IdString("\\A"));
 				const RTLIL::SigSpec* en = &cell->getPort(RTLIL::IdString("\\EN"));
 				log_assert(expr->size() == 1);
@@ -441,28 +467,28 @@ struct BtorDumper
 				int en_line = dump_sigspec(en, 1);
 				int one_line = ++line_num;
 				str = stringf("%d one 1", line_num);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d %s %d %d %d", line_num, cell_type_translation.at("$eq").c_str(), 1, en_line, one_line);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d %s %d %d %d %d", line_num, cell_type_translation.at("$mux").c_str(), 1, line_num-1,
 					expr_line, one_line);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				int cell_line = ++line_num;
 				str = stringf("%d %s %d %d", line_num, cell_type_translation.at("$assert").c_str(), 1, -1*(line_num-1));
 				//multiplying the line number with -1, which means logical negation
 				//the reason for negative sign is that the properties in btor are given as "negation of the original property"
 				//bug identified by bobosoft
 				//http://www.reddit.com/r/yosys/comments/1w3xig/btor_backend_bug/
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=cell_line;
 			}
 			//unary cells
 			else if(cell->type == "$not" || cell->type == "$neg" || cell->type == "$pos" || cell->type == "$reduce_and" ||
 				cell->type == "$reduce_or" || cell->type == "$reduce_xor" || cell->type == "$reduce_bool")
 			{
-				log("writing unary cell - %s\n", cstr(cell->type));
+				btor_log("writing unary cell - %s\n", cstr(cell->type));
 				int w = cell->parameters.at(RTLIL::IdString("\\A_WIDTH")).as_int();
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				w = w>output_width ? w:output_width; //padding of w
@@ -473,20 +499,20 @@ struct BtorDumper
 					cell_line = ++line_num;
 					bool reduced = (cell->type == "$not" || cell->type == "$neg") ? false : true;
 					str = stringf ("%d %s %d %d", cell_line, cell_type_translation.at(cell->type.str()).c_str(), reduced?output_width:w, l);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 				}
 				if(output_width < w && (cell->type == "$not" || cell->type == "$neg" || cell->type == "$pos"))
 				{
 					++line_num;
 					str = stringf ("%d slice %d %d %d %d;4", line_num, output_width, cell_line, output_width-1, 0);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					cell_line = line_num;
 				}
 				line_ref[cell->name]=cell_line;
 			}
 			else if(cell->type == "$reduce_xnor" || cell->type == "$logic_not")//no direct translation in btor
 			{
-				log("writing unary cell - %s\n", cstr(cell->type));
+				btor_log("writing unary cell - %s\n", cstr(cell->type));
 				int w = cell->parameters.at(RTLIL::IdString("\\A_WIDTH")).as_int();
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				log_assert(output_width == 1);
@@ -495,17 +521,17 @@ struct BtorDumper
 				{
 					++line_num;
 					str = stringf ("%d %s %d %d", line_num, cell_type_translation.at("$reduce_or").c_str(), output_width, l);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 				}
 				else if(cell->type == "$reduce_xnor")
 				{
 					++line_num;
 					str = stringf ("%d %s %d %d", line_num, cell_type_translation.at("$reduce_xor").c_str(), output_width, l);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 				}
 				++line_num;
 				str = stringf ("%d %s %d %d", line_num, cell_type_translation.at("$not").c_str(), output_width, l);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			//binary cells
@@ -513,7 +539,7 @@ struct BtorDumper
 				 cell->type == "$lt" || cell->type == "$le" || cell->type == "$eq" || cell->type == "$ne" ||
 				 cell->type == "$eqx" || cell->type == "$nex" || cell->type == "$ge" || cell->type == "$gt" )
 			{
-				log("writing binary cell - %s\n", cstr(cell->type));
+				btor_log("writing binary cell - %s\n", cstr(cell->type));
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				log_assert(!(cell->type == "$eq" || cell->type == "$ne" || cell->type == "$eqx" || cell->type == "$nex" ||
 					cell->type == "$ge" || cell->type == "$gt") || output_width == 1);
@@ -541,7 +567,7 @@ struct BtorDumper
 				}
 
 				str = stringf ("%d %s %d %d %d", line_num, op.c_str(), output_width, l1, l2);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 
 				line_ref[cell->name]=line_num;
 			}
@@ -549,7 +575,7 @@ struct BtorDumper
 				 cell->type == "$mod" )
 			{
 				//TODO: division by zero case
-				log("writing binary cell - %s\n", cstr(cell->type));
+				btor_log("writing binary cell - %s\n", cstr(cell->type));
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				bool l1_signed = cell->parameters.at(RTLIL::IdString("\\A_SIGNED")).as_bool();
 				bool l2_signed = cell->parameters.at(RTLIL::IdString("\\B_SIGNED")).as_bool();
@@ -576,19 +602,19 @@ struct BtorDumper
 						op = s_cell_type_translation.at("$mody");
 				}
 				str = stringf ("%d %s %d %d %d", line_num, op.c_str(), l1_width, l1, l2);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 
 				if(output_width < l1_width)
 				{
 					++line_num;
 					str = stringf ("%d slice %d %d %d %d;5", line_num, output_width, line_num-1, output_width-1, 0);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 				}
 				line_ref[cell->name]=line_num;
 			}
 			else if(cell->type == "$shr" || cell->type == "$shl" || cell->type == "$sshr" || cell->type == "$sshl" || cell->type == "$shift" || cell->type == "$shiftx")
 			{
-				log("writing binary cell - %s\n", cstr(cell->type));
+				btor_log("writing binary cell - %s\n", cstr(cell->type));
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				bool l1_signed = cell->parameters.at(RTLIL::IdString("\\A_SIGNED")).as_bool();
 				//bool l2_signed = cell->parameters.at(RTLIL::IdString("\\B_SIGNED")).as_bool();
@@ -600,7 +626,7 @@ struct BtorDumper
 				int l2 = dump_sigspec(&cell->getPort(RTLIL::IdString("\\B")), ceil_log2(l1_width));
 				int cell_output = ++line_num;
 				str = stringf ("%d %s %d %d %d", line_num, cell_type_translation.at(cell->type.str()).c_str(), l1_width, l1, l2);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 
 				if(l2_width > ceil_log2(l1_width))
 				{
@@ -608,19 +634,19 @@ struct BtorDumper
 					l2 = dump_sigspec(&cell->getPort(RTLIL::IdString("\\B")), l2_width);
 					++line_num;
 					str = stringf ("%d slice %d %d %d %d;6", line_num, extra_width, l2, l2_width-1, l2_width-extra_width);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					++line_num;
 					str = stringf ("%d one %d", line_num, extra_width);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					int mux = ++line_num;
 					str = stringf ("%d %s %d %d %d", line_num, cell_type_translation.at("$gt").c_str(), 1, line_num-2, line_num-1);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					++line_num;
 					str = stringf("%d %s %d", line_num, l1_signed && cell->type == "$sshr" ? "ones":"zero", l1_width);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					++line_num;
 					str = stringf ("%d %s %d %d %d %d", line_num, cell_type_translation.at("$mux").c_str(), l1_width, mux, line_num-1, cell_output);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					cell_output = line_num;
 				}
 
@@ -628,14 +654,14 @@ struct BtorDumper
 				{
 					++line_num;
 					str = stringf ("%d slice %d %d %d %d;5", line_num, output_width, cell_output, output_width-1, 0);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					cell_output = line_num;
 				}
 				line_ref[cell->name] = cell_output;
 			}
 			else if(cell->type == "$logic_and" || cell->type == "$logic_or")//no direct translation in btor
 			{
-				log("writing binary cell - %s\n", cstr(cell->type));
+				btor_log("writing binary cell - %s\n", cstr(cell->type));
 				int output_width = cell->parameters.at(RTLIL::IdString("\\Y_WIDTH")).as_int();
 				log_assert(output_width == 1);
 				int l1 = dump_sigspec(&cell->getPort(RTLIL::IdString("\\A")), output_width);
@@ -646,14 +672,14 @@ struct BtorDumper
 				{
 					++line_num;
 					str = stringf ("%d %s %d %d", line_num, cell_type_translation.at("$reduce_or").c_str(), output_width, l1);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					l1 = line_num;
 				}
 				if(l2_width > 1)
 				{
 					++line_num;
 					str = stringf ("%d %s %d %d", line_num, cell_type_translation.at("$reduce_or").c_str(), output_width, l2);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					l2 = line_num;
 				}
 				if(cell->type == "$logic_and")
@@ -666,13 +692,13 @@ struct BtorDumper
 					++line_num;
 					str = stringf ("%d %s %d %d %d", line_num, cell_type_translation.at("$or").c_str(), output_width, l1, l2);
 				}
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			//multiplexers
 			else if(cell->type == "$mux")
 			{
-				log("writing mux cell\n");
+				btor_log("writing mux cell\n");
 				int output_width = cell->parameters.at(RTLIL::IdString("\\WIDTH")).as_int();
 				int l1 = dump_sigspec(&cell->getPort(RTLIL::IdString("\\A")), output_width);
 				int l2 = dump_sigspec(&cell->getPort(RTLIL::IdString("\\B")), output_width);
@@ -681,12 +707,12 @@ struct BtorDumper
 				str = stringf ("%d %s %d %d %d %d",
 					line_num, cell_type_translation.at(cell->type.str()).c_str(), output_width, s, l2, l1);
 				//if s is 0 then l1, if s is 1 then l2 //according to the implementation of mux cell
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			else if(cell->type == "$pmux")
                         {
-                          log("writing pmux cell\n");
+                          btor_log("writing pmux cell\n");
                           int output_width = cell->parameters.at(RTLIL::IdString("\\WIDTH")).as_int();
                           int select_width = cell->parameters.at(RTLIL::IdString("\\S_WIDTH")).as_int();
                           int default_case = dump_sigspec(&cell->getPort(RTLIL::IdString("\\A")), output_width);
@@ -698,23 +724,23 @@ struct BtorDumper
                           {
                             ++line_num;
                             str = stringf ("%d slice 1 %d %d %d", line_num, select, i, i);
-                            f << stringf("%s\n", str.c_str());
+                            f << str << "\n";
                             c[i] = line_num;
                             ++line_num;
                             str = stringf ("%d slice %d %d %d %d", line_num, output_width, cases, i*output_width+output_width-1,
                                            i*output_width);
-                            f << stringf("%s\n", str.c_str());
+                            f << str << "\n";
                           }
 
                           ++line_num;
                           str = stringf ("%d cond %d %d %d %d", line_num, output_width, c[select_width-1], c[select_width-1]+1, default_case);
-                          f << stringf("%s\n", str.c_str());
+                          f << str << "\n";
 
                           for (int i=select_width-2; i>=0; --i)
                           {
                             ++line_num;
                             str = stringf ("%d cond %d %d %d %d", line_num, output_width, c[i], c[i]+1, line_num-1);
-                            f << stringf("%s\n", str.c_str());
+                            f << str << "\n";
                           }
 
                           line_ref[cell->name]=line_num;
@@ -723,9 +749,9 @@ struct BtorDumper
 			else if(cell->type == "$dff" || cell->type == "$adff" || cell->type == "$dffsr")
 			{
 				//TODO: remodelling of adff cells
-				log("writing cell - %s\n", cstr(cell->type));
+				btor_log("writing cell - %s\n", cstr(cell->type));
 				int output_width = cell->parameters.at(RTLIL::IdString("\\WIDTH")).as_int();
-				log(" - width is %d\n", output_width);
+				btor_log(" - width is %d\n", output_width);
 				int cond = dump_sigspec(&cell->getPort(RTLIL::IdString("\\CLK")), 1);
 				bool polarity = cell->parameters.at(RTLIL::IdString("\\CLK_POLARITY")).as_bool();
 				const RTLIL::SigSpec* cell_output = &cell->getPort(RTLIL::IdString("\\Q"));
@@ -743,7 +769,7 @@ struct BtorDumper
 						slice = ++line_num;
 						str = stringf ("%d slice %d %d %d %d;", line_num, output_width, value, start_bit-1,
 							start_bit-output_width);
-						f << stringf("%s\n", str.c_str());
+						f << str << "\n";
 					}
 					if(cell->type == "$dffsr")
 					{
@@ -756,14 +782,14 @@ struct BtorDumper
 						str = stringf ("%d %s %d %s%d %s%d %d", line_num, cell_type_translation.at("$mux").c_str(),
 							output_width, sync_reset_pol ? "":"-", sync_reset, sync_reset_value_pol? "":"-",
 							sync_reset_value, slice);
-						f << stringf("%s\n", str.c_str());
+						f << str << "\n";
 						slice = line_num;
 					}
 					++line_num;
 					str = stringf ("%d %s %d %s%d %d %d", line_num, cell_type_translation.at("$mux").c_str(),
 						output_width, polarity?"":"-", cond, slice, reg);
 
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 					int next = line_num;
 					if(cell->type == "$adff")
 					{
@@ -774,19 +800,19 @@ struct BtorDumper
 						++line_num;
 						str = stringf ("%d %s %d %s%d %d %d", line_num, cell_type_translation.at("$mux").c_str(),
 							output_width, async_reset_pol ? "":"-", async_reset, async_reset_value, next);
-						f << stringf("%s\n", str.c_str());
+						f << str << "\n";
 					}
 					++line_num;
 					str = stringf ("%d %s %d %d %d", line_num, cell_type_translation.at(cell->type.str()).c_str(),
 						output_width, reg, next);
-					f << stringf("%s\n", str.c_str());
+					f << str << "\n";
 				}
 				line_ref[cell->name]=line_num;
 			}
 			//memories
 			else if(cell->type == "$memrd")
 			{
-				log("writing memrd cell\n");
+				btor_log("writing memrd cell\n");
 				if (cell->parameters.at("\\CLK_ENABLE").as_bool() == true)
 					log_error("The btor backen does not support $memrd cells with built-in registers. Run memory_dff with -wr_only.\n");
 				str = cell->parameters.at(RTLIL::IdString("\\MEMID")).decode_string();
@@ -796,12 +822,12 @@ struct BtorDumper
 				int data_width = cell->parameters.at(RTLIL::IdString("\\WIDTH")).as_int();
 				++line_num;
 				str = stringf("%d read %d %d %d", line_num, data_width, mem, address);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			else if(cell->type == "$memwr")
 			{
-				log("writing memwr cell\n");
+				btor_log("writing memwr cell\n");
 				if (cell->parameters.at("\\CLK_ENABLE").as_bool() == false)
 					log_error("The btor backen does not support $memwr cells without built-in registers. Run memory_dff (but with -wr_only).\n");
 				int clk = dump_sigspec(&cell->getPort(RTLIL::IdString("\\CLK")), 1);
@@ -823,10 +849,10 @@ struct BtorDumper
                                         RTLIL::Memory *memory = module->memories.at(RTLIL::IdString(str.c_str()));
                                         int address_bits = ceil_log2(memory->size);
                                         str = stringf("%d array %d %d", line_num, memory->width, address_bits);
-                                        f << stringf("%s\n", str.c_str());
+                                        f << str << "\n";
                                         ++line_num;
                                         str = stringf("%d eq 1 %d %d; mem invar", line_num, mem, line_num - 1);
-                                        f << stringf("%s\n", str.c_str());
+                                        f << str << "\n";
                                         mem = line_num - 1;
 				}
 				*/
@@ -835,29 +861,29 @@ struct BtorDumper
 					str = stringf("%d one 1", line_num);
 				else
 					str = stringf("%d zero 1", line_num);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d eq 1 %d %d", line_num, clk, line_num-1);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d and 1 %d %d", line_num, line_num-1, enable);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d write %d %d %d %d %d", line_num, data_width, address_width, mem, address, data);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				/*
 				++line_num;
 				str = stringf("%d acond %d %d %d %d %d", line_num, data_width, address_width, line_num-2, line_num-1, mem);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				++line_num;
 				str = stringf("%d anext %d %d %d %d", line_num, data_width, address_width, mem, line_num-1);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				*/
 				mem_next[mem].insert(std::make_pair(line_num-1, line_num));
 			}
 			else if(cell->type == "$slice")
 			{
-				log("writing slice cell\n");
+				btor_log("writing slice cell\n");
 				const RTLIL::SigSpec* input = &cell->getPort(RTLIL::IdString("\\A"));
 				int input_width = cell->parameters.at(RTLIL::IdString("\\A_WIDTH")).as_int();
 				log_assert(input->size() == input_width);
@@ -868,12 +894,12 @@ struct BtorDumper
 				int offset = cell->parameters.at(RTLIL::IdString("\\OFFSET")).as_int();
 				++line_num;
 				str = stringf("%d %s %d %d %d %d", line_num, cell_type_translation.at(cell->type.str()).c_str(), output_width, input_line, output_width+offset-1, offset);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			else if(cell->type == "$concat")
 			{
-				log("writing concat cell\n");
+				btor_log("writing concat cell\n");
 				const RTLIL::SigSpec* input_a = &cell->getPort(RTLIL::IdString("\\A"));
 				int input_a_width = cell->parameters.at(RTLIL::IdString("\\A_WIDTH")).as_int();
 				log_assert(input_a->size() == input_a_width);
@@ -885,7 +911,7 @@ struct BtorDumper
 				++line_num;
 				str = stringf("%d %s %d %d %d", line_num, cell_type_translation.at(cell->type.str()).c_str(), input_a_width+input_b_width,
 					input_a_line, input_b_line);
-				f << stringf("%s\n", str.c_str());
+				f << str << "\n";
 				line_ref[cell->name]=line_num;
 			}
 			curr_cell.clear();
@@ -924,14 +950,14 @@ struct BtorDumper
 		int l = dump_wire(wire);
 		++line_num;
 		str = stringf("%d root 1 %d", line_num, l);
-		f << stringf("%s\n", str.c_str());
+		f << str << "\n";
 	}
 
 	void dump()
 	{
 		f << stringf(";module %s\n", cstr(module->name));
 
-		log("creating intermediate wires map\n");
+		btor_log("creating intermediate wires map\n");
 		//creating map of intermediate wires as output of some cell
 		for (auto it = module->cells_.begin(); it != module->cells_.end(); ++it)
 		{
@@ -941,7 +967,7 @@ struct BtorDumper
 				continue;
 			RTLIL::SigSpec s = sigmap(*output_sig);
 			output_sig = &s;
-			log(" - %s\n", cstr(it->second->type));
+			btor_log(" - %s\n", cstr(it->second->type));
 			if (cell->type == "$memrd")
 			{
 				for(unsigned i=0; i<output_sig->chunks().size(); ++i)
@@ -977,7 +1003,7 @@ struct BtorDumper
 			}
 		}
 
-		log("writing input\n");
+		btor_log("writing input\n");
 		std::map<int, RTLIL::Wire*> inputs, outputs;
 		std::vector<RTLIL::Wire*> safety;
 
@@ -999,25 +1025,25 @@ struct BtorDumper
 		}
 		f << stringf("\n");
 
-		log("writing memories\n");
+		btor_log("writing memories\n");
 		for(auto mem_it = module->memories.begin(); mem_it != module->memories.end(); ++mem_it)
 		{
 			dump_memory(mem_it->second);
 		}
 
-		log("writing output wires\n");
+		btor_log("writing output wires\n");
 		for (auto &it : outputs) {
 			RTLIL::Wire *wire = it.second;
 			dump_wire(wire);
 		}
 
-		log("writing cells\n");
+		btor_log("writing cells\n");
 		for(auto cell_it = module->cells_.begin(); cell_it != module->cells_.end(); ++cell_it)
 		{
 			dump_cell(cell_it->second);
 		}
 
-		log("writing memory next");
+		btor_log("writing memory next");
 		for(auto mem_it = module->memories.begin(); mem_it != module->memories.end(); ++mem_it)
 		  {
 		    dump_memory_next(mem_it->second);
@@ -1028,7 +1054,7 @@ struct BtorDumper
 
 		f << stringf("\n");
 
-		log("writing outputs info\n");
+		btor_log("writing outputs info\n");
 		f << stringf(";outputs\n");
 		for (auto &it : outputs) {
 			RTLIL::Wire *wire = it.second;
@@ -1052,9 +1078,12 @@ struct BtorBackend : public Backend {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    write_btor [filename]\n");
+		log("    write_btor [options] [filename]\n");
 		log("\n");
 		log("Write the current design to an BTOR file.\n");
+		log("\n");
+		log("    -v\n");
+		log("        print a message for each dumped wire, cell and signal\n");
 	}
 
 	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
@@ -1067,7 +1096,15 @@ struct BtorBackend : public Backend {
 
 		log_header("Executing BTOR backend.\n");
 
-		size_t argidx=1;
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-v") {
+				config.verbose = true;
+				continue;
+			}
+			break;
+		}
 		extra_args(f, filename, args, argidx);
 
 		if (top_module_name.empty())
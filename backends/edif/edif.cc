@@ -25,24 +25,44 @@
 #include "kernel/sigtools.h"
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
+#include "kernel/utils.h"
 #include <string>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-#define EDIF_DEF(_id) edif_names(RTLIL::unescape_id(_id), true).c_str()
-#define EDIF_REF(_id) edif_names(RTLIL::unescape_id(_id), false).c_str()
+#define EDIF_DEF(_id) edif_names.def(_id).c_str()
+#define EDIF_REF(_id) edif_names.ref(_id).c_str()
 
 namespace
 {
 	struct EdifNames
 	{
 		int counter;
-		std::set<std::string> generated_names, used_names;
-		std::map<std::string, std::string> name_map;
+		pool<std::string> generated_names, used_names;
+		dict<std::string, std::string> name_map;
+		IdStringNames def_names, ref_names;
 
 		EdifNames() : counter(1) { }
 
+		// the name for an id does not change once it was created, so the
+		// names for IdStrings are only created once
+		const std::string &def(RTLIL::IdString id) {
+			return def_names.get(id, [&](RTLIL::IdString id) { return operator()(RTLIL::unescape_id(id), true); });
+		}
+
+		const std::string &ref(RTLIL::IdString id) {
+			return ref_names.get(id, [&](RTLIL::IdString id) { return operator()(RTLIL::unescape_id(id), false); });
+		}
+
+		std::string def(const std::string &id) {
+			return operator()(RTLIL::unescape_id(id), true);
+		}
+
+		std::string ref(const std::string &id) {
+			return operator()(RTLIL::unescape_id(id), false);
+		}
+
 		std::string operator()(std::string id, bool define)
 		{
 			if (define) {
@@ -50,8 +70,9 @@ namespace
 				return new_id != id ? stringf("(rename %s \"%s\")", new_id.c_str(), id.c_str()) : id;
 			}
 
-			if (name_map.count(id) > 0)
-				return name_map.at(id);
+			auto it = name_map.find(id);
+			if (it != name_map.end())
+				return it->second;
 			if (generated_names.count(id) > 0)
 				goto do_rename;
 			if (id == "GND" || id == "VCC")
@@ -87,6 +108,19 @@ namespace
 	};
 }
 
+// one (portRef ..) entry of a net: a module port bit (cell == nullptr) or a
+// cell port bit, member is -1 for single bit ports
+struct EdifPortRef
+{
+	int net;
+	RTLIL::Cell *cell;
+	RTLIL::IdString port;
+	int member;
+
+	EdifPortRef(int net, RTLIL::Cell *cell, RTLIL::IdString port, int member) :
+			net(net), cell(cell), port(port), member(member) { }
+};
+
 struct EdifBackend : public Backend {
 	EdifBackend() : Backend("edif", "write design to EDIF netlist file") { }
 	virtual void help()
@@ -261,8 +295,23 @@ struct EdifBackend : public Backend {
 			if (module->get_bool_attribute("\\blackbox"))
 				continue;
 
+			// nets are numbered densely in order of first use and all port
+			// references are kept in one flat vector, they are grouped by
+			// net when the module is written
 			SigMap sigmap(module);
-			std::map<RTLIL::SigSpec, std::set<std::string>> net_join_db;
+			dict<RTLIL::SigBit, int> net_ids;
+			std::vector<RTLIL::SigBit> net_bits;
+			std::vector<EdifPortRef> net_refs;
+
+			auto net_id = [&](RTLIL::SigBit bit) -> int {
+				auto it = net_ids.find(bit);
+				if (it != net_ids.end())
+					return it->second;
+				int id = GetSize(net_bits);
+				net_ids[bit] = id;
+				net_bits.push_back(bit);
+				return id;
+			};
 
 			*f << stringf("    (cell %s\n", EDIF_DEF(module->name));
 			*f << stringf("      (cellType GENERIC)\n");
@@ -280,14 +329,11 @@ struct EdifBackend : public Backend {
 					dir = "OUTPUT";
 				if (wire->width == 1) {
 					*f << stringf("          (port %s (direction %s))\n", EDIF_DEF(wire->name), dir);
-					RTLIL::SigSpec sig = sigmap(RTLIL::SigSpec(wire));
-					net_join_db[sig].insert(stringf("(portRef %s)", EDIF_REF(wire->name)));
+					net_refs.push_back(EdifPortRef(net_id(sigmap(RTLIL::SigBit(wire))), nullptr, wire->name, -1));
 				} else {
 					*f << stringf("          (port (array %s %d) (direction %s))\n", EDIF_DEF(wire->name), wire->width, dir);
-					for (int i = 0; i < wire->width; i++) {
-						RTLIL::SigSpec sig = sigmap(RTLIL::SigSpec(wire, i));
-						net_join_db[sig].insert(stringf("(portRef (member %s %d))", EDIF_REF(wire->name), i));
-					}
+					for (int i = 0; i < wire->width; i++)
+						net_refs.push_back(EdifPortRef(net_id(sigmap(RTLIL::SigBit(wire, i))), nullptr, wire->name, i));
 				}
 			}
 			*f << stringf("        )\n");
@@ -323,14 +369,26 @@ struct EdifBackend : public Backend {
 				for (auto &p : cell->connections()) {
 					RTLIL::SigSpec sig = sigmap(p.second);
 					for (int i = 0; i < GetSize(sig); i++)
-						if (sig.size() == 1)
-							net_join_db[sig[i]].insert(stringf("(portRef %s (instanceRef %s))", EDIF_REF(p.first), EDIF_REF(cell->name)));
-						else
-							net_join_db[sig[i]].insert(stringf("(portRef (member %s %d) (instanceRef %s))", EDIF_REF(p.first), i, EDIF_REF(cell->name)));
+						net_refs.push_back(EdifPortRef(net_id(sig[i]), cell, p.first, sig.size() == 1 ? -1 : i));
 				}
 			}
-			for (auto &it : net_join_db) {
-				RTLIL::SigBit sig = it.first;
+
+			// counting sort of the port references by net
+			std::vector<int> net_start(GetSize(net_bits) + 1, 0);
+			for (auto &ref : net_refs)
+				net_start[ref.net + 1]++;
+			for (int i = 0; i < GetSize(net_bits); i++)
+				net_start[i + 1] += net_start[i];
+			std::vector<int> sorted_refs(GetSize(net_refs));
+			{
+				std::vector<int> next = net_start;
+				for (int i = 0; i < GetSize(net_refs); i++)
+					sorted_refs[next[net_refs[i].net]++] = i;
+			}
+			net_ids.clear();
+
+			for (int net = 0; net < GetSize(net_bits); net++) {
+				RTLIL::SigBit sig = net_bits[net];
 				if (sig.wire == NULL && sig != RTLIL::State::S0 && sig != RTLIL::State::S1)
 					continue;
 				std::string netname = log_signal(sig);
@@ -338,8 +396,14 @@ struct EdifBackend : public Backend {
 					if (netname[i] == ' ' || netname[i] == '\\')
 						netname.erase(netname.begin() + i--);
 				*f << stringf("          (net %s (joined\n", EDIF_DEF(netname));
-				for (auto &ref : it.second)
-					*f << stringf("            %s\n", ref.c_str());
+				for (int i = net_start[net]; i < net_start[net + 1]; i++) {
+					const EdifPortRef &ref = net_refs[sorted_refs[i]];
+					std::string port_ref = ref.member < 0 ? std::string(EDIF_REF(ref.port)) : stringf("(member %s %d)", EDIF_REF(ref.port), ref.member);
+					if (ref.cell == nullptr)
+						*f << stringf("            (portRef %s)\n", port_ref.c_str());
+					else
+						*f << stringf("            (portRef %s (instanceRef %s))\n", port_ref.c_str(), EDIF_REF(ref.cell->name));
+				}
 				if (sig.wire == NULL) {
 					if (nogndvcc)
 						log_error("Design contains constant nodes (map with \"hilomap\" first).\n");
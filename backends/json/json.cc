@@ -33,17 +33,77 @@ struct JsonWriter
 	std::ostream &f;
 	bool use_selection;
 	bool aig_mode;
+	bool compact;
 
 	Design *design;
 	Module *module;
 
 	SigMap sigmap;
 	int sigidcounter;
-	dict<SigBit, string> sigids;
+	dict<SigBit, int> sigids;
 	pool<Aig> aig_models;
 
-	JsonWriter(std::ostream &f, bool use_selection, bool aig_mode) :
-			f(f), use_selection(use_selection), aig_mode(aig_mode) { }
+	// the output is collected in this buffer and written to f in large blocks
+	std::string buffer;
+
+	JsonWriter(std::ostream &f, bool use_selection, bool aig_mode, bool compact = false) :
+			f(f), use_selection(use_selection), aig_mode(aig_mode), compact(compact) { }
+
+	void flush()
+	{
+		f.write(buffer.data(), buffer.size());
+		buffer.clear();
+	}
+
+	void emit(const char *str)
+	{
+		buffer += str;
+		if (GetSize(buffer) >= (1 << 16))
+			flush();
+	}
+
+	void emit(const string &str)
+	{
+		buffer += str;
+		if (GetSize(buffer) >= (1 << 16))
+			flush();
+	}
+
+	void emit_int(int value)
+	{
+		char tmp[16], *p = tmp + sizeof(tmp);
+		unsigned int v = value < 0 ? -(unsigned int)value : value;
+		do *--p = '0' + v % 10; while (v /= 10);
+		if (value < 0)
+			*--p = '-';
+		buffer.append(p, tmp + sizeof(tmp) - p);
+	}
+
+	// line break and indentation, omitted in compact mode
+	void newline(int indent)
+	{
+		if (compact)
+			return;
+		buffer += '\n';
+		buffer.append(indent, ' ');
+	}
+
+	void emit_key(const string &key)
+	{
+		emit(key);
+		emit(compact ? ":" : ": ");
+	}
+
+	void emit_string(const string &str)
+	{
+		buffer += '"';
+		for (char c : str) {
+			if (c == '\\')
+				buffer += c;
+			buffer += c;
+		}
+		buffer += '"';
+	}
 
 	string get_string(string str)
 	{
@@ -61,40 +121,93 @@ struct JsonWriter
 		return get_string(RTLIL::unescape_id(name));
 	}
 
-	string get_bits(SigSpec sig)
+	int get_bit_id(SigBit bit)
 	{
-		bool first = true;
-		string str = "[";
-		for (auto bit : sigmap(sig)) {
-			str += first ? " " : ", ";
-			first = false;
-			if (sigids.count(bit) == 0) {
-				string &s = sigids[bit];
-				if (bit.wire == nullptr) {
-					if (bit == State::S0) s = "\"0\"";
-					else if (bit == State::S1) s = "\"1\"";
-					else if (bit == State::Sz) s = "\"z\"";
-					else s = "\"x\"";
-				} else
-					s = stringf("%d", sigidcounter++);
+		auto it = sigids.find(bit);
+		if (it != sigids.end())
+			return it->second;
+		return sigids[bit] = sigidcounter++;
+	}
+
+	void emit_bit(SigBit bit)
+	{
+		if (bit.wire != nullptr)
+			emit_int(get_bit_id(bit));
+		else if (bit == State::S0)
+			buffer += "\"0\"";
+		else if (bit == State::S1)
+			buffer += "\"1\"";
+		else if (bit == State::Sz)
+			buffer += "\"z\"";
+		else
+			buffer += "\"x\"";
+	}
+
+	void emit_bits(SigSpec sig)
+	{
+		std::vector<SigBit> bits = sigmap(sig);
+
+		if (!compact) {
+			buffer += '[';
+			for (int i = 0; i < GetSize(bits); i++) {
+				buffer += i ? ", " : " ";
+				emit_bit(bits[i]);
+			}
+			emit(" ]");
+			return;
+		}
+
+		// runs of three or more consecutive bit ids are written as "<first>:<last>"
+		buffer += '[';
+		for (int i = 0; i < GetSize(bits); i++)
+		{
+			if (i)
+				buffer += ',';
+
+			if (bits[i].wire == nullptr) {
+				emit_bit(bits[i]);
+				continue;
 			}
-			str += sigids[bit];
+
+			int first_id = get_bit_id(bits[i]);
+			int j = i + 1;
+			while (j < GetSize(bits) && bits[j].wire != nullptr && get_bit_id(bits[j]) == first_id + (j - i))
+				j++;
+
+			if (j - i >= 3) {
+				buffer += '"';
+				emit_int(first_id);
+				buffer += ':';
+				emit_int(first_id + (j - i) - 1);
+				buffer += '"';
+				i = j - 1;
+			} else
+				emit_int(first_id);
 		}
-		return str + " ]";
+		emit("]");
+	}
+
+	static bool is_fully_def(const Const &value)
+	{
+		for (auto bit : value.bits)
+			if (bit != State::S0 && bit != State::S1)
+				return false;
+		return true;
 	}
 
 	void write_parameters(const dict<IdString, Const> &parameters)
 	{
 		bool first = true;
 		for (auto &param : parameters) {
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("            %s: ", get_name(param.first).c_str());
+			emit(first ? "" : ",");
+			newline(12);
+			emit_key(get_name(param.first));
 			if ((param.second.flags & RTLIL::ConstFlags::CONST_FLAG_STRING) != 0)
-				f << get_string(param.second.decode_string());
-			else if (GetSize(param.second.bits) > 32)
-				f << get_string(param.second.as_string());
+				emit_string(param.second.decode_string());
+			else if (GetSize(param.second.bits) == 32 && is_fully_def(param.second))
+				emit_int(param.second.as_int());
 			else
-				f << stringf("%d", param.second.as_int());
+				emit_string(param.second.as_string());
 			first = false;
 		}
 	}
@@ -109,136 +222,216 @@ struct JsonWriter
 		// reserve 0 and 1 to avoid confusion with "0" and "1"
 		sigidcounter = 2;
 
-		f << stringf("    %s: {\n", get_name(module->name).c_str());
+		emit_key(get_name(module->name));
+		emit("{");
+		newline(6);
 
-		f << stringf("      \"ports\": {");
+		emit_key("\"ports\"");
+		emit("{");
 		bool first = true;
 		for (auto n : module->ports) {
 			Wire *w = module->wire(n);
 			if (use_selection && !module->selected(w))
 				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(n).c_str());
-			f << stringf("          \"direction\": \"%s\",\n", w->port_input ? w->port_output ? "inout" : "input" : "output");
-			f << stringf("          \"bits\": %s\n", get_bits(w).c_str());
-			f << stringf("        }");
+			emit(first ? "" : ",");
+			newline(8);
+			emit_key(get_name(n));
+			emit("{");
+			newline(10);
+			emit_key("\"direction\"");
+			emit(w->port_input ? w->port_output ? "\"inout\"," : "\"input\"," : "\"output\",");
+			newline(10);
+			emit_key("\"bits\"");
+			emit_bits(w);
+			newline(8);
+			emit("}");
 			first = false;
 		}
-		f << stringf("\n      },\n");
+		newline(6);
+		emit("},");
+		newline(6);
 
-		f << stringf("      \"cells\": {");
+		emit_key("\"cells\"");
+		emit("{");
 		first = true;
 		for (auto c : module->cells()) {
 			if (use_selection && !module->selected(c))
 				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(c->name).c_str());
-			f << stringf("          \"hide_name\": %s,\n", c->name[0] == '$' ? "1" : "0");
-			f << stringf("          \"type\": %s,\n", get_name(c->type).c_str());
+			emit(first ? "" : ",");
+			newline(8);
+			emit_key(get_name(c->name));
+			emit("{");
+			newline(10);
+			emit_key("\"hide_name\"");
+			emit(c->name[0] == '$' ? "1," : "0,");
+			newline(10);
+			emit_key("\"type\"");
+			emit(get_name(c->type));
+			emit(",");
+			newline(10);
 			if (aig_mode) {
 				Aig aig(c);
 				if (!aig.name.empty()) {
-					f << stringf("          \"model\": \"%s\",\n", aig.name.c_str());
+					emit_key("\"model\"");
+					emit(stringf("\"%s\",", aig.name.c_str()));
+					newline(10);
 					aig_models.insert(aig);
 				}
 			}
-			f << stringf("          \"parameters\": {");
+			emit_key("\"parameters\"");
+			emit("{");
 			write_parameters(c->parameters);
-			f << stringf("\n          },\n");
-			f << stringf("          \"attributes\": {");
+			newline(10);
+			emit("},");
+			newline(10);
+			emit_key("\"attributes\"");
+			emit("{");
 			write_parameters(c->attributes);
-			f << stringf("\n          },\n");
+			newline(10);
+			emit("},");
+			newline(10);
 			if (c->known()) {
-				f << stringf("          \"port_directions\": {");
+				emit_key("\"port_directions\"");
+				emit("{");
 				bool first2 = true;
 				for (auto &conn : c->connections()) {
-					string direction = "output";
+					const char *direction = "\"output\"";
 					if (c->input(conn.first))
-						direction = c->output(conn.first) ? "inout" : "input";
-					f << stringf("%s\n", first2 ? "" : ",");
-					f << stringf("            %s: \"%s\"", get_name(conn.first).c_str(), direction.c_str());
+						direction = c->output(conn.first) ? "\"inout\"" : "\"input\"";
+					emit(first2 ? "" : ",");
+					newline(12);
+					emit_key(get_name(conn.first));
+					emit(direction);
 					first2 = false;
 				}
-				f << stringf("\n          },\n");
+				newline(10);
+				emit("},");
+				newline(10);
 			}
-			f << stringf("          \"connections\": {");
+			emit_key("\"connections\"");
+			emit("{");
 			bool first2 = true;
 			for (auto &conn : c->connections()) {
-				f << stringf("%s\n", first2 ? "" : ",");
-				f << stringf("            %s: %s", get_name(conn.first).c_str(), get_bits(conn.second).c_str());
+				emit(first2 ? "" : ",");
+				newline(12);
+				emit_key(get_name(conn.first));
+				emit_bits(conn.second);
 				first2 = false;
 			}
-			f << stringf("\n          }\n");
-			f << stringf("        }");
+			newline(10);
+			emit("}");
+			newline(8);
+			emit("}");
 			first = false;
 		}
-		f << stringf("\n      },\n");
+		newline(6);
+		emit("},");
+		newline(6);
 
-		f << stringf("      \"netnames\": {");
+		emit_key("\"netnames\"");
+		emit("{");
 		first = true;
 		for (auto w : module->wires()) {
 			if (use_selection && !module->selected(w))
 				continue;
-			f << stringf("%s\n", first ? "" : ",");
-			f << stringf("        %s: {\n", get_name(w->name).c_str());
-			f << stringf("          \"hide_name\": %s,\n", w->name[0] == '$' ? "1" : "0");
-			f << stringf("          \"bits\": %s,\n", get_bits(w).c_str());
-			f << stringf("          \"attributes\": {");
+			emit(first ? "" : ",");
+			newline(8);
+			emit_key(get_name(w->name));
+			emit("{");
+			newline(10);
+			emit_key("\"hide_name\"");
+			emit(w->name[0] == '$' ? "1," : "0,");
+			newline(10);
+			emit_key("\"bits\"");
+			emit_bits(w);
+			emit(",");
+			newline(10);
+			emit_key("\"attributes\"");
+			emit("{");
 			write_parameters(w->attributes);
-			f << stringf("\n          }\n");
-			f << stringf("        }");
+			newline(10);
+			emit("}");
+			newline(8);
+			emit("}");
 			first = false;
 		}
-		f << stringf("\n      }\n");
+		newline(6);
+		emit("}");
+		newline(4);
 
-		f << stringf("    }");
+		emit("}");
 	}
 
 	void write_design(Design *design_)
 	{
 		design = design_;
-		f << stringf("{\n");
-		f << stringf("  \"creator\": %s,\n", get_string(yosys_version_str).c_str());
-		f << stringf("  \"modules\": {\n");
+		emit("{");
+		newline(2);
+		emit_key("\"creator\"");
+		emit(get_string(yosys_version_str));
+		emit(",");
+		newline(2);
+		emit_key("\"modules\"");
+		emit("{");
+		newline(4);
 		vector<Module*> modules = use_selection ? design->selected_modules() : design->modules();
 		bool first_module = true;
 		for (auto mod : modules) {
-			if (!first_module)
-				f << stringf(",\n");
+			if (!first_module) {
+				emit(",");
+				newline(4);
+			}
 			write_module(mod);
 			first_module = false;
 		}
-		f << stringf("\n  }");
+		newline(2);
+		emit("}");
 		if (!aig_models.empty()) {
-			f << stringf(",\n  \"models\": {\n");
+			emit(",");
+			newline(2);
+			emit_key("\"models\"");
+			emit("{");
+			newline(4);
 			bool first_model = true;
 			for (auto &aig : aig_models) {
-				if (!first_model)
-					f << stringf(",\n");
-				f << stringf("    \"%s\": [\n", aig.name.c_str());
+				if (!first_model) {
+					emit(",");
+					newline(4);
+				}
+				emit_key(stringf("\"%s\"", aig.name.c_str()));
+				emit("[");
+				newline(6);
 				int node_idx = 0;
 				for (auto &node : aig.nodes) {
-					if (node_idx != 0)
-						f << stringf(",\n");
-					f << stringf("      /* %3d */ [ ", node_idx);
+					if (node_idx != 0) {
+						emit(",");
+						newline(6);
+					}
+					if (!compact)
+						emit(stringf("/* %3d */ ", node_idx));
+					emit(compact ? "[" : "[ ");
 					if (node.portbit >= 0)
-						f << stringf("\"%sport\", \"%s\", %d", node.inverter ? "n" : "",
-								log_id(node.portname), node.portbit);
+						emit(stringf("\"%sport\", \"%s\", %d", node.inverter ? "n" : "",
+								log_id(node.portname), node.portbit));
 					else if (node.left_parent < 0 && node.right_parent < 0)
-						f << stringf("\"%s\"", node.inverter ? "true" : "false");
+						emit(stringf("\"%s\"", node.inverter ? "true" : "false"));
 					else
-						f << stringf("\"%s\", %d, %d", node.inverter ? "nand" : "and", node.left_parent, node.right_parent);
+						emit(stringf("\"%s\", %d, %d", node.inverter ? "nand" : "and", node.left_parent, node.right_parent));
 					for (auto &op : node.outports)
-						f << stringf(", \"%s\", %d", log_id(op.first), op.second);
-					f << stringf(" ]");
+						emit(stringf(", \"%s\", %d", log_id(op.first), op.second));
+					emit(compact ? "]" : " ]");
 					node_idx++;
 				}
-				f << stringf("\n    ]");
+				newline(4);
+				emit("]");
 				first_model = false;
 			}
-			f << stringf("\n  }");
+			newline(2);
+			emit("}");
 		}
-		f << stringf("\n}\n");
+		newline(0);
+		emit("}\n");
+		flush();
 	}
 };
 
@@ -255,6 +448,11 @@ struct JsonBackend : public Backend {
 		log("    -aig\n");
 		log("        include AIG models for the different gate types\n");
 		log("\n");
+		log("    -compact\n");
+		log("        write the JSON without line breaks and indentation, and encode runs\n");
+		log("        of consecutive signal bits in <bit_vector> values as a string\n");
+		log("        \"<first>:<last>\" (see below)\n");
+		log("\n");
 		log("\n");
 		log("The general syntax of the JSON output created by this command is as follows:\n");
 		log("\n");
@@ -320,6 +518,10 @@ struct JsonBackend : public Backend {
 		log("The \"hide_name\" fields are set to 1 when the name of this cell or net is\n");
 		log("automatically created and is likely not of interest for a regular user.\n");
 		log("\n");
+		log("Parameter and attribute values are written as integers if they are 32 bits wide\n");
+		log("and contain no undefined bits. Other values are written as strings of 0, 1, x\n");
+		log("and z characters (MSB first), and string values as strings.\n");
+		log("\n");
 		log("The \"port_directions\" section is only included for cells for which the\n");
 		log("interface is known.\n");
 		log("\n");
@@ -329,6 +531,11 @@ struct JsonBackend : public Backend {
 		log("connected to a constant driver are denoted as string \"0\" or \"1\" instead of\n");
 		log("a number.\n");
 		log("\n");
+		log("With -compact, three or more consecutive integers in a <bit_vector> are written\n");
+		log("as a single string \"<first>:<last>\". For example [ 5, 6, 7, 8, \"0\" ] is written\n");
+		log("as [\"5:8\",\"0\"]. Such strings always contain a colon and can therefore not be\n");
+		log("confused with the constant bits \"0\", \"1\", \"x\" and \"z\".\n");
+		log("\n");
 		log("For example the following Verilog code:\n");
 		log("\n");
 		log("    module test(input x, y);\n");
@@ -451,6 +658,7 @@ struct JsonBackend : public Backend {
 	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
 		bool aig_mode = false;
+		bool compact = false;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -459,13 +667,17 @@ struct JsonBackend : public Backend {
 				aig_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-compact") {
+				compact = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
 
 		log_header("Executing JSON backend.\n");
 
-		JsonWriter json_writer(*f, false, aig_mode);
+		JsonWriter json_writer(*f, false, aig_mode, compact);
 		json_writer.write_design(design);
 	}
 } JsonBackend;
@@ -486,6 +698,9 @@ struct JsonPass : public Pass {
 		log("    -aig\n");
 		log("        also include AIG models for the different gate types\n");
 		log("\n");
+		log("    -compact\n");
+		log("        write compact JSON without indentation (see 'help write_json')\n");
+		log("\n");
 		log("See 'help write_json' for a description of the JSON format used.\n");
 		log("\n");
 	}
@@ -493,6 +708,7 @@ struct JsonPass : public Pass {
 	{
 		std::string filename;
 		bool aig_mode = false;
+		bool compact = false;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -505,6 +721,10 @@ struct JsonPass : public Pass {
 				aig_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-compact") {
+				compact = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -513,18 +733,14 @@ struct JsonPass : public Pass {
 		std::stringstream buf;
 
 		if (!filename.empty()) {
-			std::ofstream *ff = new std::ofstream;
-			ff->open(filename.c_str(), std::ofstream::trunc);
-			if (ff->fail()) {
-				delete ff;
+			f = open_output_file(filename);
+			if (f == nullptr)
 				log_error("Can't open file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
-			}
-			f = ff;
 		} else {
 			f = &buf;
 		}
 
-		JsonWriter json_writer(*f, true, aig_mode);
+		JsonWriter json_writer(*f, true, aig_mode, compact);
 		json_writer.write_design(design);
 
 		if (!filename.empty()) {
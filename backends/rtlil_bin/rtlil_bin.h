@@ -0,0 +1,128 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  A compact binary representation of RTLIL, used by the 'write_rtlil_bin'
+ *  backend and the 'read_rtlil_bin' frontend. The file layout is:
+ *
+ *    file     := magic version autoidx strings num_modules module*
+ *    magic    := "YSRTLBIN"
+ *    strings  := count (len bytes)*            all IdStrings of the design
+ *    module   := size:u64le body               size is the length of body, so
+ *                                              a reader can skip modules
+ *    body     := name attrs avail_params wires memories cells conns procs
+ *
+ *  All other numbers are LEB128 varints (signed numbers are zigzag encoded),
+ *  IdStrings are indices into the string table and wires are referenced by
+ *  their index in the wire list of the module. A SigSpec is a list of chunks,
+ *  each either a wire index+1 followed by offset and width, or 0 followed by
+ *  a constant. Constant bits are stored as 4-bit nibbles, two per byte.
+ *
+ *  The format only uses offsets relative to the start of a section, so a file
+ *  can be read directly from a memory mapped buffer.
+ *
+ */
+
+#ifndef RTLIL_BIN_H
+#define RTLIL_BIN_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace RTLIL_BIN
+{
+	static const char magic[8] = { 'Y', 'S', 'R', 'T', 'L', 'B', 'I', 'N' };
+	static const int version = 1;
+
+	enum WireFlags {
+		WIRE_INPUT  = 1,
+		WIRE_OUTPUT = 2,
+		WIRE_UPTO   = 4
+	};
+
+	inline void write_uint(std::string &buf, uint64_t value)
+	{
+		while (value >= 0x80) {
+			buf.push_back(char(0x80 | (value & 0x7f)));
+			value >>= 7;
+		}
+		buf.push_back(char(value));
+	}
+
+	inline void write_int(std::string &buf, int64_t value)
+	{
+		write_uint(buf, (uint64_t(value) << 1) ^ uint64_t(value >> 63));
+	}
+
+	inline void write_u64le(std::string &buf, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+			buf.push_back(char((value >> (8*i)) & 0xff));
+	}
+
+	struct Reader
+	{
+		const unsigned char *ptr, *end;
+
+		Reader(const char *data, size_t size) :
+				ptr((const unsigned char*)data), end((const unsigned char*)data + size) { }
+
+		void need(size_t n) const {
+			if (size_t(end - ptr) < n)
+				log_error("Unexpected end of binary RTLIL data.\n");
+		}
+
+		uint64_t read_uint() {
+			uint64_t value = 0;
+			for (int shift = 0;; shift += 7) {
+				need(1);
+				unsigned char c = *ptr++;
+				if (shift > 63)
+					log_error("Invalid varint in binary RTLIL data.\n");
+				value |= uint64_t(c & 0x7f) << shift;
+				if ((c & 0x80) == 0)
+					return value;
+			}
+		}
+
+		int64_t read_int() {
+			uint64_t value = read_uint();
+			return int64_t(value >> 1) ^ -int64_t(value & 1);
+		}
+
+		uint64_t read_u64le() {
+			need(8);
+			uint64_t value = 0;
+			for (int i = 0; i < 8; i++)
+				value |= uint64_t(*ptr++) << (8*i);
+			return value;
+		}
+
+		const char *read_bytes(size_t n) {
+			need(n);
+			const char *p = (const char*)ptr;
+			ptr += n;
+			return p;
+		}
+	};
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
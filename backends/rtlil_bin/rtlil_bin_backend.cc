@@ -0,0 +1,259 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "backends/rtlil_bin/rtlil_bin.h"
+#include "kernel/register.h"
+
+USING_YOSYS_NAMESPACE
+using namespace RTLIL_BIN;
+PRIVATE_NAMESPACE_BEGIN
+
+struct RtlilBinWriter
+{
+	dict<RTLIL::IdString, int> string_index;
+	std::vector<RTLIL::IdString> strings;
+	dict<RTLIL::Wire*, int> wire_index;
+	std::string buf;
+
+	void write_id(RTLIL::IdString id)
+	{
+		auto it = string_index.find(id);
+		if (it == string_index.end()) {
+			string_index[id] = GetSize(strings);
+			write_uint(buf, GetSize(strings));
+			strings.push_back(id);
+		} else
+			write_uint(buf, it->second);
+	}
+
+	void write_bits(const std::vector<RTLIL::State> &bits)
+	{
+		write_uint(buf, GetSize(bits));
+		for (int i = 0; i < GetSize(bits); i += 2) {
+			int lo = bits[i], hi = i+1 < GetSize(bits) ? bits[i+1] : 0;
+			buf.push_back(char(lo | (hi << 4)));
+		}
+	}
+
+	void write_const(const RTLIL::Const &value)
+	{
+		write_uint(buf, value.flags);
+		write_bits(value.bits);
+	}
+
+	void write_sigspec(const RTLIL::SigSpec &sig)
+	{
+		const std::vector<RTLIL::SigChunk> &chunks = sig.chunks();
+		write_uint(buf, GetSize(chunks));
+		for (auto &c : chunks) {
+			if (c.wire == NULL) {
+				write_uint(buf, 0);
+				write_bits(c.data);
+			} else {
+				write_uint(buf, wire_index.at(c.wire) + 1);
+				write_uint(buf, c.offset);
+				write_uint(buf, c.width);
+			}
+		}
+	}
+
+	void write_sigsig_list(const std::vector<RTLIL::SigSig> &list)
+	{
+		write_uint(buf, GetSize(list));
+		for (auto &it : list) {
+			write_sigspec(it.first);
+			write_sigspec(it.second);
+		}
+	}
+
+	void write_attributes(const RTLIL::AttrObject *obj)
+	{
+		write_uint(buf, GetSize(obj->attributes));
+		for (auto &it : obj->attributes) {
+			write_id(it.first);
+			write_const(it.second);
+		}
+	}
+
+	void write_case(const RTLIL::CaseRule *cs)
+	{
+		write_uint(buf, GetSize(cs->compare));
+		for (auto &sig : cs->compare)
+			write_sigspec(sig);
+		write_sigsig_list(cs->actions);
+		write_uint(buf, GetSize(cs->switches));
+		for (auto sw : cs->switches) {
+			write_attributes(sw);
+			write_sigspec(sw->signal);
+			write_uint(buf, GetSize(sw->cases));
+			for (auto c : sw->cases)
+				write_case(c);
+		}
+	}
+
+	void write_module(RTLIL::Module *module)
+	{
+		wire_index.clear();
+
+		write_id(module->name);
+		write_attributes(module);
+
+		write_uint(buf, GetSize(module->avail_parameters));
+		for (auto &id : module->avail_parameters)
+			write_id(id);
+
+		write_uint(buf, GetSize(module->wires_));
+		for (auto &it : module->wires_) {
+			RTLIL::Wire *wire = it.second;
+			int idx = GetSize(wire_index);
+			wire_index[wire] = idx;
+			write_id(wire->name);
+			write_uint(buf, wire->width);
+			write_int(buf, wire->start_offset);
+			write_uint(buf, wire->port_id);
+			write_uint(buf, (wire->port_input ? WIRE_INPUT : 0) | (wire->port_output ? WIRE_OUTPUT : 0) | (wire->upto ? WIRE_UPTO : 0));
+			write_attributes(wire);
+		}
+
+		write_uint(buf, GetSize(module->memories));
+		for (auto &it : module->memories) {
+			RTLIL::Memory *memory = it.second;
+			write_id(memory->name);
+			write_uint(buf, memory->width);
+			write_int(buf, memory->start_offset);
+			write_uint(buf, memory->size);
+			write_attributes(memory);
+		}
+
+		write_uint(buf, GetSize(module->cells_));
+		for (auto &it : module->cells_) {
+			RTLIL::Cell *cell = it.second;
+			write_id(cell->name);
+			write_id(cell->type);
+			write_uint(buf, GetSize(cell->parameters));
+			for (auto &p : cell->parameters) {
+				write_id(p.first);
+				write_const(p.second);
+			}
+			write_uint(buf, GetSize(cell->connections()));
+			for (auto &conn : cell->connections()) {
+				write_id(conn.first);
+				write_sigspec(conn.second);
+			}
+			write_attributes(cell);
+		}
+
+		write_sigsig_list(module->connections());
+
+		write_uint(buf, GetSize(module->processes));
+		for (auto &it : module->processes) {
+			RTLIL::Process *proc = it.second;
+			write_id(proc->name);
+			write_attributes(proc);
+			write_case(&proc->root_case);
+			write_uint(buf, GetSize(proc->syncs));
+			for (auto sync : proc->syncs) {
+				write_uint(buf, sync->type);
+				write_sigspec(sync->signal);
+				write_sigsig_list(sync->actions);
+			}
+		}
+	}
+
+	void write_design(std::ostream &f, RTLIL::Design *design, bool only_selected)
+	{
+		std::vector<std::string> module_data;
+
+		for (auto module : design->modules()) {
+			if (only_selected && !design->selected(module))
+				continue;
+			buf.clear();
+			write_module(module);
+			module_data.push_back(std::string());
+			module_data.back().swap(buf);
+		}
+
+		buf.clear();
+		buf.append(magic, sizeof(magic));
+		write_uint(buf, version);
+		write_uint(buf, autoidx);
+
+		write_uint(buf, GetSize(strings));
+		for (auto &id : strings) {
+			write_uint(buf, id.size());
+			buf.append(id.c_str(), id.size());
+		}
+
+		write_uint(buf, GetSize(module_data));
+		for (auto &data : module_data) {
+			write_u64le(buf, data.size());
+			f.write(buf.data(), buf.size());
+			f.write(data.data(), data.size());
+			buf.clear();
+		}
+		f.write(buf.data(), buf.size());
+	}
+};
+
+struct RtlilBinBackend : public Backend {
+	RtlilBinBackend() : Backend("rtlil_bin", "write design to binary RTLIL file") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    write_rtlil_bin [options] [filename]\n");
+		log("\n");
+		log("Write the current design to a binary RTLIL file. This contains the same\n");
+		log("information as an ilang file, but is much smaller and can be loaded much\n");
+		log("faster with 'read_rtlil_bin'. It is intended for checkpointing designs, the\n");
+		log("format is not guaranteed to be compatible between yosys versions.\n");
+		log("\n");
+		log("Files with the extension .rtlb are automatically read and written using this\n");
+		log("format by the yosys command line driver.\n");
+		log("\n");
+		log("    -selected\n");
+		log("        only write selected modules. (Modules are always written completely.)\n");
+		log("\n");
+	}
+	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
+	{
+		bool selected = false;
+
+		log_header("Executing RTLIL_BIN backend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-selected") {
+				selected = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx);
+
+		design->sort();
+
+		log("Output filename: %s\n", filename.c_str());
+		RtlilBinWriter writer;
+		writer.write_design(*f, design, selected);
+	}
+} RtlilBinBackend;
+
+PRIVATE_NAMESPACE_END
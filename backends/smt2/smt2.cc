@@ -22,6 +22,8 @@
 #include "kernel/sigtools.h"
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
+#include "backends/ilang/ilang_backend.h"
+#include "libs/sha1/sha1.h"
 #include <string>
 
 USING_YOSYS_NAMESPACE
@@ -32,7 +34,7 @@ struct Smt2Worker
 	CellTypes ct;
 	SigMap sigmap;
 	RTLIL::Module *module;
-	bool bvmode, memmode, regsmode, wiresmode, verbose;
+	bool bvmode, memmode, regsmode, wiresmode, verbose, cone;
 	int idcounter;
 
 	std::vector<std::string> decls, trans;
@@ -44,9 +46,9 @@ struct Smt2Worker
 	std::map<Cell*, int> memarrays;
 	std::map<int, int> bvsizes;
 
-	Smt2Worker(RTLIL::Module *module, bool bvmode, bool memmode, bool regsmode, bool wiresmode, bool verbose) :
+	Smt2Worker(RTLIL::Module *module, bool bvmode, bool memmode, bool regsmode, bool wiresmode, bool verbose, bool cone) :
 			ct(module->design), sigmap(module), module(module), bvmode(bvmode), memmode(memmode),
-			regsmode(regsmode), wiresmode(wiresmode), verbose(verbose), idcounter(0)
+			regsmode(regsmode), wiresmode(wiresmode), verbose(verbose), cone(cone), idcounter(0)
 	{
 		decls.push_back(stringf("(declare-sort |%s_s| 0)\n", log_id(module)));
 
@@ -469,7 +471,17 @@ struct Smt2Worker
 				log_id(cell->type), log_id(module), log_id(cell));
 	}
 
-	void run()
+	// true if the logic driving the signal has already been exported, i.e.
+	// exporting the signal does not pull in any new cells
+	bool is_exported(RTLIL::SigSpec sig)
+	{
+		for (auto bit : sigmap(sig))
+			if (bit_driver.count(bit) && !exported_cells.count(bit_driver.at(bit)))
+				return false;
+		return true;
+	}
+
+	void export_wires()
 	{
 		if (verbose) log("=> export logic driving outputs\n");
 
@@ -484,6 +496,8 @@ struct Smt2Worker
 		}
 
 		for (auto wire : module->wires()) {
+			if (cone && !is_exported(wire))
+				continue;
 			bool is_register = false;
 			if (regsmode)
 				for (auto bit : SigSpec(wire))
@@ -513,12 +527,14 @@ struct Smt2Worker
 				}
 			}
 		}
+	}
 
+	void export_init(vector<string> &init_list)
+	{
 		if (verbose) log("=> export logic associated with the initial state\n");
 
-		vector<string> init_list;
 		for (auto wire : module->wires())
-			if (wire->attributes.count("\\init")) {
+			if (wire->attributes.count("\\init") && (!cone || is_exported(wire))) {
 				RTLIL::SigSpec sig = sigmap(wire);
 				Const val = wire->attributes.at("\\init");
 				val.bits.resize(GetSize(sig));
@@ -529,12 +545,24 @@ struct Smt2Worker
 						init_list.push_back(stringf("(= %s %s) ; %s", get_bool(sig[i]).c_str(), val.bits[i] == State::S1 ? "true" : "false", log_id(wire)));
 				}
 			}
+	}
+
+	void run()
+	{
+		vector<string> init_list;
+
+		// with -cone only the logic needed for the asserts is exported, and
+		// the wires and initial values are limited to this logic
+		if (!cone) {
+			export_wires();
+			export_init(init_list);
+		}
 
 		if (verbose) log("=> export logic driving asserts\n");
 
 		vector<int> assert_list, assume_list;
 		for (auto cell : module->cells())
-			if (cell->type.in("$assert", "$assume")) {
+			if (cell->type == "$assume" || (cell->type == "$assert" && (!cone || module->selected(cell)))) {
 				string name_a = get_bool(cell->getPort("\\A"));
 				string name_en = get_bool(cell->getPort("\\EN"));
 				decls.push_back(stringf("(define-fun |%s#%d| ((state |%s_s|)) Bool (or %s (not %s))) ; %s\n",
@@ -598,6 +626,11 @@ struct Smt2Worker
 			}
 		}
 
+		if (cone) {
+			export_init(init_list);
+			export_wires();
+		}
+
 		string assert_expr = assert_list.empty() ? "true" : "(and";
 		if (!assert_list.empty()) {
 			for (int i : assert_list)
@@ -699,11 +732,22 @@ struct Smt2Backend : public Backend {
 		log("\n");
 		log("    -wires\n");
 		log("        also create '<mod>_n' functions for all public wires.\n");
+		log("\n");		log("    -cone\n");
+		log("        only export the sequential cone of influence of the selected $assert\n");
+		log("        cells (and of all $assume cells). the other $assert cells are\n");
+		log("        ignored, and '<mod>_n' functions are only created for the wires\n");
+		log("        in the cone (and for all inputs).\n");
 		log("\n");
 		log("    -tpl <template_file>\n");
 		log("        use the given template file. the line containing only the token '%%%%'\n");
 		log("        is replaced with the regular output of this command.\n");
 		log("\n");
+		log("    -cache <directory>\n");
+		log("        keep the SMT-LIBv2 code generated for each module in the given (existing)\n");
+		log("        directory, keyed by a SHA1 hash of the module contents and the options\n");
+		log("        above. modules that are unchanged since an earlier call are not\n");
+		log("        exported again, their cached code is copied to the output unmodified.\n");
+		log("\n");
 		log("[1] For more information on SMT-LIBv2 visit http://smt-lib.org/ or read David\n");
 		log("R. Cok's tutorial: http://www.grammatech.com/resources/smt/SMTLIBTutorial.pdf\n");
 		log("\n");
@@ -756,7 +800,8 @@ struct Smt2Backend : public Backend {
 	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
 		std::ifstream template_f;
-		bool bvmode = false, memmode = false, regsmode = false, wiresmode = false, verbose = false;
+		bool bvmode = false, memmode = false, regsmode = false, wiresmode = false, verbose = false, cone = false;
+		std::string cache_dir;
 
 		log_header("Executing SMT2 backend.\n");
 
@@ -790,6 +835,14 @@ struct Smt2Backend : public Backend {
 				verbose = true;
 				continue;
 			}
+			if (args[argidx] == "-cone") {
+				cone = true;
+				continue;
+			}
+			if (args[argidx] == "-cache" && argidx+1 < args.size()) {
+				cache_dir = args[++argidx];
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -813,11 +866,49 @@ struct Smt2Backend : public Backend {
 			if (module->get_bool_attribute("\\blackbox") || module->has_memories_warn() || module->has_processes_warn())
 				continue;
 
+			std::string cache_file;
+			if (!cache_dir.empty()) {
+				std::stringstream module_text;
+				module_text << stringf("%s\n%d %d %d %d %d\n", yosys_version_str, bvmode, memmode, regsmode, wiresmode, cone);
+				if (cone)
+					for (auto cell : module->selected_cells())
+						if (cell->type == "$assert")
+							module_text << stringf("%s\n", log_id(cell));
+				ILANG_BACKEND::dump_module(module_text, "", module, design, false);
+				cache_file = stringf("%s/%s.smt2", cache_dir.c_str(), sha1(module_text.str()).c_str());
+
+				std::ifstream cached_f(cache_file.c_str());
+				if (!cached_f.fail()) {
+					log("Using cached SMT-LIBv2 representation of module %s.\n", log_id(module));
+					*f << cached_f.rdbuf();
+					continue;
+				}
+			}
+
 			log("Creating SMT-LIBv2 representation of module %s.\n", log_id(module));
 
-			Smt2Worker worker(module, bvmode, memmode, regsmode, wiresmode, verbose);
+			Smt2Worker worker(module, bvmode, memmode, regsmode, wiresmode, verbose, cone);
 			worker.run();
-			worker.write(*f);
+
+			if (cache_file.empty()) {
+				worker.write(*f);
+				continue;
+			}
+
+			std::stringstream module_smt2;
+			worker.write(module_smt2);
+			*f << module_smt2.str();
+
+			// write to a temporary name first so that an interrupted run never
+			// leaves a truncated cache entry behind
+			std::string tmp_file = make_temp_file(cache_file + ".XXXXXX");
+			std::ofstream cache_f(tmp_file.c_str());
+			cache_f << module_smt2.str();
+			cache_f.close();
+			if (cache_f.fail() || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+				log_warning("Can't write SMT-LIBv2 cache file `%s'.\n", cache_file.c_str());
+				remove(tmp_file.c_str());
+			}
 		}
 
 		*f << stringf("; end of yosys output\n");
@@ -17,7 +17,7 @@
 # OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #
 
-import os, sys, getopt, re
+import os, sys, getopt, re, subprocess, threading, time
 ##yosys-sys-path##
 from smtio import smtio, smtopts, mkvcd
 
@@ -28,6 +28,8 @@ vcdfile = None
 tempind = False
 assume_skipped = None
 topmod = None
+portfolio_solvers = None
+parallel_induction = False
 so = smtopts()
 
 
@@ -54,12 +56,21 @@ yosys-smtbmc [options] <yosys_smt2_output>
 
     -m <module_name>
         name of the top module
+
+    -P <solver>,<solver>,...
+        run one solver process for each of the given solvers concurrently,
+        report the first result and terminate the other processes
+
+    -I
+        run BMC and temporal induction concurrently. the result is PASSED
+        when both pass and FAILED as soon as one of them fails. (can be
+        combined with -P, then each check is run with each solver.)
 """ + so.helpmsg())
     sys.exit(1)
 
 
 try:
-    opts, args = getopt.getopt(sys.argv[1:], so.optstr + "t:u:S:c:im:")
+    opts, args = getopt.getopt(sys.argv[1:], so.optstr + "t:u:S:c:im:P:I")
 except:
     usage()
 
@@ -81,6 +92,10 @@ for o, a in opts:
         tempind = True
     elif o == "-m":
         topmod = a
+    elif o == "-P":
+        portfolio_solvers = a.split(",")
+    elif o == "-I":
+        parallel_induction = True
     elif so.handle(o, a):
         pass
     else:
@@ -90,6 +105,92 @@ if len(args) != 1:
     usage()
 
 
+def run_portfolio():
+    # each job is a (tempind, solver) pair that runs in its own yosys-smtbmc
+    # process. the first result of each check is used, a failing check
+    # stops all jobs.
+    checks = [True, False] if parallel_induction else [tempind]
+    solvers = portfolio_solvers if portfolio_solvers is not None else [so.solver]
+
+    passthrough = []
+    for o, a in opts:
+        if o in ("-t", "-u", "-S", "-m", "-v"):
+            passthrough += [o, a] if a != "" else [o]
+
+    start_time = time.time()
+    def timestamp():
+        secs = int(time.time() - start_time)
+        return "## %6d %3d:%02d:%02d " % (secs, secs // (60*60), (secs // 60) % 60, secs % 60)
+
+    jobs = []
+    for check in checks:
+        for solver in solvers:
+            job = dict(tempind=check, solver=solver, output=[], vcdfile=None, done=False)
+            job["name"] = "%s/%s" % ("induction" if check else "bmc", solver)
+            cmd = [sys.executable, sys.argv[0], "-p", "-s", solver] + passthrough
+            if check:
+                cmd.append("-i")
+            if vcdfile is not None:
+                job["vcdfile"] = "%s.%d" % (vcdfile, len(jobs))
+                cmd += ["-c", job["vcdfile"]]
+            job["proc"] = subprocess.Popen(cmd + args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            job["reader"] = threading.Thread(target=lambda job=job: job["output"].extend(
+                    line.decode("ascii", "replace") for line in job["proc"].stdout))
+            job["reader"].start()
+            print("%s Started %s." % (timestamp(), job["name"]))
+            jobs.append(job)
+
+    results = dict()
+    winners = dict()
+    while len(results) < len(checks):
+        running = [job for job in jobs if not job["done"] and job["tempind"] not in results]
+        if len(running) == 0:
+            break
+        for job in running:
+            if job["tempind"] in results or job["proc"].poll() is None:
+                continue
+            job["reader"].join()
+            job["done"] = True
+            status = [line for line in job["output"] if " Status: " in line]
+            if len(status) == 0:
+                print("%s Job %s terminated without a result (exit code %d)." % (timestamp(), job["name"], job["proc"].returncode))
+                continue
+            passed = job["proc"].returncode == 0
+            print("%s Job %s finished first: %s" % (timestamp(), job["name"], "PASSED" if passed else "FAILED"))
+            results[job["tempind"]] = passed
+            winners[job["tempind"]] = job
+        if False in results.values():
+            break
+        time.sleep(0.1)
+
+    for job in jobs:
+        if job["proc"].poll() is None:
+            job["proc"].kill()
+            job["proc"].wait()
+        job["reader"].join()
+
+    for check in checks:
+        if check in winners:
+            print("%s Output of %s:" % (timestamp(), winners[check]["name"]))
+            for line in winners[check]["output"]:
+                print("    " + line, end="")
+
+    for job in jobs:
+        if job["vcdfile"] is not None and os.path.exists(job["vcdfile"]):
+            if job in winners.values() and not results[job["tempind"]]:
+                os.rename(job["vcdfile"], vcdfile)
+            else:
+                os.remove(job["vcdfile"])
+
+    retstatus = len(results) == len(checks) and False not in results.values()
+    print("%s Status: %s" % (timestamp(), "PASSED" if retstatus else "FAILED (!)"))
+    sys.exit(0 if retstatus else 1)
+
+
+if portfolio_solvers is not None or parallel_induction:
+    run_portfolio()
+
+
 smt = smtio(opts=so)
 
 print("%s Solver: %s" % (smt.timestamp(), so.solver))
@@ -98,14 +199,19 @@ smt.setup("QF_AUFBV")
 debug_nets = set()
 debug_nets_re = re.compile(r"^; yosys-smt2-(input|output|register|wire) (\S+) (\d+)")
 
+# the model is sent to the solver in one block instead of line by line,
+# flushing the solver pipe for each line dominates for large files
 with open(args[0], "r") as f:
+    smt2_lines = []
     for line in f:
         match = debug_nets_re.match(line)
         if match:
             debug_nets.add(match.group(2))
         if line.startswith("; yosys-smt2-module") and topmod is None:
             topmod = line.split()[2]
-        smt.write(line)
+        smt2_lines.append(line)
+    smt.write("".join(smt2_lines))
+    del smt2_lines
 
 assert topmod is not None
 
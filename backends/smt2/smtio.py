@@ -269,7 +269,7 @@ class smtopts:
         elif o == "-v":
             self.debug_print = True
         elif o == "-p":
-            self.timeinfo = True
+            self.timeinfo = False
         elif o == "-d":
             self.debug_file = open(a, "w")
         else:
@@ -33,13 +33,16 @@ struct SmvWorker
 	SigMap sigmap;
 	RTLIL::Module *module;
 	std::ostream &f;
-	bool verbose;
+	bool verbose, cone;
 
 	int idcounter;
 	dict<IdString, shared_str> idcache;
 	pool<shared_str> used_names;
 	vector<shared_str> strbuf;
 
+	pool<Wire*> cone_wires;
+	pool<Cell*> cone_cells;
+
 	pool<Wire*> partial_assignment_wires;
 	dict<SigBit, std::pair<const char*, int>> partial_assignment_bits;
 	vector<string> assignments, invarspecs;
@@ -87,8 +90,8 @@ struct SmvWorker
 		return idcache.at(id).c_str();
 	}
 
-	SmvWorker(RTLIL::Module *module, bool verbose, std::ostream &f) :
-			ct(module->design), sigmap(module), module(module), f(f), verbose(verbose), idcounter(0)
+	SmvWorker(RTLIL::Module *module, bool verbose, bool cone, std::ostream &f) :
+			ct(module->design), sigmap(module), module(module), f(f), verbose(verbose), cone(cone), idcounter(0)
 	{
 		for (auto mod : module->design->modules())
 			cid(mod->name, true);
@@ -207,13 +210,74 @@ struct SmvWorker
 		return temp_id;
 	}
 
+	// Find the cells and wires in the sequential cone of influence of the
+	// selected $assert cells. A wire is exported when one of its bits is in
+	// the cone, and then all its bits are added to the cone, so that the
+	// assignments of the exported wires only refer to exported wires.
+	void find_cone()
+	{
+		dict<SigBit, Cell*> drivers;
+		dict<SigBit, vector<Wire*>> bit_wires;
+		vector<SigBit> queue;
+		pool<SigBit> queued;
+
+		for (auto cell : module->cells())
+			for (auto &conn : cell->connections())
+				if (ct.cell_output(cell->type, conn.first))
+					for (auto bit : sigmap(conn.second))
+						drivers[bit] = cell;
+
+		for (auto wire : module->wires())
+			for (auto bit : sigmap(wire))
+				if (bit.wire != nullptr)
+					bit_wires[bit].push_back(wire);
+
+		auto add_sig = [&](const SigSpec &sig) {
+			for (auto bit : sigmap(sig))
+				if (bit.wire != nullptr && queued.insert(bit).second)
+					queue.push_back(bit);
+		};
+
+		auto add_cell = [&](Cell *cell) {
+			if (cone_cells.insert(cell).second)
+				for (auto &conn : cell->connections())
+					add_sig(conn.second);
+		};
+
+		for (auto cell : module->selected_cells())
+			if (cell->type == "$assert")
+				add_cell(cell);
+
+		while (!queue.empty())
+		{
+			SigBit bit = queue.back();
+			queue.pop_back();
+
+			for (auto wire : bit_wires.at(bit, vector<Wire*>()))
+				if (cone_wires.insert(wire).second)
+					add_sig(wire);
+
+			if (drivers.count(bit))
+				add_cell(drivers.at(bit));
+		}
+
+		log("Exporting %d of %d cells and %d of %d wires in the cone of influence of the selected $assert cells.\n",
+				GetSize(cone_cells), GetSize(module->cells_), GetSize(cone_wires), GetSize(module->wires_));
+	}
+
 	void run()
 	{
+		if (cone)
+			find_cone();
+
 		f << stringf("MODULE %s\n", cid(module->name));
 		f << stringf("  VAR\n");
 
 		for (auto wire : module->wires())
 		{
+			if (cone && !cone_wires.count(wire))
+				continue;
+
 			if (SigSpec(wire) != sigmap(wire))
 				partial_assignment_wires.insert(wire);
 
@@ -225,6 +289,9 @@ struct SmvWorker
 
 		for (auto cell : module->cells())
 		{
+			if (cone && !cone_cells.count(cell))
+				continue;
+
 			// FIXME: $slice, $concat, $mem
 
 			if (cell->type.in("$assert"))
@@ -686,13 +753,17 @@ struct SmvBackend : public Backend {
 		log("        use the given template file. the line containing only the token '%%%%'\n");
 		log("        is replaced with the regular output of this command.\n");
 		log("\n");
+		log("    -cone\n");
+		log("        only export the cells and wires in the sequential cone of influence of\n");
+		log("        the selected $assert cells.\n");
+		log("\n");
 		log("THIS COMMAND IS UNDER CONSTRUCTION\n");
 		log("\n");
 	}
 	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
 		std::ifstream template_f;
-		bool verbose = false;
+		bool verbose = false, cone = false;
 
 		log_header("Executing SMV backend.\n");
 
@@ -709,6 +780,10 @@ struct SmvBackend : public Backend {
 				verbose = true;
 				continue;
 			}
+			if (args[argidx] == "-cone") {
+				cone = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
@@ -746,7 +821,7 @@ struct SmvBackend : public Backend {
 						*f << stringf("-- SMV description generated by %s\n", yosys_version_str);
 
 						log("Creating SMV representation of module %s.\n", log_id(module));
-						SmvWorker worker(module, verbose, *f);
+						SmvWorker worker(module, verbose, cone, *f);
 						worker.run();
 
 						*f << stringf("-- end of yosys output\n");
@@ -766,7 +841,7 @@ struct SmvBackend : public Backend {
 
 			for (auto module : modules) {
 				log("Creating SMV representation of module %s.\n", log_id(module));
-				SmvWorker worker(module, verbose, *f);
+				SmvWorker worker(module, verbose, cone, *f);
 				worker.run();
 			}
 
@@ -22,12 +22,15 @@
 #include "kernel/sigtools.h"
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
+#include "kernel/utils.h"
 #include <string>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-static string spice_id2str(IdString id)
+static IdStringNames spice_names;
+
+static string spice_id2str_uncached(IdString id)
 {
 	static const char *escape_chars = "$\\[]()<>";
 	string s = RTLIL::unescape_id(id);
@@ -38,6 +41,11 @@ static string spice_id2str(IdString id)
 	return s;
 }
 
+static const string &spice_id2str(IdString id)
+{
+	return spice_names.get(id, spice_id2str_uncached);
+}
+
 static string spice_id2str(IdString id, bool use_inames, idict<IdString, 1> &inums)
 {
 	if (!use_inames && *id.c_str() == '$')
@@ -169,6 +177,7 @@ struct SpiceBackend : public Backend {
 		std::string neg = "Vss", pos = "Vdd", ncpf = "_NC";
 
 		log_header("Executing SPICE backend.\n");
+		spice_names.clear();
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -260,6 +269,8 @@ struct SpiceBackend : public Backend {
 		*f << stringf("* end of SPICE netlist *\n");
 		*f << stringf("************************\n");
 		*f << stringf("\n");
+
+		spice_names.clear();
 	}
 } SpiceBackend;
 
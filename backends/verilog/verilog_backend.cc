@@ -25,6 +25,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
 #include "kernel/sigtools.h"
+#include "kernel/utils.h"
 #include <string>
 #include <sstream>
 #include <set>
@@ -36,6 +37,7 @@ PRIVATE_NAMESPACE_BEGIN
 bool norename, noattr, attr2comment, noexpr;
 int auto_name_counter, auto_name_offset, auto_name_digits;
 std::map<RTLIL::IdString, int> auto_name_map;
+IdStringNames id_cache[2];
 std::set<RTLIL::IdString> reg_wires, reg_ct;
 
 RTLIL::Module *active_module;
@@ -65,6 +67,8 @@ void reset_auto_counter_id(RTLIL::IdString id, bool may_rename)
 void reset_auto_counter(RTLIL::Module *module)
 {
 	auto_name_map.clear();
+	id_cache[0].clear();
+	id_cache[1].clear();
 	auto_name_counter = 0;
 	auto_name_offset = 0;
 
@@ -94,7 +98,7 @@ std::string next_auto_id()
 	return stringf("_%0*d_", auto_name_digits, auto_name_offset + auto_name_counter++);
 }
 
-std::string id(RTLIL::IdString internal_id, bool may_rename = true)
+std::string id_uncached(RTLIL::IdString internal_id, bool may_rename)
 {
 	const char *str = internal_id.c_str();
 	bool do_escape = false;
@@ -127,6 +131,13 @@ std::string id(RTLIL::IdString internal_id, bool may_rename = true)
 	return std::string(str);
 }
 
+// the same wire names are printed over and over in large netlists, so the
+// escaped (or renamed) form is only computed once per module
+const std::string &id(RTLIL::IdString internal_id, bool may_rename = true)
+{
+	return id_cache[may_rename].get(internal_id, [&](RTLIL::IdString id) { return id_uncached(id, may_rename); });
+}
+
 bool is_reg_wire(RTLIL::SigSpec sig, std::string &reg_name)
 {
 	if (!sig.is_chunk() || sig.as_chunk().wire == NULL)
@@ -169,41 +180,43 @@ void dump_const(std::ostream &f, const RTLIL::Const &data, int width = -1, int o
 				f << stringf("32'%sd %u", set_signed ? "s" : "", val);
 		} else {
 	dump_bits:
-			f << stringf("%d'%sb", width, set_signed ? "s" : "");
+			std::string str = stringf("%d'%sb", width, set_signed ? "s" : "");
+			str.reserve(str.size() + std::max(width, 1));
 			if (width == 0)
-				f << stringf("0");
+				str += '0';
 			for (int i = offset+width-1; i >= offset; i--) {
 				log_assert(i < (int)data.bits.size());
 				switch (data.bits[i]) {
-				case RTLIL::S0: f << stringf("0"); break;
-				case RTLIL::S1: f << stringf("1"); break;
-				case RTLIL::Sx: f << stringf("x"); break;
-				case RTLIL::Sz: f << stringf("z"); break;
-				case RTLIL::Sa: f << stringf("z"); break;
+				case RTLIL::S0: str += '0'; break;
+				case RTLIL::S1: str += '1'; break;
+				case RTLIL::Sx: str += 'x'; break;
+				case RTLIL::Sz: str += 'z'; break;
+				case RTLIL::Sa: str += 'z'; break;
 				case RTLIL::Sm: log_error("Found marker state in final netlist.");
 				}
 			}
+			f << str;
 		}
 	} else {
-		f << stringf("\"");
+		f << "\"";
 		std::string str = data.decode_string();
 		for (size_t i = 0; i < str.size(); i++) {
 			if (str[i] == '\n')
-				f << stringf("\\n");
+				f << "\\n";
 			else if (str[i] == '\t')
-				f << stringf("\\t");
+				f << "\\t";
 			else if (str[i] < 32)
 				f << stringf("\\%03o", str[i]);
 			else if (str[i] == '"')
-				f << stringf("\\\"");
+				f << "\\\"";
 			else if (str[i] == '\\')
-				f << stringf("\\\\");
+				f << "\\\\";
 			else if (str[i] == '/' && escape_comment && i > 0 && str[i-1] == '*')
-				f << stringf("\\/");
+				f << "\\/";
 			else
 				f << str[i];
 		}
-		f << stringf("\"");
+		f << "\"";
 	}
 }
 
@@ -212,23 +225,30 @@ void dump_sigchunk(std::ostream &f, const RTLIL::SigChunk &chunk, bool no_decima
 	if (chunk.wire == NULL) {
 		dump_const(f, chunk.data, chunk.width, chunk.offset, no_decimal);
 	} else {
+		std::string str = id(chunk.wire->name);
 		if (chunk.width == chunk.wire->width && chunk.offset == 0) {
-			f << stringf("%s", id(chunk.wire->name).c_str());
+			/* whole wire */
 		} else if (chunk.width == 1) {
+			str += '[';
 			if (chunk.wire->upto)
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), (chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+				str += std::to_string((chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
 			else
-				f << stringf("%s[%d]", id(chunk.wire->name).c_str(), chunk.offset + chunk.wire->start_offset);
+				str += std::to_string(chunk.offset + chunk.wire->start_offset);
+			str += ']';
 		} else {
-			if (chunk.wire->upto)
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset,
-						(chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
-			else
-				f << stringf("%s[%d:%d]", id(chunk.wire->name).c_str(),
-						(chunk.offset + chunk.width - 1) + chunk.wire->start_offset,
-						chunk.offset + chunk.wire->start_offset);
+			str += '[';
+			if (chunk.wire->upto) {
+				str += std::to_string((chunk.wire->width - (chunk.offset + chunk.width - 1) - 1) + chunk.wire->start_offset);
+				str += ':';
+				str += std::to_string((chunk.wire->width - chunk.offset - 1) + chunk.wire->start_offset);
+			} else {
+				str += std::to_string((chunk.offset + chunk.width - 1) + chunk.wire->start_offset);
+				str += ':';
+				str += std::to_string(chunk.offset + chunk.wire->start_offset);
+			}
+			str += ']';
 		}
+		f << str;
 	}
 }
 
@@ -237,13 +257,13 @@ void dump_sigspec(std::ostream &f, const RTLIL::SigSpec &sig)
 	if (sig.is_chunk()) {
 		dump_sigchunk(f, sig.as_chunk());
 	} else {
-		f << stringf("{ ");
+		f << "{ ";
 		for (auto it = sig.chunks().rbegin(); it != sig.chunks().rend(); ++it) {
 			if (it != sig.chunks().rbegin())
-				f << stringf(", ");
+				f << ", ";
 			dump_sigchunk(f, *it, true);
 		}
-		f << stringf(" }");
+		f << " }";
 	}
 }
 
@@ -253,11 +273,11 @@ void dump_attributes(std::ostream &f, std::string indent, dict<RTLIL::IdString,
 		return;
 	for (auto it = attributes.begin(); it != attributes.end(); ++it) {
 		f << stringf("%s" "%s %s", indent.c_str(), attr2comment ? "/*" : "(*", id(it->first).c_str());
-		f << stringf(" = ");
+		f << " = ";
 		if (modattr && (it->second == Const(0, 1) || it->second == Const(0)))
-			f << stringf(" 0 ");
+			f << " 0 ";
 		else if (modattr && (it->second == Const(1, 1) || it->second == Const(1)))
-			f << stringf(" 1 ");
+			f << " 1 ";
 		else
 			dump_const(f, it->second, -1, 0, false, false, attr2comment);
 		f << stringf(" %s%c", attr2comment ? "*/" : "*)", term);
@@ -289,20 +309,20 @@ void dump_wire(std::ostream &f, std::string indent, RTLIL::Wire *wire)
 			range = stringf(" [%d:%d]", wire->width - 1 + wire->start_offset, wire->start_offset);
 	}
 	if (wire->port_input && !wire->port_output)
-		f << stringf("%s" "input%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "input" << range << " " << id(wire->name) << ";\n";
 	if (!wire->port_input && wire->port_output)
-		f << stringf("%s" "output%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "output" << range << " " << id(wire->name) << ";\n";
 	if (wire->port_input && wire->port_output)
-		f << stringf("%s" "inout%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "inout" << range << " " << id(wire->name) << ";\n";
 	if (reg_wires.count(wire->name)) {
-		f << stringf("%s" "reg%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "reg" << range << " " << id(wire->name) << ";\n";
 		if (wire->attributes.count("\\init")) {
 			f << stringf("%s" "initial %s = ", indent.c_str(), id(wire->name).c_str());
 			dump_const(f, wire->attributes.at("\\init"));
-			f << stringf(";\n");
+			f << ";\n";
 		}
 	} else if (!wire->port_input && !wire->port_output)
-		f << stringf("%s" "wire%s %s;\n", indent.c_str(), range.c_str(), id(wire->name).c_str());
+		f << indent << "wire" << range << " " << id(wire->name) << ";\n";
 #endif
 }
 
@@ -315,9 +335,9 @@ void dump_memory(std::ostream &f, std::string indent, RTLIL::Memory *memory)
 void dump_cell_expr_port(std::ostream &f, RTLIL::Cell *cell, std::string port, bool gen_signed = true)
 {
 	if (gen_signed && cell->parameters.count("\\" + port + "_SIGNED") > 0 && cell->parameters["\\" + port + "_SIGNED"].as_bool()) {
-		f << stringf("$signed(");
+		f << "$signed(";
 		dump_sigspec(f, cell->getPort("\\" + port));
-		f << stringf(")");
+		f << ")";
 	} else
 		dump_sigspec(f, cell->getPort("\\" + port));
 }
@@ -360,105 +380,105 @@ no_special_reg_name:
 
 void dump_cell_expr_uniop(std::ostream &f, std::string indent, RTLIL::Cell *cell, std::string op)
 {
-	f << stringf("%s" "assign ", indent.c_str());
+	f << indent << "assign ";
 	dump_sigspec(f, cell->getPort("\\Y"));
 	f << stringf(" = %s ", op.c_str());
 	dump_attributes(f, "", cell->attributes, ' ');
 	dump_cell_expr_port(f, cell, "A", true);
-	f << stringf(";\n");
+	f << ";\n";
 }
 
 void dump_cell_expr_binop(std::ostream &f, std::string indent, RTLIL::Cell *cell, std::string op)
 {
-	f << stringf("%s" "assign ", indent.c_str());
+	f << indent << "assign ";
 	dump_sigspec(f, cell->getPort("\\Y"));
-	f << stringf(" = ");
+	f << " = ";
 	dump_cell_expr_port(f, cell, "A", true);
 	f << stringf(" %s ", op.c_str());
 	dump_attributes(f, "", cell->attributes, ' ');
 	dump_cell_expr_port(f, cell, "B", true);
-	f << stringf(";\n");
+	f << ";\n";
 }
 
 bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 {
 	if (cell->type == "$_NOT_") {
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ");
-		f << stringf("~");
+		f << " = ";
+		f << "~";
 		dump_attributes(f, "", cell->attributes, ' ');
 		dump_cell_expr_port(f, cell, "A", false);
-		f << stringf(";\n");
+		f << ";\n";
 		return true;
 	}
 
 	if (cell->type.in("$_AND_", "$_NAND_", "$_OR_", "$_NOR_", "$_XOR_", "$_XNOR_")) {
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ");
+		f << " = ";
 		if (cell->type.in("$_NAND_", "$_NOR_", "$_XNOR_"))
-			f << stringf("~(");
+			f << "~(";
 		dump_cell_expr_port(f, cell, "A", false);
-		f << stringf(" ");
+		f << " ";
 		if (cell->type.in("$_AND_", "$_NAND_"))
-			f << stringf("&");
+			f << "&";
 		if (cell->type.in("$_OR_", "$_NOR_"))
-			f << stringf("|");
+			f << "|";
 		if (cell->type.in("$_XOR_", "$_XNOR_"))
-			f << stringf("^");
+			f << "^";
 		dump_attributes(f, "", cell->attributes, ' ');
-		f << stringf(" ");
+		f << " ";
 		dump_cell_expr_port(f, cell, "B", false);
 		if (cell->type.in("$_NAND_", "$_NOR_", "$_XNOR_"))
-			f << stringf(")");
-		f << stringf(";\n");
+			f << ")";
+		f << ";\n";
 		return true;
 	}
 
 	if (cell->type == "$_MUX_") {
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ");
+		f << " = ";
 		dump_cell_expr_port(f, cell, "S", false);
-		f << stringf(" ? ");
+		f << " ? ";
 		dump_attributes(f, "", cell->attributes, ' ');
 		dump_cell_expr_port(f, cell, "B", false);
-		f << stringf(" : ");
+		f << " : ";
 		dump_cell_expr_port(f, cell, "A", false);
-		f << stringf(";\n");
+		f << ";\n";
 		return true;
 	}
 
 	if (cell->type.in("$_AOI3_", "$_OAI3_")) {
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ~((");
+		f << " = ~((";
 		dump_cell_expr_port(f, cell, "A", false);
 		f << stringf(cell->type == "$_AOI3_" ? " & " : " | ");
 		dump_cell_expr_port(f, cell, "B", false);
 		f << stringf(cell->type == "$_AOI3_" ? ") |" : ") &");
 		dump_attributes(f, "", cell->attributes, ' ');
-		f << stringf(" ");
+		f << " ";
 		dump_cell_expr_port(f, cell, "C", false);
-		f << stringf(");\n");
+		f << ");\n";
 		return true;
 	}
 
 	if (cell->type.in("$_AOI4_", "$_OAI4_")) {
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ~((");
+		f << " = ~((";
 		dump_cell_expr_port(f, cell, "A", false);
 		f << stringf(cell->type == "$_AOI4_" ? " & " : " | ");
 		dump_cell_expr_port(f, cell, "B", false);
 		f << stringf(cell->type == "$_AOI4_" ? ") |" : ") &");
 		dump_attributes(f, "", cell->attributes, ' ');
-		f << stringf(" (");
+		f << " (";
 		dump_cell_expr_port(f, cell, "C", false);
 		f << stringf(cell->type == "$_AOI4_" ? " & " : " | ");
 		dump_cell_expr_port(f, cell, "D", false);
-		f << stringf("));\n");
+		f << "));\n";
 		return true;
 	}
 
@@ -477,22 +497,22 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			f << stringf(" or %sedge ", cell->type[7] == 'P' ? "pos" : "neg");
 			dump_sigspec(f, cell->getPort("\\R"));
 		}
-		f << stringf(")\n");
+		f << ")\n";
 
 		if (cell->type[7] != '_') {
 			f << stringf("%s" "  if (%s", indent.c_str(), cell->type[7] == 'P' ? "" : "!");
 			dump_sigspec(f, cell->getPort("\\R"));
-			f << stringf(")\n");
+			f << ")\n";
 			f << stringf("%s" "    %s <= %c;\n", indent.c_str(), reg_name.c_str(), cell->type[8]);
-			f << stringf("%s" "  else\n", indent.c_str());
+			f << indent << "  else\n";
 		}
 
 		f << stringf("%s" "    %s <= ", indent.c_str(), reg_name.c_str());
 		dump_cell_expr_port(f, cell, "D", false);
-		f << stringf(";\n");
+		f << ";\n";
 
 		if (!out_is_reg_wire) {
-			f << stringf("%s" "assign ", indent.c_str());
+			f << indent << "assign ";
 			dump_sigspec(f, cell->getPort("\\Q"));
 			f << stringf(" = %s;\n", reg_name.c_str());
 		}
@@ -517,25 +537,25 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 		dump_sigspec(f, cell->getPort("\\S"));
 		f << stringf(" or %sedge ", pol_r == 'P' ? "pos" : "neg");
 		dump_sigspec(f, cell->getPort("\\R"));
-		f << stringf(")\n");
+		f << ")\n";
 
 		f << stringf("%s" "  if (%s", indent.c_str(), pol_r == 'P' ? "" : "!");
 		dump_sigspec(f, cell->getPort("\\R"));
-		f << stringf(")\n");
+		f << ")\n";
 		f << stringf("%s" "    %s <= 0;\n", indent.c_str(), reg_name.c_str());
 
 		f << stringf("%s" "  else if (%s", indent.c_str(), pol_s == 'P' ? "" : "!");
 		dump_sigspec(f, cell->getPort("\\S"));
-		f << stringf(")\n");
+		f << ")\n";
 		f << stringf("%s" "    %s <= 1;\n", indent.c_str(), reg_name.c_str());
 
-		f << stringf("%s" "  else\n", indent.c_str());
+		f << indent << "  else\n";
 		f << stringf("%s" "    %s <= ", indent.c_str(), reg_name.c_str());
 		dump_cell_expr_port(f, cell, "D", false);
-		f << stringf(";\n");
+		f << ";\n";
 
 		if (!out_is_reg_wire) {
-			f << stringf("%s" "assign ", indent.c_str());
+			f << indent << "assign ";
 			dump_sigspec(f, cell->getPort("\\Q"));
 			f << stringf(" = %s;\n", reg_name.c_str());
 		}
@@ -593,16 +613,16 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 
 	if (cell->type == "$mux")
 	{
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ");
+		f << " = ";
 		dump_sigspec(f, cell->getPort("\\S"));
-		f << stringf(" ? ");
+		f << " ? ";
 		dump_attributes(f, "", cell->attributes, ' ');
 		dump_sigspec(f, cell->getPort("\\B"));
-		f << stringf(" : ");
+		f << " : ";
 		dump_sigspec(f, cell->getPort("\\A"));
-		f << stringf(";\n");
+		f << ";\n";
 		return true;
 	}
 
@@ -619,8 +639,8 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 
 		dump_attributes(f, indent + "  ", cell->attributes);
 		if (cell->type != "$pmux_safe" && !noattr)
-			f << stringf("%s" "  (* parallel_case *)\n", indent.c_str());
-		f << stringf("%s" "  casez (s)", indent.c_str());
+			f << indent << "  (* parallel_case *)\n";
+		f << indent << "  casez (s)";
 		if (cell->type != "$pmux_safe")
 			f << stringf(noattr ? " // synopsys parallel_case\n" : "\n");
 
@@ -631,33 +651,33 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			for (int j = s_width-1; j >= 0; j--)
 				f << stringf("%c", j == i ? '1' : cell->type == "$pmux_safe" ? '0' : '?');
 
-			f << stringf(":\n");
+			f << ":\n";
 			f << stringf("%s" "      %s = b[%d:%d];\n", indent.c_str(), func_name.c_str(), (i+1)*width-1, i*width);
 		}
 
-		f << stringf("%s" "    default:\n", indent.c_str());
+		f << indent << "    default:\n";
 		f << stringf("%s" "      %s = a;\n", indent.c_str(), func_name.c_str());
 
-		f << stringf("%s" "  endcase\n", indent.c_str());
-		f << stringf("%s" "endfunction\n", indent.c_str());
+		f << indent << "  endcase\n";
+		f << indent << "endfunction\n";
 
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
 		f << stringf(" = %s(", func_name.c_str());
 		dump_sigspec(f, cell->getPort("\\A"));
-		f << stringf(", ");
+		f << ", ";
 		dump_sigspec(f, cell->getPort("\\B"));
-		f << stringf(", ");
+		f << ", ";
 		dump_sigspec(f, cell->getPort("\\S"));
-		f << stringf(");\n");
+		f << ");\n";
 		return true;
 	}
 
 	if (cell->type == "$slice")
 	{
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = ");
+		f << " = ";
 		dump_sigspec(f, cell->getPort("\\A"));
 		f << stringf(" >> %d;\n", cell->parameters.at("\\OFFSET").as_int());
 		return true;
@@ -665,13 +685,13 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 
 	if (cell->type == "$concat")
 	{
-		f << stringf("%s" "assign ", indent.c_str());
+		f << indent << "assign ";
 		dump_sigspec(f, cell->getPort("\\Y"));
-		f << stringf(" = { ");
+		f << " = { ";
 		dump_sigspec(f, cell->getPort("\\B"));
-		f << stringf(" , ");
+		f << " , ";
 		dump_sigspec(f, cell->getPort("\\A"));
-		f << stringf(" };\n");
+		f << " };\n";
 		return true;
 	}
 
@@ -701,7 +721,7 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			dump_sigspec(f, sig_set);
 			f << stringf(", %sedge ", pol_clr ? "pos" : "neg");
 			dump_sigspec(f, sig_clr);
-			f << stringf(")\n");
+			f << ")\n";
 
 			f << stringf("%s" "  if (%s", indent.c_str(), pol_clr ? "" : "!");
 			dump_sigspec(f, sig_clr);
@@ -713,11 +733,11 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 
 			f << stringf("%s" "  else  %s[%d] <= ", indent.c_str(), reg_name.c_str(), i);
 			dump_sigspec(f, sig_d[i]);
-			f << stringf(";\n");
+			f << ";\n";
 		}
 
 		if (!out_is_reg_wire) {
-			f << stringf("%s" "assign ", indent.c_str());
+			f << indent << "assign ";
 			dump_sigspec(f, sig_q);
 			f << stringf(" = %s;\n", reg_name.c_str());
 		}
@@ -756,30 +776,30 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			f << stringf(" or %sedge ", pol_arst ? "pos" : "neg");
 			dump_sigspec(f, sig_arst);
 		}
-		f << stringf(")\n");
+		f << ")\n";
 
 		if (cell->type == "$adff") {
 			f << stringf("%s" "  if (%s", indent.c_str(), pol_arst ? "" : "!");
 			dump_sigspec(f, sig_arst);
-			f << stringf(")\n");
+			f << ")\n";
 			f << stringf("%s" "    %s <= ", indent.c_str(), reg_name.c_str());
 			dump_sigspec(f, val_arst);
-			f << stringf(";\n");
-			f << stringf("%s" "  else\n", indent.c_str());
+			f << ";\n";
+			f << indent << "  else\n";
 		}
 
 		if (cell->type == "$dffe") {
 			f << stringf("%s" "  if (%s", indent.c_str(), pol_en ? "" : "!");
 			dump_sigspec(f, sig_en);
-			f << stringf(")\n");
+			f << ")\n";
 		}
 
 		f << stringf("%s" "    %s <= ", indent.c_str(), reg_name.c_str());
 		dump_cell_expr_port(f, cell, "D", false);
-		f << stringf(";\n");
+		f << ";\n";
 
 		if (!out_is_reg_wire) {
-			f << stringf("%s" "assign ", indent.c_str());
+			f << indent << "assign ";
 			dump_sigspec(f, cell->getPort("\\Q"));
 			f << stringf(" = %s;\n", reg_name.c_str());
 		}
@@ -804,14 +824,14 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 		f << stringf("%s" "reg [%d:%d] %s [%d:%d];\n", indent.c_str(), width-1, 0, mem_id.c_str(), size-1, 0);
 		if (use_init)
 		{
-			f << stringf("%s" "initial begin\n", indent.c_str());
+			f << indent << "initial begin\n";
 			for (int i=0; i<size; i++)
 			{
 				f << stringf("%s" "  %s[%d] <= ", indent.c_str(), mem_id.c_str(), i);
 				dump_const(f, cell->parameters["\\INIT"].extract(i*width, width));
-				f << stringf(";\n");
+				f << ";\n";
 			}
-			f << stringf("%s" "end\n", indent.c_str());
+			f << indent << "end\n";
 		}
 
 		// create a map : "edge clk" -> expressions within that clock domain
@@ -995,7 +1015,7 @@ bool dump_cell_expr(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 				f << stringf("%s" "always @(%s) begin\n", indent.c_str(), clk_domain.c_str());
 				for(auto &line : lof_lines)
 					f << stringf("%s%s" "%s", indent.c_str(), indent.c_str(), line.c_str());
-				f << stringf("%s" "end\n", indent.c_str());
+				f << indent << "end\n";
 			}
 			else
 			{
@@ -1022,26 +1042,26 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 	}
 
 	dump_attributes(f, indent, cell->attributes);
-	f << stringf("%s" "%s", indent.c_str(), id(cell->type, false).c_str());
+	f << indent << id(cell->type, false);
 
 	if (cell->parameters.size() > 0) {
-		f << stringf(" #(");
+		f << " #(";
 		for (auto it = cell->parameters.begin(); it != cell->parameters.end(); ++it) {
 			if (it != cell->parameters.begin())
-				f << stringf(",");
+				f << ",";
 			f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
 			bool is_signed = (it->second.flags & RTLIL::CONST_FLAG_SIGNED) != 0;
 			dump_const(f, it->second, -1, 0, false, is_signed);
-			f << stringf(")");
+			f << ")";
 		}
 		f << stringf("\n%s" ")", indent.c_str());
 	}
 
 	std::string cell_name = cellname(cell);
 	if (cell_name != id(cell->name))
-		f << stringf(" %s /* %s */ (", cell_name.c_str(), id(cell->name).c_str());
+		f << " " << cell_name << " /* " << id(cell->name) << " */ (";
 	else
-		f << stringf(" %s (", cell_name.c_str());
+		f << " " << cell_name << " (";
 
 	bool first_arg = true;
 	std::set<RTLIL::IdString> numbered_ports;
@@ -1052,9 +1072,9 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 			if (it->first != str)
 				continue;
 			if (!first_arg)
-				f << stringf(",");
+				f << ",";
 			first_arg = false;
-			f << stringf("\n%s  ", indent.c_str());
+			f << "\n" << indent << "  ";
 			dump_sigspec(f, it->second);
 			numbered_ports.insert(it->first);
 			goto found_numbered_port;
@@ -1066,23 +1086,23 @@ void dump_cell(std::ostream &f, std::string indent, RTLIL::Cell *cell)
 		if (numbered_ports.count(it->first))
 			continue;
 		if (!first_arg)
-			f << stringf(",");
+			f << ",";
 		first_arg = false;
-		f << stringf("\n%s  .%s(", indent.c_str(), id(it->first).c_str());
+		f << "\n" << indent << "  ." << id(it->first) << "(";
 		if (it->second.size() > 0)
 			dump_sigspec(f, it->second);
-		f << stringf(")");
+		f << ")";
 	}
-	f << stringf("\n%s" ");\n", indent.c_str());
+	f << "\n" << indent << ");\n";
 }
 
 void dump_conn(std::ostream &f, std::string indent, const RTLIL::SigSpec &left, const RTLIL::SigSpec &right)
 {
-	f << stringf("%s" "assign ", indent.c_str());
+	f << indent << "assign ";
 	dump_sigspec(f, left);
-	f << stringf(" = ");
+	f << " = ";
 	dump_sigspec(f, right);
-	f << stringf(";\n");
+	f << ";\n";
 }
 
 void dump_proc_switch(std::ostream &f, std::string indent, RTLIL::SwitchRule *sw);
@@ -1092,16 +1112,16 @@ void dump_case_body(std::ostream &f, std::string indent, RTLIL::CaseRule *cs, bo
 	int number_of_stmts = cs->switches.size() + cs->actions.size();
 
 	if (!omit_trailing_begin && number_of_stmts >= 2)
-		f << stringf("%s" "begin\n", indent.c_str());
+		f << indent << "begin\n";
 
 	for (auto it = cs->actions.begin(); it != cs->actions.end(); ++it) {
 		if (it->first.size() == 0)
 			continue;
 		f << stringf("%s  ", indent.c_str());
 		dump_sigspec(f, it->first);
-		f << stringf(" = ");
+		f << " = ";
 		dump_sigspec(f, it->second);
-		f << stringf(";\n");
+		f << ";\n";
 	}
 
 	for (auto it = cs->switches.begin(); it != cs->switches.end(); ++it)
@@ -1111,24 +1131,24 @@ void dump_case_body(std::ostream &f, std::string indent, RTLIL::CaseRule *cs, bo
 		f << stringf("%s  /* empty */;\n", indent.c_str());
 
 	if (omit_trailing_begin || number_of_stmts >= 2)
-		f << stringf("%s" "end\n", indent.c_str());
+		f << indent << "end\n";
 }
 
 void dump_proc_switch(std::ostream &f, std::string indent, RTLIL::SwitchRule *sw)
 {
 	if (sw->signal.size() == 0) {
-		f << stringf("%s" "begin\n", indent.c_str());
+		f << indent << "begin\n";
 		for (auto it = sw->cases.begin(); it != sw->cases.end(); ++it) {
 			if ((*it)->compare.size() == 0)
 				dump_case_body(f, indent + "  ", *it);
 		}
-		f << stringf("%s" "end\n", indent.c_str());
+		f << indent << "end\n";
 		return;
 	}
 
-	f << stringf("%s" "casez (", indent.c_str());
+	f << indent << "casez (";
 	dump_sigspec(f, sw->signal);
-	f << stringf(")\n");
+	f << ")\n";
 
 	bool got_default = false;
 	for (auto it = sw->cases.begin(); it != sw->cases.end(); ++it) {
@@ -1141,15 +1161,15 @@ void dump_proc_switch(std::ostream &f, std::string indent, RTLIL::SwitchRule *sw
 			f << stringf("%s  ", indent.c_str());
 			for (size_t i = 0; i < (*it)->compare.size(); i++) {
 				if (i > 0)
-					f << stringf(", ");
+					f << ", ";
 				dump_sigspec(f, (*it)->compare[i]);
 			}
 		}
-		f << stringf(":\n");
+		f << ":\n";
 		dump_case_body(f, indent + "    ", *it);
 	}
 
-	f << stringf("%s" "endcase\n", indent.c_str());
+	f << indent << "endcase\n";
 }
 
 void case_body_find_regs(RTLIL::CaseRule *cs)
@@ -1178,7 +1198,7 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 		return;
 	}
 
-	f << stringf("%s" "always @* begin\n", indent.c_str());
+	f << indent << "always @* begin\n";
 	dump_case_body(f, indent, &proc->root_case, true);
 
 	std::string backup_indent = indent;
@@ -1189,15 +1209,15 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 		indent = backup_indent;
 
 		if (sync->type == RTLIL::STa) {
-			f << stringf("%s" "always @* begin\n", indent.c_str());
+			f << indent << "always @* begin\n";
 		} else {
-			f << stringf("%s" "always @(", indent.c_str());
+			f << indent << "always @(";
 			if (sync->type == RTLIL::STp || sync->type == RTLIL::ST1)
-				f << stringf("posedge ");
+				f << "posedge ";
 			if (sync->type == RTLIL::STn || sync->type == RTLIL::ST0)
-				f << stringf("negedge ");
+				f << "negedge ";
 			dump_sigspec(f, sync->signal);
-			f << stringf(") begin\n");
+			f << ") begin\n";
 		}
 		std::string ends = indent + "end\n";
 		indent += "  ";
@@ -1205,7 +1225,7 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 		if (sync->type == RTLIL::ST0 || sync->type == RTLIL::ST1) {
 			f << stringf("%s" "if (%s", indent.c_str(), sync->type == RTLIL::ST0 ? "!" : "");
 			dump_sigspec(f, sync->signal);
-			f << stringf(") begin\n");
+			f << ") begin\n";
 			ends = indent + "end\n" + ends;
 			indent += "  ";
 		}
@@ -1216,7 +1236,7 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 				if (sync2->type == RTLIL::ST0 || sync2->type == RTLIL::ST1) {
 					f << stringf("%s" "if (%s", indent.c_str(), sync2->type == RTLIL::ST1 ? "!" : "");
 					dump_sigspec(f, sync2->signal);
-					f << stringf(") begin\n");
+					f << ") begin\n";
 					ends = indent + "end\n" + ends;
 					indent += "  ";
 				}
@@ -1228,9 +1248,9 @@ void dump_process(std::ostream &f, std::string indent, RTLIL::Process *proc, boo
 				continue;
 			f << stringf("%s  ", indent.c_str());
 			dump_sigspec(f, it->first);
-			f << stringf(" <= ");
+			f << " <= ";
 			dump_sigspec(f, it->second);
-			f << stringf(";\n");
+			f << ";\n";
 		}
 
 		f << stringf("%s", ends.c_str());
@@ -1249,7 +1269,7 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 				"changes in simulation behavior are possible! Use \"proc\" to convert\n"
 				"processes to logic networks and registers.", log_id(module));
 
-	f << stringf("\n");
+	f << "\n";
 	for (auto it = module->processes.begin(); it != module->processes.end(); ++it)
 		dump_process(f, indent + "  ", it->second, true);
 
@@ -1292,14 +1312,14 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 			RTLIL::Wire *wire = it->second;
 			if (wire->port_id == port_id) {
 				if (port_id != 1)
-					f << stringf(", ");
+					f << ", ";
 				f << stringf("%s", id(wire->name).c_str());
 				keep_running = true;
 				continue;
 			}
 		}
 	}
-	f << stringf(");\n");
+	f << ");\n";
 
 	for (auto it = module->wires_.begin(); it != module->wires_.end(); ++it)
 		dump_wire(f, indent + "  ", it->second);
@@ -1316,7 +1336,7 @@ void dump_module(std::ostream &f, std::string indent, RTLIL::Module *module)
 	for (auto it = module->connections().begin(); it != module->connections().end(); ++it)
 		dump_conn(f, indent + "  ", it->first, it->second);
 
-	f << stringf("%s" "endmodule\n", indent.c_str());
+	f << indent << "endmodule\n";
 	active_module = NULL;
 }
 
@@ -1360,6 +1380,10 @@ struct VerilogBackend : public Backend {
 		log("processes to logic networks and registers. A warning is generated when\n");
 		log("this command is called on a design with RTLIL processes.\n");
 		log("\n");
+		log("When yosys is started with -j <N>, the modules are converted to Verilog in\n");
+		log("parallel by up to N worker processes and written to the output file in the\n");
+		log("usual order.\n");
+		log("\n");
 	}
 	virtual void execute(std::ostream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
@@ -1432,7 +1456,7 @@ struct VerilogBackend : public Backend {
 
 		design->sort();
 
-		*f << stringf("/* Generated by %s */\n", yosys_version_str);
+		std::vector<RTLIL::Module*> modules;
 		for (auto it = design->modules_.begin(); it != design->modules_.end(); ++it) {
 			if (it->second->get_bool_attribute("\\blackbox") != blackboxes)
 				continue;
@@ -1441,10 +1465,15 @@ struct VerilogBackend : public Backend {
 					log_cmd_error("Can't handle partially selected module %s!\n", RTLIL::id2cstr(it->first));
 				continue;
 			}
-			log("Dumping module `%s'.\n", it->first.c_str());
-			dump_module(*f, "", it->second);
+			modules.push_back(it->second);
 		}
 
+		*f << stringf("/* Generated by %s */\n", yosys_version_str);
+		run_module_dump_jobs(modules, *f, [](std::ostream &mf, RTLIL::Module *module) {
+			log("Dumping module `%s'.\n", module->name.c_str());
+			dump_module(mf, "", module);
+		});
+
 		reg_ct.clear();
 	}
 } VerilogBackend;
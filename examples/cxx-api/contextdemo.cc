@@ -0,0 +1,36 @@
+// Note: Set ENABLE_LIBYOSYS=1 in Makefile or Makefile.conf to build libyosys.so
+// yosys-config --exec --cxx -o contextdemo --cxxflags --ldflags contextdemo.cc -lyosys -lstdc++ -pthread
+
+#include <kernel/yosys.h>
+#include <kernel/context.h>
+#include <fstream>
+#include <thread>
+
+void job(std::string name)
+{
+	std::ofstream log_file(name + ".log");
+
+	Yosys::Context ctx;
+	ctx.log_streams.push_back(&log_file);
+
+	try {
+		ctx.read_file("example.v");
+		ctx.run_pass({"synth", "-noabc"});
+		ctx.run_pass({"clean", "-purge"});
+		ctx.write_file(name + ".blif");
+	} catch (Yosys::Context::Error &e) {
+		std::cerr << name << " failed: " << e.what();
+	}
+}
+
+int main()
+{
+	Yosys::yosys_setup();
+
+	std::thread t1(job, "job1"), t2(job, "job2");
+	t1.join();
+	t2.join();
+
+	Yosys::yosys_shutdown();
+	return 0;
+}
@@ -0,0 +1,317 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+struct AigerReader
+{
+	const char *pos, *end;
+	std::string filename;
+
+	AigerReader(const char *data, size_t size, std::string filename) : pos(data), end(data + size), filename(filename)
+	{
+	}
+
+	void error(const char *what)
+	{
+		log_error("Syntax error in AIGER file %s: %s\n", filename.c_str(), what);
+	}
+
+	unsigned int parse_uint()
+	{
+		while (pos != end && (*pos == ' ' || *pos == '\t'))
+			pos++;
+		if (pos == end || *pos < '0' || *pos > '9')
+			error("expected number");
+		unsigned int value = 0;
+		while (pos != end && *pos >= '0' && *pos <= '9')
+			value = 10*value + (*pos++ - '0');
+		return value;
+	}
+
+	bool at_eol()
+	{
+		while (pos != end && (*pos == ' ' || *pos == '\t' || *pos == '\r'))
+			pos++;
+		return pos == end || *pos == '\n';
+	}
+
+	void parse_eol()
+	{
+		if (!at_eol())
+			error("expected end of line");
+		if (pos != end)
+			pos++;
+	}
+
+	unsigned int parse_varint()
+	{
+		unsigned int value = 0;
+		for (int shift = 0; ; shift += 7) {
+			if (pos == end)
+				error("unexpected end of file in binary AND section");
+			unsigned char ch = *pos++;
+			value |= (ch & 0x7f) << shift;
+			if ((ch & 0x80) == 0)
+				break;
+		}
+		return value;
+	}
+
+	std::string parse_line()
+	{
+		const char *begin = pos;
+		while (pos != end && *pos != '\n')
+			pos++;
+		std::string line(begin, pos);
+		if (pos != end)
+			pos++;
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		return line;
+	}
+
+	void parse(RTLIL::Design *design, RTLIL::IdString module_name, RTLIL::IdString clk_name)
+	{
+		if (end - pos < 3 || (strncmp(pos, "aag", 3) && strncmp(pos, "aig", 3)))
+			error("missing 'aag' or 'aig' header");
+
+		bool ascii_mode = pos[1] == 'a';
+		pos += 3;
+
+		unsigned int M = parse_uint(), I = parse_uint(), L = parse_uint(), O = parse_uint(), A = parse_uint();
+		if (!at_eol())
+			log_error("AIGER file %s uses AIGER 1.9 features (bad, constraint, justice or fairness properties), which are not supported.\n", filename.c_str());
+		parse_eol();
+
+		if (M < I + L + A)
+			error("maximum variable index in header is too small");
+
+		vector<unsigned int> input_lits(I), output_lits(O);
+		vector<unsigned int> latch_lits(L), latch_next(L), latch_reset(L);
+		vector<unsigned int> and_lhs(A), and_rhs0(A), and_rhs1(A);
+
+		for (unsigned int i = 0; i < I; i++) {
+			if (ascii_mode) {
+				input_lits[i] = parse_uint();
+				parse_eol();
+			} else
+				input_lits[i] = 2*(i+1);
+		}
+
+		for (unsigned int i = 0; i < L; i++) {
+			latch_lits[i] = ascii_mode ? parse_uint() : 2*(I+i+1);
+			latch_next[i] = parse_uint();
+			latch_reset[i] = at_eol() ? 0 : parse_uint();
+			parse_eol();
+		}
+
+		for (unsigned int i = 0; i < O; i++) {
+			output_lits[i] = parse_uint();
+			parse_eol();
+		}
+
+		for (unsigned int i = 0; i < A; i++) {
+			if (ascii_mode) {
+				and_lhs[i] = parse_uint();
+				and_rhs0[i] = parse_uint();
+				and_rhs1[i] = parse_uint();
+				parse_eol();
+			} else {
+				and_lhs[i] = 2*(I+L+i+1);
+				unsigned int delta0 = parse_varint();
+				unsigned int delta1 = parse_varint();
+				if (delta0 > and_lhs[i] || delta1 > and_lhs[i] - delta0)
+					error("invalid delta in binary AND section");
+				and_rhs0[i] = and_lhs[i] - delta0;
+				and_rhs1[i] = and_rhs0[i] - delta1;
+			}
+		}
+
+		dict<std::pair<int, int>, std::string> symbols;
+		while (pos != end && *pos != 'c') {
+			std::string line = parse_line();
+			if (line.empty())
+				continue;
+			size_t space = line.find(' ');
+			if (space == std::string::npos || (line[0] != 'i' && line[0] != 'l' && line[0] != 'o'))
+				continue;
+			symbols[std::make_pair(line[0], atoi(line.c_str() + 1))] = line.substr(space + 1);
+		}
+
+		if (design->module(module_name))
+			log_error("Can't create module %s from AIGER file %s: a module with that name already exists.\n",
+					log_id(module_name), filename.c_str());
+
+		RTLIL::Module *module = design->addModule(module_name);
+
+		// the symbol table may use the same name more than once (e.g. for an
+		// input that is directly connected to an output of the same name)
+		auto symbol_name = [&](char type, int index) -> RTLIL::IdString {
+			RTLIL::IdString name = stringf("\\%c%d", type, index);
+			auto it = symbols.find(std::make_pair(type, index));
+			if (it != symbols.end() && !module->wire(RTLIL::escape_id(it->second)))
+				name = RTLIL::escape_id(it->second);
+			if (module->wire(name))
+				name = NEW_ID;
+			return name;
+		};
+
+		// one bit per AIGER variable, the complemented literals are created on demand
+		vector<RTLIL::SigBit> var_bits(M+1);
+		dict<int, RTLIL::SigBit> inverted_bits;
+		var_bits[0] = RTLIL::State::S0;
+
+		auto check_var = [&](unsigned int lit, bool defined) {
+			if (lit/2 > M)
+				error("literal exceeds maximum variable index");
+			if (defined != (var_bits[lit/2].wire != nullptr || lit/2 == 0))
+				error(defined ? "literal is used but not defined" : "variable is defined twice");
+		};
+
+		for (unsigned int i = 0; i < I; i++) {
+			check_var(input_lits[i], false);
+			if (input_lits[i] & 1)
+				error("input literal is negated");
+			RTLIL::Wire *wire = module->addWire(symbol_name('i', i));
+			wire->port_input = true;
+			var_bits[input_lits[i]/2] = wire;
+		}
+
+		for (unsigned int i = 0; i < L; i++) {
+			check_var(latch_lits[i], false);
+			if (latch_lits[i] & 1)
+				error("latch literal is negated");
+			var_bits[latch_lits[i]/2] = module->addWire(symbol_name('l', i));
+		}
+
+		for (unsigned int i = 0; i < A; i++) {
+			check_var(and_lhs[i], false);
+			if (and_lhs[i] & 1)
+				error("AND gate output literal is negated");
+			var_bits[and_lhs[i]/2] = module->addWire(NEW_ID);
+		}
+
+		auto lit_bit = [&](unsigned int lit) -> RTLIL::SigBit {
+			check_var(lit, true);
+			if ((lit & 1) == 0)
+				return var_bits[lit/2];
+			if (lit == 1)
+				return RTLIL::State::S1;
+			if (inverted_bits.count(lit) == 0)
+				inverted_bits[lit] = module->NotGate(NEW_ID, var_bits[lit/2]);
+			return inverted_bits.at(lit);
+		};
+
+		for (unsigned int i = 0; i < A; i++)
+			module->addAndGate(NEW_ID, lit_bit(and_rhs0[i]), lit_bit(and_rhs1[i]), var_bits[and_lhs[i]/2]);
+
+		if (L > 0) {
+			if (module->wire(clk_name))
+				log_error("Can't create clock input %s in module %s: a signal with that name already exists.\n", log_id(clk_name), log_id(module));
+
+			RTLIL::Wire *clk_wire = module->addWire(clk_name);
+			clk_wire->port_input = true;
+
+			for (unsigned int i = 0; i < L; i++) {
+				RTLIL::SigBit q_bit = var_bits[latch_lits[i]/2];
+				module->addDffGate(NEW_ID, clk_wire, lit_bit(latch_next[i]), q_bit);
+				if (latch_reset[i] == 0 || latch_reset[i] == 1)
+					q_bit.wire->attributes["\\init"] = RTLIL::Const(latch_reset[i] ? RTLIL::State::S1 : RTLIL::State::S0);
+				else if (latch_reset[i] != latch_lits[i])
+					error("unsupported latch reset value");
+			}
+		}
+
+		for (unsigned int i = 0; i < O; i++) {
+			RTLIL::Wire *wire = module->addWire(symbol_name('o', i));
+			wire->port_output = true;
+			module->connect(wire, lit_bit(output_lits[i]));
+		}
+
+		module->fixup_ports();
+
+		log("Read AIG with %d inputs, %d latches, %d outputs and %d AND gates into module %s.\n",
+				I, L, O, A, log_id(module));
+	}
+};
+
+struct AigerFrontend : public Frontend {
+	AigerFrontend() : Frontend("aiger", "read AIGER file") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_aiger [options] [filename]\n");
+		log("\n");
+		log("Load a module from an AIGER file (binary 'aig' or ASCII 'aag' format) into the\n");
+		log("current design. AND gates are created as $_AND_ and $_NOT_ cells, latches as\n");
+		log("$_DFF_P_ cells with an 'init' attribute on their output wire for latches with\n");
+		log("reset value 0 or 1. The names from the symbol table are used for the ports and\n");
+		log("latch outputs when present.\n");
+		log("\n");
+		log("    -module_name <name>\n");
+		log("        name of the created module (default: the filename without extension)\n");
+		log("\n");
+		log("    -clk_name <name>\n");
+		log("        name of the clock input for the latches (default: clk)\n");
+		log("\n");
+	}
+	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
+	{
+		std::string module_name, clk_name = "clk";
+
+		log_header("Executing AIGER frontend.\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-module_name" && argidx+1 < args.size()) {
+				module_name = args[++argidx];
+				continue;
+			}
+			if (arg == "-clk_name" && argidx+1 < args.size()) {
+				clk_name = args[++argidx];
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx);
+
+		if (module_name.empty()) {
+			module_name = filename;
+			size_t slash = module_name.find_last_of("/\\");
+			if (slash != std::string::npos)
+				module_name = module_name.substr(slash + 1);
+			size_t dot = module_name.find('.');
+			if (dot != std::string::npos && dot > 0)
+				module_name = module_name.substr(0, dot);
+			if (module_name.empty())
+				module_name = "aiger";
+		}
+
+		MappedFile file(*f, filename);
+		AigerReader reader(file.data, file.size, filename);
+		reader.parse(design, RTLIL::escape_id(module_name), RTLIL::escape_id(clk_name));
+	}
+} AigerFrontend;
+
+YOSYS_NAMESPACE_END
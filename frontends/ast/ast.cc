@@ -28,6 +28,7 @@
 
 #include "kernel/yosys.h"
 #include "libs/sha1/sha1.h"
+#include "backends/ilang/ilang_backend.h"
 #include "ast.h"
 
 #include <sstream>
@@ -53,7 +54,7 @@ namespace AST {
 
 // instanciate global variables (private API)
 namespace AST_INTERNAL {
-	bool flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire;
+	bool flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire, flag_dedup_paramod;
 	AstNode *current_ast, *current_ast_mod;
 	std::map<std::string, AstNode*> current_scope;
 	const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr = NULL;
@@ -164,6 +165,89 @@ std::string AST::type2str(AstNodeType type)
 	}
 }
 
+// the interned file names are kept until the program ends
+AstFilename::AstFilename()
+{
+	static const std::string empty;
+	ptr = &empty;
+}
+
+AstFilename::AstFilename(const std::string &str)
+{
+	static std::set<std::string> names;
+	static const std::string *last = nullptr;
+
+	// consecutive nodes are almost always from the same file
+	if (last == nullptr || *last != str)
+		last = &*names.insert(str).first;
+	ptr = last;
+}
+
+// AST nodes are allocated from blocks of growing size. Deleted nodes are put
+// on a free list and reused, and the blocks are released when the last node
+// has been deleted, e.g. when the design is reset after AST::process().
+static struct {
+	std::vector<void*> blocks;
+	void *free_list = nullptr;
+	char *next = nullptr, *end = nullptr;
+	size_t block_nodes = 64;
+	size_t live_nodes = 0;
+} ast_arena;
+
+static void release_ast_arena()
+{
+	for (auto p : ast_arena.blocks)
+		::operator delete(p);
+
+	ast_arena.blocks.clear();
+	ast_arena.free_list = nullptr;
+	ast_arena.next = nullptr;
+	ast_arena.end = nullptr;
+	ast_arena.block_nodes = 64;
+}
+
+void *AstNode::operator new(size_t size)
+{
+	if (size != sizeof(AstNode))
+		return ::operator new(size);
+
+	ast_arena.live_nodes++;
+
+	if (ast_arena.free_list != nullptr) {
+		void *p = ast_arena.free_list;
+		ast_arena.free_list = *(void**)p;
+		return p;
+	}
+
+	if (ast_arena.next == ast_arena.end) {
+		ast_arena.next = (char*)::operator new(ast_arena.block_nodes * sizeof(AstNode));
+		ast_arena.end = ast_arena.next + ast_arena.block_nodes * sizeof(AstNode);
+		ast_arena.blocks.push_back(ast_arena.next);
+		ast_arena.block_nodes = std::min(2 * ast_arena.block_nodes, size_t(1) << 14);
+	}
+
+	void *p = ast_arena.next;
+	ast_arena.next += sizeof(AstNode);
+	return p;
+}
+
+void AstNode::operator delete(void *ptr, size_t size)
+{
+	if (ptr == nullptr)
+		return;
+
+	if (size != sizeof(AstNode)) {
+		::operator delete(ptr);
+		return;
+	}
+
+	*(void**)ptr = ast_arena.free_list;
+	ast_arena.free_list = ptr;
+
+	if (--ast_arena.live_nodes == 0)
+		release_ast_arena();
+}
+
 // check if attribute exists and has non-zero value
 bool AstNode::get_bool_attribute(RTLIL::IdString id)
 {
@@ -956,6 +1040,11 @@ static AstModule* process_module(AstNode *ast, bool defer)
 
 		ignoreThisSignalsInInitial = RTLIL::SigSpec();
 	}
+	else if (flag_lib)
+	{
+		// mark deferred library cells, so 'hierarchy' keeps the parameters on their instances
+		current_module->attributes["\\blackbox"] = RTLIL::Const(1);
+	}
 
 	current_module->ast = ast_before_simplify;
 	current_module->nolatches = flag_nolatches;
@@ -966,12 +1055,13 @@ static AstModule* process_module(AstNode *ast, bool defer)
 	current_module->noopt = flag_noopt;
 	current_module->icells = flag_icells;
 	current_module->autowire = flag_autowire;
+	current_module->dedup_paramod = flag_dedup_paramod;
 	current_module->fixup_ports();
 	return current_module;
 }
 
 // create AstModule instances for all modules in the AST tree and add them to 'design'
-void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool dump_vlog, bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool ignore_redef, bool defer, bool autowire)
+void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool dump_vlog, bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool ignore_redef, bool defer, bool autowire, bool dedup_paramod)
 {
 	current_ast = ast;
 	flag_dump_ast1 = dump_ast1;
@@ -985,6 +1075,7 @@ void AST::process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump
 	flag_noopt = noopt;
 	flag_icells = icells;
 	flag_autowire = autowire;
+	flag_dedup_paramod = dedup_paramod;
 
 	std::vector<AstNode*> global_decls;
 
@@ -1026,6 +1117,42 @@ AstModule::~AstModule()
 }
 
 // create a new parametric module (when needed) and return the name of the generated module
+// Structural hash of a derived module, used to merge derivations with
+// different parameter values that result in the same netlist. Internal
+// names contain autoidx counters that differ between derivations, so they
+// are renamed to a canonical sequence in a copy of the module that is then
+// dumped as ilang.
+static std::string derived_module_hash(RTLIL::Module *module)
+{
+	RTLIL::Module *copy = new RTLIL::Module;
+	module->cloneInto(copy);
+	copy->name = "\\paramod";
+
+	int counter = 0;
+	std::vector<RTLIL::Wire*> wires = copy->wires();
+	for (auto wire : wires)
+		if (wire->name[0] == '$')
+			copy->rename(wire, stringf("$paramod$%d", counter++));
+	std::vector<RTLIL::Cell*> cells = copy->cells();
+	for (auto cell : cells)
+		if (cell->name[0] == '$')
+			copy->rename(cell, stringf("$paramod$%d", counter++));
+
+	dict<RTLIL::IdString, RTLIL::Process*> processes;
+	for (auto &it : copy->processes) {
+		if (it.second->name[0] == '$')
+			it.second->name = stringf("$paramod$%d", counter++);
+		processes[it.second->name] = it.second;
+	}
+	copy->processes.swap(processes);
+
+	std::stringstream buf;
+	ILANG_BACKEND::dump_module(buf, "", copy, nullptr, false);
+	delete copy;
+
+	return sha1(buf.str());
+}
+
 RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters)
 {
 	std::string stripped_name = name.str();
@@ -1047,15 +1174,17 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 	flag_noopt = noopt;
 	flag_icells = icells;
 	flag_autowire = autowire;
+	flag_dedup_paramod = dedup_paramod;
 	use_internal_line_num();
 
+	// first only resolve the parameter values, so that no copy of the AST
+	// is created when a module for this parameter set already exists
 	std::string para_info;
-	AstNode *new_ast = ast->clone();
+	dict<std::string, RTLIL::Const> para_values;
 
 	int para_counter = 0;
 	int orig_parameters_n = parameters.size();
-	for (auto it = new_ast->children.begin(); it != new_ast->children.end(); it++) {
-		AstNode *child = *it;
+	for (auto child : ast->children) {
 		if (child->type != AST_PARAMETER)
 			continue;
 		para_counter++;
@@ -1064,8 +1193,7 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 			log("Parameter %s = %s\n", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[child->str])));
 	rewrite_parameter:
 			para_info += stringf("%s=%s", child->str.c_str(), log_signal(RTLIL::SigSpec(parameters[para_id])));
-			delete child->children.at(0);
-			child->children[0] = AstNode::mkconst_bits(parameters[para_id].bits, (parameters[para_id].flags & RTLIL::CONST_FLAG_SIGNED) != 0);
+			para_values[child->str] = parameters[para_id];
 			parameters.erase(para_id);
 			continue;
 		}
@@ -1087,15 +1215,50 @@ RTLIL::IdString AstModule::derive(RTLIL::Design *design, dict<RTLIL::IdString, R
 	else
 		modname = "$paramod" + stripped_name + para_info;
 
-	if (!design->has(modname)) {
-		new_ast->str = modname;
-		design->add(process_module(new_ast, false));
-		design->module(modname)->check();
-	} else {
+	if (design->has(modname)) {
 		log("Found cached RTLIL representation for module `%s'.\n", modname.c_str());
+		return modname;
+	}
+
+	if (dedup_paramod && orig_parameters_n != 0) {
+		std::string alias = design->scratchpad_get_string("ast.paramod_alias." + modname);
+		if (!alias.empty() && design->has(alias)) {
+			log("Found cached RTLIL representation for module `%s' (merged into `%s').\n", modname.c_str(), alias.c_str());
+			return alias;
+		}
 	}
 
+	AstNode *new_ast = ast->clone();
+	for (auto child : new_ast->children) {
+		if (child->type != AST_PARAMETER || para_values.count(child->str) == 0)
+			continue;
+		const RTLIL::Const &value = para_values.at(child->str);
+		delete child->children.at(0);
+		child->children[0] = AstNode::mkconst_bits(value.bits, (value.flags & RTLIL::CONST_FLAG_SIGNED) != 0);
+	}
+
+	new_ast->str = modname;
+	design->add(process_module(new_ast, false));
+	design->module(modname)->check();
+
 	delete new_ast;
+
+	if (dedup_paramod && orig_parameters_n != 0)
+	{
+		std::string hash = derived_module_hash(design->module(modname));
+		std::string hash_key = "ast.paramod_hash." + stripped_name + "." + hash;
+		std::string other = design->scratchpad_get_string(hash_key);
+
+		if (!other.empty() && design->has(other) && derived_module_hash(design->module(other)) == hash) {
+			log("Derived module `%s' is structurally identical to `%s', using the latter.\n", modname.c_str(), other.c_str());
+			design->remove(design->module(modname));
+			design->scratchpad_set_string("ast.paramod_alias." + modname, other);
+			return other;
+		}
+
+		design->scratchpad_set_string(hash_key, modname);
+	}
+
 	return modname;
 }
 
@@ -1114,6 +1277,7 @@ RTLIL::Module *AstModule::clone() const
 	new_mod->noopt = noopt;
 	new_mod->icells = icells;
 	new_mod->autowire = autowire;
+	new_mod->dedup_paramod = dedup_paramod;
 
 	return new_mod;
 }
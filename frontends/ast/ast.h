@@ -31,6 +31,7 @@
 
 #include "kernel/rtlil.h"
 #include <stdint.h>
+#include <memory>
 #include <set>
 
 YOSYS_NAMESPACE_BEGIN
@@ -141,6 +142,71 @@ namespace AST
 	// convert an node type to a string (e.g. for debug output)
 	std::string type2str(AstNodeType type);
 
+	// the source file name of an AST node. the names are interned, so a node
+	// only holds a pointer that is shared by all nodes from the same file.
+	struct AstFilename
+	{
+		const std::string *ptr;
+
+		AstFilename();
+		AstFilename(const std::string &str);
+
+		const std::string &str() const { return *ptr; }
+		const char *c_str() const { return ptr->c_str(); }
+		operator const std::string&() const { return *ptr; }
+	};
+
+	inline std::ostream &operator<<(std::ostream &os, const AstFilename &filename) {
+		return os << filename.str();
+	}
+
+	// a std::map that is only allocated when the first element is inserted.
+	// most AST nodes have no attributes, and an empty std::map is several
+	// times the size of a pointer.
+	template<typename K, typename T>
+	struct LazyMap
+	{
+		typedef std::map<K, T> map_t;
+		typedef typename map_t::iterator iterator;
+		typedef typename map_t::const_iterator const_iterator;
+
+		std::unique_ptr<map_t> ptr;
+
+		LazyMap() { }
+		LazyMap(const LazyMap &other) : ptr(other.ptr ? new map_t(*other.ptr) : nullptr) { }
+		LazyMap &operator=(const LazyMap &other) {
+			if (this != &other)
+				ptr.reset(other.ptr ? new map_t(*other.ptr) : nullptr);
+			return *this;
+		}
+
+		static map_t &empty_map() {
+			static map_t empty;
+			return empty;
+		}
+
+		iterator begin() { return ptr ? ptr->begin() : empty_map().begin(); }
+		iterator end() { return ptr ? ptr->end() : empty_map().end(); }
+		const_iterator begin() const { return ptr ? ptr->begin() : empty_map().begin(); }
+		const_iterator end() const { return ptr ? ptr->end() : empty_map().end(); }
+
+		size_t size() const { return ptr ? ptr->size() : 0; }
+		bool empty() const { return size() == 0; }
+		size_t count(const K &key) const { return ptr ? ptr->count(key) : 0; }
+		iterator find(const K &key) { return ptr ? ptr->find(key) : empty_map().end(); }
+		T &at(const K &key) { return ptr ? ptr->at(key) : empty_map().at(key); }
+		const T &at(const K &key) const { return ptr ? ptr->at(key) : empty_map().at(key); }
+		size_t erase(const K &key) { return ptr ? ptr->erase(key) : 0; }
+		void clear() { ptr.reset(); }
+		void swap(LazyMap &other) { ptr.swap(other.ptr); }
+
+		T &operator[](const K &key) {
+			if (!ptr)
+				ptr.reset(new map_t);
+			return (*ptr)[key];
+		}
+	};
+
 	// The AST is built using instances of this struct
 	struct AstNode
 	{
@@ -155,7 +221,7 @@ namespace AST
 		std::vector<AstNode*> children;
 
 		// the list of attributes assigned to this node
-		std::map<RTLIL::IdString, AstNode*> attributes;
+		LazyMap<RTLIL::IdString, AstNode*> attributes;
 		bool get_bool_attribute(RTLIL::IdString id);
 
 		// node content - most of it is unused in most node types
@@ -178,7 +244,7 @@ namespace AST
 		// this is the original sourcecode location that resulted in this AST node
 		// it is automatically set by the constructor using AST::current_filename and
 		// the AST::get_line_num() callback function.
-		std::string filename;
+		AstFilename filename;
 		int linenum;
 
 		// creating and deleting nodes
@@ -188,6 +254,10 @@ namespace AST
 		void delete_children();
 		~AstNode();
 
+		// nodes are allocated from an arena, see ast.cc
+		static void *operator new(size_t size);
+		static void operator delete(void *ptr, size_t size);
+
 		enum mem2reg_flags
 		{
 			/* status flags */
@@ -215,7 +285,8 @@ namespace AST
 		void replace_ids(const std::string &prefix, const std::map<std::string, std::string> &rules);
 		void mem2reg_as_needed_pass1(dict<AstNode*, pool<std::string>> &mem2reg_places,
 				dict<AstNode*, uint32_t> &mem2reg_flags, dict<AstNode*, uint32_t> &proc_flags, uint32_t &status_flags);
-		bool mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod, AstNode *block);
+		struct mem2reg_inserts_t { std::vector<AstNode*> before, after; };
+		bool mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod, AstNode *block, mem2reg_inserts_t *inserts);
 		bool mem2reg_check(pool<AstNode*> &mem2reg_set);
 		void meminfo(int &mem_width, int &mem_size, int &addr_bits);
 
@@ -266,13 +337,13 @@ namespace AST
 	};
 
 	// process an AST tree (ast must point to an AST_DESIGN node) and generate RTLIL code
-	void process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool dump_vlog, bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool ignore_redef, bool defer, bool autowire);
+	void process(RTLIL::Design *design, AstNode *ast, bool dump_ast1, bool dump_ast2, bool dump_vlog, bool nolatches, bool nomeminit, bool nomem2reg, bool mem2reg, bool lib, bool noopt, bool icells, bool ignore_redef, bool defer, bool autowire, bool dedup_paramod = false);
 
 	// parametric modules are supported directly by the AST library
 	// therefore we need our own derivate of RTLIL::Module with overloaded virtual functions
 	struct AstModule : RTLIL::Module {
 		AstNode *ast;
-		bool nolatches, nomeminit, nomem2reg, mem2reg, lib, noopt, icells, autowire;
+		bool nolatches, nomeminit, nomem2reg, mem2reg, lib, noopt, icells, autowire, dedup_paramod;
 		virtual ~AstModule();
 		virtual RTLIL::IdString derive(RTLIL::Design *design, dict<RTLIL::IdString, RTLIL::Const> parameters);
 		virtual RTLIL::Module *clone() const;
@@ -296,7 +367,7 @@ namespace AST
 namespace AST_INTERNAL
 {
 	// internal state variables
-	extern bool flag_dump_ast1, flag_dump_ast2, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire;
+	extern bool flag_dump_ast1, flag_dump_ast2, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_autowire, flag_dedup_paramod;
 	extern AST::AstNode *current_ast, *current_ast_mod;
 	extern std::map<std::string, AST::AstNode*> current_scope;
 	extern const dict<RTLIL::SigBit, RTLIL::SigBit> *genRTLIL_subst_ptr;
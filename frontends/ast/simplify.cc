@@ -41,6 +41,72 @@ YOSYS_NAMESPACE_BEGIN
 using namespace AST;
 using namespace AST_INTERNAL;
 
+// true if the expression only depends on constants and on parameters that are
+// declared outside of the loop body, i.e. is the same in every loop iteration
+static bool is_loop_invariant(AstNode *node, const std::string &loop_var, const pool<std::string> &body_names)
+{
+	switch (node->type)
+	{
+	case AST_CONSTANT:
+		return true;
+
+	case AST_IDENTIFIER:
+		if (node->str == loop_var || body_names.count(node->str) || !node->children.empty() || current_scope.count(node->str) == 0)
+			return false;
+		return current_scope.at(node->str)->type == AST_PARAMETER || current_scope.at(node->str)->type == AST_LOCALPARAM;
+
+	case AST_BIT_NOT: case AST_BIT_AND: case AST_BIT_OR: case AST_BIT_XOR: case AST_BIT_XNOR:
+	case AST_SHIFT_LEFT: case AST_SHIFT_RIGHT: case AST_SHIFT_SLEFT: case AST_SHIFT_SRIGHT:
+	case AST_LT: case AST_LE: case AST_EQ: case AST_NE: case AST_GE: case AST_GT:
+	case AST_ADD: case AST_SUB: case AST_MUL: case AST_DIV: case AST_MOD: case AST_POW:
+	case AST_POS: case AST_NEG: case AST_LOGIC_AND: case AST_LOGIC_OR: case AST_LOGIC_NOT: case AST_TERNARY:
+		for (auto child : node->children)
+			if (!is_loop_invariant(child, loop_var, body_names))
+				return false;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+static void collect_declared_names(AstNode *node, pool<std::string> &names)
+{
+	if (!node->str.empty() && (node->type == AST_WIRE || node->type == AST_MEMORY || node->type == AST_PARAMETER ||
+			node->type == AST_LOCALPARAM || node->type == AST_GENVAR || node->type == AST_FUNCTION || node->type == AST_TASK))
+		names.insert(node->str);
+	for (auto child : node->children)
+		collect_declared_names(child, names);
+}
+
+// range expressions (bit widths, constant bit selects) in a loop body often
+// only depend on parameters. they are evaluated once here instead of in every
+// copy of the body that is created when the loop is unrolled.
+static void fold_loop_invariant_ranges(AstNode *node, const std::string &loop_var, const pool<std::string> &body_names, int stage)
+{
+	if (node->type == AST_FUNCTION || node->type == AST_TASK)
+		return;
+
+	if (node->type == AST_RANGE) {
+		for (auto &child : node->children) {
+			if (child->type == AST_CONSTANT || !is_loop_invariant(child, loop_var, body_names))
+				continue;
+			AstNode *buf = child->clone();
+			while (buf->simplify(true, false, false, stage, -1, false, false)) { }
+			if (buf->type == AST_CONSTANT) {
+				log_count("ast.unroll.folded_ranges", 1);
+				delete child;
+				child = buf;
+			} else
+				delete buf;
+		}
+		return;
+	}
+
+	for (auto child : node->children)
+		fold_loop_invariant_ranges(child, loop_var, body_names, stage);
+}
+
 // convert the AST into a simpler AST that has all parameters substituted by their
 // values, unrolled for-loops, expanded generate blocks, etc. when this function
 // is done with an AST it can be converted into RTLIL using genRTLIL().
@@ -61,6 +127,16 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 	AstNode *newNode = NULL;
 	bool did_something = false;
 
+#ifdef YOSYS_ENABLE_COUNTERS
+	// number of simplify() calls per node type, printed with the counters (yosys -d)
+	static std::vector<LogCounter*> type_counters;
+	if (GetSize(type_counters) <= int(type))
+		type_counters.resize(type+1);
+	if (type_counters[type] == nullptr)
+		type_counters[type] = new LogCounter(strdup(("ast.simplify." + type2str(type)).c_str()));
+	type_counters[type]->value++;
+#endif
+
 #if 0
 	log("-------------\n");
 	log("AST simplify[%d] depth %d at %s:%d,\n", stage, recursion_counter, filename.c_str(), linenum);
@@ -148,13 +224,18 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 				}
 			}
 
-			while (mem2reg_as_needed_pass2(mem2reg_set, this, NULL)) { }
+			if (!mem2reg_set.empty())
+			{
+				mem2reg_as_needed_pass2(mem2reg_set, this, NULL, NULL);
 
-			for (size_t i = 0; i < children.size(); i++) {
-				if (mem2reg_set.count(children[i]) > 0) {
-					delete children[i];
-					children.erase(children.begin() + (i--));
+				std::vector<AstNode*> new_children;
+				for (auto child : children) {
+					if (mem2reg_set.count(child) > 0)
+						delete child;
+					else
+						new_children.push_back(child);
 				}
+				children.swap(new_children);
 			}
 		}
 
@@ -959,6 +1040,10 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 		varbuf = new AstNode(AST_LOCALPARAM, varbuf);
 		varbuf->str = init_ast->children[0]->str;
 
+		pool<std::string> body_names;
+		collect_declared_names(body_ast, body_names);
+		fold_loop_invariant_ranges(body_ast, varbuf->str, body_names, stage);
+
 		AstNode *backup_scope_varbuf = current_scope[varbuf->str];
 		current_scope[varbuf->str] = varbuf;
 
@@ -985,6 +1070,7 @@ bool AstNode::simplify(bool const_fold, bool at_zero, bool in_lvalue, int stage,
 			delete buf;
 
 			// expand body
+			log_count("ast.unroll.iterations", 1);
 			int index = varbuf->children[0]->integer;
 			if (body_ast->type == AST_GENBLOCK)
 				buf = body_ast->clone();
@@ -2280,7 +2366,7 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 
 	AstNode *meminit = nullptr;
 	int next_meminit_cursor=0;
-	vector<State> meminit_bits;
+	vector<State> meminit_bits, value_bits;
 	int meminit_size=0;
 
 	std::ifstream f;
@@ -2309,13 +2395,13 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 		std::getline(f, line);
 
 		for (int i = 0; i < GetSize(line); i++) {
-			if (in_comment && line.substr(i, 2) == "*/") {
+			if (in_comment && line[i] == '*' && i+1 < GetSize(line) && line[i+1] == '/') {
 				line[i] = ' ';
 				line[i+1] = ' ';
 				in_comment = false;
 				continue;
 			}
-			if (!in_comment && line.substr(i, 2) == "/*")
+			if (!in_comment && line[i] == '/' && i+1 < GetSize(line) && line[i+1] == '*')
 				in_comment = true;
 			if (in_comment)
 				line[i] = ' ';
@@ -2337,7 +2423,9 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 				continue;
 			}
 
-			AstNode *value = VERILOG_FRONTEND::const2ast(stringf("%d'%c", mem_width, is_readmemh ? 'h' : 'b') + token);
+			// the words are parsed directly into bits, without creating an
+			// AST node for each word of the (possibly very large) memory
+			VERILOG_FRONTEND::digits2bits(value_bits, token.c_str(), mem_width, is_readmemh ? 16 : 2);
 
 			if (unconditional_init)
 			{
@@ -2363,11 +2451,11 @@ AstNode *AstNode::readmem(bool is_readmemh, std::string mem_filename, AstNode *m
 
 				meminit_size++;
 				next_meminit_cursor++;
-				meminit_bits.insert(meminit_bits.end(), value->bits.begin(), value->bits.end());
-				delete value;
+				meminit_bits.insert(meminit_bits.end(), value_bits.begin(), value_bits.end());
 			}
 			else
 			{
+				AstNode *value = AstNode::mkconst_bits(value_bits, false);
 				block->children.push_back(new AstNode(AST_ASSIGN_EQ, new AstNode(AST_IDENTIFIER, new AstNode(AST_RANGE, AstNode::mkconst_int(cursor, false))), value));
 				block->children.back()->children[0]->str = memory->str;
 				block->children.back()->children[0]->id2ast = memory;
@@ -2595,12 +2683,36 @@ bool AstNode::mem2reg_check(pool<AstNode*> &mem2reg_set)
 }
 
 // actually replace memories with registers
-bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod, AstNode *block)
+// run mem2reg_as_needed_pass2() on a statement of a block and add it to the new
+// list of statements of the block, together with the statements that have been
+// created for it. those are processed, too, so that a single pass is enough.
+static bool mem2reg_as_needed_pass2_stmt(AstNode *stmt, pool<AstNode*> &mem2reg_set, AstNode *mod, AstNode *block, std::vector<AstNode*> &new_stmts)
+{
+	AstNode::mem2reg_inserts_t inserts;
+	bool did_something = stmt->mem2reg_as_needed_pass2(mem2reg_set, mod, block, &inserts);
+
+	for (auto node : inserts.before)
+		mem2reg_as_needed_pass2_stmt(node, mem2reg_set, mod, block, new_stmts);
+	new_stmts.push_back(stmt);
+	for (auto node : inserts.after)
+		mem2reg_as_needed_pass2_stmt(node, mem2reg_set, mod, block, new_stmts);
+
+	return did_something || !inserts.before.empty() || !inserts.after.empty();
+}
+
+bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod, AstNode *block, mem2reg_inserts_t *inserts)
 {
 	bool did_something = false;
 
 	if (type == AST_BLOCK)
-		block = this;
+	{
+		std::vector<AstNode*> new_children;
+		for (auto child : children)
+			if (mem2reg_as_needed_pass2_stmt(child, mem2reg_set, mod, this, new_children))
+				did_something = true;
+		children.swap(new_children);
+		return did_something;
+	}
 
 	if ((type == AST_ASSIGN_LE || type == AST_ASSIGN_EQ) && block != NULL &&
 			children[0]->mem2reg_check(mem2reg_set) && children[0]->children[0]->children[0]->type != AST_CONSTANT)
@@ -2626,15 +2738,11 @@ bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod,
 		mod->children.push_back(wire_data);
 		while (wire_data->simplify(true, false, false, 1, -1, false, false)) { }
 
-		log_assert(block != NULL);
-		size_t assign_idx = 0;
-		while (assign_idx < block->children.size() && block->children[assign_idx] != this)
-			assign_idx++;
-		log_assert(assign_idx < block->children.size());
+		log_assert(inserts != NULL);
 
 		AstNode *assign_addr = new AstNode(AST_ASSIGN_EQ, new AstNode(AST_IDENTIFIER), children[0]->children[0]->children[0]->clone());
 		assign_addr->children[0]->str = id_addr;
-		block->children.insert(block->children.begin()+assign_idx+1, assign_addr);
+		inserts->after.push_back(assign_addr);
 
 		AstNode *case_node = new AstNode(AST_CASE, new AstNode(AST_IDENTIFIER));
 		case_node->children[0]->str = id_addr;
@@ -2650,7 +2758,7 @@ bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod,
 			cond_node->children[1]->children.push_back(assign_reg);
 			case_node->children.push_back(cond_node);
 		}
-		block->children.insert(block->children.begin()+assign_idx+2, case_node);
+		inserts->after.push_back(case_node);
 
 		children[0]->delete_children();
 		children[0]->range_valid = false;
@@ -2730,12 +2838,9 @@ bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod,
 
 			if (block)
 			{
-				size_t assign_idx = 0;
-				while (assign_idx < block->children.size() && !block->children[assign_idx]->contains(this))
-					assign_idx++;
-				log_assert(assign_idx < block->children.size());
-				block->children.insert(block->children.begin()+assign_idx, case_node);
-				block->children.insert(block->children.begin()+assign_idx, assign_addr);
+				log_assert(inserts != NULL);
+				inserts->before.push_back(assign_addr);
+				inserts->before.push_back(case_node);
 			}
 			else
 			{
@@ -2757,9 +2862,18 @@ bool AstNode::mem2reg_as_needed_pass2(pool<AstNode*> &mem2reg_set, AstNode *mod,
 
 	log_assert(id2ast == NULL || mem2reg_set.count(id2ast) == 0);
 
+	// the module can grow while it is processed (new wires and processes for
+	// memory reads outside of blocks), the new children are processed, too
+	if (type == AST_MODULE) {
+		for (size_t i = 0; i < children.size(); i++)
+			if (children[i]->mem2reg_as_needed_pass2(mem2reg_set, mod, block, inserts))
+				did_something = true;
+		return did_something;
+	}
+
 	auto children_list = children;
 	for (size_t i = 0; i < children_list.size(); i++)
-		if (children_list[i]->mem2reg_as_needed_pass2(mem2reg_set, mod, block))
+		if (children_list[i]->mem2reg_as_needed_pass2(mem2reg_set, mod, block, inserts))
 			did_something = true;
 
 	return did_something;
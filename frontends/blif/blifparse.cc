@@ -21,43 +21,198 @@
 
 YOSYS_NAMESPACE_BEGIN
 
-static bool read_next_line(char *&buffer, size_t &buffer_size, int &line_count, std::istream &f)
+// The parser works on the complete file contents in memory. Lines and tokens
+// are referenced in place, only lines with '\' continuations are copied.
+// Net names are resolved through a hash table that is sized for the module
+// before it is parsed, so nets that are referenced more than once are only
+// converted to an IdString once.
+
+struct BlifToken
+{
+	const char *begin, *end;
+
+	BlifToken() : begin(nullptr), end(nullptr) { }
+	bool empty() const { return begin == end; }
+	int size() const { return end - begin; }
+	bool operator==(const char *str) const { return strncmp(begin, str, end - begin) == 0 && str[end - begin] == 0; }
+	bool operator!=(const char *str) const { return !(*this == str); }
+	std::string str() const { return std::string(begin, end); }
+};
+
+struct BlifParser
 {
-	int buffer_len = 0;
-	buffer[0] = 0;
+	RTLIL::Design *design;
+	std::string dff_name;
+	bool run_clean;
+	bool sop_mode;
+
+	const char *ptr, *end;
+	int line_count;
+
+	// the current line and the tokenizer position in it
+	const char *line_begin, *line_end, *tok_ptr;
+	std::vector<std::unique_ptr<std::string>> joined_lines;
+
+	RTLIL::Module *module;
+	int blif_maxnum;
+
+	struct net_entry_t {
+		const char *name;
+		int len;
+		unsigned int hash;
+		RTLIL::Wire *wire;
+	};
 
-	while (1)
+	std::vector<net_entry_t> net_table;
+	int net_count;
+
+	// The .names cover that is currently read. Its cubes are stored packed, with
+	// one care bit and one value bit per input, and are only converted to a cell
+	// when the cover is complete.
+	bool in_cover;
+	int cover_line, cover_words;
+	std::vector<RTLIL::SigBit> cover_inputs;
+	RTLIL::SigSpec cover_output;
+	std::vector<uint64_t> cover_care, cover_value;
+	std::vector<bool> cover_outvals;
+
+	BlifParser(RTLIL::Design *design, const char *data, size_t size, std::string dff_name, bool run_clean, bool sop_mode) :
+			design(design), dff_name(dff_name), run_clean(run_clean), sop_mode(sop_mode), ptr(data), end(data + size), line_count(0),
+			line_begin(nullptr), line_end(nullptr), tok_ptr(nullptr), module(nullptr), blif_maxnum(0), net_count(0),
+			in_cover(false), cover_line(0), cover_words(0) { }
+
+	static bool is_space(char c)
 	{
-		buffer_len += strlen(buffer + buffer_len);
-		while (buffer_len > 0 && (buffer[buffer_len-1] == ' ' || buffer[buffer_len-1] == '\t' ||
-				buffer[buffer_len-1] == '\r' || buffer[buffer_len-1] == '\n'))
-			buffer[--buffer_len] = 0;
-
-		if (buffer_size-buffer_len < 4096) {
-			buffer_size *= 2;
-			buffer = (char*)realloc(buffer, buffer_size);
-		}
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	bool read_next_line()
+	{
+		std::string *joined = nullptr;
 
-		if (buffer_len == 0 || buffer[buffer_len-1] == '\\') {
-			if (buffer_len > 0 && buffer[buffer_len-1] == '\\')
-				buffer[--buffer_len] = 0;
+		while (1)
+		{
 			line_count++;
-			if (!f.getline(buffer+buffer_len, buffer_size-buffer_len))
+			if (ptr == end)
 				return false;
-		} else
+
+			const char *b = ptr;
+			const char *e = (const char*)memchr(ptr, '\n', end - ptr);
+			if (e == nullptr)
+				e = end;
+			ptr = e == end ? end : e + 1;
+
+			if (joined != nullptr) {
+				joined->append(b, e);
+				while (!joined->empty() && is_space(joined->back()))
+					joined->pop_back();
+				if (joined->empty())
+					continue;
+				if (joined->back() == '\\') {
+					joined->pop_back();
+					continue;
+				}
+				b = joined->data();
+				e = b + joined->size();
+			} else {
+				while (e != b && is_space(e[-1]))
+					e--;
+				if (e == b)
+					continue;
+				if (e[-1] == '\\') {
+					joined = new std::string(b, e - 1);
+					joined_lines.push_back(std::unique_ptr<std::string>(joined));
+					continue;
+				}
+			}
+
+			line_begin = tok_ptr = b;
+			line_end = e;
 			return true;
+		}
 	}
-}
 
-void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bool run_clean)
-{
-	RTLIL::Module *module = nullptr;
-	RTLIL::Const *lutptr = NULL;
-	RTLIL::State lut_default_state = RTLIL::State::Sx;
-	int blif_maxnum = 0;
+	// strtok() on the current line
+	bool next_token(BlifToken &tok)
+	{
+		while (tok_ptr != line_end && is_space(*tok_ptr))
+			tok_ptr++;
+		if (tok_ptr == line_end)
+			return false;
+		tok.begin = tok_ptr;
+		while (tok_ptr != line_end && !is_space(*tok_ptr))
+			tok_ptr++;
+		tok.end = tok_ptr;
+		return true;
+	}
+
+	// strtok(NULL, "\r\n") after a token: the rest of the line after one separator
+	bool rest_of_line(BlifToken &tok)
+	{
+		if (tok_ptr != line_end)
+			tok_ptr++;
+		tok.begin = tok_ptr;
+		while (tok_ptr != line_end && *tok_ptr != '\r')
+			tok_ptr++;
+		tok.end = tok_ptr;
+		return !tok.empty();
+	}
+
+	void reset_net_table()
+	{
+		// estimate the number of nets from the number of lines up to ".end"
+		int line_estimate = 0;
+		for (const char *p = ptr; p != end; line_estimate++) {
+			p = (const char*)memchr(p, '\n', end - p);
+			if (p == nullptr || ++p == end)
+				break;
+			if (end - p >= 4 && !strncmp(p, ".end", 4) && (end - p == 4 || is_space(p[4])))
+				break;
+		}
+
+		int table_size = 64;
+		while (table_size < 2*line_estimate)
+			table_size *= 2;
+
+		net_table.clear();
+		net_table.resize(table_size);
+		net_count = 0;
+	}
 
-	auto blif_wire = [&](const std::string &wire_name) -> Wire*
+	void grow_net_table()
 	{
+		std::vector<net_entry_t> old_table;
+		old_table.swap(net_table);
+		net_table.resize(2*GetSize(old_table));
+
+		int mask = GetSize(net_table) - 1;
+		for (auto &entry : old_table) {
+			if (entry.name == nullptr)
+				continue;
+			int idx = entry.hash & mask;
+			while (net_table[idx].name != nullptr)
+				idx = (idx + 1) & mask;
+			net_table[idx] = entry;
+		}
+	}
+
+	RTLIL::Wire *blif_wire(const BlifToken &tok)
+	{
+		unsigned int hash = 5381;
+		for (const char *p = tok.begin; p != tok.end; p++)
+			hash = mkhash(hash, (unsigned char)*p);
+
+		int mask = GetSize(net_table) - 1;
+		int idx = hash & mask;
+		while (net_table[idx].name != nullptr) {
+			net_entry_t &entry = net_table[idx];
+			if (entry.hash == hash && entry.len == tok.size() && !memcmp(entry.name, tok.begin, entry.len))
+				return entry.wire;
+			idx = (idx + 1) & mask;
+		}
+
+		std::string wire_name = tok.str();
+
 		if (wire_name[0] == '$')
 		{
 			for (int i = 0; i+1 < GetSize(wire_name); i++)
@@ -83,307 +238,449 @@ void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bo
 		if (wire == nullptr)
 			wire = module->addWire(wire_id);
 
+		net_entry_t &entry = net_table[idx];
+		entry.name = tok.begin;
+		entry.len = tok.size();
+		entry.hash = hash;
+		entry.wire = wire;
+
+		if (2 * ++net_count > GetSize(net_table))
+			grow_net_table();
+
 		return wire;
-	};
+	}
 
-	dict<RTLIL::IdString, RTLIL::Const> *obj_attributes = nullptr;
-	dict<RTLIL::IdString, RTLIL::Const> *obj_parameters = nullptr;
+	// returns false if the cube has a syntax error
+	bool add_cube(const BlifToken &input, bool outval)
+	{
+		int width = GetSize(cover_inputs);
+		if (input.size() > width)
+			return false;
+
+		// inputs missing at the end of a short cube are treated as '0'
+		size_t offset = cover_care.size();
+		cover_care.resize(offset + cover_words, 0);
+		cover_value.resize(offset + cover_words, 0);
+		for (int j = 0; j < width; j++) {
+			char c = j < input.size() ? input.begin[j] : '0';
+			if (c == '-')
+				continue;
+			if (c != '0' && c != '1') {
+				// cubes with other characters never match
+				cover_care.resize(offset);
+				cover_value.resize(offset);
+				return true;
+			}
+			cover_care[offset + j/64] |= uint64_t(1) << (j%64);
+			if (c == '1')
+				cover_value[offset + j/64] |= uint64_t(1) << (j%64);
+		}
 
-	size_t buffer_size = 4096;
-	char *buffer = (char*)malloc(buffer_size);
-	int line_count = 0;
+		cover_outvals.push_back(outval);
+		return true;
+	}
 
-	while (1)
+	// Builds the $lut mask 64 entries at a time. Inputs 0 to 5 select the bit
+	// in a word and are matched with the constant patterns below, the other
+	// inputs select the word. Later cubes override earlier ones and the entries
+	// that no cube covers get the complement of the last cube's output value.
+	void add_cover_lut()
 	{
-		if (!read_next_line(buffer, buffer_size, line_count, f)) {
-			if (module != nullptr)
-				goto error;
-			free(buffer);
-			return;
+		static const uint64_t patterns[6] = {
+			0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+			0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+		};
+
+		int width = GetSize(cover_inputs);
+		int num_entries = 1 << width;
+		int num_words = (num_entries + 63) / 64;
+		uint64_t used_bits = width < 6 ? (uint64_t(1) << num_entries) - 1 : ~uint64_t(0);
+
+		std::vector<uint64_t> defined(num_words), ones(num_words);
+
+		for (int i = 0; i < GetSize(cover_outvals); i++)
+		{
+			uint64_t care = cover_care[i], value = cover_value[i];
+			uint64_t word_mask = used_bits;
+			for (int j = 0; j < width && j < 6; j++)
+				if ((care >> j) & 1)
+					word_mask &= ((value >> j) & 1) ? patterns[j] : ~patterns[j];
+
+			uint64_t word_care = care >> 6, word_value = value >> 6;
+			for (int k = 0; k < num_words; k++) {
+				if ((k & word_care) != word_value)
+					continue;
+				defined[k] |= word_mask;
+				if (cover_outvals[i])
+					ones[k] |= word_mask;
+				else
+					ones[k] &= ~word_mask;
+			}
 		}
 
-	continue_without_read:
-		if (buffer[0] == '#')
-			continue;
+		RTLIL::State default_state = RTLIL::State::Sx;
+		if (!cover_outvals.empty())
+			default_state = cover_outvals.back() ? RTLIL::State::S0 : RTLIL::State::S1;
+
+		RTLIL::Const lut;
+		lut.bits.resize(num_entries);
+		for (int i = 0; i < num_entries; i++) {
+			uint64_t bit = uint64_t(1) << (i%64);
+			if (defined[i/64] & bit)
+				lut.bits[i] = (ones[i/64] & bit) ? RTLIL::State::S1 : RTLIL::State::S0;
+			else
+				lut.bits[i] = default_state;
+		}
 
-		if (buffer[0] == '.')
+		RTLIL::Cell *cell = module->addCell(NEW_ID, "$lut");
+		cell->parameters["\\WIDTH"] = RTLIL::Const(width);
+		cell->parameters["\\LUT"] = lut;
+		cell->setPort("\\A", cover_inputs);
+		cell->setPort("\\Y", cover_output);
+	}
+
+	// one $eq cell per cube, or-ed together and inverted for an off-set cover
+	void add_cover_sop()
+	{
+		if (cover_outvals.empty()) {
+			module->connect(cover_output, RTLIL::State::Sx);
+			return;
+		}
+
+		RTLIL::SigSpec terms;
+		for (int i = 0; i < GetSize(cover_outvals); i++)
 		{
-			if (lutptr) {
-				for (auto &bit : lutptr->bits)
-					if (bit == RTLIL::State::Sx)
-						bit = lut_default_state;
-				lutptr = NULL;
-				lut_default_state = RTLIL::State::Sx;
+			RTLIL::SigSpec sig, pattern;
+			for (int j = 0; j < GetSize(cover_inputs); j++) {
+				uint64_t bit = uint64_t(1) << (j%64);
+				if (cover_care[i*cover_words + j/64] & bit) {
+					sig.append(cover_inputs[j]);
+					pattern.append((cover_value[i*cover_words + j/64] & bit) ? RTLIL::State::S1 : RTLIL::State::S0);
+				}
 			}
+			if (sig.empty())
+				terms.append(RTLIL::State::S1);
+			else
+				terms.append(module->Eq(NEW_ID, sig, pattern));
+		}
 
-			char *cmd = strtok(buffer, " \t\r\n");
+		if (cover_outvals.back())
+			module->addReduceOr(NEW_ID, terms, cover_output);
+		else
+			module->addNot(NEW_ID, module->ReduceOr(NEW_ID, terms), cover_output);
+	}
 
-			if (!strcmp(cmd, ".model")) {
+	void finish_cover()
+	{
+		int width = GetSize(cover_inputs);
+		int num_cubes = GetSize(cover_outvals);
+
+		bool single_outval = true;
+		for (int i = 0; i < num_cubes; i++)
+			if (cover_outvals[i] != cover_outvals.back())
+				single_outval = false;
+
+		bool use_sop = sop_mode && single_outval && (width > 16 || (width > 8 && num_cubes * 64 <= (1 << width)));
+
+		if (use_sop)
+			add_cover_sop();
+		else if (width <= 16)
+			add_cover_lut();
+		else
+			log_error("The cover in line %d has %d inputs, which is too wide for a $lut cell. Use -sop.\n", cover_line, width);
+
+		in_cover = false;
+		cover_inputs.clear();
+		cover_care.clear();
+		cover_value.clear();
+		cover_outvals.clear();
+	}
+
+	void parse_blif()
+	{
+		dict<RTLIL::IdString, RTLIL::Const> *obj_attributes = nullptr;
+		dict<RTLIL::IdString, RTLIL::Const> *obj_parameters = nullptr;
+
+		BlifToken cmd, tok;
+		std::vector<RTLIL::SigBit> names_sig;
+
+		while (1)
+		{
+			if (!read_next_line()) {
 				if (module != nullptr)
 					goto error;
-				module = new RTLIL::Module;
-				module->name = RTLIL::escape_id(strtok(NULL, " \t\r\n"));
-				obj_attributes = &module->attributes;
-				obj_parameters = nullptr;
-				if (design->module(module->name))
-					log_error("Duplicate definition of module %s in line %d!\n", log_id(module->name), line_count);
-				design->add(module);
-				continue;
+				return;
 			}
 
-			if (module == nullptr)
-				goto error;
+		continue_without_read:
+			if (*line_begin == '#')
+				continue;
 
-			if (!strcmp(cmd, ".end"))
+			if (*line_begin == '.')
 			{
-				module->fixup_ports();
+				if (in_cover)
+					finish_cover();
+
+				next_token(cmd);
+
+				if (cmd == ".model") {
+					if (module != nullptr || !next_token(tok))
+						goto error;
+					module = new RTLIL::Module;
+					module->name = RTLIL::escape_id(tok.str());
+					obj_attributes = &module->attributes;
+					obj_parameters = nullptr;
+					if (design->module(module->name))
+						log_error("Duplicate definition of module %s in line %d!\n", log_id(module->name), line_count);
+					design->add(module);
+					reset_net_table();
+					continue;
+				}
+
+				if (module == nullptr)
+					goto error;
 
-				if (run_clean)
+				if (cmd == ".end")
 				{
-					Const buffer_lut(vector<RTLIL::State>({State::S0, State::S1}));
-					vector<Cell*> remove_cells;
+					module->fixup_ports();
 
-					for (auto cell : module->cells())
-						if (cell->type == "$lut" && cell->getParam("\\LUT") == buffer_lut) {
-							module->connect(cell->getPort("\\Y"), cell->getPort("\\A"));
-							remove_cells.push_back(cell);
-						}
+					if (run_clean)
+					{
+						Const buffer_lut(vector<RTLIL::State>({State::S0, State::S1}));
+						vector<Cell*> remove_cells;
 
-					for (auto cell : remove_cells)
-						module->remove(cell);
+						for (auto cell : module->cells())
+							if (cell->type == "$lut" && cell->getParam("\\LUT") == buffer_lut) {
+								module->connect(cell->getPort("\\Y"), cell->getPort("\\A"));
+								remove_cells.push_back(cell);
+							}
 
-					Wire *true_wire = module->wire("$true");
-					Wire *false_wire = module->wire("$false");
-					Wire *undef_wire = module->wire("$undef");
+						for (auto cell : remove_cells)
+							module->remove(cell);
 
-					if (true_wire != nullptr)
-						module->rename(true_wire, stringf("$true$%d", ++blif_maxnum));
+						Wire *true_wire = module->wire("$true");
+						Wire *false_wire = module->wire("$false");
+						Wire *undef_wire = module->wire("$undef");
 
-					if (false_wire != nullptr)
-						module->rename(false_wire, stringf("$false$%d", ++blif_maxnum));
+						if (true_wire != nullptr)
+							module->rename(true_wire, stringf("$true$%d", ++blif_maxnum));
 
-					if (undef_wire != nullptr)
-						module->rename(undef_wire, stringf("$undef$%d", ++blif_maxnum));
+						if (false_wire != nullptr)
+							module->rename(false_wire, stringf("$false$%d", ++blif_maxnum));
 
-					autoidx = std::max(autoidx, blif_maxnum+1);
-					blif_maxnum = 0;
-				}
+						if (undef_wire != nullptr)
+							module->rename(undef_wire, stringf("$undef$%d", ++blif_maxnum));
 
-				module = nullptr;
-				obj_attributes = nullptr;
-				obj_parameters = nullptr;
-				continue;
-			}
+						autoidx = std::max(autoidx, blif_maxnum+1);
+						blif_maxnum = 0;
+					}
 
-			if (!strcmp(cmd, ".inputs") || !strcmp(cmd, ".outputs")) {
-				char *p;
-				while ((p = strtok(NULL, " \t\r\n")) != NULL) {
-					RTLIL::IdString wire_name(stringf("\\%s", p));
-					RTLIL::Wire *wire = module->wire(wire_name);
-					if (wire == nullptr)
-						wire = module->addWire(wire_name);
-					if (!strcmp(cmd, ".inputs"))
-						wire->port_input = true;
-					else
-						wire->port_output = true;
+					module = nullptr;
+					obj_attributes = nullptr;
+					obj_parameters = nullptr;
+					continue;
 				}
-				obj_attributes = nullptr;
-				obj_parameters = nullptr;
-				continue;
-			}
 
-			if (!strcmp(cmd, ".attr") || !strcmp(cmd, ".param")) {
-				char *n = strtok(NULL, " \t\r\n");
-				char *v = strtok(NULL, "\r\n");
-				IdString id_n = RTLIL::escape_id(n);
-				Const const_v;
-				if (v[0] == '"') {
-					std::string str(v+1);
-					if (str.back() == '"')
-						str.resize(str.size()-1);
-					const_v = Const(str);
-				} else {
-					int n = strlen(v);
-					const_v.bits.resize(n);
-					for (int i = 0; i < n; i++)
-						const_v.bits[i] = v[n-i-1] != '0' ? State::S1 : State::S0;
-				}
-				if (!strcmp(cmd, ".attr")) {
-					if (obj_attributes == nullptr)
-						goto error;
-					(*obj_attributes)[id_n] = const_v;
-				} else {
-					if (obj_parameters == nullptr)
-						goto error;
-					(*obj_parameters)[id_n] = const_v;
+				if (cmd == ".inputs" || cmd == ".outputs") {
+					bool is_input = cmd == ".inputs";
+					while (next_token(tok)) {
+						RTLIL::IdString wire_name("\\" + tok.str());
+						RTLIL::Wire *wire = module->wire(wire_name);
+						if (wire == nullptr)
+							wire = module->addWire(wire_name);
+						if (is_input)
+							wire->port_input = true;
+						else
+							wire->port_output = true;
+					}
+					obj_attributes = nullptr;
+					obj_parameters = nullptr;
+					continue;
 				}
-				continue;
-			}
 
-			if (!strcmp(cmd, ".latch"))
-			{
-				char *d = strtok(NULL, " \t\r\n");
-				char *q = strtok(NULL, " \t\r\n");
-				char *edge = strtok(NULL, " \t\r\n");
-				char *clock = strtok(NULL, " \t\r\n");
-				char *init = strtok(NULL, " \t\r\n");
-				RTLIL::Cell *cell = nullptr;
-
-				if (clock == nullptr && edge != nullptr) {
-					init = edge;
-					edge = nullptr;
+				if (cmd == ".attr" || cmd == ".param") {
+					BlifToken v;
+					if (!next_token(tok) || !rest_of_line(v))
+						goto error;
+					IdString id_n = RTLIL::escape_id(tok.str());
+					Const const_v;
+					if (*v.begin == '"') {
+						std::string str(v.begin+1, v.end);
+						if (str.back() == '"')
+							str.resize(str.size()-1);
+						const_v = Const(str);
+					} else {
+						int n = v.size();
+						const_v.bits.resize(n);
+						for (int i = 0; i < n; i++)
+							const_v.bits[i] = v.begin[n-i-1] != '0' ? State::S1 : State::S0;
+					}
+					if (cmd == ".attr") {
+						if (obj_attributes == nullptr)
+							goto error;
+						(*obj_attributes)[id_n] = const_v;
+					} else {
+						if (obj_parameters == nullptr)
+							goto error;
+						(*obj_parameters)[id_n] = const_v;
+					}
+					continue;
 				}
 
-				if (init != nullptr && (init[0] == '0' || init[0] == '1'))
-					blif_wire(d)->attributes["\\init"] = Const(init[0] == '1' ? 1 : 0, 1);
-
-				if (clock == nullptr)
-					goto no_latch_clock;
-
-				if (!strcmp(edge, "re"))
-					cell = module->addDff(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q));
-				else if (!strcmp(edge, "fe"))
-					cell = module->addDff(NEW_ID, blif_wire(clock), blif_wire(d), blif_wire(q), false);
-				else {
-			no_latch_clock:
-					cell = module->addCell(NEW_ID, dff_name);
-					cell->setPort("\\D", blif_wire(d));
-					cell->setPort("\\Q", blif_wire(q));
-				}
+				if (cmd == ".latch")
+				{
+					BlifToken d, q, edge, clock, init;
+					if (!next_token(d) || !next_token(q))
+						goto error;
+					if (next_token(edge) && next_token(clock))
+						next_token(init);
+					RTLIL::Cell *cell = nullptr;
 
-				obj_attributes = &cell->attributes;
-				obj_parameters = &cell->parameters;
-				continue;
-			}
+					if (clock.empty() && !edge.empty()) {
+						init = edge;
+						edge = BlifToken();
+					}
 
-			if (!strcmp(cmd, ".gate") || !strcmp(cmd, ".subckt"))
-			{
-				char *p = strtok(NULL, " \t\r\n");
-				if (p == NULL)
-					goto error;
+					if (!init.empty() && (*init.begin == '0' || *init.begin == '1'))
+						blif_wire(d)->attributes["\\init"] = Const(*init.begin == '1' ? 1 : 0, 1);
+
+					if (!clock.empty() && (edge == "re" || edge == "fe")) {
+						RTLIL::Wire *clock_wire = blif_wire(clock);
+						RTLIL::Wire *d_wire = blif_wire(d);
+						RTLIL::Wire *q_wire = blif_wire(q);
+						cell = module->addDff(NEW_ID, clock_wire, d_wire, q_wire, edge == "re");
+					} else {
+						cell = module->addCell(NEW_ID, dff_name);
+						cell->setPort("\\D", blif_wire(d));
+						cell->setPort("\\Q", blif_wire(q));
+					}
 
-				IdString celltype = RTLIL::escape_id(p);
-				RTLIL::Cell *cell = module->addCell(NEW_ID, celltype);
+					obj_attributes = &cell->attributes;
+					obj_parameters = &cell->parameters;
+					continue;
+				}
 
-				while ((p = strtok(NULL, " \t\r\n")) != NULL) {
-					char *q = strchr(p, '=');
-					if (q == NULL || !q[0])
+				if (cmd == ".gate" || cmd == ".subckt")
+				{
+					if (!next_token(tok))
 						goto error;
-					*(q++) = 0;
-					cell->setPort(RTLIL::escape_id(p), *q ? blif_wire(q) : SigSpec());
-				}
 
-				obj_attributes = &cell->attributes;
-				obj_parameters = &cell->parameters;
-				continue;
-			}
+					IdString celltype = RTLIL::escape_id(tok.str());
+					RTLIL::Cell *cell = module->addCell(NEW_ID, celltype);
 
-			obj_attributes = nullptr;
-			obj_parameters = nullptr;
+					while (next_token(tok)) {
+						const char *q = (const char*)memchr(tok.begin, '=', tok.size());
+						if (q == NULL)
+							goto error;
+						BlifToken net;
+						net.begin = q + 1;
+						net.end = tok.end;
+						cell->setPort(RTLIL::escape_id(std::string(tok.begin, q)), net.empty() ? SigSpec() : blif_wire(net));
+					}
 
-			if (!strcmp(cmd, ".barbuf"))
-			{
-				char *p = strtok(NULL, " \t\r\n");
-				if (p == NULL)
-					goto error;
+					obj_attributes = &cell->attributes;
+					obj_parameters = &cell->parameters;
+					continue;
+				}
 
-				char *q = strtok(NULL, " \t\r\n");
-				if (q == NULL)
-					goto error;
+				obj_attributes = nullptr;
+				obj_parameters = nullptr;
 
-				module->connect(blif_wire(q), blif_wire(p));
-				continue;
-			}
+				if (cmd == ".barbuf")
+				{
+					BlifToken p, q;
+					if (!next_token(p) || !next_token(q))
+						goto error;
 
-			if (!strcmp(cmd, ".names"))
-			{
-				char *p;
-				RTLIL::SigSpec input_sig, output_sig;
-				while ((p = strtok(NULL, " \t\r\n")) != NULL)
-					input_sig.append(blif_wire(p));
-				output_sig = input_sig.extract(input_sig.size()-1, 1);
-				input_sig = input_sig.extract(0, input_sig.size()-1);
-
-				if (input_sig.size() == 0)
+					RTLIL::Wire *q_wire = blif_wire(q);
+					module->connect(q_wire, blif_wire(p));
+					continue;
+				}
+
+				if (cmd == ".names")
 				{
-					RTLIL::State state = RTLIL::State::Sa;
-					while (1) {
-						if (!read_next_line(buffer, buffer_size, line_count, f))
-							goto error;
-						for (int i = 0; buffer[i]; i++) {
-							if (buffer[i] == ' ' || buffer[i] == '\t')
-								continue;
-							if (i == 0 && buffer[i] == '.')
-								goto finished_parsing_constval;
-							if (buffer[i] == '0') {
-								if (state == RTLIL::State::S1)
-									goto error;
-								state = RTLIL::State::S0;
-								continue;
-							}
-							if (buffer[i] == '1') {
-								if (state == RTLIL::State::S0)
-									goto error;
-								state = RTLIL::State::S1;
-								continue;
+					names_sig.clear();
+					while (next_token(tok))
+						names_sig.push_back(blif_wire(tok));
+					if (names_sig.empty())
+						goto error;
+
+					RTLIL::SigSpec output_sig = names_sig.back();
+					names_sig.pop_back();
+
+					if (names_sig.empty())
+					{
+						RTLIL::State state = RTLIL::State::Sa;
+						while (1) {
+							if (!read_next_line())
+								goto error;
+							for (const char *p = line_begin; p != line_end; p++) {
+								if (*p == ' ' || *p == '\t')
+									continue;
+								if (p == line_begin && *p == '.')
+									goto finished_parsing_constval;
+								if (*p == '0') {
+									if (state == RTLIL::State::S1)
+										goto error;
+									state = RTLIL::State::S0;
+									continue;
+								}
+								if (*p == '1') {
+									if (state == RTLIL::State::S0)
+										goto error;
+									state = RTLIL::State::S1;
+									continue;
+								}
+								goto error;
 							}
-							goto error;
 						}
+
+					finished_parsing_constval:
+						if (state == RTLIL::State::Sa)
+							state = RTLIL::State::S0;
+						if (output_sig.as_wire()->name == "$undef")
+							state = RTLIL::State::Sx;
+						module->connect(RTLIL::SigSig(output_sig, state));
+						goto continue_without_read;
 					}
 
-				finished_parsing_constval:
-					if (state == RTLIL::State::Sa)
-						state = RTLIL::State::S0;
-					if (output_sig.as_wire()->name == "$undef")
-						state = RTLIL::State::Sx;
-					module->connect(RTLIL::SigSig(output_sig, state));
-					goto continue_without_read;
+					in_cover = true;
+					cover_line = line_count;
+					cover_words = (GetSize(names_sig) + 63) / 64;
+					cover_inputs.swap(names_sig);
+					cover_output = output_sig;
+					continue;
 				}
 
-				RTLIL::Cell *cell = module->addCell(NEW_ID, "$lut");
-				cell->parameters["\\WIDTH"] = RTLIL::Const(input_sig.size());
-				cell->parameters["\\LUT"] = RTLIL::Const(RTLIL::State::Sx, 1 << input_sig.size());
-				cell->setPort("\\A", input_sig);
-				cell->setPort("\\Y", output_sig);
-				lutptr = &cell->parameters.at("\\LUT");
-				lut_default_state = RTLIL::State::Sx;
-				continue;
+				goto error;
 			}
 
-			goto error;
-		}
-
-		if (lutptr == NULL)
-			goto error;
-
-		char *input = strtok(buffer, " \t\r\n");
-		char *output = strtok(NULL, " \t\r\n");
-
-		if (input == NULL || output == NULL || (strcmp(output, "0") && strcmp(output, "1")))
-			goto error;
+			if (!in_cover)
+				goto error;
 
-		int input_len = strlen(input);
-		if (input_len > 8)
-			goto error;
+			BlifToken input, output;
+			if (!next_token(input) || !next_token(output) || (output != "0" && output != "1"))
+				goto error;
 
-		for (int i = 0; i < (1 << input_len); i++) {
-			for (int j = 0; j < input_len; j++) {
-				char c1 = input[j];
-				if (c1 != '-') {
-					char c2 = (i & (1 << j)) != 0 ? '1' : '0';
-					if (c1 != c2)
-						goto try_next_value;
-				}
-			}
-			lutptr->bits.at(i) = !strcmp(output, "0") ? RTLIL::State::S0 : RTLIL::State::S1;
-		try_next_value:;
+			if (!add_cube(input, output == "1"))
+				goto error;
 		}
 
-		lut_default_state = !strcmp(output, "0") ? RTLIL::State::S1 : RTLIL::State::S0;
+	error:
+		log_error("Syntax error in line %d!\n", line_count);
 	}
+};
+
+void parse_blif(RTLIL::Design *design, const char *data, size_t size, std::string dff_name, bool run_clean, bool sop_mode)
+{
+	BlifParser parser(design, data, size, dff_name, run_clean, sop_mode);
+	parser.parse_blif();
+}
 
-error:
-	log_error("Syntax error in line %d!\n", line_count);
+void parse_blif(RTLIL::Design *design, std::istream &f, std::string dff_name, bool run_clean, bool sop_mode)
+{
+	std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	parse_blif(design, data.data(), data.size(), dff_name, run_clean, sop_mode);
 }
 
 struct BlifFrontend : public Frontend {
@@ -396,11 +693,19 @@ struct BlifFrontend : public Frontend {
 		log("\n");
 		log("Load modules from a BLIF file into the current design.\n");
 		log("\n");
+		log("    -sop\n");
+		log("        import sparse .names covers with more than 8 inputs (less than one\n");
+		log("        cube per 64 LUT entries) and all covers with more than 16 inputs as\n");
+		log("        sum-of-products logic ($eq and $reduce_or cells) instead of $lut\n");
+		log("        cells.\n");
+		log("\n");
 	}
 	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
 		log_header("Executing BLIF frontend.\n");
 
+		bool sop_mode = false;
+
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
 			std::string arg = args[argidx];
@@ -408,11 +713,16 @@ struct BlifFrontend : public Frontend {
 			// 	flag_lib = true;
 			// 	continue;
 			// }
+			if (arg == "-sop") {
+				sop_mode = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(f, filename, args, argidx);
 
-		parse_blif(design, *f, "\\DFF", true);
+		MappedFile file(*f, filename);
+		parse_blif(design, file.data, file.size, "\\DFF", true, sop_mode);
 	}
 } BlifFrontend;
 
@@ -0,0 +1,672 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  A hand-written recursive descent parser for the ilang format, used by
+ *  'read_ilang -fast'. It accepts the same language as the flex/bison
+ *  parser in ilang_lexer.l and ilang_parser.y, but works on the complete
+ *  file contents in memory and does not allocate memory for tokens.
+ *
+ */
+
+#include "ilang_frontend.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+namespace {
+
+enum ilang_keyword_t {
+	KW_NONE, KW_AUTOIDX, KW_MODULE, KW_ATTRIBUTE, KW_PARAMETER, KW_SIGNED,
+	KW_WIRE, KW_MEMORY, KW_WIDTH, KW_UPTO, KW_OFFSET, KW_SIZE, KW_INPUT,
+	KW_OUTPUT, KW_INOUT, KW_CELL, KW_CONNECT, KW_SWITCH, KW_CASE, KW_ASSIGN,
+	KW_SYNC, KW_LOW, KW_HIGH, KW_POSEDGE, KW_NEGEDGE, KW_EDGE, KW_ALWAYS,
+	KW_INIT, KW_UPDATE, KW_PROCESS, KW_END
+};
+
+struct IlangFastParser
+{
+	RTLIL::Design *design;
+	const char *ptr, *end;
+	int line_count;
+
+	RTLIL::Module *module;
+	dict<RTLIL::IdString, RTLIL::Const> attrbuf;
+
+	// scratch storage that is reused for all tokens and signals
+	std::string id_buffer;
+	std::vector<RTLIL::SigChunk> sig_chunks;
+
+	IlangFastParser(RTLIL::Design *design, const char *data, size_t size) :
+			design(design), ptr(data), end(data + size), line_count(1), module(nullptr) { }
+
+	void error(const std::string &msg)
+	{
+		log_error("Parser error in line %d: %s\n", line_count, msg.c_str());
+	}
+
+	void skip_space()
+	{
+		while (ptr != end && (*ptr == ' ' || *ptr == '\t'))
+			ptr++;
+		if (ptr != end && *ptr == '#')
+			while (ptr != end && *ptr != '\n')
+				ptr++;
+	}
+
+	bool at_eol()
+	{
+		skip_space();
+		return ptr == end || *ptr == '\r' || *ptr == '\n';
+	}
+
+	void skip_eols()
+	{
+		while (1) {
+			skip_space();
+			if (ptr == end || (*ptr != '\r' && *ptr != '\n'))
+				break;
+			if (*(ptr++) == '\n')
+				line_count++;
+		}
+	}
+
+	void expect_eol()
+	{
+		if (!at_eol())
+			error("syntax error");
+		skip_eols();
+	}
+
+	void expect_char(char ch)
+	{
+		skip_space();
+		if (ptr == end || *ptr != ch)
+			error("syntax error");
+		ptr++;
+	}
+
+	ilang_keyword_t read_keyword()
+	{
+		skip_space();
+		const char *p = ptr;
+		while (p != end && 'a' <= *p && *p <= 'z')
+			p++;
+
+		int len = p - ptr;
+		if (len == 0)
+			return KW_NONE;
+
+		static const std::pair<const char*, ilang_keyword_t> keywords[] = {
+			{"autoidx", KW_AUTOIDX}, {"module", KW_MODULE}, {"attribute", KW_ATTRIBUTE},
+			{"parameter", KW_PARAMETER}, {"signed", KW_SIGNED}, {"wire", KW_WIRE},
+			{"memory", KW_MEMORY}, {"width", KW_WIDTH}, {"upto", KW_UPTO},
+			{"offset", KW_OFFSET}, {"size", KW_SIZE}, {"input", KW_INPUT},
+			{"output", KW_OUTPUT}, {"inout", KW_INOUT}, {"cell", KW_CELL},
+			{"connect", KW_CONNECT}, {"switch", KW_SWITCH}, {"case", KW_CASE},
+			{"assign", KW_ASSIGN}, {"sync", KW_SYNC}, {"low", KW_LOW},
+			{"high", KW_HIGH}, {"posedge", KW_POSEDGE}, {"negedge", KW_NEGEDGE},
+			{"edge", KW_EDGE}, {"always", KW_ALWAYS}, {"init", KW_INIT},
+			{"update", KW_UPDATE}, {"process", KW_PROCESS}, {"end", KW_END}
+		};
+
+		for (auto &kw : keywords)
+			if (strncmp(kw.first, ptr, len) == 0 && kw.first[len] == 0) {
+				ptr = p;
+				return kw.second;
+			}
+
+		error("syntax error");
+		return KW_NONE;
+	}
+
+	bool next_is_id()
+	{
+		skip_space();
+		return ptr != end && (*ptr == '\\' || *ptr == '$' || *ptr == '.');
+	}
+
+	RTLIL::IdString read_id()
+	{
+		skip_space();
+		const char *p = ptr;
+		if (p != end && (*p == '\\' || *p == '$')) {
+			p++;
+			while (p != end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+				p++;
+		} else if (p != end && *p == '.') {
+			p++;
+			while (p != end && '0' <= *p && *p <= '9')
+				p++;
+		}
+		if (p - ptr < 2)
+			error("syntax error");
+
+		id_buffer.assign(ptr, p);
+		ptr = p;
+		return RTLIL::IdString(id_buffer);
+	}
+
+	int read_int()
+	{
+		skip_space();
+		bool negative = false;
+		if (ptr != end && *ptr == '-') {
+			negative = true;
+			ptr++;
+		}
+		if (ptr == end || *ptr < '0' || *ptr > '9')
+			error("syntax error");
+		long long value = 0;
+		while (ptr != end && '0' <= *ptr && *ptr <= '9')
+			value = value*10 + (*(ptr++) - '0');
+		return negative ? -int(value) : int(value);
+	}
+
+	void read_string(std::string &str)
+	{
+		expect_char('"');
+		str.clear();
+		while (1)
+		{
+			const char *p = ptr;
+			while (p != end && *p != '"' && *p != '\\' && *p != '\n')
+				p++;
+			str.append(ptr, p);
+			ptr = p;
+
+			if (ptr == end || *ptr == '\n')
+				error("unterminated string");
+			if (*(ptr++) == '"')
+				break;
+
+			// backslash escapes as handled by ilang_lexer.l
+			if (ptr == end || *ptr == '\n')
+				error("unterminated string");
+			char ch = *(ptr++);
+			if (ch == 'n')
+				ch = '\n';
+			else if (ch == 't')
+				ch = '\t';
+			else if ('0' <= ch && ch <= '7') {
+				ch = ch - '0';
+				for (int i = 0; i < 2 && ptr != end && '0' <= *ptr && *ptr <= '7'; i++)
+					ch = ch * 8 + *(ptr++) - '0';
+			}
+			str += ch;
+		}
+	}
+
+	RTLIL::Const read_constant()
+	{
+		skip_space();
+		if (ptr != end && *ptr == '"') {
+			std::string str;
+			read_string(str);
+			return RTLIL::Const(str);
+		}
+
+		const char *p = ptr;
+		while (p != end && '0' <= *p && *p <= '9')
+			p++;
+		if (p == end || *p != '\'' || p == ptr)
+			return RTLIL::Const(read_int(), 32);
+
+		int width = read_int();
+		const char *bits_begin = ++ptr;
+		while (ptr != end && (*ptr == '0' || *ptr == '1' || *ptr == 'x' || *ptr == 'z' || *ptr == 'm' || *ptr == '-'))
+			ptr++;
+
+		// bits are written MSB first, missing MSBs are extended like in ilang_parser.y
+		RTLIL::Const value;
+		value.bits.reserve(width);
+		for (const char *q = ptr; q != bits_begin && GetSize(value.bits) < width; ) {
+			switch (*--q) {
+				case '0': value.bits.push_back(RTLIL::S0); break;
+				case '1': value.bits.push_back(RTLIL::S1); break;
+				case 'z': value.bits.push_back(RTLIL::Sz); break;
+				case '-': value.bits.push_back(RTLIL::Sa); break;
+				case 'm': value.bits.push_back(RTLIL::Sm); break;
+				default: value.bits.push_back(RTLIL::Sx); break;
+			}
+		}
+		if (GetSize(value.bits) < width) {
+			RTLIL::State ext = RTLIL::Sx;
+			if (ptr != bits_begin)
+				ext = *bits_begin == '0' || *bits_begin == '1' ? RTLIL::S0 : *bits_begin == 'z' ? RTLIL::Sz :
+						*bits_begin == '-' ? RTLIL::Sa : *bits_begin == 'm' ? RTLIL::Sm : RTLIL::Sx;
+			value.bits.resize(width, ext);
+		}
+		return value;
+	}
+
+	RTLIL::Wire *read_wire_ref()
+	{
+		RTLIL::IdString name = read_id();
+		auto it = module->wires_.find(name);
+		if (it == module->wires_.end())
+			error(stringf("ilang error: wire %s not found", name.c_str()));
+		return it->second;
+	}
+
+	// appends the chunks of one signal (LSB first) to sig_chunks
+	void parse_sigspec()
+	{
+		skip_space();
+		if (ptr == end)
+			error("syntax error");
+
+		if (*ptr == '{')
+		{
+			ptr++;
+			int start = GetSize(sig_chunks);
+			std::vector<int> part_starts;
+			while (1) {
+				skip_space();
+				if (ptr != end && *ptr == '}')
+					break;
+				part_starts.push_back(GetSize(sig_chunks));
+				parse_sigspec();
+			}
+			ptr++;
+
+			// the first part in the concatenation is the most significant
+			std::vector<RTLIL::SigChunk> parts(sig_chunks.begin() + start, sig_chunks.end());
+			sig_chunks.resize(start);
+			int part_end = GetSize(parts);
+			for (int i = GetSize(part_starts)-1; i >= 0; i--) {
+				int part_start = part_starts[i] - start;
+				sig_chunks.insert(sig_chunks.end(), parts.begin() + part_start, parts.begin() + part_end);
+				part_end = part_start;
+			}
+			return;
+		}
+
+		if (*ptr == '\\' || *ptr == '$' || *ptr == '.')
+		{
+			RTLIL::Wire *wire = read_wire_ref();
+			skip_space();
+			if (ptr == end || *ptr != '[') {
+				if (wire->width != 0)
+					sig_chunks.push_back(RTLIL::SigChunk(wire));
+				return;
+			}
+			ptr++;
+			int high = read_int(), low = high;
+			skip_space();
+			if (ptr != end && *ptr == ':') {
+				ptr++;
+				low = read_int();
+			}
+			expect_char(']');
+			if (low < 0 || high < low || high >= wire->width)
+				error(stringf("ilang error: bit index out of range for wire %s", wire->name.c_str()));
+			sig_chunks.push_back(RTLIL::SigChunk(wire, low, high - low + 1));
+			return;
+		}
+
+		RTLIL::Const value = read_constant();
+		if (GetSize(value) != 0)
+			sig_chunks.push_back(RTLIL::SigChunk(value));
+	}
+
+	RTLIL::SigSpec read_sigspec()
+	{
+		sig_chunks.clear();
+		parse_sigspec();
+		if (GetSize(sig_chunks) == 1)
+			return RTLIL::SigSpec(sig_chunks.front());
+		return RTLIL::SigSpec(sig_chunks);
+	}
+
+	void check_dangling_attr()
+	{
+		if (attrbuf.size() != 0)
+			error("dangling attribute");
+	}
+
+	void parse_attr_stmt()
+	{
+		RTLIL::IdString name = read_id();
+		attrbuf[name] = read_constant();
+		expect_eol();
+	}
+
+	void parse_wire_stmt()
+	{
+		int width = 1, start_offset = 0, port_id = 0;
+		bool upto = false, port_input = false, port_output = false;
+
+		while (!next_is_id())
+			switch (read_keyword()) {
+				case KW_WIDTH: width = read_int(); break;
+				case KW_UPTO: upto = true; break;
+				case KW_OFFSET: start_offset = read_int(); break;
+				case KW_INPUT: port_id = read_int(), port_input = true, port_output = false; break;
+				case KW_OUTPUT: port_id = read_int(), port_input = false, port_output = true; break;
+				case KW_INOUT: port_id = read_int(), port_input = true, port_output = true; break;
+				default: error("syntax error");
+			}
+
+		RTLIL::IdString name = read_id();
+		expect_eol();
+
+		if (module->wires_.count(name) != 0)
+			error(stringf("ilang error: redefinition of wire %s.", name.c_str()));
+
+		RTLIL::Wire *wire = module->addWire(name, width);
+		wire->upto = upto;
+		wire->start_offset = start_offset;
+		wire->port_id = port_id;
+		wire->port_input = port_input;
+		wire->port_output = port_output;
+		wire->attributes.swap(attrbuf);
+		attrbuf.clear();
+	}
+
+	void parse_memory_stmt()
+	{
+		RTLIL::Memory *memory = new RTLIL::Memory;
+		memory->attributes.swap(attrbuf);
+		attrbuf.clear();
+
+		while (!next_is_id())
+			switch (read_keyword()) {
+				case KW_WIDTH: memory->width = read_int(); break;
+				case KW_SIZE: memory->size = read_int(); break;
+				case KW_OFFSET: memory->start_offset = read_int(); break;
+				default: error("syntax error");
+			}
+
+		memory->name = read_id();
+		expect_eol();
+
+		if (module->memories.count(memory->name) != 0)
+			error(stringf("ilang error: redefinition of memory %s.", memory->name.c_str()));
+		module->memories[memory->name] = memory;
+	}
+
+	void parse_cell_stmt()
+	{
+		RTLIL::IdString type = read_id();
+		RTLIL::IdString name = read_id();
+		expect_eol();
+
+		if (module->cells_.count(name) != 0)
+			error(stringf("ilang error: redefinition of cell %s.", name.c_str()));
+
+		RTLIL::Cell *cell = module->addCell(name, type);
+		cell->attributes.swap(attrbuf);
+		attrbuf.clear();
+
+		while (1)
+		{
+			ilang_keyword_t kw = read_keyword();
+
+			if (kw == KW_PARAMETER) {
+				bool is_signed = false;
+				if (!next_is_id()) {
+					if (read_keyword() != KW_SIGNED)
+						error("syntax error");
+					is_signed = true;
+				}
+				RTLIL::IdString param = read_id();
+				RTLIL::Const &value = cell->parameters[param];
+				value = read_constant();
+				if (is_signed)
+					value.flags |= RTLIL::CONST_FLAG_SIGNED;
+				expect_eol();
+				continue;
+			}
+
+			if (kw == KW_CONNECT) {
+				RTLIL::IdString port = read_id();
+				if (cell->hasPort(port))
+					error(stringf("ilang error: redefinition of cell port %s.", port.c_str()));
+				cell->setPort(port, read_sigspec());
+				expect_eol();
+				continue;
+			}
+
+			if (kw == KW_END) {
+				expect_eol();
+				break;
+			}
+
+			error("syntax error");
+		}
+	}
+
+	void parse_case_body(RTLIL::CaseRule *case_rule)
+	{
+		while (1)
+		{
+			const char *saved_ptr = ptr;
+			ilang_keyword_t kw = read_keyword();
+
+			if (kw == KW_ATTRIBUTE) {
+				parse_attr_stmt();
+				continue;
+			}
+
+			if (kw == KW_SWITCH) {
+				parse_switch(case_rule);
+				continue;
+			}
+
+			check_dangling_attr();
+
+			if (kw == KW_ASSIGN) {
+				RTLIL::SigSpec lhs = read_sigspec();
+				RTLIL::SigSpec rhs = read_sigspec();
+				case_rule->actions.push_back(RTLIL::SigSig(lhs, rhs));
+				expect_eol();
+				continue;
+			}
+
+			ptr = saved_ptr;
+			return;
+		}
+	}
+
+	void parse_switch(RTLIL::CaseRule *parent)
+	{
+		RTLIL::SwitchRule *rule = new RTLIL::SwitchRule;
+		rule->signal = read_sigspec();
+		rule->attributes.swap(attrbuf);
+		attrbuf.clear();
+		parent->switches.push_back(rule);
+		expect_eol();
+
+		while (1)
+		{
+			ilang_keyword_t kw = read_keyword();
+
+			if (kw == KW_CASE) {
+				RTLIL::CaseRule *case_rule = new RTLIL::CaseRule;
+				rule->cases.push_back(case_rule);
+				if (!at_eol())
+					while (1) {
+						case_rule->compare.push_back(read_sigspec());
+						skip_space();
+						if (ptr == end || *ptr != ',')
+							break;
+						ptr++;
+					}
+				expect_eol();
+				parse_case_body(case_rule);
+				continue;
+			}
+
+			if (kw == KW_END) {
+				expect_eol();
+				break;
+			}
+
+			error("syntax error");
+		}
+	}
+
+	void parse_process_stmt()
+	{
+		RTLIL::IdString name = read_id();
+		expect_eol();
+
+		if (module->processes.count(name) != 0)
+			error(stringf("ilang error: redefinition of process %s.", name.c_str()));
+
+		RTLIL::Process *process = new RTLIL::Process;
+		process->name = name;
+		process->attributes.swap(attrbuf);
+		attrbuf.clear();
+		module->processes[name] = process;
+
+		parse_case_body(&process->root_case);
+
+		while (1)
+		{
+			ilang_keyword_t kw = read_keyword();
+
+			if (kw == KW_END) {
+				expect_eol();
+				break;
+			}
+
+			if (kw != KW_SYNC)
+				error("syntax error");
+
+			RTLIL::SyncRule *rule = new RTLIL::SyncRule;
+			process->syncs.push_back(rule);
+
+			switch (read_keyword()) {
+				case KW_LOW: rule->type = RTLIL::ST0; break;
+				case KW_HIGH: rule->type = RTLIL::ST1; break;
+				case KW_POSEDGE: rule->type = RTLIL::STp; break;
+				case KW_NEGEDGE: rule->type = RTLIL::STn; break;
+				case KW_EDGE: rule->type = RTLIL::STe; break;
+				case KW_ALWAYS: rule->type = RTLIL::STa; break;
+				case KW_INIT: rule->type = RTLIL::STi; break;
+				default: error("syntax error");
+			}
+			if (rule->type != RTLIL::STa && rule->type != RTLIL::STi)
+				rule->signal = read_sigspec();
+			expect_eol();
+
+			while (1) {
+				const char *saved_ptr = ptr;
+				if (read_keyword() != KW_UPDATE) {
+					ptr = saved_ptr;
+					break;
+				}
+				RTLIL::SigSpec lhs = read_sigspec();
+				RTLIL::SigSpec rhs = read_sigspec();
+				rule->actions.push_back(RTLIL::SigSig(lhs, rhs));
+				expect_eol();
+			}
+		}
+	}
+
+	void parse_module()
+	{
+		RTLIL::IdString name = read_id();
+		expect_eol();
+
+		if (design->has(name))
+			error(stringf("ilang error: redefinition of module %s.", name.c_str()));
+
+		module = new RTLIL::Module;
+		module->name = name;
+		module->attributes.swap(attrbuf);
+		attrbuf.clear();
+		design->add(module);
+
+		while (1)
+		{
+			switch (read_keyword())
+			{
+			case KW_ATTRIBUTE:
+				parse_attr_stmt();
+				break;
+			case KW_WIRE:
+				parse_wire_stmt();
+				break;
+			case KW_MEMORY:
+				parse_memory_stmt();
+				break;
+			case KW_CELL:
+				parse_cell_stmt();
+				break;
+			case KW_PROCESS:
+				parse_process_stmt();
+				break;
+			case KW_CONNECT: {
+				check_dangling_attr();
+				RTLIL::SigSpec lhs = read_sigspec();
+				RTLIL::SigSpec rhs = read_sigspec();
+				module->connect(lhs, rhs);
+				expect_eol();
+				break;
+			}
+			case KW_END:
+				check_dangling_attr();
+				module->fixup_ports();
+				expect_eol();
+				module = nullptr;
+				return;
+			default:
+				error("syntax error");
+			}
+		}
+	}
+
+	void parse_design()
+	{
+		attrbuf.clear();
+		skip_eols();
+
+		while (ptr != end)
+		{
+			switch (read_keyword())
+			{
+			case KW_MODULE:
+				parse_module();
+				break;
+			case KW_ATTRIBUTE:
+				parse_attr_stmt();
+				break;
+			case KW_AUTOIDX:
+				autoidx = max(autoidx, read_int());
+				expect_eol();
+				break;
+			default:
+				error("syntax error");
+			}
+		}
+
+		check_dangling_attr();
+	}
+};
+
+} /* namespace */
+
+void ILANG_FRONTEND::fast_parse(RTLIL::Design *design, const char *data, size_t size)
+{
+	IlangFastParser parser(design, data, size);
+	parser.parse_design();
+}
+
+YOSYS_NAMESPACE_END
@@ -39,18 +39,43 @@ struct IlangFrontend : public Frontend {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    read_ilang [filename]\n");
+		log("    read_ilang [options] [filename]\n");
 		log("\n");
 		log("Load modules from an ilang file to the current design. (ilang is a text\n");
 		log("representation of a design in yosys's internal format.)\n");
 		log("\n");
+		log("    -fast\n");
+		log("        use the hand-written parser instead of the flex/bison parser. It maps\n");
+		log("        the file into memory (or reads it completely, e.g. for compressed\n");
+		log("        files or stdin) and tokenizes it in place, which is considerably\n");
+		log("        faster for large files. This will become the default once it has\n");
+		log("        been proven equivalent to the old parser.\n");
+		log("\n");
 	}
 	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
 	{
+		bool flag_fast = false;
+
 		log_header("Executing ILANG frontend.\n");
-		extra_args(f, filename, args, 1);
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			std::string arg = args[argidx];
+			if (arg == "-fast") {
+				flag_fast = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(f, filename, args, argidx);
 		log("Input filename: %s\n", filename.c_str());
 
+		if (flag_fast) {
+			MappedFile file(*f, filename);
+			ILANG_FRONTEND::fast_parse(design, file.data, file.size);
+			return;
+		}
+
 		ILANG_FRONTEND::lexin = f;
 		ILANG_FRONTEND::current_design = design;
 		rtlil_frontend_ilang_yydebug = false;
@@ -32,6 +32,7 @@ YOSYS_NAMESPACE_BEGIN
 namespace ILANG_FRONTEND {
 	extern std::istream *lexin;
 	extern RTLIL::Design *current_design;
+	void fast_parse(RTLIL::Design *design, const char *data, size_t size);
 }
 
 YOSYS_NAMESPACE_END
@@ -0,0 +1,580 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  The frontend for the JSON netlist format written by 'write_json'.
+ *  See 'help write_json' for a description of the format.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// Bit ids as used in the JSON <bit_vector> values. Constant bits are mapped
+// to negative numbers, signal bits are the (non-negative) ids from the file.
+enum {
+	JSON_BIT_0 = -1,
+	JSON_BIT_1 = -2,
+	JSON_BIT_X = -3,
+	JSON_BIT_Z = -4
+};
+
+// The parser reads the file in blocks and walks over it in a single pass
+// without building a document tree. Only the cell connections need to be
+// kept until the "netnames" section is reached, because the wires are
+// created from that section.
+
+struct JsonParser
+{
+	std::istream &f;
+	RTLIL::Design *design;
+
+	std::vector<char> buffer;
+	const char *ptr, *end;
+	int line_count;
+
+	// the largest <num> of the "$...$<num>" names, so that NEW_ID does not
+	// create the names of imported objects again
+	int maxnum;
+
+	std::string key, str;
+
+	struct json_port_t {
+		IdString name;
+		bool input, output;
+		std::vector<int> bits;
+	};
+
+	struct json_cell_t {
+		Cell *cell;
+		std::vector<std::pair<IdString, std::vector<int>>> connections;
+	};
+
+	JsonParser(std::istream &f, RTLIL::Design *design) : f(f), design(design), buffer(1 << 16), ptr(nullptr), end(nullptr), line_count(1), maxnum(0) { }
+
+	IdString import_id(const std::string &name)
+	{
+		size_t pos = name.rfind('$');
+		if (name[0] == '$' && pos != 0 && pos+1 < name.size() && name.find_first_not_of("0123456789", pos+1) == std::string::npos)
+			maxnum = std::max(maxnum, atoi(name.substr(pos+1, 9).c_str()));
+		return RTLIL::escape_id(name);
+	}
+
+	void syntax_error(const char *msg)
+	{
+		log_error("JSON syntax error in line %d: %s\n", line_count, msg);
+	}
+
+	bool fill()
+	{
+		f.read(buffer.data(), buffer.size());
+		ptr = buffer.data();
+		end = ptr + f.gcount();
+		return ptr != end;
+	}
+
+	int peek()
+	{
+		if (ptr == end && !fill())
+			return EOF;
+		return (unsigned char)*ptr;
+	}
+
+	int next()
+	{
+		if (ptr == end && !fill())
+			return EOF;
+		return (unsigned char)*(ptr++);
+	}
+
+	void skip_space()
+	{
+		while (1) {
+			while (ptr != end && (*ptr == ' ' || *ptr == '\n' || *ptr == '\t' || *ptr == '\r'))
+				if (*(ptr++) == '\n')
+					line_count++;
+			if (ptr != end || !fill())
+				break;
+		}
+	}
+
+	void skip_space_and_comments()
+	{
+		// write_json -aig adds C-style comments to the models section
+		while (skip_space(), peek() == '/') {
+			ptr++;
+			if (next() != '*')
+				syntax_error("unexpected '/'.");
+			while (1) {
+				int ch = next();
+				if (ch == EOF)
+					syntax_error("unterminated comment.");
+				if (ch == '\n')
+					line_count++;
+				if (ch == '*' && peek() == '/') {
+					ptr++;
+					break;
+				}
+			}
+		}
+	}
+
+	void expect(char ch)
+	{
+		skip_space_and_comments();
+		if (next() != ch) {
+			char msg[] = "expected 'x'.";
+			msg[10] = ch;
+			syntax_error(msg);
+		}
+	}
+
+	void parse_string(std::string &s)
+	{
+		expect('"');
+		s.clear();
+		while (1)
+		{
+			// copy unescaped runs directly from the read buffer
+			const char *p = ptr;
+			while (p != end && *p != '"' && *p != '\\' && *p != '\n')
+				p++;
+			s.append(ptr, p);
+			ptr = p;
+
+			int ch = next();
+			if (ch == '"')
+				return;
+			if (ch == EOF || ch == '\n')
+				syntax_error("unterminated string.");
+			if (ch != '\\') {
+				s += ch;
+				continue;
+			}
+
+			switch (ch = next())
+			{
+			case '"': case '\\': case '/':
+				s += ch;
+				break;
+			case 'b': s += '\b'; break;
+			case 'f': s += '\f'; break;
+			case 'n': s += '\n'; break;
+			case 'r': s += '\r'; break;
+			case 't': s += '\t'; break;
+			case 'u': {
+				int code = 0;
+				for (int i = 0; i < 4; i++) {
+					ch = next();
+					code <<= 4;
+					if ('0' <= ch && ch <= '9')
+						code |= ch - '0';
+					else if ('a' <= ch && ch <= 'f')
+						code |= ch - 'a' + 10;
+					else if ('A' <= ch && ch <= 'F')
+						code |= ch - 'A' + 10;
+					else
+						syntax_error("invalid \\u escape sequence.");
+				}
+				if (code < 0x80) {
+					s += code;
+				} else if (code < 0x800) {
+					s += 0xc0 | (code >> 6);
+					s += 0x80 | (code & 0x3f);
+				} else {
+					s += 0xe0 | (code >> 12);
+					s += 0x80 | ((code >> 6) & 0x3f);
+					s += 0x80 | (code & 0x3f);
+				}
+				break;
+			}
+			default:
+				syntax_error("invalid escape sequence.");
+			}
+		}
+	}
+
+	int parse_int()
+	{
+		skip_space_and_comments();
+		bool negative = false;
+		if (peek() == '-') {
+			negative = true;
+			ptr++;
+		}
+		int ch = peek();
+		if (ch < '0' || ch > '9')
+			syntax_error("expected number.");
+		long long value = 0;
+		while (1) {
+			while (ptr != end && '0' <= *ptr && *ptr <= '9') {
+				value = value*10 + (*(ptr++) - '0');
+				if (value > (1LL << 32))
+					syntax_error("number out of range.");
+			}
+			if ((ch = peek()) < '0' || ch > '9')
+				break;
+		}
+		if (ch == '.' || ch == 'e' || ch == 'E')
+			syntax_error("non-integer numbers are not supported.");
+		return negative ? -value : value;
+	}
+
+	// Iterate over the members of an object. Call with first=true, returns
+	// false after the closing brace and leaves the member name in 'key'.
+	bool next_member(bool &first)
+	{
+		if (first)
+			expect('{');
+		skip_space_and_comments();
+		if (peek() == '}') {
+			ptr++;
+			return false;
+		}
+		if (!first)
+			expect(',');
+		first = false;
+		parse_string(key);
+		expect(':');
+		return true;
+	}
+
+	bool next_element(bool &first)
+	{
+		if (first)
+			expect('[');
+		skip_space_and_comments();
+		if (peek() == ']') {
+			ptr++;
+			return false;
+		}
+		if (!first)
+			expect(',');
+		first = false;
+		return true;
+	}
+
+	void skip_value()
+	{
+		skip_space_and_comments();
+		int ch = peek();
+		if (ch == '{') {
+			bool first = true;
+			while (next_member(first))
+				skip_value();
+		} else if (ch == '[') {
+			bool first = true;
+			while (next_element(first))
+				skip_value();
+		} else if (ch == '"') {
+			parse_string(str);
+		} else if (ch == '-' || ('0' <= ch && ch <= '9')) {
+			do ptr++; while ((ch = peek()) != EOF && (('0' <= ch && ch <= '9') || ch == '.' || ch == 'e' || ch == 'E' || ch == '+' || ch == '-'));
+		} else if (ch == 't' || ch == 'f' || ch == 'n') {
+			while ((ch = peek()) != EOF && 'a' <= ch && ch <= 'z')
+				ptr++;
+		} else
+			syntax_error("unexpected character.");
+	}
+
+	void parse_bits(std::vector<int> &bits)
+	{
+		bits.clear();
+		bool first = true;
+		while (next_element(first))
+		{
+			skip_space_and_comments();
+			if (peek() != '"') {
+				int id = parse_int();
+				if (id < 0)
+					syntax_error("negative bit id.");
+				bits.push_back(id);
+				continue;
+			}
+
+			parse_string(str);
+			if (str == "0")
+				bits.push_back(JSON_BIT_0);
+			else if (str == "1")
+				bits.push_back(JSON_BIT_1);
+			else if (str == "x")
+				bits.push_back(JSON_BIT_X);
+			else if (str == "z")
+				bits.push_back(JSON_BIT_Z);
+			else {
+				// "<first>:<last>" runs as written by write_json -compact
+				int range_first, range_last;
+				char dummy;
+				if (sscanf(str.c_str(), "%d:%d%c", &range_first, &range_last, &dummy) != 2 || range_first < 0 || range_last < range_first)
+					syntax_error("invalid bit value.");
+				for (int id = range_first; id <= range_last; id++)
+					bits.push_back(id);
+			}
+		}
+	}
+
+	Const parse_const()
+	{
+		skip_space_and_comments();
+		if (peek() != '"')
+			return Const(parse_int(), 32);
+
+		// write_json writes parameters with more than 32 bits as bit strings
+		parse_string(str);
+		bool is_bits = !str.empty();
+		for (char c : str)
+			if (c != '0' && c != '1' && c != 'x' && c != 'z')
+				is_bits = false;
+		if (!is_bits)
+			return Const(str);
+
+		Const value;
+		value.bits.reserve(GetSize(str));
+		for (auto it = str.rbegin(); it != str.rend(); it++)
+			value.bits.push_back(*it == '0' ? State::S0 : *it == '1' ? State::S1 : *it == 'x' ? State::Sx : State::Sz);
+		return value;
+	}
+
+	void parse_params(dict<IdString, Const> &params)
+	{
+		bool first = true;
+		while (next_member(first)) {
+			IdString name = RTLIL::escape_id(key);
+			params[name] = parse_const();
+		}
+	}
+
+	void parse_port(json_port_t &port)
+	{
+		port.input = port.output = false;
+		port.bits.clear();
+
+		bool first = true;
+		while (next_member(first)) {
+			if (key == "direction") {
+				parse_string(str);
+				if (str == "input" || str == "inout")
+					port.input = true;
+				if (str == "output" || str == "inout")
+					port.output = true;
+				if (!port.input && !port.output)
+					syntax_error("invalid port direction.");
+			} else if (key == "bits") {
+				parse_bits(port.bits);
+			} else
+				skip_value();
+		}
+	}
+
+	void parse_cell(Module *module, json_cell_t &json_cell, IdString cell_name)
+	{
+		IdString cell_type;
+		dict<IdString, Const> parameters, attributes;
+
+		bool first = true;
+		while (next_member(first)) {
+			if (key == "type") {
+				parse_string(str);
+				cell_type = RTLIL::escape_id(str);
+			} else if (key == "parameters") {
+				parse_params(parameters);
+			} else if (key == "attributes") {
+				parse_params(attributes);
+			} else if (key == "connections") {
+				bool first2 = true;
+				while (next_member(first2)) {
+					json_cell.connections.push_back(std::pair<IdString, std::vector<int>>(RTLIL::escape_id(key), std::vector<int>()));
+					parse_bits(json_cell.connections.back().second);
+				}
+			} else
+				skip_value();
+		}
+
+		if (cell_type.empty())
+			log_error("JSON error in line %d: cell %s has no type.\n", line_count, log_id(cell_name));
+
+		json_cell.cell = module->addCell(cell_name, cell_type);
+		json_cell.cell->parameters.swap(parameters);
+		json_cell.cell->attributes.swap(attributes);
+	}
+
+	void parse_module()
+	{
+		IdString module_name = RTLIL::escape_id(key);
+		if (design->module(module_name))
+			log_error("JSON error in line %d: redefinition of module %s.\n", line_count, log_id(module_name));
+
+		Module *module = new Module;
+		module->name = module_name;
+		design->add(module);
+
+		std::vector<json_port_t> ports;
+		std::vector<json_cell_t> cells;
+		std::vector<SigBit> id_bits;
+		std::vector<int> bits;
+
+		auto get_bit = [&](int id) -> SigBit {
+			switch (id) {
+				case JSON_BIT_0: return State::S0;
+				case JSON_BIT_1: return State::S1;
+				case JSON_BIT_X: return State::Sx;
+				case JSON_BIT_Z: return State::Sz;
+			}
+			if (id >= GetSize(id_bits))
+				id_bits.resize(id+1);
+			if (id_bits[id].wire == nullptr)
+				id_bits[id] = module->addWire(NEW_ID);
+			return id_bits[id];
+		};
+
+		auto add_wire = [&](IdString name, const std::vector<int> &wire_bits) -> Wire* {
+			Wire *wire = module->addWire(name, GetSize(wire_bits));
+			for (int i = 0; i < GetSize(wire_bits); i++) {
+				int id = wire_bits[i];
+				if (id >= 0 && (id >= GetSize(id_bits) || id_bits[id].wire == nullptr)) {
+					if (id >= GetSize(id_bits))
+						id_bits.resize(id+1);
+					id_bits[id] = SigBit(wire, i);
+				} else
+					module->connect(SigBit(wire, i), get_bit(id));
+			}
+			return wire;
+		};
+
+		bool first = true;
+		while (next_member(first))
+		{
+			if (key == "ports") {
+				bool first2 = true;
+				while (next_member(first2)) {
+					ports.push_back(json_port_t());
+					ports.back().name = RTLIL::escape_id(key);
+					parse_port(ports.back());
+				}
+			} else if (key == "cells") {
+				bool first2 = true;
+				while (next_member(first2)) {
+					IdString cell_name = import_id(key);
+					if (module->cell(cell_name))
+						log_error("JSON error in line %d: redefinition of cell %s.\n", line_count, log_id(cell_name));
+					cells.push_back(json_cell_t());
+					parse_cell(module, cells.back(), cell_name);
+				}
+			} else if (key == "netnames") {
+				bool first2 = true;
+				while (next_member(first2)) {
+					IdString wire_name = import_id(key);
+					if (module->wire(wire_name))
+						log_error("JSON error in line %d: redefinition of wire %s.\n", line_count, log_id(wire_name));
+					dict<IdString, Const> attributes;
+					bits.clear();
+					bool first3 = true;
+					while (next_member(first3)) {
+						if (key == "bits")
+							parse_bits(bits);
+						else if (key == "attributes")
+							parse_params(attributes);
+						else
+							skip_value();
+					}
+					Wire *wire = add_wire(wire_name, bits);
+					wire->attributes.swap(attributes);
+				}
+			} else
+				skip_value();
+		}
+
+		// ports that are not listed under "netnames" (e.g. created with "json"
+		// on a partial selection) get their wire from the "ports" section
+		int port_id = 1;
+		for (auto &port : ports) {
+			Wire *wire = module->wire(port.name);
+			if (wire == nullptr)
+				wire = add_wire(port.name, port.bits);
+			else if (GetSize(wire) != GetSize(port.bits))
+				log_error("JSON error: port %s has a different width than the net with the same name.\n", log_id(port.name));
+			wire->port_id = port_id++;
+			wire->port_input = port.input;
+			wire->port_output = port.output;
+		}
+
+		std::vector<SigBit> sig_bits;
+		for (auto &json_cell : cells)
+			for (auto &conn : json_cell.connections) {
+				sig_bits.clear();
+				for (int id : conn.second)
+					sig_bits.push_back(get_bit(id));
+				json_cell.cell->setPort(conn.first, sig_bits);
+			}
+
+		module->fixup_ports();
+	}
+
+	void parse_design()
+	{
+		bool first = true;
+		while (next_member(first)) {
+			if (key == "modules") {
+				bool first2 = true;
+				while (next_member(first2))
+					parse_module();
+			} else
+				skip_value();
+		}
+
+		skip_space_and_comments();
+		if (peek() != EOF)
+			syntax_error("garbage at end of file.");
+
+		autoidx = std::max(autoidx, maxnum+1);
+	}
+};
+
+struct JsonFrontend : public Frontend {
+	JsonFrontend() : Frontend("json", "read JSON file") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_json [filename]\n");
+		log("\n");
+		log("Load modules from a JSON file (as written by 'write_json') into the current\n");
+		log("design. Both the regular and the -compact form of the format are supported.\n");
+		log("See 'help write_json' for a description of the format.\n");
+		log("\n");
+		log("Each entry in \"netnames\" becomes a wire. Bits that are shared between several\n");
+		log("nets are connected, bits that are only used by cell ports get a new internal\n");
+		log("wire. Integer parameters and attributes are read as 32 bit values, strings that\n");
+		log("only contain the characters 0, 1, x and z are read as bit vectors. The \"models\"\n");
+		log("section and unknown fields are ignored.\n");
+		log("\n");
+	}
+	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing JSON frontend.\n");
+		extra_args(f, filename, args, 1);
+		log("Input filename: %s\n", filename.c_str());
+
+		JsonParser parser(*f, design);
+		parser.parse_design();
+	}
+} JsonFrontend;
+
+PRIVATE_NAMESPACE_END
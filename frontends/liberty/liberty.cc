@@ -412,7 +412,9 @@ struct LibertyFrontend : public Frontend {
 		log("Read cells from liberty file as modules into current design.\n");
 		log("\n");
 		log("    -lib\n");
-		log("        only create empty blackbox modules\n");
+		log("        only create empty blackbox modules. only the cell, pin and bus groups\n");
+		log("        and the pin directions are read from the file, everything else is\n");
+		log("        skipped. with this option bus pins are imported as vector ports.\n");
 		log("\n");
 		log("    -ignore_redef\n");
 		log("        ignore re-definitions of modules. (the default behavior is to\n");
@@ -466,10 +468,52 @@ struct LibertyFrontend : public Frontend {
 		}
 		extra_args(f, filename, args, argidx);
 
-		LibertyParser parser(*f);
+		// plain files are shared with other passes through the liberty cache,
+		// for other input only the parts of the library used below are parsed
+		std::set<std::string> filter = { "cell", "pin", "direction", "function", "ff", "latch",
+				"clocked_on", "next_state", "enable", "data_in", "clear", "preset" };
+		// blackboxes only need the port lists, which are cheap enough to parse
+		// that it's not worth keeping them in the cache
+		std::set<std::string> lib_filter = { "cell", "pin", "bus", "direction", "type", "bus_type",
+				"bit_width", "bit_from", "bit_to" };
+		std::unique_ptr<LibertyParser> parser;
+		LibertyAst *ast;
+
+		if (flag_lib) {
+			if (dynamic_cast<std::ifstream*>(f) != nullptr)
+				parser.reset(new LibertyParser(filename, &lib_filter));
+			else
+				parser.reset(new LibertyParser(*f, &lib_filter));
+			ast = parser->ast;
+			if (ast == NULL)
+				log_error("Liberty input `%s' is empty.\n", filename.c_str());
+		} else if (dynamic_cast<std::ifstream*>(f) != nullptr) {
+			ast = LibertyCache::get(filename);
+		} else {
+			parser.reset(new LibertyParser(*f, &filter));
+			ast = parser->ast;
+			if (ast == NULL)
+				log_error("Liberty input `%s' is empty.\n", filename.c_str());
+		}
+
+		// bus types: the bit numbers of the first and last bit
+		dict<std::string, std::pair<int, int>> bus_types;
+
+		if (flag_lib)
+			for (auto node : ast->children)
+				if (node->id == "type" && node->args.size() == 1) {
+					LibertyAst *from = node->find("bit_from");
+					LibertyAst *to = node->find("bit_to");
+					LibertyAst *width = node->find("bit_width");
+					if (from && to)
+						bus_types[node->args.at(0)] = std::make_pair(atoi(from->value.c_str()), atoi(to->value.c_str()));
+					else if (width)
+						bus_types[node->args.at(0)] = std::make_pair(atoi(width->value.c_str())-1, 0);
+				}
+
 		int cell_count = 0;
 
-		for (auto cell : parser.ast->children)
+		for (auto cell : ast->children)
 		{
 			if (cell->id != "cell" || cell->args.size() != 1)
 				continue;
@@ -494,7 +538,7 @@ struct LibertyFrontend : public Frontend {
 				module->attributes[attr] = 1;
 
 			for (auto node : cell->children)
-				if (node->id == "pin" && node->args.size() == 1) {
+				if ((node->id == "pin" || (flag_lib && node->id == "bus")) && node->args.size() == 1) {
 					LibertyAst *dir = node->find("direction");
 					if (!dir || (dir->value != "input" && dir->value != "output" && dir->value != "inout" && dir->value != "internal"))
 					{
@@ -507,8 +551,18 @@ struct LibertyFrontend : public Frontend {
 							goto skip_cell;
 						}
 					}
-					if (!flag_lib || dir->value != "internal")
-						module->addWire(RTLIL::escape_id(node->args.at(0)));
+					if (flag_lib && dir->value == "internal")
+						continue;
+					RTLIL::Wire *wire = module->addWire(RTLIL::escape_id(node->args.at(0)));
+					if (node->id == "bus") {
+						LibertyAst *type = node->find("bus_type");
+						if (!type || bus_types.count(type->value) == 0)
+							log_error("Missing or unknown bus type for bus %s of cell %s.\n", node->args.at(0).c_str(), log_id(module->name));
+						auto &range = bus_types.at(type->value);
+						wire->width = abs(range.first - range.second) + 1;
+						wire->start_offset = std::min(range.first, range.second);
+						wire->upto = range.first < range.second;
+					}
 				}
 
 			for (auto node : cell->children)
@@ -520,7 +574,7 @@ struct LibertyFrontend : public Frontend {
 						create_latch(module, node);
 				}
 
-				if (node->id == "pin" && node->args.size() == 1)
+				if ((node->id == "pin" || (flag_lib && node->id == "bus")) && node->args.size() == 1)
 				{
 					LibertyAst *dir = node->find("direction");
 
@@ -0,0 +1,312 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  The frontend for the binary RTLIL format written by 'write_rtlil_bin'.
+ *  See backends/rtlil_bin/rtlil_bin.h for a description of the format.
+ *
+ */
+
+#include "backends/rtlil_bin/rtlil_bin.h"
+#include "kernel/register.h"
+
+#include <limits.h>
+
+USING_YOSYS_NAMESPACE
+using namespace RTLIL_BIN;
+PRIVATE_NAMESPACE_BEGIN
+
+struct RtlilBinParser
+{
+	RTLIL::Design *design;
+	Reader rd;
+	std::vector<RTLIL::IdString> strings;
+	std::vector<RTLIL::Wire*> wires;
+
+	RtlilBinParser(RTLIL::Design *design, const char *data, size_t size) : design(design), rd(data, size) { }
+
+	int read_count() {
+		uint64_t value = rd.read_uint();
+		if (value > uint64_t(rd.end - rd.ptr) * 8 + 8)
+			log_error("Invalid element count in binary RTLIL data.\n");
+		return value;
+	}
+
+	int read_size(const char *what) {
+		uint64_t value = rd.read_uint();
+		if (value > uint64_t(INT_MAX))
+			log_error("Invalid %s in binary RTLIL data.\n", what);
+		return value;
+	}
+
+	int read_offset(const char *what) {
+		int64_t value = rd.read_int();
+		if (value < INT_MIN || value > INT_MAX)
+			log_error("Invalid %s in binary RTLIL data.\n", what);
+		return value;
+	}
+
+	RTLIL::IdString read_id() {
+		uint64_t idx = rd.read_uint();
+		if (idx >= strings.size())
+			log_error("Invalid string index in binary RTLIL data.\n");
+		return strings[idx];
+	}
+
+	void read_bits(std::vector<RTLIL::State> &bits) {
+		int n = read_count();
+		const unsigned char *p = (const unsigned char*)rd.read_bytes((n+1) / 2);
+		bits.resize(n);
+		for (int i = 0; i < n; i++) {
+			int bit = (p[i/2] >> (i % 2 ? 4 : 0)) & 15;
+			if (bit > RTLIL::State::Sm)
+				log_error("Invalid constant bit in binary RTLIL data.\n");
+			bits[i] = RTLIL::State(bit);
+		}
+	}
+
+	RTLIL::Const read_const() {
+		RTLIL::Const value;
+		value.flags = rd.read_uint();
+		read_bits(value.bits);
+		return value;
+	}
+
+	RTLIL::SigSpec read_sigspec() {
+		RTLIL::SigSpec sig;
+		int n = read_count();
+		for (int i = 0; i < n; i++) {
+			uint64_t idx = rd.read_uint();
+			if (idx == 0) {
+				RTLIL::Const value;
+				read_bits(value.bits);
+				sig.append(RTLIL::SigSpec(value));
+			} else {
+				if (idx > wires.size())
+					log_error("Invalid wire index in binary RTLIL data.\n");
+				RTLIL::Wire *wire = wires[idx-1];
+				int offset = read_size("wire offset");
+				int width = read_size("wire chunk width");
+				if (int64_t(offset) + width > wire->width)
+					log_error("Out of range reference to wire %s in binary RTLIL data.\n", log_id(wire));
+				sig.append(RTLIL::SigSpec(wire, offset, width));
+			}
+		}
+		return sig;
+	}
+
+	void read_sigsig_list(std::vector<RTLIL::SigSig> &list) {
+		int n = read_count();
+		list.reserve(list.size() + n);
+		for (int i = 0; i < n; i++) {
+			RTLIL::SigSpec first = read_sigspec();
+			RTLIL::SigSpec second = read_sigspec();
+			list.push_back(RTLIL::SigSig(first, second));
+		}
+	}
+
+	void read_attributes(RTLIL::AttrObject *obj) {
+		int n = read_count();
+		for (int i = 0; i < n; i++) {
+			RTLIL::IdString id = read_id();
+			obj->attributes[id] = read_const();
+		}
+	}
+
+	void read_case(RTLIL::CaseRule *cs) {
+		int n = read_count();
+		for (int i = 0; i < n; i++)
+			cs->compare.push_back(read_sigspec());
+		read_sigsig_list(cs->actions);
+		n = read_count();
+		for (int i = 0; i < n; i++) {
+			RTLIL::SwitchRule *sw = new RTLIL::SwitchRule;
+			cs->switches.push_back(sw);
+			read_attributes(sw);
+			sw->signal = read_sigspec();
+			int m = read_count();
+			for (int j = 0; j < m; j++) {
+				RTLIL::CaseRule *c = new RTLIL::CaseRule;
+				sw->cases.push_back(c);
+				read_case(c);
+			}
+		}
+	}
+
+	void read_module()
+	{
+		RTLIL::IdString name = read_id();
+		if (design->module(name) != nullptr)
+			log_error("Binary RTLIL error: redefinition of module %s.\n", log_id(name));
+
+		RTLIL::Module *module = new RTLIL::Module;
+		module->name = name;
+		design->add(module);
+		read_attributes(module);
+
+		int n = read_count();
+		for (int i = 0; i < n; i++)
+			module->avail_parameters.insert(read_id());
+
+		wires.clear();
+		n = read_count();
+		wires.reserve(n);
+		for (int i = 0; i < n; i++) {
+			RTLIL::IdString wire_name = read_id();
+			if (module->wires_.count(wire_name))
+				log_error("Binary RTLIL error: redefinition of wire %s.\n", log_id(wire_name));
+			RTLIL::Wire *wire = module->addWire(wire_name);
+			wire->width = read_size("wire width");
+			wire->start_offset = read_offset("wire start offset");
+			wire->port_id = read_size("port index");
+			int flags = rd.read_uint();
+			wire->port_input = (flags & WIRE_INPUT) != 0;
+			wire->port_output = (flags & WIRE_OUTPUT) != 0;
+			wire->upto = (flags & WIRE_UPTO) != 0;
+			read_attributes(wire);
+			wires.push_back(wire);
+		}
+
+		n = read_count();
+		for (int i = 0; i < n; i++) {
+			RTLIL::Memory *memory = new RTLIL::Memory;
+			memory->name = read_id();
+			if (module->memories.count(memory->name))
+				log_error("Binary RTLIL error: redefinition of memory %s.\n", log_id(memory->name));
+			module->memories[memory->name] = memory;
+			memory->width = read_size("memory width");
+			memory->start_offset = read_offset("memory start offset");
+			memory->size = read_size("memory size");
+			read_attributes(memory);
+		}
+
+		n = read_count();
+		for (int i = 0; i < n; i++) {
+			RTLIL::IdString cell_name = read_id();
+			RTLIL::IdString cell_type = read_id();
+			if (module->cells_.count(cell_name))
+				log_error("Binary RTLIL error: redefinition of cell %s.\n", log_id(cell_name));
+			RTLIL::Cell *cell = module->addCell(cell_name, cell_type);
+			int m = read_count();
+			for (int j = 0; j < m; j++) {
+				RTLIL::IdString id = read_id();
+				cell->parameters[id] = read_const();
+			}
+			m = read_count();
+			for (int j = 0; j < m; j++) {
+				RTLIL::IdString id = read_id();
+				cell->setPort(id, read_sigspec());
+			}
+			read_attributes(cell);
+		}
+
+		std::vector<RTLIL::SigSig> connections;
+		read_sigsig_list(connections);
+		for (auto &conn : connections) {
+			if (conn.first.size() != conn.second.size())
+				log_error("Binary RTLIL error: connection with different widths in module %s.\n", log_id(module));
+			module->connect(conn);
+		}
+
+		n = read_count();
+		for (int i = 0; i < n; i++) {
+			RTLIL::Process *proc = new RTLIL::Process;
+			proc->name = read_id();
+			if (module->processes.count(proc->name))
+				log_error("Binary RTLIL error: redefinition of process %s.\n", log_id(proc->name));
+			module->processes[proc->name] = proc;
+			read_attributes(proc);
+			read_case(&proc->root_case);
+			int m = read_count();
+			for (int j = 0; j < m; j++) {
+				RTLIL::SyncRule *sync = new RTLIL::SyncRule;
+				proc->syncs.push_back(sync);
+				uint64_t type = rd.read_uint();
+				if (type > RTLIL::SyncType::STi)
+					log_error("Invalid sync rule type in binary RTLIL data.\n");
+				sync->type = RTLIL::SyncType(type);
+				sync->signal = read_sigspec();
+				read_sigsig_list(sync->actions);
+			}
+		}
+
+		module->fixup_ports();
+	}
+
+	void read_design()
+	{
+		if (memcmp(rd.read_bytes(sizeof(magic)), magic, sizeof(magic)))
+			log_error("Input is not a binary RTLIL file.\n");
+
+		int file_version = rd.read_uint();
+		if (file_version != version)
+			log_error("Unsupported binary RTLIL version %d (expected %d).\n", file_version, version);
+
+		autoidx = max(autoidx, int(rd.read_uint()));
+
+		int n = read_count();
+		strings.reserve(n);
+		for (int i = 0; i < n; i++) {
+			int len = read_count();
+			std::string str(rd.read_bytes(len), len);
+			if (len != 0 && (len < 2 || (str[0] != '\\' && str[0] != '$') || str.find('\0') != std::string::npos))
+				log_error("Invalid identifier in binary RTLIL data.\n");
+			strings.push_back(RTLIL::IdString(str));
+		}
+
+		n = read_count();
+		for (int i = 0; i < n; i++) {
+			uint64_t size = rd.read_u64le();
+			rd.need(size);
+			const unsigned char *module_end = rd.ptr + size;
+			read_module();
+			if (rd.ptr != module_end)
+				log_error("Binary RTLIL error: module section has wrong size.\n");
+		}
+
+		if (rd.ptr != rd.end)
+			log_error("Binary RTLIL error: garbage at end of file.\n");
+	}
+};
+
+struct RtlilBinFrontend : public Frontend {
+	RtlilBinFrontend() : Frontend("rtlil_bin", "read modules from binary RTLIL file") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    read_rtlil_bin [filename]\n");
+		log("\n");
+		log("Load modules from a binary RTLIL file (as written by 'write_rtlil_bin') to the\n");
+		log("current design.\n");
+		log("\n");
+	}
+	virtual void execute(std::istream *&f, std::string filename, std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing RTLIL_BIN frontend.\n");
+		extra_args(f, filename, args, 1);
+		log("Input filename: %s\n", filename.c_str());
+
+		std::string data((std::istreambuf_iterator<char>(*f)), std::istreambuf_iterator<char>());
+
+		RtlilBinParser parser(design, data.data(), data.size());
+		parser.read_design();
+	}
+} RtlilBinFrontend;
+
+PRIVATE_NAMESPACE_END
@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
+#include "backends/ilang/ilang_backend.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -27,6 +28,7 @@
 #ifndef _WIN32
 #  include <unistd.h>
 #  include <dirent.h>
+#  include <sys/wait.h>
 #endif
 
 USING_YOSYS_NAMESPACE
@@ -521,16 +523,21 @@ static bool import_netlist_instance_cells(RTLIL::Module *module, std::map<Net*,
 	return false;
 }
 
+// modules that were imported by the worker processes of the current 'verific -import'
+static pool<RTLIL::IdString> parallel_imported_modules;
+
 static void import_netlist(RTLIL::Design *design, Netlist *nl, std::set<Netlist*> &nl_todo, bool mode_gates)
 {
 	std::string module_name = nl->IsOperator() ? std::string("$verific$") + nl->Owner()->Name() : RTLIL::escape_id(nl->Owner()->Name());
 
 	if (design->has(module_name)) {
-		if (!nl->IsOperator())
+		if (!nl->IsOperator() && !parallel_imported_modules.count(module_name))
 			log_cmd_error("Re-definition of module `%s'.\n", nl->Owner()->Name());
 		return;
 	}
 
+	int64_t start_time = PerformanceTimer::query();
+
 	RTLIL::Module *module = new RTLIL::Module;
 	module->name = module_name;
 	design->add(module);
@@ -816,8 +823,141 @@ static void import_netlist(RTLIL::Design *design, Netlist *nl, std::set<Netlist*
 			cell->setPort(it.first, it.second);
 		}
 	}
+
+	log("  Imported %d wires and %d cells in %.2f seconds.\n", GetSize(module->wires_), GetSize(module->cells_),
+			(PerformanceTimer::query() - start_time) * 1e-9);
+}
+
+// import the netlist and everything instantiated in it that is not in nl_done yet
+static void import_hierarchy(RTLIL::Design *design, Netlist *top_nl, std::set<Netlist*> &nl_done, bool mode_gates)
+{
+	std::set<Netlist*> nl_todo;
+	nl_todo.insert(top_nl);
+
+	while (!nl_todo.empty()) {
+		Netlist *nl = *nl_todo.begin();
+		if (nl_done.count(nl) == 0)
+			import_netlist(design, nl, nl_todo, mode_gates);
+		nl_todo.erase(nl);
+		nl_done.insert(nl);
+	}
 }
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+// Neither Verific nor RTLIL can be used from multiple threads, but after the
+// elaboration each forked worker process can walk its own copy of the Verific
+// netlists. The workers import the hierarchies of every num_workers-th top
+// module into a staging design that is passed back as an ilang file, together
+// with the log output of the worker. The staged modules are then added to the
+// design in the order of the workers. Modules instantiated from the hierarchies
+// of several workers are only added once. The top modules of workers that
+// failed are left in top_nls and are imported serially afterwards, which also
+// reproduces the error message.
+static void parallel_import(RTLIL::Design *design, std::vector<Netlist*> &top_nls, bool mode_gates, int num_jobs)
+{
+	int num_workers = std::min(num_jobs, GetSize(top_nls));
+	if (num_workers < 2)
+		return;
+
+	log("Importing %d top modules using %d worker processes.\n", GetSize(top_nls), num_workers);
+
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-verific-XXXXXX");
+	std::vector<pid_t> worker_pids;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_files.clear();
+			log_streams.clear();
+			log_cmd_error_throw = true;
+
+			FILE *worker_log = fopen(stringf("%s/worker_%d.log", tempdir_name.c_str(), w).c_str(), "w");
+			if (worker_log != NULL)
+				log_files.push_back(worker_log);
+
+			try {
+				RTLIL::Design *staging = new RTLIL::Design;
+				std::set<Netlist*> nl_done;
+				for (int i = w; i < GetSize(top_nls); i += num_workers)
+					import_hierarchy(staging, top_nls[i], nl_done, mode_gates);
+
+				std::string out_name = stringf("%s/worker_%d.il", tempdir_name.c_str(), w);
+				std::ofstream out(out_name + ".part");
+				ILANG_BACKEND::dump_design(out, staging, false);
+				out.close();
+				if (!out.fail())
+					rename((out_name + ".part").c_str(), out_name.c_str());
+			} catch (...) {
+			}
+
+			log_flush();
+			_exit(0);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	for (auto pid : worker_pids) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+	}
+
+	std::vector<Netlist*> remaining_top_nls;
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		std::string log_name = stringf("%s/worker_%d.log", tempdir_name.c_str(), w);
+		std::string il_name = stringf("%s/worker_%d.il", tempdir_name.c_str(), w);
+		std::ifstream f(il_name.c_str());
+
+		if (w >= GetSize(worker_pids) || f.fail()) {
+			for (int i = w; i < GetSize(top_nls); i += num_workers)
+				remaining_top_nls.push_back(top_nls[i]);
+			continue;
+		}
+
+		std::ifstream worker_log(log_name.c_str());
+		std::string line;
+		while (std::getline(worker_log, line))
+			log("%s\n", line.c_str());
+
+		RTLIL::Design *staging = new RTLIL::Design;
+		Frontend::frontend_call(staging, &f, il_name, "ilang");
+
+		std::vector<RTLIL::IdString> new_modules;
+		for (auto module : staging->modules()) {
+			if (design->has(module->name)) {
+				if (module->name.str().compare(0, 9, "$verific$") != 0 && !parallel_imported_modules.count(module->name))
+					log_cmd_error("Re-definition of module `%s'.\n", log_id(module->name));
+				continue;
+			}
+			new_modules.push_back(module->name);
+		}
+
+		for (auto name : new_modules) {
+			RTLIL::Module *module = staging->module(name);
+			staging->modules_.erase(name);
+			design->add(module);
+			parallel_imported_modules.insert(name);
+		}
+
+		delete staging;
+	}
+
+	remove_directory(tempdir_name);
+	top_nls.swap(remaining_top_nls);
+}
+#endif
+
 #endif /* YOSYS_ENABLE_VERIFIC */
 
 YOSYS_NAMESPACE_BEGIN
@@ -838,12 +978,16 @@ struct VerificPass : public Pass {
 		log("Load the specified VHDL files into Verific.\n");
 		log("\n");
 		log("\n");
-		log("    verific -import [-gates] {-all | <top-module>..}\n");
+		log("    verific -import [-gates] [-j <N>] {-all | <top-module>..}\n");
 		log("\n");
 		log("Elaborate the design for the specified top modules, import to Yosys and\n");
 		log("reset the internal state of Verific. A gate-level netlist is created\n");
 		log("when called with -gates.\n");
 		log("\n");
+		log("With -j the hierarchies of the top modules are imported by N worker\n");
+		log("processes in parallel. The default is the value given with 'yosys -j'.\n");
+		log("The time used for the import of each module is logged.\n");
+		log("\n");
 		log("Visit http://verific.com/ for more information on Verific.\n");
 		log("\n");
 	}
@@ -924,8 +1068,10 @@ struct VerificPass : public Pass {
 
 		if (args.size() > 1 && args[1] == "-import")
 		{
-			std::set<Netlist*> nl_todo, nl_done;
+			std::vector<Netlist*> top_nls;
+			std::set<Netlist*> nl_done;
 			bool mode_all = false, mode_gates = false;
+			int num_jobs = yosys_jobs;
 
 			size_t argidx = 2;
 			for (; argidx < args.size(); argidx++) {
@@ -937,6 +1083,10 @@ struct VerificPass : public Pass {
 					mode_gates = true;
 					continue;
 				}
+				if (args[argidx] == "-j" && argidx+1 < args.size()) {
+					num_jobs = atoi(args[++argidx].c_str());
+					continue;
+				}
 				break;
 			}
 
@@ -971,22 +1121,24 @@ struct VerificPass : public Pass {
 					log("Running veri_file::Elaborate(\"%s\").\n", args[argidx].c_str());
 					if (!veri_file::Elaborate(args[argidx].c_str()))
 						log_cmd_error("Elaboration of top module `%s' failed.\n", args[argidx].c_str());
-					nl_todo.insert(Netlist::PresentDesign());
 				} else {
 					log("Running vhdl_file::Elaborate(\"%s\").\n", args[argidx].c_str());
 					if (!vhdl_file::Elaborate(args[argidx].c_str()))
 						log_cmd_error("Elaboration of top module `%s' failed.\n", args[argidx].c_str());
-					nl_todo.insert(Netlist::PresentDesign());
 				}
+				Netlist *nl = Netlist::PresentDesign();
+				if (std::find(top_nls.begin(), top_nls.end(), nl) == top_nls.end())
+					top_nls.push_back(nl);
 			}
 
-			while (!nl_todo.empty()) {
-				Netlist *nl = *nl_todo.begin();
-				if (nl_done.count(nl) == 0)
-					import_netlist(design, nl, nl_todo, mode_gates);
-				nl_todo.erase(nl);
-				nl_done.insert(nl);
-			}
+			parallel_imported_modules.clear();
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+			parallel_import(design, top_nls, mode_gates, num_jobs);
+#endif
+
+			for (auto nl : top_nls)
+				import_hierarchy(design, nl, nl_done, mode_gates);
+			parallel_imported_modules.clear();
 
 			Libset::Reset();
 			return;
@@ -99,8 +99,23 @@ static void my_strtobin(std::vector<RTLIL::State> &data, const char *str, int le
 	data.clear();
 
 	if (base == 10) {
-		while (!digits.empty())
-			data.push_back(my_decimal_div_by_two(digits) ? RTLIL::S1 : RTLIL::S0);
+		uint64_t value = 0;
+		bool small_value = !digits.empty() && GetSize(digits) <= 18;
+		for (auto digit : digits)
+			if (digit < 10)
+				value = value * 10 + digit;
+			else
+				small_value = false;
+		if (small_value) {
+			// fast path for decimal numbers that fit in 64 bits
+			do {
+				data.push_back((value & 1) ? RTLIL::S1 : RTLIL::S0);
+				value = value >> 1;
+			} while (value != 0);
+		} else {
+			while (!digits.empty())
+				data.push_back(my_decimal_div_by_two(digits) ? RTLIL::S1 : RTLIL::S0);
+		}
 	} else {
 		int bits_per_digit = my_ilog2(base-1);
 		for (auto it = digits.rbegin(), e = digits.rend(); it != e; it++) {
@@ -146,6 +161,11 @@ static void my_strtobin(std::vector<RTLIL::State> &data, const char *str, int le
 			len_in_bits, len, current_filename.c_str(), get_line_num());
 }
 
+void VERILOG_FRONTEND::digits2bits(std::vector<RTLIL::State> &data, const char *str, int len_in_bits, int base)
+{
+	my_strtobin(data, str, len_in_bits, base, 0);
+}
+
 // convert the Verilog code for a constant to an AST node
 AstNode *VERILOG_FRONTEND::const2ast(std::string code, char case_type, bool warn_z)
 {
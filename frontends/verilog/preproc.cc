@@ -37,6 +37,7 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 YOSYS_NAMESPACE_BEGIN
 using namespace VERILOG_FRONTEND;
@@ -45,6 +46,18 @@ static std::list<std::string> output_code;
 static std::list<std::string> input_buffer;
 static size_t input_buffer_charp;
 
+// Include files are preprocessed on their own and the result is cached, together
+// with the define state before and after the include. A cached result is reused
+// when the file is unchanged and the define state before the include is the same.
+struct PreprocIncludeCacheEntry {
+	std::map<std::string, std::string> defines_before, defines_after;
+	std::set<std::string> with_args_before, with_args_after;
+	std::string output;
+};
+
+static dict<std::string, std::vector<PreprocIncludeCacheEntry>> include_cache;
+PreprocStats VERILOG_FRONTEND::preproc_stats;
+
 static void return_char(char ch)
 {
 	if (input_buffer_charp == 0)
@@ -210,6 +223,72 @@ static void input_file(std::istream &f, std::string filename)
 	input_buffer.insert(it, "\n`file_pop\n");
 }
 
+static void preproc_loop(std::string filename, std::map<std::string, std::string> &defines_map, std::set<std::string> &defines_with_args,
+		int &ifdef_fail_level, bool &in_elseif, const std::list<std::string> &include_dirs);
+
+static void include_file(std::istream &f, std::string fn, std::string path, std::string filename, std::map<std::string, std::string> &defines_map,
+		std::set<std::string> &defines_with_args, const std::list<std::string> &include_dirs)
+{
+	struct stat stbuf;
+	if (stat(path.c_str(), &stbuf) != 0) {
+		preproc_stats.include_uncached++;
+		input_file(f, fn);
+		return;
+	}
+
+	std::string key = stringf("%s:%lld:%lld:", path.c_str(), (long long)stbuf.st_mtime, (long long)stbuf.st_size) + fn;
+	// no references into include_cache are kept, nested includes may insert new entries
+	for (auto &entry : include_cache[key])
+		if (entry.defines_before == defines_map && entry.with_args_before == defines_with_args) {
+			preproc_stats.include_hits++;
+			output_code.push_back(entry.output);
+			defines_map = entry.defines_after;
+			defines_with_args = entry.with_args_after;
+			return;
+		}
+
+	PreprocIncludeCacheEntry entry;
+	entry.defines_before = defines_map;
+	entry.with_args_before = defines_with_args;
+
+	std::list<std::string> saved_output_code, saved_input_buffer;
+	size_t saved_input_buffer_charp = input_buffer_charp;
+	saved_output_code.swap(output_code);
+	saved_input_buffer.swap(input_buffer);
+	input_buffer_charp = 0;
+
+	int ifdef_fail_level = 0;
+	bool in_elseif = false;
+
+	input_file(f, fn);
+	preproc_loop(filename, defines_map, defines_with_args, ifdef_fail_level, in_elseif, include_dirs);
+
+	for (auto &str : output_code)
+		entry.output += str;
+
+	output_code.swap(saved_output_code);
+	input_buffer.swap(saved_input_buffer);
+	input_buffer_charp = saved_input_buffer_charp;
+
+	if (ifdef_fail_level != 0) {
+		// an `ifdef block that is not closed in the include file can't be processed
+		// on its own, so fall back to inserting the file into the input
+		preproc_stats.include_uncached++;
+		defines_map.swap(entry.defines_before);
+		defines_with_args.swap(entry.with_args_before);
+		f.clear();
+		f.seekg(0);
+		input_file(f, fn);
+		return;
+	}
+
+	preproc_stats.include_misses++;
+	output_code.push_back(entry.output);
+	entry.defines_after = defines_map;
+	entry.with_args_after = defines_with_args;
+	include_cache[key].push_back(entry);
+}
+
 std::string frontend_verilog_preproc(std::istream &f, std::string filename, const std::map<std::string, std::string> pre_defines_map, const std::list<std::string> include_dirs)
 {
 	std::set<std::string> defines_with_args;
@@ -225,6 +304,22 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 	defines_map["YOSYS"] = "1";
 	defines_map[formal_mode ? "FORMAL" : "SYNTHESIS"] = "1";
 
+	preproc_loop(filename, defines_map, defines_with_args, ifdef_fail_level, in_elseif, include_dirs);
+
+	std::string output;
+	for (auto &str : output_code)
+		output += str;
+
+	output_code.clear();
+	input_buffer.clear();
+	input_buffer_charp = 0;
+
+	return output;
+}
+
+static void preproc_loop(std::string filename, std::map<std::string, std::string> &defines_map, std::set<std::string> &defines_with_args,
+		int &ifdef_fail_level, bool &in_elseif, const std::list<std::string> &include_dirs)
+{
 	while (!input_buffer.empty())
 	{
 		std::string tok = next_token();
@@ -291,27 +386,30 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 					fn = fn.substr(0, pos) + fn.substr(pos+1);
 			}
 			std::ifstream ff;
+			std::string path = fn;
 			ff.clear();
-			ff.open(fn.c_str());
+			ff.open(path.c_str());
 			if (ff.fail() && fn.size() > 0 && fn[0] != '/' && filename.find('/') != std::string::npos) {
 				// if the include file was not found, it is not given with an absolute path, and the
 				// currently read file is given with a path, then try again relative to its directory
 				ff.clear();
-				ff.open(filename.substr(0, filename.rfind('/')+1) + fn);
+				path = filename.substr(0, filename.rfind('/')+1) + fn;
+				ff.open(path);
 			}
 			if (ff.fail() && fn.size() > 0 && fn[0] != '/') {
 				// if the include file was not found and it is not given with an absolute path, then
 				// search it in the include path
 				for (auto incdir : include_dirs) {
 					ff.clear();
-					ff.open(incdir + '/' + fn);
+					path = incdir + '/' + fn;
+					ff.open(path);
 					if (!ff.fail()) break;
 				}
 			}
 			if (ff.fail())
 				output_code.push_back("`file_notfound " + fn);
 			else
-				input_file(ff, fn);
+				include_file(ff, fn, path, filename, defines_map, defines_with_args, include_dirs);
 			continue;
 		}
 
@@ -403,6 +501,7 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 
 		if (tok.size() > 1 && tok[0] == '`' && defines_map.count(tok.substr(1)) > 0) {
 			std::string name = tok.substr(1);
+			preproc_stats.macro_expansions++;
 			// printf("expand: >>%s<< -> >>%s<<\n", name.c_str(), defines_map[name].c_str());
 			std::string skipped_spaces = skip_spaces();
 			tok = next_token(false);
@@ -436,16 +535,6 @@ std::string frontend_verilog_preproc(std::istream &f, std::string filename, cons
 
 		output_code.push_back(tok);
 	}
-
-	std::string output;
-	for (auto &str : output_code)
-		output += str;
-
-	output_code.clear();
-	input_buffer.clear();
-	input_buffer_charp = 0;
-
-	return output;
 }
 
 YOSYS_NAMESPACE_END
@@ -31,6 +31,11 @@
 #include "libs/sha1/sha1.h"
 #include <stdarg.h>
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
+
 YOSYS_NAMESPACE_BEGIN
 using namespace VERILOG_FRONTEND;
 
@@ -39,6 +44,173 @@ using namespace VERILOG_FRONTEND;
 static std::vector<std::string> verilog_defaults;
 static std::list<std::vector<std::string>> verilog_defaults_stack;
 
+// preprocessed code for the remaining files of a multi-file read_verilog command,
+// and the arguments of the execute() call that continues this command
+static dict<std::string, std::string> parallel_preproc_results;
+static std::vector<std::string> parallel_preproc_args;
+
+static void parallel_preproc(const std::vector<std::string> &filenames, int num_jobs,
+		const std::map<std::string, std::string> &defines_map, const std::list<std::string> &include_dirs)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	int num_workers = std::min(num_jobs, GetSize(filenames));
+	if (num_workers < 2)
+		return;
+
+	log("Preprocessing %d files using %d worker processes.\n", GetSize(filenames), num_workers);
+
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-preproc-XXXXXX");
+	std::vector<pid_t> worker_pids;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_files.clear();
+			log_streams.clear();
+			log_cmd_error_throw = true;
+
+			for (int i = w; i < GetSize(filenames); i += num_workers) {
+				try {
+					std::ifstream f(filenames[i].c_str());
+					if (f.fail())
+						continue;
+					std::string code = frontend_verilog_preproc(f, filenames[i], defines_map, include_dirs);
+					std::string out_name = stringf("%s/file_%d.v", tempdir_name.c_str(), i);
+					std::ofstream out(out_name + ".part");
+					out << code;
+					out.close();
+					if (!out.fail())
+						rename((out_name + ".part").c_str(), out_name.c_str());
+				} catch (...) {
+				}
+			}
+			_exit(0);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	for (auto pid : worker_pids) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+	}
+
+	// files without a result (e.g. because the worker failed or the file can't be
+	// opened) are simply processed again in the main process
+	for (int i = 0; i < GetSize(filenames); i++) {
+		std::ifstream f(stringf("%s/file_%d.v", tempdir_name.c_str(), i).c_str());
+		if (!f.fail())
+			parallel_preproc_results[filenames[i]] = std::string((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+	}
+
+	remove_directory(tempdir_name);
+#endif
+}
+
+// the modules read from each file with -incremental (before 'hierarchy' or any
+// other pass modified them), and a hash of the options and the preprocessed code
+struct IncrementalFile
+{
+	std::string hash;
+	RTLIL::Design *modules;
+};
+
+static dict<std::string, IncrementalFile> incremental_files;
+
+// true if 'derived' is 'name' or one of the modules that AstModule::derive()
+// creates from it ('name' may be the $abstract module of -defer)
+static bool incremental_derived_from(const std::string &derived, std::string name)
+{
+	if (name.substr(0, 9) == "$abstract")
+		name = name.substr(9);
+	if (derived == name || derived == "$abstract" + name)
+		return true;
+	if (derived.compare(0, 8 + GetSize(name), "$paramod" + name) == 0 && (GetSize(derived) == 8 + GetSize(name) || derived[8 + GetSize(name)] == '\\'))
+		return true;
+	return derived.compare(0, 9, "$paramod$") == 0 && GetSize(derived) == 49 + GetSize(name) && derived.compare(49, GetSize(name), name) == 0;
+}
+
+// removes the modules of a changed file and everything derived from them. the
+// modules that instantiate them are dirty: they are reset to the version that
+// was read from their file (keeping the name), so that 'hierarchy' elaborates
+// them again, and the modules derived from them are removed as well
+static void incremental_remove(RTLIL::Design *design, const std::string &filename)
+{
+	std::vector<std::string> worklist;
+	pool<std::string> done_names, reset_names;
+
+	for (auto &it : incremental_files.at(filename).modules->modules_)
+		worklist.push_back(it.first.str());
+
+	std::vector<RTLIL::Module*> stale_modules;
+	for (auto module : design->modules())
+		for (auto &name : worklist)
+			if (incremental_derived_from(module->name.str(), name)) {
+				stale_modules.push_back(module);
+				break;
+			}
+	for (auto module : stale_modules)
+		design->remove(module);
+
+	while (!worklist.empty())
+	{
+		std::string name = worklist.back();
+		worklist.pop_back();
+		if (done_names.count(name))
+			continue;
+		done_names.insert(name);
+
+		std::vector<RTLIL::Module*> dirty_modules;
+		for (auto module : design->modules())
+			for (auto cell : module->cells())
+				if (incremental_derived_from(cell->type.str(), name)) {
+					dirty_modules.push_back(module);
+					break;
+				}
+
+		for (auto module : dirty_modules)
+		{
+			std::string dirty_name = module->name.str();
+			if (reset_names.count(dirty_name))
+				continue;
+			reset_names.insert(dirty_name);
+
+			RTLIL::Module *orig_module = nullptr;
+			for (auto &it : incremental_files)
+				if (it.first != filename && it.second.modules->module(dirty_name) != nullptr)
+					orig_module = it.second.modules->module(dirty_name);
+
+			if (orig_module == nullptr) {
+				log_warning("Module `%s' instantiates `%s' from the changed file `%s', but it was not read with -incremental and can't be reset.\n",
+						log_id(dirty_name), log_id(name), filename.c_str());
+				continue;
+			}
+
+			log("Resetting module `%s' that instantiates `%s'.\n", log_id(dirty_name), log_id(name));
+			design->remove(module);
+			design->add(orig_module->clone());
+
+			stale_modules.clear();
+			for (auto mod : design->modules())
+				if (mod->name.str() != dirty_name && incremental_derived_from(mod->name.str(), dirty_name))
+					stale_modules.push_back(mod);
+			for (auto mod : stale_modules)
+				design->remove(mod);
+
+			worklist.push_back(dirty_name);
+		}
+	}
+}
+
 static void error_on_dpi_function(AST::AstNode *node)
 {
 	if (node->type == AST::AST_DPI_FUNCTION)
@@ -78,6 +250,12 @@ struct VerilogFrontend : public Frontend {
 		log("    -yydebug\n");
 		log("        enable parser debug output\n");
 		log("\n");
+		log("    -debug\n");
+		log("        print statistics of the pre-processor. These are accumulated over all\n");
+		log("        read_verilog calls. Include files are pre-processed separately and the\n");
+		log("        result is reused when the same unchanged file is included again with\n");
+		log("        the same set of defines.\n");
+		log("\n");
 		log("    -nolatches\n");
 		log("        usually latches are synthesized into logic loops\n");
 		log("        this option prohibits this and sets the output to 'x'\n");
@@ -136,6 +314,46 @@ struct VerilogFrontend : public Frontend {
 		log("        only read the abstract syntax tree and defer actual compilation\n");
 		log("        to a later 'hierarchy' command. Useful in cases where the default\n");
 		log("        parameters of modules yield invalid or not synthesizable code.\n");
+		log("        Modules are then only elaborated when 'hierarchy' finds an instance\n");
+		log("        of them, the ASTs of unused modules are removed by 'hierarchy -top'.\n");
+		log("        With -lib this can be used to read large cell libraries cheaply.\n");
+		log("\n");
+		log("    -netlist\n");
+		log("        read a structural netlist (e.g. the output of 'write_verilog -noexpr')\n");
+		log("        with a fast reader that creates the wires and cells directly instead of\n");
+		log("        going through the abstract syntax tree. Only wire declarations, cell\n");
+		log("        instances with constant parameters, 'assign' statements without\n");
+		log("        operators and 'initial' statements that set the init value of a wire\n");
+		log("        are supported. Cell types starting with '$' are only interpreted as\n");
+		log("        internal cell types with -icells. This option can't be combined with\n");
+		log("        -defer and the options that dump the abstract syntax tree.\n");
+		log("\n");
+		log("        Input files that only contain such netlist modules are detected and\n");
+		log("        read with this reader even without -netlist, unless one of the options\n");
+		log("        above or -sv or -formal is used.\n");
+		log("\n");
+		log("    -nonetlist\n");
+		log("        always use the regular parser and the abstract syntax tree, also for\n");
+		log("        input files that only contain netlist modules.\n");
+		log("\n");
+		log("    -dedup_paramod\n");
+		log("        when deriving parametrized modules, compare the generated netlist\n");
+		log("        with the modules already derived from the same module and reuse an\n");
+		log("        existing one if they are identical. (e.g. when a parameter only\n");
+		log("        affects simulation.)\n");
+		log("\n");
+		log("    -incremental\n");
+		log("        remember the modules read from each file together with a hash of the\n");
+		log("        options and the preprocessed file contents. When the same file is\n");
+		log("        read again with -incremental and did not change, it is not parsed\n");
+		log("        again: modules that are missing in the design (e.g. after 'design\n");
+		log("        -reset') are copied from the remembered version, and modules that\n");
+		log("        are still in the design are kept as they are. When the file did\n");
+		log("        change, the modules it produced before and the modules derived from\n");
+		log("        them by 'hierarchy' are replaced by the new ones. Modules from other\n");
+		log("        files read with -incremental that instantiate them are reset to the\n");
+		log("        version that was read from their file, so that 'hierarchy' elaborates\n");
+		log("        them again.\n");
 		log("\n");
 		log("    -noautowire\n");
 		log("        make the default of `default_nettype be \"none\" instead of \"wire\".\n");
@@ -151,6 +369,12 @@ struct VerilogFrontend : public Frontend {
 		log("        add 'dir' to the directories which are used when searching include\n");
 		log("        files\n");
 		log("\n");
+		log("    -j <N>\n");
+		log("        when multiple files are given, run the pre-processor for N files in\n");
+		log("        parallel in separate worker processes. The files are still parsed and\n");
+		log("        elaborated one by one in the given order. The default is the value\n");
+		log("        given with 'yosys -j'.\n");
+		log("\n");
 		log("The command 'verilog_defaults' can be used to register default options for\n");
 		log("subsequent calls to 'read_verilog'.\n");
 		log("\n");
@@ -177,6 +401,12 @@ struct VerilogFrontend : public Frontend {
 		bool flag_icells = false;
 		bool flag_ignore_redef = false;
 		bool flag_defer = false;
+		bool flag_dedup_paramod = false;
+		bool flag_netlist = false;
+		bool flag_nonetlist = false;
+		bool flag_debug = false;
+		bool flag_incremental = false;
+		int num_jobs = yosys_jobs;
 		std::map<std::string, std::string> defines_map;
 		std::list<std::string> include_dirs;
 		std::list<std::string> attributes;
@@ -188,6 +418,10 @@ struct VerilogFrontend : public Frontend {
 
 		log_header("Executing Verilog-2005 frontend.\n");
 
+		if (args != parallel_preproc_args)
+			parallel_preproc_results.clear();
+		parallel_preproc_args.clear();
+
 		args.insert(args.begin()+1, verilog_defaults.begin(), verilog_defaults.end());
 
 		size_t argidx;
@@ -217,6 +451,10 @@ struct VerilogFrontend : public Frontend {
 				frontend_verilog_yydebug = true;
 				continue;
 			}
+			if (arg == "-debug") {
+				flag_debug = true;
+				continue;
+			}
 			if (arg == "-nolatches") {
 				flag_nolatches = true;
 				continue;
@@ -266,6 +504,22 @@ struct VerilogFrontend : public Frontend {
 				flag_defer = true;
 				continue;
 			}
+			if (arg == "-netlist") {
+				flag_netlist = true;
+				continue;
+			}
+			if (arg == "-nonetlist") {
+				flag_nonetlist = true;
+				continue;
+			}
+			if (arg == "-dedup_paramod") {
+				flag_dedup_paramod = true;
+				continue;
+			}
+			if (arg == "-incremental") {
+				flag_incremental = true;
+				continue;
+			}
 			if (arg == "-noautowire") {
 				default_nettype_wire = false;
 				continue;
@@ -301,51 +555,163 @@ struct VerilogFrontend : public Frontend {
 				include_dirs.push_back(arg.substr(2));
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_jobs = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
-		extra_args(f, filename, args, argidx);
+		std::string options_str;
+		for (size_t i = 1; i < argidx; i++)
+			options_str += args[i] + "\n";
 
-		log("Parsing %s%s input from `%s' to AST representation.\n",
-				formal_mode ? "formal " : "", sv_mode ? "SystemVerilog" : "Verilog", filename.c_str());
+		extra_args(f, filename, args, argidx);
 
-		AST::current_filename = filename;
-		AST::set_line_num = &frontend_verilog_yyset_lineno;
-		AST::get_line_num = &frontend_verilog_yyget_lineno;
+		if (flag_netlist && (flag_defer || flag_dump_ast1 || flag_dump_ast2 || flag_dump_vlog))
+			log_cmd_error("Option -netlist can't be combined with -defer, -dump_ast1, -dump_ast2 or -dump_vlog.\n");
 
-		current_ast = new AST::AstNode(AST::AST_DESIGN);
+		if (!flag_nopp && num_jobs > 1 && !next_args.empty() && parallel_preproc_results.empty() && filename.substr(0, 2) != "<<")
+		{
+			std::vector<std::string> filenames;
+			filenames.push_back(filename);
+			for (size_t i = argidx; i < next_args.size(); i++) {
+				if (next_args[i].substr(0, 2) == "<<") {
+					if (next_args[i] == "<<")
+						i++;
+					continue;
+				}
+				std::string fn = next_args[i];
+				rewrite_filename(fn);
+				filenames.push_back(fn);
+			}
+			parallel_preproc(filenames, num_jobs, defines_map, include_dirs);
+		}
 
-		lexin = f;
 		std::string code_after_preproc;
 
 		if (!flag_nopp) {
-			code_after_preproc = frontend_verilog_preproc(*f, filename, defines_map, include_dirs);
+			if (parallel_preproc_results.count(filename)) {
+				code_after_preproc.swap(parallel_preproc_results.at(filename));
+				parallel_preproc_results.erase(filename);
+			} else
+				code_after_preproc = frontend_verilog_preproc(*f, filename, defines_map, include_dirs);
+			if (flag_debug)
+				log("Pre-processor statistics: %d include files reused from cache, %d processed and cached, %d not cacheable, %d macro expansions.\n",
+						preproc_stats.include_hits, preproc_stats.include_misses, preproc_stats.include_uncached, preproc_stats.macro_expansions);
 			if (flag_ppdump)
 				log("-- Verilog code after preprocessor --\n%s-- END OF DUMP --\n", code_after_preproc.c_str());
-			lexin = new std::istringstream(code_after_preproc);
 		}
 
-		frontend_verilog_yyset_lineno(1);
-		frontend_verilog_yyrestart(NULL);
-		frontend_verilog_yyparse();
-		frontend_verilog_yylex_destroy();
+		std::string incremental_hash;
+		pool<RTLIL::IdString> incremental_old_modules;
 
-		for (auto &child : current_ast->children) {
-			if (child->type == AST::AST_MODULE)
-				for (auto &attr : attributes)
-					if (child->attributes.count(attr) == 0)
-						child->attributes[attr] = AST::AstNode::mkconst_int(1, false);
+		if (flag_incremental)
+		{
+			if (flag_nopp) {
+				std::stringstream buffer;
+				buffer << f->rdbuf();
+				code_after_preproc = buffer.str();
+			}
+
+			incremental_hash = sha1(options_str + code_after_preproc);
+
+			if (incremental_files.count(filename))
+			{
+				IncrementalFile &entry = incremental_files.at(filename);
+
+				if (entry.hash == incremental_hash) {
+					int copied = 0;
+					for (auto module : entry.modules->modules())
+						if (!design->has(module->name)) {
+							design->add(module->clone());
+							copied++;
+						}
+					log("File `%s' is unchanged, copied %d of %d modules into the design.\n",
+							filename.c_str(), copied, GetSize(entry.modules->modules_));
+					if (!parallel_preproc_results.empty())
+						parallel_preproc_args = next_args;
+					log("Successfully finished Verilog frontend.\n");
+					return;
+				}
+
+				log("File `%s' has changed, replacing %d modules.\n", filename.c_str(), GetSize(entry.modules->modules_));
+				incremental_remove(design, filename);
+				delete entry.modules;
+				incremental_files.erase(filename);
+			}
+
+			for (auto &it : design->modules_)
+				incremental_old_modules.insert(it.first);
+		}
+
+		// input that only contains netlist modules is read without the AST, unless the
+		// options ask for the AST or the input uses keywords that the netlist reader
+		// handles differently
+		bool auto_netlist = !flag_nonetlist && !flag_nopp && !flag_defer && !flag_dump_ast1 && !flag_dump_ast2 &&
+				!flag_dump_vlog && !sv_mode && !formal_mode;
+		bool netlist_done = false;
+
+		if (flag_netlist || auto_netlist)
+		{
+			if (flag_nopp && !flag_incremental) {
+				std::stringstream buffer;
+				buffer << f->rdbuf();
+				code_after_preproc = buffer.str();
+			}
+			netlist_done = netlist_parse(design, code_after_preproc, filename, flag_lib, flag_icells, flag_ignore_redef,
+					attributes, !flag_netlist);
 		}
 
-		if (flag_nodpi)
-			error_on_dpi_function(current_ast);
+		if (!netlist_done)
+		{
+			log("Parsing %s%s input from `%s' to AST representation.\n",
+					formal_mode ? "formal " : "", sv_mode ? "SystemVerilog" : "Verilog", filename.c_str());
 
-		AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_ignore_redef, flag_defer, default_nettype_wire);
+			AST::current_filename = filename;
+			AST::set_line_num = &frontend_verilog_yyset_lineno;
+			AST::get_line_num = &frontend_verilog_yyget_lineno;
 
-		if (!flag_nopp)
-			delete lexin;
+			current_ast = new AST::AstNode(AST::AST_DESIGN);
+
+			lexin = f;
+			if (!flag_nopp || flag_incremental)
+				lexin = new std::istringstream(code_after_preproc);
+
+			frontend_verilog_yyset_lineno(1);
+			frontend_verilog_yyrestart(NULL);
+			frontend_verilog_yyparse();
+			frontend_verilog_yylex_destroy();
+
+			for (auto &child : current_ast->children) {
+				if (child->type == AST::AST_MODULE)
+					for (auto &attr : attributes)
+						if (child->attributes.count(attr) == 0)
+							child->attributes[attr] = AST::AstNode::mkconst_int(1, false);
+			}
+
+			if (flag_nodpi)
+				error_on_dpi_function(current_ast);
+
+			AST::process(design, current_ast, flag_dump_ast1, flag_dump_ast2, flag_dump_vlog, flag_nolatches, flag_nomeminit, flag_nomem2reg, flag_mem2reg, flag_lib, flag_noopt, flag_icells, flag_ignore_redef, flag_defer, default_nettype_wire, flag_dedup_paramod);
+
+			if (!flag_nopp || flag_incremental)
+				delete lexin;
+
+			delete current_ast;
+			current_ast = NULL;
+		}
+
+		if (flag_incremental) {
+			IncrementalFile &entry = incremental_files[filename];
+			entry.hash = incremental_hash;
+			entry.modules = new RTLIL::Design;
+			for (auto module : design->modules())
+				if (!incremental_old_modules.count(module->name))
+					entry.modules->add(module->clone());
+		}
 
-		delete current_ast;
-		current_ast = NULL;
+		if (!parallel_preproc_results.empty())
+			parallel_preproc_args = next_args;
 
 		log("Successfully finished Verilog frontend.\n");
 	}
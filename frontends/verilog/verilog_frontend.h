@@ -45,6 +45,16 @@ namespace VERILOG_FRONTEND
 	// this function converts a Verilog constant to an AST_CONSTANT node
 	AST::AstNode *const2ast(std::string code, char case_type = 0, bool warn_z = false);
 
+	// parse the digits of a based constant (without size and base, e.g. the
+	// words of a $readmemh file) into len_in_bits bits, LSB first
+	void digits2bits(std::vector<RTLIL::State> &data, const char *str, int len_in_bits, int base);
+
+	// read a structural netlist (read_verilog -netlist) directly into RTLIL modules. with
+	// auto_detect nothing is changed and false is returned if the code isn't a plain netlist.
+	bool netlist_parse(RTLIL::Design *design, const std::string &code, const std::string &filename,
+			bool flag_lib, bool flag_icells, bool flag_ignore_redef, const std::list<std::string> &attributes,
+			bool auto_detect = false);
+
 	// state of `default_nettype
 	extern bool default_nettype_wire;
 
@@ -56,6 +66,13 @@ namespace VERILOG_FRONTEND
 
 	// lexer input stream
 	extern std::istream *lexin;
+
+	// pre-processor statistics, see read_verilog -debug
+	struct PreprocStats {
+		int include_hits = 0, include_misses = 0, include_uncached = 0;
+		int macro_expansions = 0;
+	};
+	extern PreprocStats preproc_stats;
 }
 
 // the pre-processor
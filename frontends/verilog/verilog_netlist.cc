@@ -0,0 +1,1157 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ *  ---
+ *
+ *  A reader for structural Verilog netlists (read_verilog -netlist).
+ *
+ *  Netlists only contain wire declarations, cell instances and simple
+ *  assignments. This reader scans the pre-processed code in place and
+ *  creates the RTLIL wires and cells directly, without going through the
+ *  flex/bison parser and the AST frontend library.
+ *
+ */
+
+#include "verilog_frontend.h"
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+using namespace VERILOG_FRONTEND;
+
+namespace {
+
+struct netlist_fallback { };
+
+// single character tokens use their character code
+enum {
+	TOK_EOF = 256,
+	TOK_ID,
+	TOK_NUMBER,
+	TOK_STRING,
+	TOK_ATTR_BEGIN,
+	TOK_ATTR_END,
+	TOK_MODULE,
+	TOK_ENDMODULE,
+	TOK_INPUT,
+	TOK_OUTPUT,
+	TOK_INOUT,
+	TOK_WIRE,
+	TOK_REG,
+	TOK_SIGNED,
+	TOK_ASSIGN,
+	TOK_INITIAL,
+	TOK_UNSUPPORTED
+};
+
+// Keywords are looked up with a switch on the first character and a compare
+// with the few keywords of matching length. This is a perfect hash for this
+// small set and avoids creating a string for every identifier.
+int lookup_keyword(const char *p, int len)
+{
+#define KEYWORD(_str, _tok) if (len == int(sizeof(_str))-1 && !memcmp(p, _str, len)) return _tok;
+	switch (p[0])
+	{
+	case 'a':
+		KEYWORD("assign", TOK_ASSIGN)
+		KEYWORD("always", TOK_UNSUPPORTED)
+		KEYWORD("and", TOK_UNSUPPORTED)
+		break;
+	case 'b':
+		KEYWORD("buf", TOK_UNSUPPORTED)
+		KEYWORD("bufif0", TOK_UNSUPPORTED)
+		KEYWORD("bufif1", TOK_UNSUPPORTED)
+		break;
+	case 'e':
+		KEYWORD("endmodule", TOK_ENDMODULE)
+		break;
+	case 'f':
+		KEYWORD("function", TOK_UNSUPPORTED)
+		break;
+	case 'g':
+		KEYWORD("generate", TOK_UNSUPPORTED)
+		KEYWORD("genvar", TOK_UNSUPPORTED)
+		break;
+	case 'i':
+		KEYWORD("input", TOK_INPUT)
+		KEYWORD("inout", TOK_INOUT)
+		KEYWORD("initial", TOK_INITIAL)
+		KEYWORD("integer", TOK_UNSUPPORTED)
+		break;
+	case 'l':
+		KEYWORD("localparam", TOK_UNSUPPORTED)
+		break;
+	case 'm':
+		KEYWORD("module", TOK_MODULE)
+		KEYWORD("macromodule", TOK_MODULE)
+		break;
+	case 'n':
+		KEYWORD("nand", TOK_UNSUPPORTED)
+		KEYWORD("nor", TOK_UNSUPPORTED)
+		KEYWORD("not", TOK_UNSUPPORTED)
+		KEYWORD("notif0", TOK_UNSUPPORTED)
+		KEYWORD("notif1", TOK_UNSUPPORTED)
+		break;
+	case 'o':
+		KEYWORD("output", TOK_OUTPUT)
+		KEYWORD("or", TOK_UNSUPPORTED)
+		break;
+	case 'p':
+		KEYWORD("parameter", TOK_UNSUPPORTED)
+		KEYWORD("primitive", TOK_UNSUPPORTED)
+		break;
+	case 'r':
+		KEYWORD("reg", TOK_REG)
+		KEYWORD("real", TOK_UNSUPPORTED)
+		break;
+	case 's':
+		KEYWORD("signed", TOK_SIGNED)
+		KEYWORD("specify", TOK_UNSUPPORTED)
+		KEYWORD("supply0", TOK_UNSUPPORTED)
+		KEYWORD("supply1", TOK_UNSUPPORTED)
+		break;
+	case 't':
+		KEYWORD("task", TOK_UNSUPPORTED)
+		KEYWORD("tri", TOK_UNSUPPORTED)
+		break;
+	case 'w':
+		KEYWORD("wire", TOK_WIRE)
+		break;
+	case 'x':
+		KEYWORD("xor", TOK_UNSUPPORTED)
+		KEYWORD("xnor", TOK_UNSUPPORTED)
+		break;
+	}
+#undef KEYWORD
+	return TOK_ID;
+}
+
+inline bool is_space(char ch)
+{
+	return ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n';
+}
+
+inline bool is_id_char(char ch)
+{
+	return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z') || ('0' <= ch && ch <= '9') || ch == '_' || ch == '$';
+}
+
+inline bool is_digit_char(char ch)
+{
+	return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'f') || ('A' <= ch && ch <= 'F') ||
+			ch == 'x' || ch == 'X' || ch == 'z' || ch == 'Z' || ch == '?' || ch == '_';
+}
+
+int netlist_linenum;
+
+int get_netlist_linenum()
+{
+	return netlist_linenum;
+}
+
+void set_netlist_linenum(int linenum)
+{
+	netlist_linenum = linenum;
+}
+
+struct NetlistReader
+{
+	RTLIL::Design *design;
+	std::string filename;
+	bool flag_lib, flag_icells, flag_ignore_redef;
+	const std::list<std::string> &setattr;
+
+	const char *ptr, *end;
+	int linenum;
+
+	// the current token
+	int tok, tok_line;
+	const char *tok_begin;
+	int tok_len;
+	std::string tok_str;
+
+	// the `file_push / `file_pop stack of the pre-processor
+	std::vector<std::string> filename_stack;
+	std::vector<int> linenum_stack;
+
+	// modules and log messages are only committed to the design when the
+	// whole input has been read, so that auto_detect can still back out
+	bool auto_detect;
+	std::vector<RTLIL::Module*> new_modules;
+	pool<RTLIL::IdString> new_module_names;
+	std::vector<std::pair<bool, std::string>> deferred_log;
+
+	RTLIL::Module *module;
+	pool<RTLIL::Wire*> implicit_wires;
+	dict<RTLIL::IdString, RTLIL::Const> attr;
+	std::string idbuf;
+
+	struct decl_t {
+		bool port_input = false, port_output = false;
+		int width = 1, start_offset = 0;
+		bool upto = false, is_signed = false;
+	};
+
+	// wires declared as signed and the signedness of the last parsed signal,
+	// assignments extend the right hand side like the AST frontend
+	pool<RTLIL::Wire*> signed_wires;
+	bool last_signed;
+
+	NetlistReader(RTLIL::Design *design, const std::string &code, const std::string &filename, bool flag_lib,
+			bool flag_icells, bool flag_ignore_redef, const std::list<std::string> &setattr, bool auto_detect) :
+			design(design), filename(filename), flag_lib(flag_lib), flag_icells(flag_icells),
+			flag_ignore_redef(flag_ignore_redef), setattr(setattr), ptr(code.data()), end(code.data() + code.size()),
+			linenum(1), tok(TOK_EOF), tok_line(1), tok_begin(ptr), tok_len(0), auto_detect(auto_detect), module(nullptr),
+			last_signed(false)
+	{
+	}
+
+	~NetlistReader()
+	{
+		delete module;
+		for (auto m : new_modules)
+			delete m;
+	}
+
+	std::string src(int line)
+	{
+		return filename + ":" + std::to_string(line);
+	}
+
+	std::string tok_text()
+	{
+		if (tok == TOK_EOF)
+			return "end of file";
+		return "`" + std::string(tok_begin, tok_len) + "'";
+	}
+
+	// with auto_detect any error means that the input is not a plain netlist
+	// and is handled by the regular parser instead
+	YS_NORETURN YS_ATTRIBUTE(format(printf, 2, 3), noreturn) void error(const char *fmt, ...)
+	{
+		if (auto_detect)
+			throw netlist_fallback();
+		va_list ap;
+		va_start(ap, fmt);
+		logv_error(fmt, ap);
+	}
+
+	YS_NORETURN YS_ATTRIBUTE(noreturn) void syntax_error(const char *expected)
+	{
+		error("Syntax error in netlist at %s:%d: expected %s but found %s.\n",
+				filename.c_str(), tok_line, expected, tok_text().c_str());
+	}
+
+	YS_NORETURN YS_ATTRIBUTE(noreturn) void unsupported(const char *what)
+	{
+		error("%s at %s:%d are not supported by read_verilog -netlist.\n",
+				what, filename.c_str(), tok_line);
+	}
+
+	void expect(int t, const char *what)
+	{
+		if (tok != t)
+			syntax_error(what);
+		next();
+	}
+
+	std::string rest_of_line()
+	{
+		const char *p = ptr;
+		while (ptr < end && *ptr != '\n')
+			ptr++;
+		return std::string(p, ptr);
+	}
+
+	static std::string unquote(std::string str)
+	{
+		while (!str.empty() && (str.front() == ' ' || str.front() == '\t'))
+			str = str.substr(1);
+		if (!str.empty() && str.front() == '"')
+			str = str.substr(1);
+		if (!str.empty() && str.back() == '"')
+			str = str.substr(0, str.size()-1);
+		return str;
+	}
+
+	// the compiler directives that are handled by the Verilog lexer
+	void directive()
+	{
+		const char *p = ++ptr;
+		while (ptr < end && is_id_char(*ptr))
+			ptr++;
+		std::string name(p, ptr);
+
+		if (name == "timescale" || name == "celldefine" || name == "endcelldefine") {
+			rest_of_line();
+			return;
+		}
+
+		if (name == "file_push") {
+			filename_stack.push_back(filename);
+			linenum_stack.push_back(linenum);
+			filename = unquote(rest_of_line());
+			linenum = 0;
+			return;
+		}
+
+		if (name == "file_pop" && !filename_stack.empty()) {
+			rest_of_line();
+			if (ptr < end)
+				ptr++;
+			filename = filename_stack.back();
+			linenum = linenum_stack.back();
+			filename_stack.pop_back();
+			linenum_stack.pop_back();
+			return;
+		}
+
+		if (name == "line") {
+			std::string args = rest_of_line();
+			if (ptr < end)
+				ptr++;
+			char *q;
+			linenum = strtol(args.c_str(), &q, 10);
+			while (*q == ' ' || *q == '\t')
+				q++;
+			std::string fn = q;
+			filename = unquote(fn.substr(0, fn.find('"', 1) + 1));
+			return;
+		}
+
+		if (name == "default_nettype") {
+			while (ptr < end && (*ptr == ' ' || *ptr == '\t'))
+				ptr++;
+			p = ptr;
+			while (ptr < end && is_id_char(*ptr))
+				ptr++;
+			std::string value(p, ptr);
+			if (value == "wire")
+				default_nettype_wire = true;
+			else if (value == "none")
+				default_nettype_wire = false;
+			else
+				error("Unsupported default nettype `%s' at %s:%d.\n", value.c_str(), filename.c_str(), linenum);
+			return;
+		}
+
+		error("Unimplemented compiler directive or undefined macro `%s at %s:%d.\n", name.c_str(), filename.c_str(), linenum);
+	}
+
+	// true for "/* synopsys <what> */" and "/* synthesis <what> */" comments
+	static bool is_synopsys_comment(const char *p, const char *e, const char *what)
+	{
+		std::string text(p+2, e-2);
+		std::istringstream words(text);
+		std::string tool, flag, extra;
+		words >> tool >> flag;
+		return (tool == "synopsys" || tool == "synthesis") && flag == what && !(words >> extra);
+	}
+
+	// skips a block comment, including the code between translate_off and translate_on comments
+	void block_comment()
+	{
+		int comment_line = linenum;
+		const char *p = ptr;
+		for (ptr += 2; ptr < end && !(ptr[0] == '*' && ptr+1 < end && ptr[1] == '/'); ptr++)
+			if (*ptr == '\n')
+				linenum++;
+		if (ptr == end)
+			error("Unterminated comment starting at %s:%d.\n", filename.c_str(), comment_line);
+		ptr += 2;
+
+		if (!is_synopsys_comment(p, ptr, "translate_off"))
+			return;
+
+		while (ptr < end) {
+			if (*ptr == '\n')
+				linenum++;
+			if (ptr+1 < end && ptr[0] == '/' && ptr[1] == '*') {
+				p = ptr;
+				const char *e = strstr(ptr, "*/");
+				if (e != nullptr && e < end && is_synopsys_comment(p, e+2, "translate_on")) {
+					ptr = e+2;
+					return;
+				}
+			}
+			ptr++;
+		}
+	}
+
+	void next()
+	{
+		while (1) {
+			while (ptr < end && is_space(*ptr)) {
+				if (*ptr == '\n')
+					linenum++;
+				ptr++;
+			}
+			if (ptr+1 < end && ptr[0] == '/' && ptr[1] == '/') {
+				while (ptr < end && *ptr != '\n')
+					ptr++;
+				continue;
+			}
+			if (ptr+1 < end && ptr[0] == '/' && ptr[1] == '*') {
+				block_comment();
+				continue;
+			}
+			if (ptr < end && *ptr == '`') {
+				directive();
+				continue;
+			}
+			break;
+		}
+
+		tok_begin = ptr;
+		tok_line = linenum;
+		netlist_linenum = linenum;
+
+		if (ptr == end) {
+			tok = TOK_EOF;
+		} else if (is_id_char(*ptr) && !('0' <= *ptr && *ptr <= '9') && *ptr != '$') {
+			while (ptr < end && is_id_char(*ptr))
+				ptr++;
+			tok = lookup_keyword(tok_begin, ptr - tok_begin);
+		} else if (*ptr == '\\') {
+			while (ptr < end && !is_space(*ptr))
+				ptr++;
+			tok = TOK_ID;
+		} else if (('0' <= *ptr && *ptr <= '9') || *ptr == '\'') {
+			while (ptr < end && (('0' <= *ptr && *ptr <= '9') || *ptr == '_'))
+				ptr++;
+			const char *p = ptr;
+			while (p < end && (*p == ' ' || *p == '\t'))
+				p++;
+			if (p < end && *p == '\'') {
+				p++;
+				if (p < end && (*p == 's' || *p == 'S'))
+					p++;
+				if (p == end || !strchr("bBoOdDhH", *p) || *p == 0)
+					error("Invalid based constant at %s:%d.\n", filename.c_str(), linenum);
+				for (p++; p < end && is_space(*p); p++)
+					if (*p == '\n')
+						linenum++;
+				while (p < end && is_digit_char(*p))
+					p++;
+				ptr = p;
+			}
+			tok = TOK_NUMBER;
+		} else if (*ptr == '"') {
+			tok_str.clear();
+			for (ptr++; ptr < end && *ptr != '"'; ptr++) {
+				if (*ptr == '\n')
+					error("Unterminated string at %s:%d.\n", filename.c_str(), linenum);
+				if (*ptr != '\\' || ptr+1 == end) {
+					tok_str += *ptr;
+					continue;
+				}
+				ptr++;
+				if (*ptr == 'n')
+					tok_str += '\n';
+				else if (*ptr == 't')
+					tok_str += '\t';
+				else if ('0' <= *ptr && *ptr <= '7') {
+					int value = 0;
+					for (int i = 0; i < 3 && ptr < end && '0' <= *ptr && *ptr <= '7'; i++, ptr++)
+						value = value*8 + *ptr - '0';
+					tok_str += char(value);
+					ptr--;
+				} else
+					tok_str += *ptr;
+			}
+			if (ptr == end)
+				error("Unterminated string at %s:%d.\n", filename.c_str(), linenum);
+			ptr++;
+			tok = TOK_STRING;
+		} else if (*ptr == '(' && ptr+1 < end && ptr[1] == '*' && !(ptr+2 < end && ptr[2] == ')')) {
+			ptr += 2;
+			tok = TOK_ATTR_BEGIN;
+		} else if (*ptr == '*' && ptr+1 < end && ptr[1] == ')') {
+			ptr += 2;
+			tok = TOK_ATTR_END;
+		} else {
+			tok = (unsigned char)*(ptr++);
+		}
+
+		tok_len = ptr - tok_begin;
+	}
+
+	RTLIL::IdString tok_id()
+	{
+		if (tok_begin[0] == '\\') {
+			idbuf.assign(tok_begin, tok_len);
+		} else {
+			idbuf.assign(1, '\\');
+			idbuf.append(tok_begin, tok_len);
+		}
+		return idbuf;
+	}
+
+	// the value of a TOK_NUMBER or TOK_STRING token
+	RTLIL::Const tok_const()
+	{
+		if (tok == TOK_STRING)
+			return RTLIL::Const(tok_str);
+
+		// fast paths for plain decimal numbers and single bit constants,
+		// everything else is passed to const2ast()
+		if (tok_len <= 9 && '0' <= tok_begin[0] && tok_begin[0] <= '9') {
+			int value = 0, i;
+			for (i = 0; i < tok_len && '0' <= tok_begin[i] && tok_begin[i] <= '9'; i++)
+				value = value*10 + tok_begin[i] - '0';
+			if (i == tok_len) {
+				RTLIL::Const c(value);
+				c.flags |= RTLIL::CONST_FLAG_SIGNED;
+				return c;
+			}
+		}
+		if (tok_len == 4 && tok_begin[0] == '1' && tok_begin[1] == '\'' && tok_begin[2] == 'b') {
+			switch (tok_begin[3]) {
+				case '0': return RTLIL::State::S0;
+				case '1': return RTLIL::State::S1;
+				case 'x': return RTLIL::State::Sx;
+				case 'z': return RTLIL::State::Sz;
+			}
+		}
+
+		AST::AstNode *node = const2ast(std::string(tok_begin, tok_len));
+		RTLIL::Const value = node->asParaConst();
+		delete node;
+		return value;
+	}
+
+	int parse_int()
+	{
+		bool negative = false;
+		if (tok == '-') {
+			negative = true;
+			next();
+		}
+		if (tok != TOK_NUMBER)
+			syntax_error("integer");
+		RTLIL::Const value = tok_const();
+		next();
+		return negative ? -value.as_int() : value.as_int();
+	}
+
+	void parse_attributes()
+	{
+		while (tok == TOK_ATTR_BEGIN)
+		{
+			next();
+			while (tok != TOK_ATTR_END)
+			{
+				if (tok != TOK_ID)
+					syntax_error("attribute name");
+				RTLIL::IdString name = tok_id();
+				RTLIL::Const value(1);
+				next();
+				if (tok == '=') {
+					next();
+					if (tok != TOK_NUMBER && tok != TOK_STRING)
+						syntax_error("constant attribute value");
+					value = tok_const();
+					value.flags &= ~RTLIL::CONST_FLAG_SIGNED;
+					next();
+				}
+				attr[name] = value;
+				if (tok == ',') {
+					next();
+					continue;
+				}
+				if (tok != TOK_ATTR_END)
+					syntax_error("`,' or `*)'");
+			}
+			next();
+		}
+	}
+
+	void apply_attributes(dict<RTLIL::IdString, RTLIL::Const> &attributes)
+	{
+		for (auto &it : attr)
+			attributes[it.first] = it.second;
+	}
+
+	RTLIL::Wire *get_wire(RTLIL::IdString id)
+	{
+		RTLIL::Wire *wire = module->wire(id);
+		if (wire == nullptr) {
+			if (!default_nettype_wire)
+				error("Identifier `%s' is implicitly declared at %s:%d and `default_nettype is set to none.\n",
+						id.c_str(), filename.c_str(), tok_line);
+			deferred_log.push_back(std::make_pair(true, stringf("Identifier `%s' is implicitly declared at %s:%d.\n",
+					id.c_str(), filename.c_str(), tok_line)));
+			wire = module->addWire(id);
+			wire->attributes["\\src"] = src(tok_line);
+			implicit_wires.insert(wire);
+		}
+		return wire;
+	}
+
+	// maps a Verilog index of the wire to the bit offset in the RTLIL wire
+	int bit_offset(RTLIL::Wire *wire, int index)
+	{
+		int offset = wire->upto ? wire->start_offset + wire->width - 1 - index : index - wire->start_offset;
+		if (offset < 0 || offset >= wire->width)
+			error("Index %d is out of range for signal `%s' at %s:%d.\n", index, wire->name.c_str(), filename.c_str(), tok_line);
+		return offset;
+	}
+
+	RTLIL::SigSpec parse_primary()
+	{
+		last_signed = false;
+
+		if (tok == TOK_NUMBER) {
+			RTLIL::Const value = tok_const();
+			last_signed = (value.flags & RTLIL::CONST_FLAG_SIGNED) != 0;
+			next();
+			return value;
+		}
+
+		if (tok == '{')
+		{
+			std::vector<RTLIL::SigSpec> parts;
+			next();
+
+			if (tok == TOK_NUMBER) {
+				RTLIL::Const value = tok_const();
+				next();
+				if (tok == '{') {
+					RTLIL::SigSpec sig = parse_primary();
+					expect('}', "`}'");
+					last_signed = false;
+					return sig.repeat(value.as_int());
+				}
+				parts.push_back(value);
+				if (tok == ',')
+					next();
+				else if (tok != '}')
+					syntax_error("`,' or `}'");
+			}
+
+			while (tok != '}') {
+				parts.push_back(parse_primary());
+				if (tok == ',')
+					next();
+				else if (tok != '}')
+					syntax_error("`,' or `}'");
+			}
+			next();
+
+			// the first part of a concatenation holds the most significant bits
+			RTLIL::SigSpec sig;
+			for (auto it = parts.rbegin(); it != parts.rend(); it++)
+				sig.append(*it);
+			last_signed = false;
+			return sig;
+		}
+
+		if (tok == TOK_ID)
+		{
+			RTLIL::Wire *wire = get_wire(tok_id());
+			next();
+			if (tok != '[') {
+				last_signed = signed_wires.count(wire) != 0;
+				return wire;
+			}
+
+			next();
+			int index = parse_int();
+			if (tok == ']') {
+				next();
+				return RTLIL::SigSpec(wire, bit_offset(wire, index));
+			}
+			if (tok != ':')
+				unsupported("Dynamic or indexed part selects");
+			next();
+			int offset_a = bit_offset(wire, index);
+			int offset_b = bit_offset(wire, parse_int());
+			expect(']', "`]'");
+			return RTLIL::SigSpec(wire, std::min(offset_a, offset_b), abs(offset_a - offset_b) + 1);
+		}
+
+		if (tok == TOK_STRING || tok == TOK_EOF || tok == ';' || tok == ',' || tok == ')')
+			syntax_error("signal");
+		unsupported("Expressions");
+	}
+
+	RTLIL::SigSpec parse_sigspec()
+	{
+		RTLIL::SigSpec sig = parse_primary();
+		if (tok != ',' && tok != ';' && tok != ')' && tok != '}' && tok != '=')
+			unsupported("Expressions");
+		return sig;
+	}
+
+	// the value of a parameter of a cell instance
+	RTLIL::Const parse_param_value()
+	{
+		bool negative = false;
+		if (tok == '-') {
+			negative = true;
+			next();
+		}
+		if (tok != TOK_NUMBER && (negative || tok != TOK_STRING))
+			unsupported("Non-constant parameter values");
+		RTLIL::Const value = tok_const();
+		next();
+		if (negative) {
+			int flags = value.flags;
+			value = RTLIL::const_neg(value, RTLIL::Const(), flags & RTLIL::CONST_FLAG_SIGNED, false, GetSize(value));
+			value.flags = flags;
+		}
+		return value;
+	}
+
+	void skip_statement()
+	{
+		while (tok != ';' && tok != TOK_EOF)
+			next();
+		expect(';', "`;'");
+	}
+
+	void parse_decl_head(decl_t &decl)
+	{
+		decl = decl_t();
+		if (tok == TOK_INPUT || tok == TOK_INOUT)
+			decl.port_input = true;
+		if (tok == TOK_OUTPUT || tok == TOK_INOUT)
+			decl.port_output = true;
+		if (decl.port_input || decl.port_output)
+			next();
+		if (tok == TOK_WIRE || tok == TOK_REG)
+			next();
+		if (tok == TOK_SIGNED) {
+			decl.is_signed = true;
+			next();
+		}
+		if (tok == '[') {
+			next();
+			int msb = parse_int();
+			expect(':', "`:'");
+			int lsb = parse_int();
+			expect(']', "`]'");
+			decl.width = abs(msb - lsb) + 1;
+			decl.start_offset = std::min(msb, lsb);
+			decl.upto = msb < lsb;
+		}
+	}
+
+	RTLIL::Wire *declare_wire(RTLIL::IdString id, const decl_t &decl, int line)
+	{
+		RTLIL::Wire *wire = module->wire(id);
+
+		if (wire != nullptr) {
+			if (implicit_wires.count(wire))
+				error("Identifier `%s' is used before its declaration at %s:%d.\n", id.c_str(), filename.c_str(), line);
+			if (wire->width != decl.width || wire->start_offset != decl.start_offset || wire->upto != decl.upto)
+				error("Declaration of `%s' at %s:%d doesn't match its earlier declaration.\n", id.c_str(), filename.c_str(), line);
+		} else {
+			if (module->count_id(id) != 0)
+				error("Re-definition of `%s' at %s:%d!\n", id.c_str(), filename.c_str(), line);
+			wire = module->addWire(id, decl.width);
+			wire->start_offset = decl.start_offset;
+			wire->upto = decl.upto;
+			wire->attributes["\\src"] = src(line);
+		}
+
+		wire->port_input |= decl.port_input;
+		wire->port_output |= decl.port_output;
+		if (decl.is_signed)
+			signed_wires.insert(wire);
+		apply_attributes(wire->attributes);
+		return wire;
+	}
+
+	void connect(const RTLIL::SigSpec &lhs, RTLIL::SigSpec rhs, bool rhs_signed)
+	{
+		rhs.extend_u0(GetSize(lhs), rhs_signed);
+		module->connect(lhs, rhs);
+	}
+
+	void parse_declaration()
+	{
+		decl_t decl;
+		parse_decl_head(decl);
+
+		while (1)
+		{
+			if (tok != TOK_ID)
+				syntax_error("identifier");
+			RTLIL::IdString id = tok_id();
+			int line = tok_line;
+			next();
+
+			if (tok == '[')
+				unsupported("Memories");
+
+			// library modules only keep their ports
+			RTLIL::Wire *wire = nullptr;
+			if (!flag_lib || decl.port_input || decl.port_output || module->wire(id) != nullptr)
+				wire = declare_wire(id, decl, line);
+
+			if (tok == '=') {
+				next();
+				RTLIL::SigSpec rhs = parse_sigspec();
+				if (wire != nullptr && !flag_lib)
+					connect(wire, rhs, last_signed);
+			}
+
+			if (tok != ',')
+				break;
+			next();
+		}
+
+		expect(';', "`;'");
+	}
+
+	void parse_assign()
+	{
+		next();
+
+		if (flag_lib) {
+			skip_statement();
+			return;
+		}
+
+		while (1) {
+			RTLIL::SigSpec lhs = parse_sigspec();
+			expect('=', "`='");
+			RTLIL::SigSpec rhs = parse_sigspec();
+			connect(lhs, rhs, last_signed);
+			if (tok != ',')
+				break;
+			next();
+		}
+
+		expect(';', "`;'");
+	}
+
+	// only the "initial <wire> = <constant>;" statements that are written
+	// by write_verilog for the init values of registers. the AST frontend
+	// creates a process for them, so they are left to it with auto_detect.
+	void parse_initial()
+	{
+		if (auto_detect)
+			unsupported("Initial blocks");
+		next();
+
+		if (flag_lib) {
+			skip_statement();
+			return;
+		}
+
+		if (tok != TOK_ID)
+			unsupported("Initial blocks");
+		RTLIL::Wire *wire = get_wire(tok_id());
+		next();
+		if (tok != '=')
+			unsupported("Initial blocks");
+		next();
+		if (tok != TOK_NUMBER)
+			unsupported("Initial blocks");
+		RTLIL::Const value = tok_const();
+		next();
+		expect(';', "`;'");
+
+		value.bits.resize(wire->width, RTLIL::State::S0);
+		wire->attributes["\\init"] = RTLIL::Const(value.bits);
+	}
+
+	void parse_instances()
+	{
+		RTLIL::IdString type = tok_id();
+		if (flag_icells && type.str().compare(0, 2, "\\$") == 0)
+			type = type.substr(1);
+		next();
+
+		if (flag_lib) {
+			skip_statement();
+			return;
+		}
+
+		dict<RTLIL::IdString, RTLIL::Const> parameters;
+		if (tok == '#')
+		{
+			int para_counter = 0;
+			next();
+			expect('(', "`('");
+			while (tok != ')') {
+				if (tok == '.') {
+					next();
+					if (tok != TOK_ID)
+						syntax_error("parameter name");
+					RTLIL::IdString name = tok_id();
+					next();
+					expect('(', "`('");
+					parameters[name] = parse_param_value();
+					expect(')', "`)'");
+				} else
+					parameters[stringf("$%d", ++para_counter)] = parse_param_value();
+				if (tok == ',')
+					next();
+				else if (tok != ')')
+					syntax_error("`,' or `)'");
+			}
+			next();
+		}
+
+		while (1)
+		{
+			if (tok != TOK_ID)
+				syntax_error("instance name");
+			RTLIL::IdString name = tok_id();
+			int line = tok_line;
+			next();
+
+			if (tok == '[')
+				unsupported("Arrays of instances");
+			if (module->count_id(name) != 0)
+				error("Re-definition of cell `%s' at %s:%d!\n", name.c_str(), filename.c_str(), line);
+
+			RTLIL::Cell *cell = module->addCell(name, type);
+			cell->parameters = parameters;
+			cell->attributes["\\src"] = src(line);
+			apply_attributes(cell->attributes);
+
+			int port_counter = 0;
+			expect('(', "`('");
+			while (tok != ')') {
+				if (tok == '.') {
+					next();
+					if (tok != TOK_ID)
+						syntax_error("port name");
+					RTLIL::IdString port = tok_id();
+					next();
+					expect('(', "`('");
+					RTLIL::SigSpec sig;
+					if (tok != ')')
+						sig = parse_sigspec();
+					expect(')', "`)'");
+					cell->setPort(port, sig);
+				} else {
+					RTLIL::SigSpec sig;
+					if (tok != ',')
+						sig = parse_sigspec();
+					cell->setPort(stringf("$%d", ++port_counter), sig);
+				}
+				if (tok == ',')
+					next();
+				else if (tok != ')')
+					syntax_error("`,' or `)'");
+			}
+			next();
+
+			if (tok != ',')
+				break;
+			next();
+		}
+
+		expect(';', "`;'");
+	}
+
+	void parse_module()
+	{
+		int module_line = tok_line;
+		next();
+
+		if (tok != TOK_ID)
+			syntax_error("module name");
+		RTLIL::IdString name = tok_id();
+		if (flag_icells && name.str().compare(0, 2, "\\$") == 0)
+			name = name.substr(1);
+		next();
+
+		bool ignore_module = false;
+		if (design->has(name) || new_module_names.count(name)) {
+			if (!flag_ignore_redef)
+				error("Re-definition of module `%s' at %s:%d!\n", name.c_str(), filename.c_str(), module_line);
+			deferred_log.push_back(std::make_pair(false, stringf("Ignoring re-definition of module `%s' at %s:%d!\n",
+					name.c_str(), filename.c_str(), module_line)));
+			ignore_module = true;
+		} else
+			deferred_log.push_back(std::make_pair(false, stringf("Generating RTLIL representation for module `%s'.\n", name.c_str())));
+
+		module = new RTLIL::Module;
+		module->name = name;
+		module->attributes["\\src"] = src(module_line);
+		apply_attributes(module->attributes);
+		for (auto &a : setattr)
+			if (module->attributes.count(a) == 0)
+				module->attributes[a] = RTLIL::Const(1);
+		if (flag_lib)
+			module->attributes["\\blackbox"] = RTLIL::Const(1);
+		attr.clear();
+
+		if (tok == '#')
+			unsupported("Module parameters");
+
+		// ports in the order of the module header
+		std::vector<RTLIL::IdString> port_names;
+
+		if (tok == '(')
+		{
+			decl_t decl;
+			bool ansi_ports = false;
+
+			next();
+			while (tok != ')')
+			{
+				parse_attributes();
+				if (tok == TOK_INPUT || tok == TOK_OUTPUT || tok == TOK_INOUT) {
+					parse_decl_head(decl);
+					ansi_ports = true;
+				}
+				if (tok != TOK_ID)
+					syntax_error("port name");
+				RTLIL::IdString id = tok_id();
+				if (ansi_ports)
+					declare_wire(id, decl, tok_line);
+				port_names.push_back(id);
+				attr.clear();
+				next();
+				if (tok == ',')
+					next();
+				else if (tok != ')')
+					syntax_error("`,' or `)'");
+			}
+			next();
+		}
+		expect(';', "`;'");
+
+		while (1)
+		{
+			parse_attributes();
+
+			if (tok == TOK_ENDMODULE)
+				break;
+
+			switch (tok)
+			{
+			case TOK_INPUT:
+			case TOK_OUTPUT:
+			case TOK_INOUT:
+			case TOK_WIRE:
+			case TOK_REG:
+				parse_declaration();
+				break;
+			case TOK_ASSIGN:
+				parse_assign();
+				break;
+			case TOK_INITIAL:
+				parse_initial();
+				break;
+			case TOK_ID:
+				parse_instances();
+				break;
+			case TOK_UNSUPPORTED:
+				error("Keyword %s at %s:%d is not supported by read_verilog -netlist.\n",
+						tok_text().c_str(), filename.c_str(), tok_line);
+			default:
+				syntax_error("module item");
+			}
+
+			attr.clear();
+		}
+		next();
+
+		int port_id = 0;
+		for (auto id : port_names) {
+			RTLIL::Wire *wire = module->wire(id);
+			if (wire == nullptr || (!wire->port_input && !wire->port_output))
+				error("Module port `%s' of module `%s' is not declared as input, output or inout.\n",
+						id.c_str(), name.c_str());
+			if (wire->port_id != 0)
+				error("Module port `%s' of module `%s' is listed twice in the module header.\n",
+						id.c_str(), name.c_str());
+			wire->port_id = ++port_id;
+		}
+		for (auto wire : module->wires())
+			if ((wire->port_input || wire->port_output) && wire->port_id == 0)
+				error("Port `%s' of module `%s' is not listed in the module header.\n",
+						wire->name.c_str(), name.c_str());
+
+		module->fixup_ports();
+		implicit_wires.clear();
+		signed_wires.clear();
+
+		if (ignore_module) {
+			delete module;
+		} else {
+			new_modules.push_back(module);
+			new_module_names.insert(name);
+		}
+		module = nullptr;
+	}
+
+	void run()
+	{
+		next();
+		while (1)
+		{
+			parse_attributes();
+			if (tok == TOK_EOF)
+				break;
+			if (tok == TOK_MODULE)
+				parse_module();
+			else if (tok == TOK_UNSUPPORTED)
+				error("Keyword %s at %s:%d is not supported by read_verilog -netlist.\n",
+						tok_text().c_str(), filename.c_str(), tok_line);
+			else
+				syntax_error("`module'");
+		}
+	}
+
+	void commit()
+	{
+		log("Parsing %s netlist from `%s'.\n", sv_mode ? "SystemVerilog" : "Verilog", AST::current_filename.c_str());
+		for (auto &it : deferred_log) {
+			if (it.first)
+				log_warning("%s", it.second.c_str());
+			else
+				log("%s", it.second.c_str());
+		}
+		for (auto m : new_modules)
+			design->add(m);
+		new_modules.clear();
+	}
+};
+
+} /* namespace */
+
+bool VERILOG_FRONTEND::netlist_parse(RTLIL::Design *design, const std::string &code, const std::string &filename,
+		bool flag_lib, bool flag_icells, bool flag_ignore_redef, const std::list<std::string> &attributes, bool auto_detect)
+{
+	// const2ast() reports errors with the line number of the AST frontend
+	AST::current_filename = filename;
+	AST::set_line_num = &set_netlist_linenum;
+	AST::get_line_num = &get_netlist_linenum;
+
+	bool saved_default_nettype_wire = default_nettype_wire;
+	NetlistReader reader(design, code, filename, flag_lib, flag_icells, flag_ignore_redef, attributes, auto_detect);
+
+	try {
+		reader.run();
+	} catch (netlist_fallback) {
+		default_nettype_wire = saved_default_nettype_wire;
+		return false;
+	}
+
+	reader.commit();
+	return true;
+}
+
+YOSYS_NAMESPACE_END
@@ -20,6 +20,7 @@
 #include "kernel/register.h"
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
+#include "libs/sha1/sha1.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -56,6 +57,12 @@ struct Vhdl2verilogPass : public Pass {
 		log("    -top <top-entity-name>\n");
 		log("        The name of the top entity. This option is mandatory.\n");
 		log("\n");
+		log("    -cache <directory>\n");
+		log("        keep the vhdl2verilog output in the specified directory, keyed by a\n");
+		log("        hash of the contents of the VHDL files and the options. when the VHDL\n");
+		log("        files haven't changed, the cached output is used without running\n");
+		log("        vhdl2verilog. the default is the cache directory given with 'yosys -C'.\n");
+		log("\n");
 		log("The following options are passed as-is to vhdl2verilog:\n");
 		log("\n");
 		log("    -arch <architecture_name>\n");
@@ -80,6 +87,8 @@ struct Vhdl2verilogPass : public Pass {
 		std::string out_file, top_entity;
 		std::string vhdl2verilog_dir;
 		std::string extra_opts;
+		std::string cache_dir = yosys_module_cache_dir;
+		std::vector<std::string> hashed_files;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -95,6 +104,10 @@ struct Vhdl2verilogPass : public Pass {
 				vhdl2verilog_dir = args[++argidx];
 				continue;
 			}
+			if (args[argidx] == "-cache" && argidx+1 < args.size()) {
+				cache_dir = args[++argidx];
+				continue;
+			}
 			if ((args[argidx] == "-arch" || args[argidx] == "-suppress" || args[argidx] == "-mapfile") && argidx+1 < args.size()) {
 				if (args[argidx] == "-mapfile" && !args[argidx+1].empty() && args[argidx+1][0] != '/') {
 					char pwd[PATH_MAX];
@@ -104,6 +117,8 @@ struct Vhdl2verilogPass : public Pass {
 					}
 					args[argidx+1] = pwd + ("/" + args[argidx+1]);
 				}
+				if (args[argidx] == "-mapfile")
+					hashed_files.push_back(args[argidx+1]);
 				extra_opts += std::string(" ") + args[argidx];
 				extra_opts += std::string(" '") + args[++argidx] + std::string("'");
 				continue;
@@ -123,9 +138,6 @@ struct Vhdl2verilogPass : public Pass {
 		if (top_entity.empty())
 			log_cmd_error("Missing -top option.\n");
 
-		std::string tempdir_name = make_temp_dir("/tmp/yosys-vhdl2verilog-XXXXXX");
-		log("Using temp directory %s.\n", tempdir_name.c_str());
-
 		if (!out_file.empty() && out_file[0] != '/') {
 			char pwd[PATH_MAX];
 			if (!getcwd(pwd, sizeof(pwd))) {
@@ -135,7 +147,7 @@ struct Vhdl2verilogPass : public Pass {
 			out_file = pwd + ("/" + out_file);
 		}
 
-		FILE *f = fopen(stringf("%s/files.list", tempdir_name.c_str()).c_str(), "wt");
+		std::vector<std::string> files;
 		while (argidx < args.size()) {
 			std::string file = args[argidx++];
 			if (file.empty())
@@ -148,33 +160,103 @@ struct Vhdl2verilogPass : public Pass {
 				}
 				file = pwd + ("/" + file);
 			}
-			fprintf(f, "%s\n", file.c_str());
-			log("Adding '%s' to the file list.\n", file.c_str());
+			files.push_back(file);
+			hashed_files.push_back(file);
 		}
-		fclose(f);
 
-		std::string command = "exec 2>&1; ";
-		if (!vhdl2verilog_dir.empty())
-			command += stringf("cd '%s'; . ./setup_env.sh; ", vhdl2verilog_dir.c_str());
-		command += stringf("cd '%s'; vhdl2verilog -out '%s' -filelist files.list -top '%s'%s", tempdir_name.c_str(),
-				out_file.empty() ? "vhdl2verilog_output.v" : out_file.c_str(), top_entity.c_str(), extra_opts.c_str());
+		// the cache key covers the options and the contents of all input files
+		std::string cache_file;
+		if (!cache_dir.empty()) {
+			std::stringstream key;
+			key << "vhdl2verilog\n" << vhdl2verilog_dir << "\n" << top_entity << "\n" << extra_opts << "\n";
+			for (auto &file : hashed_files) {
+				std::ifstream ff(file.c_str());
+				key << file << "\n" << ff.rdbuf() << "\n";
+			}
+			cache_file = stringf("%s/vhdl2verilog-%s.v", cache_dir.c_str(), sha1(key.str()).c_str());
+		}
 
-		log("Running '%s'..\n", command.c_str());
+		// the converter output is read into memory once and then passed to the
+		// cache, the -out file and the Verilog frontend
+		std::string verilog_code, verilog_filename;
 
-		int ret = run_command(command, [](const std::string &line) { log("%s", line.c_str()); });
-		if (ret != 0)
-			log_error("Execution of command \"%s\" failed: return code %d.\n", command.c_str(), ret);
+		if (!cache_file.empty()) {
+			std::ifstream ff(cache_file.c_str());
+			if (!ff.fail()) {
+				log("Using cached vhdl2verilog output `%s'.\n", cache_file.c_str());
+				std::stringstream buf;
+				buf << ff.rdbuf();
+				verilog_code = buf.str();
+				verilog_filename = cache_file;
+			}
+		}
 
-		if (out_file.empty()) {
-			std::ifstream ff;
-			ff.open(stringf("%s/vhdl2verilog_output.v", tempdir_name.c_str()).c_str());
+		if (verilog_filename.empty())
+		{
+			std::string tempdir_name = make_temp_dir("/tmp/yosys-vhdl2verilog-XXXXXX");
+			log("Using temp directory %s.\n", tempdir_name.c_str());
+
+			FILE *f = fopen(stringf("%s/files.list", tempdir_name.c_str()).c_str(), "wt");
+			for (auto &file : files) {
+				fprintf(f, "%s\n", file.c_str());
+				log("Adding '%s' to the file list.\n", file.c_str());
+			}
+			fclose(f);
+
+			std::string command = "exec 2>&1; ";
+			if (!vhdl2verilog_dir.empty())
+				command += stringf("cd '%s'; . ./setup_env.sh; ", vhdl2verilog_dir.c_str());
+			command += stringf("cd '%s'; vhdl2verilog -out '%s' -filelist files.list -top '%s'%s", tempdir_name.c_str(),
+					out_file.empty() ? "vhdl2verilog_output.v" : out_file.c_str(), top_entity.c_str(), extra_opts.c_str());
+
+			log("Running '%s'..\n", command.c_str());
+
+			int ret = run_command(command, [](const std::string &line) { log("%s", line.c_str()); });
+			if (ret != 0)
+				log_error("Execution of command \"%s\" failed: return code %d.\n", command.c_str(), ret);
+
+			verilog_filename = out_file.empty() ? stringf("%s/vhdl2verilog_output.v", tempdir_name.c_str()) : out_file;
+
+			if (out_file.empty() || !cache_file.empty()) {
+				std::ifstream ff(verilog_filename.c_str());
+				if (ff.fail())
+					log_error("Can't open vhdl2verilog output file `%s'.\n", verilog_filename.c_str());
+				std::stringstream buf;
+				buf << ff.rdbuf();
+				verilog_code = buf.str();
+			}
+
+			log_header("Removing temp directory `%s':\n", tempdir_name.c_str());
+			remove_directory(tempdir_name);
+
+			// write to a temporary name first so that an interrupted run never
+			// leaves a truncated cache entry behind
+			if (!cache_file.empty()) {
+				std::string tmp_file = make_temp_file(cache_file + ".XXXXXX");
+				std::ofstream ff(tmp_file.c_str());
+				ff << verilog_code;
+				ff.close();
+				if (ff.fail() || rename(tmp_file.c_str(), cache_file.c_str()) != 0) {
+					log_warning("Can't write vhdl2verilog cache file `%s'.\n", cache_file.c_str());
+					remove(tmp_file.c_str());
+				}
+			}
+		}
+		else if (!out_file.empty())
+		{
+			std::ofstream ff(out_file.c_str());
+			ff << verilog_code;
+			ff.close();
 			if (ff.fail())
-				log_error("Can't open vhdl2verilog output file `vhdl2verilog_output.v'.\n");
-			Frontend::frontend_call(design, &ff, stringf("%s/vhdl2verilog_output.v", tempdir_name.c_str()), "verilog");
+				log_error("Can't write output file `%s'.\n", out_file.c_str());
+		}
+
+		if (out_file.empty()) {
+			std::istringstream ff(verilog_code);
+			std::istream *fp = &ff;
+			Frontend::frontend_call(design, fp, verilog_filename, "verilog");
 		}
 
-		log_header("Removing temp directory `%s':\n", tempdir_name.c_str());
-		remove_directory(tempdir_name);
 		log_pop();
 	}
 } Vhdl2verilogPass;
@@ -0,0 +1,189 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/aigsim.h"
+#include "kernel/cellaigs.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+AigSim::AigSim(const SigMap &sigmap, int num_words) : sigmap(sigmap), num_words(num_words)
+{
+	num_cells = 0;
+	num_simulated_cells = 0;
+	num_unsupported_cells = 0;
+	num_aig_nodes = 0;
+	rng_state = 1;
+}
+
+void AigSim::add_cell(RTLIL::Cell *cell)
+{
+	cells.push_back(cell);
+	for (auto &conn : cell->connections())
+		if (cell->output(conn.first))
+			for (auto bit : sigmap(conn.second))
+				if (bit.wire != NULL)
+					bit2driver[bit] = cell;
+	num_cells++;
+}
+
+uint64_t AigSim::rng()
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 2; i++) {
+		rng_state ^= rng_state << 13;
+		rng_state ^= rng_state >> 17;
+		rng_state ^= rng_state << 5;
+		value = (value << 32) | rng_state;
+	}
+	return value;
+}
+
+const uint64_t *AigSim::value(RTLIL::SigBit bit) const
+{
+	bit = sigmap(bit);
+	auto it = bit2index.find(bit);
+	if (it == bit2index.end())
+		return NULL;
+	return values.data() + it->second * num_words;
+}
+
+// constants and bits without driver are created on first use, the returned
+// pointer is only valid until the next call
+const uint64_t *AigSim::input_value(RTLIL::SigBit bit)
+{
+	auto it = bit2index.find(bit);
+	if (it != bit2index.end())
+		return values.data() + it->second * num_words;
+
+	if (bit.wire == NULL ? bit.data != RTLIL::State::S0 && bit.data != RTLIL::State::S1 : bit2driver.count(bit) != 0)
+		return NULL;
+
+	int index = GetSize(values) / num_words;
+	for (int i = 0; i < num_words; i++)
+		values.push_back(bit.wire != NULL ? rng() : bit.data == RTLIL::State::S1 ? ~uint64_t(0) : 0);
+	bit2index[bit] = index;
+	return values.data() + index * num_words;
+}
+
+void AigSim::run(uint32_t seed)
+{
+	rng_state = seed ? seed : 1;
+	num_simulated_cells = 0;
+	num_unsupported_cells = 0;
+	num_aig_nodes = 0;
+	bit2index.clear();
+	values.clear();
+
+	// evaluate each cell after the drivers of its inputs. cells in logic loops
+	// are evaluated with unknown values for the inputs from inside the loop.
+	dict<RTLIL::Cell*, int> cell_state;
+	std::vector<RTLIL::Cell*> stack;
+	std::vector<uint64_t> node_values;
+
+	for (auto root_cell : cells)
+	{
+		if (cell_state.count(root_cell))
+			continue;
+
+		stack.push_back(root_cell);
+		while (!stack.empty())
+		{
+			RTLIL::Cell *cell = stack.back();
+			int &state = cell_state[cell];
+
+			if (state == 0) {
+				state = 1;
+				for (auto &conn : cell->connections())
+					if (!cell->output(conn.first))
+						for (auto bit : sigmap(conn.second)) {
+							auto it = bit2driver.find(bit);
+							if (it != bit2driver.end() && cell_state.count(it->second) == 0)
+								stack.push_back(it->second);
+						}
+				continue;
+			}
+
+			stack.pop_back();
+			if (state == 2)
+				continue;
+			state = 2;
+
+			// like in SatGen, $equiv cells are buffers for their A input
+			if (cell->type == "$equiv") {
+				RTLIL::SigBit bit_y = sigmap(cell->getPort("\\Y")).as_bit();
+				const uint64_t *in = input_value(sigmap(cell->getPort("\\A")).as_bit());
+				if (in != NULL && bit_y.wire != NULL && !bit2index.count(bit_y)) {
+					std::vector<uint64_t> buffer(in, in + num_words);
+					bit2index[bit_y] = GetSize(values) / num_words;
+					values.insert(values.end(), buffer.begin(), buffer.end());
+					num_simulated_cells++;
+				}
+				continue;
+			}
+
+			Aig aig(cell);
+			if (aig.name.empty()) {
+				num_unsupported_cells++;
+				continue;
+			}
+
+			node_values.resize(GetSize(aig.nodes) * num_words);
+			for (int i = 0; i < GetSize(aig.nodes); i++)
+			{
+				const AigNode &node = aig.nodes[i];
+				uint64_t *v = node_values.data() + i * num_words;
+
+				if (!node.portname.empty()) {
+					const uint64_t *in = input_value(sigmap(cell->getPort(node.portname)[node.portbit]));
+					if (in == NULL)
+						goto next_cell;
+					for (int k = 0; k < num_words; k++)
+						v[k] = in[k];
+				} else if (node.left_parent < 0) {
+					for (int k = 0; k < num_words; k++)
+						v[k] = 0;
+				} else {
+					const uint64_t *l = node_values.data() + node.left_parent * num_words;
+					const uint64_t *r = node_values.data() + node.right_parent * num_words;
+					for (int k = 0; k < num_words; k++)
+						v[k] = l[k] & r[k];
+				}
+
+				if (node.inverter)
+					for (int k = 0; k < num_words; k++)
+						v[k] = ~v[k];
+			}
+
+			for (int i = 0; i < GetSize(aig.nodes); i++)
+				for (auto &op : aig.nodes[i].outports) {
+					RTLIL::SigBit bit = sigmap(cell->getPort(op.first)[op.second]);
+					if (bit.wire == NULL || bit2index.count(bit))
+						continue;
+					bit2index[bit] = GetSize(values) / num_words;
+					values.insert(values.end(), node_values.begin() + i * num_words, node_values.begin() + (i+1) * num_words);
+				}
+
+			num_simulated_cells++;
+			num_aig_nodes += GetSize(aig.nodes);
+		next_cell:;
+		}
+	}
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,67 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef AIGSIM_H
+#define AIGSIM_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Bit-parallel random simulation of the Aig models of cells (kernel/cellaigs.h),
+// with 64 patterns in each of the num_words machine words per signal bit.
+//
+// Bits that are not driven by any of the added cells get random values. Outputs
+// of cells without Aig model (e.g. $mul or FFs) and of cells with undefined or
+// unknown inputs are unknown, i.e. value() returns NULL for them. $equiv cells
+// are simulated as buffers for their A input.
+
+struct AigSim
+{
+	const SigMap &sigmap;
+	int num_words;
+
+	// statistics for -v output of the passes using this
+	int num_cells, num_simulated_cells, num_unsupported_cells;
+	int64_t num_aig_nodes;
+
+	AigSim(const SigMap &sigmap, int num_words = 4);
+
+	void add_cell(RTLIL::Cell *cell);
+	void run(uint32_t seed = 1);
+
+	const uint64_t *value(RTLIL::SigBit bit) const;
+
+	int num_patterns() const { return 64 * num_words; }
+
+private:
+	std::vector<RTLIL::Cell*> cells;
+	dict<RTLIL::SigBit, RTLIL::Cell*> bit2driver;
+	dict<RTLIL::SigBit, int> bit2index;
+	std::vector<uint64_t> values;
+	uint32_t rng_state;
+
+	uint64_t rng();
+	const uint64_t *input_value(RTLIL::SigBit bit);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,370 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/bitsim.h"
+#include "kernel/celltypes.h"
+#include "kernel/utils.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+BitSim::BitSim(RTLIL::Module *module) : module(module), sigmap(module), ce(module)
+{
+	num_fine_cells = 0;
+	num_coarse_cells = 0;
+
+	CellTypes ct;
+	ct.setup_internals();
+	ct.setup_stdcells();
+
+	for (auto cell : module->cells()) {
+		if (!ct.cell_known(cell->type))
+			continue;
+		for (auto &conn : cell->connections())
+			if (ct.cell_output(cell->type, conn.first))
+				for (auto bit : sigmap(conn.second))
+					if (bit.wire != NULL)
+						bit2driver[bit] = cell;
+	}
+
+	// index 0, 1 and 2 are the constants 0, 1 and x
+	ones = { 0, ~uint64_t(0), 0 };
+	zeros = { ~uint64_t(0), 0, 0 };
+}
+
+int BitSim::bit_index(RTLIL::SigBit bit)
+{
+	if (bit.wire == NULL)
+		return bit.data == RTLIL::State::S0 ? 0 : bit.data == RTLIL::State::S1 ? 1 : 2;
+
+	auto it = bit2index.find(bit);
+	if (it != bit2index.end())
+		return it->second;
+
+	int index = GetSize(ones);
+	ones.push_back(0);
+	zeros.push_back(0);
+	bit2index[bit] = index;
+	return index;
+}
+
+void BitSim::add_source(RTLIL::SigSpec sig)
+{
+	for (auto bit : sigmap(sig))
+		if (bit.wire != NULL) {
+			sources.insert(bit);
+			bit_index(bit);
+		}
+}
+
+void BitSim::compile(RTLIL::SigSpec targets, RTLIL::SigSpec &undef)
+{
+	pool<RTLIL::SigBit> visited_bits;
+	pool<RTLIL::Cell*> cone;
+	std::vector<RTLIL::SigBit> queue;
+
+	for (auto bit : sigmap(targets))
+		queue.push_back(bit);
+
+	while (!queue.empty())
+	{
+		RTLIL::SigBit bit = queue.back();
+		queue.pop_back();
+
+		if (bit.wire == NULL || sources.count(bit) || visited_bits.count(bit))
+			continue;
+		visited_bits.insert(bit);
+
+		auto it = bit2driver.find(bit);
+		if (it == bit2driver.end()) {
+			undef.append(bit);
+			add_source(bit);
+			continue;
+		}
+
+		RTLIL::Cell *cell = it->second;
+		if (cone.count(cell))
+			continue;
+		cone.insert(cell);
+
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first))
+				for (auto in_bit : sigmap(conn.second))
+					queue.push_back(in_bit);
+	}
+
+	TopoSort<RTLIL::Cell*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>> toposort;
+	toposort.analyze_loops = false;
+
+	for (auto cell : cone) {
+		toposort.node(cell);
+		for (auto &conn : cell->connections())
+			if (cell->input(conn.first))
+				for (auto bit : sigmap(conn.second)) {
+					if (bit.wire == NULL || sources.count(bit))
+						continue;
+					RTLIL::Cell *driver = bit2driver.at(bit);
+					if (driver != cell)
+						toposort.edge(driver, cell);
+					else
+						log_error("Found logic loop through cell %s in module %s.\n", log_id(cell), log_id(module));
+				}
+	}
+
+	toposort.sort();
+	if (toposort.found_loops)
+		log_error("Found logic loop in input cone of %s in module %s.\n", log_signal(targets), log_id(module));
+
+	num_fine_cells = 0;
+	num_coarse_cells = 0;
+
+	for (auto cell : toposort.sorted)
+	{
+		op_t op;
+		op.cell = cell;
+		op.y = op.a = op.b = op.c = op.d = 2;
+
+		if (cell->type == "$_BUF_")
+			op.type = OP_BUF;
+		else if (cell->type == "$_NOT_")
+			op.type = OP_NOT;
+		else if (cell->type == "$_AND_")
+			op.type = OP_AND;
+		else if (cell->type == "$_NAND_")
+			op.type = OP_NAND;
+		else if (cell->type == "$_OR_")
+			op.type = OP_OR;
+		else if (cell->type == "$_NOR_")
+			op.type = OP_NOR;
+		else if (cell->type == "$_XOR_")
+			op.type = OP_XOR;
+		else if (cell->type == "$_XNOR_")
+			op.type = OP_XNOR;
+		else if (cell->type == "$_MUX_")
+			op.type = OP_MUX;
+		else if (cell->type == "$_AOI3_")
+			op.type = OP_AOI3;
+		else if (cell->type == "$_OAI3_")
+			op.type = OP_OAI3;
+		else if (cell->type == "$_AOI4_")
+			op.type = OP_AOI4;
+		else if (cell->type == "$_OAI4_")
+			op.type = OP_OAI4;
+		else
+			op.type = OP_CELL;
+
+		if (op.type != OP_CELL)
+		{
+			op.y = bit_index(sigmap(cell->getPort("\\Y")).as_bit());
+			if (cell->hasPort("\\A"))
+				op.a = bit_index(sigmap(cell->getPort("\\A")).as_bit());
+			if (cell->hasPort("\\B"))
+				op.b = bit_index(sigmap(cell->getPort("\\B")).as_bit());
+			if (cell->hasPort("\\C"))
+				op.c = bit_index(sigmap(cell->getPort("\\C")).as_bit());
+			if (cell->hasPort("\\D"))
+				op.d = bit_index(sigmap(cell->getPort("\\D")).as_bit());
+			if (cell->hasPort("\\S"))
+				op.c = bit_index(sigmap(cell->getPort("\\S")).as_bit());
+			num_fine_cells++;
+		}
+		else
+		{
+			pool<RTLIL::SigBit> input_bits;
+			for (auto &conn : cell->connections())
+				if (cell->input(conn.first))
+					for (auto bit : sigmap(conn.second))
+						if (bit.wire != NULL && !input_bits.count(bit)) {
+							input_bits.insert(bit);
+							op.cell_inputs.append(bit);
+							op.input_idx.push_back(bit_index(bit));
+						}
+			for (auto &conn : cell->connections())
+				if (cell->output(conn.first))
+					for (auto bit : sigmap(conn.second))
+						if (bit.wire != NULL && !input_bits.count(bit)) {
+							op.cell_outputs.append(bit);
+							op.output_idx.push_back(sources.count(bit) ? -1 : bit_index(bit));
+						}
+			num_coarse_cells++;
+		}
+
+		ops.push_back(op);
+	}
+}
+
+void BitSim::set(RTLIL::SigSpec sig, int lane, RTLIL::Const value)
+{
+	sig = sigmap(sig);
+	log_assert(GetSize(sig) == GetSize(value));
+
+	uint64_t mask = uint64_t(1) << lane;
+	for (int i = 0; i < GetSize(sig); i++) {
+		if (sig[i].wire == NULL)
+			continue;
+		int index = bit_index(sig[i]);
+		ones[index] &= ~mask;
+		zeros[index] &= ~mask;
+		if (value.bits[i] == RTLIL::State::S1)
+			ones[index] |= mask;
+		if (value.bits[i] == RTLIL::State::S0)
+			zeros[index] |= mask;
+	}
+}
+
+void BitSim::set_all(RTLIL::SigSpec sig, RTLIL::Const value)
+{
+	sig = sigmap(sig);
+	log_assert(GetSize(sig) == GetSize(value));
+
+	for (int i = 0; i < GetSize(sig); i++) {
+		if (sig[i].wire == NULL)
+			continue;
+		int index = bit_index(sig[i]);
+		ones[index] = value.bits[i] == RTLIL::State::S1 ? ~uint64_t(0) : 0;
+		zeros[index] = value.bits[i] == RTLIL::State::S0 ? ~uint64_t(0) : 0;
+	}
+}
+
+RTLIL::Const BitSim::get(RTLIL::SigSpec sig, int lane) const
+{
+	sig = sigmap(sig);
+	RTLIL::Const value(RTLIL::State::Sx, GetSize(sig));
+
+	for (int i = 0; i < GetSize(sig); i++) {
+		if (sig[i].wire == NULL) {
+			value.bits[i] = sig[i].data;
+			continue;
+		}
+		auto it = bit2index.find(sig[i]);
+		if (it == bit2index.end())
+			continue;
+		if ((ones[it->second] >> lane) & 1)
+			value.bits[i] = RTLIL::State::S1;
+		if ((zeros[it->second] >> lane) & 1)
+			value.bits[i] = RTLIL::State::S0;
+	}
+
+	return value;
+}
+
+void BitSim::eval_cell(const op_t &op, int num_lanes)
+{
+	RTLIL::Const in_value(RTLIL::State::Sx, GetSize(op.input_idx));
+
+	for (int lane = 0; lane < num_lanes; lane++)
+	{
+		for (int i = 0; i < GetSize(op.input_idx); i++) {
+			int index = op.input_idx[i];
+			in_value.bits[i] = (ones[index] >> lane) & 1 ? RTLIL::State::S1 :
+					(zeros[index] >> lane) & 1 ? RTLIL::State::S0 : RTLIL::State::Sx;
+		}
+
+		RTLIL::SigSpec out_value = op.cell_outputs, undef;
+		ce.push();
+		if (!op.cell_inputs.empty())
+			ce.set(op.cell_inputs, in_value);
+		bool ok = ce.eval(out_value, undef);
+		ce.pop();
+
+		uint64_t mask = uint64_t(1) << lane;
+		for (int i = 0; i < GetSize(op.output_idx); i++) {
+			int index = op.output_idx[i];
+			if (index < 0)
+				continue;
+			ones[index] &= ~mask;
+			zeros[index] &= ~mask;
+			if (ok && out_value[i] == RTLIL::State::S1)
+				ones[index] |= mask;
+			if (ok && out_value[i] == RTLIL::State::S0)
+				zeros[index] |= mask;
+		}
+	}
+}
+
+void BitSim::run(int num_lanes)
+{
+	log_assert(0 < num_lanes && num_lanes <= 64);
+
+	// with ones/zeros for each bit, AND and OR are exact for x inputs and XOR
+	// is only defined in lanes where both inputs are defined, like in calc.cc
+	uint64_t *o = ones.data(), *z = zeros.data();
+
+	for (auto &op : ops)
+	{
+		int y = op.y, a = op.a, b = op.b, c = op.c, d = op.d;
+		uint64_t t1, t0, u1, u0;
+
+		switch (op.type)
+		{
+		case OP_BUF:
+			o[y] = o[a], z[y] = z[a];
+			break;
+		case OP_NOT:
+			o[y] = z[a], z[y] = o[a];
+			break;
+		case OP_AND:
+			o[y] = o[a] & o[b], z[y] = z[a] | z[b];
+			break;
+		case OP_NAND:
+			z[y] = o[a] & o[b], o[y] = z[a] | z[b];
+			break;
+		case OP_OR:
+			o[y] = o[a] | o[b], z[y] = z[a] & z[b];
+			break;
+		case OP_NOR:
+			z[y] = o[a] | o[b], o[y] = z[a] & z[b];
+			break;
+		case OP_XOR:
+			o[y] = (o[a] & z[b]) | (z[a] & o[b]), z[y] = (o[a] & o[b]) | (z[a] & z[b]);
+			break;
+		case OP_XNOR:
+			z[y] = (o[a] & z[b]) | (z[a] & o[b]), o[y] = (o[a] & o[b]) | (z[a] & z[b]);
+			break;
+		case OP_MUX:
+			// an undefined select only passes bits that are the same on A and B
+			t1 = ~(o[c] | z[c]);
+			o[y] = (z[c] & o[a]) | (o[c] & o[b]) | (t1 & o[a] & o[b]);
+			z[y] = (z[c] & z[a]) | (o[c] & z[b]) | (t1 & z[a] & z[b]);
+			break;
+		case OP_AOI3:
+			t1 = o[a] & o[b], t0 = z[a] | z[b];
+			z[y] = t1 | o[c], o[y] = t0 & z[c];
+			break;
+		case OP_OAI3:
+			t1 = o[a] | o[b], t0 = z[a] & z[b];
+			z[y] = t1 & o[c], o[y] = t0 | z[c];
+			break;
+		case OP_AOI4:
+			t1 = o[a] & o[b], t0 = z[a] | z[b];
+			u1 = o[c] & o[d], u0 = z[c] | z[d];
+			z[y] = t1 | u1, o[y] = t0 & u0;
+			break;
+		case OP_OAI4:
+			t1 = o[a] | o[b], t0 = z[a] & z[b];
+			u1 = o[c] | o[d], u0 = z[c] & z[d];
+			z[y] = t1 & u1, o[y] = t0 | u0;
+			break;
+		case OP_CELL:
+			eval_cell(op, num_lanes);
+			break;
+		}
+	}
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,95 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef BITSIM_H
+#define BITSIM_H
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/consteval.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Compiled simulator for the combinational cells of a module, evaluating up to
+// 64 input vectors ("lanes") at once with the same results as ConstEval.
+//
+// compile() levelizes the input cone of the requested signals into an array of
+// operations. Each signal bit is stored as a pair of 64 bit words (lanes that
+// are 1, lanes that are 0; lanes in neither word are x). Fine-grained cells
+// ($_AND_, $_MUX_, ...) are evaluated for all lanes with a few word operations.
+// Coarse cells are evaluated lane by lane with ConstEval, so the x semantics
+// match the eval command exactly.
+
+struct BitSim
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+
+	// statistics, set by compile()
+	int num_fine_cells, num_coarse_cells;
+
+	BitSim(RTLIL::Module *module);
+
+	// bits that get their values from set() and are not evaluated from their
+	// drivers. must be called before compile().
+	void add_source(RTLIL::SigSpec sig);
+
+	// create the schedule for computing the targets. bits in the input cone of
+	// the targets that are neither driven by a combinational cell nor sources are
+	// added to undef and become sources with the value x.
+	void compile(RTLIL::SigSpec targets, RTLIL::SigSpec &undef);
+
+	// source values of a lane. source bits that are never set are x.
+	void set(RTLIL::SigSpec sig, int lane, RTLIL::Const value);
+	void set_all(RTLIL::SigSpec sig, RTLIL::Const value);
+
+	void run(int num_lanes = 64);
+
+	RTLIL::Const get(RTLIL::SigSpec sig, int lane) const;
+
+private:
+	enum op_type_t {
+		OP_BUF, OP_NOT, OP_AND, OP_NAND, OP_OR, OP_NOR, OP_XOR, OP_XNOR,
+		OP_MUX, OP_AOI3, OP_OAI3, OP_AOI4, OP_OAI4, OP_CELL
+	};
+
+	struct op_t {
+		op_type_t type;
+		int y, a, b, c, d;
+		RTLIL::Cell *cell;
+		RTLIL::SigSpec cell_inputs, cell_outputs;
+		std::vector<int> input_idx, output_idx;
+	};
+
+	ConstEval ce;
+	dict<RTLIL::SigBit, RTLIL::Cell*> bit2driver;
+	dict<RTLIL::SigBit, int> bit2index;
+	pool<RTLIL::SigBit> sources;
+	std::vector<op_t> ops;
+
+	// ones[i] and zeros[i] are the lanes in which bit i is 1 and 0
+	std::vector<uint64_t> ones, zeros;
+
+	int bit_index(RTLIL::SigBit bit);
+	void eval_cell(const op_t &op, int num_lanes);
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
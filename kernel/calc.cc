@@ -97,6 +97,147 @@ static RTLIL::Const big2const(const BigInteger &val, int result_len, int undef_b
 	return result;
 }
 
+// Fast path for the common case of small fully defined constants: Values with
+// up to 62 bits (plus sign) are handled with native integers, so that sums,
+// differences and (for narrow enough arguments) products can not overflow.
+// Everything else falls back to BigInteger.
+
+static const int fast_const_bits = 62;
+
+static bool const2int(const RTLIL::Const &val, bool as_signed, int64_t &result)
+{
+	int num_bits = GetSize(val.bits);
+	if (num_bits > fast_const_bits)
+		return false;
+
+	uint64_t mag = 0;
+	for (int i = 0; i < num_bits; i++) {
+		if (val.bits[i] == RTLIL::State::S1)
+			mag |= uint64_t(1) << i;
+		else if (val.bits[i] != RTLIL::State::S0)
+			return false;
+	}
+
+	if (as_signed && num_bits > 0 && val.bits[num_bits-1] == RTLIL::State::S1)
+		mag |= ~uint64_t(0) << num_bits;
+
+	result = int64_t(mag);
+	return true;
+}
+
+static RTLIL::Const int2const(int64_t val, int result_len)
+{
+	RTLIL::Const result(RTLIL::State::S0, result_len);
+	for (int i = 0; i < result_len; i++)
+		if ((val >> min(i, 63)) & 1)
+			result.bits[i] = RTLIL::State::S1;
+	return result;
+}
+
+// Wide fully defined arguments of $add, $sub and $mul are processed in 32-bit
+// limbs (with 64-bit intermediate results). These functions compute modulo
+// 2^result_len, so both arguments are extended to result_len bits first.
+
+static bool const2limbs(const RTLIL::Const &val, bool as_signed, int width, std::vector<uint32_t> &limbs)
+{
+	int num_bits = GetSize(val.bits);
+	limbs.assign((width + 31) / 32, 0);
+
+	for (int i = 0; i < num_bits; i++) {
+		if (val.bits[i] == RTLIL::State::S1) {
+			if (i < width)
+				limbs[i / 32] |= uint32_t(1) << (i % 32);
+		} else if (val.bits[i] != RTLIL::State::S0)
+			return false;
+	}
+
+	if (as_signed && num_bits > 0 && val.bits[num_bits-1] == RTLIL::State::S1)
+		for (int i = num_bits; i < width; i++)
+			limbs[i / 32] |= uint32_t(1) << (i % 32);
+
+	return true;
+}
+
+static RTLIL::Const limbs2const(const std::vector<uint32_t> &limbs, int width)
+{
+	RTLIL::Const result(RTLIL::State::S0, width);
+	for (int i = 0; i < width; i++)
+		if ((limbs[i / 32] >> (i % 32)) & 1)
+			result.bits[i] = RTLIL::State::S1;
+	return result;
+}
+
+static bool const_limbs_arith(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len, char op, RTLIL::Const &result)
+{
+	std::vector<uint32_t> a, b, y;
+	if (!const2limbs(arg1, signed1, result_len, a) || !const2limbs(arg2, signed2, result_len, b))
+		return false;
+
+	int n = GetSize(a);
+	y.assign(n, 0);
+
+	if (op == '+') {
+		uint64_t carry = 0;
+		for (int i = 0; i < n; i++) {
+			uint64_t sum = uint64_t(a[i]) + b[i] + carry;
+			y[i] = uint32_t(sum);
+			carry = sum >> 32;
+		}
+	} else if (op == '-') {
+		uint64_t borrow = 0;
+		for (int i = 0; i < n; i++) {
+			uint64_t diff = uint64_t(a[i]) - b[i] - borrow;
+			y[i] = uint32_t(diff);
+			borrow = (diff >> 32) & 1;
+		}
+	} else {
+		log_assert(op == '*');
+		for (int i = 0; i < n; i++) {
+			if (a[i] == 0)
+				continue;
+			uint64_t carry = 0;
+			for (int j = 0; i + j < n; j++) {
+				uint64_t prod = uint64_t(a[i]) * b[j] + y[i+j] + carry;
+				y[i+j] = uint32_t(prod);
+				carry = prod >> 32;
+			}
+		}
+	}
+
+	result = limbs2const(y, result_len);
+	return true;
+}
+
+// Shift amounts are saturated to +/- 2^40, which shifts out every bit of any
+// constant. Returns false if the shift amount has undefined bits.
+static bool const2offset(const RTLIL::Const &val, bool as_signed, int64_t &result)
+{
+	const int max_bits = 40;
+	int num_bits = GetSize(val.bits);
+	RTLIL::State sign = as_signed && num_bits > 0 ? val.bits.back() : RTLIL::State::S0;
+	bool saturate = false;
+	uint64_t mag = 0;
+
+	for (int i = 0; i < num_bits; i++) {
+		if (val.bits[i] != RTLIL::State::S0 && val.bits[i] != RTLIL::State::S1)
+			return false;
+		if (i < max_bits) {
+			if (val.bits[i] == RTLIL::State::S1)
+				mag |= uint64_t(1) << i;
+		} else if (val.bits[i] != sign)
+			saturate = true;
+	}
+
+	if (sign == RTLIL::State::S1)
+		mag |= ~uint64_t(0) << min(num_bits, max_bits);
+
+	if (saturate)
+		result = sign == RTLIL::State::S1 ? -(int64_t(1) << max_bits) : int64_t(1) << max_bits;
+	else
+		result = int64_t(mag);
+	return true;
+}
+
 static RTLIL::State logic_and(RTLIL::State a, RTLIL::State b)
 {
 	if (a == RTLIL::State::S0) return RTLIL::State::S0;
@@ -129,40 +270,46 @@ static RTLIL::State logic_xnor(RTLIL::State a, RTLIL::State b)
 	return a == b ? RTLIL::State::S1 : RTLIL::State::S0;
 }
 
+// padding bit for extending a constant like extend_u0(), used by the bitwise
+// functions below to read extended arguments without copying them
+static inline RTLIL::State ext_padding(const RTLIL::Const &arg, bool is_signed)
+{
+	return is_signed && !arg.bits.empty() ? arg.bits.back() : RTLIL::State::S0;
+}
+
 RTLIL::Const RTLIL::const_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
 {
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
-	RTLIL::Const arg1_ext = arg1;
-	extend_u0(arg1_ext, result_len, signed1);
+	int width1 = min(GetSize(arg1), result_len);
+	RTLIL::State padding = ext_padding(arg1, signed1);
 
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		if (i >= arg1_ext.bits.size())
-			result.bits[i] = RTLIL::State::S0;
-		else if (arg1_ext.bits[i] == RTLIL::State::S0)
+	for (int i = 0; i < result_len; i++) {
+		RTLIL::State bit = i < width1 ? arg1.bits[i] : padding;
+		if (bit == RTLIL::State::S0)
 			result.bits[i] = RTLIL::State::S1;
-		else if (arg1_ext.bits[i] == RTLIL::State::S1)
+		else if (bit == RTLIL::State::S1)
 			result.bits[i] = RTLIL::State::S0;
 	}
 
 	return result;
 }
 
-static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State),
-		RTLIL::Const arg1, RTLIL::Const arg2, bool signed1, bool signed2, int result_len = -1)
+template<RTLIL::State (*logic_func)(RTLIL::State, RTLIL::State)>
+static RTLIL::Const logic_wrapper(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len = -1)
 {
 	if (result_len < 0)
 		result_len = max(arg1.bits.size(), arg2.bits.size());
 
-	extend_u0(arg1, result_len, signed1);
-	extend_u0(arg2, result_len, signed2);
+	int width1 = min(GetSize(arg1), result_len), width2 = min(GetSize(arg2), result_len);
+	RTLIL::State padding1 = ext_padding(arg1, signed1), padding2 = ext_padding(arg2, signed2);
 
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
-	for (size_t i = 0; i < size_t(result_len); i++) {
-		RTLIL::State a = i < arg1.bits.size() ? arg1.bits[i] : RTLIL::State::S0;
-		RTLIL::State b = i < arg2.bits.size() ? arg2.bits[i] : RTLIL::State::S0;
+	for (int i = 0; i < result_len; i++) {
+		RTLIL::State a = i < width1 ? arg1.bits[i] : padding1;
+		RTLIL::State b = i < width2 ? arg2.bits[i] : padding2;
 		result.bits[i] = logic_func(a, b);
 	}
 
@@ -171,29 +318,32 @@ static RTLIL::Const logic_wrapper(RTLIL::State(*logic_func)(RTLIL::State, RTLIL:
 
 RTLIL::Const RTLIL::const_and(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_and, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper<logic_and>(arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_or(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_or, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper<logic_or>(arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_xor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xor, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper<logic_xor>(arg1, arg2, signed1, signed2, result_len);
 }
 
 RTLIL::Const RTLIL::const_xnor(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	return logic_wrapper(logic_xnor, arg1, arg2, signed1, signed2, result_len);
+	return logic_wrapper<logic_xnor>(arg1, arg2, signed1, signed2, result_len);
 }
 
-static RTLIL::Const logic_reduce_wrapper(RTLIL::State initial, RTLIL::State(*logic_func)(RTLIL::State, RTLIL::State), const RTLIL::Const &arg1, int result_len)
+// 'final_state' is the value that can not be changed by any further bits
+// (S0 for and, S1 for or, Sx for xor), so the loop can stop there.
+template<RTLIL::State (*logic_func)(RTLIL::State, RTLIL::State)>
+static RTLIL::Const logic_reduce_wrapper(RTLIL::State initial, RTLIL::State final_state, const RTLIL::Const &arg1, int result_len)
 {
 	RTLIL::State temp = initial;
 
-	for (size_t i = 0; i < arg1.bits.size(); i++)
+	for (size_t i = 0; i < arg1.bits.size() && temp != final_state; i++)
 		temp = logic_func(temp, arg1.bits[i]);
 
 	RTLIL::Const result(temp);
@@ -204,22 +354,22 @@ static RTLIL::Const logic_reduce_wrapper(RTLIL::State initial, RTLIL::State(*log
 
 RTLIL::Const RTLIL::const_reduce_and(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S1, logic_and, arg1, result_len);
+	return logic_reduce_wrapper<logic_and>(RTLIL::State::S1, RTLIL::State::S0, arg1, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_or(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	return logic_reduce_wrapper<logic_or>(RTLIL::State::S0, RTLIL::State::S1, arg1, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	return logic_reduce_wrapper<logic_xor>(RTLIL::State::S0, RTLIL::State::Sx, arg1, result_len);
 }
 
 RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	RTLIL::Const buffer = logic_reduce_wrapper(RTLIL::State::S0, logic_xor, arg1, result_len);
+	RTLIL::Const buffer = logic_reduce_wrapper<logic_xor>(RTLIL::State::S0, RTLIL::State::Sx, arg1, result_len);
 	if (!buffer.bits.empty()) {
 		if (buffer.bits.front() == RTLIL::State::S0)
 			buffer.bits.front() = RTLIL::State::S1;
@@ -231,7 +381,7 @@ RTLIL::Const RTLIL::const_reduce_xnor(const RTLIL::Const &arg1, const RTLIL::Con
 
 RTLIL::Const RTLIL::const_reduce_bool(const RTLIL::Const &arg1, const RTLIL::Const&, bool, bool, int result_len)
 {
-	return logic_reduce_wrapper(RTLIL::State::S0, logic_or, arg1, result_len);
+	return logic_reduce_wrapper<logic_or>(RTLIL::State::S0, RTLIL::State::S1, arg1, result_len);
 }
 
 RTLIL::Const RTLIL::const_logic_not(const RTLIL::Const &arg1, const RTLIL::Const&, bool signed1, bool, int result_len)
@@ -277,12 +427,27 @@ RTLIL::Const RTLIL::const_logic_or(const RTLIL::Const &arg1, const RTLIL::Const
 
 static RTLIL::Const const_shift_worker(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool sign_ext, int direction, int result_len)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
+	int64_t offset_int;
+	if (const2offset(arg2, false, offset_int)) {
+		RTLIL::Const result(RTLIL::State::S0, result_len);
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset_int * direction;
+			if (pos < 0)
+				result.bits[i] = RTLIL::State::S0;
+			else if (pos >= GetSize(arg1))
+				result.bits[i] = sign_ext ? arg1.bits.back() : RTLIL::State::S0;
+			else
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, false, undef_bit_pos) * direction;
+
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
 	if (undef_bit_pos >= 0)
 		return result;
@@ -330,12 +495,23 @@ RTLIL::Const RTLIL::const_sshr(const RTLIL::Const &arg1, const RTLIL::Const &arg
 
 static RTLIL::Const const_shift_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool, bool signed2, int result_len, RTLIL::State other_bits)
 {
-	int undef_bit_pos = -1;
-	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
-
 	if (result_len < 0)
 		result_len = arg1.bits.size();
 
+	int64_t offset_int;
+	if (const2offset(arg2, signed2, offset_int)) {
+		RTLIL::Const result(other_bits, result_len);
+		for (int i = 0; i < result_len; i++) {
+			int64_t pos = i + offset_int;
+			if (pos >= 0 && pos < GetSize(arg1))
+				result.bits[i] = arg1.bits[pos];
+		}
+		return result;
+	}
+
+	int undef_bit_pos = -1;
+	BigInteger offset = const2big(arg2, signed2, undef_bit_pos);
+
 	RTLIL::Const result(RTLIL::State::Sx, result_len);
 	if (undef_bit_pos >= 0)
 		return result;
@@ -364,7 +540,12 @@ RTLIL::Const RTLIL::const_shiftx(const RTLIL::Const &arg1, const RTLIL::Const &a
 RTLIL::Const RTLIL::const_lt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
 	int undef_bit_pos = -1;
-	bool y = const2big(arg1, signed1, undef_bit_pos) < const2big(arg2, signed2, undef_bit_pos);
+	int64_t a, b;
+	bool y;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		y = a < b;
+	else
+		y = const2big(arg1, signed1, undef_bit_pos) < const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
 
 	while (int(result.bits.size()) < result_len)
@@ -375,7 +556,12 @@ RTLIL::Const RTLIL::const_lt(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 RTLIL::Const RTLIL::const_le(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
 	int undef_bit_pos = -1;
-	bool y = const2big(arg1, signed1, undef_bit_pos) <= const2big(arg2, signed2, undef_bit_pos);
+	int64_t a, b;
+	bool y;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		y = a <= b;
+	else
+		y = const2big(arg1, signed1, undef_bit_pos) <= const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
 
 	while (int(result.bits.size()) < result_len)
@@ -385,21 +571,20 @@ RTLIL::Const RTLIL::const_le(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_eq(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	RTLIL::Const arg1_ext = arg1;
-	RTLIL::Const arg2_ext = arg2;
 	RTLIL::Const result(RTLIL::State::S0, result_len);
 
-	int width = max(arg1_ext.bits.size(), arg2_ext.bits.size());
-	extend_u0(arg1_ext, width, signed1 && signed2);
-	extend_u0(arg2_ext, width, signed1 && signed2);
+	int width1 = GetSize(arg1), width2 = GetSize(arg2);
+	RTLIL::State padding1 = ext_padding(arg1, signed1 && signed2), padding2 = ext_padding(arg2, signed1 && signed2);
 
 	RTLIL::State matched_status = RTLIL::State::S1;
-	for (size_t i = 0; i < arg1_ext.bits.size(); i++) {
-		if (arg1_ext.bits.at(i) == RTLIL::State::S0 && arg2_ext.bits.at(i) == RTLIL::State::S1)
+	for (int i = 0; i < max(width1, width2); i++) {
+		RTLIL::State a = i < width1 ? arg1.bits[i] : padding1;
+		RTLIL::State b = i < width2 ? arg2.bits[i] : padding2;
+		if (a == RTLIL::State::S0 && b == RTLIL::State::S1)
 			return result;
-		if (arg1_ext.bits.at(i) == RTLIL::State::S1 && arg2_ext.bits.at(i) == RTLIL::State::S0)
+		if (a == RTLIL::State::S1 && b == RTLIL::State::S0)
 			return result;
-		if (arg1_ext.bits.at(i) > RTLIL::State::S1 || arg2_ext.bits.at(i) > RTLIL::State::S1)
+		if (a > RTLIL::State::S1 || b > RTLIL::State::S1)
 			matched_status = RTLIL::State::Sx;
 	}
 
@@ -419,16 +604,15 @@ RTLIL::Const RTLIL::const_ne(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_eqx(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
-	RTLIL::Const arg1_ext = arg1;
-	RTLIL::Const arg2_ext = arg2;
 	RTLIL::Const result(RTLIL::State::S0, result_len);
 
-	int width = max(arg1_ext.bits.size(), arg2_ext.bits.size());
-	extend_u0(arg1_ext, width, signed1 && signed2);
-	extend_u0(arg2_ext, width, signed1 && signed2);
+	int width1 = GetSize(arg1), width2 = GetSize(arg2);
+	RTLIL::State padding1 = ext_padding(arg1, signed1 && signed2), padding2 = ext_padding(arg2, signed1 && signed2);
 
-	for (size_t i = 0; i < arg1_ext.bits.size(); i++) {
-		if (arg1_ext.bits.at(i) != arg2_ext.bits.at(i))
+	for (int i = 0; i < max(width1, width2); i++) {
+		RTLIL::State a = i < width1 ? arg1.bits[i] : padding1;
+		RTLIL::State b = i < width2 ? arg2.bits[i] : padding2;
+		if (a != b)
 			return result;
 	}
 
@@ -449,7 +633,12 @@ RTLIL::Const RTLIL::const_nex(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 RTLIL::Const RTLIL::const_ge(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
 	int undef_bit_pos = -1;
-	bool y = const2big(arg1, signed1, undef_bit_pos) >= const2big(arg2, signed2, undef_bit_pos);
+	int64_t a, b;
+	bool y;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		y = a >= b;
+	else
+		y = const2big(arg1, signed1, undef_bit_pos) >= const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
 
 	while (int(result.bits.size()) < result_len)
@@ -460,7 +649,12 @@ RTLIL::Const RTLIL::const_ge(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 RTLIL::Const RTLIL::const_gt(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
 	int undef_bit_pos = -1;
-	bool y = const2big(arg1, signed1, undef_bit_pos) > const2big(arg2, signed2, undef_bit_pos);
+	int64_t a, b;
+	bool y;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		y = a > b;
+	else
+		y = const2big(arg1, signed1, undef_bit_pos) > const2big(arg2, signed2, undef_bit_pos);
 	RTLIL::Const result(undef_bit_pos >= 0 ? RTLIL::State::Sx : y ? RTLIL::State::S1 : RTLIL::State::S0);
 
 	while (int(result.bits.size()) < result_len)
@@ -470,6 +664,14 @@ RTLIL::Const RTLIL::const_gt(const RTLIL::Const &arg1, const RTLIL::Const &arg2,
 
 RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a, b;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		return int2const(a + b, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()));
+
+	RTLIL::Const result;
+	if (const_limbs_arith(arg1, arg2, signed1, signed2, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), '+', result))
+		return result;
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) + const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -477,6 +679,14 @@ RTLIL::Const RTLIL::const_add(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a, b;
+	if (const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		return int2const(a - b, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()));
+
+	RTLIL::Const result;
+	if (const_limbs_arith(arg1, arg2, signed1, signed2, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), '-', result))
+		return result;
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) - const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), undef_bit_pos);
@@ -484,6 +694,14 @@ RTLIL::Const RTLIL::const_sub(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a, b;
+	if (GetSize(arg1) + GetSize(arg2) <= fast_const_bits && const2int(arg1, signed1, a) && const2int(arg2, signed2, b))
+		return int2const(a * b, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()));
+
+	RTLIL::Const result;
+	if (const_limbs_arith(arg1, arg2, signed1, signed2, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), '*', result))
+		return result;
+
 	int undef_bit_pos = -1;
 	BigInteger y = const2big(arg1, signed1, undef_bit_pos) * const2big(arg2, signed2, undef_bit_pos);
 	return big2const(y, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()), min(undef_bit_pos, 0));
@@ -491,6 +709,13 @@ RTLIL::Const RTLIL::const_mul(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a_int, b_int;
+	if (const2int(arg1, signed1, a_int) && const2int(arg2, signed2, b_int)) {
+		if (b_int == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		return int2const(a_int / b_int, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()));
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
@@ -504,6 +729,13 @@ RTLIL::Const RTLIL::const_div(const RTLIL::Const &arg1, const RTLIL::Const &arg2
 
 RTLIL::Const RTLIL::const_mod(const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 {
+	int64_t a_int, b_int;
+	if (const2int(arg1, signed1, a_int) && const2int(arg2, signed2, b_int)) {
+		if (b_int == 0)
+			return RTLIL::Const(RTLIL::State::Sx, result_len);
+		return int2const(a_int % b_int, result_len >= 0 ? result_len : max(arg1.bits.size(), arg2.bits.size()));
+	}
+
 	int undef_bit_pos = -1;
 	BigInteger a = const2big(arg1, signed1, undef_bit_pos);
 	BigInteger b = const2big(arg2, signed2, undef_bit_pos);
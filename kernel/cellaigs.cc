@@ -478,4 +478,93 @@ optimize:;
 	new_nodes.swap(nodes);
 }
 
+AigManager::AigManager(const SigMap &sigmap) : sigmap(sigmap)
+{
+	node_t const_node;
+	const_node.left = -1;
+	const_node.right = -1;
+	nodes.push_back(const_node);
+}
+
+int AigManager::lit_input(SigBit bit)
+{
+	bit = sigmap(bit);
+
+	if (bit == State::S0 || bit == State::S1)
+		return lit_const(bit == State::S1);
+
+	auto it = driven_bits.find(bit);
+	if (it != driven_bits.end())
+		return it->second;
+
+	it = input_cache.find(bit);
+	if (it != input_cache.end())
+		return it->second;
+
+	node_t node;
+	node.left = -1;
+	node.right = -1;
+	node.bit = bit;
+
+	int lit = 2*GetSize(nodes);
+	nodes.push_back(node);
+	input_cache[bit] = lit;
+	return lit;
+}
+
+int AigManager::lit_and(int a, int b)
+{
+	if (a > b)
+		std::swap(a, b);
+
+	if (a == lit_const(false) || a == lit_not(b))
+		return lit_const(false);
+	if (a == lit_const(true) || a == b)
+		return b;
+
+	pair<int, int> key(a, b);
+	auto it = and_cache.find(key);
+	if (it != and_cache.end())
+		return it->second;
+
+	node_t node;
+	node.left = a;
+	node.right = b;
+
+	int lit = 2*GetSize(nodes);
+	nodes.push_back(node);
+	and_cache[key] = lit;
+	return lit;
+}
+
+void AigManager::add_cell(Cell *cell, const Aig &aig, vector<pair<SigBit, int>> &outputs)
+{
+	vector<int> lits;
+	lits.reserve(GetSize(aig.nodes));
+
+	for (auto &node : aig.nodes)
+	{
+		int lit;
+
+		if (node.portbit >= 0)
+			lit = lit_input(cell->getPort(node.portname)[node.portbit]);
+		else if (node.left_parent < 0 && node.right_parent < 0)
+			lit = lit_const(false);
+		else
+			lit = lit_and(lits.at(node.left_parent), lits.at(node.right_parent));
+
+		if (node.inverter)
+			lit = lit_not(lit);
+
+		for (auto &op : node.outports) {
+			SigBit bit = cell->getPort(op.first)[op.second];
+			outputs.push_back(make_pair(bit, lit));
+			if (sigmap(bit).wire != nullptr)
+				driven_bits[sigmap(bit)] = lit;
+		}
+
+		lits.push_back(lit);
+	}
+}
+
 YOSYS_NAMESPACE_END
@@ -21,6 +21,7 @@
 #define CELLAIGS_H
 
 #include "kernel/yosys.h"
+#include "kernel/sigtools.h"
 
 YOSYS_NAMESPACE_BEGIN
 
@@ -47,6 +48,45 @@ struct Aig
 	unsigned int hash() const;
 };
 
+// A structurally hashed AIG for many cells of a module. Literals are integers,
+// with the node index in the upper bits and the complement flag in bit 0. Node 0
+// is the constant false node, all other nodes are either AND nodes or inputs
+// (signal bits that are not driven by any of the added cells' AIGs). Cell inputs
+// driven by the outputs of previously added cells are resolved to the driving
+// literals, so adding cells in topological order yields a single AIG.
+
+struct AigManager
+{
+	struct node_t
+	{
+		int left, right;
+		SigBit bit;
+	};
+
+	const SigMap &sigmap;
+	vector<node_t> nodes;
+	dict<pair<int, int>, int> and_cache;
+	dict<SigBit, int> input_cache;
+	dict<SigBit, int> driven_bits;
+
+	AigManager(const SigMap &sigmap);
+
+	static int lit_not(int lit) { return lit ^ 1; }
+	static int lit_const(bool value) { return value ? 1 : 0; }
+
+	bool is_const(int lit) const { return (lit >> 1) == 0; }
+	bool is_input(int lit) const { return (lit >> 1) != 0 && nodes[lit >> 1].left < 0; }
+	bool is_and(int lit) const { return nodes[lit >> 1].left >= 0; }
+
+	int lit_input(SigBit bit);
+	int lit_and(int a, int b);
+	int lit_or(int a, int b) { return lit_not(lit_and(lit_not(a), lit_not(b))); }
+
+	// instantiate the AIG of a cell, appends the (not sigmapped) output port
+	// bits of the cell together with their literals to the outputs vector
+	void add_cell(Cell *cell, const Aig &aig, vector<pair<SigBit, int>> &outputs);
+};
+
 YOSYS_NAMESPACE_END
 
 #endif
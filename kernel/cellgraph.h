@@ -0,0 +1,118 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CELLGRAPH_H
+#define CELLGRAPH_H
+
+#include "kernel/yosys.h"
+#include "kernel/utils.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// A graph with one node per cell and an edge from each cell to the cells that
+// read one of its output bits. The user of the graph decides which cells and
+// which bits of their ports are inputs and outputs, the bits should be mapped
+// with the same SigMap. Passes that already have dense indices for signal bits
+// use an SccGraph over these indices directly.
+//
+//	CellGraph graph;
+//	for (auto cell : module->cells())
+//		for (auto &conn : cell->connections())
+//			for (auto bit : sigmap(conn.second))
+//				if (ct.cell_output(cell->type, conn.first))
+//					graph.add_output(cell, bit);
+//				else
+//					graph.add_input(cell, bit);
+//	graph.build();
+//	for (auto &scc : graph.find_sccs()) ...
+
+struct CellGraph
+{
+	std::vector<RTLIL::Cell*> cells;
+	dict<RTLIL::Cell*, int> cell_index;
+	SccGraph graph;
+
+	int node(RTLIL::Cell *cell)
+	{
+		auto it = cell_index.find(cell);
+		if (it != cell_index.end())
+			return it->second;
+		cells.push_back(cell);
+		cell_index[cell] = graph.add_node();
+		return GetSize(cells)-1;
+	}
+
+	void add_input(RTLIL::Cell *cell, RTLIL::SigBit bit)
+	{
+		if (bit.wire != nullptr)
+			bit_readers[bit].push_back(node(cell));
+	}
+
+	void add_output(RTLIL::Cell *cell, RTLIL::SigBit bit)
+	{
+		if (bit.wire != nullptr)
+			bit_drivers[bit].push_back(node(cell));
+	}
+
+	// creates the edges from the inputs and outputs added so far
+	void build()
+	{
+		for (auto &it : bit_drivers) {
+			auto readers = bit_readers.find(it.first);
+			if (readers == bit_readers.end())
+				continue;
+			for (int from : it.second)
+				for (int to : readers->second)
+					graph.add_edge(from, to);
+		}
+		graph.unify_edges();
+		bit_drivers.clear();
+		bit_readers.clear();
+	}
+
+	// see SccGraph::find_sccs()
+	std::vector<std::vector<RTLIL::Cell*>> find_sccs(bool self_loops = true, int max_depth = -1) const
+	{
+		std::vector<std::vector<RTLIL::Cell*>> result;
+		for (auto &scc : graph.find_sccs(self_loops, max_depth)) {
+			result.emplace_back();
+			for (int n : scc)
+				result.back().push_back(cells[n]);
+		}
+		return result;
+	}
+
+	// returns false if there are loops, see SccGraph::topo_sort()
+	bool topo_sort(std::vector<RTLIL::Cell*> &order) const
+	{
+		std::vector<int> int_order;
+		bool ok = graph.topo_sort(int_order);
+		order.clear();
+		for (int n : int_order)
+			order.push_back(cells[n]);
+		return ok;
+	}
+
+private:
+	dict<RTLIL::SigBit, std::vector<int>> bit_drivers, bit_readers;
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CELLMATCH_H
+#define CELLMATCH_H
+
+#include "kernel/yosys.h"
+#include "kernel/modtools.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// A small framework for passes that look for patterns of cells around cells
+// of a few "anchor" types. A callback is registered for each anchor type and
+// is called once for every selected cell of that type. When a callback changes
+// the netlist it can re-trigger the anchor cells connected to the changed
+// signals, which are then matched again. The connectivity queries use the
+// module's ModIndex, which is kept up to date by the module itself.
+struct CellMatcher
+{
+	typedef std::function<void(RTLIL::Cell*)> callback_t;
+
+	RTLIL::Module *module;
+	ModIndex &index;
+	SigMap &sigmap;
+
+	dict<RTLIL::IdString, callback_t> rules;
+	dict<RTLIL::IdString, std::vector<RTLIL::Cell*>> cells_by_type;
+
+	std::vector<RTLIL::Cell*> worklist;
+	pool<RTLIL::Cell*> queued;
+
+	CellMatcher(RTLIL::Module *module) : module(module), index(module->modindex()), sigmap(index.sigmap)
+	{
+		if (index.auto_reload_module)
+			index.reload_module();
+
+		for (auto cell : module->selected_cells())
+			cells_by_type[cell->type].push_back(cell);
+	}
+
+	// the selected cells of the given type when the matcher was created
+	const std::vector<RTLIL::Cell*> &cells(RTLIL::IdString type)
+	{
+		static const std::vector<RTLIL::Cell*> empty;
+		auto it = cells_by_type.find(type);
+		return it == cells_by_type.end() ? empty : it->second;
+	}
+
+	void add_rule(RTLIL::IdString type, callback_t callback)
+	{
+		rules[type] = callback;
+	}
+
+	void trigger(RTLIL::Cell *cell)
+	{
+		if (rules.count(cell->type) == 0 || queued.count(cell) || !module->selected(cell))
+			return;
+		worklist.push_back(cell);
+		queued.insert(cell);
+	}
+
+	// queue all anchor cells that have a port connected to the signal
+	void trigger(const RTLIL::SigSpec &sig)
+	{
+		for (auto bit : sig)
+			for (auto &port : index.query_ports(bit))
+				trigger(port.cell);
+	}
+
+	// cells must be removed through this function while run() is active
+	void remove(RTLIL::Cell *cell)
+	{
+		queued.erase(cell);
+		module->remove(cell);
+	}
+
+	void run()
+	{
+		for (auto &it : rules)
+			for (auto cell : cells(it.first))
+				trigger(cell);
+
+		// the worklist is processed in order, so that on the first pass the
+		// cells of each anchor type are visited in module order
+		for (int i = 0; i < GetSize(worklist); i++) {
+			RTLIL::Cell *cell = worklist[i];
+			if (queued.count(cell) == 0)
+				continue;
+			queued.erase(cell);
+			rules.at(cell->type)(cell);
+		}
+
+		worklist.clear();
+	}
+
+	const pool<ModIndex::PortInfo> &ports(RTLIL::SigBit bit)
+	{
+		return index.query_ports(bit);
+	}
+
+	// all cells connected to at least one bit of the signal, except the given cell
+	pool<RTLIL::Cell*> other_cells(const RTLIL::SigSpec &sig, RTLIL::Cell *src = nullptr)
+	{
+		pool<RTLIL::Cell*> result;
+		for (auto bit : sig)
+			for (auto &port : index.query_ports(bit))
+				if (port.cell != src)
+					result.insert(port.cell);
+		return result;
+	}
+
+	// true if each bit of the signal is connected to at most one cell port
+	bool is_unconnected(const RTLIL::SigSpec &sig)
+	{
+		for (auto bit : sig)
+			if (GetSize(index.query_ports(bit)) > 1)
+				return false;
+		return true;
+	}
+
+	// true if every bit of the signal connects port a_port of cell a with port
+	// b_port of cell b. unless other_conns_allowed is set there must not be any
+	// other connections to the signal.
+	bool is_full_bus(const RTLIL::SigSpec &sig, RTLIL::Cell *a, RTLIL::IdString a_port,
+			RTLIL::Cell *b, RTLIL::IdString b_port, bool other_conns_allowed = false)
+	{
+		for (auto bit : sig)
+		{
+			bool found_a = false, found_b = false;
+			for (auto &port : index.query_ports(bit)) {
+				if (port.cell == a && port.port == a_port)
+					found_a = true;
+				else if (port.cell == b && port.port == b_port)
+					found_b = true;
+				else if (!other_conns_allowed)
+					return false;
+			}
+			if (!found_a || !found_b)
+				return false;
+		}
+		return true;
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -24,6 +24,64 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+// set up on first use by yosys_get_celltypes(), so that starting yosys
+// does not create the IdStrings for all internal cell types. it is not
+// changed after that, so it can be queried from several threads.
+struct CellTypes;
+extern CellTypes yosys_celltypes;
+CellTypes &yosys_get_celltypes();
+
+// All cell types of the internal cell library. CellTypeId has one CT_<name>
+// value per entry (e.g. CT_add for $add and CT__AND_ for $_AND_), so that
+// the cell evaluation and SAT code can dispatch with a switch on
+// cell_type_id(cell->type) instead of comparing IdStrings one after another.
+#define YOSYS_INTERNAL_CELL_TYPES(X) \
+	X(not) X(pos) X(neg) X(reduce_and) X(reduce_or) X(reduce_xor) X(reduce_xnor) X(reduce_bool) \
+	X(logic_not) X(slice) X(lut) X(and) X(or) X(xor) X(xnor) X(shl) X(shr) X(sshl) X(sshr) \
+	X(shift) X(shiftx) X(lt) X(le) X(eq) X(ne) X(eqx) X(nex) X(ge) X(gt) X(add) X(sub) \
+	X(mul) X(div) X(mod) X(pow) X(logic_and) X(logic_or) X(concat) X(macc) X(mux) X(pmux) \
+	X(lcu) X(alu) X(fa) X(tribuf) X(assert) X(assume) X(equiv) \
+	X(sr) X(dff) X(dffe) X(dffsr) X(adff) X(dlatch) X(dlatchsr) \
+	X(memrd) X(memwr) X(meminit) X(mem) X(fsm) \
+	X(_BUF_) X(_NOT_) X(_AND_) X(_NAND_) X(_OR_) X(_NOR_) X(_XOR_) X(_XNOR_) \
+	X(_MUX_) X(_MUX4_) X(_MUX8_) X(_MUX16_) X(_AOI3_) X(_OAI3_) X(_AOI4_) X(_OAI4_) X(_TBUF_) \
+	X(_SR_NN_) X(_SR_NP_) X(_SR_PN_) X(_SR_PP_) X(_DFF_N_) X(_DFF_P_) \
+	X(_DFFE_NN_) X(_DFFE_NP_) X(_DFFE_PN_) X(_DFFE_PP_) \
+	X(_DFF_NN0_) X(_DFF_NN1_) X(_DFF_NP0_) X(_DFF_NP1_) X(_DFF_PN0_) X(_DFF_PN1_) X(_DFF_PP0_) X(_DFF_PP1_) \
+	X(_DFFSR_NNN_) X(_DFFSR_NNP_) X(_DFFSR_NPN_) X(_DFFSR_NPP_) \
+	X(_DFFSR_PNN_) X(_DFFSR_PNP_) X(_DFFSR_PPN_) X(_DFFSR_PPP_) \
+	X(_DLATCH_N_) X(_DLATCH_P_) \
+	X(_DLATCHSR_NNN_) X(_DLATCHSR_NNP_) X(_DLATCHSR_NPN_) X(_DLATCHSR_NPP_) \
+	X(_DLATCHSR_PNN_) X(_DLATCHSR_PNP_) X(_DLATCHSR_PPN_) X(_DLATCHSR_PPP_)
+
+enum CellTypeId {
+	CT_NONE,
+#define X(_t) CT_ ## _t,
+	YOSYS_INTERNAL_CELL_TYPES(X)
+#undef X
+	CT_COUNT
+};
+
+// indexed by IdString::index_, filled in by yosys_get_celltypes()
+extern std::vector<CellTypeId> yosys_cell_type_ids;
+
+// CT_NONE for everything that is not an internal cell type
+inline CellTypeId cell_type_id(RTLIL::IdString type)
+{
+	if (yosys_cell_type_ids.empty())
+		yosys_get_celltypes();
+	return type.index_ < GetSize(yosys_cell_type_ids) ? yosys_cell_type_ids[type.index_] : CT_NONE;
+}
+
+template<typename... Args>
+inline bool cell_type_in(CellTypeId id, Args... ids)
+{
+	for (CellTypeId it : {ids...})
+		if (id == it)
+			return true;
+	return false;
+}
+
 struct CellType
 {
 	RTLIL::IdString type;
@@ -35,6 +93,23 @@ struct CellTypes
 {
 	dict<RTLIL::IdString, CellType> cell_types;
 
+	// The queries below use dense tables indexed by IdString::index_ instead
+	// of looking up the type and port names in cell_types. Each port name
+	// that is used by a known type gets one of the 64 bits of the input and
+	// output masks. Types that use port names without a bit (and types with
+	// a name index beyond the dense table) are looked up in cell_types.
+	struct TypeInfo {
+		uint64_t inputs, outputs;
+		bool exact, is_evaluable;
+	};
+
+	static const int dense_type_limit = 1 << 20;
+
+	std::vector<TypeInfo> type_infos;
+	std::vector<int> type_slots, port_bits;
+	dict<RTLIL::IdString, int> sparse_type_slots;
+	bool index_dirty = true;
+
 	CellTypes()
 	{
 	}
@@ -46,19 +121,99 @@ struct CellTypes
 
 	void setup(RTLIL::Design *design = NULL)
 	{
-		if (design)
-			setup_design(design);
+		// all instances except the global one copy the internal cell library
+		// instead of setting it up again
+		if (this == &yosys_celltypes) {
+			setup_internals();
+			setup_internals_mem();
+			setup_stdcells();
+			setup_stdcells_mem();
+		} else {
+			for (auto &it : yosys_get_celltypes().cell_types)
+				cell_types[it.first] = it.second;
+			index_dirty = true;
+		}
 
-		setup_internals();
-		setup_internals_mem();
-		setup_stdcells();
-		setup_stdcells_mem();
+		// the internal cell types take precedence over modules of the same name
+		if (design)
+			for (auto module : design->modules())
+				if (!yosys_get_celltypes().cell_known(module->name))
+					setup_module(module);
 	}
 
 	void setup_type(RTLIL::IdString type, const pool<RTLIL::IdString> &inputs, const pool<RTLIL::IdString> &outputs, bool is_evaluable = false)
 	{
 		CellType ct = {type, inputs, outputs, is_evaluable};
 		cell_types[ct.type] = ct;
+		index_dirty = true;
+	}
+
+	void build_index()
+	{
+		type_infos.clear();
+		type_slots.clear();
+		port_bits.clear();
+		sparse_type_slots.clear();
+
+		int next_bit = 0;
+		auto assign_bit = [&](RTLIL::IdString port) -> int {
+			if (port.index_ >= GetSize(port_bits))
+				port_bits.resize(port.index_ + 1, -1);
+			if (port_bits[port.index_] < 0 && next_bit < 64)
+				port_bits[port.index_] = next_bit++;
+			return port_bits[port.index_];
+		};
+
+		for (auto &it : cell_types)
+		{
+			const CellType &ct = it.second;
+			TypeInfo info = {0, 0, true, ct.is_evaluable};
+
+			for (auto port : ct.inputs) {
+				int bit = assign_bit(port);
+				if (bit < 0)
+					info.exact = false;
+				else
+					info.inputs |= uint64_t(1) << bit;
+			}
+
+			for (auto port : ct.outputs) {
+				int bit = assign_bit(port);
+				if (bit < 0)
+					info.exact = false;
+				else
+					info.outputs |= uint64_t(1) << bit;
+			}
+
+			int slot = GetSize(type_infos);
+			type_infos.push_back(info);
+
+			if (ct.type.index_ < dense_type_limit) {
+				if (ct.type.index_ >= GetSize(type_slots))
+					type_slots.resize(ct.type.index_ + 1, -1);
+				type_slots[ct.type.index_] = slot;
+			} else
+				sparse_type_slots[ct.type] = slot;
+		}
+
+		index_dirty = false;
+	}
+
+	const TypeInfo *type_info(RTLIL::IdString type)
+	{
+		if (index_dirty)
+			build_index();
+		if (type.index_ < GetSize(type_slots))
+			return type_slots[type.index_] < 0 ? nullptr : &type_infos[type_slots[type.index_]];
+		if (type.index_ < dense_type_limit)
+			return nullptr;
+		auto it = sparse_type_slots.find(type);
+		return it == sparse_type_slots.end() ? nullptr : &type_infos[it->second];
+	}
+
+	int port_bit(RTLIL::IdString port) const
+	{
+		return port.index_ < GetSize(port_bits) ? port_bits[port.index_] : -1;
 	}
 
 	void setup_module(RTLIL::Module *module)
@@ -211,29 +366,40 @@ struct CellTypes
 	void clear()
 	{
 		cell_types.clear();
+		index_dirty = true;
 	}
 
 	bool cell_known(RTLIL::IdString type)
 	{
-		return cell_types.count(type) != 0;
+		return type_info(type) != nullptr;
 	}
 
 	bool cell_output(RTLIL::IdString type, RTLIL::IdString port)
 	{
-		auto it = cell_types.find(type);
-		return it != cell_types.end() && it->second.outputs.count(port) != 0;
+		const TypeInfo *info = type_info(type);
+		if (info == nullptr)
+			return false;
+		int bit = port_bit(port);
+		if (bit >= 0 && (info->outputs >> bit & 1) != 0)
+			return true;
+		return !info->exact && cell_types.at(type).outputs.count(port) != 0;
 	}
 
 	bool cell_input(RTLIL::IdString type, RTLIL::IdString port)
 	{
-		auto it = cell_types.find(type);
-		return it != cell_types.end() && it->second.inputs.count(port) != 0;
+		const TypeInfo *info = type_info(type);
+		if (info == nullptr)
+			return false;
+		int bit = port_bit(port);
+		if (bit >= 0 && (info->inputs >> bit & 1) != 0)
+			return true;
+		return !info->exact && cell_types.at(type).inputs.count(port) != 0;
 	}
 
 	bool cell_evaluable(RTLIL::IdString type)
 	{
-		auto it = cell_types.find(type);
-		return it != cell_types.end() && it->second.is_evaluable;
+		const TypeInfo *info = type_info(type);
+		return info != nullptr && info->is_evaluable;
 	}
 
 	static RTLIL::Const eval_not(RTLIL::Const v)
@@ -246,18 +412,21 @@ struct CellTypes
 
 	static RTLIL::Const eval(RTLIL::IdString type, const RTLIL::Const &arg1, const RTLIL::Const &arg2, bool signed1, bool signed2, int result_len)
 	{
-		if (type == "$sshr" && !signed1)
-			type = "$shr";
-		if (type == "$sshl" && !signed1)
-			type = "$shl";
+		CellTypeId id = cell_type_id(type);
+
+		if (id == CT_sshr && !signed1)
+			id = CT_shr;
+		if (id == CT_sshl && !signed1)
+			id = CT_shl;
 
-		if (type != "$sshr" && type != "$sshl" && type != "$shr" && type != "$shl" && type != "$shift" && type != "$shiftx" &&
-				type != "$pos" && type != "$neg" && type != "$not") {
+		if (!cell_type_in(id, CT_sshr, CT_sshl, CT_shr, CT_shl, CT_shift, CT_shiftx, CT_pos, CT_neg, CT_not)) {
 			if (!signed1 || !signed2)
 				signed1 = false, signed2 = false;
 		}
 
-#define HANDLE_CELL_TYPE(_t) if (type == "$" #_t) return const_ ## _t(arg1, arg2, signed1, signed2, result_len);
+		switch (id)
+		{
+#define HANDLE_CELL_TYPE(_t) case CT_ ## _t: return const_ ## _t(arg1, arg2, signed1, signed2, result_len);
 		HANDLE_CELL_TYPE(not)
 		HANDLE_CELL_TYPE(and)
 		HANDLE_CELL_TYPE(or)
@@ -295,47 +464,52 @@ struct CellTypes
 		HANDLE_CELL_TYPE(neg)
 #undef HANDLE_CELL_TYPE
 
-		if (type == "$_BUF_")
+		case CT__BUF_:
 			return arg1;
-		if (type == "$_NOT_")
+		case CT__NOT_:
 			return eval_not(arg1);
-		if (type == "$_AND_")
+		case CT__AND_:
 			return const_and(arg1, arg2, false, false, 1);
-		if (type == "$_NAND_")
+		case CT__NAND_:
 			return eval_not(const_and(arg1, arg2, false, false, 1));
-		if (type == "$_OR_")
+		case CT__OR_:
 			return const_or(arg1, arg2, false, false, 1);
-		if (type == "$_NOR_")
-			return eval_not(const_and(arg1, arg2, false, false, 1));
-		if (type == "$_XOR_")
+		case CT__NOR_:
+			return eval_not(const_or(arg1, arg2, false, false, 1));
+		case CT__XOR_:
 			return const_xor(arg1, arg2, false, false, 1);
-		if (type == "$_XNOR_")
+		case CT__XNOR_:
 			return const_xnor(arg1, arg2, false, false, 1);
+		default:
+			break;
+		}
 
 		log_abort();
 	}
 
 	static RTLIL::Const eval(RTLIL::Cell *cell, const RTLIL::Const &arg1, const RTLIL::Const &arg2)
 	{
-		if (cell->type == "$slice") {
+		CellTypeId id = cell_type_id(cell->type);
+
+		if (id == CT_slice) {
 			RTLIL::Const ret;
-			int width = cell->parameters.at("\\Y_WIDTH").as_int();
+			int width = cell->parameters.at(ID::Y_WIDTH).as_int();
 			int offset = cell->parameters.at("\\OFFSET").as_int();
 			ret.bits.insert(ret.bits.end(), arg1.bits.begin()+offset, arg1.bits.begin()+offset+width);
 			return ret;
 		}
 
-		if (cell->type == "$concat") {
+		if (id == CT_concat) {
 			RTLIL::Const ret = arg1;
 			ret.bits.insert(ret.bits.end(), arg2.bits.begin(), arg2.bits.end());
 			return ret;
 		}
 
-		if (cell->type == "$lut")
+		if (id == CT_lut)
 		{
-			int width = cell->parameters.at("\\WIDTH").as_int();
+			int width = cell->parameters.at(ID::WIDTH).as_int();
 
-			std::vector<RTLIL::State> t = cell->parameters.at("\\LUT").bits;
+			std::vector<RTLIL::State> t = cell->parameters.at(ID::LUT).bits;
 			while (GetSize(t) < (1 << width))
 				t.push_back(RTLIL::S0);
 			t.resize(1 << width);
@@ -357,15 +531,17 @@ struct CellTypes
 			return t;
 		}
 
-		bool signed_a = cell->parameters.count("\\A_SIGNED") > 0 && cell->parameters["\\A_SIGNED"].as_bool();
-		bool signed_b = cell->parameters.count("\\B_SIGNED") > 0 && cell->parameters["\\B_SIGNED"].as_bool();
-		int result_len = cell->parameters.count("\\Y_WIDTH") > 0 ? cell->parameters["\\Y_WIDTH"].as_int() : -1;
+		bool signed_a = cell->parameters.count(ID::A_SIGNED) > 0 && cell->parameters[ID::A_SIGNED].as_bool();
+		bool signed_b = cell->parameters.count(ID::B_SIGNED) > 0 && cell->parameters[ID::B_SIGNED].as_bool();
+		int result_len = cell->parameters.count(ID::Y_WIDTH) > 0 ? cell->parameters[ID::Y_WIDTH].as_int() : -1;
 		return eval(cell->type, arg1, arg2, signed_a, signed_b, result_len);
 	}
 
 	static RTLIL::Const eval(RTLIL::Cell *cell, const RTLIL::Const &arg1, const RTLIL::Const &arg2, const RTLIL::Const &arg3)
 	{
-		if (cell->type.in("$mux", "$pmux", "$_MUX_")) {
+		CellTypeId id = cell_type_id(cell->type);
+
+		if (cell_type_in(id, CT_mux, CT_pmux, CT__MUX_)) {
 			RTLIL::Const ret = arg1;
 			for (size_t i = 0; i < arg3.bits.size(); i++)
 				if (arg3.bits[i] == RTLIL::State::S1) {
@@ -375,9 +551,9 @@ struct CellTypes
 			return ret;
 		}
 
-		if (cell->type == "$_AOI3_")
+		if (id == CT__AOI3_)
 			return eval_not(const_or(const_and(arg1, arg2, false, false, 1), arg3, false, false, 1));
-		if (cell->type == "$_OAI3_")
+		if (id == CT__OAI3_)
 			return eval_not(const_and(const_or(arg1, arg2, false, false, 1), arg3, false, false, 1));
 
 		log_assert(arg3.bits.size() == 0);
@@ -386,19 +562,18 @@ struct CellTypes
 
 	static RTLIL::Const eval(RTLIL::Cell *cell, const RTLIL::Const &arg1, const RTLIL::Const &arg2, const RTLIL::Const &arg3, const RTLIL::Const &arg4)
 	{
-		if (cell->type == "$_AOI4_")
+		CellTypeId id = cell_type_id(cell->type);
+
+		if (id == CT__AOI4_)
 			return eval_not(const_or(const_and(arg1, arg2, false, false, 1), const_and(arg3, arg4, false, false, 1), false, false, 1));
-		if (cell->type == "$_OAI4_")
-			return eval_not(const_and(const_or(arg1, arg2, false, false, 1), const_and(arg3, arg4, false, false, 1), false, false, 1));
+		if (id == CT__OAI4_)
+			return eval_not(const_and(const_or(arg1, arg2, false, false, 1), const_or(arg3, arg4, false, false, 1), false, false, 1));
 
 		log_assert(arg4.bits.size() == 0);
 		return eval(cell, arg1, arg2, arg3);
 	}
 };
 
-// initialized by yosys_setup()
-extern CellTypes yosys_celltypes;
-
 YOSYS_NAMESPACE_END
 
 #endif
@@ -0,0 +1,359 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+#include <fstream>
+#include <errno.h>
+
+#ifndef _WIN32
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#ifdef YOSYS_ENABLE_ZLIB
+#  include <zlib.h>
+#endif
+
+#ifdef YOSYS_ENABLE_ZSTD
+#  include <zstd.h>
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+// Input and output streams for files with a ".gz" or ".zst" suffix. The data
+// is (de)compressed in blocks while the frontend or backend is streaming, the
+// file is never held in memory as a whole.
+
+enum compress_type_t {
+	COMPRESS_NONE,
+	COMPRESS_GZIP,
+	COMPRESS_ZSTD
+};
+
+static compress_type_t compress_type(const std::string &filename)
+{
+	if (filename.size() > 3 && filename.substr(filename.size()-3) == ".gz")
+		return COMPRESS_GZIP;
+	if (filename.size() > 4 && filename.substr(filename.size()-4) == ".zst")
+		return COMPRESS_ZSTD;
+	return COMPRESS_NONE;
+}
+
+std::string strip_compress_suffix(std::string filename)
+{
+	switch (compress_type(filename)) {
+		case COMPRESS_GZIP: return filename.substr(0, filename.size()-3);
+		case COMPRESS_ZSTD: return filename.substr(0, filename.size()-4);
+		default: return filename;
+	}
+}
+
+#if defined(YOSYS_ENABLE_ZLIB) || defined(YOSYS_ENABLE_ZSTD)
+static const int compress_buffer_size = 1 << 16;
+
+struct compressed_istream : public std::istream
+{
+	std::unique_ptr<std::streambuf> buf;
+	compressed_istream(std::streambuf *buf) : std::istream(buf), buf(buf) { }
+};
+
+struct compressed_ostream : public std::ostream
+{
+	std::unique_ptr<std::streambuf> buf;
+	compressed_ostream(std::streambuf *buf) : std::ostream(buf), buf(buf) { }
+	~compressed_ostream() { flush(); }
+};
+#endif
+
+#ifdef YOSYS_ENABLE_ZLIB
+struct gzip_istreambuf : public std::streambuf
+{
+	gzFile gz;
+	std::vector<char> buffer;
+
+	gzip_istreambuf(gzFile gz) : gz(gz), buffer(compress_buffer_size) { }
+	~gzip_istreambuf() { gzclose(gz); }
+
+	virtual int_type underflow()
+	{
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+
+		int n = gzread(gz, buffer.data(), GetSize(buffer));
+		if (n <= 0)
+			return traits_type::eof();
+
+		setg(buffer.data(), buffer.data(), buffer.data() + n);
+		return traits_type::to_int_type(*gptr());
+	}
+};
+
+struct gzip_ostreambuf : public std::streambuf
+{
+	gzFile gz;
+	std::vector<char> buffer;
+
+	gzip_ostreambuf(gzFile gz) : gz(gz), buffer(compress_buffer_size)
+	{
+		setp(buffer.data(), buffer.data() + GetSize(buffer));
+	}
+
+	~gzip_ostreambuf()
+	{
+		sync();
+		gzclose(gz);
+	}
+
+	virtual int sync()
+	{
+		int n = pptr() - pbase();
+		if (n > 0 && gzwrite(gz, pbase(), n) != n)
+			return -1;
+		setp(buffer.data(), buffer.data() + GetSize(buffer));
+		return 0;
+	}
+
+	virtual int_type overflow(int_type c)
+	{
+		if (sync() != 0)
+			return traits_type::eof();
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			sputc(traits_type::to_char_type(c));
+		return traits_type::not_eof(c);
+	}
+};
+#endif
+
+#ifdef YOSYS_ENABLE_ZSTD
+struct zstd_istreambuf : public std::streambuf
+{
+	FILE *file;
+	ZSTD_DStream *stream;
+	std::vector<char> in_buffer, out_buffer;
+	ZSTD_inBuffer input;
+
+	zstd_istreambuf(FILE *file) : file(file), in_buffer(ZSTD_DStreamInSize()), out_buffer(ZSTD_DStreamOutSize())
+	{
+		stream = ZSTD_createDStream();
+		ZSTD_initDStream(stream);
+		input.src = in_buffer.data();
+		input.size = 0;
+		input.pos = 0;
+	}
+
+	~zstd_istreambuf()
+	{
+		ZSTD_freeDStream(stream);
+		fclose(file);
+	}
+
+	virtual int_type underflow()
+	{
+		if (gptr() < egptr())
+			return traits_type::to_int_type(*gptr());
+
+		while (1)
+		{
+			if (input.pos == input.size) {
+				input.size = fread(in_buffer.data(), 1, in_buffer.size(), file);
+				input.pos = 0;
+				if (input.size == 0)
+					return traits_type::eof();
+			}
+
+			ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+			size_t rc = ZSTD_decompressStream(stream, &output, &input);
+			if (ZSTD_isError(rc))
+				log_error("Decompression of zstd input failed: %s\n", ZSTD_getErrorName(rc));
+
+			if (output.pos > 0) {
+				setg(out_buffer.data(), out_buffer.data(), out_buffer.data() + output.pos);
+				return traits_type::to_int_type(*gptr());
+			}
+		}
+	}
+};
+
+struct zstd_ostreambuf : public std::streambuf
+{
+	FILE *file;
+	ZSTD_CStream *stream;
+	std::vector<char> in_buffer, out_buffer;
+	bool failed;
+
+	zstd_ostreambuf(FILE *file) : file(file), in_buffer(ZSTD_CStreamInSize()), out_buffer(ZSTD_CStreamOutSize()), failed(false)
+	{
+		stream = ZSTD_createCStream();
+		ZSTD_initCStream(stream, 3);
+		setp(in_buffer.data(), in_buffer.data() + in_buffer.size());
+	}
+
+	~zstd_ostreambuf()
+	{
+		sync();
+		while (!failed) {
+			ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+			size_t rc = ZSTD_endStream(stream, &output);
+			write_output(output, rc);
+			if (rc == 0 || ZSTD_isError(rc))
+				break;
+		}
+		ZSTD_freeCStream(stream);
+		fclose(file);
+	}
+
+	void write_output(const ZSTD_outBuffer &output, size_t rc)
+	{
+		if (ZSTD_isError(rc) || fwrite(output.dst, 1, output.pos, file) != output.pos)
+			failed = true;
+	}
+
+	virtual int sync()
+	{
+		ZSTD_inBuffer input = { pbase(), size_t(pptr() - pbase()), 0 };
+		while (!failed && input.pos < input.size) {
+			ZSTD_outBuffer output = { out_buffer.data(), out_buffer.size(), 0 };
+			size_t rc = ZSTD_compressStream(stream, &output, &input);
+			write_output(output, rc);
+		}
+		setp(in_buffer.data(), in_buffer.data() + in_buffer.size());
+		return failed ? -1 : 0;
+	}
+
+	virtual int_type overflow(int_type c)
+	{
+		if (sync() != 0)
+			return traits_type::eof();
+		if (!traits_type::eq_int_type(c, traits_type::eof()))
+			sputc(traits_type::to_char_type(c));
+		return traits_type::not_eof(c);
+	}
+};
+#endif
+
+std::istream *open_input_file(std::string filename)
+{
+	switch (compress_type(filename))
+	{
+	case COMPRESS_GZIP: {
+#ifdef YOSYS_ENABLE_ZLIB
+		gzFile gz = gzopen(filename.c_str(), "rb");
+		if (gz == NULL)
+			return nullptr;
+		return new compressed_istream(new gzip_istreambuf(gz));
+#else
+		log_cmd_error("Can't read `%s': Yosys was built without zlib support.\n", filename.c_str());
+#endif
+	}
+	case COMPRESS_ZSTD: {
+#ifdef YOSYS_ENABLE_ZSTD
+		FILE *file = fopen(filename.c_str(), "rb");
+		if (file == NULL)
+			return nullptr;
+		return new compressed_istream(new zstd_istreambuf(file));
+#else
+		log_cmd_error("Can't read `%s': Yosys was built without zstd support.\n", filename.c_str());
+#endif
+	}
+	default: {
+		std::ifstream *ff = new std::ifstream;
+		ff->open(filename.c_str());
+		if (ff->fail()) {
+			delete ff;
+			return nullptr;
+		}
+		return ff;
+	}
+	}
+}
+
+std::ostream *open_output_file(std::string filename)
+{
+	switch (compress_type(filename))
+	{
+	case COMPRESS_GZIP: {
+#ifdef YOSYS_ENABLE_ZLIB
+		gzFile gz = gzopen(filename.c_str(), "wb");
+		if (gz == NULL)
+			return nullptr;
+		return new compressed_ostream(new gzip_ostreambuf(gz));
+#else
+		log_cmd_error("Can't write `%s': Yosys was built without zlib support.\n", filename.c_str());
+#endif
+	}
+	case COMPRESS_ZSTD: {
+#ifdef YOSYS_ENABLE_ZSTD
+		FILE *file = fopen(filename.c_str(), "wb");
+		if (file == NULL)
+			return nullptr;
+		return new compressed_ostream(new zstd_ostreambuf(file));
+#else
+		log_cmd_error("Can't write `%s': Yosys was built without zstd support.\n", filename.c_str());
+#endif
+	}
+	default: {
+		std::ofstream *ff = new std::ofstream;
+		ff->open(filename.c_str(), std::ofstream::trunc);
+		if (ff->fail()) {
+			delete ff;
+			return nullptr;
+		}
+		return ff;
+	}
+	}
+}
+
+MappedFile::MappedFile(std::istream &f, std::string filename) : data(nullptr), size(0), mapping(nullptr)
+{
+#ifndef _WIN32
+	if (filename != "-" && compress_type(filename) == COMPRESS_NONE) {
+		int fd = open(filename.c_str(), O_RDONLY);
+		struct stat st;
+		if (fd >= 0 && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				madvise(p, st.st_size, MADV_SEQUENTIAL);
+				mapping = p;
+				data = (const char*)p;
+				size = st.st_size;
+			}
+		}
+		if (fd >= 0)
+			close(fd);
+		if (mapping != nullptr)
+			return;
+	}
+#endif
+	buffer.assign(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+	data = buffer.data();
+	size = buffer.size();
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+	if (mapping != nullptr)
+		munmap(mapping, size);
+#endif
+}
+
+YOSYS_NAMESPACE_END
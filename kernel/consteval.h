@@ -34,11 +34,22 @@ struct ConstEval
 	SigMap values_map;
 	SigPool stop_signals;
 	SigSet<RTLIL::Cell*> sig2driver;
-	std::set<RTLIL::Cell*> busy;
+	bool sig2driver_valid;
+	pool<RTLIL::Cell*> busy;
 	std::vector<SigMap> stack;
 
-	ConstEval(RTLIL::Module *module) : module(module), assign_map(module)
+	ConstEval(RTLIL::Module *module) : module(module), assign_map(module), sig2driver_valid(false)
 	{
+	}
+
+	// the driver index is only built when the first signal actually needs to
+	// be evaluated through cells, many users only evaluate constants
+	void index_drivers()
+	{
+		if (sig2driver_valid)
+			return;
+		sig2driver_valid = true;
+
 		CellTypes ct;
 		ct.setup_internals();
 		ct.setup_stdcells();
@@ -88,12 +99,14 @@ struct ConstEval
 
 	bool eval(RTLIL::Cell *cell, RTLIL::SigSpec &undef)
 	{
-		if (cell->type == "$lcu")
+		CellTypeId type = cell_type_id(cell->type);
+
+		if (type == CT_lcu)
 		{
-			RTLIL::SigSpec sig_p = cell->getPort("\\P");
-			RTLIL::SigSpec sig_g = cell->getPort("\\G");
-			RTLIL::SigSpec sig_ci = cell->getPort("\\CI");
-			RTLIL::SigSpec sig_co = values_map(assign_map(cell->getPort("\\CO")));
+			RTLIL::SigSpec sig_p = cell->getPort(ID::P);
+			RTLIL::SigSpec sig_g = cell->getPort(ID::G);
+			RTLIL::SigSpec sig_ci = cell->getPort(ID::CI);
+			RTLIL::SigSpec sig_co = values_map(assign_map(cell->getPort(ID::CO)));
 
 			if (sig_co.is_fully_const())
 				return true;
@@ -127,24 +140,24 @@ struct ConstEval
 
 		RTLIL::SigSpec sig_a, sig_b, sig_s, sig_y;
 
-		log_assert(cell->hasPort("\\Y"));
-		sig_y = values_map(assign_map(cell->getPort("\\Y")));
+		log_assert(cell->hasPort(ID::Y));
+		sig_y = values_map(assign_map(cell->getPort(ID::Y)));
 		if (sig_y.is_fully_const())
 			return true;
 
-		if (cell->hasPort("\\S")) {
-			sig_s = cell->getPort("\\S");
+		if (cell->hasPort(ID::S)) {
+			sig_s = cell->getPort(ID::S);
 			if (!eval(sig_s, undef, cell))
 				return false;
 		}
 
-		if (cell->hasPort("\\A"))
-			sig_a = cell->getPort("\\A");
+		if (cell->hasPort(ID::A))
+			sig_a = cell->getPort(ID::A);
 
-		if (cell->hasPort("\\B"))
-			sig_b = cell->getPort("\\B");
+		if (cell->hasPort(ID::B))
+			sig_b = cell->getPort(ID::B);
 
-		if (cell->type == "$mux" || cell->type == "$pmux" || cell->type == "$_MUX_")
+		if (type == CT_mux || type == CT_pmux || type == CT__MUX_)
 		{
 			std::vector<RTLIL::SigSpec> y_candidates;
 			int count_maybe_set_s_bits = 0;
@@ -194,10 +207,10 @@ struct ConstEval
 			else
 				set(sig_y, y_values.front());
 		}
-		else if (cell->type == "$fa")
+		else if (type == CT_fa)
 		{
-			RTLIL::SigSpec sig_c = cell->getPort("\\C");
-			RTLIL::SigSpec sig_x = cell->getPort("\\X");
+			RTLIL::SigSpec sig_c = cell->getPort(ID::C);
+			RTLIL::SigSpec sig_x = cell->getPort(ID::X);
 			int width = GetSize(sig_c);
 
 			if (!eval(sig_a, undef, cell))
@@ -223,13 +236,13 @@ struct ConstEval
 			set(sig_y, val_y);
 			set(sig_x, val_x);
 		}
-		else if (cell->type == "$alu")
+		else if (type == CT_alu)
 		{
-			bool signed_a = cell->parameters.count("\\A_SIGNED") > 0 && cell->parameters["\\A_SIGNED"].as_bool();
-			bool signed_b = cell->parameters.count("\\B_SIGNED") > 0 && cell->parameters["\\B_SIGNED"].as_bool();
+			bool signed_a = cell->parameters.count(ID::A_SIGNED) > 0 && cell->parameters[ID::A_SIGNED].as_bool();
+			bool signed_b = cell->parameters.count(ID::B_SIGNED) > 0 && cell->parameters[ID::B_SIGNED].as_bool();
 
-			RTLIL::SigSpec sig_ci = cell->getPort("\\CI");
-			RTLIL::SigSpec sig_bi = cell->getPort("\\BI");
+			RTLIL::SigSpec sig_ci = cell->getPort(ID::CI);
+			RTLIL::SigSpec sig_bi = cell->getPort(ID::BI);
 
 			if (!eval(sig_a, undef, cell))
 				return false;
@@ -243,43 +256,34 @@ struct ConstEval
 			if (!eval(sig_bi, undef, cell))
 				return false;
 
-			RTLIL::SigSpec sig_x = cell->getPort("\\X");
-			RTLIL::SigSpec sig_co = cell->getPort("\\CO");
+			RTLIL::SigSpec sig_x = cell->getPort(ID::X);
+			RTLIL::SigSpec sig_co = cell->getPort(ID::CO);
 
 			bool any_input_undef = !(sig_a.is_fully_def() && sig_b.is_fully_def() && sig_ci.is_fully_def() && sig_bi.is_fully_def());
-			sig_a.extend_u0(GetSize(sig_y), signed_a);
-			sig_b.extend_u0(GetSize(sig_y), signed_b);
-
-			bool carry = sig_ci[0] == RTLIL::S1;
-			bool b_inv = sig_bi[0] == RTLIL::S1;
-
-			for (int i = 0; i < GetSize(sig_y); i++)
-			{
-				RTLIL::SigSpec x_inputs = { sig_a[i], sig_b[i], sig_bi[0] };
-
-				if (!x_inputs.is_fully_def()) {
-					set(sig_x[i], RTLIL::Sx);
-				} else {
-					bool bit_a = sig_a[i] == RTLIL::S1;
-					bool bit_b = (sig_b[i] == RTLIL::S1) != b_inv;
-					bool bit_x = bit_a != bit_b;
-					set(sig_x[i], bit_x ? RTLIL::S1 : RTLIL::S0);
-				}
-
-				if (any_input_undef) {
-					set(sig_y[i], RTLIL::Sx);
-					set(sig_co[i], RTLIL::Sx);
-				} else {
-					bool bit_a = sig_a[i] == RTLIL::S1;
-					bool bit_b = (sig_b[i] == RTLIL::S1) != b_inv;
-					bool bit_y = (bit_a != bit_b) != carry;
-					carry = (bit_a && bit_b) || (bit_a && carry) || (bit_b && carry);
-					set(sig_y[i], bit_y ? RTLIL::S1 : RTLIL::S0);
-					set(sig_co[i], carry ? RTLIL::S1 : RTLIL::S0);
-				}
+			int width = GetSize(sig_y);
+
+			// X = A ^ B ^ BI and Y = A + (B ^ BI) + CI, computed on whole
+			// words. The carry into bit i is Y ^ X, so the carry out of bit i
+			// is (A & (B ^ BI)) | (X & (Y ^ X)).
+			RTLIL::Const val_a = sig_a.as_const(), val_b = sig_b.as_const();
+			RTLIL::Const val_bi(sig_bi.as_const().bits.at(0), width);
+			RTLIL::Const val_b_inv = const_xor(val_b, val_bi, signed_b, false, width);
+			RTLIL::Const val_x = const_xor(val_a, val_b_inv, signed_a, false, width);
+
+			if (any_input_undef) {
+				set(sig_x, val_x);
+				set(sig_y, RTLIL::Const(RTLIL::Sx, width));
+				set(sig_co, RTLIL::Const(RTLIL::Sx, width));
+			} else {
+				RTLIL::Const val_y = const_add(const_add(val_a, val_b_inv, signed_a, false, width), sig_ci.as_const(), false, false, width);
+				RTLIL::Const val_g = const_and(val_a, val_b_inv, signed_a, false, width);
+				RTLIL::Const val_pc = const_and(val_x, const_xor(val_y, val_x, false, false, width), false, false, width);
+				set(sig_x, val_x);
+				set(sig_y, val_y);
+				set(sig_co, const_or(val_g, val_pc, false, false, width));
 			}
 		}
-		else if (cell->type == "$macc")
+		else if (type == CT_macc)
 		{
 			Macc macc;
 			macc.from_cell(cell);
@@ -294,21 +298,21 @@ struct ConstEval
 					return false;
 			}
 
-			RTLIL::Const result(0, GetSize(cell->getPort("\\Y")));
+			RTLIL::Const result(0, GetSize(cell->getPort(ID::Y)));
 			if (!macc.eval(result))
 				log_abort();
 
-			set(cell->getPort("\\Y"), result);
+			set(cell->getPort(ID::Y), result);
 		}
 		else
 		{
 			RTLIL::SigSpec sig_c, sig_d;
 
-			if (cell->type.in("$_AOI3_", "$_OAI3_", "$_AOI4_", "$_OAI4_")) {
-				if (cell->hasPort("\\C"))
-					sig_c = cell->getPort("\\C");
-				if (cell->hasPort("\\D"))
-					sig_d = cell->getPort("\\D");
+			if (cell_type_in(type, CT__AOI3_, CT__OAI3_, CT__AOI4_, CT__OAI4_)) {
+				if (cell->hasPort(ID::C))
+					sig_c = cell->getPort(ID::C);
+				if (cell->hasPort(ID::D))
+					sig_d = cell->getPort(ID::D);
 			}
 
 			if (sig_a.size() > 0 && !eval(sig_a, undef, cell))
@@ -348,7 +352,8 @@ struct ConstEval
 			busy.insert(busy_cell);
 		}
 
-		std::set<RTLIL::Cell*> driver_cells;
+		pool<RTLIL::Cell*> driver_cells;
+		index_drivers();
 		sig2driver.find(sig, driver_cells);
 		for (auto cell : driver_cells) {
 			if (!eval(cell, undef)) {
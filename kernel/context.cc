@@ -0,0 +1,139 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/context.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+extern std::vector<int> header_count;
+
+static std::recursive_mutex context_mutex;
+
+Context::Scope::Scope(Context &ctx) : ctx(ctx), lock(context_mutex)
+{
+	old_design = yosys_design;
+	old_saved_designs.swap(saved_designs);
+	old_pushed_designs.swap(pushed_designs);
+	old_log_files.swap(Yosys::log_files);
+	old_log_streams.swap(Yosys::log_streams);
+	old_header_count.swap(header_count);
+	old_log_errfile = log_errfile;
+	old_log_cmd_error_throw = log_cmd_error_throw;
+	old_log_error_throw = log_error_throw;
+	old_log_last_error = log_last_error;
+	old_autoidx = autoidx;
+
+	yosys_design = ctx.design_;
+	saved_designs.swap(ctx.saved_designs_);
+	pushed_designs.swap(ctx.pushed_designs_);
+	Yosys::log_files = ctx.log_files;
+	Yosys::log_streams = ctx.log_streams;
+	header_count.swap(ctx.header_count_);
+	log_errfile = NULL;
+	log_cmd_error_throw = true;
+	log_error_throw = true;
+	autoidx = ctx.autoidx_;
+}
+
+Context::Scope::~Scope()
+{
+	log_flush();
+
+	ctx.design_ = yosys_design;
+	ctx.saved_designs_.swap(saved_designs);
+	ctx.pushed_designs_.swap(pushed_designs);
+	ctx.header_count_.swap(header_count);
+	ctx.autoidx_ = autoidx;
+
+	yosys_design = old_design;
+	saved_designs.swap(old_saved_designs);
+	pushed_designs.swap(old_pushed_designs);
+	Yosys::log_files.swap(old_log_files);
+	Yosys::log_streams.swap(old_log_streams);
+	header_count.swap(old_header_count);
+	log_errfile = old_log_errfile;
+	log_cmd_error_throw = old_log_cmd_error_throw;
+	log_error_throw = old_log_error_throw;
+	log_last_error = old_log_last_error;
+	autoidx = old_autoidx;
+}
+
+Context::Context() : autoidx_(1)
+{
+	std::lock_guard<std::recursive_mutex> lock(context_mutex);
+	design_ = new RTLIL::Design;
+	header_count_.push_back(0);
+}
+
+Context::~Context()
+{
+	std::lock_guard<std::recursive_mutex> lock(context_mutex);
+	for (auto &it : saved_designs_)
+		delete it.second;
+	for (auto design : pushed_designs_)
+		delete design;
+	delete design_;
+}
+
+template<typename F> void Context::guarded(F func)
+{
+	std::string error;
+
+	{
+		Scope scope(*this);
+		try {
+			func();
+		} catch (log_cmd_error_exception) {
+			while (design_->selection_stack.size() > 1)
+				design_->selection_stack.pop_back();
+			log_reset_stack();
+			error = log_last_error;
+		}
+	}
+
+	if (!error.empty())
+		throw Error(error);
+}
+
+void Context::run_pass(const std::vector<std::string> &args)
+{
+	guarded([&]() {
+		std::string command;
+		for (auto &arg : args)
+			command += (command.empty() ? "" : " ") + arg;
+		log("\n-- Running command `%s' --\n", command.c_str());
+		Pass::call(design_, args);
+	});
+}
+
+void Context::read_file(const std::string &filename, const std::string &frontend)
+{
+	guarded([&]() {
+		run_frontend(filename, frontend, design_);
+	});
+}
+
+void Context::write_file(const std::string &filename, const std::string &backend)
+{
+	guarded([&]() {
+		run_backend(filename, backend, design_);
+	});
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,108 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "kernel/yosys.h"
+#include <mutex>
+#include <stdexcept>
+
+YOSYS_NAMESPACE_BEGIN
+
+// A Context holds the state of one synthesis job when yosys is used as a
+// library: the design (and the designs stored with 'design -save/-push'),
+// the log outputs, the log header numbering and the autoidx counter. An
+// application can have any number of contexts, in any number of threads.
+//
+// The rest of the kernel (the IdString table, the pass registry, ...) is
+// shared by the whole process. Therefore only one context is active at a
+// time: a Context::Scope takes a process-wide lock and installs the state of
+// its context in the global variables until it goes out of scope. The
+// methods of Context do this themselves, code that works on design()
+// directly must hold a Scope.
+//
+// Errors in commands run by a context throw a Context::Error instead of
+// terminating the process.
+//
+//	yosys_setup();
+//	Context ctx;
+//	ctx.log_streams.push_back(&std::cout);
+//	ctx.read_file("example.v");
+//	ctx.run_pass({"synth", "-top", "example"});
+//	ctx.write_file("example.json");
+
+struct Context
+{
+	struct Error : std::runtime_error {
+		Error(const std::string &msg) : std::runtime_error(msg) { }
+	};
+
+	struct Scope
+	{
+		Scope(Context &ctx);
+		~Scope();
+
+	private:
+		Context &ctx;
+		std::unique_lock<std::recursive_mutex> lock;
+		RTLIL::Design *old_design;
+		std::map<std::string, RTLIL::Design*> old_saved_designs;
+		std::vector<RTLIL::Design*> old_pushed_designs;
+		std::vector<FILE*> old_log_files;
+		std::vector<std::ostream*> old_log_streams;
+		std::vector<int> old_header_count;
+		FILE *old_log_errfile;
+		bool old_log_cmd_error_throw, old_log_error_throw;
+		std::string old_log_last_error;
+		int old_autoidx;
+	};
+
+	std::vector<FILE*> log_files;
+	std::vector<std::ostream*> log_streams;
+
+	Context();
+	~Context();
+
+	RTLIL::Design *design() { return design_; }
+
+	// runs a command with the arguments as they would be after parsing, so
+	// that file names and other arguments need no quoting
+	void run_pass(const std::vector<std::string> &args);
+
+	// frontend and backend "auto" select the format from the file name
+	void read_file(const std::string &filename, const std::string &frontend = "auto");
+	void write_file(const std::string &filename, const std::string &backend = "auto");
+
+private:
+	RTLIL::Design *design_;
+	std::map<std::string, RTLIL::Design*> saved_designs_;
+	std::vector<RTLIL::Design*> pushed_designs_;
+	std::vector<int> header_count_;
+	int autoidx_;
+
+	template<typename F> void guarded(F func);
+
+	Context(const Context&) = delete;
+	Context &operator=(const Context&) = delete;
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
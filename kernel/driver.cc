@@ -35,6 +35,24 @@
 #  include <unistd.h>
 #endif
 
+#if defined(__linux__) && defined(__GLIBC__)
+#  include <execinfo.h>
+#  include <signal.h>
+#  include <fcntl.h>
+#  include <sys/time.h>
+#  include <cxxabi.h>
+#  ifdef YOSYS_ENABLE_PLUGINS
+#    include <dlfcn.h>
+#  endif
+#endif
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <signal.h>
+#  define YOSYS_ENABLE_SERVER
+#endif
+
 #if !defined(_WIN32) || defined(__MINGW32__)
 #  include <unistd.h>
 #else
@@ -119,8 +137,306 @@ const char *prompt()
 
 #else /* EMSCRIPTEN */
 
+#if defined(__linux__) && defined(__GLIBC__)
+#  define YOSYS_ENABLE_SAMPLING
+
+// Sampling profiler (-F): a SIGPROF timer records the command stack, the
+// module processed by run_module_jobs() and a backtrace every 10 ms of CPU
+// time. The handler only uses write(), so the raw samples go to an unlinked
+// temp file. They are symbolized and folded when yosys exits.
+
+#define SAMPLE_MAX_FRAMES 64
+
+struct SampleHeader {
+	int num_passes, num_frames, module_len;
+};
+
+static int sample_fd = -1;
+
+static void sample_handler(int)
+{
+	int saved_errno = errno;
+	char buffer[sizeof(SampleHeader) + PASS_STACK_SIZE*sizeof(Pass*) + sizeof(pass_stack_module) + SAMPLE_MAX_FRAMES*sizeof(void*)];
+	void *frames[SAMPLE_MAX_FRAMES];
+
+	SampleHeader header;
+	header.num_passes = std::min(int(pass_stack_depth), PASS_STACK_SIZE);
+	header.num_frames = backtrace(frames, SAMPLE_MAX_FRAMES);
+	header.module_len = strnlen(pass_stack_module, sizeof(pass_stack_module));
+
+	char *p = buffer;
+	memcpy(p, &header, sizeof(header)), p += sizeof(header);
+	memcpy(p, pass_stack, header.num_passes*sizeof(Pass*)), p += header.num_passes*sizeof(Pass*);
+	memcpy(p, pass_stack_module, header.module_len), p += header.module_len;
+	memcpy(p, frames, header.num_frames*sizeof(void*)), p += header.num_frames*sizeof(void*);
+
+	if (write(sample_fd, buffer, p - buffer) < 0) { /* samples are best-effort */ }
+	errno = saved_errno;
+}
+
+static void start_sampling()
+{
+	std::string filename = make_temp_file("/tmp/yosys-samples-XXXXXX");
+	sample_fd = open(filename.c_str(), O_RDWR);
+	unlink(filename.c_str());
+	if (sample_fd < 0)
+		log_error("Can't create temp file for the sampling profiler: %s\n", strerror(errno));
+
+	// the first call of backtrace() loads libgcc, which must not happen in the handler
+	void *dummy[1];
+	backtrace(dummy, 1);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = sample_handler;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGPROF, &sa, NULL);
+
+	struct itimerval timer;
+	timer.it_interval.tv_sec = 0;
+	timer.it_interval.tv_usec = 10000;
+	timer.it_value = timer.it_interval;
+	setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static std::string sample_frame_name(void *addr, std::map<void*, std::string> &cache)
+{
+	if (cache.count(addr))
+		return cache.at(addr);
+
+	std::string name = stringf("%p", addr);
+#ifdef YOSYS_ENABLE_PLUGINS
+	Dl_info dli;
+	if (dladdr(addr, &dli) && dli.dli_sname != nullptr) {
+		int status = 0;
+		char *demangled = abi::__cxa_demangle(dli.dli_sname, nullptr, nullptr, &status);
+		name = status == 0 ? demangled : dli.dli_sname;
+		free(demangled);
+	} else if (dladdr(addr, &dli) && dli.dli_fname != nullptr) {
+		const char *basename = strrchr(dli.dli_fname, '/');
+		name = stringf("%s+%p", basename ? basename+1 : dli.dli_fname, (void*)((char*)addr - (char*)dli.dli_fbase));
+	}
+#endif
+
+	// ';' separates the frames in the folded format
+	for (auto &c : name)
+		if (c == ';')
+			c = ':';
+	return cache[addr] = name;
+}
+
+static void write_samples(std::string filename)
+{
+	struct itimerval timer;
+	memset(&timer, 0, sizeof(timer));
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+
+	std::string data;
+	char buffer[65536];
+	lseek(sample_fd, 0, SEEK_SET);
+	for (ssize_t n; (n = read(sample_fd, buffer, sizeof(buffer))) > 0;)
+		data.append(buffer, n);
+	close(sample_fd);
+	sample_fd = -1;
+
+	std::map<std::string, int> stacks;
+	std::map<void*, std::string> frame_cache;
+	int num_samples = 0;
+
+	for (size_t pos = 0; pos + sizeof(SampleHeader) <= data.size(); num_samples++)
+	{
+		SampleHeader header;
+		memcpy(&header, &data[pos], sizeof(header));
+		pos += sizeof(header);
+		if (pos + header.num_passes*sizeof(Pass*) + header.module_len + header.num_frames*sizeof(void*) > data.size())
+			break;
+
+		std::string stack;
+		for (int i = 0; i < header.num_passes; i++, pos += sizeof(Pass*)) {
+			Pass *pass;
+			memcpy(&pass, &data[pos], sizeof(Pass*));
+			stack += stack.empty() ? "" : ";";
+			stack += pass->pass_name;
+		}
+		if (stack.empty())
+			stack = "[no command]";
+
+		if (header.module_len > 0)
+			stack += ";[" + data.substr(pos, header.module_len) + "]";
+		pos += header.module_len;
+
+		// skip the frames of the handler and the signal trampoline
+		for (int i = header.num_frames-1; i >= 0; i--) {
+			void *addr;
+			memcpy(&addr, &data[pos + i*sizeof(void*)], sizeof(void*));
+			if (i >= 2)
+				stack += ";" + sample_frame_name(addr, frame_cache);
+		}
+		pos += header.num_frames*sizeof(void*);
+
+		stacks[stack]++;
+	}
+
+	FILE *f = fopen(filename.c_str(), "w");
+	if (f == NULL)
+		log_error("Can't open sample file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+	for (auto &it : stacks)
+		fprintf(f, "%s %d\n", it.first.c_str(), it.second);
+	fclose(f);
+
+	log("Wrote %d samples (%d distinct stacks) to `%s'.\n", num_samples, GetSize(stacks), filename.c_str());
+}
+#endif
+
+#ifdef __GNUC__
+// constructed before the other static objects (e.g. the Pass instances), so
+// -startup-profile can report the time spent in static initialization
+static struct StartupTimer {
+	int64_t begin_ns;
+	StartupTimer() : begin_ns(PerformanceTimer::query()) { }
+} startup_timer __attribute__((init_priority(101)));
+#endif
+
+#ifdef YOSYS_ENABLE_SERVER
+static volatile sig_atomic_t server_shutdown = 0;
+
+static void server_sigterm_handler(int)
+{
+	server_shutdown = 1;
+}
+
+// runs in the forked child: execute one command line per request line and
+// send the log output followed by "%%ok" or "%%error <message>"
+static void serve_session(int fd)
+{
+	FILE *f_in = fdopen(fd, "r");
+	FILE *f_out = fdopen(dup(fd), "w");
+
+	log_files.clear();
+	log_streams.clear();
+	log_files.push_back(f_out);
+	log_errfile = NULL;
+	log_error_stderr = false;
+	log_hasher = nullptr;
+	log_cmd_error_throw = true;
+
+	RTLIL::Design *design = yosys_get_design();
+	char *line = NULL;
+	size_t line_size = 0;
+
+	while (getline(&line, &line_size, f_in) > 0)
+	{
+		std::string command = line;
+		while (!command.empty() && (command.back() == '\n' || command.back() == '\r'))
+			command.pop_back();
+		if (command.empty())
+			continue;
+		if (command == "exit")
+			break;
+		if (command == "shutdown") {
+			kill(getppid(), SIGTERM);
+			break;
+		}
+
+		try {
+			Pass::call(design, command);
+			fprintf(f_out, "%%%%ok\n");
+		} catch (log_cmd_error_exception) {
+			while (design->selection_stack.size() > 1)
+				design->selection_stack.pop_back();
+			log_reset_stack();
+			fprintf(f_out, "%%%%error %s", log_last_error.c_str());
+		}
+		fflush(f_out);
+	}
+
+	free(line);
+	fclose(f_in);
+	fclose(f_out);
+}
+
+// every connection is served by a forked copy of this process, so sessions
+// start from the resident state (designs, saved designs, loaded plugins)
+// without re-reading anything and can't affect each other
+static void run_server(std::string socket_path)
+{
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+		log_error("Socket path `%s' is too long.\n", socket_path.c_str());
+	strcpy(addr.sun_path, socket_path.c_str());
+
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock < 0)
+		log_error("Can't create socket: %s\n", strerror(errno));
+
+	unlink(socket_path.c_str());
+	if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, 16) < 0)
+		log_error("Can't listen on socket `%s': %s\n", socket_path.c_str(), strerror(errno));
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = server_sigterm_handler;
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+	signal(SIGCHLD, SIG_IGN);
+
+	log("Listening for sessions on `%s'.\n", socket_path.c_str());
+	log_flush();
+
+	while (!server_shutdown)
+	{
+		int fd = accept(sock, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			log_error("Can't accept connection on `%s': %s\n", socket_path.c_str(), strerror(errno));
+		}
+
+		log_flush();
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(sock);
+			signal(SIGTERM, SIG_DFL);
+			signal(SIGINT, SIG_DFL);
+			serve_session(fd);
+			_exit(0);
+		}
+		if (pid < 0)
+			log_warning("Can't fork session process: %s\n", strerror(errno));
+		close(fd);
+	}
+
+	close(sock);
+	unlink(socket_path.c_str());
+	signal(SIGCHLD, SIG_DFL);
+	log("Server on `%s' shut down.\n", socket_path.c_str());
+}
+#endif
+
+static void report_startup_profile(int64_t main_ns, int64_t setup_ns, int64_t plugins_ns)
+{
+	int64_t now_ns = PerformanceTimer::query();
+#ifdef __GNUC__
+	fprintf(stderr, "Startup profile: static init %.3f ms, ", (main_ns - startup_timer.begin_ns) * 1e-6);
+#else
+	fprintf(stderr, "Startup profile: ");
+#endif
+	fprintf(stderr, "setup %.3f ms (%d commands), plugins %.3f ms, time to first command %.3f ms\n",
+			(setup_ns - main_ns) * 1e-6, GetSize(pass_register), (plugins_ns - setup_ns) * 1e-6,
+#ifdef __GNUC__
+			(now_ns - startup_timer.begin_ns) * 1e-6);
+#else
+			(now_ns - main_ns) * 1e-6);
+#endif
+}
+
 int main(int argc, char **argv)
 {
+	int64_t main_ns = PerformanceTimer::query();
 	std::string frontend_command = "auto";
 	std::string backend_command = "auto";
 	std::vector<std::string> passes_commands;
@@ -133,19 +449,40 @@ int main(int argc, char **argv)
 	bool print_stats = true;
 	bool call_abort = false;
 	bool timing_details = false;
+	bool print_profile = false;
+	std::string profile_trace_file;
+	std::string sample_file;
 	bool mode_v = false;
 	bool mode_q = false;
+	bool startup_profile = false;
+	std::string server_socket;
 
 #ifdef YOSYS_ENABLE_READLINE
+	// the history file is only read (and written back) for interactive sessions
 	int history_offset = 0;
 	std::string history_file;
-	if (getenv("HOME") != NULL) {
-		history_file = stringf("%s/.yosys_history", getenv("HOME"));
-		read_history(history_file.c_str());
-		history_offset = where_history();
-	}
 #endif
 
+	// long options, removed before getopt() sees them
+	for (int i = 1; i < argc;) {
+		int n = 0;
+		if (!strcmp(argv[i], "-startup-profile"))
+			startup_profile = true, n = 1;
+		else if (!strcmp(argv[i], "-server") && i+1 < argc)
+			server_socket = argv[i+1], n = 2;
+		else if (!strcmp(argv[i], "-incremental-check"))
+			yosys_incremental_check = true, n = 1;
+		else if (!strcmp(argv[i], "-tmpdir") && i+1 < argc)
+			yosys_temp_dir = argv[i+1], n = 2;
+		if (n == 0) {
+			i++;
+			continue;
+		}
+		for (int j = i; j+n <= argc; j++)
+			argv[j] = argv[j+n];
+		argc -= n;
+	}
+
 	if (argc == 2 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "-help") || !strcmp(argv[1], "--help")))
 	{
 		printf("\n");
@@ -169,7 +506,39 @@ int main(int argc, char **argv)
 		printf("        annotate all log messages with a time stamp\n");
 		printf("\n");
 		printf("    -d\n");
-		printf("        print more detailed timing stats at exit\n");
+		printf("        print more detailed timing stats and operation counters at exit\n");
+		printf("\n");
+		printf("    -P\n");
+		printf("        print the call tree of all executed commands at exit, with total and\n");
+		printf("        self time, number of calls and the time spent on individual modules\n");
+		printf("        (for passes that process modules with the -j worker mechanism), the\n");
+		printf("        change in resident memory and the growth of peak memory per command,\n");
+		printf("        and the design size (cells, wires, IdStrings) after each top-level\n");
+		printf("        command\n");
+		printf("\n");
+		printf("    -J <trace_file>\n");
+		printf("        write the timing of all executed commands to the given file in the\n");
+		printf("        Chrome trace event JSON format (chrome://tracing, Perfetto, speedscope)\n");
+		printf("\n");
+		printf("    -F <folded_file>\n");
+		printf("        sample the call stack every 10 ms of CPU time and write the samples\n");
+		printf("        to the given file at exit, in the folded format of flamegraph.pl\n");
+		printf("        (one line per stack, prefixed with the stack of running commands\n");
+		printf("        and the module processed by the innermost command). Not available\n");
+		printf("        on all platforms. Samples in -j worker processes are not recorded.\n");
+		printf("\n");
+		printf("    -j <N>\n");
+		printf("        use up to N worker processes for passes that process each module\n");
+		printf("        independently (e.g. opt_expr, wreduce, simplemap, proc_mux,\n");
+		printf("        write_verilog), and solve hard SAT problems with a portfolio of N\n");
+		printf("        differently configured SAT solver processes\n");
+		printf("\n");
+		printf("    -C <cache_dir>\n");
+		printf("        keep the result of each module for the passes that support -j in the\n");
+		printf("        given (existing) directory, keyed by a SHA1 hash of the module, the\n");
+		printf("        command line, the selection and the design scratchpad. when a later\n");
+		printf("        run executes the same command on an unchanged module, the stored\n");
+		printf("        result is used instead of running the command on the module again\n");
 		printf("\n");
 		printf("    -l logfile\n");
 		printf("        write log messages to the specified file\n");
@@ -216,6 +585,33 @@ int main(int argc, char **argv)
 		printf("    -V\n");
 		printf("        print version information and exit\n");
 		printf("\n");
+		printf("    -server <socket_path>\n");
+		printf("        after executing the other commands, listen on the given unix socket\n");
+		printf("        instead of entering the interactive shell. every connection is a\n");
+		printf("        session in a forked copy of the process (i.e. it starts with the\n");
+		printf("        designs loaded so far and its changes are not seen by other\n");
+		printf("        sessions). each line sent is executed as command, the reply is the\n");
+		printf("        log output followed by a line '%%%%ok' or '%%%%error <message>'. the\n");
+		printf("        line 'exit' ends the session, 'shutdown' also stops the server.\n");
+		printf("\n");
+		printf("    -incremental-check\n");
+		printf("        in builds with assertions, the consistency check of the design after\n");
+		printf("        each command only checks the cells whose ports were changed since the\n");
+		printf("        last check (and all wires, memories and connections). changes of cell\n");
+		printf("        parameters alone are not detected. (independent of this option, the\n");
+		printf("        modules of large designs are checked in parallel with -j)\n");
+		printf("\n");
+		printf("    -tmpdir <dir>\n");
+		printf("        create the temporary files and directories (e.g. of abc and of the\n");
+		printf("        -j worker processes) in the given directory. the default is the\n");
+		printf("        value of $YOSYS_TMPDIR, or /dev/shm if it exists and is writable,\n");
+		printf("        or /tmp otherwise\n");
+		printf("\n");
+		printf("    -startup-profile\n");
+		printf("        print the time spent in static initialization, setup and loading\n");
+		printf("        plugins, and the total time until the first command is executed,\n");
+		printf("        to stderr\n");
+		printf("\n");
 		printf("The option -S is an shortcut for calling the \"synth\" command, a default\n");
 		printf("script for transforming the Verilog input to a gate-level netlist. For example:\n");
 		printf("\n");
@@ -233,7 +629,7 @@ int main(int argc, char **argv)
 	}
 
 	int opt;
-	while ((opt = getopt(argc, argv, "MXAQTVSm:f:Hh:b:o:p:l:L:qv:tds:c:")) != -1)
+	while ((opt = getopt(argc, argv, "MXAQTVSm:f:Hh:b:o:p:l:L:qv:tdPJ:F:j:C:s:c:")) != -1)
 	{
 		switch (opt)
 		{
@@ -307,6 +703,27 @@ int main(int argc, char **argv)
 		case 'd':
 			timing_details = true;
 			break;
+		case 'P':
+			print_profile = true;
+			pass_profile_enabled = true;
+			break;
+		case 'J':
+			profile_trace_file = optarg;
+			pass_profile_enabled = true;
+			break;
+		case 'F':
+			sample_file = optarg;
+			break;
+		case 'C':
+			yosys_module_cache_dir = optarg;
+			break;
+		case 'j':
+			yosys_jobs = atoi(optarg);
+			if (yosys_jobs < 1) {
+				fprintf(stderr, "Invalid number of jobs: %s\n", optarg);
+				exit(1);
+			}
+			break;
 		case 's':
 			scriptfile = optarg;
 			scriptfile_tcl = false;
@@ -329,17 +746,41 @@ int main(int argc, char **argv)
 	if (print_banner)
 		yosys_banner();
 
-	if (print_stats)
+	// the log hash is only needed if someone sees the footer, and without it
+	// "yosys -q" does not need to format the suppressed log messages at all
+	if (print_stats && (!log_files.empty() || (mode_v && !mode_q)))
 		log_hasher = new SHA1;
 
 	yosys_setup();
+	int64_t setup_ns = PerformanceTimer::query();
+
+	if (!sample_file.empty()) {
+#ifdef YOSYS_ENABLE_SAMPLING
+		start_sampling();
+#else
+		log_error("The sampling profiler (-F) is not supported on this platform.\n");
+#endif
+	}
 
 	for (auto &fn : plugin_filenames)
 		load_plugin(fn, {});
 
-	if (optind == argc && passes_commands.size() == 0 && scriptfile.empty()) {
+	if (startup_profile)
+		report_startup_profile(main_ns, setup_ns, PerformanceTimer::query());
+
+	if (!server_socket.empty() && !got_output_filename)
+		backend_command = "";
+
+	if (optind == argc && passes_commands.size() == 0 && scriptfile.empty() && server_socket.empty()) {
 		if (!got_output_filename)
 			backend_command = "";
+#ifdef YOSYS_ENABLE_READLINE
+		if (getenv("HOME") != NULL) {
+			history_file = stringf("%s/.yosys_history", getenv("HOME"));
+			read_history(history_file.c_str());
+			history_offset = where_history();
+		}
+#endif
 		shell(yosys_design);
 	}
 
@@ -364,9 +805,17 @@ int main(int argc, char **argv)
 	if (!backend_command.empty())
 		run_backend(output_filename, backend_command);
 
+	if (!server_socket.empty()) {
+#ifdef YOSYS_ENABLE_SERVER
+		run_server(server_socket);
+#else
+		log_error("Server mode (-server) is not supported on this platform.\n");
+#endif
+	}
+
 	if (print_stats)
 	{
-		std::string hash = log_hasher->final().substr(0, 10);
+		std::string hash = log_hasher ? log_hasher->final().substr(0, 10) : "n/a";
 		delete log_hasher;
 		log_hasher = nullptr;
 
@@ -419,6 +868,7 @@ int main(int argc, char **argv)
 				log("%5d%% %5d calls %8.3f sec %s\n", int(100*std::get<0>(*it) / total_ns),
 						std::get<1>(*it), std::get<0>(*it) / 1000000000.0, std::get<2>(*it).c_str());
 			}
+			log_counters();
 		}
 		else
 		{
@@ -436,6 +886,17 @@ int main(int argc, char **argv)
 		}
 	}
 
+	if (print_profile)
+		log_pass_profile();
+
+	if (!profile_trace_file.empty())
+		write_pass_profile_trace(profile_trace_file);
+
+#ifdef YOSYS_ENABLE_SAMPLING
+	if (!sample_file.empty())
+		write_samples(sample_file);
+#endif
+
 #if defined(YOSYS_ENABLE_COVER) && defined(__linux__)
 	if (getenv("YOSYS_COVER_DIR") || getenv("YOSYS_COVER_FILE"))
 	{
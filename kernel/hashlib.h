@@ -16,10 +16,31 @@
 #include <string>
 #include <vector>
 
+#if defined(HASHLIB_SWISSTABLE) && defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 namespace hashlib {
 
+// HASHLIB_SMALL (make SMALL=1) trades lookup speed for memory: the hashtables
+// have one bucket per entry instead of three and small dicts are searched
+// linearly up to twice the size.
+#ifdef HASHLIB_SMALL
+const int hashtable_size_trigger = 1;
+const int hashtable_size_factor = 1;
+#else
 const int hashtable_size_trigger = 2;
 const int hashtable_size_factor = 3;
+#endif
+
+// dicts with at most this many entries have no hashtable and are searched
+// linearly. most dicts in a netlist are tiny (cell ports, parameters and
+// attributes), and for them the hashtable costs more memory than the entries.
+#ifdef HASHLIB_SMALL
+const int hashtable_linear_limit = 16;
+#else
+const int hashtable_linear_limit = 8;
+#endif
 
 // The XOR version of DJB2
 inline unsigned int mkhash(unsigned int a, unsigned int b) {
@@ -49,6 +70,18 @@ inline unsigned int mkhash_xorshift(unsigned int a) {
 	return a;
 }
 
+// The finalizer of MurmurHash3 (multiply and xorshift). Much better mixing
+// than the djb2 functions above, use it for values that are combined with
+// others that are similar to them, so that the combination does not collide.
+inline unsigned int mkhash_finalize(unsigned int a) {
+	a ^= a >> 16;
+	a *= 0x85ebca6b;
+	a ^= a >> 13;
+	a *= 0xc2b2ae35;
+	a ^= a >> 16;
+	return a;
+}
+
 template<typename T> struct hash_ops {
 	static inline bool cmp(const T &a, const T &b) {
 		return a == b;
@@ -95,7 +128,7 @@ template<typename P, typename Q> struct hash_ops<std::pair<P, Q>> {
 		return a == b;
 	}
 	static inline unsigned int hash(std::pair<P, Q> a) {
-		return mkhash(hash_ops<P>::hash(a.first), hash_ops<Q>::hash(a.second));
+		return mkhash(mkhash_finalize(hash_ops<P>::hash(a.first)), hash_ops<Q>::hash(a.second));
 	}
 };
 
@@ -190,6 +223,195 @@ inline int hashtable_size(int min_size)
 	throw std::length_error("hash table exceeded maximum size.");
 }
 
+#ifdef HASHLIB_COUNTERS
+// number of times the index of a dict<> or pool<> has been rebuilt
+inline long long &rehash_counter() {
+	static long long counter = 0;
+	return counter;
+}
+#  define HASHLIB_COUNT_REHASH() rehash_counter()++
+#else
+#  define HASHLIB_COUNT_REHASH() do { } while (0)
+#endif
+
+#ifdef HASHLIB_SWISSTABLE
+// Open addressing index for the entries vector of dict<> and pool<>, used
+// instead of the hashtable of chained entries when HASHLIB_SWISSTABLE is
+// defined. The slots are organized in groups of 16, with one control byte
+// per slot that is either empty, deleted, or holds the low 7 bits of the
+// hash of the entry in that slot. A lookup compares all control bytes of a
+// group with the hash bits at once (using SSE2 if available) and only
+// compares the keys for matching slots. Groups are probed in triangular
+// order until a group with an empty slot is found.
+class hashindex
+{
+	enum { group_size = 16 };
+	enum : signed char { ctrl_empty = -128, ctrl_deleted = -2 };
+
+	std::vector<signed char> ctrl;
+	std::vector<int> slots;
+	int num_used = 0;
+
+	// the hash functions used in yosys are fast but not well distributed
+	static inline unsigned int mix(unsigned int h) {
+		h ^= h >> 16;
+		h *= 0x85ebca6b;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35;
+		h ^= h >> 16;
+		return h;
+	}
+
+	static inline int first_bit(unsigned int mask) {
+#ifdef __GNUC__
+		return __builtin_ctz(mask);
+#else
+		int i = 0;
+		while (((mask >> i) & 1) == 0)
+			i++;
+		return i;
+#endif
+	}
+
+	// bitmask of the slots in a group with the given control byte
+	static inline unsigned int match(const signed char *group, signed char c) {
+#ifdef __SSE2__
+		__m128i data = _mm_loadu_si128((const __m128i*)group);
+		return _mm_movemask_epi8(_mm_cmpeq_epi8(data, _mm_set1_epi8(c)));
+#else
+		unsigned int mask = 0;
+		for (int i = 0; i < group_size; i++)
+			if (group[i] == c)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+	// bitmask of the empty and deleted slots in a group
+	static inline unsigned int match_free(const signed char *group) {
+#ifdef __SSE2__
+		return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+		unsigned int mask = 0;
+		for (int i = 0; i < group_size; i++)
+			if (group[i] < 0)
+				mask |= 1 << i;
+		return mask;
+#endif
+	}
+
+	// find the slot holding the entry index 'index'
+	int find_slot(unsigned int hash, int index) const
+	{
+		unsigned int h = mix(hash);
+		size_t group_mask = slots.size() / group_size - 1;
+		size_t group = (h >> 7) & group_mask;
+
+		for (size_t step = 1;; step++) {
+			const signed char *group_ctrl = &ctrl[group * group_size];
+			for (unsigned int mask = match(group_ctrl, h & 0x7f); mask; mask &= mask - 1) {
+				int slot = group * group_size + first_bit(mask);
+				if (slots[slot] == index)
+					return slot;
+			}
+			if (match(group_ctrl, ctrl_empty))
+				throw std::runtime_error("hashindex: entry not found.");
+			group = (group + step) & group_mask;
+		}
+	}
+
+public:
+	bool empty() const {
+		return slots.empty();
+	}
+
+	void clear() {
+		ctrl.clear();
+		slots.clear();
+		num_used = 0;
+	}
+
+	void swap(hashindex &other) {
+		ctrl.swap(other.ctrl);
+		slots.swap(other.slots);
+		std::swap(num_used, other.num_used);
+	}
+
+	// true if one more slot can not be used without exceeding the maximum load factor of 7/8
+	bool full() const {
+		return (num_used + 1) * 8 > int(slots.size()) * 7;
+	}
+
+	// remove all entries and resize for (at least) the given number of entries
+	void reset(size_t min_entries)
+	{
+		size_t capacity = group_size;
+		while (capacity * 7 < min_entries * 8 + 8)
+			capacity *= 2;
+
+		ctrl.clear();
+		ctrl.resize(capacity, ctrl_empty);
+		slots.clear();
+		slots.resize(capacity, -1);
+		num_used = 0;
+	}
+
+	// return the entry index for which match_entry() returns true, or -1
+	template<typename F>
+	int find(unsigned int hash, F match_entry) const
+	{
+		if (slots.empty())
+			return -1;
+
+		unsigned int h = mix(hash);
+		size_t group_mask = slots.size() / group_size - 1;
+		size_t group = (h >> 7) & group_mask;
+
+		for (size_t step = 1;; step++) {
+			const signed char *group_ctrl = &ctrl[group * group_size];
+			for (unsigned int mask = match(group_ctrl, h & 0x7f); mask; mask &= mask - 1) {
+				int index = slots[group * group_size + first_bit(mask)];
+				if (match_entry(index))
+					return index;
+			}
+			if (match(group_ctrl, ctrl_empty))
+				return -1;
+			group = (group + step) & group_mask;
+		}
+	}
+
+	// add an entry index that is not in the index yet (the caller must check full() first)
+	void insert(unsigned int hash, int index)
+	{
+		unsigned int h = mix(hash);
+		size_t group_mask = slots.size() / group_size - 1;
+		size_t group = (h >> 7) & group_mask;
+
+		for (size_t step = 1;; step++) {
+			unsigned int mask = match_free(&ctrl[group * group_size]);
+			if (mask) {
+				int slot = group * group_size + first_bit(mask);
+				if (ctrl[slot] == ctrl_empty)
+					num_used++;
+				ctrl[slot] = h & 0x7f;
+				slots[slot] = index;
+				return;
+			}
+			group = (group + step) & group_mask;
+		}
+	}
+
+	// change the entry index stored for an entry, or remove it if new_index is -1
+	void replace(unsigned int hash, int old_index, int new_index)
+	{
+		int slot = find_slot(hash, old_index);
+		slots[slot] = new_index;
+		if (new_index < 0)
+			ctrl[slot] = ctrl_deleted;
+	}
+};
+#endif
+
 template<typename K, typename T, typename OPS = hash_ops<K>> class dict;
 template<typename K, int offset = 0, typename OPS = hash_ops<K>> class idict;
 template<typename K, typename OPS = hash_ops<K>> class pool;
@@ -208,7 +430,11 @@ class dict
 		entry_t(std::pair<K, T> &&udata, int next) : udata(std::move(udata)), next(next) { }
 	};
 
+#ifdef HASHLIB_SWISSTABLE
+	hashindex hashtable;
+#else
 	std::vector<int> hashtable;
+#endif
 	std::vector<entry_t> entries;
 	OPS ops;
 
@@ -220,6 +446,68 @@ class dict
 	}
 #endif
 
+#ifdef HASHLIB_SWISSTABLE
+	int do_hash(const K &key) const
+	{
+		return ops.hash(key);
+	}
+
+	void do_rehash()
+	{
+		HASHLIB_COUNT_REHASH();
+		hashtable.reset(std::max(entries.capacity(), 2 * entries.size()));
+		for (int i = 0; i < int(entries.size()); i++)
+			hashtable.insert(do_hash(entries[i].udata.first), i);
+	}
+
+	int do_erase(int index, int hash)
+	{
+		do_assert(index < int(entries.size()));
+		if (hashtable.empty() || index < 0)
+			return 0;
+
+		hashtable.replace(hash, index, -1);
+
+		int back_idx = entries.size()-1;
+
+		if (index != back_idx) {
+			hashtable.replace(do_hash(entries[back_idx].udata.first), back_idx, index);
+			entries[index] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			hashtable.clear();
+
+		return 1;
+	}
+
+	int do_lookup(const K &key, int &hash) const
+	{
+		return hashtable.find(hash, [&](int index) { return ops.cmp(entries[index].udata.first, key); });
+	}
+
+	int do_insert(const K &key, int &hash)
+	{
+		entries.push_back(entry_t(std::pair<K, T>(key, T()), -1));
+		if (hashtable.full())
+			do_rehash();
+		else
+			hashtable.insert(hash, entries.size() - 1);
+		return entries.size() - 1;
+	}
+
+	int do_insert(const std::pair<K, T> &value, int &hash)
+	{
+		entries.push_back(entry_t(value, -1));
+		if (hashtable.full())
+			do_rehash();
+		else
+			hashtable.insert(hash, entries.size() - 1);
+		return entries.size() - 1;
+	}
+#else
 	int do_hash(const K &key) const
 	{
 		unsigned int hash = 0;
@@ -230,7 +518,15 @@ class dict
 
 	void do_rehash()
 	{
+		HASHLIB_COUNT_REHASH();
 		hashtable.clear();
+
+		if (int(entries.size()) <= hashtable_linear_limit) {
+			for (auto &entry : entries)
+				entry.next = -1;
+			return;
+		}
+
 		hashtable.resize(hashtable_size(entries.capacity() * hashtable_size_factor), -1);
 
 		for (int i = 0; i < int(entries.size()); i++) {
@@ -244,9 +540,16 @@ class dict
 	int do_erase(int index, int hash)
 	{
 		do_assert(index < int(entries.size()));
-		if (hashtable.empty() || index < 0)
+		if (index < 0)
 			return 0;
 
+		if (hashtable.empty()) {
+			if (index != int(entries.size())-1)
+				entries[index] = std::move(entries.back());
+			entries.pop_back();
+			return 1;
+		}
+
 		int k = hashtable[hash];
 		do_assert(0 <= k && k < int(entries.size()));
 
@@ -292,8 +595,12 @@ class dict
 
 	int do_lookup(const K &key, int &hash) const
 	{
-		if (hashtable.empty())
+		if (hashtable.empty()) {
+			for (int i = 0; i < int(entries.size()); i++)
+				if (ops.cmp(entries[i].udata.first, key))
+					return i;
 			return -1;
+		}
 
 		if (entries.size() * hashtable_size_trigger > hashtable.size()) {
 			((dict*)this)->do_rehash();
@@ -314,8 +621,10 @@ class dict
 	{
 		if (hashtable.empty()) {
 			entries.push_back(entry_t(std::pair<K, T>(key, T()), -1));
-			do_rehash();
-			hash = do_hash(key);
+			if (int(entries.size()) > hashtable_linear_limit) {
+				do_rehash();
+				hash = do_hash(key);
+			}
 		} else {
 			entries.push_back(entry_t(std::pair<K, T>(key, T()), hashtable[hash]));
 			hashtable[hash] = entries.size() - 1;
@@ -327,8 +636,10 @@ class dict
 	{
 		if (hashtable.empty()) {
 			entries.push_back(entry_t(value, -1));
-			do_rehash();
-			hash = do_hash(value.first);
+			if (int(entries.size()) > hashtable_linear_limit) {
+				do_rehash();
+				hash = do_hash(value.first);
+			}
 		} else {
 			entries.push_back(entry_t(value, hashtable[hash]));
 			hashtable[hash] = entries.size() - 1;
@@ -336,6 +647,8 @@ class dict
 		return entries.size() - 1;
 	}
 
+#endif
+
 public:
 	class const_iterator : public std::iterator<std::forward_iterator_tag, std::pair<K, T>>
 	{
@@ -454,6 +767,30 @@ public:
 		return ++it;
 	}
 
+	// erase all entries for which pred(entry) is true in one pass. the order of
+	// the remaining entries is preserved and the hash table is rebuilt once.
+	template<typename Predicate>
+	int erase_if(Predicate pred)
+	{
+		int new_size = 0;
+		for (int i = 0; i < int(entries.size()); i++) {
+			if (pred(const_cast<const std::pair<K, T>&>(entries[i].udata)))
+				continue;
+			if (new_size != i)
+				entries[new_size] = std::move(entries[i]);
+			entries[new_size++].next = -1;
+		}
+		int count = int(entries.size()) - new_size;
+		if (count == 0)
+			return 0;
+		entries.erase(entries.begin() + new_size, entries.end());
+		if (entries.empty())
+			hashtable.clear();
+		else
+			do_rehash();
+		return count;
+	}
+
 	int count(const K &key) const
 	{
 		int hash = do_hash(key);
@@ -550,6 +887,25 @@ public:
 		return !operator==(other);
 	}
 
+#if !defined(NDEBUG) && !defined(HASHLIB_SWISSTABLE)
+	// number of hash buckets, of buckets with entries, and the length of the
+	// longest collision chain (for checking the quality of hash functions)
+	void collision_stats(int &num_buckets, int &used_buckets, int &max_chain) const
+	{
+		num_buckets = hashtable.size();
+		used_buckets = 0;
+		max_chain = 0;
+		for (int index : hashtable) {
+			int len = 0;
+			for (; index >= 0; index = entries[index].next)
+				len++;
+			if (len > 0)
+				used_buckets++;
+			max_chain = std::max(max_chain, len);
+		}
+	}
+#endif
+
 	void reserve(size_t n) { entries.reserve(n); }
 	size_t size() const { return entries.size(); }
 	bool empty() const { return entries.empty(); }
@@ -577,7 +933,11 @@ protected:
 		entry_t(const K &udata, int next) : udata(udata), next(next) { }
 	};
 
+#ifdef HASHLIB_SWISSTABLE
+	hashindex hashtable;
+#else
 	std::vector<int> hashtable;
+#endif
 	std::vector<entry_t> entries;
 	OPS ops;
 
@@ -589,6 +949,58 @@ protected:
 	}
 #endif
 
+#ifdef HASHLIB_SWISSTABLE
+	int do_hash(const K &key) const
+	{
+		return ops.hash(key);
+	}
+
+	void do_rehash()
+	{
+		HASHLIB_COUNT_REHASH();
+		hashtable.reset(std::max(entries.capacity(), 2 * entries.size()));
+		for (int i = 0; i < int(entries.size()); i++)
+			hashtable.insert(do_hash(entries[i].udata), i);
+	}
+
+	int do_erase(int index, int hash)
+	{
+		do_assert(index < int(entries.size()));
+		if (hashtable.empty() || index < 0)
+			return 0;
+
+		hashtable.replace(hash, index, -1);
+
+		int back_idx = entries.size()-1;
+
+		if (index != back_idx) {
+			hashtable.replace(do_hash(entries[back_idx].udata), back_idx, index);
+			entries[index] = std::move(entries[back_idx]);
+		}
+
+		entries.pop_back();
+
+		if (entries.empty())
+			hashtable.clear();
+
+		return 1;
+	}
+
+	int do_lookup(const K &key, int &hash) const
+	{
+		return hashtable.find(hash, [&](int index) { return ops.cmp(entries[index].udata, key); });
+	}
+
+	int do_insert(const K &value, int &hash)
+	{
+		entries.push_back(entry_t(value, -1));
+		if (hashtable.full())
+			do_rehash();
+		else
+			hashtable.insert(hash, entries.size() - 1);
+		return entries.size() - 1;
+	}
+#else
 	int do_hash(const K &key) const
 	{
 		unsigned int hash = 0;
@@ -599,6 +1011,7 @@ protected:
 
 	void do_rehash()
 	{
+		HASHLIB_COUNT_REHASH();
 		hashtable.clear();
 		hashtable.resize(hashtable_size(entries.capacity() * hashtable_size_factor), -1);
 
@@ -688,6 +1101,8 @@ protected:
 		return entries.size() - 1;
 	}
 
+#endif
+
 public:
 	class const_iterator : public std::iterator<std::forward_iterator_tag, K>
 	{
@@ -794,6 +1209,30 @@ public:
 		return ++it;
 	}
 
+	// erase all entries for which pred(entry) is true in one pass. the order of
+	// the remaining entries is preserved and the hash table is rebuilt once.
+	template<typename Predicate>
+	int erase_if(Predicate pred)
+	{
+		int new_size = 0;
+		for (int i = 0; i < int(entries.size()); i++) {
+			if (pred(const_cast<const K&>(entries[i].udata)))
+				continue;
+			if (new_size != i)
+				entries[new_size] = std::move(entries[i]);
+			entries[new_size++].next = -1;
+		}
+		int count = int(entries.size()) - new_size;
+		if (count == 0)
+			return 0;
+		entries.erase(entries.begin() + new_size, entries.end());
+		if (entries.empty())
+			hashtable.clear();
+		else
+			do_rehash();
+		return count;
+	}
+
 	int count(const K &key) const
 	{
 		int hash = do_hash(key);
@@ -867,6 +1306,25 @@ public:
 		return !operator==(other);
 	}
 
+#if !defined(NDEBUG) && !defined(HASHLIB_SWISSTABLE)
+	// number of hash buckets, of buckets with entries, and the length of the
+	// longest collision chain (for checking the quality of hash functions)
+	void collision_stats(int &num_buckets, int &used_buckets, int &max_chain) const
+	{
+		num_buckets = hashtable.size();
+		used_buckets = 0;
+		max_chain = 0;
+		for (int index : hashtable) {
+			int len = 0;
+			for (; index >= 0; index = entries[index].next)
+				len++;
+			if (len > 0)
+				used_buckets++;
+			max_chain = std::max(max_chain, len);
+		}
+	}
+#endif
+
 	void reserve(size_t n) { entries.reserve(n); }
 	size_t size() const { return entries.size(); }
 	bool empty() const { return entries.empty(); }
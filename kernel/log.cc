@@ -46,13 +46,21 @@ SHA1 *log_hasher = NULL;
 bool log_time = false;
 bool log_error_stderr = false;
 bool log_cmd_error_throw = false;
+bool log_error_throw = false;
 bool log_quiet_warnings = false;
 int log_verbose_level;
 string log_last_error;
 
 vector<int> header_count;
-pool<RTLIL::IdString> log_id_cache;
-vector<shared_str> string_buf;
+
+// Strings returned by log_signal() and IdStrings referenced by log_id() must
+// stay valid for the log statement that uses them. Both are kept in ring
+// buffers of fixed size, so memory stays flat however often they are called.
+#define LOG_STRING_BUF_SIZE 100
+#define LOG_ID_CACHE_SIZE 1000
+vector<RTLIL::IdString> log_id_cache;
+int log_id_cache_index = -1;
+std::string string_buf[LOG_STRING_BUF_SIZE];
 int string_buf_index = -1;
 
 static struct timeval initial_tv = { 0, 0 };
@@ -81,6 +89,21 @@ int gettimeofday(struct timeval *tv, struct timezone *tz)
 
 void logv(const char *format, va_list ap)
 {
+	if (!log_active()) {
+		// nothing would see the message, so skip formatting it and only
+		// keep track of the trailing newlines for log_spacer()
+		int len = strlen(format), nl_count = 0;
+		while (nl_count < len && format[len-nl_count-1] == '\n')
+			nl_count++;
+		if (nl_count == len)
+			log_newline_count += nl_count;
+		else
+			log_newline_count = nl_count;
+		if (log_time && len > 0)
+			next_print_log = format[len-1] == '\n';
+		return;
+	}
+
 	while (format[0] == '\n' && format[1] != 0) {
 		log("\n");
 		format++;
@@ -174,9 +197,7 @@ void logv_warning(const char *format, va_list ap)
 
 void logv_error(const char *format, va_list ap)
 {
-#ifdef EMSCRIPTEN
 	auto backup_log_files = log_files;
-#endif
 
 	if (log_errfile != NULL)
 		log_files.push_back(log_errfile);
@@ -194,6 +215,10 @@ void logv_error(const char *format, va_list ap)
 	log_files = backup_log_files;
 	throw 0;
 #else
+	if (log_error_throw) {
+		log_files = backup_log_files;
+		throw log_cmd_error_exception();
+	}
 	exit(1);
 #endif
 }
@@ -259,8 +284,7 @@ void log_pop()
 {
 	header_count.pop_back();
 	log_id_cache.clear();
-	string_buf.clear();
-	string_buf_index = -1;
+	log_id_cache_index = -1;
 	log_flush();
 }
 
@@ -362,8 +386,7 @@ void log_reset_stack()
 	while (header_count.size() > 1)
 		header_count.pop_back();
 	log_id_cache.clear();
-	string_buf.clear();
-	string_buf_index = -1;
+	log_id_cache_index = -1;
 	log_flush();
 }
 
@@ -386,23 +409,28 @@ void log_dump_val_worker(RTLIL::SigSpec v) {
 
 const char *log_signal(const RTLIL::SigSpec &sig, bool autoint)
 {
-	std::stringstream buf;
+	static std::stringstream buf;
+	buf.str(std::string());
+	buf.clear();
 	ILANG_BACKEND::dump_sigspec(buf, sig, autoint);
 
-	if (string_buf.size() < 100) {
-		string_buf.push_back(buf.str());
-		return string_buf.back().c_str();
-	} else {
-		if (++string_buf_index == 100)
-			string_buf_index = 0;
-		string_buf[string_buf_index] = buf.str();
-		return string_buf[string_buf_index].c_str();
-	}
+	// slots are reused without freeing them, so their capacity is recycled.
+	// the array never moves, so earlier results stay valid for the next
+	// LOG_STRING_BUF_SIZE calls.
+	if (++string_buf_index == LOG_STRING_BUF_SIZE)
+		string_buf_index = 0;
+	string_buf[string_buf_index].assign(buf.str());
+	return string_buf[string_buf_index].c_str();
 }
 
 const char *log_id(RTLIL::IdString str)
 {
-	log_id_cache.insert(str);
+	if (++log_id_cache_index == LOG_ID_CACHE_SIZE)
+		log_id_cache_index = 0;
+	if (log_id_cache_index == GetSize(log_id_cache))
+		log_id_cache.push_back(str);
+	else
+		log_id_cache[log_id_cache_index] = str;
 	const char *p = str.c_str();
 	if (p[0] != '\\')
 		return p;
@@ -471,5 +499,35 @@ dict<std::string, std::pair<std::string, int>> get_coverage_data()
 
 #endif
 
-YOSYS_NAMESPACE_END
+#ifdef YOSYS_ENABLE_COUNTERS
+LogCounter *log_counter_list = nullptr;
+
+LogCounter::LogCounter(const char *name) : name(name), value(0), next(log_counter_list)
+{
+	log_counter_list = this;
+}
+#endif
 
+void log_counters()
+{
+#ifdef YOSYS_ENABLE_COUNTERS
+	std::map<std::string, int64_t> counters;
+	for (LogCounter *p = log_counter_list; p != nullptr; p = p->next)
+		counters[p->name] += p->value;
+#  ifdef HASHLIB_COUNTERS
+	counters["kernel.hashlib.rehash"] += hashlib::rehash_counter();
+#  endif
+
+	bool first = true;
+	for (auto &it : counters) {
+		if (it.second == 0)
+			continue;
+		if (first)
+			log("Operation counters:\n");
+		log("%15lld %s\n", (long long)it.second, it.first.c_str());
+		first = false;
+	}
+#endif
+}
+
+YOSYS_NAMESPACE_END
@@ -53,10 +53,18 @@ extern SHA1 *log_hasher;
 extern bool log_time;
 extern bool log_error_stderr;
 extern bool log_cmd_error_throw;
+extern bool log_error_throw;
 extern bool log_quiet_warnings;
 extern int log_verbose_level;
 extern string log_last_error;
 
+// Returns false if log() output would be discarded (e.g. "yosys -q" without
+// log file). Use it to skip building expensive message arguments such as
+// log_signal() strings in per-cell loops.
+static inline bool log_active() {
+	return !log_files.empty() || !log_streams.empty() || log_hasher != nullptr;
+}
+
 void logv(const char *format, va_list ap);
 void logv_header(const char *format, va_list ap);
 void logv_warning(const char *format, va_list ap);
@@ -145,6 +153,38 @@ std::string cover_list_worker(std::string prefix, std::string first, T... rest)
 #endif
 
 
+// ---------------------------------------------------
+// Operation counters for profiling hot loops
+// ---------------------------------------------------
+
+// log_count("opt_muxtree.eval_mux", 1) adds to a named counter. The counters
+// are printed by log_counters() with the detailed timing stats (yosys -d)
+// and compile to nothing without YOSYS_ENABLE_COUNTERS (ENABLE_COUNTERS=0).
+// Counters with the same name in different places are summed up.
+
+#ifdef YOSYS_ENABLE_COUNTERS
+
+struct LogCounter {
+	const char *name;
+	int64_t value;
+	LogCounter *next;
+	LogCounter(const char *name);
+};
+
+extern LogCounter *log_counter_list;
+
+#define log_count(_name, _n) do { \
+    static YOSYS_NAMESPACE_PREFIX LogCounter __c(_name); \
+    __c.value += (_n); \
+} while (0)
+
+#else
+#  define log_count(...) do { } while (0)
+#endif
+
+void log_counters();
+
+
 // ------------------------------------------------------------
 // everything below this line are utilities for troubleshooting
 // ------------------------------------------------------------
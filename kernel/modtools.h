@@ -103,10 +103,8 @@ struct ModIndex : public RTLIL::Monitor
 
 	void reload_module(bool reset_sigmap = true)
 	{
-		if (reset_sigmap) {
-			sigmap.clear();
-			sigmap.set(module);
-		}
+		if (reset_sigmap)
+			sigmap = module->sigmap();
 
 		database.clear();
 		for (auto wire : module->wires())
@@ -226,7 +224,7 @@ struct ModIndex : public RTLIL::Monitor
 		auto_reload_module = true;
 	}
 
-	ModIndex(RTLIL::Module *_m) : sigmap(_m), module(_m)
+	ModIndex(RTLIL::Module *_m) : module(_m)
 	{
 		auto_reload_counter = 0;
 		auto_reload_module = true;
@@ -396,7 +394,7 @@ struct ModWalker
 
 		ct.clear();
 		ct.setup(design);
-		sigmap.set(module);
+		sigmap = module->sigmap();
 
 		signal_drivers.clear();
 		signal_consumers.clear();
@@ -577,6 +575,98 @@ struct ModWalker
 	}
 };
 
+// The $equiv cells of a module, split into proven cells (A and B connected to
+// the same signal) and unproven cells, see Module::equiv_index(). The index is
+// updated when the ports of a $equiv cell change or when $equiv cells are added
+// or removed, so that the equiv_* passes do not need to scan the whole module.
+// Changing the type of an existing cell to or from $equiv is not tracked.
+struct EquivIndex : public RTLIL::Monitor
+{
+	RTLIL::Module *module;
+	pool<RTLIL::Cell*> proven, unproven;
+	bool valid;
+
+	EquivIndex(RTLIL::Module *module) : module(module), valid(false)
+	{
+		module->monitors.insert(this);
+	}
+
+	~EquivIndex()
+	{
+		module->monitors.erase(this);
+	}
+
+	void reload()
+	{
+		if (valid)
+			return;
+
+		proven.clear();
+		unproven.clear();
+
+		for (auto cell : module->cells())
+			if (cell->type == "$equiv") {
+				if (cell->getPort("\\A") == cell->getPort("\\B"))
+					proven.insert(cell);
+				else
+					unproven.insert(cell);
+			}
+
+		valid = true;
+	}
+
+	int count() {
+		reload();
+		return GetSize(proven) + GetSize(unproven);
+	}
+
+	// the selected cells of proven or unproven, sorted by name
+	std::vector<RTLIL::Cell*> selected(const pool<RTLIL::Cell*> &cells) const
+	{
+		RTLIL::ModuleSelection sel(module->design, module);
+		std::vector<RTLIL::Cell*> result;
+		for (auto cell : cells)
+			if (sel.selected(cell))
+				result.push_back(cell);
+		std::sort(result.begin(), result.end(), RTLIL::sort_by_name_id<RTLIL::Cell>());
+		return result;
+	}
+
+	virtual void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port, const RTLIL::SigSpec&, RTLIL::SigSpec &sig) YS_OVERRIDE
+	{
+		if (!valid || cell->type != "$equiv")
+			return;
+
+		proven.erase(cell);
+		unproven.erase(cell);
+
+		// a port is disconnected when the cell is removed
+		if (GetSize(sig) == 0)
+			return;
+
+		// in a batch we are called after the port has changed, otherwise before
+		RTLIL::SigSpec sig_a, sig_b;
+		if (port == "\\A")
+			sig_a = sig;
+		else if (cell->hasPort("\\A"))
+			sig_a = cell->getPort("\\A");
+		if (port == "\\B")
+			sig_b = sig;
+		else if (cell->hasPort("\\B"))
+			sig_b = cell->getPort("\\B");
+
+		if (sig_a == sig_b)
+			proven.insert(cell);
+		else
+			unproven.insert(cell);
+	}
+
+	virtual void notify_blackout(RTLIL::Module*) YS_OVERRIDE
+	{
+		valid = false;
+	}
+};
+
 YOSYS_NAMESPACE_END
 
 #endif
@@ -19,12 +19,18 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "backends/ilang/ilang_backend.h"
+#include "libs/sha1/sha1.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 
+#ifndef _WIN32
+#  include <unistd.h>
+#endif
+
 YOSYS_NAMESPACE_BEGIN
 
 #define MAX_REG_COUNT 1000
@@ -39,6 +45,52 @@ std::map<std::string, Backend*> backend_register;
 
 std::vector<std::string> Frontend::next_args;
 
+bool pass_profile_enabled = false;
+std::vector<PassProfileNode> pass_profile_nodes;
+std::vector<PassProfileEvent> pass_profile_events;
+std::vector<PassProfileSample> pass_profile_samples;
+static int pass_profile_current = 0;
+
+std::vector<std::string> pass_call_args;
+
+Pass *pass_stack[PASS_STACK_SIZE];
+volatile int pass_stack_depth = 0;
+char pass_stack_module[128];
+
+// current and peak resident set size in kB (zero where not available)
+static void get_memory_usage(int64_t &rss_kb, int64_t &peak_kb)
+{
+	rss_kb = 0, peak_kb = 0;
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f != NULL) {
+		long long sz_total, sz_resident;
+		if (fscanf(f, "%lld %lld", &sz_total, &sz_resident) == 2)
+			rss_kb = sz_resident * (getpagesize() / 1024);
+		fclose(f);
+	}
+#endif
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#  ifdef __APPLE__
+		peak_kb = ru.ru_maxrss / 1024;
+#  else
+		peak_kb = ru.ru_maxrss;
+#  endif
+	}
+#endif
+}
+
+static int live_idstring_count()
+{
+#ifdef YOSYS_THREADSAFE_IDSTRING
+	return RTLIL::IdString::global_id_count_ - GetSize(RTLIL::IdString::global_free_idx_list_);
+#else
+	return GetSize(RTLIL::IdString::global_id_storage_) - GetSize(RTLIL::IdString::global_free_idx_list_);
+#endif
+}
+
 Pass::Pass(std::string name, std::string short_help) : pass_name(name), short_help(short_help)
 {
 	next_queued_pass = first_queued_pass;
@@ -79,18 +131,170 @@ Pass::pre_post_exec_state_t Pass::pre_execute()
 	call_counter++;
 	state.begin_ns = PerformanceTimer::query();
 	state.parent_pass = current_pass;
+	state.parent_profile_node = pass_profile_current;
+	state.parent_stack_depth = pass_stack_depth;
+	if (pass_stack_depth < PASS_STACK_SIZE)
+		pass_stack[pass_stack_depth] = this;
+	pass_stack_depth = pass_stack_depth + 1;
+	state.begin_rss_kb = 0;
+	state.begin_peak_kb = 0;
 	current_pass = this;
+	if (pass_profile_enabled) {
+		if (pass_profile_nodes.empty()) {
+			pass_profile_nodes.push_back(PassProfileNode());
+			pass_profile_nodes.back().parent = -1;
+			pass_profile_nodes.back().call_counter = 0;
+			pass_profile_nodes.back().runtime_ns = 0;
+			pass_profile_nodes.back().rss_delta_kb = 0;
+			pass_profile_nodes.back().peak_growth_kb = 0;
+		}
+		auto &children = pass_profile_nodes[pass_profile_current].children;
+		if (children.count(pass_name) == 0) {
+			PassProfileNode node;
+			node.name = pass_name;
+			node.parent = pass_profile_current;
+			node.call_counter = 0;
+			node.runtime_ns = 0;
+			node.rss_delta_kb = 0;
+			node.peak_growth_kb = 0;
+			children[pass_name] = GetSize(pass_profile_nodes);
+			pass_profile_nodes.push_back(node);
+		}
+		pass_profile_current = pass_profile_nodes[pass_profile_current].children.at(pass_name);
+		get_memory_usage(state.begin_rss_kb, state.begin_peak_kb);
+		state.begin_ns = PerformanceTimer::query();
+	}
 	clear_flags();
 	return state;
 }
 
 void Pass::post_execute(Pass::pre_post_exec_state_t state)
 {
-	int64_t time_ns = PerformanceTimer::query() - state.begin_ns;
+	int64_t end_ns = PerformanceTimer::query();
+	int64_t time_ns = end_ns - state.begin_ns;
 	runtime_ns += time_ns;
 	current_pass = state.parent_pass;
+	pass_stack_depth = state.parent_stack_depth;
 	if (current_pass)
 		current_pass->runtime_ns -= time_ns;
+	if (pass_profile_enabled && pass_profile_current != 0) {
+		int64_t rss_kb, peak_kb;
+		get_memory_usage(rss_kb, peak_kb);
+		PassProfileNode &node = pass_profile_nodes[pass_profile_current];
+		node.call_counter++;
+		node.runtime_ns += time_ns;
+		node.rss_delta_kb += rss_kb - state.begin_rss_kb;
+		node.peak_growth_kb = std::max(node.peak_growth_kb, peak_kb - state.begin_peak_kb);
+		if (state.parent_profile_node == 0) {
+			pass_profile_nodes[0].runtime_ns += time_ns;
+			pass_profile_nodes[0].peak_growth_kb = std::max(pass_profile_nodes[0].peak_growth_kb, peak_kb);
+		}
+		PassProfileEvent event;
+		event.node = pass_profile_current;
+		event.begin_ns = state.begin_ns;
+		event.end_ns = end_ns;
+		event.rss_kb = rss_kb;
+		pass_profile_events.push_back(event);
+	}
+	pass_profile_current = state.parent_profile_node;
+}
+
+void pass_profile_add_module(RTLIL::Module *module, int64_t runtime_ns)
+{
+	if (pass_profile_enabled && pass_profile_current != 0)
+		pass_profile_nodes[pass_profile_current].module_runtime_ns[log_id(module)] += runtime_ns;
+}
+
+void pass_stack_set_module(RTLIL::Module *module)
+{
+	// the first character is written last, so that a signal handler sees
+	// either an empty or a complete name
+	pass_stack_module[0] = 0;
+	if (module == nullptr)
+		return;
+	const char *name = log_id(module);
+	strncpy(pass_stack_module + 1, name + 1, sizeof(pass_stack_module) - 2);
+	pass_stack_module[sizeof(pass_stack_module) - 1] = 0;
+	pass_stack_module[0] = name[0];
+}
+
+static void log_pass_profile_node(int idx, int depth, int64_t total_ns)
+{
+	const PassProfileNode &node = pass_profile_nodes[idx];
+
+	std::vector<std::pair<int64_t, int>> children;
+	int64_t self_ns = node.runtime_ns;
+	for (auto &it : node.children) {
+		children.push_back(std::pair<int64_t, int>(-pass_profile_nodes[it.second].runtime_ns, it.second));
+		self_ns -= pass_profile_nodes[it.second].runtime_ns;
+	}
+	std::sort(children.begin(), children.end());
+
+	if (idx != 0) {
+		log("%5.1f%% %9.3f %9.3f %7d %9.1f %9.1f  %*s%s\n", 100.0 * node.runtime_ns / total_ns, node.runtime_ns / 1e9,
+				self_ns / 1e9, node.call_counter, node.rss_delta_kb / 1024.0, node.peak_growth_kb / 1024.0,
+				2*depth, "", node.name.c_str());
+
+		std::vector<std::pair<int64_t, std::string>> modules;
+		for (auto &it : node.module_runtime_ns)
+			modules.push_back(std::pair<int64_t, std::string>(-it.second, it.first));
+		std::sort(modules.begin(), modules.end());
+		for (int i = 0; i < GetSize(modules) && i < 5; i++)
+			log("%5.1f%% %9.3f %37s  %*s[%s]\n", -100.0 * modules[i].first / total_ns, -modules[i].first / 1e9,
+					"", 2*depth+2, "", modules[i].second.c_str());
+		if (GetSize(modules) > 5)
+			log("%55s  %*s[.. %d more modules]\n", "", 2*depth+2, "", GetSize(modules) - 5);
+	}
+
+	for (auto &it : children)
+		log_pass_profile_node(it.second, idx == 0 ? 0 : depth+1, total_ns);
+}
+
+void log_pass_profile()
+{
+	if (pass_profile_nodes.empty())
+		return;
+
+	log("Pass profile (total and self time in seconds, RSS change and peak RSS growth in MB):\n");
+	log("%6s %9s %9s %7s %9s %9s  %s\n", "", "total", "self", "calls", "rss", "peak", "command");
+	log_pass_profile_node(0, 0, std::max(pass_profile_nodes[0].runtime_ns, int64_t(1)));
+
+	log("\nDesign size after each top-level command:\n");
+	log("%9s %9s %7s %9s %9s %9s  %s\n", "rss", "peak", "modules", "cells", "wires", "idstrings", "command");
+	for (auto &sample : pass_profile_samples)
+		log("%9.1f %9.1f %7d %9d %9d %9d  %s\n", sample.rss_kb / 1024.0, sample.peak_kb / 1024.0, sample.modules,
+				sample.cells, sample.wires, sample.idstrings, pass_profile_nodes[sample.node].name.c_str());
+}
+
+void write_pass_profile_trace(std::string filename)
+{
+	FILE *f = fopen(filename.c_str(), "w");
+	if (f == NULL)
+		log_error("Can't open profile file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+
+	// Chrome trace event format ("complete" events, timestamps in us),
+	// this can be loaded in chrome://tracing, Perfetto and speedscope
+	int64_t start_ns = 0;
+	for (auto &event : pass_profile_events)
+		if (start_ns == 0 || event.begin_ns < start_ns)
+			start_ns = event.begin_ns;
+
+	// memory and design size are added as counter events
+	fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+	for (int i = 0; i < GetSize(pass_profile_events); i++) {
+		const PassProfileEvent &event = pass_profile_events[i];
+		fprintf(f, "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"rss_mb\": %.1f}}",
+				i ? "," : "", pass_profile_nodes[event.node].name.c_str(),
+				(event.begin_ns - start_ns) / 1e3, (event.end_ns - event.begin_ns) / 1e3, event.rss_kb / 1024.0);
+		fprintf(f, ",\n{\"name\": \"memory\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": {\"rss_mb\": %.1f}}",
+				(event.end_ns - start_ns) / 1e3, event.rss_kb / 1024.0);
+	}
+	for (auto &sample : pass_profile_samples)
+		fprintf(f, ",\n{\"name\": \"design\", \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"args\": "
+				"{\"cells\": %d, \"wires\": %d, \"idstrings\": %d}}", (sample.end_ns - start_ns) / 1e3,
+				sample.cells, sample.wires, sample.idstrings);
+	fprintf(f, "\n]}\n");
+	fclose(f);
 }
 
 void Pass::help()
@@ -227,13 +431,36 @@ void Pass::call(RTLIL::Design *design, std::vector<std::string> args)
 	if (pass_register.count(args[0]) == 0)
 		log_cmd_error("No such command: %s (type 'help' for a command overview)\n", args[0].c_str());
 
+	if (!pass_register[args[0]]->read_only())
+		design->unshare_modules();
+
 	size_t orig_sel_stack_pos = design->selection_stack.size();
+	std::vector<std::string> orig_pass_call_args = pass_call_args;
+	pass_call_args = args;
 	auto state = pass_register[args[0]]->pre_execute();
+	int profile_node = pass_profile_current;
 	pass_register[args[0]]->execute(args, design);
 	pass_register[args[0]]->post_execute(state);
+	pass_call_args.swap(orig_pass_call_args);
 	while (design->selection_stack.size() > orig_sel_stack_pos)
 		design->selection_stack.pop_back();
 
+	if (pass_profile_enabled && state.parent_profile_node == 0) {
+		PassProfileSample sample;
+		sample.node = profile_node;
+		sample.end_ns = PerformanceTimer::query();
+		get_memory_usage(sample.rss_kb, sample.peak_kb);
+		sample.modules = GetSize(design->modules_);
+		sample.cells = 0;
+		sample.wires = 0;
+		for (auto &it : design->modules_) {
+			sample.cells += GetSize(it.second->cells_);
+			sample.wires += GetSize(it.second->wires_);
+		}
+		sample.idstrings = live_idstring_count();
+		pass_profile_samples.push_back(sample);
+	}
+
 	design->check();
 }
 
@@ -305,6 +532,8 @@ bool ScriptPass::check_label(std::string label, std::string info)
 			if (label == active_run_to)
 				block_active = false;
 		}
+		if (block_active && !checkpoint_dir.empty())
+			checkpoint_label(label);
 		return block_active;
 	}
 }
@@ -316,8 +545,81 @@ void ScriptPass::run(std::string command, std::string info)
 			log("        %s\n", command.c_str());
 		else
 			log("        %s    %s\n", command.c_str(), info.c_str());
-	} else
+	} else if (!checkpoint_dir.empty()) {
+		checkpoint_pending.push_back(std::pair<bool, std::string>(false, command));
+		checkpoint_hash = sha1(checkpoint_hash + "\n" + command);
+	} else if (pipeline && pipeline_command(command)) {
+		pipeline_pending.push_back(command);
+	} else {
+		pipeline_flush();
 		Pass::call(active_design, command);
+	}
+}
+
+bool ScriptPass::pipeline_command(std::string command)
+{
+	std::vector<std::string> args = split_tokens(command);
+	if (args.empty() || pass_register.count(args[0]) == 0)
+		return false;
+
+	for (auto &arg : args)
+		if (arg[0] == '#' || arg[0] == '!' || arg.back() == ';')
+			return false;
+
+	return pass_register.at(args[0])->module_local(args);
+}
+
+void ScriptPass::pipeline_flush()
+{
+	if (pipeline_pending.empty())
+		return;
+
+	std::vector<std::string> commands;
+	commands.swap(pipeline_pending);
+	run_module_pipeline(active_design, active_design->selected_modules(), commands);
+}
+
+// The checkpoint for a label is named after a hash of the design at the start
+// of the script and of all commands run before the label. Nothing is executed
+// until the end of the script, so that the last existing checkpoint is used.
+void ScriptPass::checkpoint_label(std::string label)
+{
+	std::string filename = stringf("%s/%s.rtlb", checkpoint_dir.c_str(), checkpoint_hash.c_str());
+
+	if (check_file_exists(filename)) {
+		checkpoint_pending.clear();
+		checkpoint_resume = filename;
+		checkpoint_resume_label = label;
+	} else
+		checkpoint_pending.push_back(std::pair<bool, std::string>(true, filename));
+}
+
+void ScriptPass::checkpoint_flush()
+{
+	if (!checkpoint_resume.empty()) {
+		log("Resuming from checkpoint `%s' at label `%s'.\n", checkpoint_resume.c_str(), checkpoint_resume_label.c_str());
+		for (auto mod : active_design->modules().to_vector())
+			active_design->remove(mod);
+		Pass::call(active_design, std::vector<std::string>{"read_rtlil_bin", checkpoint_resume});
+	}
+
+	for (auto &it : checkpoint_pending) {
+		if (it.first) {
+			// write to a temporary name first so that an interrupted run
+			// never leaves a truncated checkpoint behind
+			std::string tmp_file = make_temp_file(it.second + ".XXXXXX");
+			Pass::call(active_design, std::vector<std::string>{"write_rtlil_bin", tmp_file});
+			if (rename(tmp_file.c_str(), it.second.c_str()) != 0) {
+				log_warning("Can't write checkpoint file `%s'.\n", it.second.c_str());
+				remove(tmp_file.c_str());
+			}
+		} else
+			Pass::call(active_design, it.second);
+	}
+
+	checkpoint_pending.clear();
+	checkpoint_resume.clear();
+	checkpoint_resume_label.clear();
 }
 
 void ScriptPass::run_script(RTLIL::Design *design, std::string run_from, std::string run_to)
@@ -327,7 +629,25 @@ void ScriptPass::run_script(RTLIL::Design *design, std::string run_from, std::st
 	block_active = run_from.empty();
 	active_run_from = run_from;
 	active_run_to = run_to;
+	pipeline_pending.clear();
+
+	if (pipeline && !checkpoint_dir.empty())
+		log_cmd_error("Pipelined execution can't be combined with checkpoints.\n");
+
+	if (!checkpoint_dir.empty()) {
+		if (!check_file_exists(checkpoint_dir))
+			log_cmd_error("Checkpoint directory `%s' does not exist.\n", checkpoint_dir.c_str());
+		std::stringstream buf;
+		buf << yosys_version_str << "\n" << pass_name << "\n";
+		ILANG_BACKEND::dump_design(buf, design, false);
+		checkpoint_hash = sha1(buf.str());
+	}
+
 	script();
+
+	if (!checkpoint_dir.empty())
+		checkpoint_flush();
+	pipeline_flush();
 }
 
 void ScriptPass::help_script()
@@ -419,12 +739,7 @@ void Frontend::extra_args(std::istream *&f, std::string &filename, std::vector<s
 			f = new std::istringstream(last_here_document);
 		} else {
 			rewrite_filename(filename);
-			std::ifstream *ff = new std::ifstream;
-			ff->open(filename.c_str());
-			if (ff->fail())
-				delete ff;
-			else
-				f = ff;
+			f = open_input_file(filename);
 		}
 		if (f == NULL)
 			log_cmd_error("Can't open input file `%s' for reading: %s\n", filename.c_str(), strerror(errno));
@@ -466,6 +781,8 @@ void Frontend::frontend_call(RTLIL::Design *design, std::istream *f, std::string
 	if (frontend_register.count(args[0]) == 0)
 		log_cmd_error("No such frontend: %s\n", args[0].c_str());
 
+	design->unshare_modules();
+
 	if (f != NULL) {
 		auto state = frontend_register[args[0]]->pre_execute();
 		frontend_register[args[0]]->execute(f, filename, args, design);
@@ -533,13 +850,9 @@ void Backend::extra_args(std::ostream *&f, std::string &filename, std::vector<st
 		}
 
 		filename = arg;
-		std::ofstream *ff = new std::ofstream;
-		ff->open(filename.c_str(), std::ofstream::trunc);
-		if (ff->fail()) {
-			delete ff;
+		f = open_output_file(filename);
+		if (f == NULL)
 			log_cmd_error("Can't open output file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
-		}
-		f = ff;
 	}
 
 	if (called_with_fp)
@@ -593,7 +906,8 @@ void Backend::backend_call(RTLIL::Design *design, std::ostream *f, std::string f
 	design->check();
 }
 
-static struct CellHelpMessages {
+// only built when 'help' needs it, not on every startup
+struct CellHelpMessages {
 	dict<string, string> cell_help, cell_code;
 	CellHelpMessages() {
 #include "techlibs/common/simlib_help.inc"
@@ -601,10 +915,19 @@ static struct CellHelpMessages {
 		cell_help.sort();
 		cell_code.sort();
 	}
-} cell_help_messages;
+};
+
+static CellHelpMessages &cell_help_messages()
+{
+	static CellHelpMessages *messages = nullptr;
+	if (messages == nullptr)
+		messages = new CellHelpMessages;
+	return *messages;
+}
 
 struct HelpPass : public Pass {
 	HelpPass() : Pass("help", "display help messages") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		log("\n");
@@ -700,7 +1023,7 @@ struct HelpPass : public Pass {
 			}
 			else if (args[1] == "-cells") {
 				log("\n");
-				for (auto &it : cell_help_messages.cell_help) {
+				for (auto &it : cell_help_messages().cell_help) {
 					string line = split_tokens(it.second, "\n").at(0);
 					string cell_name = next_token(line);
 					log("    %-15s %s\n", cell_name.c_str(), line.c_str());
@@ -738,14 +1061,14 @@ struct HelpPass : public Pass {
 			else if (pass_register.count(args[1])) {
 				pass_register.at(args[1])->help();
 			}
-			else if (cell_help_messages.cell_help.count(args[1])) {
-				log("%s", cell_help_messages.cell_help.at(args[1]).c_str());
+			else if (cell_help_messages().cell_help.count(args[1])) {
+				log("%s", cell_help_messages().cell_help.at(args[1]).c_str());
 				log("Run 'help %s+' to display the Verilog model for this cell type.\n", args[1].c_str());
 				log("\n");
 			}
-			else if (cell_help_messages.cell_code.count(args[1])) {
+			else if (cell_help_messages().cell_code.count(args[1])) {
 				log("\n");
-				log("%s", cell_help_messages.cell_code.at(args[1]).c_str());
+				log("%s", cell_help_messages().cell_code.at(args[1]).c_str());
 			}
 			else
 				log("No such command or cell type: %s\n", args[1].c_str());
@@ -758,6 +1081,7 @@ struct HelpPass : public Pass {
 
 struct EchoPass : public Pass {
 	EchoPass() : Pass("echo", "turning echoing back of commands on and off") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		log("\n");
@@ -797,7 +1121,10 @@ struct MinisatSatSolver : public SatSolver {
 		yosys_satsolver = this;
 	}
 	virtual ezSAT *create() YS_OVERRIDE {
-		return new ezMiniSAT();
+		ezMiniSAT *ez = new ezMiniSAT();
+		if (yosys_jobs > 1)
+			ez->setPortfolio(yosys_jobs);
+		return ez;
 	}
 } MinisatSatSolver;
 
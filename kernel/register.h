@@ -34,12 +34,23 @@ struct Pass
 	virtual void clear_flags();
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design) = 0;
 
+	// commands that never modify modules return true here, so that running them
+	// does not copy modules that are shared with saved designs
+	virtual bool read_only() { return false; }
+
+	// commands that only read and modify the selected modules (and no other
+	// part of the design) return true here, so that script passes can run
+	// them for each module independently (see ScriptPass::pipeline)
+	virtual bool module_local(const std::vector<std::string> & /* args */) { return false; }
+
 	int call_counter;
 	int64_t runtime_ns;
 
 	struct pre_post_exec_state_t {
 		Pass *parent_pass;
-		int64_t begin_ns;
+		int parent_profile_node;
+		int64_t begin_ns, begin_rss_kb, begin_peak_kb;
+		int parent_stack_depth;
 	};
 
 	pre_post_exec_state_t pre_execute();
@@ -70,7 +81,16 @@ struct ScriptPass : Pass
 	RTLIL::Design *active_design;
 	std::string active_run_from, active_run_to;
 
-	ScriptPass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help) { }
+	// when set, the design is saved to this directory at each label and the
+	// script is resumed from the last label whose checkpoint is found there
+	std::string checkpoint_dir;
+
+	// when set, consecutive module local commands are collected and then run
+	// with run_module_pipeline(), so that each module goes through them on its
+	// own in a worker process. other commands wait for all modules.
+	bool pipeline;
+
+	ScriptPass(std::string name, std::string short_help = "** document me **") : Pass(name, short_help), pipeline(false) { }
 
 	virtual void script() = 0;
 
@@ -78,6 +98,18 @@ struct ScriptPass : Pass
 	void run(std::string command, std::string info = std::string());
 	void run_script(RTLIL::Design *design, std::string run_from = std::string(), std::string run_to = std::string());
 	void help_script();
+
+private:
+	// commands (first=false) and checkpoints to write (first=true) that are
+	// not executed yet, because a later checkpoint may make them unnecessary
+	std::vector<std::pair<bool, std::string>> checkpoint_pending;
+	std::string checkpoint_hash, checkpoint_resume, checkpoint_resume_label;
+	void checkpoint_label(std::string label);
+	void checkpoint_flush();
+
+	std::vector<std::string> pipeline_pending;
+	bool pipeline_command(std::string command);
+	void pipeline_flush();
 };
 
 struct Frontend : Pass
@@ -108,6 +140,7 @@ struct Backend : Pass
 	virtual ~Backend();
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE YS_FINAL;
 	virtual void execute(std::ostream *&f, std::string filename,  std::vector<std::string> args, RTLIL::Design *design) = 0;
+	virtual bool read_only() YS_OVERRIDE { return true; }
 
 	void extra_args(std::ostream *&f, std::string &filename, std::vector<std::string> args, size_t argidx);
 
@@ -124,6 +157,57 @@ extern std::map<std::string, Pass*> pass_register;
 extern std::map<std::string, Frontend*> frontend_register;
 extern std::map<std::string, Backend*> backend_register;
 
+// Call tree of executed commands, recorded when pass_profile_enabled is set
+// (command line options -P and -J). Node 0 is the root. A command that is
+// called from different parent commands gets one node per call site.
+// rss_delta_kb is the summed change of the resident set size over all calls,
+// peak_growth_kb the largest increase of the peak RSS during a single call.
+struct PassProfileNode
+{
+	std::string name;
+	int parent, call_counter;
+	int64_t runtime_ns, rss_delta_kb, peak_growth_kb;
+	dict<std::string, int> children;
+	dict<std::string, int64_t> module_runtime_ns;
+};
+
+struct PassProfileEvent
+{
+	int node;
+	int64_t begin_ns, end_ns, rss_kb;
+};
+
+// design size after a top-level command
+struct PassProfileSample
+{
+	int node;
+	int64_t end_ns, rss_kb, peak_kb;
+	int modules, cells, wires, idstrings;
+};
+
+extern bool pass_profile_enabled;
+extern std::vector<PassProfileNode> pass_profile_nodes;
+extern std::vector<PassProfileEvent> pass_profile_events;
+extern std::vector<PassProfileSample> pass_profile_samples;
+
+// arguments of the innermost running command (used as part of the key for
+// the module result cache in run_module_jobs())
+extern std::vector<std::string> pass_call_args;
+
+// Stack of running commands and the name of the module that is processed
+// by run_module_jobs(), for the sampling profiler (command line option -F).
+// They are only updated with plain stores, so a signal handler can read them.
+#define PASS_STACK_SIZE 16
+extern Pass *pass_stack[PASS_STACK_SIZE];
+extern volatile int pass_stack_depth;
+extern char pass_stack_module[128];
+
+// attribute time spent on one module to the currently running command
+void pass_profile_add_module(RTLIL::Module *module, int64_t runtime_ns);
+void pass_stack_set_module(RTLIL::Module *module);
+void log_pass_profile();
+void write_pass_profile_trace(std::string filename);
+
 YOSYS_NAMESPACE_END
 
 #endif
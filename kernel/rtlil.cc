@@ -20,6 +20,8 @@
 #include "kernel/yosys.h"
 #include "kernel/macc.h"
 #include "kernel/celltypes.h"
+#include "kernel/sigtools.h"
+#include "kernel/modtools.h"
 #include "frontends/verilog/verilog_frontend.h"
 #include "backends/ilang/ilang_backend.h"
 
@@ -28,11 +30,125 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+// defined before the destruct guard, so that their destructors run when the
+// guard already turns put_reference() into a no-op
+#define X(_id) const RTLIL::IdString ID::_id(RTLIL::IdString::static_index_t{ID::STATIC_ID_ ## _id});
+#include "kernel/constids.inc"
+#undef X
+
 RTLIL::IdString::destruct_guard_t RTLIL::IdString::destruct_guard;
+#ifdef YOSYS_THREADSAFE_IDSTRING
+RTLIL::IdString::global_id_segment_t *RTLIL::IdString::global_id_segments_[RTLIL::IdString::global_id_max_segments_];
+RTLIL::IdString::global_id_shard_t RTLIL::IdString::global_id_shards_storage_[RTLIL::IdString::global_id_shards_];
+std::mutex RTLIL::IdString::global_free_idx_mutex_;
+std::vector<int> RTLIL::IdString::global_free_idx_list_;
+int RTLIL::IdString::global_id_count_;
+#else
 std::vector<int> RTLIL::IdString::global_refcount_storage_;
 std::vector<char*> RTLIL::IdString::global_id_storage_;
 dict<char*, int, hash_cstr_ops> RTLIL::IdString::global_id_index_;
 std::vector<int> RTLIL::IdString::global_free_idx_list_;
+std::vector<std::string> RTLIL::IdString::global_autoid_locs_;
+dict<int, int> RTLIL::IdString::global_autoid_index_;
+#if UINTPTR_MAX <= 0xffffffffu
+std::vector<int> RTLIL::IdString::global_autoid_loc_storage_;
+#endif
+#endif
+
+#ifdef YOSYS_THREADSAFE_IDSTRING
+char *RTLIL::IdString::materialize_autoid(int)
+{
+	log_abort();
+}
+#else
+static dict<std::string, int> global_autoid_loc_index;
+
+std::string RTLIL::IdString::autoid_str(int idx)
+{
+	return stringf("$auto$%s$%d", global_autoid_locs_.at(autoid_loc(idx)).c_str(), autoid_num(global_id_storage_.at(idx)));
+}
+
+char *RTLIL::IdString::materialize_autoid(int idx)
+{
+	char *p = global_id_storage_.at(idx);
+	if (!is_autoid(p))
+		return p;
+
+	// the text can exist already when a frontend imported a name that NEW_ID
+	// created in another session. this id was never used by its text, so it
+	// gets an extra suffix instead. (autoidx is not used for this, because
+	// c_str() must not change it, see ILANG_BACKEND::dump_design().)
+	std::string str = autoid_str(idx);
+	for (int k = 1; global_id_index_.count((char*)str.c_str()) != 0; k++)
+		str = stringf("%s$%d", autoid_str(idx).c_str(), k);
+	global_autoid_index_.erase(autoid_num(p));
+
+	p = strdup(str.c_str());
+	global_id_storage_.at(idx) = p;
+	global_id_index_[p] = idx;
+	return p;
+}
+
+int RTLIL::IdString::lookup_autoid(const char *p)
+{
+	if (strncmp(p, "$auto$", 6) != 0)
+		return -1;
+
+	const char *q = strrchr(p, '$');
+	if (q[1] < '1' || q[1] > '9')
+		return -1;
+
+	char *endptr;
+	long num = strtol(q+1, &endptr, 10);
+	if (*endptr != 0 || num > 0x7fffffff)
+		return -1;
+
+	auto it = global_autoid_index_.find(num);
+	if (it == global_autoid_index_.end() || autoid_str(it->second) != p)
+		return -1;
+
+	int idx = it->second;
+	materialize_autoid(idx);
+	return idx;
+}
+
+int RTLIL::IdString::new_autoid_loc(const std::string &loc)
+{
+	auto it = global_autoid_loc_index.find(loc);
+	if (it != global_autoid_loc_index.end())
+		return it->second;
+
+	int id = GetSize(global_autoid_locs_);
+	log_assert(id < 0x40000000);
+	global_autoid_locs_.push_back(loc);
+	global_autoid_loc_index[loc] = id;
+	return id;
+}
+
+int RTLIL::IdString::new_autoid(int loc, int num)
+{
+	log_assert(destruct_guard.ok);
+	log_assert(num > 0 && global_autoid_index_.count(num) == 0);
+
+	if (global_free_idx_list_.empty()) {
+		log_assert(global_id_storage_.size() < 0x40000000);
+		global_free_idx_list_.push_back(global_id_storage_.size());
+		global_id_storage_.push_back(nullptr);
+		global_refcount_storage_.push_back(0);
+	}
+
+	int idx = global_free_idx_list_.back();
+	global_free_idx_list_.pop_back();
+	global_id_storage_.at(idx) = autoid_ptr(loc, num);
+	global_autoid_index_[num] = idx;
+#if UINTPTR_MAX <= 0xffffffffu
+	if (GetSize(global_autoid_loc_storage_) <= idx)
+		global_autoid_loc_storage_.resize(global_id_storage_.size());
+	global_autoid_loc_storage_[idx] = loc;
+#endif
+	return idx;
+}
+#endif
 
 RTLIL::Const::Const()
 {
@@ -42,6 +158,7 @@ RTLIL::Const::Const()
 RTLIL::Const::Const(std::string str)
 {
 	flags = RTLIL::CONST_FLAG_STRING;
+	bits.reserve(str.size() * 8);
 	for (int i = str.size()-1; i >= 0; i--) {
 		unsigned char ch = str[i];
 		for (int j = 0; j < 8; j++) {
@@ -201,6 +318,64 @@ pool<string> RTLIL::AttrObject::get_strpool_attribute(RTLIL::IdString id) const
 	return data;
 }
 
+namespace {
+	// all "src" attribute values seen by add_src_attribute() and the results
+	// of merging them. the same few location sets are merged over and over
+	// again by techmap and simplemap.
+	struct SrcTable
+	{
+		idict<RTLIL::Const> values;
+		dict<std::pair<int, int>, int> merged;
+
+		const RTLIL::Const &merge(const RTLIL::Const &a, const RTLIL::Const &b)
+		{
+			// most entries are only used by a single cell; don't let the
+			// table grow without bounds
+			if (GetSize(values) > 100000) {
+				values.clear();
+				merged.clear();
+			}
+
+			auto key = std::make_pair(values(a), values(b));
+			auto it = merged.find(key);
+			if (it == merged.end()) {
+				RTLIL::AttrObject obj, other;
+				if (GetSize(a))
+					obj.attributes[ID("\\src")] = a;
+				if (GetSize(b))
+					other.attributes[ID("\\src")] = b;
+				obj.add_strpool_attribute(ID("\\src"), other.get_strpool_attribute(ID("\\src")));
+				it = merged.insert(std::make_pair(key, values(obj.attributes.at(ID("\\src"), RTLIL::Const())))).first;
+			}
+			return values[it->second];
+		}
+	};
+
+	SrcTable src_table;
+}
+
+void RTLIL::AttrObject::set_src_attribute(const std::string &src)
+{
+	if (src.empty())
+		attributes.erase(ID("\\src"));
+	else
+		attributes[ID("\\src")] = src;
+}
+
+std::string RTLIL::AttrObject::get_src_attribute() const
+{
+	auto it = attributes.find(ID("\\src"));
+	return it == attributes.end() ? std::string() : it->second.decode_string();
+}
+
+void RTLIL::AttrObject::add_src_attribute(const RTLIL::Const &src)
+{
+	auto it = attributes.find(ID("\\src"));
+	RTLIL::Const result = src_table.merge(it == attributes.end() ? RTLIL::Const() : it->second, src);
+	if (GetSize(result))
+		attributes[ID("\\src")] = result;
+}
+
 bool RTLIL::Selection::selected_module(RTLIL::IdString mod_name) const
 {
 	if (full_selection)
@@ -227,9 +402,9 @@ bool RTLIL::Selection::selected_member(RTLIL::IdString mod_name, RTLIL::IdString
 		return true;
 	if (selected_modules.count(mod_name) > 0)
 		return true;
-	if (selected_members.count(mod_name) > 0)
-		if (selected_members.at(mod_name).count(memb_name) > 0)
-			return true;
+	auto it = selected_members.find(mod_name);
+	if (it != selected_members.end())
+		return it->second.count(memb_name) > 0;
 	return false;
 }
 
@@ -290,6 +465,39 @@ void RTLIL::Selection::optimize(RTLIL::Design *design)
 	}
 }
 
+RTLIL::ModuleSelection::ModuleSelection(const RTLIL::Design *design, const RTLIL::Module *module)
+{
+	whole_module = design->selected_whole_module(module->name);
+	empty_module = !whole_module && !design->selected_module(module->name);
+
+	if (whole_module || empty_module)
+		return;
+
+	const RTLIL::Selection &sel = design->selection_stack.back();
+	auto it = sel.selected_members.find(module->name);
+	if (it == sel.selected_members.end()) {
+		empty_module = true;
+		return;
+	}
+
+	int max_index = 0;
+	for (auto memb_name : it->second)
+		max_index = std::max(max_index, memb_name.index_);
+
+	members.resize(max_index+1);
+	for (auto memb_name : it->second)
+		members[memb_name.index_] = true;
+}
+
+void RTLIL::Monitor::notify_remove(RTLIL::Module*, const pool<RTLIL::Cell*> &cells)
+{
+	for (auto cell : cells)
+	for (auto &conn : cell->connections()) {
+		RTLIL::SigSpec signal;
+		notify_connect(cell, conn.first, conn.second, signal);
+	}
+}
+
 RTLIL::Design::Design()
 {
 	static unsigned int hashidx_count = 123456789;
@@ -300,10 +508,52 @@ RTLIL::Design::Design()
 	selection_stack.push_back(RTLIL::Selection());
 }
 
+namespace {
+// the cells of each module that passed the last Design::check() and
+// whose ports were not changed since then, for yosys -incremental-check
+struct CheckedCells : RTLIL::Monitor
+{
+	dict<RTLIL::Module*, pool<RTLIL::Cell*>> unchanged;
+
+	void notify_module_del(RTLIL::Module *module) YS_OVERRIDE {
+		unchanged.erase(module);
+	}
+
+	void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString&, const RTLIL::SigSpec&, RTLIL::SigSpec&) YS_OVERRIDE {
+		auto it = unchanged.find(cell->module);
+		if (it != unchanged.end())
+			it->second.erase(cell);
+	}
+
+	void notify_blackout(RTLIL::Module *module) YS_OVERRIDE {
+		unchanged.erase(module);
+	}
+
+	void notify_remove(RTLIL::Module *module, const pool<RTLIL::Cell*> &cells) YS_OVERRIDE {
+		auto it = unchanged.find(module);
+		if (it != unchanged.end())
+			for (auto cell : cells)
+				it->second.erase(cell);
+	}
+};
+
+dict<RTLIL::Design*, CheckedCells*> checked_cells;
+
+// below this number of cells the fork in run_module_dump_jobs() costs
+// more than the check itself
+const int parallel_check_min_cells = 10000;
+}
+
 RTLIL::Design::~Design()
 {
-	for (auto it = modules_.begin(); it != modules_.end(); ++it)
+	auto it = checked_cells.find(this);
+	if (it != checked_cells.end()) {
 		delete it->second;
+		checked_cells.erase(it);
+	}
+
+	for (auto it = modules_.begin(); it != modules_.end(); ++it)
+		release_module(it->second);
 }
 
 RTLIL::ObjRange<RTLIL::Module*> RTLIL::Design::modules()
@@ -440,6 +690,7 @@ void RTLIL::Design::remove(RTLIL::Module *module)
 	}
 
 	log_assert(modules_.at(module->name) == module);
+	log_assert(module->shared_designs_.empty());
 	modules_.erase(module->name);
 	delete module;
 }
@@ -451,6 +702,62 @@ void RTLIL::Design::rename(RTLIL::Module *module, RTLIL::IdString new_name)
 	add(module);
 }
 
+void RTLIL::Design::add_shared(RTLIL::Module *module, bool take_ownership)
+{
+	log_assert(modules_.count(module->name) == 0);
+	log_assert(refcount_modules_ == 0);
+	log_assert(module->design != nullptr && module->design != this);
+	modules_[module->name] = module;
+
+	if (take_ownership) {
+		module->shared_designs_.push_back(module->design);
+		module->design = this;
+	} else
+		module->shared_designs_.push_back(this);
+}
+
+void RTLIL::Design::unshare_modules()
+{
+	log_assert(refcount_modules_ == 0);
+
+	for (auto &it : modules_)
+	{
+		RTLIL::Module *module = it.second;
+		if (module->shared_designs_.empty())
+			continue;
+
+		RTLIL::Module *new_mod = module->clone();
+
+		if (module->design == this) {
+			// keep the original, the other designs share the copy
+			new_mod->design = module->shared_designs_.front();
+			new_mod->shared_designs_.assign(module->shared_designs_.begin()+1, module->shared_designs_.end());
+			for (auto design : module->shared_designs_)
+				design->modules_.at(module->name) = new_mod;
+			module->shared_designs_.clear();
+		} else {
+			auto &shared = module->shared_designs_;
+			shared.erase(std::find(shared.begin(), shared.end(), this));
+			new_mod->design = this;
+			it.second = new_mod;
+		}
+	}
+}
+
+void RTLIL::Design::release_module(RTLIL::Module *module)
+{
+	auto &shared = module->shared_designs_;
+
+	if (shared.empty()) {
+		delete module;
+	} else if (module->design == this) {
+		module->design = shared.back();
+		shared.pop_back();
+	} else {
+		shared.erase(std::find(shared.begin(), shared.end(), this));
+	}
+}
+
 void RTLIL::Design::sort()
 {
 	scratchpad.sort();
@@ -462,12 +769,52 @@ void RTLIL::Design::sort()
 void RTLIL::Design::check()
 {
 #ifndef NDEBUG
+	std::vector<RTLIL::Module*> check_modules;
+	int num_cells = 0;
+
 	for (auto &it : modules_) {
 		log_assert(this == it.second->design);
 		log_assert(it.first == it.second->name);
 		log_assert(!it.first.empty());
-		it.second->check();
+		check_modules.push_back(it.second);
+		num_cells += GetSize(it.second->cells_);
+	}
+
+	CheckedCells *checked = nullptr;
+	if (yosys_incremental_check) {
+		if (checked_cells.count(this) == 0) {
+			checked_cells[this] = new CheckedCells;
+			monitors.insert(checked_cells.at(this));
+		}
+		checked = checked_cells.at(this);
+		num_cells = 0;
+		for (auto module : check_modules)
+			num_cells += GetSize(module->cells_) - GetSize(checked->unchanged[module]);
 	}
+
+	// the modules are checked in forked workers with -j, a failed
+	// log_assert() in a worker is reported as error by the parent
+	std::ostringstream discard;
+	auto job = [&](std::ostream&, RTLIL::Module *module) {
+		if (checked)
+			module->check_incremental(checked->unchanged.at(module));
+		else
+			module->check();
+	};
+
+	if (num_cells >= parallel_check_min_cells)
+		run_module_dump_jobs(check_modules, discard, job);
+	else
+		for (auto module : check_modules)
+			job(discard, module);
+
+	if (checked)
+		for (auto module : check_modules) {
+			pool<RTLIL::Cell*> &unchanged = checked->unchanged.at(module);
+			unchanged.clear();
+			for (auto &it : module->cells_)
+				unchanged.insert(it.second);
+		}
 #endif
 }
 
@@ -561,18 +908,26 @@ RTLIL::Module::Module()
 	design = nullptr;
 	refcount_wires_ = 0;
 	refcount_cells_ = 0;
+	sigmap_cache_ = nullptr;
+	modindex_cache_ = nullptr;
+	equiv_index_cache_ = nullptr;
+	batch_depth_ = 0;
 }
 
 RTLIL::Module::~Module()
 {
+	delete sigmap_cache_;
+	delete modindex_cache_;
+	delete equiv_index_cache_;
 	for (auto it = wires_.begin(); it != wires_.end(); ++it)
-		delete it->second;
+		it->second->~Wire();
 	for (auto it = memories.begin(); it != memories.end(); ++it)
 		delete it->second;
 	for (auto it = cells_.begin(); it != cells_.end(); ++it)
-		delete it->second;
+		it->second->~Cell();
 	for (auto it = processes.begin(); it != processes.end(); ++it)
 		delete it->second;
+	// the storage of all wires and cells is released with the pools
 }
 
 RTLIL::IdString RTLIL::Module::derive(RTLIL::Design*, dict<RTLIL::IdString, RTLIL::Const>)
@@ -1113,6 +1468,11 @@ void RTLIL::Module::sort()
 }
 
 void RTLIL::Module::check()
+{
+	check_incremental(pool<RTLIL::Cell*>());
+}
+
+void RTLIL::Module::check_incremental(const pool<RTLIL::Cell*> &unchanged_cells YS_ATTRIBUTE(unused))
 {
 #ifndef NDEBUG
 	std::vector<bool> ports_declared;
@@ -1151,6 +1511,8 @@ void RTLIL::Module::check()
 	for (auto &it : cells_) {
 		log_assert(this == it.second->module);
 		log_assert(it.first == it.second->name);
+		if (unchanged_cells.count(it.second))
+			continue;
 		log_assert(!it.first.empty());
 		log_assert(!it.second->type.empty());
 		for (auto &it2 : it.second->connections()) {
@@ -1265,20 +1627,26 @@ bool RTLIL::Module::has_processes_warn() const
 
 std::vector<RTLIL::Wire*> RTLIL::Module::selected_wires() const
 {
+	RTLIL::ModuleSelection sel(design, this);
 	std::vector<RTLIL::Wire*> result;
+	if (sel.empty_module)
+		return result;
 	result.reserve(wires_.size());
 	for (auto &it : wires_)
-		if (design->selected(this, it.second))
+		if (sel.selected(it.first))
 			result.push_back(it.second);
 	return result;
 }
 
 std::vector<RTLIL::Cell*> RTLIL::Module::selected_cells() const
 {
+	RTLIL::ModuleSelection sel(design, this);
 	std::vector<RTLIL::Cell*> result;
-	result.reserve(wires_.size());
+	if (sel.empty_module)
+		return result;
+	result.reserve(cells_.size());
 	for (auto &it : cells_)
-		if (design->selected(this, it.second))
+		if (sel.selected(it.first))
 			result.push_back(it.second);
 	return result;
 }
@@ -1321,18 +1689,7 @@ namespace {
 
 void RTLIL::Module::remove(const pool<RTLIL::Wire*> &wires)
 {
-	log_assert(refcount_wires_ == 0);
-
-	DeleteWireWorker delete_wire_worker;
-	delete_wire_worker.module = this;
-	delete_wire_worker.wires_p = &wires;
-	rewrite_sigspecs(delete_wire_worker);
-
-	for (auto &it : wires) {
-		log_assert(wires_.count(it->name) != 0);
-		wires_.erase(it->name);
-		delete it;
-	}
+	remove_batch(pool<RTLIL::Cell*>(), wires);
 }
 
 void RTLIL::Module::remove(RTLIL::Cell *cell)
@@ -1340,10 +1697,74 @@ void RTLIL::Module::remove(RTLIL::Cell *cell)
 	while (!cell->connections_.empty())
 		cell->unsetPort(cell->connections_.begin()->first);
 
+	flush_batch();
+
 	log_assert(cells_.count(cell->name) != 0);
 	log_assert(refcount_cells_ == 0);
 	cells_.erase(cell->name);
-	delete cell;
+	free_cell(cell);
+}
+
+void RTLIL::Module::remove_batch(const pool<RTLIL::Cell*> &cells, const pool<RTLIL::Wire*> &wires)
+{
+	flush_batch();
+
+	if (!cells.empty())
+	{
+		log_assert(refcount_cells_ == 0);
+
+		for (auto mon : monitors)
+			mon->notify_remove(this, cells);
+
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_remove(this, cells);
+
+		if (yosys_xtrace) {
+			for (auto cell : cells)
+			for (auto &conn : cell->connections_)
+				log("#X# Unconnect %s.%s.%s\n", log_id(this), log_id(cell), log_id(conn.first));
+			log_backtrace("-X- ", yosys_xtrace-1);
+		}
+
+		int count YS_ATTRIBUTE(unused) = cells_.erase_if([&](const std::pair<RTLIL::IdString, RTLIL::Cell*> &it) {
+			return cells.count(it.second) != 0;
+		});
+		log_assert(count == GetSize(cells));
+
+		for (auto cell : cells)
+			free_cell(cell);
+	}
+
+	if (!wires.empty())
+	{
+		log_assert(refcount_wires_ == 0);
+
+		DeleteWireWorker delete_wire_worker;
+		delete_wire_worker.module = this;
+		delete_wire_worker.wires_p = &wires;
+		rewrite_sigspecs(delete_wire_worker);
+
+		int count YS_ATTRIBUTE(unused) = wires_.erase_if([&](const std::pair<RTLIL::IdString, RTLIL::Wire*> &it) {
+			return wires.count(it.second) != 0;
+		});
+		log_assert(count == GetSize(wires));
+
+		for (auto wire : wires)
+			free_wire(wire);
+	}
+}
+
+void RTLIL::Module::free_wire(RTLIL::Wire *wire)
+{
+	wire->~Wire();
+	wire_pool_.release(wire);
+}
+
+void RTLIL::Module::free_cell(RTLIL::Cell *cell)
+{
+	cell->~Cell();
+	cell_pool_.release(cell);
 }
 
 void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
@@ -1353,6 +1774,9 @@ void RTLIL::Module::rename(RTLIL::Wire *wire, RTLIL::IdString new_name)
 	wires_.erase(wire->name);
 	wire->name = new_name;
 	add(wire);
+
+	// SigBit hashes and ordering depend on the wire name
+	invalidate_caches();
 }
 
 void RTLIL::Module::rename(RTLIL::Cell *cell, RTLIL::IdString new_name)
@@ -1362,6 +1786,9 @@ void RTLIL::Module::rename(RTLIL::Cell *cell, RTLIL::IdString new_name)
 	cells_.erase(cell->name);
 	cell->name = new_name;
 	add(cell);
+
+	// the ModIndex hashes its port entries by cell name
+	invalidate_caches();
 }
 
 void RTLIL::Module::rename(RTLIL::IdString old_name, RTLIL::IdString new_name)
@@ -1388,6 +1815,8 @@ void RTLIL::Module::swap_names(RTLIL::Wire *w1, RTLIL::Wire *w2)
 
 	wires_[w1->name] = w1;
 	wires_[w2->name] = w2;
+
+	invalidate_caches();
 }
 
 void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
@@ -1403,6 +1832,8 @@ void RTLIL::Module::swap_names(RTLIL::Cell *c1, RTLIL::Cell *c2)
 
 	cells_[c1->name] = c1;
 	cells_[c2->name] = c2;
+
+	invalidate_caches();
 }
 
 RTLIL::IdString RTLIL::Module::uniquify(RTLIL::IdString name)
@@ -1441,13 +1872,18 @@ static bool fixup_ports_compare(const RTLIL::Wire *a, const RTLIL::Wire *b)
 
 void RTLIL::Module::connect(const RTLIL::SigSig &conn)
 {
-	for (auto mon : monitors)
-		mon->notify_connect(this, conn);
-
-	if (design)
-		for (auto mon : design->monitors)
+	if (batch_depth_ > 0 && has_monitors()) {
+		batch_conns_.first.append(conn.first);
+		batch_conns_.second.append(conn.second);
+	} else {
+		for (auto mon : monitors)
 			mon->notify_connect(this, conn);
 
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, conn);
+	}
+
 	// ignore all attempts to assign constants to other constants
 	if (conn.first.has_const()) {
 		RTLIL::SigSig new_conn;
@@ -1474,8 +1910,86 @@ void RTLIL::Module::connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs
 	connect(RTLIL::SigSig(lhs, rhs));
 }
 
+// Appends the bit pairs of conns to connections_, skipping constant lhs bits,
+// self connections and pairs that are already in seen. A pair that extends the
+// last chunk on both sides of the last connection is merged into it.
+static void append_connection_bits(std::vector<RTLIL::SigSig> &connections, const RTLIL::SigSig &conn,
+		pool<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &seen, bool &merge_last)
+{
+	log_assert(GetSize(conn.first) == GetSize(conn.second));
+
+	for (int i = 0; i < GetSize(conn.first); i++)
+	{
+		RTLIL::SigBit lhs = conn.first[i], rhs = conn.second[i];
+		if (lhs.wire == nullptr || lhs == rhs || !seen.insert(std::make_pair(lhs, rhs)).second)
+			continue;
+
+		if (merge_last) {
+			RTLIL::SigSig &last = connections.back();
+			RTLIL::SigBit last_lhs = last.first[GetSize(last.first)-1];
+			RTLIL::SigBit last_rhs = last.second[GetSize(last.second)-1];
+			if (lhs.wire == last_lhs.wire && lhs.offset == last_lhs.offset+1 &&
+					(rhs.wire ? rhs.wire == last_rhs.wire && rhs.offset == last_rhs.offset+1 : last_rhs.wire == nullptr)) {
+				last.first.append_bit(lhs);
+				last.second.append_bit(rhs);
+				continue;
+			}
+		}
+
+		connections.push_back(RTLIL::SigSig(lhs, rhs));
+		merge_last = true;
+	}
+}
+
+void RTLIL::Module::connect_many(const std::vector<RTLIL::SigSig> &conns)
+{
+	for (auto &conn : conns)
+	{
+		if (batch_depth_ > 0 && has_monitors()) {
+			batch_conns_.first.append(conn.first);
+			batch_conns_.second.append(conn.second);
+		} else {
+			for (auto mon : monitors)
+				mon->notify_connect(this, conn);
+
+			if (design)
+				for (auto mon : design->monitors)
+					mon->notify_connect(this, conn);
+		}
+
+		if (yosys_xtrace) {
+			log("#X# Connect (SigSig) in %s: %s = %s (%d bits)\n", log_id(this), log_signal(conn.first), log_signal(conn.second), GetSize(conn.first));
+			log_backtrace("-X- ", yosys_xtrace-1);
+		}
+	}
+
+	// connections that were added before are never merged with or
+	// deduplicated against the new ones, so that their bits keep their order
+	pool<std::pair<RTLIL::SigBit, RTLIL::SigBit>> seen;
+	bool merge_last = false;
+
+	for (auto &conn : conns)
+		append_connection_bits(connections_, conn, seen, merge_last);
+}
+
+void RTLIL::Module::compact_connections()
+{
+	// the set of connected bit pairs does not change, so the monitors (and
+	// the sigmap and modindex caches) do not need to be notified
+	std::vector<RTLIL::SigSig> old_connections;
+	old_connections.swap(connections_);
+
+	pool<std::pair<RTLIL::SigBit, RTLIL::SigBit>> seen;
+	bool merge_last = false;
+
+	for (auto &conn : old_connections)
+		append_connection_bits(connections_, conn, seen, merge_last);
+}
+
 void RTLIL::Module::new_connections(const std::vector<RTLIL::SigSig> &new_conn)
 {
+	flush_batch();
+
 	for (auto mon : monitors)
 		mon->notify_connect(this, new_conn);
 
@@ -1498,6 +2012,104 @@ const std::vector<RTLIL::SigSig> &RTLIL::Module::connections() const
 	return connections_;
 }
 
+const SigMap &RTLIL::Module::sigmap()
+{
+	flush_batch();
+	if (sigmap_cache_ == nullptr)
+		sigmap_cache_ = new ModuleSigMap(this);
+	return sigmap_cache_->get();
+}
+
+void RTLIL::Module::invalidate_caches()
+{
+	// the blackout covers the changes that were not reported yet
+	batch_ports_.clear();
+	batch_conns_ = RTLIL::SigSig();
+
+	// the sigmap and modindex caches are monitors, too
+	for (auto mon : monitors)
+		mon->notify_blackout(this);
+
+	if (design)
+		for (auto mon : design->monitors)
+			mon->notify_blackout(this);
+}
+
+ModIndex &RTLIL::Module::modindex()
+{
+	flush_batch();
+
+	if (modindex_cache_ == nullptr)
+		modindex_cache_ = new ModIndex(this);
+
+	// reloads are expected when the index is re-used by a new pass;
+	// the warning in ModIndex is about reloads within one pass
+	modindex_cache_->auto_reload_counter = 0;
+	return *modindex_cache_;
+}
+
+EquivIndex &RTLIL::Module::equiv_index()
+{
+	flush_batch();
+
+	if (equiv_index_cache_ == nullptr)
+		equiv_index_cache_ = new EquivIndex(this);
+
+	equiv_index_cache_->reload();
+	return *equiv_index_cache_;
+}
+
+void RTLIL::Module::begin_batch()
+{
+	batch_depth_++;
+}
+
+void RTLIL::Module::end_batch()
+{
+	log_assert(batch_depth_ > 0);
+	if (--batch_depth_ == 0)
+		flush_batch();
+}
+
+void RTLIL::Module::flush_batch()
+{
+	if (batch_ports_.empty() && batch_conns_.first.empty())
+		return;
+
+	dict<std::pair<RTLIL::Cell*, RTLIL::IdString>, RTLIL::SigSpec> ports;
+	RTLIL::SigSig conns;
+	ports.swap(batch_ports_);
+	std::swap(conns, batch_conns_);
+
+	for (auto &it : ports)
+	{
+		RTLIL::Cell *cell = it.first.first;
+		auto conn_it = cell->connections_.find(it.first.second);
+		RTLIL::SigSpec unset;
+		RTLIL::SigSpec &signal = conn_it == cell->connections_.end() ? unset : conn_it->second;
+
+		if (it.second == signal)
+			continue;
+
+		for (auto mon : monitors)
+			mon->notify_connect(cell, it.first.second, it.second, signal);
+
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(cell, it.first.second, it.second, signal);
+	}
+
+	if (!conns.first.empty())
+	{
+		for (auto mon : monitors)
+			mon->notify_connect(this, conns);
+
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(this, conns);
+	}
+}
+
 void RTLIL::Module::fixup_ports()
 {
 	std::vector<RTLIL::Wire*> all_ports;
@@ -1515,11 +2127,14 @@ void RTLIL::Module::fixup_ports()
 		ports.push_back(all_ports[i]->name);
 		all_ports[i]->port_id = i+1;
 	}
+
+	// ModIndex caches port_input/port_output
+	invalidate_caches();
 }
 
 RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, int width)
 {
-	RTLIL::Wire *wire = new RTLIL::Wire;
+	RTLIL::Wire *wire = new (wire_pool_.alloc()) RTLIL::Wire;
 	wire->name = name;
 	wire->width = width;
 	add(wire);
@@ -1541,9 +2156,20 @@ RTLIL::Wire *RTLIL::Module::addWire(RTLIL::IdString name, const RTLIL::Wire *oth
 
 RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, RTLIL::IdString type)
 {
-	RTLIL::Cell *cell = new RTLIL::Cell;
+	RTLIL::Cell *cell = new (cell_pool_.alloc()) RTLIL::Cell;
 	cell->name = name;
 	cell->type = type;
+
+	// fine-grained cells are created in large numbers, so their port dict is
+	// allocated with the exact size right away
+	const char *type_str = type.c_str();
+	if (type_str[0] == '$' && type_str[1] == '_') {
+		auto &cell_types = yosys_get_celltypes().cell_types;
+		auto it = cell_types.find(type);
+		if (it != cell_types.end())
+			cell->connections_.reserve(GetSize(it->second.inputs) + GetSize(it->second.outputs));
+	}
+
 	add(cell);
 	return cell;
 }
@@ -1554,6 +2180,20 @@ RTLIL::Cell *RTLIL::Module::addCell(RTLIL::IdString name, const RTLIL::Cell *oth
 	cell->connections_ = other->connections_;
 	cell->parameters = other->parameters;
 	cell->attributes = other->attributes;
+
+	for (auto &conn : cell->connections_) {
+		if (batch_depth_ > 0) {
+			if (has_monitors())
+				batch_ports_.insert(std::make_pair(std::make_pair(cell, conn.first), RTLIL::SigSpec()));
+			continue;
+		}
+		for (auto mon : monitors)
+			mon->notify_connect(cell, conn.first, RTLIL::SigSpec(), conn.second);
+		if (design)
+			for (auto mon : design->monitors)
+				mon->notify_connect(cell, conn.first, RTLIL::SigSpec(), conn.second);
+	}
+
 	return cell;
 }
 
@@ -1973,6 +2613,7 @@ RTLIL::Memory::Memory()
 	hashidx_ = hashidx_count;
 
 	width = 1;
+	start_offset = 0;
 	size = 0;
 }
 
@@ -1998,13 +2639,18 @@ void RTLIL::Cell::unsetPort(RTLIL::IdString portname)
 
 	if (conn_it != connections_.end())
 	{
-		for (auto mon : module->monitors)
-			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
-
-		if (module->design)
-			for (auto mon : module->design->monitors)
+		if (module->batch_depth_ > 0) {
+			if (module->has_monitors())
+				module->batch_ports_.insert(std::make_pair(std::make_pair(this, portname), conn_it->second));
+		} else {
+			for (auto mon : module->monitors)
 				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+			if (module->design)
+				for (auto mon : module->design->monitors)
+					mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+		}
+
 		if (yosys_xtrace) {
 			log("#X# Unconnect %s.%s.%s\n", log_id(this->module), log_id(this), log_id(portname));
 			log_backtrace("-X- ", yosys_xtrace-1);
@@ -2026,19 +2672,24 @@ void RTLIL::Cell::setPort(RTLIL::IdString portname, RTLIL::SigSpec signal)
 	if (conn_it->second == signal)
 		return;
 
-	for (auto mon : module->monitors)
-		mon->notify_connect(this, conn_it->first, conn_it->second, signal);
-
-	if (module->design)
-		for (auto mon : module->design->monitors)
+	if (module->batch_depth_ > 0) {
+		if (module->has_monitors())
+			module->batch_ports_.insert(std::make_pair(std::make_pair(this, portname), conn_it->second));
+	} else {
+		for (auto mon : module->monitors)
 			mon->notify_connect(this, conn_it->first, conn_it->second, signal);
 
+		if (module->design)
+			for (auto mon : module->design->monitors)
+				mon->notify_connect(this, conn_it->first, conn_it->second, signal);
+	}
+
 	if (yosys_xtrace) {
 		log("#X# Connect %s.%s.%s = %s (%d)\n", log_id(this->module), log_id(this), log_id(portname), log_signal(signal), GetSize(signal));
 		log_backtrace("-X- ", yosys_xtrace-1);
 	}
 
-	conn_it->second = signal;
+	conn_it->second = std::move(signal);
 }
 
 const RTLIL::SigSpec &RTLIL::Cell::getPort(RTLIL::IdString portname) const
@@ -2053,7 +2704,7 @@ const dict<RTLIL::IdString, RTLIL::SigSpec> &RTLIL::Cell::connections() const
 
 bool RTLIL::Cell::known() const
 {
-	if (yosys_celltypes.cell_known(type))
+	if (yosys_get_celltypes().cell_known(type))
 		return true;
 	if (module && module->design && module->design->module(type))
 		return true;
@@ -2062,8 +2713,8 @@ bool RTLIL::Cell::known() const
 
 bool RTLIL::Cell::input(RTLIL::IdString portname) const
 {
-	if (yosys_celltypes.cell_known(type))
-		return yosys_celltypes.cell_input(type, portname);
+	if (yosys_get_celltypes().cell_known(type))
+		return yosys_get_celltypes().cell_input(type, portname);
 	if (module && module->design) {
 		RTLIL::Module *m = module->design->module(type);
 		RTLIL::Wire *w = m ? m->wire(portname) : nullptr;
@@ -2074,8 +2725,8 @@ bool RTLIL::Cell::input(RTLIL::IdString portname) const
 
 bool RTLIL::Cell::output(RTLIL::IdString portname) const
 {
-	if (yosys_celltypes.cell_known(type))
-		return yosys_celltypes.cell_output(type, portname);
+	if (yosys_get_celltypes().cell_known(type))
+		return yosys_get_celltypes().cell_output(type, portname);
 	if (module && module->design) {
 		RTLIL::Module *m = module->design->module(type);
 		RTLIL::Wire *w = m ? m->wire(portname) : nullptr;
@@ -2525,10 +3176,14 @@ void RTLIL::SigSpec::unpack() const
 {
 	RTLIL::SigSpec *that = (RTLIL::SigSpec*)this;
 
+	// callers of unpack() usually modify bits_ afterwards
+	that->hash_ = 0;
+
 	if (that->chunks_.empty())
 		return;
 
 	cover("kernel.rtlil.sigspec.convert.unpack");
+	log_count("kernel.sigspec.unpack", 1);
 	log_assert(that->bits_.empty());
 
 	that->bits_.reserve(that->width_);
@@ -2537,7 +3192,15 @@ void RTLIL::SigSpec::unpack() const
 			that->bits_.push_back(RTLIL::SigBit(c, i));
 
 	that->chunks_.clear();
-	that->hash_ = 0;
+}
+
+// the finalizers make sure that different slices of similar wires do not
+// collide (djb2 alone maps many index/offset/width triples to the same hash)
+static inline unsigned int mkhash_wire_chunk(unsigned int hash, int wire_index, int offset, int width)
+{
+	hash = mkhash_finalize(mkhash(hash, wire_index));
+	hash = mkhash_finalize(mkhash(hash, offset));
+	return mkhash_finalize(mkhash(hash, width));
 }
 
 void RTLIL::SigSpec::updhash() const
@@ -2548,19 +3211,46 @@ void RTLIL::SigSpec::updhash() const
 		return;
 
 	cover("kernel.rtlil.sigspec.hash");
-	that->pack();
 
 	that->hash_ = mkhash_init;
-	for (auto &c : that->chunks_)
-		if (c.wire == NULL) {
-			for (auto &v : c.data)
-				that->hash_ = mkhash(that->hash_, v);
-		} else {
-			that->hash_ = mkhash(that->hash_, c.wire->name.index_);
-			that->hash_ = mkhash(that->hash_, c.offset);
-			that->hash_ = mkhash(that->hash_, c.width);
+
+	if (packed())
+	{
+		for (auto &c : that->chunks_)
+			if (c.wire == NULL) {
+				for (auto &v : c.data)
+					that->hash_ = mkhash(that->hash_, v);
+			} else
+				that->hash_ = mkhash_wire_chunk(that->hash_, c.wire->name.index_, c.offset, c.width);
+	}
+	else
+	{
+		// Same hash as for the packed representation, but without
+		// actually packing the bits (and then unpacking them again).
+		RTLIL::Wire *last_wire = NULL;
+		int last_offset = 0, last_width = 0;
+
+		for (auto &bit : that->bits_) {
+			if (bit.wire != NULL && bit.wire == last_wire && last_offset + last_width == bit.offset) {
+				last_width++;
+				continue;
+			}
+			if (last_wire != NULL)
+				that->hash_ = mkhash_wire_chunk(that->hash_, last_wire->name.index_, last_offset, last_width);
+			if (bit.wire == NULL) {
+				that->hash_ = mkhash(that->hash_, bit.data);
+				last_wire = NULL;
+			} else {
+				last_wire = bit.wire;
+				last_offset = bit.offset;
+				last_width = 1;
+			}
 		}
 
+		if (last_wire != NULL)
+			that->hash_ = mkhash_wire_chunk(that->hash_, last_wire->name.index_, last_offset, last_width);
+	}
+
 	if (that->hash_ == 0)
 		that->hash_ = 1;
 }
@@ -2588,6 +3278,10 @@ void RTLIL::SigSpec::sort_and_unify()
 	*this = unique_bits;
 }
 
+// above this number of bit comparisons the pattern based SigSpec functions
+// build a hash index of the pattern instead of comparing every bit pair
+static const int sigspec_pattern_index_threshold = 256;
+
 void RTLIL::SigSpec::replace(const RTLIL::SigSpec &pattern, const RTLIL::SigSpec &with)
 {
 	replace(pattern, with, this);
@@ -2604,11 +3298,29 @@ void RTLIL::SigSpec::replace(const RTLIL::SigSpec &pattern, const RTLIL::SigSpec
 	unpack();
 	other->unpack();
 
-	for (int i = 0; i < GetSize(pattern.bits_); i++) {
-		if (pattern.bits_[i].wire != NULL) {
-			for (int j = 0; j < GetSize(bits_); j++) {
-				if (bits_[j] == pattern.bits_[i]) {
-					other->bits_[j] = with.bits_[i];
+	if (GetSize(pattern.bits_) * GetSize(bits_) > sigspec_pattern_index_threshold)
+	{
+		// later pattern bits take precedence, as in the loop below
+		dict<RTLIL::SigBit, RTLIL::SigBit> rules;
+		rules.reserve(GetSize(pattern.bits_));
+		for (int i = 0; i < GetSize(pattern.bits_); i++)
+			if (pattern.bits_[i].wire != NULL)
+				rules[pattern.bits_[i]] = with.bits_[i];
+
+		for (int j = 0; j < GetSize(bits_); j++) {
+			auto it = rules.find(bits_[j]);
+			if (it != rules.end())
+				other->bits_[j] = it->second;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < GetSize(pattern.bits_); i++) {
+			if (pattern.bits_[i].wire != NULL) {
+				for (int j = 0; j < GetSize(bits_); j++) {
+					if (bits_[j] == pattern.bits_[i]) {
+						other->bits_[j] = with.bits_[i];
+					}
 				}
 			}
 		}
@@ -2683,27 +3395,49 @@ void RTLIL::SigSpec::remove2(const RTLIL::SigSpec &pattern, RTLIL::SigSpec *othe
 	else
 		cover("kernel.rtlil.sigspec.remove");
 
+	if (GetSize(pattern.chunks()) * width_ > sigspec_pattern_index_threshold) {
+		pool<RTLIL::SigBit> pattern_bits;
+		pattern_bits.reserve(GetSize(pattern));
+		for (auto &chunk : pattern.chunks())
+			if (chunk.wire != NULL)
+				for (int i = 0; i < chunk.width; i++)
+					pattern_bits.insert(RTLIL::SigBit(chunk.wire, chunk.offset + i));
+		remove2(pattern_bits, other);
+		return;
+	}
+
 	unpack();
 	if (other != NULL) {
 		log_assert(width_ == other->width_);
 		other->unpack();
 	}
 
-	for (int i = GetSize(bits_) - 1; i >= 0; i--) {
-		if (bits_[i].wire == NULL) continue;
-
-		for (auto &pattern_chunk : pattern.chunks()) {
-			if (bits_[i].wire == pattern_chunk.wire &&
-				bits_[i].offset >= pattern_chunk.offset &&
-				bits_[i].offset < pattern_chunk.offset + pattern_chunk.width) {
-				bits_.erase(bits_.begin() + i);
-				width_--;
-				if (other != NULL) {
-					other->bits_.erase(other->bits_.begin() + i);
-					other->width_--;
+	const std::vector<RTLIL::SigChunk> &pattern_chunks = pattern.chunks();
+
+	int new_width = 0;
+	for (int i = 0; i < width_; i++) {
+		bool matched = false;
+		if (bits_[i].wire != NULL)
+			for (auto &pattern_chunk : pattern_chunks)
+				if (bits_[i].wire == pattern_chunk.wire &&
+					bits_[i].offset >= pattern_chunk.offset &&
+					bits_[i].offset < pattern_chunk.offset + pattern_chunk.width) {
+					matched = true;
+					break;
 				}
-			}
-		}
+		if (matched)
+			continue;
+		bits_[new_width] = bits_[i];
+		if (other != NULL)
+			other->bits_[new_width] = other->bits_[i];
+		new_width++;
+	}
+
+	bits_.resize(new_width);
+	width_ = new_width;
+	if (other != NULL) {
+		other->bits_.resize(new_width);
+		other->width_ = new_width;
 	}
 
 	check();
@@ -2734,15 +3468,21 @@ void RTLIL::SigSpec::remove2(const pool<RTLIL::SigBit> &pattern, RTLIL::SigSpec
 		other->unpack();
 	}
 
-	for (int i = GetSize(bits_) - 1; i >= 0; i--) {
-		if (bits_[i].wire != NULL && pattern.count(bits_[i])) {
-			bits_.erase(bits_.begin() + i);
-			width_--;
-			if (other != NULL) {
-				other->bits_.erase(other->bits_.begin() + i);
-				other->width_--;
-			}
-		}
+	int new_width = 0;
+	for (int i = 0; i < width_; i++) {
+		if (bits_[i].wire != NULL && pattern.count(bits_[i]))
+			continue;
+		bits_[new_width] = bits_[i];
+		if (other != NULL)
+			other->bits_[new_width] = other->bits_[i];
+		new_width++;
+	}
+
+	bits_.resize(new_width);
+	width_ = new_width;
+	if (other != NULL) {
+		other->bits_.resize(new_width);
+		other->width_ = new_width;
 	}
 
 	check();
@@ -2762,15 +3502,21 @@ void RTLIL::SigSpec::remove2(const std::set<RTLIL::SigBit> &pattern, RTLIL::SigS
 		other->unpack();
 	}
 
-	for (int i = GetSize(bits_) - 1; i >= 0; i--) {
-		if (bits_[i].wire != NULL && pattern.count(bits_[i])) {
-			bits_.erase(bits_.begin() + i);
-			width_--;
-			if (other != NULL) {
-				other->bits_.erase(other->bits_.begin() + i);
-				other->width_--;
-			}
-		}
+	int new_width = 0;
+	for (int i = 0; i < width_; i++) {
+		if (bits_[i].wire != NULL && pattern.count(bits_[i]))
+			continue;
+		bits_[new_width] = bits_[i];
+		if (other != NULL)
+			other->bits_[new_width] = other->bits_[i];
+		new_width++;
+	}
+
+	bits_.resize(new_width);
+	width_ = new_width;
+	if (other != NULL) {
+		other->bits_.resize(new_width);
+		other->width_ = new_width;
 	}
 
 	check();
@@ -2787,8 +3533,45 @@ RTLIL::SigSpec RTLIL::SigSpec::extract(const RTLIL::SigSpec &pattern, const RTLI
 
 	RTLIL::SigSpec ret;
 	std::vector<RTLIL::SigBit> bits_match = to_sigbit_vector();
+	const std::vector<RTLIL::SigChunk> &pattern_chunks = pattern.chunks();
 
-	for (auto& pattern_chunk : pattern.chunks()) {
+	if (GetSize(pattern_chunks) * width_ > sigspec_pattern_index_threshold)
+	{
+		// the result is grouped by pattern chunk, and a bit that is in more
+		// than one chunk is extracted once for each of them
+		dict<RTLIL::SigBit, std::vector<int>> bit_chunks;
+		for (int k = 0; k < GetSize(pattern_chunks); k++) {
+			auto &chunk = pattern_chunks[k];
+			if (chunk.wire != NULL)
+				for (int i = 0; i < chunk.width; i++) {
+					std::vector<int> &chunk_list = bit_chunks[RTLIL::SigBit(chunk.wire, chunk.offset + i)];
+					if (chunk_list.empty() || chunk_list.back() != k)
+						chunk_list.push_back(k);
+				}
+		}
+
+		std::vector<std::vector<int>> chunk_matches(GetSize(pattern_chunks));
+		for (int i = 0; i < width_; i++) {
+			if (bits_match[i].wire == NULL)
+				continue;
+			auto it = bit_chunks.find(bits_match[i]);
+			if (it != bit_chunks.end())
+				for (int k : it->second)
+					chunk_matches[k].push_back(i);
+		}
+
+		std::vector<RTLIL::SigBit> bits_other;
+		if (other)
+			bits_other = other->to_sigbit_vector();
+		for (auto &matches : chunk_matches)
+			for (int i : matches)
+				ret.append_bit(other ? bits_other[i] : bits_match[i]);
+
+		ret.check();
+		return ret;
+	}
+
+	for (auto& pattern_chunk : pattern_chunks) {
 		if (other) {
 			std::vector<RTLIL::SigBit> bits_other = other->to_sigbit_vector();
 			for (int i = 0; i < width_; i++)
@@ -2867,7 +3650,11 @@ void RTLIL::SigSpec::remove_const()
 		width_ = 0;
 		for (auto &chunk : chunks_)
 			if (chunk.wire != NULL) {
-				new_chunks.push_back(chunk);
+				if (!new_chunks.empty() && new_chunks.back().wire == chunk.wire &&
+						new_chunks.back().offset + new_chunks.back().width == chunk.offset)
+					new_chunks.back().width += chunk.width;
+				else
+					new_chunks.push_back(chunk);
 				width_ += chunk.width;
 			}
 
@@ -2888,6 +3675,7 @@ void RTLIL::SigSpec::remove_const()
 		width_ = bits_.size();
 	}
 
+	hash_ = 0;
 	check();
 }
 
@@ -2909,8 +3697,34 @@ void RTLIL::SigSpec::remove(int offset, int length)
 
 RTLIL::SigSpec RTLIL::SigSpec::extract(int offset, int length) const
 {
-	unpack();
-	cover("kernel.rtlil.sigspec.extract_pos");
+	log_assert(offset >= 0);
+	log_assert(length >= 0);
+	log_assert(offset + length <= width_);
+
+	if (packed())
+	{
+		cover("kernel.rtlil.sigspec.extract_pos.packed");
+
+		// slices of a packed chunk list are still properly packed
+		RTLIL::SigSpec ret;
+		int chunk_offset = 0;
+
+		for (auto &c : chunks_) {
+			if (chunk_offset >= offset + length)
+				break;
+			int lo = std::max(offset, chunk_offset);
+			int hi = std::min(offset + length, chunk_offset + c.width);
+			if (lo < hi)
+				ret.chunks_.push_back(lo == chunk_offset && hi - lo == c.width ? c : c.extract(lo - chunk_offset, hi - lo));
+			chunk_offset += c.width;
+		}
+
+		ret.width_ = length;
+		ret.check();
+		return ret;
+	}
+
+	cover("kernel.rtlil.sigspec.extract_pos.unpacked");
 	return std::vector<RTLIL::SigBit>(bits_.begin() + offset, bits_.begin() + offset + length);
 }
 
@@ -2950,9 +3764,21 @@ void RTLIL::SigSpec::append(const RTLIL::SigSpec &signal)
 		bits_.insert(bits_.end(), signal.bits_.begin(), signal.bits_.end());
 
 	width_ += signal.width_;
+	hash_ = 0;
 	check();
 }
 
+void RTLIL::SigSpec::append(RTLIL::SigSpec &&signal)
+{
+	if (width_ == 0) {
+		cover("kernel.rtlil.sigspec.append_move");
+		*this = std::move(signal);
+		return;
+	}
+
+	append(static_cast<const RTLIL::SigSpec&>(signal));
+}
+
 void RTLIL::SigSpec::append_bit(const RTLIL::SigBit &bit)
 {
 	if (packed())
@@ -2981,6 +3807,7 @@ void RTLIL::SigSpec::append_bit(const RTLIL::SigBit &bit)
 	}
 
 	width_++;
+	hash_ = 0;
 	check();
 }
 
@@ -3097,10 +3924,18 @@ bool RTLIL::SigSpec::operator ==(const RTLIL::SigSpec &other) const
 	if (width_ != other.width_)
 		return false;
 
+	// compare the bits directly if both sides are unpacked anyways
+	if (!packed() && !other.packed()) {
+		cover("kernel.rtlil.sigspec.comp_eq.unpacked");
+		if (hash_ && other.hash_ && hash_ != other.hash_)
+			return false;
+		return bits_ == other.bits_;
+	}
+
 	pack();
 	other.pack();
 
-	if (chunks_.size() != chunks_.size())
+	if (chunks_.size() != other.chunks_.size())
 		return false;
 
 	updhash();
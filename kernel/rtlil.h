@@ -24,6 +24,11 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+struct SigMap;
+struct ModuleSigMap;
+struct ModIndex;
+struct EquivIndex;
+
 namespace RTLIL
 {
 	enum State : unsigned char {
@@ -55,6 +60,7 @@ namespace RTLIL
 	struct Const;
 	struct AttrObject;
 	struct Selection;
+	struct ModuleSelection;
 	struct Monitor;
 	struct Design;
 	struct Module;
@@ -71,6 +77,8 @@ namespace RTLIL
 	struct SyncRule;
 	struct Process;
 
+	template<typename T> struct ObjectPool;
+
 	typedef std::pair<SigSpec, SigSpec> SigSig;
 
 	struct IdString
@@ -83,11 +91,211 @@ namespace RTLIL
 			~destruct_guard_t() { ok = false; }
 		} destruct_guard;
 
+#ifdef YOSYS_THREADSAFE_IDSTRING
+		// Concurrent variant of the id string cache: the storage is
+		// segmented so that existing entries never move, refcounts are
+		// atomic, and the index is split into independently locked shards.
+		// c_str() and copying an existing IdString are lock-free.
+
+		static const int global_id_segment_bits_ = 16;
+		static const int global_id_segment_size_ = 1 << global_id_segment_bits_;
+		static const int global_id_max_segments_ = 0x40000000 >> global_id_segment_bits_;
+		static const int global_id_shards_ = 64;
+
+		struct global_id_segment_t {
+			std::atomic<int> refcount[global_id_segment_size_];
+			char *id[global_id_segment_size_];
+		};
+
+		struct global_id_shard_t {
+			std::mutex mutex;
+			dict<char*, int, hash_cstr_ops> index;
+		};
+
+		static global_id_segment_t *global_id_segments_[global_id_max_segments_];
+		static global_id_shard_t global_id_shards_storage_[global_id_shards_];
+		static std::mutex global_free_idx_mutex_;
+		static std::vector<int> global_free_idx_list_;
+		static int global_id_count_;
+
+		static inline std::atomic<int> &global_refcount(int idx) {
+			return global_id_segments_[idx >> global_id_segment_bits_]->refcount[idx & (global_id_segment_size_-1)];
+		}
+
+		static inline char *&global_id(int idx) {
+			return global_id_segments_[idx >> global_id_segment_bits_]->id[idx & (global_id_segment_size_-1)];
+		}
+
+		static inline global_id_shard_t &global_shard(const char *p) {
+			return global_id_shards_storage_[hash_cstr_ops::hash(p) % global_id_shards_];
+		}
+
+		static inline int global_alloc_idx()
+		{
+			std::lock_guard<std::mutex> lock(global_free_idx_mutex_);
+
+			if (global_free_idx_list_.empty()) {
+				log_assert(global_id_count_ < 0x40000000);
+				int idx = global_id_count_++;
+				if ((idx & (global_id_segment_size_-1)) == 0)
+					global_id_segments_[idx >> global_id_segment_bits_] = new global_id_segment_t();
+				global_refcount(idx).store(0, std::memory_order_relaxed);
+				global_id(idx) = nullptr;
+				return idx;
+			}
+
+			int idx = global_free_idx_list_.back();
+			global_free_idx_list_.pop_back();
+			return idx;
+		}
+
+		static inline int get_reference(int idx)
+		{
+			global_refcount(idx).fetch_add(1, std::memory_order_relaxed);
+			return idx;
+		}
+
+		static inline int get_reference(const char *p)
+		{
+			log_assert(destruct_guard.ok);
+
+			if (p[0]) {
+				log_assert(p[1] != 0);
+				log_assert(p[0] == '$' || p[0] == '\\');
+			}
+
+			int idx;
+			global_id_shard_t &shard = global_shard(p);
+
+			{
+				std::lock_guard<std::mutex> lock(shard.mutex);
+
+				auto it = shard.index.find((char*)p);
+				if (it != shard.index.end()) {
+					global_refcount(it->second).fetch_add(1, std::memory_order_relaxed);
+					return it->second;
+				}
+
+				idx = global_alloc_idx();
+				global_id(idx) = strdup(p);
+				shard.index[global_id(idx)] = idx;
+				global_refcount(idx).fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// Avoid Create->Delete->Create pattern (outside of the shard
+			// lock, as put_reference() might need to take it)
+			static thread_local IdString last_created_id;
+			put_reference(last_created_id.index_);
+			last_created_id.index_ = idx;
+			get_reference(last_created_id.index_);
+
+			if (yosys_xtrace) {
+				log("#X# New IdString '%s' with index %d.\n", p, idx);
+				log_backtrace("-X- ", yosys_xtrace-1);
+			}
+
+			return idx;
+		}
+
+		static inline void put_reference(int idx)
+		{
+			// put_reference() may be called from destructors after the destructor of
+			// global_id_shards_storage_ has been run. in this case we simply do nothing.
+			if (!destruct_guard.ok)
+				return;
+
+			// fast path: this is not the last reference
+			std::atomic<int> &refcount = global_refcount(idx);
+			int old_refcount = refcount.load(std::memory_order_relaxed);
+			while (old_refcount > 1)
+				if (refcount.compare_exchange_weak(old_refcount, old_refcount-1, std::memory_order_release, std::memory_order_relaxed))
+					return;
+
+			// slow path: with the shard lock held nobody can look up this id
+			// string, so if we drop the last reference the entry can be freed
+			global_id_shard_t &shard = global_shard(global_id(idx));
+			std::lock_guard<std::mutex> lock(shard.mutex);
+
+			old_refcount = refcount.fetch_sub(1, std::memory_order_acq_rel);
+			log_assert(old_refcount > 0);
+
+			if (old_refcount != 1)
+				return;
+
+			if (yosys_xtrace) {
+				log("#X# Removed IdString '%s' with index %d.\n", global_id(idx), idx);
+				log_backtrace("-X- ", yosys_xtrace-1);
+			}
+
+			shard.index.erase(global_id(idx));
+			free(global_id(idx));
+			global_id(idx) = nullptr;
+
+			std::lock_guard<std::mutex> free_lock(global_free_idx_mutex_);
+			global_free_idx_list_.push_back(idx);
+		}
+
+		// autogenerated names are always created eagerly in this variant
+		static inline bool is_autoid(const char*) { return false; }
+		static char *materialize_autoid(int idx);
+#else
 		static std::vector<int> global_refcount_storage_;
 		static std::vector<char*> global_id_storage_;
 		static dict<char*, int, hash_cstr_ops> global_id_index_;
 		static std::vector<int> global_free_idx_list_;
 
+		static inline char *&global_id(int idx) {
+			return global_id_storage_.at(idx);
+		}
+
+		// Autogenerated names (NEW_ID) are created without formatting the
+		// "$auto$<file>:<line>:<func>$<num>" string: the storage slot holds a
+		// tagged value with a source location index and the number instead.
+		// The text is only rendered (and added to global_id_index_) when it
+		// is first requested via c_str() or looked up by name. Frontends move
+		// autoidx past the "$...$<num>" names they import, but if the text
+		// exists already anyway, materialize_autoid() appends a suffix, so
+		// that every text still belongs to exactly one index.
+
+		static std::vector<std::string> global_autoid_locs_;
+		static dict<int, int> global_autoid_index_;
+
+		static inline bool is_autoid(const char *p) {
+			return (uintptr_t(p) & 1) != 0;
+		}
+
+#if UINTPTR_MAX > 0xffffffffu
+		static inline char *autoid_ptr(int loc, int num) {
+			return (char*)uintptr_t((uint64_t(loc) << 33) | (uint64_t(uint32_t(num)) << 1) | 1);
+		}
+
+		static inline int autoid_loc(int idx) {
+			return int(uint64_t(uintptr_t(global_id_storage_.at(idx))) >> 33);
+		}
+#else
+		// with 32 bit pointers (emscripten) only the number fits into the
+		// tagged value, the source location is kept in a separate table
+		static std::vector<int> global_autoid_loc_storage_;
+
+		static inline char *autoid_ptr(int, int num) {
+			return (char*)uintptr_t((uint32_t(num) << 1) | 1);
+		}
+
+		static inline int autoid_loc(int idx) {
+			return global_autoid_loc_storage_.at(idx);
+		}
+#endif
+
+		static inline int autoid_num(const char *p) {
+			return int(uint32_t(uint64_t(uintptr_t(p)) >> 1));
+		}
+
+		static std::string autoid_str(int idx);
+		static char *materialize_autoid(int idx);
+		static int lookup_autoid(const char *p);
+		static int new_autoid_loc(const std::string &loc);
+		static int new_autoid(int loc, int num);
+
 		static inline int get_reference(int idx)
 		{
 			global_refcount_storage_.at(idx)++;
@@ -109,6 +317,14 @@ namespace RTLIL
 				return it->second;
 			}
 
+			if (p[0] == '$' && !global_autoid_index_.empty()) {
+				int idx = lookup_autoid(p);
+				if (idx >= 0) {
+					global_refcount_storage_.at(idx)++;
+					return idx;
+				}
+			}
+
 			if (global_free_idx_list_.empty()) {
 				log_assert(global_id_storage_.size() < 0x40000000);
 				global_free_idx_list_.push_back(global_id_storage_.size());
@@ -148,6 +364,13 @@ namespace RTLIL
 			if (--global_refcount_storage_.at(idx) != 0)
 				return;
 
+			if (is_autoid(global_id_storage_.at(idx))) {
+				global_autoid_index_.erase(autoid_num(global_id_storage_.at(idx)));
+				global_id_storage_.at(idx) = nullptr;
+				global_free_idx_list_.push_back(idx);
+				return;
+			}
+
 			if (yosys_xtrace) {
 				log("#X# Removed IdString '%s' with index %d.\n", global_id_storage_.at(idx), idx);
 				log_backtrace("-X- ", yosys_xtrace-1);
@@ -159,10 +382,16 @@ namespace RTLIL
 			global_free_idx_list_.push_back(idx);
 		}
 
+#endif
+
 		// the actual IdString object is just is a single int
 
 		int index_;
 
+		// for the static IdStrings in namespace ID, see yosys_setup()
+		struct static_index_t { int idx; };
+		explicit IdString(static_index_t s) : index_(s.idx) { }
+
 		IdString() : index_(get_reference("")) { }
 		IdString(const char *str) : index_(get_reference(str)) { }
 		IdString(const IdString &str) : index_(get_reference(str.index_)) { }
@@ -185,11 +414,12 @@ namespace RTLIL
 		}
 
 		const char *c_str() const {
-			return global_id_storage_.at(index_);
+			char *p = global_id(index_);
+			return is_autoid(p) ? materialize_autoid(index_) : p;
 		}
 
 		std::string str() const {
-			return std::string(global_id_storage_.at(index_));
+			return std::string(c_str());
 		}
 
 		bool operator<(const IdString &rhs) const {
@@ -208,6 +438,9 @@ namespace RTLIL
 		bool operator!=(const char *rhs) const { return strcmp(c_str(), rhs) != 0; }
 
 		char operator[](size_t i) const {
+			// the "$auto$" prefix of an autogenerated name is known without rendering it
+			if (i < 6 && is_autoid(global_id(index_)))
+				return "$auto$"[i];
 			const char *p = c_str();
 			for (; i != 0; i--, p++)
 				log_assert(*p != 0);
@@ -226,7 +459,7 @@ namespace RTLIL
 		}
 
 		bool empty() const {
-			return c_str()[0] == 0;
+			return (*this)[0] == 0;
 		}
 
 		void clear() {
@@ -451,6 +684,27 @@ namespace RTLIL
 	};
 };
 
+// Pre-interned IdStrings for the port, parameter and attribute names in
+// kernel/constids.inc, e.g. ID::A for "\\A" and ID::A_SIGNED for "\\A_SIGNED".
+// Using them does not need a lookup in the global id string index like
+// constructing an IdString from a string literal does. yosys_setup() creates
+// them right after the empty id string, so they have the fixed indices from
+// StaticIdIndex. They can't be used before yosys_setup().
+namespace ID
+{
+	enum StaticIdIndex {
+		STATIC_ID_NONE,
+#define X(_id) STATIC_ID_ ## _id,
+#include "kernel/constids.inc"
+#undef X
+		STATIC_ID_COUNT
+	};
+
+#define X(_id) extern const RTLIL::IdString _id;
+#include "kernel/constids.inc"
+#undef X
+}
+
 struct RTLIL::Const
 {
 	int flags;
@@ -489,7 +743,7 @@ struct RTLIL::Const
 	inline unsigned int hash() const {
 		unsigned int h = mkhash_init;
 		for (auto b : bits)
-			mkhash(h, b);
+			h = mkhash(h, b);
 		return h;
 	}
 };
@@ -503,6 +757,13 @@ struct RTLIL::AttrObject
 	void set_strpool_attribute(RTLIL::IdString id, const pool<string> &data);
 	void add_strpool_attribute(RTLIL::IdString id, const pool<string> &data);
 	pool<string> get_strpool_attribute(RTLIL::IdString id) const;
+
+	// the "src" attribute is a '|' separated set of source locations. the
+	// values are interned and merging them is memoized, so that passes which
+	// copy one location set to many new objects do not parse it every time.
+	void set_src_attribute(const std::string &src);
+	std::string get_src_attribute() const;
+	void add_src_attribute(const RTLIL::Const &src);
 };
 
 struct RTLIL::SigChunk
@@ -613,18 +874,29 @@ public:
 	SigSpec(std::set<RTLIL::SigBit> bits);
 	SigSpec(bool bit);
 
+	// the cached hash moves with the data, the source is left empty
 	SigSpec(RTLIL::SigSpec &&other) {
 		width_ = other.width_;
 		hash_ = other.hash_;
 		chunks_ = std::move(other.chunks_);
 		bits_ = std::move(other.bits_);
+		other.width_ = 0;
+		other.hash_ = 0;
+		other.chunks_.clear();
+		other.bits_.clear();
 	}
 
 	const RTLIL::SigSpec &operator=(RTLIL::SigSpec &&other) {
+		if (this == &other)
+			return *this;
 		width_ = other.width_;
 		hash_ = other.hash_;
 		chunks_ = std::move(other.chunks_);
 		bits_ = std::move(other.bits_);
+		other.width_ = 0;
+		other.hash_ = 0;
+		other.chunks_.clear();
+		other.bits_.clear();
 		return *this;
 	}
 
@@ -639,7 +911,7 @@ public:
 	inline int size() const { return width_; }
 	inline bool empty() const { return width_ == 0; }
 
-	inline RTLIL::SigBit &operator[](int index) { inline_unpack(); return bits_.at(index); }
+	inline RTLIL::SigBit &operator[](int index) { inline_unpack(); hash_ = 0; return bits_.at(index); }
 	inline const RTLIL::SigBit &operator[](int index) const { inline_unpack(); return bits_.at(index); }
 
 	inline RTLIL::SigSpecIterator begin() { RTLIL::SigSpecIterator it; it.sig_p = this; it.index = 0; return it; }
@@ -679,6 +951,7 @@ public:
 	RTLIL::SigSpec extract(int offset, int length = 1) const;
 
 	void append(const RTLIL::SigSpec &signal);
+	void append(RTLIL::SigSpec &&signal);
 	void append_bit(const RTLIL::SigBit &bit);
 
 	void extend_u0(int width, bool is_signed = false);
@@ -762,6 +1035,29 @@ struct RTLIL::Selection
 	}
 };
 
+// The selection of one module compiled into a dense bitmap over the
+// IdString indices of the selected members. Testing a wire or cell is then
+// a bit test instead of the hash lookups done by Design::selected(). The
+// object is a snapshot: it must be recreated when the selection changes.
+
+struct RTLIL::ModuleSelection
+{
+	bool whole_module, empty_module;
+	std::vector<bool> members;
+
+	ModuleSelection(const RTLIL::Design *design, const RTLIL::Module *module);
+
+	bool selected(RTLIL::IdString memb_name) const {
+		if (whole_module)
+			return true;
+		return size_t(memb_name.index_) < members.size() && members[memb_name.index_];
+	}
+
+	template<typename T> bool selected(const T *member) const {
+		return selected(member->name);
+	}
+};
+
 struct RTLIL::Monitor
 {
 	unsigned int hashidx_;
@@ -780,6 +1076,10 @@ struct RTLIL::Monitor
 	virtual void notify_connect(RTLIL::Module*, const RTLIL::SigSig&) { }
 	virtual void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) { }
 	virtual void notify_blackout(RTLIL::Module*) { }
+
+	// called by Module::remove_batch() before the cells are deleted. the
+	// default implementation reports each port as disconnected.
+	virtual void notify_remove(RTLIL::Module*, const pool<RTLIL::Cell*> &cells);
 };
 
 struct RTLIL::Design
@@ -813,6 +1113,14 @@ struct RTLIL::Design
 	void remove(RTLIL::Module *module);
 	void rename(RTLIL::Module *module, RTLIL::IdString new_name);
 
+	// Modules can be shared copy-on-write between designs (design -save etc.).
+	// unshare_modules() gives this design a private copy of all shared modules
+	// and is called before running a command that might modify the design.
+	// With take_ownership set, module->design is changed to this design.
+	void add_shared(RTLIL::Module *module, bool take_ownership = false);
+	void unshare_modules();
+	void release_module(RTLIL::Module *module);
+
 	void scratchpad_unset(std::string varname);
 
 	void scratchpad_set_int(std::string varname, int value);
@@ -866,6 +1174,44 @@ struct RTLIL::Design
 	std::vector<RTLIL::Module*> selected_whole_modules_warn() const;
 };
 
+// Storage for the wires and cells of a module: objects are carved out of
+// large blocks and released objects are recycled through a free list. The
+// owner is responsible for constructing and destructing the objects.
+template<typename T>
+struct RTLIL::ObjectPool
+{
+	std::vector<char*> blocks;
+	std::vector<T*> free_list;
+	int block_used, block_size;
+
+	ObjectPool() : block_used(0), block_size(0) { }
+	ObjectPool(const ObjectPool &other) = delete;
+	void operator=(const ObjectPool &other) = delete;
+
+	~ObjectPool() {
+		for (auto block : blocks)
+			::operator delete(block);
+	}
+
+	void *alloc() {
+		if (!free_list.empty()) {
+			T *p = free_list.back();
+			free_list.pop_back();
+			return p;
+		}
+		if (block_used == block_size) {
+			block_size = block_size ? std::min(2*block_size, 4096) : 16;
+			blocks.push_back(static_cast<char*>(::operator new(block_size * sizeof(T))));
+			block_used = 0;
+		}
+		return blocks.back() + sizeof(T) * block_used++;
+	}
+
+	void release(T *p) {
+		free_list.push_back(p);
+	}
+};
+
 struct RTLIL::Module : public RTLIL::AttrObject
 {
 	unsigned int hashidx_;
@@ -875,6 +1221,12 @@ protected:
 	void add(RTLIL::Wire *wire);
 	void add(RTLIL::Cell *cell);
 
+	// all wires and cells of the module live in these pools
+	RTLIL::ObjectPool<RTLIL::Wire> wire_pool_;
+	RTLIL::ObjectPool<RTLIL::Cell> cell_pool_;
+	void free_wire(RTLIL::Wire *wire);
+	void free_cell(RTLIL::Cell *cell);
+
 public:
 	RTLIL::Design *design;
 	pool<RTLIL::Monitor*> monitors;
@@ -882,9 +1234,20 @@ public:
 	int refcount_wires_;
 	int refcount_cells_;
 
+	// designs other than this->design that hold this module, see Design::add_shared()
+	std::vector<RTLIL::Design*> shared_designs_;
+
 	dict<RTLIL::IdString, RTLIL::Wire*> wires_;
 	dict<RTLIL::IdString, RTLIL::Cell*> cells_;
 	std::vector<RTLIL::SigSig> connections_;
+	ModuleSigMap *sigmap_cache_;
+	ModIndex *modindex_cache_;
+	EquivIndex *equiv_index_cache_;
+
+	// changes that are not reported to the monitors yet, see begin_batch()
+	int batch_depth_;
+	dict<std::pair<RTLIL::Cell*, RTLIL::IdString>, RTLIL::SigSpec> batch_ports_;
+	RTLIL::SigSig batch_conns_;
 
 	RTLIL::IdString name;
 	pool<RTLIL::IdString> avail_parameters;
@@ -898,13 +1261,43 @@ public:
 
 	virtual void sort();
 	virtual void check();
+	void check_incremental(const pool<RTLIL::Cell*> &unchanged_cells);
 	virtual void optimize();
 
 	void connect(const RTLIL::SigSig &conn);
 	void connect(const RTLIL::SigSpec &lhs, const RTLIL::SigSpec &rhs);
+	void connect_many(const std::vector<RTLIL::SigSig> &conns);
+	void compact_connections();
 	void new_connections(const std::vector<RTLIL::SigSig> &new_conn);
 	const std::vector<RTLIL::SigSig> &connections() const;
 
+	// A SigMap for the module connections that is kept up to date across
+	// passes. Use "SigMap sigmap(module->sigmap())" for a private copy.
+	// Code that modifies connections_ directly must call invalidate_caches(),
+	// which reports the change to all monitors via notify_blackout().
+	const SigMap &sigmap();
+	void invalidate_caches();
+
+	// Like sigmap(), a ModIndex that is kept up to date across passes.
+	ModIndex &modindex();
+
+	// The proven and unproven $equiv cells, kept up to date across passes.
+	EquivIndex &equiv_index();
+
+	bool has_monitors() const {
+		return !monitors.empty() || (design != nullptr && !design->monitors.empty());
+	}
+
+	// Between begin_batch() and end_batch() (which can be nested) the port
+	// and connection changes are collected instead of reported one by one.
+	// flush_batch() reports them: one notify_connect() per changed cell port,
+	// from the signal before the first change to the current one, and one
+	// notify_connect() with all new connections. The batch is flushed before
+	// cells or wires are removed and by sigmap() and modindex().
+	void begin_batch();
+	void end_batch();
+	void flush_batch();
+
 	std::vector<RTLIL::IdString> ports;
 	void fixup_ports();
 
@@ -935,6 +1328,11 @@ public:
 	void remove(const pool<RTLIL::Wire*> &wires);
 	void remove(RTLIL::Cell *cell);
 
+	// Remove many cells and wires at once: one notify_remove() per monitor for
+	// all cells, and wires_ and cells_ are compacted in a single pass each
+	// instead of erasing the objects one by one.
+	void remove_batch(const pool<RTLIL::Cell*> &cells, const pool<RTLIL::Wire*> &wires = pool<RTLIL::Wire*>());
+
 	void rename(RTLIL::Wire *wire, RTLIL::IdString new_name);
 	void rename(RTLIL::Cell *cell, RTLIL::IdString new_name);
 	void rename(RTLIL::IdString old_name, RTLIL::IdString new_name);
@@ -1162,6 +1560,11 @@ public:
 	void unsetPort(RTLIL::IdString portname);
 	void setPort(RTLIL::IdString portname, RTLIL::SigSpec signal);
 	const RTLIL::SigSpec &getPort(RTLIL::IdString portname) const;
+
+	// modify the signal of an existing port in place, for example:
+	//   cell->rewritePort("\\A", [&](RTLIL::SigSpec &sig) { sigmap.apply(sig); });
+	// the signal is only copied when there are monitors to notify.
+	template<typename T> void rewritePort(RTLIL::IdString portname, T functor);
 	const dict<RTLIL::IdString, RTLIL::SigSpec> &connections() const;
 
 	// information about cell ports
@@ -1260,7 +1663,7 @@ inline bool RTLIL::SigBit::operator!=(const RTLIL::SigBit &other) const {
 
 inline unsigned int RTLIL::SigBit::hash() const {
 	if (wire)
-		return mkhash_add(wire->name.hash(), offset);
+		return mkhash_add(mkhash_finalize(wire->name.hash()), offset);
 	return data;
 }
 
@@ -1280,6 +1683,7 @@ inline RTLIL::SigBit::SigBit(const RTLIL::SigSpec &sig) {
 template<typename T>
 void RTLIL::Module::rewrite_sigspecs(T functor)
 {
+	invalidate_caches();
 	for (auto &it : cells_)
 		it.second->rewrite_sigspecs(functor);
 	for (auto &it : processes)
@@ -1290,6 +1694,22 @@ void RTLIL::Module::rewrite_sigspecs(T functor)
 	}
 }
 
+template<typename T>
+void RTLIL::Cell::rewritePort(RTLIL::IdString portname, T functor)
+{
+	auto it = connections_.find(portname);
+	log_assert(it != connections_.end());
+
+	if (!module->has_monitors() && !yosys_xtrace) {
+		functor(it->second);
+		return;
+	}
+
+	RTLIL::SigSpec signal = it->second;
+	functor(signal);
+	setPort(portname, std::move(signal));
+}
+
 template<typename T>
 void RTLIL::Cell::rewrite_sigspecs(T functor) {
 	for (auto &it : connections_)
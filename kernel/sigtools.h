@@ -144,7 +144,24 @@ struct SigSet
 		unsigned int hash() const { return first->name.hash() + second; }
 	};
 
-	dict<bitDef_t, std::set<T, Compare>> bits;
+	// the data for each bit is stored in a vector that is kept sorted
+	// according to Compare and has no duplicates
+	dict<bitDef_t, std::vector<T>> bits;
+	Compare compare;
+
+	void insert_data(std::vector<T> &vec, const T &data)
+	{
+		auto it = std::lower_bound(vec.begin(), vec.end(), data, compare);
+		if (it == vec.end() || compare(data, *it))
+			vec.insert(it, data);
+	}
+
+	void erase_data(std::vector<T> &vec, const T &data)
+	{
+		auto it = std::lower_bound(vec.begin(), vec.end(), data, compare);
+		if (it != vec.end() && !compare(data, *it))
+			vec.erase(it);
+	}
 
 	void clear()
 	{
@@ -155,43 +172,54 @@ struct SigSet
 	{
 		for (auto &bit : sig)
 			if (bit.wire != NULL)
-				bits[bit].insert(data);
+				insert_data(bits[bit], data);
 	}
 
 	void insert(RTLIL::SigSpec sig, const std::set<T> &data)
 	{
 		for (auto &bit : sig)
-			if (bit.wire != NULL)
-				bits[bit].insert(data.begin(), data.end());
+			if (bit.wire != NULL) {
+				auto &vec = bits[bit];
+				for (auto &d : data)
+					insert_data(vec, d);
+			}
 	}
 
 	void erase(RTLIL::SigSpec sig)
 	{
 		for (auto &bit : sig)
 			if (bit.wire != NULL)
-				bits[bit].clear();
+				bits.erase(bit);
 	}
 
 	void erase(RTLIL::SigSpec sig, T data)
 	{
 		for (auto &bit : sig)
-			if (bit.wire != NULL)
-				bits[bit].erase(data);
+			if (bit.wire != NULL) {
+				auto it = bits.find(bit);
+				if (it != bits.end())
+					erase_data(it->second, data);
+			}
 	}
 
 	void erase(RTLIL::SigSpec sig, const std::set<T> &data)
 	{
 		for (auto &bit : sig)
-			if (bit.wire != NULL)
-				bits[bit].erase(data.begin(), data.end());
+			if (bit.wire != NULL) {
+				auto it = bits.find(bit);
+				if (it != bits.end())
+					for (auto &d : data)
+						erase_data(it->second, d);
+			}
 	}
 
 	void find(RTLIL::SigSpec sig, std::set<T> &result)
 	{
 		for (auto &bit : sig)
 			if (bit.wire != NULL) {
-				auto &data = bits[bit];
-				result.insert(data.begin(), data.end());
+				auto it = bits.find(bit);
+				if (it != bits.end())
+					result.insert(it->second.begin(), it->second.end());
 			}
 	}
 
@@ -199,8 +227,9 @@ struct SigSet
 	{
 		for (auto &bit : sig)
 			if (bit.wire != NULL) {
-				auto &data = bits[bit];
-				result.insert(data.begin(), data.end());
+				auto it = bits.find(bit);
+				if (it != bits.end())
+					result.insert(it->second.begin(), it->second.end());
 			}
 	}
 
@@ -214,8 +243,11 @@ struct SigSet
 	bool has(RTLIL::SigSpec sig)
 	{
 		for (auto &bit : sig)
-			if (bit.wire != NULL && bits.count(bit))
-				return true;
+			if (bit.wire != NULL) {
+				auto it = bits.find(bit);
+				if (it != bits.end() && !it->second.empty())
+					return true;
+			}
 		return false;
 	}
 };
@@ -224,6 +256,11 @@ struct SigMap
 {
 	mfp<SigBit> database;
 
+	// the wires with bits in the database. all bits of other wires map to
+	// themselves, so apply() keeps their chunks as they are and only looks
+	// up the bits of these wires.
+	pool<RTLIL::Wire*> mapped_wires;
+
 	SigMap(RTLIL::Module *module = NULL)
 	{
 		if (module != NULL)
@@ -233,11 +270,13 @@ struct SigMap
 	void swap(SigMap &other)
 	{
 		database.swap(other.database);
+		mapped_wires.swap(other.mapped_wires);
 	}
 
 	void clear()
 	{
 		database.clear();
+		mapped_wires.clear();
 	}
 
 	void set(RTLIL::Module *module)
@@ -248,6 +287,7 @@ struct SigMap
 
 		database.clear();
 		database.reserve(bitcount);
+		mapped_wires.clear();
 
 		for (auto &it : module->connections())
 			add(it.first, it.second);
@@ -267,6 +307,11 @@ struct SigMap
 
 			if (bf.wire || bt.wire)
 			{
+				if (from[i].wire)
+					mapped_wires.insert(from[i].wire);
+				if (to[i].wire)
+					mapped_wires.insert(to[i].wire);
+
 				database.imerge(bfi, bti);
 
 				if (bf.wire == nullptr)
@@ -282,8 +327,10 @@ struct SigMap
 	{
 		for (auto &bit : sig) {
 			RTLIL::SigBit b = database.find(bit);
-			if (b.wire != nullptr)
+			if (b.wire != nullptr) {
+				mapped_wires.insert(bit.wire);
 				database.promote(bit);
+			}
 		}
 	}
 
@@ -294,8 +341,28 @@ struct SigMap
 
 	void apply(RTLIL::SigSpec &sig) const
 	{
-		for (auto &bit : sig)
-			apply(bit);
+		if (mapped_wires.empty())
+			return;
+
+		bool found = false;
+		for (auto &chunk : sig.chunks())
+			if (chunk.wire != nullptr && mapped_wires.count(chunk.wire)) {
+				found = true;
+				break;
+			}
+
+		if (!found)
+			return;
+
+		RTLIL::SigSpec new_sig;
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.wire == nullptr || !mapped_wires.count(chunk.wire))
+				new_sig.append(chunk);
+			else
+				for (int i = 0; i < chunk.width; i++)
+					new_sig.append_bit(database.find(RTLIL::SigBit(chunk.wire, chunk.offset + i)));
+		}
+		sig = std::move(new_sig);
 	}
 
 	RTLIL::SigBit operator()(RTLIL::SigBit bit) const
@@ -327,6 +394,59 @@ struct SigMap
 	}
 };
 
+// The SigMap returned by RTLIL::Module::sigmap(). Connections added with
+// module->connect() are merged in as they come in. Everything else that
+// changes the module connections (new_connections(), removing wires, a
+// blackout) just marks the map as invalid, and it is rebuilt on next access.
+struct ModuleSigMap : public RTLIL::Monitor
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+	bool valid;
+
+	ModuleSigMap(RTLIL::Module *module) : module(module), valid(false)
+	{
+		module->monitors.insert(this);
+	}
+
+	~ModuleSigMap()
+	{
+		module->monitors.erase(this);
+	}
+
+	const SigMap &get()
+	{
+		if (!valid) {
+			sigmap.set(module);
+			valid = true;
+		}
+		return sigmap;
+	}
+
+	virtual void notify_connect(RTLIL::Module*, const RTLIL::SigSig &sigsig) YS_OVERRIDE
+	{
+		// Module::connect() calls us again with the constant bits
+		// on the left hand side removed.
+		if (valid && !sigsig.first.has_const())
+			sigmap.add(sigsig.first, sigsig.second);
+	}
+
+	virtual void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) YS_OVERRIDE
+	{
+		valid = false;
+	}
+
+	virtual void notify_blackout(RTLIL::Module*) YS_OVERRIDE
+	{
+		valid = false;
+	}
+
+	virtual void notify_remove(RTLIL::Module*, const pool<RTLIL::Cell*>&) YS_OVERRIDE
+	{
+		// cell connections are not part of the map
+	}
+};
+
 YOSYS_NAMESPACE_END
 
 #endif /* SIGTOOLS_H */
@@ -0,0 +1,217 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef TRUTHTABLE_H
+#define TRUTHTABLE_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// A completely specified boolean function of up to 16 inputs, stored as packed
+// 64 bit words. Bit i of the table is the output for the input pattern i, with
+// input 0 as the LSB of i. This is the same bit order as the LUT parameter of
+// $lut cells. Bits beyond 2^width in the last word are always zero.
+struct TruthTable
+{
+	int width;
+	std::vector<uint64_t> words;
+
+	TruthTable(int width = 0) : width(width), words(width > 6 ? 1 << (width-6) : 1)
+	{
+		log_assert(0 <= width && width <= 16);
+	}
+
+	// x and z bits in the LUT are treated as 0
+	TruthTable(const RTLIL::Const &lut, int width) : TruthTable(width)
+	{
+		for (int i = 0; i < std::min(GetSize(lut), 1 << width); i++)
+			if (lut.bits[i] == RTLIL::State::S1)
+				set(i, true);
+	}
+
+	static uint64_t var_mask(int var)
+	{
+		static const uint64_t masks[6] = {
+			0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+			0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+		};
+		return masks[var];
+	}
+
+	uint64_t valid_mask() const
+	{
+		return width >= 6 ? ~uint64_t(0) : (uint64_t(1) << (1 << width)) - 1;
+	}
+
+	// the function that is just the given input
+	static TruthTable variable(int width, int var)
+	{
+		TruthTable tt(width);
+		for (int w = 0; w < GetSize(tt.words); w++)
+			tt.words[w] = var < 6 ? var_mask(var) & tt.valid_mask() : ((w >> (var-6)) & 1) ? ~uint64_t(0) : 0;
+		return tt;
+	}
+
+	bool get(int idx) const
+	{
+		return (words[idx >> 6] >> (idx & 63)) & 1;
+	}
+
+	void set(int idx, bool value)
+	{
+		if (value)
+			words[idx >> 6] |= uint64_t(1) << (idx & 63);
+		else
+			words[idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+	}
+
+	RTLIL::Const as_const() const
+	{
+		RTLIL::Const lut(RTLIL::State::S0, 1 << width);
+		for (int i = 0; i < (1 << width); i++)
+			if (get(i))
+				lut.bits[i] = RTLIL::State::S1;
+		return lut;
+	}
+
+	bool is_const(bool value) const
+	{
+		uint64_t expected = value ? valid_mask() : 0;
+		for (auto word : words)
+			if (word != expected)
+				return false;
+		return true;
+	}
+
+	TruthTable operator~() const
+	{
+		TruthTable tt(width);
+		for (int w = 0; w < GetSize(words); w++)
+			tt.words[w] = ~words[w] & valid_mask();
+		return tt;
+	}
+
+	TruthTable operator&(const TruthTable &other) const
+	{
+		log_assert(width == other.width);
+		TruthTable tt(width);
+		for (int w = 0; w < GetSize(words); w++)
+			tt.words[w] = words[w] & other.words[w];
+		return tt;
+	}
+
+	TruthTable operator|(const TruthTable &other) const
+	{
+		log_assert(width == other.width);
+		TruthTable tt(width);
+		for (int w = 0; w < GetSize(words); w++)
+			tt.words[w] = words[w] | other.words[w];
+		return tt;
+	}
+
+	TruthTable operator^(const TruthTable &other) const
+	{
+		log_assert(width == other.width);
+		TruthTable tt(width);
+		for (int w = 0; w < GetSize(words); w++)
+			tt.words[w] = words[w] ^ other.words[w];
+		return tt;
+	}
+
+	bool operator==(const TruthTable &other) const
+	{
+		return width == other.width && words == other.words;
+	}
+
+	bool operator!=(const TruthTable &other) const
+	{
+		return !(*this == other);
+	}
+
+	unsigned int hash() const
+	{
+		unsigned int h = mkhash_init;
+		h = mkhash(h, width);
+		for (auto word : words)
+			h = mkhash(h, hash_ops<int64_t>::hash(word));
+		return h;
+	}
+
+	// the function with the given input fixed to a value, the result has the
+	// same width but does not depend on that input anymore
+	TruthTable cofactor(int var, bool value) const
+	{
+		log_assert(0 <= var && var < width);
+		TruthTable tt(width);
+		if (var < 6) {
+			int shift = 1 << var;
+			uint64_t mask = var_mask(var);
+			for (int w = 0; w < GetSize(words); w++) {
+				uint64_t bits = words[w] & (value ? mask : ~mask);
+				tt.words[w] = value ? bits | (bits >> shift) : bits | (bits << shift);
+			}
+		} else {
+			int stride = 1 << (var-6);
+			for (int w = 0; w < GetSize(words); w++)
+				tt.words[w] = words[value ? w | stride : w & ~stride];
+		}
+		return tt;
+	}
+
+	bool depends_on(int var) const
+	{
+		return cofactor(var, false) != cofactor(var, true);
+	}
+
+	// a table of width-1 inputs without the given input, which must not be
+	// used by the function (e.g. the result of cofactor())
+	TruthTable remove_var(int var) const
+	{
+		log_assert(0 <= var && var < width);
+		TruthTable tt(width-1);
+		uint64_t low_mask = (uint64_t(1) << var) - 1;
+		for (int i = 0; i < (1 << (width-1)); i++) {
+			int idx = (i & low_mask) | ((i & ~low_mask) << 1);
+			if (get(idx))
+				tt.set(i, true);
+		}
+		return tt;
+	}
+
+	// the table for reordered inputs: input i of the result is input perm[i] of this table
+	TruthTable permute(const std::vector<int> &perm) const
+	{
+		log_assert(GetSize(perm) == width);
+		TruthTable tt(width);
+		for (int i = 0; i < (1 << width); i++) {
+			int idx = 0;
+			for (int k = 0; k < width; k++)
+				if ((i >> k) & 1)
+					idx |= 1 << perm[k];
+			if (get(idx))
+				tt.set(i, true);
+		}
+		return tt;
+	}
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -21,6 +21,7 @@
 // do not depend on any other components of yosys (except stuff like log_*).
 
 #include "kernel/yosys.h"
+#include <deque>
 
 #ifndef UTILS_H
 #define UTILS_H
@@ -154,41 +155,63 @@ struct TopoSort
 		database[right].insert(left);
 	}
 
-	void sort_worker(const T &n, std::set<T, C> &marked_cells, std::set<T, C> &active_cells, std::vector<T> &active_stack)
+	// depth-first search with an explicit stack, the order of the result is
+	// the same as with the obvious recursive implementation
+	void sort_worker(const T &root, pool<T> &marked_cells, pool<T> &active_cells)
 	{
-		if (active_cells.count(n)) {
-			found_loops = true;
-			if (analyze_loops) {
-				std::set<T, C> loop;
-				for (int i = GetSize(active_stack)-1; i >= 0; i--) {
-					loop.insert(active_stack[i]);
-					if (active_stack[i] == n)
-						break;
+		struct frame_t {
+			T node;
+			typename std::set<T, C>::const_iterator it, end;
+		};
+		std::vector<frame_t> stack;
+
+		auto visit = [&](const T &n)
+		{
+			if (active_cells.count(n)) {
+				found_loops = true;
+				if (analyze_loops) {
+					std::set<T, C> loop;
+					for (int i = GetSize(stack)-1; i >= 0; i--) {
+						loop.insert(stack[i].node);
+						if (stack[i].node == n)
+							break;
+					}
+					loops.insert(loop);
 				}
-				loops.insert(loop);
+				return;
 			}
-			return;
-		}
 
-		if (marked_cells.count(n))
-			return;
+			if (marked_cells.count(n))
+				return;
+
+			const std::set<T, C> &left_nodes = database.at(n);
+			if (left_nodes.empty()) {
+				marked_cells.insert(n);
+				sorted.push_back(n);
+				return;
+			}
 
-		if (!database.at(n).empty())
-		{
-			if (analyze_loops)
-				active_stack.push_back(n);
 			active_cells.insert(n);
+			stack.push_back(frame_t{n, left_nodes.begin(), left_nodes.end()});
+		};
 
-			for (auto &left_n : database.at(n))
-				sort_worker(left_n, marked_cells, active_cells, active_stack);
+		visit(root);
+
+		while (!stack.empty())
+		{
+			frame_t &frame = stack.back();
+			if (frame.it != frame.end) {
+				const T &left_n = *(frame.it++);
+				visit(left_n);
+				continue;
+			}
 
-			if (analyze_loops)
-				active_stack.pop_back();
+			T n = frame.node;
+			stack.pop_back();
 			active_cells.erase(n);
+			marked_cells.insert(n);
+			sorted.push_back(n);
 		}
-
-		marked_cells.insert(n);
-		sorted.push_back(n);
 	}
 
 	bool sort()
@@ -197,18 +220,181 @@ struct TopoSort
 		sorted.clear();
 		found_loops = false;
 
-		std::set<T, C> marked_cells;
-		std::set<T, C> active_cells;
-		std::vector<T> active_stack;
+		pool<T> marked_cells;
+		pool<T> active_cells;
+		sorted.reserve(database.size());
 
 		for (auto &it : database)
-			sort_worker(it.first, marked_cells, active_cells, active_stack);
+			sort_worker(it.first, marked_cells, active_cells);
 
 		log_assert(GetSize(sorted) == GetSize(database));
 		return !found_loops;
 	}
 };
 
+// ------------------------------------------------
+// Strongly connected components and topological order of a graph with
+// dense node indices (see kernel/cellgraph.h for a graph of cells)
+// ------------------------------------------------
+
+struct SccGraph
+{
+	std::vector<std::vector<int>> edges;
+
+	int size() const { return GetSize(edges); }
+	void resize(int n) { edges.resize(n); }
+
+	int add_node()
+	{
+		edges.emplace_back();
+		return GetSize(edges)-1;
+	}
+
+	void add_edge(int from, int to)
+	{
+		edges[from].push_back(to);
+	}
+
+	// remove duplicate edges
+	void unify_edges()
+	{
+		for (auto &e : edges) {
+			std::sort(e.begin(), e.end());
+			e.erase(std::unique(e.begin(), e.end()), e.end());
+		}
+	}
+
+	// Tarjan's algorithm with an explicit stack, so that deep graphs can not
+	// overflow the call stack. Returns the components with more than one node,
+	// and the single nodes with an edge to themselves if self_loops is set. The
+	// components are returned in reverse topological order. If max_depth is not
+	// negative then edges back to nodes that are more than max_depth levels up
+	// in the depth-first search tree are ignored, which splits large components
+	// into smaller loops.
+	std::vector<std::vector<int>> find_sccs(bool self_loops = true, int max_depth = -1) const
+	{
+		int num_nodes = GetSize(edges);
+		std::vector<int> index(num_nodes, -1), lowlink(num_nodes), depth(num_nodes);
+		std::vector<bool> on_stack(num_nodes);
+		std::vector<int> node_stack;
+		std::vector<std::pair<int, int>> call_stack;
+		std::vector<std::vector<int>> sccs;
+		int counter = 0;
+
+		auto visit = [&](int n, int d) {
+			index[n] = lowlink[n] = counter++;
+			depth[n] = d;
+			on_stack[n] = true;
+			node_stack.push_back(n);
+			call_stack.push_back(std::make_pair(n, 0));
+		};
+
+		for (int root = 0; root < num_nodes; root++)
+		{
+			if (index[root] >= 0)
+				continue;
+
+			visit(root, 0);
+
+			while (!call_stack.empty())
+			{
+				int n = call_stack.back().first;
+				int &edge_idx = call_stack.back().second;
+
+				if (edge_idx < GetSize(edges[n])) {
+					int m = edges[n][edge_idx++];
+					if (index[m] < 0)
+						visit(m, depth[n]+1);
+					else if (on_stack[m] && (max_depth < 0 || depth[m] + max_depth > depth[n]))
+						lowlink[n] = std::min(lowlink[n], lowlink[m]);
+					continue;
+				}
+
+				call_stack.pop_back();
+				if (!call_stack.empty()) {
+					int parent = call_stack.back().first;
+					lowlink[parent] = std::min(lowlink[parent], lowlink[n]);
+				}
+
+				if (lowlink[n] != index[n])
+					continue;
+
+				std::vector<int> scc;
+				while (1) {
+					int m = node_stack.back();
+					node_stack.pop_back();
+					on_stack[m] = false;
+					scc.push_back(m);
+					if (m == n)
+						break;
+				}
+
+				if (GetSize(scc) > 1 || (self_loops && std::find(edges[n].begin(), edges[n].end(), n) != edges[n].end()))
+					sccs.push_back(std::move(scc));
+			}
+		}
+
+		return sccs;
+	}
+
+	// Kahn's algorithm. Returns false if the graph has loops, in which case the
+	// nodes in and behind the loops are missing in the order.
+	bool topo_sort(std::vector<int> &order) const
+	{
+		int num_nodes = GetSize(edges);
+		std::vector<int> in_count(num_nodes);
+		for (auto &e : edges)
+			for (int m : e)
+				in_count[m]++;
+
+		order.clear();
+		order.reserve(num_nodes);
+		for (int n = 0; n < num_nodes; n++)
+			if (in_count[n] == 0)
+				order.push_back(n);
+
+		for (int i = 0; i < GetSize(order); i++)
+			for (int m : edges[order[i]])
+				if (--in_count[m] == 0)
+					order.push_back(m);
+
+		return GetSize(order) == num_nodes;
+	}
+};
+
+// ------------------------------------------------
+// A memo table for strings computed from IdStrings (e.g. the escaped names
+// in backends), indexed by the IdString index. The table holds a reference
+// to each id, so that an index is not reused for another name, and the
+// returned strings stay valid (and in place) until clear() is called.
+// ------------------------------------------------
+
+struct IdStringNames
+{
+	std::vector<int> index;
+	std::deque<std::pair<RTLIL::IdString, std::string>> names;
+
+	template<typename F>
+	const std::string &get(RTLIL::IdString id, F make_name)
+	{
+		if (id.index_ < GetSize(index) && index[id.index_] >= 0)
+			return names[index[id.index_]].second;
+
+		std::string name = make_name(id);
+		if (id.index_ >= GetSize(index))
+			index.resize(id.index_ + 1, -1);
+		index[id.index_] = GetSize(names);
+		names.push_back(std::make_pair(id, name));
+		return names.back().second;
+	}
+
+	void clear()
+	{
+		index.clear();
+		names.clear();
+	}
+};
+
 YOSYS_NAMESPACE_END
 
 #endif
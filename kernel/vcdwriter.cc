@@ -0,0 +1,144 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/vcdwriter.h"
+#include <time.h>
+
+YOSYS_NAMESPACE_BEGIN
+
+VcdWriter::VcdWriter(FILE *f, int buffer_size) : f(f), buffer_size(buffer_size), current_time(-1), in_definitions(true)
+{
+	buffer.reserve(buffer_size + 256);
+}
+
+VcdWriter::~VcdWriter()
+{
+	flush();
+}
+
+void VcdWriter::header(const std::string &comment, const std::string &timescale)
+{
+	log_assert(in_definitions);
+
+	time_t timestamp;
+	char stime[128] = {};
+	time(&timestamp);
+	strftime(stime, sizeof(stime), "%c", localtime(&timestamp));
+
+	append(stringf("$date\n    %s\n$end\n", stime));
+	append(stringf("$version\n    Generated by %s\n$end\n", yosys_version_str));
+	if (!comment.empty())
+		append(stringf("$comment\n    %s\n$end\n", comment.c_str()));
+	append(stringf("$timescale %s $end\n", timescale.c_str()));
+}
+
+void VcdWriter::push_scope(const std::string &name)
+{
+	log_assert(in_definitions);
+	append(stringf("$scope module %s $end\n", name.c_str()));
+}
+
+void VcdWriter::pop_scope()
+{
+	log_assert(in_definitions);
+	append("$upscope $end\n");
+}
+
+int VcdWriter::add_var(const std::string &name, int width)
+{
+	log_assert(in_definitions);
+
+	// identifiers are the shortest strings of the printable characters
+	// '!' to '~', in the order of declaration
+	var_t var;
+	for (int n = GetSize(vars); ; n = n / 94 - 1) {
+		var.id += char('!' + n % 94);
+		if (n < 94)
+			break;
+	}
+	var.width = width;
+	var.written = false;
+
+	std::string legal_name = name;
+	for (auto &c : legal_name)
+		if (c == '$' || c == ':' || c == ' ' || c == '\t')
+			c = '_';
+
+	append(stringf("$var wire %d %s %s $end\n", width, var.id.c_str(), legal_name.c_str()));
+
+	vars.push_back(var);
+	return GetSize(vars) - 1;
+}
+
+void VcdWriter::end_definitions()
+{
+	log_assert(in_definitions);
+	append("$enddefinitions $end\n");
+	in_definitions = false;
+}
+
+void VcdWriter::timestep(int64_t time)
+{
+	log_assert(!in_definitions && time >= current_time);
+	if (time == current_time)
+		return;
+	append(stringf("#%lld\n", (long long)time));
+	current_time = time;
+}
+
+void VcdWriter::value(int var_idx, const RTLIL::Const &value)
+{
+	static const char bitvals[] = "01xzxx";
+
+	var_t &var = vars.at(var_idx);
+	log_assert(current_time >= 0 && GetSize(value) == var.width);
+
+	if (var.written && var.last_value == value)
+		return;
+
+	char buf[64];
+	if (var.width == 1) {
+		buf[0] = bitvals[value.bits[0]];
+		append(buf, 1);
+	} else {
+		// VCD vectors are written MSB first
+		append("b", 1);
+		for (int i = var.width-1; i >= 0; i -= int(sizeof(buf))) {
+			int n = 0;
+			for (int k = i; k >= 0 && n < int(sizeof(buf)); k--)
+				buf[n++] = bitvals[value.bits[k]];
+			append(buf, n);
+		}
+		append(" ", 1);
+	}
+	append(var.id);
+	append("\n", 1);
+
+	var.last_value = value;
+	var.written = true;
+}
+
+void VcdWriter::flush()
+{
+	if (!buffer.empty())
+		fwrite(buffer.data(), 1, buffer.size(), f);
+	buffer.clear();
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,90 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef VCDWRITER_H
+#define VCDWRITER_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Streaming writer for VCD files. The variables are declared first, then the
+// values are written one time step after the other. Only the values that
+// changed since the last time step are written, and the output is collected
+// in a buffer that is written to the file in large blocks.
+//
+//	VcdWriter vcd(f);
+//	vcd.header("Generated from ...");
+//	vcd.push_scope("top");
+//	int clk = vcd.add_var("clk", 1);
+//	vcd.pop_scope();
+//	vcd.end_definitions();
+//	vcd.timestep(0);
+//	vcd.value(clk, RTLIL::State::S0);
+
+struct VcdWriter
+{
+	VcdWriter(FILE *f, int buffer_size = 1 << 16);
+	~VcdWriter();
+
+	// $date, $version, $comment and $timescale sections
+	void header(const std::string &comment, const std::string &timescale = "1ns");
+
+	void push_scope(const std::string &name);
+	void pop_scope();
+
+	// returns the handle of the new variable. names with characters that
+	// are not legal in VCD names ('$', ':' and white space) are fixed up.
+	int add_var(const std::string &name, int width);
+
+	void end_definitions();
+
+	// the time must not decrease from one call to the next
+	void timestep(int64_t time);
+
+	void value(int var, const RTLIL::Const &value);
+
+	void flush();
+
+private:
+	struct var_t {
+		std::string id;
+		int width;
+		RTLIL::Const last_value;
+		bool written;
+	};
+
+	FILE *f;
+	int buffer_size;
+	std::string buffer;
+	std::vector<var_t> vars;
+	int64_t current_time;
+	bool in_definitions;
+
+	void append(const char *str, size_t len) {
+		buffer.append(str, len);
+		if (GetSize(buffer) >= buffer_size)
+			flush();
+	}
+	void append(const std::string &str) { append(str.data(), str.size()); }
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
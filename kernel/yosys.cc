@@ -19,6 +19,9 @@
 
 #include "kernel/yosys.h"
 #include "kernel/celltypes.h"
+#include "frontends/ilang/ilang_frontend.h"
+#include "backends/ilang/ilang_backend.h"
+#include "libs/sha1/sha1.h"
 
 #ifdef YOSYS_ENABLE_READLINE
 #  include <readline/readline.h>
@@ -32,6 +35,7 @@
 #ifdef _WIN32
 #  include <windows.h>
 #  include <io.h>
+#  include <direct.h>
 #elif defined(__APPLE__)
 #  include <mach-o/dyld.h>
 #  include <unistd.h>
@@ -42,6 +46,7 @@
 #  include <dirent.h>
 #  include <sys/types.h>
 #  include <sys/stat.h>
+#  include <sys/wait.h>
 #endif
 
 #include <limits.h>
@@ -51,8 +56,14 @@ YOSYS_NAMESPACE_BEGIN
 
 int autoidx = 1;
 int yosys_xtrace = 0;
+int yosys_jobs = 1;
+bool yosys_incremental_check = false;
+std::string yosys_module_cache_dir;
+std::string yosys_temp_dir;
 RTLIL::Design *yosys_design = NULL;
 CellTypes yosys_celltypes;
+std::vector<CellTypeId> yosys_cell_type_ids;
+static bool yosys_celltypes_ready = false;
 
 #ifdef YOSYS_ENABLE_TCL
 Tcl_Interp *yosys_tcl_interp = NULL;
@@ -332,8 +343,36 @@ int run_command(const std::string &command, std::function<void(const std::string
 #endif
 }
 
+// the temp dir is set with 'yosys -tmpdir <dir>' or $YOSYS_TMPDIR. By default
+// /dev/shm is used if it is available, as the temp files of abc and the
+// other passes that run external tools are small and short-lived.
+std::string get_temp_dir()
+{
+	if (yosys_temp_dir.empty()) {
+		const char *env = getenv("YOSYS_TMPDIR");
+		if (env != nullptr && *env)
+			yosys_temp_dir = env;
+#ifdef _WIN32
+		else
+			yosys_temp_dir = "/tmp";
+#else
+		else {
+			struct stat stbuf;
+			if (!stat("/dev/shm", &stbuf) && S_ISDIR(stbuf.st_mode) && !access("/dev/shm", W_OK | X_OK))
+				yosys_temp_dir = "/dev/shm";
+			else
+				yosys_temp_dir = "/tmp";
+		}
+#endif
+	}
+	return yosys_temp_dir;
+}
+
 std::string make_temp_file(std::string template_str)
 {
+	if (template_str.rfind("/tmp/", 0) == 0 && get_temp_dir() != "/tmp")
+		template_str = get_temp_dir() + template_str.substr(4);
+
 #ifdef _WIN32
 	if (template_str.rfind("/tmp/", 0) == 0) {
 #  ifdef __MINGW32__
@@ -388,6 +427,9 @@ std::string make_temp_dir(std::string template_str)
 	mkdir(template_str.c_str());
 	return template_str;
 #else
+	if (template_str.rfind("/tmp/", 0) == 0 && get_temp_dir() != "/tmp")
+		template_str = get_temp_dir() + template_str.substr(4);
+
 #  ifndef NDEBUG
 	size_t pos = template_str.rfind("XXXXXX");
 	log_assert(pos != std::string::npos);
@@ -430,7 +472,21 @@ bool is_absolute_path(std::string filename)
 void remove_directory(std::string dirname)
 {
 #ifdef _WIN32
-	run_command(stringf("rmdir /s /q \"%s\"", dirname.c_str()));
+	struct _finddata_t info;
+	intptr_t handle = _findfirst((dirname + "\\*").c_str(), &info);
+	if (handle != -1) {
+		do {
+			if (!strcmp(info.name, ".") || !strcmp(info.name, ".."))
+				continue;
+			std::string buffer = stringf("%s\\%s", dirname.c_str(), info.name);
+			if (info.attrib & _A_SUBDIR)
+				remove_directory(buffer);
+			else
+				remove(buffer.c_str());
+		} while (_findnext(handle, &info) == 0);
+		_findclose(handle);
+	}
+	_rmdir(dirname.c_str());
 #else
 	struct stat stbuf;
 	struct dirent **namelist;
@@ -439,10 +495,11 @@ void remove_directory(std::string dirname)
 	for (int i = 0; i < n; i++) {
 		if (strcmp(namelist[i]->d_name, ".") && strcmp(namelist[i]->d_name, "..")) {
 			std::string buffer = stringf("%s/%s", dirname.c_str(), namelist[i]->d_name);
-			if (!stat(buffer.c_str(), &stbuf) && S_ISREG(stbuf.st_mode)) {
-				remove(buffer.c_str());
-			} else
+			// lstat() so that a symlink to a directory is removed, not followed
+			if (!lstat(buffer.c_str(), &stbuf) && S_ISDIR(stbuf.st_mode))
 				remove_directory(buffer);
+			else
+				remove(buffer.c_str());
 		}
 		free(namelist[i]);
 	}
@@ -451,6 +508,404 @@ void remove_directory(std::string dirname)
 #endif
 }
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+static void replace_module_contents(RTLIL::Module *module, RTLIL::Module *new_module)
+{
+	// avail_parameters is not part of the ilang representation
+	new_module->avail_parameters = module->avail_parameters;
+
+	std::vector<RTLIL::Cell*> cells = module->cells();
+	for (auto cell : cells)
+		module->remove(cell);
+
+	pool<RTLIL::Wire*> wires;
+	for (auto wire : module->wires())
+		wires.insert(wire);
+	module->remove(wires);
+
+	for (auto &it : module->memories)
+		delete it.second;
+	module->memories.clear();
+
+	for (auto &it : module->processes)
+		delete it.second;
+	module->processes.clear();
+
+	module->new_connections(std::vector<RTLIL::SigSig>());
+	module->attributes.clear();
+
+	new_module->cloneInto(module);
+}
+
+// assign the largest modules first, each to the least loaded worker
+static std::vector<std::vector<int>> schedule_module_jobs(const std::vector<RTLIL::Module*> &modules, int num_workers)
+{
+	std::vector<std::pair<int, int>> module_sizes;
+	for (int i = 0; i < GetSize(modules); i++)
+		module_sizes.push_back(std::pair<int, int>(-GetSize(modules[i]->cells_) - GetSize(modules[i]->wires_), i));
+	std::sort(module_sizes.begin(), module_sizes.end());
+
+	std::vector<std::vector<int>> worker_modules(num_workers);
+	std::vector<int> worker_load(num_workers);
+	for (auto &it : module_sizes) {
+		int w = std::min_element(worker_load.begin(), worker_load.end()) - worker_load.begin();
+		worker_modules[w].push_back(it.second);
+		worker_load[w] -= it.first;
+	}
+	return worker_modules;
+}
+
+// Runs child_job() for each module in forked worker processes. Both jobs get
+// a per-module file name prefix in a temp dir, and the log output of the
+// module is written to <prefix>.log. With merge_modules the modules and the
+// scratchpad are copied back from the workers. parent_job() is called in the
+// original module order after the log of the module is replayed. Returns
+// false when there is only one worker, then the caller runs the jobs itself.
+static bool run_module_workers(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, bool merge_modules,
+		std::function<bool(int, const std::string&)> child_job, std::function<void(int, const std::string&, int)> parent_job)
+{
+	int num_workers = std::min(yosys_jobs, GetSize(modules));
+	if (num_workers <= 1)
+		return false;
+
+	std::vector<std::vector<int>> worker_modules = schedule_module_jobs(modules, num_workers);
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-jobs-XXXXXX");
+	dict<std::string, std::string> old_scratchpad;
+	std::vector<pid_t> worker_pids;
+
+	if (merge_modules)
+		old_scratchpad = design->scratchpad;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			log_error("Failed to fork worker process: %s\n", strerror(errno));
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_streams.clear();
+			log_cmd_error_throw = true;
+			yosys_jobs = 1;
+
+			bool ok = true;
+			try {
+				for (int idx : worker_modules[w]) {
+					std::string prefix = stringf("%s/module_%d", tempdir_name.c_str(), idx);
+					FILE *f = fopen((prefix + ".log").c_str(), "w");
+					log_files.clear();
+					if (f != NULL)
+						log_files.push_back(f);
+					ok = child_job(idx, prefix) && ok;
+					log_flush();
+					if (f != NULL)
+						fclose(f);
+					log_files.clear();
+				}
+			} catch (...) {
+				log_flush();
+				_exit(1);
+			}
+
+			if (merge_modules)
+			{
+				std::ofstream f(stringf("%s/worker_%d.il", tempdir_name.c_str(), w).c_str());
+				f << stringf("autoidx %d\n", autoidx);
+				for (int idx : worker_modules[w])
+					ILANG_BACKEND::dump_module(f, "", modules[idx], design, false);
+				f.close();
+
+				std::ofstream sf(stringf("%s/worker_%d.scratchpad", tempdir_name.c_str(), w).c_str());
+				for (auto &it : design->scratchpad)
+					sf << GetSize(it.first) << " " << GetSize(it.second) << "\n" << it.first << it.second << "\n";
+				sf.close();
+
+				ok = ok && !f.fail() && !sf.fail();
+			}
+
+			_exit(ok ? 0 : 1);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	std::vector<bool> worker_ok(num_workers);
+	for (int w = 0; w < num_workers; w++) {
+		int status = 0;
+		if (waitpid(worker_pids[w], &status, 0) == worker_pids[w])
+			worker_ok[w] = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	RTLIL::Design *results = new RTLIL::Design;
+	std::vector<int> module_worker(GetSize(modules));
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		for (int idx : worker_modules[w])
+			module_worker[idx] = w;
+
+		if (!merge_modules || !worker_ok[w])
+			continue;
+
+		std::ifstream f(stringf("%s/worker_%d.il", tempdir_name.c_str(), w).c_str());
+		ILANG_FRONTEND::lexin = &f;
+		ILANG_FRONTEND::current_design = results;
+		rtlil_frontend_ilang_yydebug = false;
+		rtlil_frontend_ilang_yyrestart(NULL);
+		rtlil_frontend_ilang_yyparse();
+		rtlil_frontend_ilang_yylex_destroy();
+
+		std::ifstream sf(stringf("%s/worker_%d.scratchpad", tempdir_name.c_str(), w).c_str());
+		int key_len, value_len;
+		while (sf >> key_len >> value_len) {
+			std::string key(key_len, 0), value(value_len, 0);
+			sf.get();
+			sf.read(&key[0], key_len);
+			sf.read(&value[0], value_len);
+			if (old_scratchpad.count(key) == 0 || old_scratchpad.at(key) != value)
+				design->scratchpad[key] = value;
+		}
+	}
+
+	// replay the logs and merge the results in the original module order
+	for (int idx = 0; idx < GetSize(modules); idx++)
+	{
+		std::string prefix = stringf("%s/module_%d", tempdir_name.c_str(), idx);
+
+		std::ifstream f((prefix + ".log").c_str());
+		std::string line;
+		while (std::getline(f, line))
+			log("%s%s", line.c_str(), f.eof() ? "" : "\n");
+
+		if (!worker_ok[module_worker[idx]] || (merge_modules && results->module(modules[idx]->name) == nullptr)) {
+			delete results;
+			remove_directory(tempdir_name);
+			log_error("Worker process for module %s failed.\n", log_id(modules[idx]));
+		}
+
+		if (merge_modules)
+			replace_module_contents(modules[idx], results->module(modules[idx]->name));
+
+		parent_job(idx, prefix, module_worker[idx]);
+	}
+
+	delete results;
+	remove_directory(tempdir_name);
+	return true;
+}
+#endif
+
+static void run_module_jobs_worker(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, std::function<void(RTLIL::Module*)> job)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	bool done = run_module_workers(design, modules, true,
+		[&](int idx, const std::string &prefix) {
+			int64_t begin_ns = PerformanceTimer::query();
+			job(modules[idx]);
+			if (pass_profile_enabled) {
+				std::ofstream tf((prefix + ".time").c_str());
+				tf << (PerformanceTimer::query() - begin_ns) << "\n";
+			}
+			return true;
+		},
+		[&](int idx, const std::string &prefix, int) {
+			if (pass_profile_enabled) {
+				std::ifstream tf((prefix + ".time").c_str());
+				int64_t module_ns = 0;
+				if (tf >> module_ns)
+					pass_profile_add_module(modules[idx], module_ns);
+			}
+		});
+	if (done)
+		return;
+#endif
+
+	for (auto module : modules) {
+		int64_t begin_ns = PerformanceTimer::query();
+		pass_stack_set_module(module);
+		job(module);
+		pass_stack_set_module(nullptr);
+		pass_profile_add_module(module, PerformanceTimer::query() - begin_ns);
+	}
+}
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+// The cache key of a module covers the yosys version, the command line of the
+// running command, the design scratchpad, the selection within the module and
+// the module itself. The cached result is the module after the command.
+static std::string module_cache_file(RTLIL::Design *design, RTLIL::Module *module)
+{
+	std::stringstream buf;
+	buf << yosys_version_str << "\n";
+	for (auto &arg : pass_call_args)
+		buf << arg << "\n";
+
+	std::map<std::string, std::string> scratchpad(design->scratchpad.begin(), design->scratchpad.end());
+	for (auto &it : scratchpad)
+		buf << GetSize(it.first) << " " << GetSize(it.second) << "\n" << it.first << it.second << "\n";
+
+	if (!design->selected_whole_module(module->name)) {
+		for (auto wire : module->selected_wires())
+			buf << "selected " << wire->name.str() << "\n";
+		for (auto cell : module->selected_cells())
+			buf << "selected " << cell->name.str() << "\n";
+		for (auto &it : module->processes)
+			if (design->selected(module, it.second))
+				buf << "selected " << it.first.str() << "\n";
+	}
+
+	ILANG_BACKEND::dump_module(buf, "", module, design, false);
+	return stringf("%s/%s.il", yosys_module_cache_dir.c_str(), sha1(buf.str()).c_str());
+}
+
+bool load_cached_module(RTLIL::Module *module, std::string filename)
+{
+	std::ifstream f(filename.c_str());
+	if (f.fail())
+		return false;
+
+	RTLIL::Design *cached = new RTLIL::Design;
+	ILANG_FRONTEND::lexin = &f;
+	ILANG_FRONTEND::current_design = cached;
+	rtlil_frontend_ilang_yydebug = false;
+	rtlil_frontend_ilang_yyrestart(NULL);
+	rtlil_frontend_ilang_yyparse();
+	rtlil_frontend_ilang_yylex_destroy();
+
+	bool found = cached->module(module->name) != nullptr;
+	if (found)
+		replace_module_contents(module, cached->module(module->name));
+	delete cached;
+	return found;
+}
+
+void store_cached_module(RTLIL::Design *design, RTLIL::Module *module, std::string filename)
+{
+	// write to a temporary name first so that an interrupted run never
+	// leaves a truncated cache entry behind
+	std::string tmp_file = make_temp_file(filename + ".XXXXXX");
+	std::ofstream f(tmp_file.c_str());
+	f << stringf("autoidx %d\n", autoidx);
+	ILANG_BACKEND::dump_module(f, "", module, design, false);
+	f.close();
+	if (f.fail() || rename(tmp_file.c_str(), filename.c_str()) != 0) {
+		log_warning("Can't write module cache file `%s'.\n", filename.c_str());
+		remove(tmp_file.c_str());
+	}
+}
+#endif
+
+void run_module_jobs(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, std::function<void(RTLIL::Module*)> job)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	if (!yosys_module_cache_dir.empty() && !pass_call_args.empty())
+	{
+		std::vector<RTLIL::Module*> missed_modules;
+		std::vector<std::string> missed_files;
+
+		for (auto module : modules) {
+			std::string filename = module_cache_file(design, module);
+			if (load_cached_module(module, filename)) {
+				log("Using cached result of `%s' for module %s.\n", pass_call_args[0].c_str(), log_id(module));
+				continue;
+			}
+			missed_modules.push_back(module);
+			missed_files.push_back(filename);
+		}
+
+		dict<std::string, std::string> old_scratchpad = design->scratchpad;
+		run_module_jobs_worker(design, missed_modules, job);
+
+		// results that depend on side effects in the scratchpad can't be replayed
+		if (design->scratchpad != old_scratchpad)
+			return;
+
+		for (int i = 0; i < GetSize(missed_modules); i++)
+			store_cached_module(design, missed_modules[i], missed_files[i]);
+		return;
+	}
+#endif
+
+	run_module_jobs_worker(design, modules, job);
+}
+
+void run_module_dump_jobs(const std::vector<RTLIL::Module*> &modules, std::ostream &f, std::function<void(std::ostream&, RTLIL::Module*)> job)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	f.flush();
+
+	// the output is concatenated in the original module order
+	bool done = run_module_workers(nullptr, modules, false,
+		[&](int idx, const std::string &prefix) {
+			std::ofstream of((prefix + ".out").c_str(), std::ios::binary);
+			job(of, modules[idx]);
+			of.close();
+			return !of.fail();
+		},
+		[&](int, const std::string &prefix, int) {
+			std::ifstream of((prefix + ".out").c_str(), std::ios::binary);
+			if (of.peek() != std::ifstream::traits_type::eof())
+				f << of.rdbuf();
+		});
+	if (done)
+		return;
+#endif
+
+	for (auto module : modules)
+		job(f, module);
+}
+
+void run_module_pipeline(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, const std::vector<std::string> &commands)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	// each module is taken through all commands before the next module of
+	// the same worker is started. the stage times are the CPU time of the
+	// worker since it was started.
+	std::vector<std::vector<std::pair<int64_t, int64_t>>> module_stages(GetSize(modules));
+	std::vector<int> module_worker(GetSize(modules));
+	int64_t stage_ns = 0;
+
+	bool done = !commands.empty() && run_module_workers(design, modules, true,
+		[&](int idx, const std::string &prefix) {
+			std::ofstream tf((prefix + ".time").c_str());
+			for (int i = 0; i < GetSize(commands); i++) {
+				int64_t begin_ns = PerformanceTimer::query();
+				Pass::call_on_module(design, modules[idx], commands[i]);
+				tf << begin_ns << " " << PerformanceTimer::query() << "\n";
+			}
+			return true;
+		},
+		[&](int idx, const std::string &prefix, int worker) {
+			std::ifstream tf((prefix + ".time").c_str());
+			int64_t begin_ns, end_ns;
+			while (tf >> begin_ns >> end_ns) {
+				module_stages[idx].push_back(std::pair<int64_t, int64_t>(begin_ns, end_ns));
+				stage_ns += end_ns - begin_ns;
+			}
+			module_worker[idx] = worker;
+		});
+
+	if (done) {
+		log("\nPipelined %d commands for %d modules in %.3f seconds of stage runtime.\n",
+				GetSize(commands), GetSize(modules), stage_ns / 1e9);
+		log("Stage timeline in milliseconds of worker CPU time:\n");
+		for (int idx = 0; idx < GetSize(modules); idx++) {
+			log("  module %s (worker %d):\n", log_id(modules[idx]), module_worker[idx]);
+			for (int i = 0; i < GetSize(module_stages[idx]); i++)
+				log("    %10.3f %10.3f  %s\n", module_stages[idx][i].first / 1e6, module_stages[idx][i].second / 1e6, commands[i].c_str());
+		}
+		return;
+	}
+#endif
+
+	for (auto &command : commands)
+		Pass::call(design, command);
+}
+
 int GetSize(RTLIL::Wire *wire)
 {
 	return wire->width;
@@ -463,12 +918,53 @@ void yosys_setup()
 	log_assert(empty_id.index_ == 0);
 	IdString::get_reference(empty_id.index_);
 
+	// the static IdStrings get the next indices, they keep their reference
+	// until the process exits (also over yosys_shutdown() and yosys_setup())
+	static bool static_ids_ready = false;
+	if (!static_ids_ready) {
+#define X(_id) { \
+			IdString id("\\" #_id); \
+			log_assert(id.index_ == ID::STATIC_ID_ ## _id); \
+			IdString::get_reference(id.index_); \
+		}
+#include "kernel/constids.inc"
+#undef X
+		static_ids_ready = true;
+	}
+
 	Pass::init_register();
 	yosys_design = new RTLIL::Design;
-	yosys_celltypes.setup();
+#ifdef YOSYS_THREADSAFE_IDSTRING
+	// worker threads must not race on the lazy setup
+	yosys_get_celltypes();
+#endif
 	log_push();
 }
 
+CellTypes &yosys_get_celltypes()
+{
+	if (!yosys_celltypes_ready) {
+		yosys_celltypes.setup();
+		yosys_celltypes.build_index();
+		yosys_celltypes_ready = true;
+
+		// the IdStrings are kept alive by yosys_celltypes, so their
+		// indices stay valid until yosys_shutdown()
+		std::vector<CellTypeId> ids;
+#define X(_t) { \
+			RTLIL::IdString type = "$" #_t; \
+			log_assert(yosys_celltypes.cell_known(type)); \
+			if (type.index_ >= GetSize(ids)) \
+				ids.resize(type.index_ + 1, CT_NONE); \
+			ids[type.index_] = CT_ ## _t; \
+		}
+		YOSYS_INTERNAL_CELL_TYPES(X)
+#undef X
+		yosys_cell_type_ids.swap(ids);
+	}
+	return yosys_celltypes;
+}
+
 void yosys_shutdown()
 {
 	log_pop();
@@ -484,6 +980,8 @@ void yosys_shutdown()
 
 	Pass::done_register();
 	yosys_celltypes.clear();
+	yosys_cell_type_ids.clear();
+	yosys_celltypes_ready = false;
 
 #ifdef YOSYS_ENABLE_TCL
 	if (yosys_tcl_interp != NULL) {
@@ -505,7 +1003,7 @@ void yosys_shutdown()
 	IdString::put_reference(empty_id.index_);
 }
 
-RTLIL::IdString new_id(std::string file, int line, std::string func)
+static std::string new_id_loc(std::string file, int line, std::string func)
 {
 #ifdef _WIN32
 	size_t pos = file.find_last_of("/\\");
@@ -519,7 +1017,44 @@ RTLIL::IdString new_id(std::string file, int line, std::string func)
 	if (pos != std::string::npos)
 		func = func.substr(pos+1);
 
-	return stringf("$auto$%s:%d:%s$%d", file.c_str(), line, func.c_str(), autoidx++);
+	return stringf("%s:%d:%s", file.c_str(), line, func.c_str());
+}
+
+RTLIL::IdString new_id(const char *file, int line, const char *func)
+{
+#ifndef YOSYS_THREADSAFE_IDSTRING
+	// the source location of a NEW_ID is interned once, after that creating
+	// a new name is just a table lookup and no string is formatted. this is
+	// only done for numbers that were never used before, each Context has its
+	// own autoidx and the names of the others may exist already.
+	static int max_autoidx = 0;
+	bool new_autoidx = autoidx > max_autoidx;
+	max_autoidx = std::max(max_autoidx, autoidx);
+
+	if (new_autoidx && !yosys_xtrace)
+	{
+		struct loc_cache_t {
+			const char *file, *func;
+			int line, loc;
+		};
+		static loc_cache_t loc_cache[256];
+
+		loc_cache_t &entry = loc_cache[(uintptr_t(file) ^ uintptr_t(func) ^ line) & 255];
+		if (entry.file != file || entry.func != func || entry.line != line) {
+			entry.file = file;
+			entry.func = func;
+			entry.line = line;
+			entry.loc = RTLIL::IdString::new_autoid_loc(new_id_loc(file, line, func));
+		}
+
+		RTLIL::IdString id;
+		RTLIL::IdString::put_reference(id.index_);
+		id.index_ = RTLIL::IdString::get_reference(RTLIL::IdString::new_autoid(entry.loc, autoidx++));
+		return id;
+	}
+#endif
+
+	return stringf("$auto$%s$%d", new_id_loc(file, line, func).c_str(), autoidx++);
 }
 
 RTLIL::Design *yosys_get_design()
@@ -759,16 +1294,21 @@ void run_frontend(std::string filename, std::string command, std::string *backen
 		design = yosys_design;
 
 	if (command == "auto") {
-		if (filename.size() > 2 && filename.substr(filename.size()-2) == ".v")
+		std::string name = strip_compress_suffix(filename);
+		if (name.size() > 2 && name.substr(name.size()-2) == ".v")
 			command = "verilog";
-		else if (filename.size() > 2 && filename.substr(filename.size()-3) == ".sv")
+		else if (name.size() > 2 && name.substr(name.size()-3) == ".sv")
 			command = "verilog -sv";
-		else if (filename.size() > 2 && filename.substr(filename.size()-4) == ".vhd")
+		else if (name.size() > 2 && name.substr(name.size()-4) == ".vhd")
 			command = "vhdl";
-		else if (filename.size() > 4 && filename.substr(filename.size()-5) == ".blif")
+		else if (name.size() > 4 && name.substr(name.size()-5) == ".blif")
 			command = "blif";
-		else if (filename.size() > 3 && filename.substr(filename.size()-3) == ".il")
+		else if (name.size() > 3 && name.substr(name.size()-3) == ".il")
 			command = "ilang";
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".rtlb")
+			command = "rtlil_bin";
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".json")
+			command = "json";
 		else if (filename.size() > 3 && filename.substr(filename.size()-3) == ".ys")
 			command = "script";
 		else if (filename == "-")
@@ -874,15 +1414,18 @@ void run_backend(std::string filename, std::string command, RTLIL::Design *desig
 		design = yosys_design;
 
 	if (command == "auto") {
-		if (filename.size() > 2 && filename.substr(filename.size()-2) == ".v")
+		std::string name = strip_compress_suffix(filename);
+		if (name.size() > 2 && name.substr(name.size()-2) == ".v")
 			command = "verilog";
-		else if (filename.size() > 3 && filename.substr(filename.size()-3) == ".il")
+		else if (name.size() > 3 && name.substr(name.size()-3) == ".il")
 			command = "ilang";
-		else if (filename.size() > 5 && filename.substr(filename.size()-5) == ".blif")
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".rtlb")
+			command = "rtlil_bin";
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".blif")
 			command = "blif";
-		else if (filename.size() > 5 && filename.substr(filename.size()-5) == ".edif")
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".edif")
 			command = "edif";
-		else if (filename.size() > 5 && filename.substr(filename.size()-5) == ".json")
+		else if (name.size() > 5 && name.substr(name.size()-5) == ".json")
 			command = "json";
 		else if (filename == "-")
 			command = "ilang";
@@ -1083,6 +1626,7 @@ struct ShellPass : public Pass {
 #ifdef YOSYS_ENABLE_READLINE
 struct HistoryPass : public Pass {
 	HistoryPass() : Pass("history", "show last interactive commands") { }
+	virtual bool read_only() { return true; }
 	virtual void help() {
 		log("\n");
 		log("    history\n");
@@ -1102,6 +1646,7 @@ struct HistoryPass : public Pass {
 
 struct ScriptCmdPass : public Pass {
 	ScriptCmdPass() : Pass("script", "execute commands from script file") { }
+	virtual bool read_only() { return true; }
 	virtual void help() {
 		log("\n");
 		log("    script <filename> [<from_label>:<to_label>]\n");
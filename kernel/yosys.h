@@ -52,6 +52,15 @@
 #include <stdexcept>
 #include <memory>
 
+#ifdef YOSYS_THREADSAFE_IDSTRING
+#  include <atomic>
+#  include <mutex>
+#endif
+
+#if defined(HASHLIB_SWISSTABLE) && defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
 #include <sstream>
 #include <fstream>
 #include <istream>
@@ -164,6 +173,7 @@ using hashlib::mkhash;
 using hashlib::mkhash_init;
 using hashlib::mkhash_add;
 using hashlib::mkhash_xorshift;
+using hashlib::mkhash_finalize;
 using hashlib::hash_ops;
 using hashlib::hash_cstr_ops;
 using hashlib::hash_ptr_ops;
@@ -230,17 +240,46 @@ std::string next_token(std::string &text, const char *sep = " \t\r\n", bool long
 std::vector<std::string> split_tokens(const std::string &text, const char *sep = " \t\r\n");
 bool patmatch(const char *pattern, const char *string);
 int run_command(const std::string &command, std::function<void(const std::string&)> process_line = std::function<void(const std::string&)>());
+// templates starting with "/tmp/" are created in get_temp_dir() instead
+std::string get_temp_dir();
 std::string make_temp_file(std::string template_str = "/tmp/yosys_XXXXXX");
 std::string make_temp_dir(std::string template_str = "/tmp/yosys_XXXXXX");
 bool check_file_exists(std::string filename, bool is_exec = false);
 bool is_absolute_path(std::string filename);
 void remove_directory(std::string dirname);
 
+// files with a ".gz" or ".zst" suffix are (de)compressed transparently.
+// returns nullptr if the file can't be opened.
+std::istream *open_input_file(std::string filename);
+std::ostream *open_output_file(std::string filename);
+std::string strip_compress_suffix(std::string filename);
+
+// the complete contents of an input file, mapped into memory with mmap() when
+// possible and read from the already opened stream f otherwise
+struct MappedFile
+{
+	const char *data;
+	size_t size;
+
+	MappedFile(std::istream &f, std::string filename);
+	~MappedFile();
+
+private:
+	std::string buffer;
+	void *mapping;
+	MappedFile(const MappedFile&);
+	MappedFile &operator=(const MappedFile&);
+};
+
 template<typename T> int GetSize(const T &obj) { return obj.size(); }
 int GetSize(RTLIL::Wire *wire);
 
 extern int autoidx;
 extern int yosys_xtrace;
+extern int yosys_jobs;
+extern bool yosys_incremental_check;
+extern std::string yosys_module_cache_dir;
+extern std::string yosys_temp_dir;
 
 YOSYS_NAMESPACE_END
 
@@ -267,11 +306,13 @@ Tcl_Interp *yosys_get_tcl_interp();
 
 extern RTLIL::Design *yosys_design;
 
-RTLIL::IdString new_id(std::string file, int line, std::string func);
+RTLIL::IdString new_id(const char *file, int line, const char *func);
 
 #define NEW_ID \
 	YOSYS_NAMESPACE_PREFIX new_id(__FILE__, __LINE__, __FUNCTION__)
 
+// the names in kernel/constids.inc are available as ID::<name> without the
+// function-local static (see kernel/rtlil.h)
 #define ID(_str) \
 	([]() { static YOSYS_NAMESPACE_PREFIX RTLIL::IdString _id(_str); return _id; })()
 
@@ -285,6 +326,13 @@ void run_pass(std::string command, RTLIL::Design *design = nullptr);
 void run_frontend(std::string filename, std::string command, std::string *backend_command, std::string *from_to_label = nullptr, RTLIL::Design *design = nullptr);
 void run_frontend(std::string filename, std::string command, RTLIL::Design *design = nullptr);
 void run_backend(std::string filename, std::string command, RTLIL::Design *design = nullptr);
+void run_module_jobs(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, std::function<void(RTLIL::Module*)> job);
+void run_module_dump_jobs(const std::vector<RTLIL::Module*> &modules, std::ostream &f, std::function<void(std::ostream&, RTLIL::Module*)> job);
+void run_module_pipeline(RTLIL::Design *design, const std::vector<RTLIL::Module*> &modules, const std::vector<std::string> &commands);
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+bool load_cached_module(RTLIL::Module *module, std::string filename);
+void store_cached_module(RTLIL::Design *design, RTLIL::Module *module, std::string filename);
+#endif
 void shell(RTLIL::Design *design);
 
 // from kernel/version_*.o (cc source generated from Makefile)
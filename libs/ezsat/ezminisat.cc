@@ -23,6 +23,7 @@
 
 #include "ezminisat.h"
 
+#include <algorithm>
 #include <limits.h>
 #include <stdint.h>
 #include <csignal>
@@ -30,6 +31,8 @@
 
 #ifndef _WIN32
 #  include <unistd.h>
+#  include <poll.h>
+#  include <sys/wait.h>
 #endif
 
 #include "../minisat/Solver.h"
@@ -40,6 +43,11 @@ ezMiniSAT::ezMiniSAT() : minisatSolver(NULL)
 	minisatSolver = NULL;
 	foundContradiction = false;
 
+	portfolioSize = 1;
+	portfolioConflicts = 20000;
+
+	compactionRetiredGroups = 0;
+
 	freeze(CONST_TRUE);
 	freeze(CONST_FALSE);
 }
@@ -60,6 +68,7 @@ void ezMiniSAT::clear()
 	minisatVars.clear();
 #if EZMINISAT_SIMPSOLVER && EZMINISAT_INCREMENTAL
 	cnfFrozenVars.clear();
+	minisatFrozen.clear();
 #endif
 	ezSAT::clear();
 }
@@ -75,24 +84,285 @@ bool ezMiniSAT::eliminated(int idx)
 {
 	idx = idx < 0 ? -idx : idx;
 	if (minisatSolver != NULL && idx > 0 && idx <= int(minisatVars.size()))
-		return minisatSolver->isEliminated(minisatVars.at(idx-1));
+		return minisatEliminated(minisatVars.at(idx-1));
 	return false;
 }
 #endif
 
-#ifndef _WIN32
-ezMiniSAT *ezMiniSAT::alarmHandlerThis = NULL;
-clock_t ezMiniSAT::alarmHandlerTimeout = 0;
+// variables that were eliminated before a compaction have no MiniSAT
+// variable in the new solver instance and are mapped to var_Undef
+bool ezMiniSAT::minisatEliminated(int var) const
+{
+#if EZMINISAT_SIMPSOLVER
+	return var == Minisat::var_Undef || minisatSolver->isEliminated(var);
+#else
+	(void)var;
+	return false;
+#endif
+}
 
-void ezMiniSAT::alarmHandler(int)
+void ezMiniSAT::updateStatistics()
 {
-	if (clock() > alarmHandlerTimeout) {
-		alarmHandlerThis->minisatSolver->interrupt();
-		alarmHandlerTimeout = 0;
-	} else
-		alarm(1);
+	solverCalls++;
+	if (minisatSolver == NULL)
+		return;
+
+	solverVariables = minisatSolver->nVars();
+#if EZMINISAT_SIMPSOLVER
+	solverVariables -= minisatSolver->eliminated_vars;
+#endif
+	solverClauses = minisatSolver->nClauses();
+	solverLearnts = minisatSolver->nLearnts();
+
+	solverMaxVariables = std::max(solverMaxVariables, solverVariables);
+	solverMaxClauses = std::max(solverMaxClauses, solverClauses);
+	solverMaxLearnts = std::max(solverMaxLearnts, solverLearnts);
 }
+
+// rebuild the solver instance from the problem clauses that are not yet
+// satisfied at level 0, this drops the learnt clauses, the clauses of
+// retired groups and everything MiniSAT keeps for eliminated variables
+void ezMiniSAT::compact()
+{
+	compactionRetiredGroups = numRetiredGroups();
+
+#if EZMINISAT_INCREMENTAL
+	if (minisatSolver == NULL || foundContradiction)
+		return;
+
+	Solver *oldSolver = minisatSolver;
+	std::vector<Minisat::Var> oldVars, varMap(oldSolver->nVars(), Minisat::var_Undef);
+	oldVars.swap(minisatVars);
+
+	minisatSolver = new Solver;
+	minisatSolver->verbosity = EZMINISAT_VERBOSITY;
+
+	Minisat::vec<Minisat::Lit> units;
+
+	for (int i = 0; i < int(oldVars.size()); i++)
+	{
+		Minisat::Var var = oldVars[i];
+		bool is_eliminated = var == Minisat::var_Undef;
+#if EZMINISAT_SIMPSOLVER
+		is_eliminated = is_eliminated || oldSolver->isEliminated(var);
+#endif
+		if (is_eliminated) {
+			minisatVars.push_back(Minisat::var_Undef);
+			continue;
+		}
+
+		varMap[var] = minisatSolver->newVar();
+		minisatVars.push_back(varMap[var]);
+#if EZMINISAT_SIMPSOLVER
+		if (i < int(minisatFrozen.size()) && minisatFrozen[i])
+			minisatSolver->setFrozen(varMap[var], true);
+#endif
+		if (oldSolver->value(var) != Minisat::l_Undef)
+			units.push(Minisat::mkLit(varMap[var], oldSolver->value(var) == Minisat::l_False));
+	}
+
+	bool ok = true;
+
+	for (int i = 0; i < units.size() && ok; i++)
+		ok = minisatSolver->addClause(units[i]);
+
+	Minisat::vec<Minisat::Lit> ps;
+	for (auto it = oldSolver->clausesBegin(); oldSolver->nClauses() > 0 && it != oldSolver->clausesEnd() && ok; ++it)
+	{
+		const Minisat::Clause &c = *it;
+		if (c.mark() != 0)
+			continue;
+
+		bool satisfied = false;
+		ps.clear();
+		for (int i = 0; i < c.size() && !satisfied; i++) {
+			Minisat::lbool value = oldSolver->value(c[i]);
+			if (value == Minisat::l_True)
+				satisfied = true;
+			else if (value == Minisat::l_Undef)
+				ps.push(Minisat::mkLit(varMap.at(Minisat::var(c[i])), Minisat::sign(c[i])));
+		}
+
+		if (!satisfied)
+			ok = minisatSolver->addClause(ps);
+	}
+
+	delete oldSolver;
+	solverCompactions++;
+
+	if (!ok) {
+		delete minisatSolver;
+		minisatSolver = NULL;
+		minisatVars.clear();
+		foundContradiction = true;
+	}
 #endif
+}
+
+#ifndef _WIN32
+struct ezMiniSATPortfolio
+{
+	std::vector<pid_t> pids;
+	std::vector<int> fds;
+
+	// each child process solves the problem with a different configuration and
+	// writes one status byte (0 = unsat, 1 = sat) and the model values to a pipe
+	template<typename Solver>
+	void fork_solvers(Solver *solver, const Minisat::vec<Minisat::Lit> &assumps, const std::vector<int> &modelIdx,
+			const std::vector<Minisat::Var> &minisatVars, int num_solvers, int64_t conflicts_left, int64_t propagations_left)
+	{
+		fflush(NULL);
+
+		for (int i = 1; i <= num_solvers; i++)
+		{
+			int pipefd[2];
+			if (pipe(pipefd) != 0)
+				break;
+
+			pid_t pid = fork();
+			if (pid < 0) {
+				close(pipefd[0]);
+				close(pipefd[1]);
+				break;
+			}
+
+			if (pid == 0)
+			{
+				close(pipefd[0]);
+
+				solver->random_seed = 91648253 + 1000003 * i;
+				solver->random_var_freq = 0.01 * (i % 4 + 1);
+				solver->luby_restart = i % 2 == 0;
+				solver->phase_saving = i % 3 == 2 ? 1 : 2;
+				solver->budgetOff();
+				if (conflicts_left > 0)
+					solver->setConfBudget(conflicts_left);
+				if (propagations_left > 0)
+					solver->setPropBudget(propagations_left);
+
+				std::vector<char> buffer;
+				try {
+					Minisat::lbool ret = solver->solveLimited(assumps);
+					if (ret == Minisat::l_Undef)
+						_exit(1);
+					buffer.push_back(ret == Minisat::l_True);
+					if (ret == Minisat::l_True)
+						for (auto idx : modelIdx) {
+							Minisat::lbool value = solver->modelValue(minisatVars.at((idx < 0 ? -idx : idx) - 1));
+							buffer.push_back(value == Minisat::lbool(idx > 0));
+						}
+				} catch (...) {
+					_exit(1);
+				}
+
+				for (size_t pos = 0; pos < buffer.size();) {
+					ssize_t n = write(pipefd[1], buffer.data() + pos, buffer.size() - pos);
+					if (n <= 0)
+						_exit(1);
+					pos += n;
+				}
+				_exit(0);
+			}
+
+			close(pipefd[1]);
+			pids.push_back(pid);
+			fds.push_back(pipefd[0]);
+		}
+	}
+
+	bool read_all(int fd, char *data, size_t size)
+	{
+		while (size > 0) {
+			ssize_t n = read(fd, data, size);
+			if (n <= 0)
+				return false;
+			data += n, size -= n;
+		}
+		return true;
+	}
+
+	// returns -1 if no child process has finished yet, 0 for unsat and 1 for sat
+	int poll_solvers(size_t model_size, std::vector<bool> &modelValues)
+	{
+		for (size_t i = 0; i < fds.size(); i++)
+		{
+			if (fds[i] < 0)
+				continue;
+
+			struct pollfd pfd;
+			pfd.fd = fds[i];
+			pfd.events = POLLIN;
+			if (poll(&pfd, 1, 0) <= 0)
+				continue;
+
+			char status;
+			std::vector<char> buffer(model_size);
+			if (read_all(fds[i], &status, 1) && (status == 0 || read_all(fds[i], buffer.data(), model_size))) {
+				modelValues.clear();
+				if (status != 0)
+					for (auto value : buffer)
+						modelValues.push_back(value != 0);
+				return status != 0;
+			}
+
+			// the child process failed, e.g. because it ran out of memory
+			close(fds[i]);
+			fds[i] = -1;
+		}
+		return -1;
+	}
+
+	~ezMiniSATPortfolio()
+	{
+		for (auto pid : pids)
+			kill(pid, SIGKILL);
+		for (auto pid : pids)
+			waitpid(pid, NULL, 0);
+		for (auto fd : fds)
+			if (fd >= 0)
+				close(fd);
+	}
+};
+#endif
+
+// called by the solver between decisions, returns non-zero to stop the search
+struct ezMiniSATTerminate
+{
+	clock_t timeout_clock;
+	const std::function<bool()> *interrupt;
+	int calls;
+	bool terminated;
+#ifndef _WIN32
+	ezMiniSATPortfolio *portfolio;
+#endif
+	size_t model_size;
+	std::vector<bool> *modelValues;
+	int portfolio_result;
+
+	ezMiniSATTerminate() : timeout_clock(0), interrupt(NULL), calls(0), terminated(false),
+#ifndef _WIN32
+			portfolio(NULL),
+#endif
+			model_size(0), modelValues(NULL), portfolio_result(-1) { }
+
+	static int callback(void *state)
+	{
+		ezMiniSATTerminate *that = (ezMiniSATTerminate*)state;
+		if (that->terminated)
+			return 1;
+		if (++that->calls % 256 != 0)
+			return 0;
+		if (that->timeout_clock != 0 && clock() > that->timeout_clock)
+			that->terminated = true;
+		if (that->interrupt != NULL && (*that->interrupt)())
+			that->terminated = true;
+#ifndef _WIN32
+		if (that->portfolio != NULL && (that->portfolio_result = that->portfolio->poll_solvers(that->model_size, *that->modelValues)) >= 0)
+			that->terminated = true;
+#endif
+		return that->terminated;
+	}
+};
 
 bool ezMiniSAT::solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions)
 {
@@ -109,6 +379,9 @@ contradiction:
 		return false;
 	}
 
+	if (solverCompactionInterval > 0 && numRetiredGroups() - compactionRetiredGroups >= solverCompactionInterval)
+		compact();
+
 	if (foundContradiction) {
 		consumeCnf();
 		return false;
@@ -118,6 +391,8 @@ contradiction:
 
 	for (auto id : assumptions)
 		extraClauses.push_back(bind(id));
+	for (auto id : active_groups())
+		extraClauses.push_back(bind(id));
 	for (auto id : modelExpressions)
 		modelIdx.push_back(bind(id));
 
@@ -127,38 +402,48 @@ contradiction:
 	}
 
 #if EZMINISAT_INCREMENTAL
-	std::vector<std::vector<int>> cnf;
+	std::vector<int> cnf;
 	consumeCnf(cnf);
 #else
-	const std::vector<std::vector<int>> &cnf = this->cnf();
+	const std::vector<int> &cnf = this->cnf();
 #endif
 
 	while (int(minisatVars.size()) < numCnfVariables())
 		minisatVars.push_back(minisatSolver->newVar());
 
 #if EZMINISAT_SIMPSOLVER && EZMINISAT_INCREMENTAL
-	for (auto idx : cnfFrozenVars)
-		minisatSolver->setFrozen(minisatVars.at(idx > 0 ? idx-1 : -idx-1), true);
+	for (auto idx : cnfFrozenVars) {
+		int var_idx = idx > 0 ? idx-1 : -idx-1;
+		if (minisatEliminated(minisatVars.at(var_idx)))
+			continue;
+		minisatSolver->setFrozen(minisatVars.at(var_idx), true);
+		if (var_idx >= int(minisatFrozen.size()))
+			minisatFrozen.resize(var_idx+1);
+		minisatFrozen[var_idx] = true;
+	}
 	cnfFrozenVars.clear();
 #endif
 
-	for (auto &clause : cnf) {
-		Minisat::vec<Minisat::Lit> ps;
-		for (auto idx : clause) {
-			if (idx > 0)
-				ps.push(Minisat::mkLit(minisatVars.at(idx-1)));
-			else
-				ps.push(Minisat::mkLit(minisatVars.at(-idx-1), true));
+	// the clauses are stored back to back, each one terminated by a zero
+	Minisat::vec<Minisat::Lit> ps;
+	for (auto idx : cnf) {
+		if (idx == 0) {
+			if (!minisatSolver->addClause(ps))
+				goto contradiction;
+			ps.clear();
+			continue;
+		}
+		if (idx > 0)
+			ps.push(Minisat::mkLit(minisatVars.at(idx-1)));
+		else
+			ps.push(Minisat::mkLit(minisatVars.at(-idx-1), true));
 #if EZMINISAT_SIMPSOLVER
-			if (minisatSolver->isEliminated(minisatVars.at(idx > 0 ? idx-1 : -idx-1))) {
-				fprintf(stderr, "Assert in %s:%d failed! Missing call to ezsat->freeze(): %s (lit=%d)\n",
-						__FILE__, __LINE__, cnfLiteralInfo(idx).c_str(), idx);
-				abort();
-			}
-#endif
+		if (minisatEliminated(minisatVars.at(idx > 0 ? idx-1 : -idx-1))) {
+			fprintf(stderr, "Assert in %s:%d failed! Missing call to ezsat->freeze(): %s (lit=%d)\n",
+					__FILE__, __LINE__, cnfLiteralInfo(idx).c_str(), idx);
+			abort();
 		}
-		if (!minisatSolver->addClause(ps))
-			goto contradiction;
+#endif
 	}
 
 	if (cnf.size() > 0 && !minisatSolver->simplify())
@@ -172,41 +457,89 @@ contradiction:
 		else
 			assumps.push(Minisat::mkLit(minisatVars.at(-idx-1), true));
 #if EZMINISAT_SIMPSOLVER
-		if (minisatSolver->isEliminated(minisatVars.at(idx > 0 ? idx-1 : -idx-1))) {
+		if (minisatEliminated(minisatVars.at(idx > 0 ? idx-1 : -idx-1))) {
 			fprintf(stderr, "Assert in %s:%d failed! Missing call to ezsat->freeze(): %s\n", __FILE__, __LINE__, cnfLiteralInfo(idx).c_str());
 			abort();
 		}
 #endif
 	}
 
-#ifndef _WIN32
-	struct sigaction sig_action;
-	struct sigaction old_sig_action;
-	int old_alarm_timeout = 0;
+	// the timeout and the portfolio are checked from the terminate callback of
+	// the solver, so that no signal handlers or threads are needed for them
+	ezMiniSATTerminate term;
+	term.timeout_clock = solverTimeout > 0 ? clock() + solverTimeout*CLOCKS_PER_SEC : 0;
+	term.interrupt = solverInterrupt ? &solverInterrupt : NULL;
+	uint64_t start_conflicts = minisatSolver->conflicts;
+	uint64_t start_propagations = minisatSolver->propagations;
+	uint64_t start_decisions = minisatSolver->decisions;
 
-	if (solverTimeout > 0) {
-		sig_action.sa_handler = alarmHandler;
-		sigemptyset(&sig_action.sa_mask);
-		sig_action.sa_flags = SA_RESTART;
-		alarmHandlerThis = this;
-		alarmHandlerTimeout = clock() + solverTimeout*CLOCKS_PER_SEC;
-		old_alarm_timeout = alarm(0);
-		sigaction(SIGALRM, &sig_action, &old_sig_action);
-		alarm(1);
-	}
-#endif
+	bool foundSolution = false;
+	bool foundPortfolioSolution = false;
+	Minisat::lbool ret = Minisat::l_Undef;
 
-	bool foundSolution = minisatSolver->solve(assumps);
+	if (term.timeout_clock != 0 || term.interrupt != NULL)
+		minisatSolver->setTermCallback(&term, ezMiniSATTerminate::callback);
 
 #ifndef _WIN32
-	if (solverTimeout > 0) {
-		if (alarmHandlerTimeout == 0)
-			solverTimoutStatus = true;
-		alarm(0);
-		sigaction(SIGALRM, &old_sig_action, NULL);
-		alarm(old_alarm_timeout);
+	ezMiniSATPortfolio portfolio;
+	if (portfolioSize > 1)
+	{
+		// easy problems are solved without forking, afterwards the other solvers
+		// of the portfolio run while this one continues the search
+		minisatSolver->budgetOff();
+		minisatSolver->setConfBudget(solverConflictBudget > 0 ? std::min<int64_t>(solverConflictBudget, portfolioConflicts) : portfolioConflicts);
+		if (solverPropagationBudget > 0)
+			minisatSolver->setPropBudget(solverPropagationBudget);
+		ret = minisatSolver->solveLimited(assumps);
+
+		int64_t conflicts_left = solverConflictBudget - int64_t(minisatSolver->conflicts - start_conflicts);
+		int64_t propagations_left = solverPropagationBudget - int64_t(minisatSolver->propagations - start_propagations);
+
+		if (ret == Minisat::l_Undef && !term.terminated && (solverConflictBudget <= 0 || conflicts_left > 0) && (solverPropagationBudget <= 0 || propagations_left > 0))
+		{
+			portfolio.fork_solvers(minisatSolver, assumps, modelIdx, minisatVars, portfolioSize-1, solverConflictBudget > 0 ? conflicts_left : -1,
+					solverPropagationBudget > 0 ? propagations_left : -1);
+
+			term.portfolio = &portfolio;
+			term.model_size = modelIdx.size();
+			term.modelValues = &modelValues;
+			minisatSolver->setTermCallback(&term, ezMiniSATTerminate::callback);
+
+			minisatSolver->budgetOff();
+			if (solverConflictBudget > 0)
+				minisatSolver->setConfBudget(conflicts_left);
+			if (solverPropagationBudget > 0)
+				minisatSolver->setPropBudget(propagations_left);
+			ret = minisatSolver->solveLimited(assumps);
+		}
 	}
+	else
 #endif
+	{
+		minisatSolver->budgetOff();
+		if (solverConflictBudget > 0)
+			minisatSolver->setConfBudget(solverConflictBudget);
+		if (solverPropagationBudget > 0)
+			minisatSolver->setPropBudget(solverPropagationBudget);
+		ret = minisatSolver->solveLimited(assumps);
+	}
+
+	minisatSolver->budgetOff();
+	minisatSolver->setTermCallback(NULL, NULL);
+
+	if (ret != Minisat::l_Undef)
+		foundSolution = ret == Minisat::l_True;
+	else if (term.portfolio_result >= 0) {
+		foundSolution = term.portfolio_result != 0;
+		foundPortfolioSolution = true;
+	} else
+		solverTimoutStatus = true;
+
+	solverConflicts = minisatSolver->conflicts - start_conflicts;
+	solverPropagations = minisatSolver->propagations - start_propagations;
+	solverDecisions = minisatSolver->decisions - start_decisions;
+
+	updateStatistics();
 
 	if (!foundSolution) {
 #if !EZMINISAT_INCREMENTAL
@@ -217,10 +550,9 @@ contradiction:
 		return false;
 	}
 
-	modelValues.clear();
 	modelValues.resize(modelIdx.size());
 
-	for (size_t i = 0; i < modelIdx.size(); i++)
+	for (size_t i = 0; i < modelIdx.size() && !foundPortfolioSolution; i++)
 	{
 		int idx = modelIdx[i];
 		bool refvalue = true;
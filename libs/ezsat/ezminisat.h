@@ -49,15 +49,25 @@ private:
 
 #if EZMINISAT_SIMPSOLVER && EZMINISAT_INCREMENTAL
 	std::set<int> cnfFrozenVars;
+	std::vector<bool> minisatFrozen;
 #endif
+	int compactionRetiredGroups;
 
-#ifndef _WIN32
-	static ezMiniSAT *alarmHandlerThis;
-	static clock_t alarmHandlerTimeout;
-	static void alarmHandler(int);
-#endif
+	bool minisatEliminated(int var) const;
+	void updateStatistics();
 
 public:
+	// Number of solver processes used for hard problems (portfolioSize > 1):
+	// When a problem is not solved within the first portfolioConflicts
+	// conflicts, portfolioSize-1 differently configured copies of the solver
+	// are forked and the first answer is used.
+	int portfolioSize, portfolioConflicts;
+
+	void setPortfolio(int size, int conflicts = 20000) {
+		portfolioSize = size;
+		portfolioConflicts = conflicts;
+	}
+
 	ezMiniSAT();
 	virtual ~ezMiniSAT();
 	virtual void clear();
@@ -65,6 +75,7 @@ public:
 	virtual void freeze(int id);
 	virtual bool eliminated(int idx);
 #endif
+	virtual void compact();
 	virtual bool solver(const std::vector<int> &modelExpressions, std::vector<bool> &modelValues, const std::vector<int> &assumptions);
 };
 
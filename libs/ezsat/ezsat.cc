@@ -54,8 +54,26 @@ ezSAT::ezSAT()
 	cnfClausesCount = 0;
 
 	solverTimeout = 0;
+	solverConflictBudget = 0;
+	solverPropagationBudget = 0;
 	solverTimoutStatus = false;
 
+	solverConflicts = 0;
+	solverPropagations = 0;
+	solverDecisions = 0;
+
+	solverCalls = 0;
+	solverCompactions = 0;
+	solverVariables = 0;
+	solverClauses = 0;
+	solverLearnts = 0;
+	solverMaxVariables = 0;
+	solverMaxClauses = 0;
+	solverMaxLearnts = 0;
+	solverCompactionInterval = 0;
+
+	retiredGroupsCount = 0;
+
 	literal("CONST_TRUE");
 	literal("CONST_FALSE");
 
@@ -85,11 +103,12 @@ int ezSAT::literal()
 
 int ezSAT::literal(const std::string &name)
 {
-	if (literalsCache.count(name) == 0) {
-		literals.push_back(name);
-		literalsCache[name] = literals.size();
-	}
-	return literalsCache.at(name);
+	auto it = literalsCache.find(name);
+	if (it != literalsCache.end())
+		return it->second;
+	literals.push_back(name);
+	literalsCache[name] = literals.size();
+	return literals.size();
 }
 
 int ezSAT::frozen_literal()
@@ -108,23 +127,28 @@ int ezSAT::frozen_literal(const std::string &name)
 
 int ezSAT::expression(OpId op, int a, int b, int c, int d, int e, int f)
 {
-	std::vector<int> args(6);
-	args[0] = a, args[1] = b, args[2] = c;
-	args[3] = d, args[4] = e, args[5] = f;
-	return expression(op, args);
+	int args[6] = { a, b, c, d, e, f };
+	return expression(op, args, 6);
 }
 
 int ezSAT::expression(OpId op, const std::vector<int> &args)
 {
-	std::vector<int> myArgs;
-	myArgs.reserve(args.size());
+	return expression(op, args.data(), int(args.size()));
+}
+
+int ezSAT::expression(OpId op, const int *args, int args_size)
+{
+	// the buffer is not used anymore when NOT() is called below
+	std::vector<int> &myArgs = expressionArgsBuffer;
+	myArgs.clear();
 	bool xorRemovedOddTrues = false;
 
 	addhash(__LINE__);
 	addhash(op);
 
-	for (auto arg : args)
+	for (int i = 0; i < args_size; i++)
 	{
+		int arg = args[i];
 		addhash(__LINE__);
 		addhash(arg);
 
@@ -202,16 +226,7 @@ int ezSAT::expression(OpId op, const std::vector<int> &args)
 		abort();
 	}
 
-	std::pair<OpId, std::vector<int>> myExpr(op, myArgs);
-	int id = 0;
-
-	if (expressionsCache.count(myExpr) > 0) {
-		id = expressionsCache.at(myExpr);
-	} else {
-		id = -(int(expressions.size()) + 1);
-		expressionsCache[myExpr] = id;
-		expressions.push_back(myExpr);
-	}
+	int id = lookup_or_add_expression(op, myArgs.data(), int(myArgs.size()));
 
 	if (xorRemovedOddTrues)
 		id = NOT(id);
@@ -222,6 +237,54 @@ int ezSAT::expression(OpId op, const std::vector<int> &args)
 	return id;
 }
 
+unsigned int ezSAT::expression_hash(OpId op, const int *args, int args_size)
+{
+	unsigned int h = 5381 + op;
+	for (int i = 0; i < args_size; i++)
+		h = ((h << 5) + h) ^ unsigned(args[i]);
+	return h;
+}
+
+int ezSAT::lookup_or_add_expression(OpId op, const int *args, int args_size)
+{
+	unsigned int h = expression_hash(op, args, args_size);
+
+	if (2*expressions.size() >= expressionsTable.size())
+	{
+		expressionsTable.assign(expressionsTable.empty() ? 1024 : 2*expressionsTable.size(), 0);
+		size_t mask = expressionsTable.size() - 1;
+		for (int i = 0; i < int(expressions.size()); i++) {
+			size_t slot = expressions[i].hash & mask;
+			while (expressionsTable[slot] != 0)
+				slot = (slot + 1) & mask;
+			expressionsTable[slot] = i + 1;
+		}
+	}
+
+	size_t mask = expressionsTable.size() - 1;
+	size_t slot = h & mask;
+
+	for (; expressionsTable[slot] != 0; slot = (slot + 1) & mask) {
+		const expression_t &expr = expressions[expressionsTable[slot] - 1];
+		if (expr.hash != h || expr.op != op || expr.args_size != args_size)
+			continue;
+		if (std::equal(args, args + args_size, expressionArgs.begin() + expr.args_offset))
+			return -expressionsTable[slot];
+	}
+
+	expression_t expr;
+	expr.op = op;
+	expr.args_offset = expressionArgs.size();
+	expr.args_size = args_size;
+	expr.hash = h;
+
+	expressionArgs.insert(expressionArgs.end(), args, args + args_size);
+	expressions.push_back(expr);
+	expressionsTable[slot] = expressions.size();
+
+	return -int(expressions.size());
+}
+
 void ezSAT::lookup_literal(int id, std::string &name) const
 {
 	assert(0 < id && id <= int(literals.size()));
@@ -236,16 +299,18 @@ const std::string &ezSAT::lookup_literal(int id) const
 
 void ezSAT::lookup_expression(int id, OpId &op, std::vector<int> &args) const
 {
-	assert(0 < -id && -id <= int(expressions.size()));
-	op = expressions[-id - 1].first;
-	args = expressions[-id - 1].second;
+	int args_size;
+	const int *args_data = lookup_expression(id, op, args_size);
+	args.assign(args_data, args_data + args_size);
 }
 
-const std::vector<int> &ezSAT::lookup_expression(int id, OpId &op) const
+const int *ezSAT::lookup_expression(int id, OpId &op, int &args_size) const
 {
 	assert(0 < -id && -id <= int(expressions.size()));
-	op = expressions[-id - 1].first;
-	return expressions[-id - 1].second;
+	const expression_t &expr = expressions[-id - 1];
+	op = expr.op;
+	args_size = expr.args_size;
+	return expressionArgs.data() + expr.args_offset;
 }
 
 int ezSAT::parse_string(const std::string &)
@@ -318,13 +383,14 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 	}
 
 	OpId op;
-	const std::vector<int> &args = lookup_expression(id, op);
+	int args_size;
+	const int *args = lookup_expression(id, op, args_size);
 	int a, b;
 
 	switch (op)
 	{
 	case OpNot:
-		assert(args.size() == 1);
+		assert(args_size == 1);
 		a = eval(args[0], values);
 		if (a == CONST_TRUE)
 			return CONST_FALSE;
@@ -333,8 +399,8 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 		return 0;
 	case OpAnd:
 		a = CONST_TRUE;
-		for (auto arg : args) {
-			b = eval(arg, values);
+		for (int i = 0; i < args_size; i++) {
+			b = eval(args[i], values);
 			if (b != CONST_TRUE && b != CONST_FALSE)
 				a = 0;
 			if (b == CONST_FALSE)
@@ -343,8 +409,8 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 		return a;
 	case OpOr:
 		a = CONST_FALSE;
-		for (auto arg : args) {
-			b = eval(arg, values);
+		for (int i = 0; i < args_size; i++) {
+			b = eval(args[i], values);
 			if (b != CONST_TRUE && b != CONST_FALSE)
 				a = 0;
 			if (b == CONST_TRUE)
@@ -353,8 +419,8 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 		return a;
 	case OpXor:
 		a = CONST_FALSE;
-		for (auto arg : args) {
-			b = eval(arg, values);
+		for (int i = 0; i < args_size; i++) {
+			b = eval(args[i], values);
 			if (b != CONST_TRUE && b != CONST_FALSE)
 				return 0;
 			if (b == CONST_TRUE)
@@ -362,10 +428,10 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 		}
 		return a;
 	case OpIFF:
-		assert(args.size() > 0);
+		assert(args_size > 0);
 		a = eval(args[0], values);
-		for (auto arg : args) {
-			b = eval(arg, values);
+		for (int i = 0; i < args_size; i++) {
+			b = eval(args[i], values);
 			if (b != CONST_TRUE && b != CONST_FALSE)
 				return 0;
 			if (b != a)
@@ -373,7 +439,7 @@ int ezSAT::eval(int id, const std::vector<int> &values) const
 		}
 		return CONST_TRUE;
 	case OpITE:
-		assert(args.size() == 3);
+		assert(args_size == 3);
 		a = eval(args[0], values);
 		if (a == CONST_TRUE)
 			return eval(args[1], values);
@@ -404,6 +470,25 @@ bool ezSAT::eliminated(int)
 	return false;
 }
 
+void ezSAT::compact()
+{
+}
+
+int ezSAT::new_group()
+{
+	int group = frozen_literal();
+	activeGroups.insert(group);
+	return group;
+}
+
+void ezSAT::retire_group(int group)
+{
+	assert(activeGroups.count(group) != 0);
+	activeGroups.erase(group);
+	retiredGroupsCount++;
+	assume(NOT(group));
+}
+
 void ezSAT::assume(int id)
 {
 	addhash(__LINE__);
@@ -422,22 +507,23 @@ void ezSAT::assume(int id)
 
 			if (op == OpNot) {
 				int idx = bind(args[0]);
-				cnfClauses.push_back(std::vector<int>(1, -idx));
-				cnfClausesCount++;
+				add_clause_lit(-idx);
+				add_clause_end();
 				return;
 			}
 			if (op == OpOr) {
-				std::vector<int> clause;
-				for (int arg : args)
-					clause.push_back(bind(arg));
-				cnfClauses.push_back(clause);
-				cnfClausesCount++;
+				for (auto &arg : args)
+					arg = bind(arg);
+				for (auto arg : args)
+					add_clause_lit(arg);
+				add_clause_end();
 				return;
 			}
 			if (op == OpAnd) {
 				for (int arg : args) {
-					cnfClauses.push_back(std::vector<int>(1, bind(arg)));
-					cnfClausesCount++;
+					int idx = bind(arg);
+					add_clause_lit(idx);
+					add_clause_end();
 				}
 				return;
 			}
@@ -445,44 +531,44 @@ void ezSAT::assume(int id)
 	}
 
 	int idx = bind(id);
-	cnfClauses.push_back(std::vector<int>(1, idx));
-	cnfClausesCount++;
+	add_clause_lit(idx);
+	add_clause_end();
 }
 
 void ezSAT::add_clause(const std::vector<int> &args)
 {
 	addhash(__LINE__);
-	for (auto arg : args)
+	for (auto arg : args) {
 		addhash(arg);
-
-	cnfClauses.push_back(args);
-	cnfClausesCount++;
+		add_clause_lit(arg);
+	}
+	add_clause_end();
 }
 
 void ezSAT::add_clause(const std::vector<int> &args, bool argsPolarity, int a, int b, int c)
 {
-	std::vector<int> clause;
-	for (auto arg : args)
-		clause.push_back(argsPolarity ? +arg : -arg);
-	if (a != 0)
-		clause.push_back(a);
-	if (b != 0)
-		clause.push_back(b);
-	if (c != 0)
-		clause.push_back(c);
-	add_clause(clause);
+	addhash(__LINE__);
+	for (auto arg : args) {
+		addhash(argsPolarity ? +arg : -arg);
+		add_clause_lit(argsPolarity ? +arg : -arg);
+	}
+	for (auto arg : {a, b, c})
+		if (arg != 0) {
+			addhash(arg);
+			add_clause_lit(arg);
+		}
+	add_clause_end();
 }
 
 void ezSAT::add_clause(int a, int b, int c)
 {
-	std::vector<int> clause;
-	if (a != 0)
-		clause.push_back(a);
-	if (b != 0)
-		clause.push_back(b);
-	if (c != 0)
-		clause.push_back(c);
-	add_clause(clause);
+	addhash(__LINE__);
+	for (auto arg : {a, b, c})
+		if (arg != 0) {
+			addhash(arg);
+			add_clause_lit(arg);
+		}
+	add_clause_end();
 }
 
 int ezSAT::bind_cnf_not(const std::vector<int> &args)
@@ -649,7 +735,7 @@ void ezSAT::consumeCnf()
 	cnfClauses.clear();
 }
 
-void ezSAT::consumeCnf(std::vector<std::vector<int>> &cnf)
+void ezSAT::consumeCnf(std::vector<int> &cnf)
 {
 	if (mode_keep_cnf())
 		cnfClausesBackup.insert(cnfClausesBackup.end(), cnfClauses.begin(), cnfClauses.end());
@@ -662,8 +748,16 @@ void ezSAT::consumeCnf(std::vector<std::vector<int>> &cnf)
 void ezSAT::getFullCnf(std::vector<std::vector<int>> &full_cnf) const
 {
 	assert(full_cnf.empty());
-	full_cnf.insert(full_cnf.end(), cnfClausesBackup.begin(), cnfClausesBackup.end());
-	full_cnf.insert(full_cnf.end(), cnfClauses.begin(), cnfClauses.end());
+	for (auto buffer : {&cnfClausesBackup, &cnfClauses}) {
+		std::vector<int> clause;
+		for (auto lit : *buffer)
+			if (lit != 0)
+				clause.push_back(lit);
+			else {
+				full_cnf.push_back(clause);
+				clause.clear();
+			}
+	}
 }
 
 void ezSAT::preSolverCallback()
@@ -1250,7 +1344,8 @@ void ezSAT::printDIMACS(FILE *f, bool verbose) const
 		if (mode_keep_cnf()) {
 			fprintf(f, "c\n");
 			fprintf(f, "c %d clauses from backup, %d from current buffer\n",
-					int(cnfClausesBackup.size()), int(cnfClauses.size()));
+					int(std::count(cnfClausesBackup.begin(), cnfClausesBackup.end(), 0)),
+					int(std::count(cnfClauses.begin(), cnfClauses.end(), 0)));
 		}
 
 		fprintf(f, "c\n");
@@ -1276,10 +1371,10 @@ void ezSAT::printDIMACS(FILE *f, bool verbose) const
 	}
 }
 
-static std::string expression2str(const std::pair<ezSAT::OpId, std::vector<int>> &data)
+static std::string expression2str(ezSAT::OpId op, const int *args, int args_size)
 {
 	std::string text;
-	switch (data.first) {
+	switch (op) {
 #define X(op) case ezSAT::op: text += #op; break;
 		X(OpNot)
 		X(OpAnd)
@@ -1292,8 +1387,8 @@ static std::string expression2str(const std::pair<ezSAT::OpId, std::vector<int>>
 #undef X
 	}
 	text += ":";
-	for (auto it : data.second)
-		text += " " + my_int_to_string(it);
+	for (int i = 0; i < args_size; i++)
+		text += " " + my_int_to_string(args[i]);
 	return text;
 }
 
@@ -1309,13 +1404,13 @@ void ezSAT::printInternalState(FILE *f) const
 	for (int i = 0; i < int(literals.size()); i++)
 		fprintf(f, "    %d: `%s'\n", i+1, literals[i].c_str());
 
-	fprintf(f, "expressionsCache:\n");
-	for (auto &it : expressionsCache)
-		fprintf(f, "    `%s' -> %d\n", expression2str(it.first).c_str(), it.second);
-
 	fprintf(f, "expressions:\n");
-	for (int i = 0; i < int(expressions.size()); i++)
-		fprintf(f, "    %d: `%s'\n", -i-1, expression2str(expressions[i]).c_str());
+	for (int i = 0; i < int(expressions.size()); i++) {
+		OpId op;
+		int args_size;
+		const int *args = lookup_expression(-i-1, op, args_size);
+		fprintf(f, "    %d: `%s'\n", -i-1, expression2str(op, args, args_size).c_str());
+	}
 
 	fprintf(f, "cnfVariables (count=%d):\n", cnfVariableCount);
 	for (int i = 0; i < int(cnfLiteralVariables.size()); i++)
@@ -1326,11 +1421,11 @@ void ezSAT::printInternalState(FILE *f) const
 			fprintf(f, "    expression %d -> %d (%s)\n", -i-1, cnfExpressionVariables[i], to_string(-i-1).c_str());
 
 	fprintf(f, "cnfClauses:\n");
-	for (auto &i1 : cnfClauses) {
-		for (auto &i2 : i1)
-			fprintf(f, " %4d", i2);
-		fprintf(f, "\n");
-	}
+	for (auto lit : cnfClauses)
+		if (lit != 0)
+			fprintf(f, " %4d", lit);
+		else
+			fprintf(f, "\n");
 	if (cnfConsumed)
 		fprintf(f, " *** more clauses consumed via cnfConsume() ***\n");
 
@@ -20,8 +20,11 @@
 #ifndef EZSAT_H
 #define EZSAT_H
 
+#include <stdint.h>
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <functional>
 #include <vector>
 #include <string>
 #include <stdio.h>
@@ -54,16 +57,37 @@ private:
 
 	bool non_incremental_solve_used_up;
 
-	std::map<std::string, int> literalsCache;
+	std::unordered_map<std::string, int> literalsCache;
 	std::vector<std::string> literals;
 
-	std::map<std::pair<OpId, std::vector<int>>, int> expressionsCache;
-	std::vector<std::pair<OpId, std::vector<int>>> expressions;
+	// the arguments of all expressions are stored back to back in
+	// expressionArgs. expressionsTable is an open addressing hash table
+	// with the index+1 of the expressions (0 = empty slot) that is used
+	// to find existing expressions without creating temporary vectors.
+	struct expression_t {
+		OpId op;
+		int args_offset, args_size;
+		unsigned int hash;
+	};
+
+	std::vector<expression_t> expressions;
+	std::vector<int> expressionArgs, expressionArgsBuffer;
+	std::vector<int> expressionsTable;
 
+	static unsigned int expression_hash(OpId op, const int *args, int args_size);
+	int lookup_or_add_expression(OpId op, const int *args, int args_size);
+
+	// clauses are stored back to back, each one terminated by a zero
 	bool cnfConsumed;
 	int cnfVariableCount, cnfClausesCount;
 	std::vector<int> cnfLiteralVariables, cnfExpressionVariables;
-	std::vector<std::vector<int>> cnfClauses, cnfClausesBackup;
+	std::vector<int> cnfClauses, cnfClausesBackup;
+
+	std::set<int> activeGroups;
+	int retiredGroupsCount;
+
+	void add_clause_lit(int lit) { cnfClauses.push_back(lit); }
+	void add_clause_end() { cnfClauses.push_back(0); cnfClausesCount++; }
 
 	void add_clause(const std::vector<int> &args);
 	void add_clause(const std::vector<int> &args, bool argsPolarity, int a = 0, int b = 0, int c = 0);
@@ -77,9 +101,31 @@ protected:
 	void preSolverCallback();
 
 public:
+	// limits for one solver() call (0 = no limit), solverTimoutStatus
+	// is set when the solver stopped because one of them was reached
 	int solverTimeout;
+	int64_t solverConflictBudget, solverPropagationBudget;
 	bool solverTimoutStatus;
 
+	// polled by the solver backend during the search, returning true stops
+	// the search like a timeout (for example when another process found the
+	// answer already)
+	std::function<bool()> solverInterrupt;
+
+	// statistics for the last solver() call
+	int64_t solverConflicts, solverPropagations, solverDecisions;
+
+	// statistics over all solver() calls (set by the solver backend): the
+	// size of the solver instance after the last call and the largest size
+	// seen so far, without eliminated variables and removed clauses
+	int solverCalls, solverCompactions;
+	int solverVariables, solverClauses, solverLearnts;
+	int solverMaxVariables, solverMaxClauses, solverMaxLearnts;
+
+	// incremental solvers rebuild their solver instance from the live clauses
+	// after this many groups have been retired (0 = never)
+	int solverCompactionInterval;
+
 	ezSAT();
 	virtual ~ezSAT();
 
@@ -101,12 +147,13 @@ public:
 	int frozen_literal(const std::string &name);
 	int expression(OpId op, int a = 0, int b = 0, int c = 0, int d = 0, int e = 0, int f = 0);
 	int expression(OpId op, const std::vector<int> &args);
+	int expression(OpId op, const int *args, int args_size);
 
 	void lookup_literal(int id, std::string &name) const;
 	const std::string &lookup_literal(int id) const;
 
 	void lookup_expression(int id, OpId &op, std::vector<int> &args) const;
-	const std::vector<int> &lookup_expression(int id, OpId &op) const;
+	const int *lookup_expression(int id, OpId &op, int &args_size) const;
 
 	int parse_string(const std::string &text);
 	std::string to_string(int id) const;
@@ -153,15 +200,38 @@ public:
 		solverTimeout = newTimeoutSeconds;
 	}
 
+	void setSolverConflictBudget(int64_t newConflictBudget) {
+		solverConflictBudget = newConflictBudget;
+	}
+
+	void setSolverPropagationBudget(int64_t newPropagationBudget) {
+		solverPropagationBudget = newPropagationBudget;
+	}
+
 	bool getSolverTimoutStatus() {
 		return solverTimoutStatus;
 	}
 
+	void setSolverCompactionInterval(int newCompactionInterval) {
+		solverCompactionInterval = newCompactionInterval;
+	}
+
+	// clause groups: constraints added with assume(id, group) only hold while
+	// the group is active. the solver backend assumes all active groups in
+	// each solver() call, retire_group() disables a group for good so that
+	// its clauses are satisfied at level 0 and can be dropped by compact().
+
+	int new_group();
+	void retire_group(int group);
+	const std::set<int> &active_groups() const { return activeGroups; }
+	int numRetiredGroups() const { return retiredGroupsCount; }
+
 	// manage CNF (usually only accessed by SAT solvers)
 
 	virtual void clear();
 	virtual void freeze(int id);
 	virtual bool eliminated(int idx);
+	virtual void compact();
 	void assume(int id);
 	void assume(int id, int context_id) { assume(OR(id, NOT(context_id))); }
 	int bind(int id, bool auto_freeze = true);
@@ -169,10 +239,12 @@ public:
 
 	int numCnfVariables() const { return cnfVariableCount; }
 	int numCnfClauses() const { return cnfClausesCount; }
-	const std::vector<std::vector<int>> &cnf() const { return cnfClauses; }
+
+	// the clauses that have not been consumed yet, each one terminated by a zero
+	const std::vector<int> &cnf() const { return cnfClauses; }
 
 	void consumeCnf();
-	void consumeCnf(std::vector<std::vector<int>> &cnf);
+	void consumeCnf(std::vector<int> &cnf);
 
 	// use this function to get the full CNF in keep_cnf mode
 	void getFullCnf(std::vector<std::vector<int>> &full_cnf) const;
@@ -103,6 +103,8 @@ Solver::Solver() :
   , conflict_budget    (-1)
   , propagation_budget (-1)
   , asynch_interrupt   (false)
+  , termCallbackState  (NULL)
+  , termCallback       (NULL)
 {}
 
 
@@ -21,8 +21,10 @@
 #include "subcircuit.h"
 
 #include <algorithm>
+#include <bitset>
 #include <assert.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef _YOSYS_
@@ -290,10 +292,65 @@ class SubCircuit::SolverWorker
 
 	typedef std::vector<std::map<int, int>> adjMatrix_t;
 
+	static int lowestBit(uint64_t word)
+	{
+#ifdef __GNUC__
+		return __builtin_ctzll(word);
+#else
+		int idx = 0;
+		while ((word & 1) == 0)
+			word >>= 1, idx++;
+		return idx;
+#endif
+	}
+
+	// a dense set of haystack node indices, used for the rows of the
+	// enumeration matrix and for the haystack adjacency
+
+	struct BitRow {
+		std::vector<uint64_t> words;
+
+		void resize(int size) {
+			words.assign((size + 63) / 64, 0);
+		}
+		bool test(int idx) const {
+			return ((words[idx >> 6] >> (idx & 63)) & 1) != 0;
+		}
+		void set(int idx) {
+			words[idx >> 6] |= uint64_t(1) << (idx & 63);
+		}
+		void reset(int idx) {
+			words[idx >> 6] &= ~(uint64_t(1) << (idx & 63));
+		}
+		int count() const {
+			int n = 0;
+			for (uint64_t word : words)
+				n += std::bitset<64>(word).count();
+			return n;
+		}
+		// the smallest element >= idx, or -1
+		int next(int idx) const {
+			int w = idx >> 6;
+			if (w >= int(words.size()))
+				return -1;
+			uint64_t word = words[w] & (~uint64_t(0) << (idx & 63));
+			while (word == 0) {
+				if (++w >= int(words.size()))
+					return -1;
+				word = words[w];
+			}
+			return (w << 6) + lowestBit(word);
+		}
+		int first() const {
+			return next(0);
+		}
+	};
+
 	struct GraphData {
 		std::string graphId;
 		Graph graph;
 		adjMatrix_t adjMatrix;
+		std::vector<BitRow> adjBits;
 		std::vector<bool> usedNodes;
 	};
 
@@ -720,6 +777,10 @@ class SubCircuit::SolverWorker
 	DiCache diCache;
 	bool verbose;
 
+	// enumeration matrix entries removed by pruning and by the branches of
+	// ullmannRecursion(), so they can be restored when backtracking
+	std::vector<std::pair<int, int>> trail;
+
 	// main solver functions
 
 	bool matchNodePorts(const Graph &needle, int needleNodeIdx, const Graph &haystack, int haystackNodeIdx, const std::map<std::string, std::string> &swaps) const
@@ -848,7 +909,7 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void generateEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::map<std::string, std::set<std::string>> &initialMappings) const
+	void generateEnumerationMatrix(std::vector<BitRow> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, const std::map<std::string, std::set<std::string>> &initialMappings) const
 	{
 		std::map<std::string, std::set<int>> haystackNodesByTypeId;
 		for (int i = 0; i < int(haystack.graph.nodes.size()); i++)
@@ -859,6 +920,7 @@ class SubCircuit::SolverWorker
 		for (int i = 0; i < int(needle.graph.nodes.size()); i++)
 		{
 			const Graph::Node &nn = needle.graph.nodes[i];
+			enumerationMatrix[i].resize(haystack.graph.nodes.size());
 
 			for (int j : haystackNodesByTypeId[nn.typeId]) {
 				const Graph::Node &hn = haystack.graph.nodes[j];
@@ -866,7 +928,7 @@ class SubCircuit::SolverWorker
 					continue;
 				if (!matchNodes(needle, i, haystack, j))
 					continue;
-				enumerationMatrix[i].insert(j);
+				enumerationMatrix[i].set(j);
 			}
 
 			if (compatibleTypes.count(nn.typeId) > 0)
@@ -877,20 +939,25 @@ class SubCircuit::SolverWorker
 							continue;
 						if (!matchNodes(needle, i, haystack, j))
 							continue;
-						enumerationMatrix[i].insert(j);
+						enumerationMatrix[i].set(j);
 					}
 		}
 	}
 
-	bool checkEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack)
+	bool checkEnumerationMatrix(std::vector<BitRow> &enumerationMatrix, int i, int j, const GraphData &needle, const GraphData &haystack)
 	{
 		for (const auto &it_needle : needle.adjMatrix.at(i))
 		{
 			int needleNeighbour = it_needle.first;
 			int needleEdgeType = it_needle.second;
 
-			for (int haystackNeighbour : enumerationMatrix[needleNeighbour])
-				if (haystack.adjMatrix.at(j).count(haystackNeighbour) > 0) {
+			// only the candidates of the neighbour that are adjacent to j in the haystack
+			const std::vector<uint64_t> &candidateWords = enumerationMatrix[needleNeighbour].words;
+			const std::vector<uint64_t> &adjacentWords = haystack.adjBits[j].words;
+
+			for (int w = 0; w < int(candidateWords.size()); w++)
+				for (uint64_t word = candidateWords[w] & adjacentWords[w]; word != 0; word &= word - 1) {
+					int haystackNeighbour = (w << 6) + lowestBit(word);
 					int haystackEdgeType = haystack.adjMatrix.at(j).at(haystackNeighbour);
 					if (diCache.compare(needleEdgeType, haystackEdgeType, swapPorts, swapPermutations)) {
 						const Graph::Node &needleFromNode = needle.graph.nodes[i];
@@ -910,38 +977,57 @@ class SubCircuit::SolverWorker
 		return true;
 	}
 
-	bool pruneEnumerationMatrix(std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, int &nextRow, bool allowOverlap)
+	void removeCandidate(std::vector<BitRow> &enumerationMatrix, int i, int j)
+	{
+		enumerationMatrix[i].reset(j);
+		trail.push_back(std::pair<int, int>(i, j));
+	}
+
+	void undoTrail(std::vector<BitRow> &enumerationMatrix, size_t trailMark)
+	{
+		while (trail.size() > trailMark) {
+			enumerationMatrix[trail.back().first].set(trail.back().second);
+			trail.pop_back();
+		}
+	}
+
+	bool pruneEnumerationMatrix(std::vector<BitRow> &enumerationMatrix, const GraphData &needle, const GraphData &haystack, int &nextRow, bool allowOverlap)
 	{
+		std::vector<int> removed;
 		bool didSomething = true;
 		while (didSomething)
 		{
 			nextRow = -1;
 			didSomething = false;
 			for (int i = 0; i < int(enumerationMatrix.size()); i++) {
-				std::set<int> newRow;
-				for (int j : enumerationMatrix[i]) {
+				int newRowSize = 0;
+				removed.clear();
+				for (int j = enumerationMatrix[i].first(); j >= 0; j = enumerationMatrix[i].next(j+1)) {
 					if (!checkEnumerationMatrix(enumerationMatrix, i, j, needle, haystack))
-						didSomething = true;
+						removed.push_back(j);
 					else if (!allowOverlap && haystack.usedNodes[j])
-						didSomething = true;
+						removed.push_back(j);
 					else
-						newRow.insert(j);
+						newRowSize++;
 				}
-				if (newRow.size() == 0)
+				if (newRowSize == 0)
 					return false;
-				if (newRow.size() >= 2 && (nextRow < 0 || needle.adjMatrix.at(nextRow).size() < needle.adjMatrix.at(i).size()))
+				if (newRowSize >= 2 && (nextRow < 0 || needle.adjMatrix.at(nextRow).size() < needle.adjMatrix.at(i).size()))
 					nextRow = i;
-				enumerationMatrix[i].swap(newRow);
+				for (int j : removed)
+					removeCandidate(enumerationMatrix, i, j);
+				if (!removed.empty())
+					didSomething = true;
 			}
 		}
 		return true;
 	}
 
-	void printEnumerationMatrix(const std::vector<std::set<int>> &enumerationMatrix, int maxHaystackNodeIdx = -1) const
+	void printEnumerationMatrix(const std::vector<BitRow> &enumerationMatrix, int maxHaystackNodeIdx = -1) const
 	{
 		if (maxHaystackNodeIdx < 0) {
 			for (const auto &it : enumerationMatrix)
-				for (int idx : it)
+				for (int idx = it.first(); idx >= 0; idx = it.next(idx+1))
 					maxHaystackNodeIdx = std::max(maxHaystackNodeIdx, idx);
 		}
 
@@ -956,16 +1042,16 @@ class SubCircuit::SolverWorker
 			for (int j = 0; j < maxHaystackNodeIdx; j++) {
 				if (j % 5 == 0)
 					my_printf(" ");
-				my_printf("%c", enumerationMatrix[i].count(j) > 0 ? '*' : '.');
+				my_printf("%c", enumerationMatrix[i].test(j) ? '*' : '.');
 			}
 			my_printf("\n");
 		}
 	}
 
-	bool checkPortmapCandidate(const std::vector<std::set<int>> &enumerationMatrix, const GraphData &needle,  const GraphData &haystack, int idx, const std::map<std::string, std::string> &currentCandidate)
+	bool checkPortmapCandidate(const std::vector<BitRow> &enumerationMatrix, const GraphData &needle,  const GraphData &haystack, int idx, const std::map<std::string, std::string> &currentCandidate)
 	{
-		assert(enumerationMatrix[idx].size() == 1);
-		int idxHaystack = *enumerationMatrix[idx].begin();
+		assert(enumerationMatrix[idx].count() == 1);
+		int idxHaystack = enumerationMatrix[idx].first();
 
 		const Graph::Node &nn = needle.graph.nodes[idx];
 		const Graph::Node &hn = haystack.graph.nodes[idxHaystack];
@@ -979,8 +1065,8 @@ class SubCircuit::SolverWorker
 			int needleNeighbour = it_needle.first;
 			int needleEdgeType = it_needle.second;
 
-			assert(enumerationMatrix[needleNeighbour].size() == 1);
-			int haystackNeighbour = *enumerationMatrix[needleNeighbour].begin();
+			assert(enumerationMatrix[needleNeighbour].count() == 1);
+			int haystackNeighbour = enumerationMatrix[needleNeighbour].first();
 
 			assert(haystack.adjMatrix.at(idxHaystack).count(haystackNeighbour) > 0);
 			int haystackEdgeType = haystack.adjMatrix.at(idxHaystack).at(haystackNeighbour);
@@ -991,7 +1077,7 @@ class SubCircuit::SolverWorker
 		return true;
 	}
 
-	void generatePortmapCandidates(std::set<std::map<std::string, std::string>> &portmapCandidates, const std::vector<std::set<int>> &enumerationMatrix,
+	void generatePortmapCandidates(std::set<std::map<std::string, std::string>> &portmapCandidates, const std::vector<BitRow> &enumerationMatrix,
 			const GraphData &needle, const GraphData &haystack, int idx)
 	{
 		std::map<std::string, std::string> currentCandidate;
@@ -1041,7 +1127,7 @@ class SubCircuit::SolverWorker
 		}
 	}
 
-	bool prunePortmapCandidates(std::vector<std::set<std::map<std::string, std::string>>> &portmapCandidates, std::vector<std::set<int>> enumerationMatrix, const GraphData &needle, const GraphData &haystack)
+	bool prunePortmapCandidates(std::vector<std::set<std::map<std::string, std::string>>> &portmapCandidates, const std::vector<BitRow> &enumerationMatrix, const GraphData &needle, const GraphData &haystack)
 	{
 		bool didSomething = false;
 
@@ -1049,8 +1135,8 @@ class SubCircuit::SolverWorker
 
 		for (int i = 0; i < int(needle.graph.nodes.size()); i++)
 		{
-			assert(enumerationMatrix[i].size() == 1);
-			int j = *enumerationMatrix[i].begin();
+			assert(enumerationMatrix[i].count() == 1);
+			int j = enumerationMatrix[i].first();
 
 			std::set<std::map<std::string, std::string>> thisCandidates;
 			portmapCandidates[i].swap(thisCandidates);
@@ -1062,8 +1148,8 @@ class SubCircuit::SolverWorker
 					int needleNeighbour = it_needle.first;
 					int needleEdgeType = it_needle.second;
 
-					assert(enumerationMatrix[needleNeighbour].size() == 1);
-					int haystackNeighbour = *enumerationMatrix[needleNeighbour].begin();
+					assert(enumerationMatrix[needleNeighbour].count() == 1);
+					int haystackNeighbour = enumerationMatrix[needleNeighbour].first();
 
 					assert(haystack.adjMatrix.at(j).count(haystackNeighbour) > 0);
 					int haystackEdgeType = haystack.adjMatrix.at(j).at(haystackNeighbour);
@@ -1104,7 +1190,15 @@ class SubCircuit::SolverWorker
 		return false;
 	}
 
-	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<std::set<int>> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
+	// the enumeration matrix is restored to its original state before this returns
+	void ullmannRecursion(std::vector<Solver::Result> &results, std::vector<BitRow> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
+	{
+		size_t trailMark = trail.size();
+		ullmannRecursionWorker(results, enumerationMatrix, iter, needle, haystack, allowOverlap, limitResults);
+		undoTrail(enumerationMatrix, trailMark);
+	}
+
+	void ullmannRecursionWorker(std::vector<Solver::Result> &results, std::vector<BitRow> &enumerationMatrix, int iter, const GraphData &needle, GraphData &haystack, bool allowOverlap, int limitResults)
 	{
 		int i = -1;
 		if (!pruneEnumerationMatrix(enumerationMatrix, needle, haystack, i, allowOverlap))
@@ -1123,8 +1217,8 @@ class SubCircuit::SolverWorker
 				Solver::ResultNodeMapping mapping;
 				mapping.needleNodeId = needle.graph.nodes[j].nodeId;
 				mapping.needleUserData = needle.graph.nodes[j].userData;
-				mapping.haystackNodeId = haystack.graph.nodes[*enumerationMatrix[j].begin()].nodeId;
-				mapping.haystackUserData = haystack.graph.nodes[*enumerationMatrix[j].begin()].userData;
+				mapping.haystackNodeId = haystack.graph.nodes[enumerationMatrix[j].first()].nodeId;
+				mapping.haystackUserData = haystack.graph.nodes[enumerationMatrix[j].first()].userData;
 				generatePortmapCandidates(portmapCandidates[j], enumerationMatrix, needle, haystack, j);
 				result.mappings[needle.graph.nodes[j].nodeId] = mapping;
 			}
@@ -1166,8 +1260,8 @@ class SubCircuit::SolverWorker
 			}
 
 			for (int j = 0; j < int(enumerationMatrix.size()); j++)
-				if (!haystack.graph.nodes[*enumerationMatrix[j].begin()].shared)
-					haystack.usedNodes[*enumerationMatrix[j].begin()] = true;
+				if (!haystack.graph.nodes[enumerationMatrix[j].first()].shared)
+					haystack.usedNodes[enumerationMatrix[j].first()] = true;
 
 			if (verbose) {
 				my_printf("\nSolution:\n");
@@ -1184,10 +1278,9 @@ class SubCircuit::SolverWorker
 			printEnumerationMatrix(enumerationMatrix, haystack.graph.nodes.size());
 		}
 
-		std::set<int> activeRow;
-		enumerationMatrix[i].swap(activeRow);
+		BitRow activeRow = enumerationMatrix[i];
 
-		for (int j : activeRow)
+		for (int j = activeRow.first(); j >= 0; j = activeRow.next(j+1))
 		{
 			// found enough?
 			if (limitResults >= 0 && int(results.size()) >= limitResults)
@@ -1197,14 +1290,18 @@ class SubCircuit::SolverWorker
 			if (!allowOverlap && haystack.usedNodes[j])
 				continue;
 
-			// create enumeration matrix for child in recursion tree
-			std::vector<std::set<int>> nextEnumerationMatrix = enumerationMatrix;
-			for (int k = 0; k < int(nextEnumerationMatrix.size()); k++)
-				nextEnumerationMatrix[k].erase(j);
-			nextEnumerationMatrix[i].insert(j);
+			// narrow down the enumeration matrix for child in recursion tree
+			size_t trailMark = trail.size();
+			for (int k = 0; k < int(enumerationMatrix.size()); k++)
+				if (k != i && enumerationMatrix[k].test(j))
+					removeCandidate(enumerationMatrix, k, j);
+			for (int k = activeRow.first(); k >= 0; k = activeRow.next(k+1))
+				if (k != j)
+					removeCandidate(enumerationMatrix, i, k);
 
 			// recursion
-			ullmannRecursion(results, nextEnumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults);
+			ullmannRecursion(results, enumerationMatrix, iter+1, needle, haystack, allowOverlap, limitResults);
+			undoTrail(enumerationMatrix, trailMark);
 
 			// we just have found something -> unroll to top recursion level
 			if (!allowOverlap && haystack.usedNodes[j] && iter > 0)
@@ -1269,7 +1366,7 @@ class SubCircuit::SolverWorker
 		{
 			GraphData &haystack = it.second;
 
-			std::vector<std::set<int>> enumerationMatrix;
+			std::vector<BitRow> enumerationMatrix;
 			std::map<std::string, std::set<std::string>> initialMappings;
 			generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
 
@@ -1488,6 +1585,13 @@ protected:
 		gd.graphId = graphId;
 		gd.graph = graph;
 		diCache.add(gd.graph, gd.adjMatrix, graphId, userSolver);
+
+		gd.adjBits.resize(gd.adjMatrix.size());
+		for (int i = 0; i < int(gd.adjMatrix.size()); i++) {
+			gd.adjBits[i].resize(gd.adjMatrix.size());
+			for (const auto &it : gd.adjMatrix[i])
+				gd.adjBits[i].set(it.first);
+		}
 	}
 
 	void addCompatibleTypes(std::string needleTypeId, std::string haystackTypeId)
@@ -1521,7 +1625,7 @@ protected:
 		const GraphData &needle = graphData[needleGraphId];
 		GraphData &haystack = graphData[haystackGraphId];
 
-		std::vector<std::set<int>> enumerationMatrix;
+		std::vector<BitRow> enumerationMatrix;
 		generateEnumerationMatrix(enumerationMatrix, needle, haystack, initialMappings);
 
 		if (verbose)
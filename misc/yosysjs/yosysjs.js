@@ -232,10 +232,18 @@ var YosysJS = new function() {
 		ys.callback_cache[0] = on_ready;
 		on_ready = null;
 
+		ys.chunk_callback_cache = {};
+
 		ys.worker.onmessage = function(e) {
 			var response = e.data[0];
+			if (response.partial) {
+				var chunk_callback = ys.chunk_callback_cache[response.idx];
+				if (chunk_callback) chunk_callback.apply(null, response.args);
+				return;
+			}
 			var callback = ys.callback_cache[response.idx];
 			delete ys.callback_cache[response.idx];
+			delete ys.chunk_callback_cache[response.idx];
 			if ("errmsg" in response) ys.errmsg = response.errmsg;
 			if (callback) callback.apply(null, response.args);
 		}
@@ -262,6 +270,24 @@ var YosysJS = new function() {
 			ys.worker.postMessage([request]);
 		}
 
+		// on_chunk is called with an Uint8Array for each part of the file and
+		// callback with the total size. With remove set the file is deleted
+		// in the worker after it has been sent. Use a TextDecoder with
+		// {stream: true} to turn the chunks of a text file into strings.
+		ys.read_file_stream = function(filename, on_chunk, callback, remove, chunk_size) {
+			var request = {
+				"idx": ys.callback_idx,
+				"mode": "read_file_stream",
+				"filename": filename,
+				"remove": remove ? true : false,
+				"chunk_size": chunk_size
+			};
+
+			ys.chunk_callback_cache[ys.callback_idx] = on_chunk;
+			ys.callback_cache[ys.callback_idx++] = callback;
+			ys.worker.postMessage([request]);
+		}
+
 		ys.write_file = function(filename, text, callback) {
 			var request = {
 				"idx": ys.callback_idx,
@@ -33,6 +33,31 @@ onmessage = function(e) {
 		} catch (e) { }
 	}
 
+	// send the file in chunks of raw bytes, each chunk is transferred to
+	// the page without a copy and the file is removed afterwards if asked
+	// to, so that a large output never exists as one string
+	if (request.mode == "read_file_stream") {
+		var chunk_size = request.chunk_size || 1024*1024;
+		var total_size = 0;
+		try {
+			var stream = FS.open(request.filename, 'r');
+			while (true) {
+				var chunk = new Uint8Array(chunk_size);
+				var n = FS.read(stream, chunk, 0, chunk_size);
+				if (n == 0)
+					break;
+				if (n < chunk_size)
+					chunk = chunk.slice(0, n);
+				total_size += n;
+				postMessage([{ "idx": request.idx, "partial": true, "args": [chunk] }], [chunk.buffer]);
+			}
+			FS.close(stream);
+			if (request.remove)
+				FS.unlink(request.filename);
+		} catch (e) { }
+		response.args.push(total_size);
+	}
+
 	if (request.mode == "write_file") {
 		try {
 			FS.writeFile(request.filename, request.text, {encoding: 'utf8'});
@@ -25,8 +25,187 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+struct CheckDriver
+{
+	int bit;
+	RTLIL::Cell *cell;
+	RTLIL::IdString port;
+	RTLIL::Wire *wire;
+	int offset;
+};
+
+// All signal bits of a module are numbered densely: every wire gets a base
+// offset and every wire bit is mapped once to the number of its SigMap
+// representative, so the driver/user bookkeeping below is done in plain
+// vectors instead of hash tables keyed by SigBit.
+struct CheckWorker
+{
+	RTLIL::Module *module;
+	bool noinit;
+
+	SigMap sigmap;
+	dict<RTLIL::Wire*, int> wire_base;
+	std::vector<int> canon;
+	std::vector<RTLIL::SigBit> canon_bits;
+
+	CheckWorker(RTLIL::Module *module, bool noinit) : module(module), noinit(noinit), sigmap(module)
+	{
+		int num_bits = 0;
+		for (auto wire : module->wires()) {
+			wire_base[wire] = num_bits;
+			num_bits += wire->width;
+		}
+
+		canon.resize(num_bits, -1);
+		canon_bits.resize(num_bits);
+		for (auto &it : wire_base)
+			for (int i = 0; i < it.first->width; i++) {
+				RTLIL::SigBit bit = sigmap(RTLIL::SigBit(it.first, i));
+				canon_bits[it.second + i] = RTLIL::SigBit(it.first, i);
+				if (bit.wire)
+					canon[it.second + i] = wire_base.at(bit.wire) + bit.offset;
+			}
+	}
+
+	// dense indices of the bits in sig, -1 for constant bits
+	void indices(const RTLIL::SigSpec &sig, std::vector<int> &result)
+	{
+		result.clear();
+		for (auto &chunk : sig.chunks()) {
+			if (chunk.wire == nullptr) {
+				result.insert(result.end(), chunk.width, -1);
+				continue;
+			}
+			int base = wire_base.at(chunk.wire) + chunk.offset;
+			for (int i = 0; i < chunk.width; i++)
+				result.push_back(canon[base + i]);
+		}
+	}
+
+	std::vector<RTLIL::Cell*> cells;
+
+	std::string node_name(int node)
+	{
+		if (node < GetSize(canon))
+			return stringf("wire %s", log_signal(canon_bits[node]));
+		RTLIL::Cell *cell = cells.at(node - GetSize(canon));
+		return stringf("cell %s (%s)", log_id(cell), log_id(cell->type));
+	}
+
+	int run()
+	{
+		int counter = 0;
+		int num_bits = GetSize(canon);
+
+		std::vector<CheckDriver> drivers;
+		std::vector<int> drivers_count(num_bits);
+		std::vector<bool> driven(num_bits), used(num_bits);
+		std::vector<int> sig;
+		SccGraph graph;
+		graph.resize(num_bits + GetSize(module->cells_));
+
+		for (auto cell : module->cells())
+		{
+			bool logic_cell = yosys_get_celltypes().cell_evaluable(cell->type);
+			int cell_node = num_bits + GetSize(cells);
+			cells.push_back(cell);
+
+			for (auto &conn : cell->connections()) {
+				bool is_input = cell->input(conn.first);
+				bool is_output = cell->output(conn.first);
+				indices(conn.second, sig);
+				if (is_input)
+					for (int bit : sig)
+						if (bit >= 0) {
+							if (logic_cell)
+								graph.add_edge(bit, cell_node);
+							used[bit] = true;
+						}
+				if (is_output)
+					for (int i = 0; i < GetSize(sig); i++)
+						if (sig[i] >= 0) {
+							if (logic_cell)
+								graph.add_edge(cell_node, sig[i]);
+							drivers.push_back(CheckDriver{sig[i], cell, conn.first, nullptr, i});
+							driven[sig[i]] = true;
+							if (!is_input)
+								drivers_count[sig[i]]++;
+						}
+			}
+		}
+
+		for (auto wire : module->wires()) {
+			if (wire->port_input || wire->port_output) {
+				indices(wire, sig);
+				for (int i = 0; i < GetSize(sig); i++) {
+					if (sig[i] < 0)
+						continue;
+					if (wire->port_input) {
+						drivers.push_back(CheckDriver{sig[i], nullptr, RTLIL::IdString(), wire, i});
+						driven[sig[i]] = true;
+					}
+					if (wire->port_output)
+						used[sig[i]] = true;
+					if (wire->port_input && !wire->port_output)
+						drivers_count[sig[i]]++;
+				}
+			}
+			if (noinit && wire->attributes.count("\\init")) {
+				log_warning("Wire %s.%s has an unprocessed 'init' attribute.\n", log_id(module), log_id(wire));
+				counter++;
+			}
+		}
+
+		std::map<int, std::vector<std::string>> conflicts;
+		for (auto &drv : drivers)
+			if (drivers_count[drv.bit] > 1) {
+				if (drv.cell)
+					conflicts[drv.bit].push_back(stringf("port %s[%d] of cell %s (%s)",
+							log_id(drv.port), drv.offset, log_id(drv.cell), log_id(drv.cell->type)));
+				else
+					conflicts[drv.bit].push_back(stringf("module input %s[%d]", log_id(drv.wire), drv.offset));
+			}
+
+		for (auto &it : conflicts) {
+			string message = stringf("multiple conflicting drivers for %s.%s:\n", log_id(module), log_signal(canon_bits[it.first]));
+			for (auto &str : it.second)
+				message += stringf("    %s\n", str.c_str());
+			log_warning("%s", message.c_str());
+			counter++;
+		}
+
+		for (int bit = 0; bit < num_bits; bit++)
+			if (used[bit] && !driven[bit]) {
+				log_warning("Wire %s.%s is used but has no driver.\n", log_id(module), log_signal(canon_bits[bit]));
+				counter++;
+			}
+
+		// each strongly connected component is reported as one loop. the nodes
+		// are named only for the loops that were found, in the same order as
+		// they would be reported when sorting the names directly.
+		std::set<std::set<std::string>> loops;
+		for (auto &loop : graph.find_sccs(false)) {
+			std::set<std::string> names;
+			for (int node : loop)
+				names.insert(node_name(node));
+			loops.insert(names);
+		}
+
+		for (auto &loop : loops) {
+			string message = stringf("found logic loop in module %s:\n", log_id(module));
+			for (auto &str : loop)
+				message += stringf("    %s\n", str.c_str());
+			log_warning("%s", message.c_str());
+			counter++;
+		}
+
+		return counter;
+	}
+};
+
 struct CheckPass : public Pass {
 	CheckPass() : Pass("check", "check for obvious problems in the design") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -70,87 +249,26 @@ struct CheckPass : public Pass {
 
 		log_header("Executing CHECK pass (checking for obvious problems).\n");
 
-		for (auto module : design->selected_whole_modules_warn())
+		// make sure the worker processes don't each set up the cell library
+		yosys_get_celltypes();
+
+		// the modules are checked in parallel (see -j), each job reports its
+		// number of problems as one line of the output stream
+		std::stringstream counts;
+		run_module_dump_jobs(design->selected_whole_modules_warn(), counts, [&](std::ostream &f, RTLIL::Module *module)
 		{
 			if (module->has_processes_warn())
-				continue;
+				return;
 
 			log("checking module %s..\n", log_id(module));
 
-			SigMap sigmap(module);
-			dict<SigBit, vector<string>> wire_drivers;
-			dict<SigBit, int> wire_drivers_count;
-			pool<SigBit> used_wires;
-			TopoSort<string> topo;
+			CheckWorker worker(module, noinit);
+			f << worker.run() << "\n";
+		});
 
-			for (auto cell : module->cells())
-			for (auto &conn : cell->connections()) {
-				SigSpec sig = sigmap(conn.second);
-				bool logic_cell = yosys_celltypes.cell_evaluable(cell->type);
-				if (cell->input(conn.first))
-					for (auto bit : sig)
-						if (bit.wire) {
-							if (logic_cell)
-								topo.edge(stringf("wire %s", log_signal(bit)),
-										stringf("cell %s (%s)", log_id(cell), log_id(cell->type)));
-							used_wires.insert(bit);
-						}
-				if (cell->output(conn.first))
-					for (int i = 0; i < GetSize(sig); i++) {
-						if (logic_cell)
-							topo.edge(stringf("cell %s (%s)", log_id(cell), log_id(cell->type)),
-									stringf("wire %s", log_signal(sig[i])));
-						if (sig[i].wire)
-							wire_drivers[sig[i]].push_back(stringf("port %s[%d] of cell %s (%s)",
-									log_id(conn.first), i, log_id(cell), log_id(cell->type)));
-					}
-				if (!cell->input(conn.first) && cell->output(conn.first))
-					for (auto bit : sig)
-						if (bit.wire) wire_drivers_count[bit]++;
-			}
-
-			for (auto wire : module->wires()) {
-				if (wire->port_input) {
-					SigSpec sig = sigmap(wire);
-					for (int i = 0; i < GetSize(sig); i++)
-						wire_drivers[sig[i]].push_back(stringf("module input %s[%d]", log_id(wire), i));
-				}
-				if (wire->port_output)
-					for (auto bit : sigmap(wire))
-						if (bit.wire) used_wires.insert(bit);
-				if (wire->port_input && !wire->port_output)
-					for (auto bit : sigmap(wire))
-						if (bit.wire) wire_drivers_count[bit]++;
-				if (noinit && wire->attributes.count("\\init")) {
-					log_warning("Wire %s.%s has an unprocessed 'init' attribute.\n", log_id(module), log_id(wire));
-					counter++;
-				}
-			}
-
-			for (auto it : wire_drivers)
-				if (wire_drivers_count[it.first] > 1) {
-					string message = stringf("multiple conflicting drivers for %s.%s:\n", log_id(module), log_signal(it.first));
-					for (auto str : it.second)
-						message += stringf("    %s\n", str.c_str());
-					log_warning("%s", message.c_str());
-					counter++;
-				}
-
-			for (auto bit : used_wires)
-				if (!wire_drivers.count(bit)) {
-					log_warning("Wire %s.%s is used but has no driver.\n", log_id(module), log_signal(bit));
-					counter++;
-				}
-
-			topo.sort();
-			for (auto &loop : topo.loops) {
-				string message = stringf("found logic loop in module %s:\n", log_id(module));
-				for (auto &str : loop)
-					message += stringf("    %s\n", str.c_str());
-				log_warning("%s", message.c_str());
-				counter++;
-			}
-		}
+		int module_counter;
+		while (counts >> module_counter)
+			counter += module_counter;
 
 		log("found and reported %d problems.\n", counter);
 
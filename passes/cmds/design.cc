@@ -29,6 +29,7 @@ std::vector<RTLIL::Design*> pushed_designs;
 
 struct DesignPass : public Pass {
 	DesignPass() : Pass("design", "save, restore and reset current design") { }
+	virtual bool read_only() { return true; }
 	virtual ~DesignPass() {
 		for (auto &it : saved_designs)
 			delete it.second;
@@ -82,6 +83,10 @@ struct DesignPass : public Pass {
 		log("\n");
 		log("Copy modules from the current design into the specified one.\n");
 		log("\n");
+		log("\n");
+		log("Saved designs share unmodified modules with the current design. A module is\n");
+		log("only copied when a command that might modify it is executed.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
@@ -194,8 +199,16 @@ struct DesignPass : public Pass {
 			{
 				std::string trg_name = as_name.empty() ? mod->name.str() : RTLIL::escape_id(as_name);
 
-				if (copy_to_design->modules_.count(trg_name))
-					delete copy_to_design->modules_.at(trg_name);
+				if (copy_to_design->modules_.count(trg_name)) {
+					copy_to_design->release_module(copy_to_design->modules_.at(trg_name));
+					copy_to_design->modules_.erase(trg_name);
+				}
+
+				if (RTLIL::IdString(trg_name) == mod->name) {
+					copy_to_design->add_shared(mod, copy_to_design == design);
+					continue;
+				}
+
 				copy_to_design->modules_[trg_name] = mod->clone();
 				copy_to_design->modules_[trg_name]->name = trg_name;
 				copy_to_design->modules_[trg_name]->design = copy_to_design;
@@ -206,8 +219,9 @@ struct DesignPass : public Pass {
 		{
 			RTLIL::Design *design_copy = new RTLIL::Design;
 
+			// modules are only copied when they are modified, see Design::unshare_modules()
 			for (auto &it : design->modules_)
-				design_copy->add(it.second->clone());
+				design_copy->add_shared(it.second);
 
 			design_copy->selection_stack = design->selection_stack;
 			design_copy->selection_vars = design->selection_vars;
@@ -225,7 +239,7 @@ struct DesignPass : public Pass {
 		if (reset_mode || !load_name.empty() || push_mode || pop_mode)
 		{
 			for (auto &it : design->modules_)
-				delete it.second;
+				design->release_module(it.second);
 			design->modules_.clear();
 
 			design->selection_stack.clear();
@@ -239,15 +253,17 @@ struct DesignPass : public Pass {
 		{
 			RTLIL::Design *saved_design = pop_mode ? pushed_designs.back() : saved_designs.at(load_name);
 
-			if (pop_mode)
-				pushed_designs.pop_back();
-
 			for (auto &it : saved_design->modules_)
-				design->add(it.second->clone());
+				design->add_shared(it.second, true);
 
 			design->selection_stack = saved_design->selection_stack;
 			design->selection_vars = saved_design->selection_vars;
 			design->selected_active_module = saved_design->selected_active_module;
+
+			if (pop_mode) {
+				pushed_designs.pop_back();
+				delete saved_design;
+			}
 		}
 	}
 } DesignPass;
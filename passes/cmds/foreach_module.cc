@@ -0,0 +1,312 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include <fstream>
+#include <errno.h>
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ForeachModuleJob
+{
+	RTLIL::Module *module;
+	std::string in_file, out_file, log_file;
+	pool<RTLIL::IdString> stubs;
+};
+
+// a design with a copy of the module and a port-only blackbox for each module
+// that it instantiates
+static RTLIL::Design *make_job_design(RTLIL::Design *design, RTLIL::Module *module, pool<RTLIL::IdString> &stubs)
+{
+	RTLIL::Design *job_design = new RTLIL::Design;
+	job_design->add(module->clone());
+
+	for (auto cell : module->cells())
+	{
+		RTLIL::Module *mod = design->module(cell->type);
+		if (mod == nullptr || stubs.count(cell->type) || cell->type == module->name)
+			continue;
+
+		RTLIL::Module *stub = job_design->addModule(mod->name);
+		stub->attributes = mod->attributes;
+		stub->set_bool_attribute("\\blackbox");
+		stub->avail_parameters = mod->avail_parameters;
+		for (auto wire : mod->wires())
+			if (wire->port_id > 0) {
+				RTLIL::Wire *w = stub->addWire(wire->name, wire);
+				w->attributes = wire->attributes;
+			}
+		stub->fixup_ports();
+		stubs.insert(mod->name);
+	}
+
+	return job_design;
+}
+
+// runs the commands with at most num_jobs of them at the same time and
+// returns their exit codes
+static std::vector<int> run_commands(const std::vector<std::string> &commands, int num_jobs)
+{
+	std::vector<int> results(GetSize(commands), -1);
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	dict<pid_t, int> running;
+	int next = 0;
+
+	log_flush();
+	fflush(NULL);
+
+	while (next < GetSize(commands) || !running.empty())
+	{
+		while (next < GetSize(commands) && GetSize(running) < num_jobs)
+		{
+			pid_t pid = fork();
+			if (pid < 0)
+				log_error("Failed to fork worker process: %s\n", strerror(errno));
+			if (pid == 0) {
+				execl("/bin/sh", "sh", "-c", commands[next].c_str(), (char*)NULL);
+				_exit(127);
+			}
+			running[pid] = next++;
+		}
+
+		int status = 0;
+		pid_t pid = waitpid(-1, &status, 0);
+		if (pid < 0) {
+			if (errno == EINTR)
+				continue;
+			log_error("Failed to wait for worker process: %s\n", strerror(errno));
+		}
+		if (running.count(pid) == 0)
+			continue;
+		results[running.at(pid)] = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+		running.erase(pid);
+	}
+#else
+	(void)num_jobs;
+	for (int i = 0; i < GetSize(commands); i++)
+		results[i] = run_command(commands[i]);
+#endif
+
+	return results;
+}
+
+struct ForeachModulePass : public Pass {
+	ForeachModulePass() : Pass("foreach_module", "run a script on each module in worker processes") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    foreach_module [options] -script <filename> [selection]\n");
+		log("\n");
+		log("This command runs a yosys script on each of the selected modules in a separate\n");
+		log("yosys process. Each module is written to a binary RTLIL file, together with a\n");
+		log("port-only blackbox for each module it instantiates. The worker process reads\n");
+		log("this file, runs the script on it and writes the result back. The resulting\n");
+		log("module then replaces the original module. Modules created by the script are\n");
+		log("added to the design unless a module of the same name already exists.\n");
+		log("\n");
+		log("A module whose worker process fails is left unchanged and a warning is printed\n");
+		log("instead of an error, so that the other modules are still processed.\n");
+		log("\n");
+		log("    -script <filename>\n");
+		log("        the script to run on each module\n");
+		log("\n");
+		log("    -jobs <N>\n");
+		log("        run up to N worker processes at the same time. The default is the\n");
+		log("        number of jobs given with 'yosys -j', or 1.\n");
+		log("\n");
+		log("    -launcher <command>\n");
+		log("        a command that is prepended to the command line of each worker, for\n");
+		log("        example 'ssh host' or 'srun -n1'. The script, the yosys executable\n");
+		log("        and the working directory must then be accessible from the hosts\n");
+		log("        that run the workers.\n");
+		log("\n");
+		log("    -yosys <command>\n");
+		log("        the yosys executable used for the workers. The default is the yosys\n");
+		log("        executable that runs this command.\n");
+		log("\n");
+		log("    -workdir <dir>\n");
+		log("        create the directory for the intermediate files in <dir> instead of\n");
+		log("        /tmp. This is needed when the workers run on other hosts.\n");
+		log("\n");
+		log("    -nocleanup\n");
+		log("        do not delete the directory for the intermediate files\n");
+		log("\n");
+		log("    -strict\n");
+		log("        abort with an error when a worker fails\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		std::string script_file, launcher, yosys_exe, workdir = "/tmp";
+		int num_jobs = std::max(yosys_jobs, 1);
+		bool cleanup = true, strict = false;
+
+		log_header("Executing FOREACH_MODULE pass (running a script on each module).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-script" && argidx+1 < args.size()) {
+				script_file = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-jobs" && argidx+1 < args.size()) {
+				num_jobs = std::max(atoi(args[++argidx].c_str()), 1);
+				continue;
+			}
+			if (args[argidx] == "-launcher" && argidx+1 < args.size()) {
+				launcher = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-yosys" && argidx+1 < args.size()) {
+				yosys_exe = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-workdir" && argidx+1 < args.size()) {
+				workdir = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-nocleanup") {
+				cleanup = false;
+				continue;
+			}
+			if (args[argidx] == "-strict") {
+				strict = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (script_file.empty())
+			log_cmd_error("Missing -script option.\n");
+		if (!check_file_exists(script_file))
+			log_cmd_error("Can't open script file `%s'.\n", script_file.c_str());
+
+		if (yosys_exe.empty()) {
+			yosys_exe = proc_self_dirname() + "yosys";
+#ifdef _WIN32
+			yosys_exe += ".exe";
+#endif
+		}
+
+		std::vector<ForeachModuleJob> jobs;
+		for (auto module : design->selected_whole_modules_warn()) {
+			if (module->get_bool_attribute("\\blackbox"))
+				continue;
+			jobs.push_back(ForeachModuleJob());
+			jobs.back().module = module;
+		}
+
+		if (jobs.empty()) {
+			log("No modules selected.\n");
+			return;
+		}
+
+		std::string tempdir_name = make_temp_dir(workdir + "/yosys-foreach-XXXXXX");
+		std::vector<std::string> commands;
+
+		for (int idx = 0; idx < GetSize(jobs); idx++)
+		{
+			auto &job = jobs[idx];
+			job.in_file = stringf("%s/module_%d.rtlb", tempdir_name.c_str(), idx);
+			job.out_file = stringf("%s/result_%d.rtlb", tempdir_name.c_str(), idx);
+			job.log_file = stringf("%s/module_%d.log", tempdir_name.c_str(), idx);
+
+			RTLIL::Design *job_design = make_job_design(design, job.module, job.stubs);
+			Pass::call(job_design, std::vector<std::string>{"write_rtlil_bin", job.in_file});
+			delete job_design;
+
+			std::string worker_script = stringf("read_rtlil_bin %s; script %s; write_rtlil_bin %s",
+					job.in_file.c_str(), script_file.c_str(), job.out_file.c_str());
+			std::string command = stringf("%s -q -l %s -p '%s' > /dev/null 2>&1", yosys_exe.c_str(), job.log_file.c_str(), worker_script.c_str());
+			if (!launcher.empty())
+				command = launcher + " " + command;
+
+			log("Worker command for module %s: %s\n", log_id(job.module), command.c_str());
+			commands.push_back(command);
+		}
+
+		log("Running %d worker processes with up to %d at a time.\n", GetSize(commands), num_jobs);
+		std::vector<int> results = run_commands(commands, num_jobs);
+
+		int failed_count = 0;
+		for (int idx = 0; idx < GetSize(jobs); idx++)
+		{
+			auto &job = jobs[idx];
+			RTLIL::IdString name = job.module->name;
+
+			log("\nResults of the worker process for module %s:\n", log_id(name));
+			std::ifstream lf(job.log_file.c_str());
+			std::string line;
+			while (std::getline(lf, line))
+				log("  %s\n", line.c_str());
+
+			RTLIL::Design *result_design = nullptr;
+			if (results[idx] == 0 && check_file_exists(job.out_file)) {
+				result_design = new RTLIL::Design;
+				Pass::call(result_design, std::vector<std::string>{"read_rtlil_bin", job.out_file});
+			}
+
+			if (result_design == nullptr || result_design->module(name) == nullptr) {
+				delete result_design;
+				failed_count++;
+				if (strict) {
+					if (cleanup)
+						remove_directory(tempdir_name);
+					log_error("Worker process for module %s failed (exit code %d).\n", log_id(name), results[idx]);
+				}
+				log_warning("Worker process for module %s failed (exit code %d), keeping the original module.\n", log_id(name), results[idx]);
+				continue;
+			}
+
+			design->remove(job.module);
+			design->add(result_design->module(name)->clone());
+
+			for (auto mod : result_design->modules()) {
+				if (mod->name == name || job.stubs.count(mod->name))
+					continue;
+				if (design->module(mod->name) != nullptr) {
+					log_warning("Module %s created by the worker for module %s already exists, ignoring it.\n", log_id(mod), log_id(name));
+					continue;
+				}
+				log("Adding module %s created by the worker.\n", log_id(mod));
+				design->add(mod->clone());
+			}
+
+			delete result_design;
+		}
+
+		if (cleanup)
+			remove_directory(tempdir_name);
+		else
+			log("Intermediate files are in %s.\n", tempdir_name.c_str());
+
+		log("\nReplaced %d modules, %d worker processes failed.\n", GetSize(jobs) - failed_count, failed_count);
+	}
+} ForeachModulePass;
+
+PRIVATE_NAMESPACE_END
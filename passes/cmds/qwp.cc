@@ -209,11 +209,11 @@ struct QwpWorker
 		// AA = A' * A
 		// Ay = A' * y
 		//
-		// M := [AA Ay]
-
-		// Row major order
-		int N = GetSize(nodes), N1 = N+1;
-		vector<double> M(N * N1);
+		// AA is a (weighted) graph laplacian plus a diagonal matrix, so it is
+		// stored in sparse form as its diagonal and per-row off-diagonal entries.
+		int N = GetSize(nodes);
+		vector<double> diag(N), Ay(N);
+		vector<vector<pair<int, double>>> offdiag(N);
 
 		// Edge constraints:
 		//   A[i,:] := [ 0 0 .... 0 weight 0 ... 0 -weight 0 ... 0 0], y[i] := 0
@@ -225,11 +225,11 @@ struct QwpWorker
 			int idx2 = edge.first.second;
 			double weight = edge.second * (1.0 + xorshift32() * 1e-3);
 
-			M[idx1 + idx1*N1] += weight * weight;
-			M[idx2 + idx2*N1] += weight * weight;
+			diag[idx1] += weight * weight;
+			diag[idx2] += weight * weight;
 
-			M[idx1 + idx2*N1] += -weight * weight;
-			M[idx2 + idx1*N1] += -weight * weight;
+			offdiag[idx1].push_back(pair<int, double>(idx2, -weight * weight));
+			offdiag[idx2].push_back(pair<int, double>(idx1, -weight * weight));
 		}
 
 		// Node constraints:
@@ -250,94 +250,96 @@ struct QwpWorker
 				weight = 1e3;
 			weight *= (1.0 + xorshift32() * 1e-3);
 
-			M[idx + idx*N1] += weight * weight;
-			M[N + idx*N1] += rhs * weight * weight;
+			diag[idx] += weight * weight;
+			Ay[idx] += rhs * weight * weight;
 		}
 
 #ifdef LOG_MATRICES
 		log("\n");
 		for (int i = 0; i < N; i++) {
-			for (int j = 0; j < N+1; j++)
-				log(" %10.2e", M[(N+1)*i + j]);
-			log("\n");
+			log(" %10.2e |", diag[i]);
+			for (auto &it : offdiag[i])
+				log(" %d:%.2e", it.first, it.second);
+			log(" | %10.2e\n", Ay[i]);
 		}
 #endif
 
 		// Solve "AA*x = Ay"
 		// (least squares fit for "A*x = y")
 		//
-		// Using gaussian elimination to get M := [Id x]
-
-		vector<int> pivot_cache;
-		vector<int> queue;
-
-		for (int i = 0; i < N; i++)
-			queue.push_back(i);
-
-		// gaussian elimination
-		for (int i = 0; i < N; i++)
-		{
-			// find best row
-			int best_row = queue.front();
-			int best_row_queue_idx = 0;
-			double best_row_absval = 0;
-
-			for (int k = 0; k < GetSize(queue); k++) {
-				int row = queue[k];
-				double absval = fabs(M[i + row*N1]);
-				if (absval > best_row_absval) {
-					best_row = row;
-					best_row_queue_idx = k;
-					best_row_absval = absval;
-				}
+		// Using conjugate gradients with a diagonal preconditioner, starting
+		// from the current node positions. AA is symmetric positive definite.
+
+		auto multiply = [&](const vector<double> &v, vector<double> &result) {
+			for (int i = 0; i < N; i++) {
+				double sum = diag[i] * v[i];
+				for (auto &it : offdiag[i])
+					sum += it.second * v[it.first];
+				result[i] = sum;
 			}
+		};
 
-			int row = best_row;
-			pivot_cache.push_back(row);
+		vector<double> x(N), res(N), z(N), p(N), q(N);
+		double rhs_norm = 0;
 
-			queue[best_row_queue_idx] = queue.back();
-			queue.pop_back();
+		for (int i = 0; i < N; i++) {
+			x[i] = alt_mode ? nodes[i].alt_pos : nodes[i].pos;
+			rhs_norm += Ay[i] * Ay[i];
+		}
 
-			// normalize row
-			for (int k = i+1; k < N1; k++)
-				M[k + row*N1] /= M[i + row*N1];
-			M[i + row*N1] = 1.0;
+		multiply(x, q);
 
-			// elimination
-			for (int other_row : queue) {
-				double d = M[i + other_row*N1];
-				for (int k = i+1; k < N1; k++)
-					M[k + other_row*N1] -= d*M[k + row*N1];
-				M[i + other_row*N1] = 0.0;
-			}
+		double rz = 0, r_norm = 0;
+		for (int i = 0; i < N; i++) {
+			res[i] = Ay[i] - q[i];
+			z[i] = res[i] / diag[i];
+			p[i] = z[i];
+			rz += res[i] * z[i];
+			r_norm += res[i] * res[i];
 		}
 
-		log_assert(queue.empty());
-		log_assert(GetSize(pivot_cache) == N);
+		double tolerance = 1e-20 * max(rhs_norm, 1e-30);
+		int iter;
 
-		// back substitution
-		for (int i = N-1; i >= 0; i--)
-		for (int j = i+1; j < N; j++)
+		for (iter = 0; iter < N+10 && r_norm > tolerance; iter++)
 		{
-			int row = pivot_cache[i];
-			int other_row = pivot_cache[j];
-			M[N + row*N1] -= M[j + row*N1] * M[N + other_row*N1];
-			M[j + row*N1] = 0.0;
+			multiply(p, q);
+
+			double pq = 0;
+			for (int i = 0; i < N; i++)
+				pq += p[i] * q[i];
+			if (!(pq > 0))
+				break;
+
+			double alpha = rz / pq;
+			double rz_new = 0;
+			r_norm = 0;
+
+			for (int i = 0; i < N; i++) {
+				x[i] += alpha * p[i];
+				res[i] -= alpha * q[i];
+				z[i] = res[i] / diag[i];
+				rz_new += res[i] * z[i];
+				r_norm += res[i] * res[i];
+			}
+
+			double beta = rz_new / rz;
+			rz = rz_new;
+
+			for (int i = 0; i < N; i++)
+				p[i] = z[i] + beta * p[i];
 		}
 
 #ifdef LOG_MATRICES
-		log("\n");
-		for (int i = 0; i < N; i++) {
-			for (int j = 0; j < N+1; j++)
-				log(" %10.2e", M[(N+1)*i + j]);
-			log("\n");
-		}
+		log("\n%d CG iterations, residual %.2e\n", iter, sqrt(r_norm));
+		for (int i = 0; i < N; i++)
+			log(" %10.2e\n", x[i]);
 #endif
 
 		// update node positions
 		for (int i = 0; i < N; i++)
 		{
-			double v = M[(N+1)*i + N];
+			double v = x[i];
 			double c = alt_mode ? alt_midpos : midpos;
 			double r = alt_mode ? alt_radius : radius;
 
@@ -51,6 +51,8 @@ struct ScatterPass : public Pass {
 			if (!design->selected(mod_it.second))
 				continue;
 
+			mod_it.second->invalidate_caches();
+
 			for (auto &c : mod_it.second->cells_)
 			for (auto &p : c.second->connections_)
 			{
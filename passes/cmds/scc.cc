@@ -25,6 +25,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
+#include "kernel/cellgraph.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
@@ -39,67 +40,9 @@ struct SccWorker
 	SigMap sigmap;
 	CellTypes ct;
 
-	std::set<RTLIL::Cell*> workQueue;
-	std::map<RTLIL::Cell*, std::set<RTLIL::Cell*>> cellToNextCell;
-	std::map<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
-
-	std::map<RTLIL::Cell*, std::pair<int, int>> cellLabels;
-	std::map<RTLIL::Cell*, int> cellDepth;
-	std::set<RTLIL::Cell*> cellsOnStack;
-	std::vector<RTLIL::Cell*> cellStack;
-	int labelCounter;
-
-	std::map<RTLIL::Cell*, int> cell2scc;
+	dict<RTLIL::Cell*, RTLIL::SigSpec> cellToPrevSig, cellToNextSig;
 	std::vector<std::set<RTLIL::Cell*>> sccList;
 
-	void run(RTLIL::Cell *cell, int depth, int maxDepth)
-	{
-		log_assert(workQueue.count(cell) > 0);
-
-		workQueue.erase(cell);
-		cellLabels[cell] = std::pair<int, int>(labelCounter, labelCounter);
-		labelCounter++;
-
-		cellsOnStack.insert(cell);
-		cellStack.push_back(cell);
-
-		if (maxDepth >= 0)
-			cellDepth[cell] = depth;
-
-		for (auto nextCell : cellToNextCell[cell])
-			if (cellLabels.count(nextCell) == 0) {
-				run(nextCell, depth+1, maxDepth);
-				cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			} else
-			if (cellsOnStack.count(nextCell) > 0 && (maxDepth < 0 || cellDepth[nextCell] + maxDepth > depth)) {
-					cellLabels[cell].second = min(cellLabels[cell].second, cellLabels[nextCell].second);
-			}
-
-		if (cellLabels[cell].first == cellLabels[cell].second)
-		{
-			if (cellStack.back() == cell)
-			{
-				cellStack.pop_back();
-				cellsOnStack.erase(cell);
-			}
-			else
-			{
-				log("Found an SCC:");
-				std::set<RTLIL::Cell*> scc;
-				while (cellsOnStack.count(cell) > 0) {
-					RTLIL::Cell *c = cellStack.back();
-					cellStack.pop_back();
-					cellsOnStack.erase(c);
-					log(" %s", RTLIL::id2cstr(c->name));
-					cell2scc[c] = sccList.size();
-					scc.insert(c);
-				}
-				sccList.push_back(scc);
-				log("\n");
-			}
-		}
-	}
-
 	SccWorker(RTLIL::Design *design, RTLIL::Module *module, bool nofeedbackMode, bool allCellTypes, int maxDepth) :
 			design(design), module(module), sigmap(module)
 	{
@@ -116,7 +59,7 @@ struct SccWorker
 		}
 
 		SigPool selectedSignals;
-		SigSet<RTLIL::Cell*> sigToNextCells;
+		CellGraph graph;
 
 		for (auto &it : module->wires_)
 			if (design->selected(module, it.second))
@@ -132,7 +75,7 @@ struct SccWorker
 			if (!allCellTypes && !ct.cell_known(cell->type))
 				continue;
 
-			workQueue.insert(cell);
+			graph.node(cell);
 
 			RTLIL::SigSpec inputSignals, outputSignals;
 
@@ -157,34 +100,24 @@ struct SccWorker
 			inputSignals.sort_and_unify();
 			outputSignals.sort_and_unify();
 
+			for (auto bit : inputSignals)
+				graph.add_input(cell, bit);
+			for (auto bit : outputSignals)
+				graph.add_output(cell, bit);
+
 			cellToPrevSig[cell] = inputSignals;
 			cellToNextSig[cell] = outputSignals;
-			sigToNextCells.insert(inputSignals, cell);
 		}
 
-		for (auto cell : workQueue)
-			cellToNextCell[cell] = sigToNextCells.find(cellToNextSig[cell]);
+		graph.build();
 
-		labelCounter = 0;
-		cellLabels.clear();
-
-		while (workQueue.size() > 0)
+		for (auto &scc : graph.find_sccs(!nofeedbackMode, maxDepth))
 		{
-			RTLIL::Cell *cell = *workQueue.begin();
-			log_assert(cellStack.size() == 0);
-			cellDepth.clear();
-
-			if (!nofeedbackMode && cellToNextCell[cell].count(cell)) {
-				log("Found an SCC:");
-				std::set<RTLIL::Cell*> scc;
+			log("Found an SCC:");
+			for (auto cell : scc)
 				log(" %s", RTLIL::id2cstr(cell->name));
-				cell2scc[cell] = sccList.size();
-				scc.insert(cell);
-				sccList.push_back(scc);
-				workQueue.erase(cell);
-				log("\n");
-			} else
-				run(cell, 0, maxDepth);
+			log("\n");
+			sccList.push_back(std::set<RTLIL::Cell*>(scc.begin(), scc.end()));
 		}
 
 		log("Found %d SCCs in module %s.\n", int(sccList.size()), RTLIL::id2cstr(module->name));
@@ -136,6 +136,181 @@ static bool match_attr(const dict<RTLIL::IdString, RTLIL::Const> &attributes, st
 	return match_attr(attributes, match_expr, std::string(), 0);
 }
 
+// Per-module index of the public member names and of the attribute and
+// parameter keys, so that patterns with a literal prefix (e.g. "foo_*" or
+// "a:keep") only need to be matched against a few candidates instead of
+// every object in the module. The index is kept between select calls and
+// rebuilt when a fingerprint over the member names (or attribute keys)
+// changes, which is computed from IdString indices without any string
+// operations.
+
+struct SelectIndex
+{
+	typedef std::vector<std::pair<std::string, RTLIL::IdString>> names_t;
+
+	RTLIL::IdString module_name;
+	uint64_t names_fingerprint = 0;
+	names_t wires, memories, cells, processes;
+
+	bool keys_valid = false;
+	uint64_t keys_fingerprint = 0;
+	dict<RTLIL::IdString, std::vector<RTLIL::IdString>> attr_members, param_members;
+};
+
+static dict<RTLIL::Module*, SelectIndex> select_index_cache;
+
+static inline uint64_t select_index_mix(uint64_t a, uint64_t b)
+{
+	uint64_t x = (a * 0x9e3779b97f4a7c15ull) ^ (b + 0x632be59bd9b4e019ull);
+	x ^= x >> 29;
+	x *= 0xbf58476d1ce4e5b9ull;
+	return x ^ (x >> 32);
+}
+
+template<typename T>
+static uint64_t select_index_names_fingerprint(const dict<RTLIL::IdString, T*> &objects, int tag)
+{
+	uint64_t fp = select_index_mix(tag, GetSize(objects));
+	for (auto &it : objects)
+		fp += select_index_mix(tag, it.first.index_);
+	return fp;
+}
+
+template<typename T>
+static uint64_t select_index_keys_fingerprint(const dict<RTLIL::IdString, T*> &objects, int tag)
+{
+	uint64_t fp = 0;
+	for (auto &it : objects)
+		for (auto &attr : it.second->attributes)
+			fp += select_index_mix(select_index_mix(tag, it.first.index_), attr.first.index_);
+	return fp;
+}
+
+template<typename T>
+static void select_index_names(SelectIndex::names_t &index, const dict<RTLIL::IdString, T*> &objects)
+{
+	index.clear();
+	for (auto &it : objects)
+		if (it.first[0] == '\\')
+			index.push_back(std::make_pair(it.first.substr(1), it.first));
+	std::sort(index.begin(), index.end());
+}
+
+template<typename T>
+static void select_index_keys(dict<RTLIL::IdString, std::vector<RTLIL::IdString>> &index, const dict<RTLIL::IdString, T*> &objects)
+{
+	for (auto &it : objects)
+		for (auto &attr : it.second->attributes)
+			index[attr.first].push_back(it.first);
+}
+
+static SelectIndex &get_select_index(RTLIL::Module *mod, bool with_keys)
+{
+	uint64_t names_fp = select_index_mix(mod->name.index_, 0);
+	names_fp += select_index_names_fingerprint(mod->wires_, 1);
+	names_fp += select_index_names_fingerprint(mod->memories, 2);
+	names_fp += select_index_names_fingerprint(mod->cells_, 3);
+	names_fp += select_index_names_fingerprint(mod->processes, 4);
+
+	SelectIndex &idx = select_index_cache[mod];
+	if (idx.module_name != mod->name || idx.names_fingerprint != names_fp) {
+		idx = SelectIndex();
+		idx.module_name = mod->name;
+		idx.names_fingerprint = names_fp;
+		select_index_names(idx.wires, mod->wires_);
+		select_index_names(idx.memories, mod->memories);
+		select_index_names(idx.cells, mod->cells_);
+		select_index_names(idx.processes, mod->processes);
+	}
+
+	if (with_keys)
+	{
+		uint64_t keys_fp = select_index_keys_fingerprint(mod->wires_, 1);
+		keys_fp += select_index_keys_fingerprint(mod->memories, 2);
+		keys_fp += select_index_keys_fingerprint(mod->cells_, 3);
+		keys_fp += select_index_keys_fingerprint(mod->processes, 4);
+		for (auto &it : mod->cells_)
+			for (auto &param : it.second->parameters)
+				keys_fp += select_index_mix(select_index_mix(5, it.first.index_), param.first.index_);
+
+		if (!idx.keys_valid || idx.keys_fingerprint != keys_fp) {
+			idx.keys_valid = true;
+			idx.keys_fingerprint = keys_fp;
+			idx.attr_members.clear();
+			idx.param_members.clear();
+			select_index_keys(idx.attr_members, mod->wires_);
+			select_index_keys(idx.attr_members, mod->memories);
+			select_index_keys(idx.attr_members, mod->cells_);
+			select_index_keys(idx.attr_members, mod->processes);
+			for (auto &it : mod->cells_)
+				for (auto &param : it.second->parameters)
+					idx.param_members[param.first].push_back(it.first);
+		}
+	}
+
+	return idx;
+}
+
+static void prune_select_index(RTLIL::Design *design)
+{
+	std::vector<RTLIL::Module*> del_list;
+	for (auto &it : select_index_cache)
+		if (design->module(it.second.module_name) != it.first)
+			del_list.push_back(it.first);
+	for (auto mod : del_list)
+		select_index_cache.erase(mod);
+}
+
+// Returns false if the pattern has no literal prefix that restricts the
+// matches to public names (patterns starting with '$' also match on the
+// last "$..." segment of internal names and must always do a full scan).
+static bool name_pattern_prefix(const std::string &pattern, std::string &prefix)
+{
+	if (pattern.empty() || pattern[0] == '$')
+		return false;
+	prefix = pattern.substr(0, pattern.find_first_of("*?[\\"));
+	return !prefix.empty();
+}
+
+// Calls match_ids() on the candidates for the pattern and on every object
+// if the pattern cannot use the index.
+template<typename T, typename F>
+static void select_by_name(const dict<RTLIL::IdString, T*> &objects, const SelectIndex::names_t &index,
+		const std::string &pattern, F filter, pool<RTLIL::IdString> *&result, RTLIL::Selection &sel, RTLIL::IdString mod_name)
+{
+	std::string prefix;
+	if (!name_pattern_prefix(pattern, prefix)) {
+		for (auto &it : objects)
+			if (filter(it.second) && match_ids(it.first, pattern)) {
+				if (result == nullptr)
+					result = &sel.selected_members[mod_name];
+				result->insert(it.first);
+			}
+		return;
+	}
+
+	auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(prefix, RTLIL::IdString()));
+	for (; it != index.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+		if (filter(objects.at(it->second)) && match_ids(it->second, pattern)) {
+			if (result == nullptr)
+				result = &sel.selected_members[mod_name];
+			result->insert(it->second);
+		}
+}
+
+// Returns false if the attribute name pattern has wildcards, otherwise the
+// keys that match_attr() would look up.
+static bool attr_pattern_keys(const std::string &match_expr, std::vector<RTLIL::IdString> &keys)
+{
+	std::string name_pat = match_expr.substr(0, match_expr.find_first_of("<!=>"));
+	if (name_pat.empty() || name_pat.find_first_of("*?[") != std::string::npos)
+		return false;
+	if (name_pat[0] == '\\' || name_pat[0] == '$')
+		keys.push_back(name_pat);
+	keys.push_back("\\" + name_pat);
+	return true;
+}
+
 static void select_op_neg(RTLIL::Design *design, RTLIL::Selection &lhs)
 {
 	if (lhs.full_selection) {
@@ -463,7 +638,7 @@ static int select_op_expand(RTLIL::Design *design, RTLIL::Selection &lhs, std::v
 		for (auto &conn : cell.second->connections())
 		{
 			char last_mode = '-';
-			if (eval_only && !yosys_celltypes.cell_evaluable(cell.second->type))
+			if (eval_only && !yosys_get_celltypes().cell_evaluable(cell.second->type))
 				goto exclude_match;
 			for (auto &rule : rules) {
 				last_mode = rule.mode;
@@ -782,6 +957,8 @@ static void select_stmt(RTLIL::Design *design, std::string arg)
 	}
 
 	sel.full_selection = false;
+	prune_select_index(design);
+
 	for (auto &mod_it : design->modules_)
 	{
 		if (arg_mod.substr(0, 2) == "A:") {
@@ -797,27 +974,24 @@ static void select_stmt(RTLIL::Design *design, std::string arg)
 		}
 
 		RTLIL::Module *mod = mod_it.second;
-		if (arg_memb.substr(0, 2) == "w:") {
-			for (auto &it : mod->wires_)
-				if (match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		std::string memb_kind = arg_memb.substr(0, 2);
+		SelectIndex &index = get_select_index(mod, memb_kind == "a:" || memb_kind == "r:");
+		pool<RTLIL::IdString> *members = nullptr;
+		auto any_object = [](RTLIL::AttrObject*) { return true; };
+
+		if (memb_kind == "w:") {
+			select_by_name(mod->wires_, index.wires, arg_memb.substr(2), any_object, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "i:") {
-			for (auto &it : mod->wires_)
-				if (it.second->port_input && match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "i:") {
+			select_by_name(mod->wires_, index.wires, arg_memb.substr(2), [](RTLIL::Wire *w) { return w->port_input; }, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "o:") {
-			for (auto &it : mod->wires_)
-				if (it.second->port_output && match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "o:") {
+			select_by_name(mod->wires_, index.wires, arg_memb.substr(2), [](RTLIL::Wire *w) { return w->port_output; }, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "x:") {
-			for (auto &it : mod->wires_)
-				if ((it.second->port_input || it.second->port_output) && match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "x:") {
+			select_by_name(mod->wires_, index.wires, arg_memb.substr(2), [](RTLIL::Wire *w) { return w->port_input || w->port_output; }, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "s:") {
+		if (memb_kind == "s:") {
 			size_t delim = arg_memb.substr(2).find(':');
 			if (delim == std::string::npos) {
 				int width = atoi(arg_memb.substr(2).c_str());
@@ -834,59 +1008,73 @@ static void select_stmt(RTLIL::Design *design, std::string arg)
 						sel.selected_members[mod->name].insert(it.first);
 			}
 		} else
-		if (arg_memb.substr(0, 2) == "m:") {
-			for (auto &it : mod->memories)
-				if (match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "m:") {
+			select_by_name(mod->memories, index.memories, arg_memb.substr(2), any_object, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "c:") {
-			for (auto &it : mod->cells_)
-				if (match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "c:") {
+			select_by_name(mod->cells_, index.cells, arg_memb.substr(2), any_object, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "t:") {
+		if (memb_kind == "t:") {
 			for (auto &it : mod->cells_)
 				if (match_ids(it.second->type, arg_memb.substr(2)))
 					sel.selected_members[mod->name].insert(it.first);
 		} else
-		if (arg_memb.substr(0, 2) == "p:") {
-			for (auto &it : mod->processes)
-				if (match_ids(it.first, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "p:") {
+			select_by_name(mod->processes, index.processes, arg_memb.substr(2), any_object, members, sel, mod->name);
 		} else
-		if (arg_memb.substr(0, 2) == "a:") {
-			for (auto &it : mod->wires_)
-				if (match_attr(it.second->attributes, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->memories)
-				if (match_attr(it.second->attributes, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->cells_)
-				if (match_attr(it.second->attributes, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->processes)
-				if (match_attr(it.second->attributes, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "a:") {
+			std::vector<RTLIL::IdString> keys;
+			if (attr_pattern_keys(arg_memb.substr(2), keys)) {
+				for (auto key : keys)
+					if (index.attr_members.count(key))
+						for (auto memb_name : index.attr_members.at(key)) {
+							RTLIL::AttrObject *obj = nullptr;
+							if (mod->wires_.count(memb_name))
+								obj = mod->wires_.at(memb_name);
+							else if (mod->memories.count(memb_name))
+								obj = mod->memories.at(memb_name);
+							else if (mod->cells_.count(memb_name))
+								obj = mod->cells_.at(memb_name);
+							else
+								obj = mod->processes.at(memb_name);
+							if (match_attr(obj->attributes, arg_memb.substr(2)))
+								sel.selected_members[mod->name].insert(memb_name);
+						}
+			} else {
+				for (auto &it : mod->wires_)
+					if (match_attr(it.second->attributes, arg_memb.substr(2)))
+						sel.selected_members[mod->name].insert(it.first);
+				for (auto &it : mod->memories)
+					if (match_attr(it.second->attributes, arg_memb.substr(2)))
+						sel.selected_members[mod->name].insert(it.first);
+				for (auto &it : mod->cells_)
+					if (match_attr(it.second->attributes, arg_memb.substr(2)))
+						sel.selected_members[mod->name].insert(it.first);
+				for (auto &it : mod->processes)
+					if (match_attr(it.second->attributes, arg_memb.substr(2)))
+						sel.selected_members[mod->name].insert(it.first);
+			}
 		} else
-		if (arg_memb.substr(0, 2) == "r:") {
-			for (auto &it : mod->cells_)
-				if (match_attr(it.second->parameters, arg_memb.substr(2)))
-					sel.selected_members[mod->name].insert(it.first);
+		if (memb_kind == "r:") {
+			std::vector<RTLIL::IdString> keys;
+			if (attr_pattern_keys(arg_memb.substr(2), keys)) {
+				for (auto key : keys)
+					if (index.param_members.count(key))
+						for (auto memb_name : index.param_members.at(key))
+							if (match_attr(mod->cells_.at(memb_name)->parameters, arg_memb.substr(2)))
+								sel.selected_members[mod->name].insert(memb_name);
+			} else {
+				for (auto &it : mod->cells_)
+					if (match_attr(it.second->parameters, arg_memb.substr(2)))
+						sel.selected_members[mod->name].insert(it.first);
+			}
 		} else {
-			if (arg_memb.substr(0, 2) == "n:")
+			if (memb_kind == "n:")
 				arg_memb = arg_memb.substr(2);
-			for (auto &it : mod->wires_)
-				if (match_ids(it.first, arg_memb))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->memories)
-				if (match_ids(it.first, arg_memb))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->cells_)
-				if (match_ids(it.first, arg_memb))
-					sel.selected_members[mod->name].insert(it.first);
-			for (auto &it : mod->processes)
-				if (match_ids(it.first, arg_memb))
-					sel.selected_members[mod->name].insert(it.first);
+			select_by_name(mod->wires_, index.wires, arg_memb, any_object, members, sel, mod->name);
+			select_by_name(mod->memories, index.memories, arg_memb, any_object, members, sel, mod->name);
+			select_by_name(mod->cells_, index.cells, arg_memb, any_object, members, sel, mod->name);
+			select_by_name(mod->processes, index.processes, arg_memb, any_object, members, sel, mod->name);
 		}
 	}
 
@@ -947,6 +1135,7 @@ PRIVATE_NAMESPACE_BEGIN
 
 struct SelectPass : public Pass {
 	SelectPass() : Pass("select", "modify and view the list of selected objects") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1441,6 +1630,7 @@ struct SelectPass : public Pass {
 
 struct CdPass : public Pass {
 	CdPass() : Pass("cd", "a shortcut for 'select -module <name>'") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1513,6 +1703,7 @@ static void log_matches(const char *title, Module *module, T list)
 
 struct LsPass : public Pass {
 	LsPass() : Pass("ls", "list modules or objects in modules") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
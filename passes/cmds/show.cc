@@ -19,8 +19,10 @@
 
 #include "kernel/register.h"
 #include "kernel/celltypes.h"
+#include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include <string.h>
+#include <sys/stat.h>
 
 #ifndef _WIN32
 #  include <dirent.h>
@@ -67,6 +69,9 @@ struct ShowWorker
 	std::map<RTLIL::Const, int> colorattr_cache;
 	RTLIL::IdString colorattr;
 
+	std::string cluster_mode;
+	const std::vector<std::string> &expand_patterns;
+
 
 	static uint32_t xorshift32(uint32_t x) {
 		x ^= x << 13;
@@ -323,6 +328,32 @@ struct ShowWorker
 			collect_proc_signals(it, input_signals, output_signals);
 	}
 
+	std::string cluster_name(RTLIL::Cell *cell)
+	{
+		if (cluster_mode == "type")
+			return cell->type.str();
+
+		if (cluster_mode == "prefix") {
+			// hierarchical prefix of a flattened name, e.g. "cpu.alu" for the
+			// cells "\cpu.alu.sum" and "$techmap\cpu.alu.$add$alu.v:12$34"
+			std::string name = cell->name.str();
+			if (name.substr(0, 8) == "$techmap")
+				name = name.substr(8);
+			if (name[0] == '$')
+				return std::string();
+			size_t pos = name.rfind('.', name.find('$'));
+			if (pos == std::string::npos)
+				return std::string();
+			return name.substr(0, pos);
+		}
+
+		RTLIL::IdString attr = RTLIL::escape_id(cluster_mode);
+		if (cell->attributes.count(attr) == 0)
+			return std::string();
+		const RTLIL::Const &value = cell->attributes.at(attr);
+		return (value.flags & RTLIL::CONST_FLAG_STRING) != 0 ? value.decode_string() : value.as_string();
+	}
+
 	void handle_module()
 	{
 		single_idx_count = 0;
@@ -338,6 +369,48 @@ struct ShowWorker
 
 		std::set<std::string> all_sources, all_sinks;
 
+		// with -cluster, the selected cells of each group are collapsed into a
+		// single node g<idx>, unless the group has only one cell or is expanded
+		std::vector<std::pair<std::string, int>> groups;
+		std::vector<bool> group_collapsed;
+		dict<RTLIL::IdString, int> cell_group;
+
+		// in clustered mode cell ports are drawn on the sigmapped signals and
+		// connections between internal wires are not drawn (flattened designs
+		// have one for each port of each former instance)
+		SigMap sigmap;
+
+		if (!cluster_mode.empty())
+		{
+			sigmap.set(module);
+			for (auto &it : module->wires_)
+				if (it.second->port_id != 0 && design->selected_member(module->name, it.first))
+					sigmap.add(RTLIL::SigSpec(it.second));
+
+			dict<std::string, int> group_index;
+			for (auto &it : module->cells_) {
+				if (!design->selected_member(module->name, it.first))
+					continue;
+				std::string name = cluster_name(it.second);
+				if (name.empty())
+					continue;
+				if (group_index.count(name) == 0) {
+					group_index[name] = GetSize(groups);
+					groups.push_back(std::pair<std::string, int>(name, 0));
+				}
+				cell_group[it.first] = group_index.at(name);
+				groups[group_index.at(name)].second++;
+			}
+
+			for (auto &g : groups) {
+				bool collapsed = g.second > 1;
+				for (auto &pattern : expand_patterns)
+					if (patmatch(pattern.c_str(), RTLIL::unescape_id(g.first).c_str()))
+						collapsed = false;
+				group_collapsed.push_back(collapsed);
+			}
+		}
+
 		std::map<std::string, std::string> wires_on_demand;
 		for (auto &it : module->wires_) {
 			if (!design->selected_member(module->name, it.first))
@@ -345,7 +418,7 @@ struct ShowWorker
 			const char *shape = "diamond";
 			if (it.second->port_input || it.second->port_output)
 				shape = "octagon";
-			if (it.first[0] == '\\') {
+			if (it.first[0] == '\\' && (groups.empty() || it.second->port_id != 0)) {
 				fprintf(f, "n%d [ shape=%s, label=\"%s\", %s, fontcolor=\"black\" ];\n",
 						id2num(it.first), shape, findLabel(it.first.str()),
 						nextColor(RTLIL::SigSpec(it.second), "color=\"black\"").c_str());
@@ -371,11 +444,44 @@ struct ShowWorker
 			fprintf(f, "}\n");
 		}
 
+		int collapsed_cells = 0;
+		for (int i = 0; i < GetSize(groups); i++)
+			if (group_collapsed[i]) {
+				fprintf(f, "g%d [ shape=box3d, label=\"%s\\n%d cells\" ];\n", i, escape(groups[i].first), groups[i].second);
+				collapsed_cells += groups[i].second;
+			}
+		if (collapsed_cells > 0)
+			log("Collapsed %d cells into %d groups.\n", collapsed_cells,
+					int(std::count(group_collapsed.begin(), group_collapsed.end(), true)));
+
 		for (auto &it : module->cells_)
 		{
 			if (!design->selected_member(module->name, it.first))
 				continue;
 
+			if (cell_group.count(it.first) && group_collapsed[cell_group.at(it.first)])
+			{
+				// collapsed cells connect to the wire nodes directly, all their
+				// ports are merged into the group node
+				std::string node = stringf("g%d", cell_group.at(it.first));
+				for (auto &conn : it.second->connections()) {
+					bool driver = ct.cell_output(it.second->type, conn.first);
+					RTLIL::SigSpec sig = sigmap(conn.second);
+					for (auto &c : sig.chunks()) {
+						if (c.wire == NULL || !design->selected_member(module->name, c.wire->name))
+							continue;
+						net_conn &nc = net_conn_map[stringf("n%d", id2num(c.wire->name))];
+						if (driver)
+							nc.in.insert(node);
+						else
+							nc.out.insert(node);
+						nc.bits = std::max(nc.bits, c.wire->width);
+						nc.color = nextColor(c, nc.color);
+					}
+				}
+				continue;
+			}
+
 			std::vector<RTLIL::IdString> in_ports, out_ports;
 
 			for (auto &conn : it.second->connections()) {
@@ -409,7 +515,7 @@ struct ShowWorker
 			std::string code;
 			for (auto &conn : it.second->connections()) {
 				code += gen_portbox(stringf("c%d:p%d", id2num(it.first), id2num(conn.first)),
-						conn.second, ct.cell_output(it.second->type, conn.first));
+						groups.empty() ? conn.second : sigmap(conn.second), ct.cell_output(it.second->type, conn.first));
 			}
 
 #ifdef CLUSTER_CELLS_AND_PORTBOXES
@@ -475,6 +581,18 @@ struct ShowWorker
 			if (!found_lhs_wire || !found_rhs_wire)
 				continue;
 
+			if (!groups.empty()) {
+				bool lhs_port = false, rhs_port = false;
+				for (auto &c : conn.first.chunks())
+					if (c.wire != NULL && c.wire->port_id != 0)
+						lhs_port = true;
+				for (auto &c : conn.second.chunks())
+					if (c.wire != NULL && c.wire->port_id != 0)
+						rhs_port = true;
+				if ((!lhs_port || !rhs_port) && !conn.first.has_const() && !conn.second.has_const())
+					continue;
+			}
+
 			std::string code, left_node, right_node;
 			code += gen_portbox("", conn.second, false, &left_node);
 			code += gen_portbox("", conn.first, true, &right_node);
@@ -500,14 +618,29 @@ struct ShowWorker
 			}
 		}
 
+		// parallel nets between two collapsed groups are drawn as one edge
+		std::map<std::pair<std::string, std::string>, int> group_edges;
+
 		for (auto &it : net_conn_map)
 		{
 			currentColor = xorshift32(currentColor);
 			if (wires_on_demand.count(it.first) > 0) {
+				if (!groups.empty()) {
+					// nets that are internal to a collapsed group are not shown
+					for (auto &from : it.second.in)
+						if (from[0] == 'g')
+							it.second.out.erase(from);
+					if (it.second.out.empty() && it.second.in.size() == 1 && (*it.second.in.begin())[0] == 'g')
+						continue;
+				}
 				if (it.second.in.size() == 1 && it.second.out.size() > 1 && it.second.in.begin()->substr(0, 1) == "p")
 					it.second.out.erase(*it.second.in.begin());
 				if (it.second.in.size() == 1 && it.second.out.size() == 1) {
 					std::string from = *it.second.in.begin(), to = *it.second.out.begin();
+					if (from[0] == 'g' && to[0] == 'g') {
+						group_edges[std::pair<std::string, std::string>(from, to)] += it.second.bits;
+						continue;
+					}
 					if (from != to || from.substr(0, 1) != "p")
 						fprintf(f, "%s:e -> %s:w [%s, %s];\n", from.c_str(), to.c_str(), nextColor(it.second.color).c_str(), widthLabel(it.second.bits).c_str());
 					continue;
@@ -523,16 +656,23 @@ struct ShowWorker
 				fprintf(f, "%s:e -> %s:w [%s, %s];\n", it.first.c_str(), it2.c_str(), nextColor(it.second.color).c_str(), widthLabel(it.second.bits).c_str());
 		}
 
+		for (auto &it : group_edges) {
+			currentColor = xorshift32(currentColor);
+			fprintf(f, "%s:e -> %s:w [%s, %s];\n", it.first.first.c_str(), it.first.second.c_str(), nextColor().c_str(), widthLabel(it.second).c_str());
+		}
+
 		fprintf(f, "}\n");
 	}
 
 	ShowWorker(FILE *f, RTLIL::Design *design, std::vector<RTLIL::Design*> &libs, uint32_t colorSeed, bool genWidthLabels,
 			bool genSignedLabels, bool stretchIO, bool enumerateIds, bool abbreviateIds, bool notitle,
 			const std::vector<std::pair<std::string, RTLIL::Selection>> &color_selections,
-			const std::vector<std::pair<std::string, RTLIL::Selection>> &label_selections, RTLIL::IdString colorattr) :
+			const std::vector<std::pair<std::string, RTLIL::Selection>> &label_selections, RTLIL::IdString colorattr,
+			std::string cluster_mode, const std::vector<std::string> &expand_patterns) :
 			f(f), design(design), currentColor(colorSeed), genWidthLabels(genWidthLabels),
 			genSignedLabels(genSignedLabels), stretchIO(stretchIO), enumerateIds(enumerateIds), abbreviateIds(abbreviateIds),
-			notitle(notitle), color_selections(color_selections), label_selections(label_selections), colorattr(colorattr)
+			notitle(notitle), color_selections(color_selections), label_selections(label_selections), colorattr(colorattr),
+			cluster_mode(cluster_mode), expand_patterns(expand_patterns)
 	{
 		ct.setup_internals();
 		ct.setup_internals_mem();
@@ -567,8 +707,25 @@ struct ShowWorker
 	}
 };
 
+static std::string read_file_text(std::string filename)
+{
+	std::ifstream f(filename.c_str());
+	if (f.fail())
+		return std::string();
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static bool file_is_newer(std::string filename, std::string other_filename)
+{
+	struct stat st, other_st;
+	if (stat(filename.c_str(), &st) != 0 || stat(other_filename.c_str(), &other_st) != 0)
+		return false;
+	return st.st_mtime >= other_st.st_mtime;
+}
+
 struct ShowPass : public Pass {
 	ShowPass() : Pass("show", "generate schematics using graphviz") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -639,8 +796,22 @@ struct ShowPass : public Pass {
 		log("    -notitle\n");
 		log("        do not add the module name as graph title to the dot file\n");
 		log("\n");
+		log("    -cluster {prefix|type|<attribute>}\n");
+		log("        collapse groups of cells into a single node, for designs that are too\n");
+		log("        large to be drawn cell by cell. cells are grouped by the hierarchical\n");
+		log("        prefix of their (flattened) name, by cell type, or by the value of the\n");
+		log("        given attribute. cells without a group are drawn as usual, and nets\n");
+		log("        that only connect cells within a group are omitted. e.g. the output\n");
+		log("        of 'scc -set_cell_attr loop {}' can be shown with '-cluster loop'.\n");
+		log("\n");
+		log("    -expand <pattern>\n");
+		log("        draw the cells of all groups whose name matches the given wildcard\n");
+		log("        pattern individually. this option can be used multiple times.\n");
+		log("\n");
 		log("When no <format> is specified, 'dot' is used. When no <format> and <viewer> is\n");
-		log("specified, 'xdot' is used to display the schematic.\n");
+		log("specified, 'xdot' is used to display the schematic. If the generated dot file is\n");
+		log("identical to the one of the previous call, the existing graphics file is reused\n");
+		log("instead of running 'dot' again.\n");
 		log("\n");
 		log("The generated output files are '~/.yosys_show.dot' and '~/.yosys_show.<format>',\n");
 		log("unless another prefix is specified using -prefix <prefix>.\n");
@@ -676,6 +847,8 @@ struct ShowPass : public Pass {
 		bool flag_abbreviate = true;
 		bool flag_notitle = false;
 		RTLIL::IdString colorattr;
+		std::string cluster_mode;
+		std::vector<std::string> expand_patterns;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++)
@@ -755,6 +928,14 @@ struct ShowPass : public Pass {
 				flag_notitle = true;
 				continue;
 			}
+			if (arg == "-cluster" && argidx+1 < args.size()) {
+				cluster_mode = args[++argidx];
+				continue;
+			}
+			if (arg == "-expand" && argidx+1 < args.size()) {
+				expand_patterns.push_back(args[++argidx]);
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -789,6 +970,10 @@ struct ShowPass : public Pass {
 		std::string dot_file = stringf("%s.dot", prefix.c_str());
 		std::string out_file = stringf("%s.%s", prefix.c_str(), format.empty() ? "svg" : format.c_str());
 
+		// the graphics file can be reused if it was generated from an identical dot file
+		bool out_file_current = file_is_newer(out_file, dot_file);
+		std::string old_dot_text = out_file_current ? read_file_text(dot_file) : std::string();
+
 		log("Writing dot description to `%s'.\n", dot_file.c_str());
 		FILE *f = fopen(dot_file.c_str(), "w");
 		if (f == NULL) {
@@ -796,7 +981,7 @@ struct ShowPass : public Pass {
 				delete lib;
 			log_cmd_error("Can't open dot file `%s' for writing.\n", dot_file.c_str());
 		}
-		ShowWorker worker(f, design, libs, colorSeed, flag_width, flag_signed, flag_stretch, flag_enum, flag_abbreviate, flag_notitle, color_selections, label_selections, colorattr);
+		ShowWorker worker(f, design, libs, colorSeed, flag_width, flag_signed, flag_stretch, flag_enum, flag_abbreviate, flag_notitle, color_selections, label_selections, colorattr, cluster_mode, expand_patterns);
 		fclose(f);
 
 		for (auto lib : libs)
@@ -805,6 +990,9 @@ struct ShowPass : public Pass {
 		if (worker.page_counter == 0)
 			log_cmd_error("Nothing there to show.\n");
 
+		if (format != "dot" && !format.empty() && !old_dot_text.empty() && old_dot_text == read_file_text(dot_file)) {
+			log("Dot description is unchanged, reusing `%s'.\n", out_file.c_str());
+		} else
 		if (format != "dot" && !format.empty()) {
 			std::string cmd = stringf("dot -T%s -o '%s.new' '%s' && mv '%s.new' '%s'", format.c_str(), out_file.c_str(), dot_file.c_str(), out_file.c_str(), out_file.c_str());
 			log("Exec: %s\n", cmd.c_str());
@@ -27,29 +27,44 @@ PRIVATE_NAMESPACE_BEGIN
 
 struct SplitnetsWorker
 {
-	std::map<RTLIL::Wire*, std::vector<RTLIL::SigBit>> splitmap;
+	// the new wires of each split wire, in offset order, with their offset
+	// in the original wire
+	dict<RTLIL::Wire*, std::vector<std::pair<int, RTLIL::Wire*>>> splitmap;
+	bool compact_names;
+
+	SplitnetsWorker() : compact_names(false) { }
 
 	void append_wire(RTLIL::Module *module, RTLIL::Wire *wire, int offset, int width, std::string format)
 	{
-		std::string new_wire_name = wire->name.str();
-
-		if (format.size() > 0)
-			new_wire_name += format.substr(0, 1);
+		RTLIL::Wire *new_wire;
 
-		if (width > 1) {
-			new_wire_name += stringf("%d", offset+width-1);
-			if (format.size() > 2)
-				new_wire_name += format.substr(2, 1);
-			else
-				new_wire_name += ":";
+		if (compact_names && wire->name[0] == '$')
+		{
+			new_wire = module->addWire(NEW_ID, width);
 		}
+		else
+		{
+			std::string new_wire_name = wire->name.str();
+
+			if (format.size() > 0)
+				new_wire_name += format.substr(0, 1);
 
-		new_wire_name += stringf("%d", offset);
+			if (width > 1) {
+				new_wire_name += stringf("%d", offset+width-1);
+				if (format.size() > 2)
+					new_wire_name += format.substr(2, 1);
+				else
+					new_wire_name += ":";
+			}
 
-		if (format.size() > 1)
-			new_wire_name += format.substr(1, 1);
+			new_wire_name += stringf("%d", offset);
+
+			if (format.size() > 1)
+				new_wire_name += format.substr(1, 1);
+
+			new_wire = module->addWire(module->uniquify(new_wire_name), width);
+		}
 
-		RTLIL::Wire *new_wire = module->addWire(module->uniquify(new_wire_name), width);
 		new_wire->port_id = wire->port_id ? wire->port_id + offset : 0;
 		new_wire->port_input = wire->port_input;
 		new_wire->port_output = wire->port_output;
@@ -67,15 +82,46 @@ struct SplitnetsWorker
 			new_wire->attributes["\\init"] = new_init;
 		}
 
-		std::vector<RTLIL::SigBit> sigvec = RTLIL::SigSpec(new_wire).to_sigbit_vector();
-		splitmap[wire].insert(splitmap[wire].end(), sigvec.begin(), sigvec.end());
+		splitmap[wire].push_back(std::make_pair(offset, new_wire));
 	}
 
+	// rewrites whole chunks: a signal without split wires is left untouched,
+	// otherwise each chunk of a split wire becomes one chunk per new wire
 	void operator()(RTLIL::SigSpec &sig)
 	{
-		for (auto &bit : sig)
-			if (splitmap.count(bit.wire) > 0)
-				bit = splitmap.at(bit.wire).at(bit.offset);
+		bool found = false;
+		for (auto &chunk : sig.chunks())
+			if (chunk.wire != NULL && splitmap.count(chunk.wire) > 0) {
+				found = true;
+				break;
+			}
+
+		if (!found)
+			return;
+
+		RTLIL::SigSpec new_sig;
+		for (auto &chunk : sig.chunks())
+		{
+			if (chunk.wire == NULL || splitmap.count(chunk.wire) == 0) {
+				new_sig.append(chunk);
+				continue;
+			}
+
+			auto &parts = splitmap.at(chunk.wire);
+			auto it = parts.begin();
+			if (GetSize(parts) == chunk.wire->width)
+				it += chunk.offset;
+			else
+				while (it+1 != parts.end() && (it+1)->first <= chunk.offset)
+					++it;
+
+			for (int offset = chunk.offset, end = chunk.offset + chunk.width; offset < end; ++it) {
+				int width = std::min(end, it->first + it->second->width) - offset;
+				new_sig.append(RTLIL::SigSpec(it->second, offset - it->first, width));
+				offset += width;
+			}
+		}
+		sig = new_sig;
 	}
 };
 
@@ -102,11 +148,17 @@ struct SplitnetsPass : public Pass {
 		log("        don't blindly split nets in individual bits. instead look at the driver\n");
 		log("        and split nets so that no driver drives only part of a net.\n");
 		log("\n");
+		log("    -compact\n");
+		log("        nets with private names (names starting with '$') get short auto-generated\n");
+		log("        names instead of '<name>[<index>]'. this reduces the memory used for\n");
+		log("        names when splitting wide internal buses in large designs.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		bool flag_ports = false;
 		bool flag_driver = false;
+		bool flag_compact = false;
 		std::string format = "[]:";
 
 		log_header("Executing SPLITNETS pass (splitting up multi-bit signals).\n");
@@ -126,6 +178,10 @@ struct SplitnetsPass : public Pass {
 				flag_driver = true;
 				continue;
 			}
+			if (args[argidx] == "-compact") {
+				flag_compact = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -136,6 +192,7 @@ struct SplitnetsPass : public Pass {
 		for (auto module : design->selected_modules())
 		{
 			SplitnetsWorker worker;
+			worker.compact_names = flag_compact;
 
 			if (flag_ports)
 			{
@@ -189,15 +246,18 @@ struct SplitnetsPass : public Pass {
 			}
 			else
 			{
+				std::vector<RTLIL::Wire*> split_wires;
 				for (auto &w : module->wires_) {
 					RTLIL::Wire *wire = w.second;
 					if (wire->width > 1 && (wire->port_id == 0 || flag_ports) && design->selected(module, w.second))
-						worker.splitmap[wire] = std::vector<RTLIL::SigBit>();
+						split_wires.push_back(wire);
 				}
 
-				for (auto &it : worker.splitmap)
-					for (int i = 0; i < it.first->width; i++)
-						worker.append_wire(module, it.first, i, 1, format);
+				for (auto wire : split_wires) {
+					worker.splitmap[wire].reserve(wire->width);
+					for (int i = 0; i < wire->width; i++)
+						worker.append_wire(module, wire, i, 1, format);
+				}
 			}
 
 			module->rewrite_sigspecs(worker);
@@ -76,9 +76,13 @@ struct statdata_t
 		STAT_NUMERIC_MEMBERS
 	#undef X
 
+		// cell types are counted in a hash table and only sorted once at the end
+		RTLIL::ModuleSelection sel(design, mod);
+		dict<RTLIL::IdString, int> cell_counts;
+
 		for (auto &it : mod->wires_)
 		{
-			if (!design->selected(mod, it.second))
+			if (!sel.selected(it.first))
 				continue;
 
 			if (it.first[0] == '\\') {
@@ -91,7 +95,7 @@ struct statdata_t
 		}
 
 		for (auto &it : mod->memories) {
-			if (!design->selected(mod, it.second))
+			if (!sel.selected(it.first))
 				continue;
 			num_memories++;
 			num_memory_bits += it.second->width * it.second->size;
@@ -99,7 +103,7 @@ struct statdata_t
 
 		for (auto &it : mod->cells_)
 		{
-			if (!design->selected(mod, it.second))
+			if (!sel.selected(it.first))
 				continue;
 
 			RTLIL::IdString cell_type = it.second->type;
@@ -132,11 +136,14 @@ struct statdata_t
 			}
 
 			num_cells++;
-			num_cells_by_type[cell_type]++;
+			cell_counts[cell_type]++;
 		}
 
+		for (auto &it : cell_counts)
+			num_cells_by_type[it.first] = it.second;
+
 		for (auto &it : mod->processes) {
-			if (!design->selected(mod, it.second))
+			if (!sel.selected(it.first))
 				continue;
 			num_processes++;
 		}
@@ -166,9 +173,41 @@ struct statdata_t
 			log("   Chip area for this module: %f\n", area);
 		}
 	}
+
+	void log_data_json(const char *indent)
+	{
+		log("{\n");
+	#define X(_name) log("%s   \"" #_name "\": %d,\n", indent, _name);
+		STAT_INT_MEMBERS
+	#undef X
+		if (area != 0)
+			log("%s   \"area\": %f,\n", indent, area);
+		log("%s   \"num_cells_by_type\": {", indent);
+		bool first = true;
+		for (auto &it : num_cells_by_type) {
+			log("%s\n%s      %s: %d", first ? "" : ",", indent, json_string(it.first.str()).c_str(), it.second);
+			first = false;
+		}
+		log("%s}\n", first ? "" : stringf("\n%s   ", indent).c_str());
+		log("%s}", indent);
+	}
+
+	static std::string json_string(const std::string &str)
+	{
+		std::string result = "\"";
+		for (char ch : str) {
+			if (ch == '"' || ch == '\\')
+				result += '\\';
+			if ((unsigned char)ch < 0x20)
+				result += stringf("\\u%04x", ch);
+			else
+				result += ch;
+		}
+		return result + "\"";
+	}
 };
 
-statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTLIL::IdString mod, int level)
+statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTLIL::IdString mod, int level, bool quiet = false)
 {
 	statdata_t mod_data = mod_stat.at(mod);
 	std::map<RTLIL::IdString, int, RTLIL::sort_by_id_str> num_cells_by_type;
@@ -176,8 +215,9 @@ statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTL
 
 	for (auto &it : num_cells_by_type)
 		if (mod_stat.count(it.first) > 0) {
-			log("     %*s%-*s %6d\n", 2*level, "", 26-2*level, RTLIL::id2cstr(it.first), it.second);
-			mod_data = mod_data + hierarchy_worker(mod_stat, it.first, level+1) * it.second;
+			if (!quiet)
+				log("     %*s%-*s %6d\n", 2*level, "", 26-2*level, RTLIL::id2cstr(it.first), it.second);
+			mod_data = mod_data + hierarchy_worker(mod_stat, it.first, level+1, quiet) * it.second;
 			mod_data.num_cells -= it.second;
 		} else {
 			mod_data.num_cells_by_type[it.first] += it.second;
@@ -188,14 +228,7 @@ statdata_t hierarchy_worker(std::map<RTLIL::IdString, statdata_t> &mod_stat, RTL
 
 void read_liberty_cellarea(dict<IdString, double> &cell_area, string liberty_file)
 {
-	std::ifstream f;
-	f.open(liberty_file.c_str());
-	if (f.fail())
-		log_cmd_error("Can't open liberty file `%s': %s\n", liberty_file.c_str(), strerror(errno));
-	LibertyParser libparser(f);
-	f.close();
-
-	for (auto cell : libparser.ast->children)
+	for (auto cell : LibertyCache::get(liberty_file)->children)
 	{
 		if (cell->id != "cell" || cell->args.size() != 1)
 			continue;
@@ -208,6 +241,7 @@ void read_liberty_cellarea(dict<IdString, double> &cell_area, string liberty_fil
 
 struct StatPass : public Pass {
 	StatPass() : Pass("stat", "print some statistics") { }
+	virtual bool read_only() { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -229,12 +263,14 @@ struct StatPass : public Pass {
 		log("        annotate internal cell types with their word width.\n");
 		log("        e.g. $add_8 for an 8 bit wide $add cell.\n");
 		log("\n");
+		log("    -json\n");
+		log("        output the statistics in a machine-readable JSON format.\n");
+		log("        this is output to the console; use \"tee\" to output to a file.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
-		log_header("Printing statistics.\n");
-
-		bool width_mode = false;
+		bool width_mode = false, json_mode = false;
 		RTLIL::Module *top_mod = NULL;
 		std::map<RTLIL::IdString, statdata_t> mod_stat;
 		dict<IdString, double> cell_area;
@@ -246,6 +282,10 @@ struct StatPass : public Pass {
 				width_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-json") {
+				json_mode = true;
+				continue;
+			}
 			if (args[argidx] == "-liberty" && argidx+1 < args.size()) {
 				string liberty_file = args[++argidx];
 				rewrite_filename(liberty_file);
@@ -262,6 +302,15 @@ struct StatPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
+		if (!json_mode)
+			log_header("Printing statistics.\n");
+		else {
+			log("{\n");
+			log("   \"creator\": %s,\n", statdata_t::json_string(yosys_version_str).c_str());
+			log("   \"modules\": {");
+		}
+
+		bool first_module = true;
 		for (auto mod : design->selected_modules())
 		{
 			if (!top_mod && design->full_selection())
@@ -271,26 +320,47 @@ struct StatPass : public Pass {
 			statdata_t data(design, mod, width_mode, cell_area);
 			mod_stat[mod->name] = data;
 
+			if (json_mode) {
+				log("%s\n      %s: ", first_module ? "" : ",", statdata_t::json_string(mod->name.str()).c_str());
+				data.log_data_json("      ");
+				first_module = false;
+				continue;
+			}
+
 			log("\n");
 			log("=== %s%s ===\n", RTLIL::id2cstr(mod->name), design->selected_whole_module(mod->name) ? "" : " (partially selected)");
 			log("\n");
 			data.log_data();
 		}
 
+		if (json_mode)
+			log("%s}", first_module ? "" : "\n   ");
+
 		if (top_mod != NULL && GetSize(mod_stat) > 1)
 		{
-			log("\n");
-			log("=== design hierarchy ===\n");
-			log("\n");
+			if (json_mode) {
+				log(",\n   \"design\": ");
+			} else {
+				log("\n");
+				log("=== design hierarchy ===\n");
+				log("\n");
+				log("   %-28s %6d\n", RTLIL::id2cstr(top_mod->name), 1);
+			}
 
-			log("   %-28s %6d\n", RTLIL::id2cstr(top_mod->name), 1);
-			statdata_t data = hierarchy_worker(mod_stat, top_mod->name, 0);
+			statdata_t data = hierarchy_worker(mod_stat, top_mod->name, 0, json_mode);
 
-			log("\n");
-			data.log_data();
+			if (json_mode)
+				data.log_data_json("   ");
+			else {
+				log("\n");
+				data.log_data();
+			}
 		}
 
-		log("\n");
+		if (json_mode)
+			log("\n}\n");
+		else
+			log("\n");
 	}
 } StatPass;
 
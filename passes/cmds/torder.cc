@@ -80,7 +80,7 @@ struct TorderPass : public Pass {
 				if (stop_db.count(cell->type) && stop_db.at(cell->type).count(conn.first))
 					continue;
 
-				if (!noautostop && yosys_celltypes.cell_known(cell->type)) {
+				if (!noautostop && yosys_get_celltypes().cell_known(cell->type)) {
 					if (conn.first.in("\\Q", "\\CTRL_OUT", "\\RD_DATA"))
 						continue;
 					if (cell->type == "$memrd" && conn.first == "\\DATA")
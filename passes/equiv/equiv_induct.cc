@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
 #include "kernel/sigtools.h"
+#include "kernel/modtools.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -47,6 +48,7 @@ struct EquivInductWorker
 			satgen(ez.get(), &sigmap), max_seq(max_seq), success_counter(0)
 	{
 		satgen.model_undef = model_undef;
+		ez->setSolverCompactionInterval(16);
 	}
 
 	void create_timestep(int step)
@@ -87,15 +89,23 @@ struct EquivInductWorker
 
 		if (satgen.model_undef) {
 			for (auto cell : cells)
-				if (yosys_celltypes.cell_known(cell->type))
+				if (yosys_get_celltypes().cell_known(cell->type))
 					for (auto &conn : cell->connections())
-						if (yosys_celltypes.cell_input(cell->type, conn.first))
+						if (yosys_get_celltypes().cell_input(cell->type, conn.first))
 							undriven_signals.add(sigmap(conn.second));
 			for (auto cell : cells)
-				if (yosys_celltypes.cell_known(cell->type))
+				if (yosys_get_celltypes().cell_known(cell->type))
 					for (auto &conn : cell->connections())
-						if (yosys_celltypes.cell_output(cell->type, conn.first))
+						if (yosys_get_celltypes().cell_output(cell->type, conn.first))
 							undriven_signals.del(sigmap(conn.second));
+
+			// the undriven signals are assumed to be defined in every time
+			// step and the initial state in the first one
+			pool<SigBit> def_sources;
+			for (auto bit : undriven_signals.export_all())
+				def_sources.insert(bit);
+			satgen.setDefinedBits(cells, def_sources, true);
+			log("  Undef modelling: %d signal bits are never undef.\n", GetSize(satgen.defined_bits));
 		}
 
 		create_timestep(1);
@@ -112,6 +122,7 @@ struct EquivInductWorker
 			ez->assume(ez_step_is_consistent[step]);
 
 			log("  Proving existence of base case for step %d. (%d clauses over %d variables)\n", step, ez->numCnfClauses(), ez->numCnfVariables());
+			log_count("equiv_induct.solve", 1);
 			if (!ez->solve()) {
 				log("  Proof for base case failed. Circuit inherently diverges!\n");
 				return;
@@ -122,6 +133,7 @@ struct EquivInductWorker
 			ez->bind(new_step_not_consistent);
 
 			log("  Proving induction step %d. (%d clauses over %d variables)\n", step, ez->numCnfClauses(), ez->numCnfVariables());
+			log_count("equiv_induct.solve", 1);
 			if (!ez->solve(new_step_not_consistent)) {
 				log("  Proof for induction step holds. Entire workset of %d cells proven!\n", GetSize(workset));
 				for (auto cell : workset)
@@ -135,13 +147,18 @@ struct EquivInductWorker
 
 		workset.sort();
 
+		// All remaining $equiv cells are proven together in the solver that
+		// already holds the unrolled circuit: each counterexample rules out
+		// the cells it violates, and the cells left when there is no more
+		// counterexample are proven.
+		vector<Cell*> pending;
+		vector<int> pending_conds;
+
 		for (auto cell : workset)
 		{
 			SigBit bit_a = sigmap(cell->getPort("\\A")).as_bit();
 			SigBit bit_b = sigmap(cell->getPort("\\B")).as_bit();
 
-			log("  Trying to prove $equiv for %s:", log_signal(sigmap(cell->getPort("\\Y"))));
-
 			int ez_a = satgen.importSigBit(bit_a, max_seq+1);
 			int ez_b = satgen.importSigBit(bit_b, max_seq+1);
 			int cond = ez->XOR(ez_a, ez_b);
@@ -149,14 +166,51 @@ struct EquivInductWorker
 			if (satgen.model_undef)
 				cond = ez->AND(cond, ez->NOT(satgen.importUndefSigBit(bit_a, max_seq+1)));
 
-			if (!ez->solve(cond)) {
-				log(" success!\n");
-				cell->setPort("\\B", cell->getPort("\\A"));
-				success_counter++;
-			} else {
-				log(" failed.\n");
+			pending.push_back(cell);
+			pending_conds.push_back(cond);
+		}
+
+		while (!pending.empty())
+		{
+			// "one of the pending cells fails" is a single clause in its own
+			// group, so that it is dropped again when the solver is compacted
+			vector<bool> model;
+			vector<int> any_fails = pending_conds;
+			int group = ez->new_group();
+			any_fails.push_back(ez->NOT(group));
+			ez->assume(ez->expression(ezSAT::OpOr, any_fails));
+
+			log("  Trying to prove %d $equiv cells. (%d clauses over %d variables)\n", GetSize(pending), ez->numCnfClauses(), ez->numCnfVariables());
+			log_count("equiv_induct.solve", 1);
+			bool found_fail = ez->solve(pending_conds, model);
+			ez->retire_group(group);
+
+			if (!found_fail) {
+				for (auto cell : pending) {
+					log("    Proved $equiv for %s.\n", log_signal(sigmap(cell->getPort("\\Y"))));
+					cell->setPort("\\B", cell->getPort("\\A"));
+					success_counter++;
+				}
+				break;
 			}
+
+			vector<Cell*> next_pending;
+			vector<int> next_pending_conds;
+
+			for (int i = 0; i < GetSize(pending); i++)
+				if (model[i]) {
+					log("    Failed to prove $equiv for %s.\n", log_signal(sigmap(pending[i]->getPort("\\Y"))));
+				} else {
+					next_pending.push_back(pending[i]);
+					next_pending_conds.push_back(pending_conds[i]);
+				}
+
+			pending.swap(next_pending);
+			pending_conds.swap(next_pending_conds);
 		}
+
+		log("  Solver: %d calls, %d compactions, at most %d clauses (%d learnt) over %d variables.\n", ez->solverCalls,
+				ez->solverCompactions, ez->solverMaxClauses, ez->solverMaxLearnts, ez->solverMaxVariables);
 	}
 };
 
@@ -216,13 +270,11 @@ struct EquivInductPass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
+			EquivIndex &index = module->equiv_index();
 			pool<Cell*> unproven_equiv_cells;
 
-			for (auto cell : module->selected_cells())
-				if (cell->type == "$equiv") {
-					if (cell->getPort("\\A") != cell->getPort("\\B"))
-						unproven_equiv_cells.insert(cell);
-				}
+			for (auto cell : index.selected(index.unproven))
+				unproven_equiv_cells.insert(cell);
 
 			if (unproven_equiv_cells.empty()) {
 				log("No selected unproven $equiv cells found in %s.\n", log_id(module));
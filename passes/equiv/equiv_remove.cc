@@ -18,6 +18,7 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/modtools.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -67,13 +68,19 @@ struct EquivRemovePass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
-			for (auto cell : module->selected_cells())
-				if (cell->type == "$equiv" && (mode_gold || mode_gate || cell->getPort("\\A") == cell->getPort("\\B"))) {
-					log("Removing $equiv cell %s.%s (%s).\n", log_id(module), log_id(cell), log_signal(cell->getPort("\\Y")));
-					module->connect(cell->getPort("\\Y"), mode_gate ? cell->getPort("\\B") : cell->getPort("\\A"));
-					module->remove(cell);
-					remove_count++;
-				}
+			EquivIndex &index = module->equiv_index();
+			vector<Cell*> cells = index.selected(index.proven);
+
+			if (mode_gold || mode_gate)
+				for (auto cell : index.selected(index.unproven))
+					cells.push_back(cell);
+
+			for (auto cell : cells) {
+				log("Removing $equiv cell %s.%s (%s).\n", log_id(module), log_id(cell), log_signal(cell->getPort("\\Y")));
+				module->connect(cell->getPort("\\Y"), mode_gate ? cell->getPort("\\B") : cell->getPort("\\A"));
+				module->remove(cell);
+				remove_count++;
+			}
 		}
 
 		log("Removed a total of %d $equiv cells.\n", remove_count);
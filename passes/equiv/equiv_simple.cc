@@ -19,6 +19,13 @@
 
 #include "kernel/yosys.h"
 #include "kernel/satgen.h"
+#include "kernel/aigsim.h"
+#include "kernel/modtools.h"
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -39,6 +46,14 @@ struct EquivSimpleWorker
 
 	pool<pair<Cell*, int>> imported_cells_cache;
 
+	// full input cones of single bits, these are the same in all time steps and
+	// are needed again for the $equiv cells of a group that share state bits
+	struct FullCone {
+		vector<Cell*> cells;
+		vector<SigBit> bits;
+	};
+	dict<SigBit, FullCone> full_cone_cache;
+
 	EquivSimpleWorker(const vector<Cell*> &equiv_cells, SigMap &sigmap, dict<SigBit, Cell*> &bit2driver, int max_seq, bool verbose, bool model_undef) :
 			module(equiv_cells.front()->module), equiv_cells(equiv_cells), equiv_cell(nullptr),
 			sigmap(sigmap), bit2driver(bit2driver), satgen(ez.get(), &sigmap), max_seq(max_seq), verbose(verbose)
@@ -57,7 +72,7 @@ struct EquivSimpleWorker
 			return true;
 
 		for (auto &conn : cell->connections())
-			if (yosys_celltypes.cell_input(cell->type, conn.first))
+			if (yosys_get_celltypes().cell_input(cell->type, conn.first))
 				for (auto bit : sigmap(conn.second)) {
 					if (cell->type.in("$dff", "$_DFF_P_", "$_DFF_N_")) {
 						if (!conn.first.in("\\CLK", "\\C"))
@@ -87,6 +102,22 @@ struct EquivSimpleWorker
 			if (input_bits != nullptr) input_bits->insert(bit);
 	}
 
+	const FullCone &find_full_cone(SigBit bit)
+	{
+		auto it = full_cone_cache.find(bit);
+		if (it != full_cone_cache.end())
+			return it->second;
+
+		pool<Cell*> no_stop_cells, cells_cone;
+		pool<SigBit> no_stop_bits, bits_cone, next_seed;
+		find_input_cone(next_seed, cells_cone, bits_cone, no_stop_cells, no_stop_bits, nullptr, bit);
+
+		FullCone &cone = full_cone_cache[bit];
+		cone.cells.insert(cone.cells.end(), cells_cone.begin(), cells_cone.end());
+		cone.bits.insert(cone.bits.end(), bits_cone.begin(), bits_cone.end());
+		return cone;
+	}
+
 	bool run_cell()
 	{
 		SigBit bit_a = sigmap(equiv_cell->getPort("\\A")).as_bit();
@@ -122,21 +153,22 @@ struct EquivSimpleWorker
 		int step = max_seq;
 		while (1)
 		{
-			pool<Cell*> no_stop_cells;
-			pool<SigBit> no_stop_bits;
-
 			pool<Cell*> full_cells_cone_a, full_cells_cone_b;
 			pool<SigBit> full_bits_cone_a, full_bits_cone_b;
 
 			pool<SigBit> next_seed_a, next_seed_b;
 
-			for (auto bit_a : seed_a)
-				find_input_cone(next_seed_a, full_cells_cone_a, full_bits_cone_a, no_stop_cells, no_stop_bits, nullptr, bit_a);
-			next_seed_a.clear();
+			for (auto bit_a : seed_a) {
+				const FullCone &cone = find_full_cone(bit_a);
+				full_cells_cone_a.insert(cone.cells.begin(), cone.cells.end());
+				full_bits_cone_a.insert(cone.bits.begin(), cone.bits.end());
+			}
 
-			for (auto bit_b : seed_b)
-				find_input_cone(next_seed_b, full_cells_cone_b, full_bits_cone_b, no_stop_cells, no_stop_bits, nullptr, bit_b);
-			next_seed_b.clear();
+			for (auto bit_b : seed_b) {
+				const FullCone &cone = find_full_cone(bit_b);
+				full_cells_cone_b.insert(cone.cells.begin(), cone.cells.end());
+				full_bits_cone_b.insert(cone.bits.begin(), cone.bits.end());
+			}
 
 			pool<Cell*> short_cells_cone_a, short_cells_cone_b;
 			pool<SigBit> short_bits_cone_a, short_bits_cone_b;
@@ -174,6 +206,8 @@ struct EquivSimpleWorker
 			if (verbose)
 				log("    Problem size at t=%d: %d literals, %d clauses\n", step, ez->numCnfVariables(), ez->numCnfClauses());
 
+			log_count("equiv_simple.solve", 1);
+			log_count("equiv_simple.cone_cells", GetSize(problem_cells));
 			if (!ez->solve(ez_context)) {
 				log(verbose ? "    Proved equivalence! Marking $equiv cell as proven.\n" : " success!\n");
 				equiv_cell->setPort("\\B", equiv_cell->getPort("\\A"));
@@ -248,6 +282,173 @@ struct EquivSimpleWorker
 
 };
 
+// merge groups of $equiv cells with overlapping input cones (in the first time step), so
+// that the shared part of the cones is only encoded once. each cell is visited only once:
+// the traversal stops at cells that are already in the cone of an earlier group. when
+// that group is full, the cell is handed over so that later groups can merge with this one.
+static void merge_groups_by_cones(vector<vector<Cell*>> &groups, SigMap &sigmap, dict<SigBit, Cell*> &bit2driver, int max_group_size)
+{
+	mfp<int> group_map;
+	vector<int> group_sizes;
+	dict<Cell*, int> cell_owner;
+
+	for (int i = 0; i < GetSize(groups); i++) {
+		group_map(i);
+		group_sizes.push_back(GetSize(groups[i]));
+	}
+
+	for (int i = 0; i < GetSize(groups); i++)
+	{
+		vector<SigBit> queue;
+		for (auto cell : groups[i]) {
+			queue.push_back(sigmap(cell->getPort("\\A")).as_bit());
+			queue.push_back(sigmap(cell->getPort("\\B")).as_bit());
+		}
+
+		while (!queue.empty())
+		{
+			SigBit bit = queue.back();
+			queue.pop_back();
+
+			if (!bit2driver.count(bit))
+				continue;
+
+			Cell *cell = bit2driver.at(bit);
+			if (cell_owner.count(cell)) {
+				int root_i = group_map.ifind(i), root_j = group_map.ifind(cell_owner.at(cell));
+				if (root_i != root_j) {
+					if (group_sizes[root_i] + group_sizes[root_j] <= max_group_size) {
+						group_map.imerge(root_i, root_j);
+						group_sizes[group_map.ifind(root_i)] = group_sizes[root_i] + group_sizes[root_j];
+					} else
+						cell_owner[cell] = i;
+				}
+				continue;
+			}
+
+			cell_owner[cell] = i;
+			if (cell->type.in("$dff", "$_DFF_P_", "$_DFF_N_"))
+				continue;
+
+			for (auto &conn : cell->connections())
+				if (yosys_get_celltypes().cell_input(cell->type, conn.first))
+					for (auto bit : sigmap(conn.second))
+						queue.push_back(bit);
+		}
+	}
+
+	vector<vector<Cell*>> merged_groups;
+	dict<int, int> root_to_group;
+	for (int i = 0; i < GetSize(groups); i++) {
+		int root = group_map.ifind(i);
+		if (root_to_group.count(root) == 0) {
+			root_to_group[root] = GetSize(merged_groups);
+			merged_groups.push_back(vector<Cell*>());
+		}
+		vector<Cell*> &cells = merged_groups[root_to_group.at(root)];
+		cells.insert(cells.end(), groups[i].begin(), groups[i].end());
+	}
+
+	log("Merged %d groups with overlapping input cones into %d groups.\n", GetSize(groups), GetSize(merged_groups));
+	groups.swap(merged_groups);
+}
+
+// prove the groups in worker processes, each worker writes the log and one
+// line with the proven cells for each of its groups. groups without result
+// file (e.g. because the worker failed) are left for the main process.
+static void parallel_equiv_simple(const vector<vector<Cell*>> &groups, vector<bool> &groups_done, int num_jobs,
+		SigMap &sigmap, dict<SigBit, Cell*> &bit2driver, int max_seq, bool verbose, bool model_undef, int &success_counter)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	int num_workers = std::min(num_jobs, GetSize(groups));
+	if (num_workers < 2)
+		return;
+
+	log("Proving %d groups using %d worker processes.\n", GetSize(groups), num_workers);
+
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-equiv-XXXXXX");
+	std::vector<pid_t> worker_pids;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_streams.clear();
+			log_cmd_error_throw = true;
+
+			// the workers already run in parallel, don't fork SAT portfolios
+			yosys_jobs = 1;
+
+			for (int i = w; i < GetSize(groups); i += num_workers) {
+				std::string out_name = stringf("%s/group_%d", tempdir_name.c_str(), i);
+				FILE *f = fopen((out_name + ".log").c_str(), "w");
+				log_files.clear();
+				if (f != NULL)
+					log_files.push_back(f);
+				try {
+					EquivSimpleWorker worker(groups[i], sigmap, bit2driver, max_seq, verbose, model_undef);
+					worker.run();
+				} catch (...) {
+					log_flush();
+					_exit(1);
+				}
+				log_flush();
+				if (f != NULL)
+					fclose(f);
+				log_files.clear();
+
+				std::ofstream out(out_name + ".part");
+				for (auto cell : groups[i])
+					out << (cell->getPort("\\A") == cell->getPort("\\B"));
+				out << "\n";
+				out.close();
+				if (!out.fail())
+					rename((out_name + ".part").c_str(), (out_name + ".res").c_str());
+			}
+			_exit(0);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	for (auto pid : worker_pids) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+	}
+
+	for (int i = 0; i < GetSize(groups); i++)
+	{
+		std::string out_name = stringf("%s/group_%d", tempdir_name.c_str(), i);
+		std::ifstream f((out_name + ".res").c_str());
+		std::string result;
+		if (!std::getline(f, result) || GetSize(result) != GetSize(groups[i]))
+			continue;
+
+		std::ifstream logf((out_name + ".log").c_str());
+		std::string line;
+		while (std::getline(logf, line))
+			log("%s%s", line.c_str(), logf.eof() ? "" : "\n");
+
+		for (int j = 0; j < GetSize(groups[i]); j++)
+			if (result[j] == '1') {
+				groups[i][j]->setPort("\\B", groups[i][j]->getPort("\\A"));
+				success_counter++;
+			}
+		groups_done[i] = true;
+	}
+
+	remove_directory(tempdir_name);
+#endif
+}
+
 struct EquivSimplePass : public Pass {
 	EquivSimplePass() : Pass("equiv_simple", "try proving simple $equiv instances") { }
 	virtual void help()
@@ -267,15 +468,31 @@ struct EquivSimplePass : public Pass {
 		log("    -nogroup\n");
 		log("        disabling grouping of $equiv cells by output wire\n");
 		log("\n");
+		log("    -cone\n");
+		log("        also merge groups of $equiv cells with overlapping input cones (up to\n");
+		log("        64 cells per group). The cells of a group are proven with the same\n");
+		log("        incremental SAT solver, so the shared part of the cones is only\n");
+		log("        encoded once.\n");
+		log("\n");
+		log("    -nosim\n");
+		log("        don't use random simulation (of 256 patterns) to find $equiv cells\n");
+		log("        that can't be proven before using the SAT solver\n");
+		log("\n");
 		log("    -seq <N>\n");
 		log("        the max. number of time steps to be considered (default = 1)\n");
 		log("\n");
+		log("    -j <N>\n");
+		log("        prove the groups of $equiv cells in N worker processes. The results\n");
+		log("        and the log output are applied in the original order afterwards.\n");
+		log("        The default is the value given with 'yosys -j'.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, Design *design)
 	{
-		bool verbose = false, model_undef = false, nogroup = false;
+		bool verbose = false, model_undef = false, nogroup = false, cone = false, nosim = false;
 		int success_counter = 0;
 		int max_seq = 1;
+		int num_jobs = yosys_jobs;
 
 		log_header("Executing EQUIV_SIMPLE pass.\n");
 
@@ -293,10 +510,22 @@ struct EquivSimplePass : public Pass {
 				nogroup = true;
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				nosim = true;
+				continue;
+			}
+			if (args[argidx] == "-cone") {
+				cone = true;
+				continue;
+			}
 			if (args[argidx] == "-seq" && argidx+1 < args.size()) {
 				max_seq = atoi(args[++argidx].c_str());
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_jobs = atoi(args[++argidx].c_str());
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -312,15 +541,16 @@ struct EquivSimplePass : public Pass {
 			dict<SigBit, dict<SigBit, Cell*>> unproven_equiv_cells;
 			int unproven_cells_counter = 0;
 
-			for (auto cell : module->selected_cells())
-				if (cell->type == "$equiv" && cell->getPort("\\A") != cell->getPort("\\B")) {
-					auto bit = sigmap(cell->getPort("\\Y").as_bit());
-					auto bit_group = bit;
-					if (!nogroup && bit_group.wire)
-						bit_group.offset = 0;
-					unproven_equiv_cells[bit_group][bit] = cell;
-					unproven_cells_counter++;
-				}
+			EquivIndex &index = module->equiv_index();
+
+			for (auto cell : index.selected(index.unproven)) {
+				auto bit = sigmap(cell->getPort("\\Y").as_bit());
+				auto bit_group = bit;
+				if (!nogroup && bit_group.wire)
+					bit_group.offset = 0;
+				unproven_equiv_cells[bit_group][bit] = cell;
+				unproven_cells_counter++;
+			}
 
 			if (unproven_equiv_cells.empty())
 				continue;
@@ -332,21 +562,69 @@ struct EquivSimplePass : public Pass {
 				if (!ct.cell_known(cell->type) && !cell->type.in("$dff", "$_DFF_P_", "$_DFF_N_"))
 					continue;
 				for (auto &conn : cell->connections())
-					if (yosys_celltypes.cell_output(cell->type, conn.first))
+					if (yosys_get_celltypes().cell_output(cell->type, conn.first))
 						for (auto bit : sigmap(conn.second))
 							bit2driver[bit] = cell;
 			}
 
+			// $equiv cells with different A and B values in the random simulation can't be proven in
+			// any number of time steps, because FF outputs are unknown in the simulation
+			AigSim *sim = nullptr;
+			int disproved_cells_counter = 0;
+			if (!nosim) {
+				sim = new AigSim(sigmap);
+				for (auto cell : module->cells())
+					if (ct.cell_known(cell->type) || cell->type.in("$dff", "$_DFF_P_", "$_DFF_N_"))
+						sim->add_cell(cell);
+				sim->run();
+				if (verbose)
+					log("Simulated %d random patterns on %d cells (%d AIG nodes, %d cells without AIG model).\n",
+							sim->num_patterns(), sim->num_simulated_cells, int(sim->num_aig_nodes), sim->num_unsupported_cells);
+			}
+
 			unproven_equiv_cells.sort();
+			vector<vector<Cell*>> groups;
 			for (auto it : unproven_equiv_cells)
 			{
 				it.second.sort();
 
-				vector<Cell*> cells;
+				groups.push_back(vector<Cell*>());
 				for (auto it2 : it.second)
-					cells.push_back(it2.second);
+				{
+					if (sim != nullptr) {
+						const uint64_t *value_a = sim->value(it2.second->getPort("\\A").as_bit());
+						const uint64_t *value_b = sim->value(it2.second->getPort("\\B").as_bit());
+						if (value_a != nullptr && value_b != nullptr && !std::equal(value_a, value_a + sim->num_words, value_b)) {
+							if (verbose)
+								log("  Random simulation disproved $equiv for %s.\n", log_signal(it2.second->getPort("\\Y")));
+							disproved_cells_counter++;
+							continue;
+						}
+					}
+					groups.back().push_back(it2.second);
+				}
+
+				if (groups.back().empty())
+					groups.pop_back();
+			}
+
+			if (sim != nullptr) {
+				log("Random simulation disproved %d $equiv cells.\n", disproved_cells_counter);
+				delete sim;
+			}
+
+			if (cone)
+				merge_groups_by_cones(groups, sigmap, bit2driver, 64);
+
+			vector<bool> groups_done(GetSize(groups));
+			parallel_equiv_simple(groups, groups_done, num_jobs, sigmap, bit2driver, max_seq, verbose, model_undef, success_counter);
+
+			for (int i = 0; i < GetSize(groups); i++)
+			{
+				if (groups_done[i])
+					continue;
 
-				EquivSimpleWorker worker(cells, sigmap, bit2driver, max_seq, verbose, model_undef);
+				EquivSimpleWorker worker(groups[i], sigmap, bit2driver, max_seq, verbose, model_undef);
 				success_counter += worker.run();
 			}
 		}
@@ -18,6 +18,7 @@
  */
 
 #include "kernel/yosys.h"
+#include "kernel/modtools.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -55,16 +56,9 @@ struct EquivStatusPass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
-			vector<Cell*> unproven_equiv_cells;
-			int proven_equiv_cells = 0;
-
-			for (auto cell : module->selected_cells())
-				if (cell->type == "$equiv") {
-					if (cell->getPort("\\A") != cell->getPort("\\B"))
-						unproven_equiv_cells.push_back(cell);
-					else
-						proven_equiv_cells++;
-				}
+			EquivIndex &index = module->equiv_index();
+			vector<Cell*> unproven_equiv_cells = index.selected(index.unproven);
+			int proven_equiv_cells = design->selected_whole_module(module) ? GetSize(index.proven) : GetSize(index.selected(index.proven));
 
 			if (unproven_equiv_cells.empty() && !proven_equiv_cells) {
 				log("No $equiv cells found in %s.\n", log_id(module));
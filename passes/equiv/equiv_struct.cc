@@ -27,7 +27,6 @@ struct EquivStructWorker
 {
 	Module *module;
 	SigMap sigmap;
-	SigMap equiv_bits;
 	bool mode_fwd;
 	bool mode_icells;
 	int merge_count;
@@ -55,8 +54,108 @@ struct EquivStructWorker
 		}
 	};
 
-	dict<merge_key_t, pool<IdString>> merge_cache;
-	pool<merge_key_t> fwd_merge_cache, bwd_merge_cache;
+	// The worker is kept across iterations. The forward keys are only
+	// recomputed for the cells whose inputs were changed by the merges of
+	// the previous iteration, found via input_cells, and only the groups
+	// that got a new member (or still have more than one member after a
+	// merge) are looked at again.
+	pool<IdString> cells, dirty_cells;
+	dict<IdString, merge_key_t> fwd_keys;
+	dict<merge_key_t, pool<IdString>> fwd_groups;
+	dict<SigBit, pool<IdString>> input_cells;
+	pool<merge_key_t> fwd_queue;
+
+	void add_cell(Cell *cell)
+	{
+		if (!module->selected(cell))
+			return;
+		if (cell->type == "$equiv" || mode_icells || module->design->module(cell->type)) {
+			cells.insert(cell->name);
+			dirty_cells.insert(cell->name);
+		}
+	}
+
+	void remove_cell(Cell *cell)
+	{
+		auto it = fwd_keys.find(cell->name);
+		if (it != fwd_keys.end()) {
+			fwd_groups[it->second].erase(cell->name);
+			if (fwd_groups[it->second].empty())
+				fwd_groups.erase(it->second);
+			fwd_keys.erase(it);
+		}
+		cells.erase(cell->name);
+		dirty_cells.erase(cell->name);
+		module->remove(cell);
+	}
+
+	void connect(const SigSpec &lhs, const SigSpec &rhs)
+	{
+		for (auto bit : sigmap(lhs))
+			for (auto cell_name : input_cells[bit])
+				dirty_cells.insert(cell_name);
+		for (auto bit : sigmap(rhs))
+			for (auto cell_name : input_cells[bit])
+				dirty_cells.insert(cell_name);
+
+		module->connect(lhs, rhs);
+		sigmap.add(lhs, rhs);
+	}
+
+	merge_key_t cell_key(Cell *cell)
+	{
+		merge_key_t key;
+		key.type = cell->type;
+
+		for (auto &it : cell->parameters)
+			key.parameters.push_back(it);
+		std::sort(key.parameters.begin(), key.parameters.end());
+
+		for (auto &it : cell->connections())
+			key.port_sizes.push_back(make_pair(it.first, GetSize(it.second)));
+		std::sort(key.port_sizes.begin(), key.port_sizes.end());
+
+		return key;
+	}
+
+	void update_fwd_keys()
+	{
+		for (auto cell_name : dirty_cells)
+		{
+			// input_cells still lists the cells that were removed
+			Cell *cell = module->cell(cell_name);
+			if (cell == nullptr)
+				continue;
+
+			auto it = fwd_keys.find(cell_name);
+			if (it != fwd_keys.end()) {
+				fwd_groups[it->second].erase(cell_name);
+				if (fwd_groups[it->second].empty())
+					fwd_groups.erase(it->second);
+			}
+
+			merge_key_t key = cell_key(cell);
+
+			for (auto &conn : cell->connections())
+				if (cell->input(conn.first)) {
+					SigSpec sig = sigmap(conn.second);
+					for (int i = 0; i < GetSize(sig); i++) {
+						key.connections.push_back(make_tuple(conn.first, i, sig[i]));
+						input_cells[sig[i]].insert(cell_name);
+					}
+				}
+
+			std::sort(key.connections.begin(), key.connections.end());
+
+			pool<IdString> &group = fwd_groups[key];
+			group.insert(cell_name);
+			if (GetSize(group) > 1)
+				fwd_queue.insert(key);
+			fwd_keys[cell_name] = key;
+		}
+
+		dirty_cells.clear();
+	}
 
 	void merge_cell_pair(Cell *cell_a, Cell *cell_b)
 	{
@@ -88,7 +187,7 @@ struct EquivStructWorker
 			SigBit bit_y = module->addWire(NEW_ID);
 			log("        New $equiv for input %s: A: %s, B: %s, Y: %s\n",
 					input_names[i].c_str(), log_signal(bit_a), log_signal(bit_b), log_signal(bit_y));
-			module->addEquiv(NEW_ID, bit_a, bit_b, bit_y);
+			add_cell(module->addEquiv(NEW_ID, bit_a, bit_b, bit_y));
 			merged_map.add(bit_a, bit_y);
 			merged_map.add(bit_b, bit_y);
 		}
@@ -103,181 +202,190 @@ struct EquivStructWorker
 
 		for (auto &pn : inport_names)
 			cell_a->setPort(pn, merged_map(sigmap(cell_a->getPort(pn))));
+		if (!inputs_a.empty())
+			dirty_cells.insert(cell_a->name);
 
 		for (auto &pn : outport_names) {
 			SigSpec sig_a = cell_a->getPort(pn);
 			SigSpec sig_b = cell_b->getPort(pn);
-			module->connect(sig_b, sig_a);
+			connect(sig_b, sig_a);
 		}
 
 		auto merged_attr = cell_b->get_strpool_attribute("\\equiv_merged");
 		merged_attr.insert(log_id(cell_b));
 		cell_a->add_strpool_attribute("\\equiv_merged", merged_attr);
-		module->remove(cell_b);
+		remove_cell(cell_b);
+	}
+
+	// returns true if the group still has more than one cell afterwards
+	bool merge_group(const pool<IdString> &group, int phase)
+	{
+		const char *strategy = nullptr;
+		vector<Cell*> gold_cells, gate_cells, other_cells;
+		vector<pair<Cell*, Cell*>> cell_pairs;
+		IdString cells_type;
+
+		for (auto cell_name : group) {
+			Cell *c = module->cell(cell_name);
+			if (c != nullptr) {
+				string n = cell_name.str();
+				cells_type = c->type;
+				if (GetSize(n) > 5 && n.substr(GetSize(n)-5) == "_gold")
+					gold_cells.push_back(c);
+				else if (GetSize(n) > 5 && n.substr(GetSize(n)-5) == "_gate")
+					gate_cells.push_back(c);
+				else
+					other_cells.push_back(c);
+			}
+		}
+
+		if (phase && fwonly_cells.count(cells_type))
+			return false;
+
+		if (GetSize(gold_cells) > 1 || GetSize(gate_cells) > 1 || GetSize(other_cells) > 1)
+		{
+			strategy = "deduplicate";
+			for (int i = 0; i+1 < GetSize(gold_cells); i += 2)
+				cell_pairs.push_back(make_pair(gold_cells[i], gold_cells[i+1]));
+			for (int i = 0; i+1 < GetSize(gate_cells); i += 2)
+				cell_pairs.push_back(make_pair(gate_cells[i], gate_cells[i+1]));
+			for (int i = 0; i+1 < GetSize(other_cells); i += 2)
+				cell_pairs.push_back(make_pair(other_cells[i], other_cells[i+1]));
+			goto run_strategy;
+		}
+
+		if (GetSize(gold_cells) == 1 && GetSize(gate_cells) == 1)
+		{
+			strategy = "gold-gate-pairs";
+			cell_pairs.push_back(make_pair(gold_cells[0], gate_cells[0]));
+			goto run_strategy;
+		}
+
+		if (GetSize(gold_cells) == 1 && GetSize(other_cells) == 1)
+		{
+			strategy = "gold-guess";
+			cell_pairs.push_back(make_pair(gold_cells[0], other_cells[0]));
+			goto run_strategy;
+		}
+
+		if (GetSize(other_cells) == 1 && GetSize(gate_cells) == 1)
+		{
+			strategy = "gate-guess";
+			cell_pairs.push_back(make_pair(other_cells[0], gate_cells[0]));
+			goto run_strategy;
+		}
+
+		log_assert(GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells) < 2);
+		return false;
+
+	run_strategy:
+		int total_group_size = GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells);
+		log("    %s merging %d %s cells (from group of %d) using strategy %s:\n", phase ? "Bwd" : "Fwd",
+				2*GetSize(cell_pairs), log_id(cells_type), total_group_size, strategy);
+		for (auto it : cell_pairs) {
+			log("      Merging cells %s and %s.\n", log_id(it.first),  log_id(it.second));
+			merge_cell_pair(it.first, it.second);
+		}
+		return total_group_size - GetSize(cell_pairs) > 1;
+	}
+
+	EquivStructWorker(Module *module, bool mode_fwd, bool mode_icells, const pool<IdString> &fwonly_cells) :
+			module(module), sigmap(module), mode_fwd(mode_fwd), mode_icells(mode_icells), merge_count(0), fwonly_cells(fwonly_cells)
+	{
+		for (auto cell : module->selected_cells())
+			add_cell(cell);
 	}
 
-	EquivStructWorker(Module *module, bool mode_fwd, bool mode_icells, const pool<IdString> &fwonly_cells, int iter_num) :
-			module(module), sigmap(module), equiv_bits(module),
-			mode_fwd(mode_fwd), mode_icells(mode_icells), merge_count(0), fwonly_cells(fwonly_cells)
+	int iterate(int iter_num)
 	{
 		log("  Starting iteration %d.\n", iter_num);
+		merge_count = 0;
 
 		pool<SigBit> equiv_inputs;
-		pool<IdString> cells;
+		vector<Cell*> equiv_cells;
 
-		for (auto cell : module->selected_cells())
+		for (auto cell_name : cells) {
+			Cell *cell = module->cell(cell_name);
 			if (cell->type == "$equiv") {
 				SigBit sig_a = sigmap(cell->getPort("\\A").as_bit());
 				SigBit sig_b = sigmap(cell->getPort("\\B").as_bit());
-				equiv_bits.add(sig_b, sig_a);
 				equiv_inputs.insert(sig_a);
 				equiv_inputs.insert(sig_b);
-				cells.insert(cell->name);
-			} else {
-				if (mode_icells || module->design->module(cell->type))
-					cells.insert(cell->name);
+				equiv_cells.push_back(cell);
 			}
+		}
 
-		for (auto cell : module->selected_cells())
-			if (cell->type == "$equiv") {
-				SigBit sig_a = sigmap(cell->getPort("\\A").as_bit());
-				SigBit sig_b = sigmap(cell->getPort("\\B").as_bit());
-				SigBit sig_y = sigmap(cell->getPort("\\Y").as_bit());
-				if (sig_a == sig_b && equiv_inputs.count(sig_y)) {
-					log("    Purging redundant $equiv cell %s.\n", log_id(cell));
-					module->connect(sig_y, sig_a);
-					module->remove(cell);
-					merge_count++;
-				}
+		for (auto cell : equiv_cells) {
+			SigBit sig_a = sigmap(cell->getPort("\\A").as_bit());
+			SigBit sig_b = sigmap(cell->getPort("\\B").as_bit());
+			SigBit sig_y = sigmap(cell->getPort("\\Y").as_bit());
+			if (sig_a == sig_b && equiv_inputs.count(sig_y)) {
+				log("    Purging redundant $equiv cell %s.\n", log_id(cell));
+				connect(sig_y, sig_a);
+				remove_cell(cell);
+				merge_count++;
 			}
+		}
 
 		if (merge_count > 0)
-			return;
+			return merge_count;
 
-		for (auto cell_name : cells)
-		{
-			merge_key_t key;
-			vector<tuple<IdString, int, SigBit>> fwd_connections;
+		update_fwd_keys();
 
-			Cell *cell = module->cell(cell_name);
-			key.type = cell->type;
+		pool<merge_key_t> queue;
+		queue.swap(fwd_queue);
 
-			for (auto &it : cell->parameters)
-				key.parameters.push_back(it);
-			std::sort(key.parameters.begin(), key.parameters.end());
+		for (auto &key : queue) {
+			auto it = fwd_groups.find(key);
+			if (it == fwd_groups.end())
+				continue;
+			// copy, the merges change the groups
+			pool<IdString> group = it->second;
+			if (merge_group(group, 0))
+				fwd_queue.insert(key);
+		}
 
-			for (auto &it : cell->connections())
-				key.port_sizes.push_back(make_pair(it.first, GetSize(it.second)));
-			std::sort(key.port_sizes.begin(), key.port_sizes.end());
+		if (merge_count > 0)
+			return merge_count;
+
+		// the backward keys depend on all $equiv cells and are only needed
+		// once the forward merges reached a fixed point
+		SigMap equiv_bits = sigmap;
+		for (auto cell : equiv_cells) {
+			SigBit sig_a = sigmap(cell->getPort("\\A").as_bit());
+			SigBit sig_b = sigmap(cell->getPort("\\B").as_bit());
+			equiv_bits.add(sig_b, sig_a);
+		}
 
-			for (auto &conn : cell->connections())
-			{
-				if (cell->input(conn.first)) {
-					SigSpec sig = sigmap(conn.second);
-					for (int i = 0; i < GetSize(sig); i++)
-						fwd_connections.push_back(make_tuple(conn.first, i, sig[i]));
-				}
+		dict<merge_key_t, pool<IdString>> bwd_groups;
+		pool<merge_key_t> bwd_queue;
 
+		for (auto cell_name : cells)
+		{
+			Cell *cell = module->cell(cell_name);
+			merge_key_t key = cell_key(cell);
+
+			for (auto &conn : cell->connections())
 				if (cell->output(conn.first)) {
 					SigSpec sig = equiv_bits(conn.second);
 					for (int i = 0; i < GetSize(sig); i++) {
 						key.connections.clear();
 						key.connections.push_back(make_tuple(conn.first, i, sig[i]));
 
-						if (merge_cache.count(key))
-							bwd_merge_cache.insert(key);
-						merge_cache[key].insert(cell_name);
+						pool<IdString> &group = bwd_groups[key];
+						group.insert(cell_name);
+						if (GetSize(group) > 1)
+							bwd_queue.insert(key);
 					}
 				}
-			}
-
-			std::sort(fwd_connections.begin(), fwd_connections.end());
-			key.connections.swap(fwd_connections);
-
-			if (merge_cache.count(key))
-				fwd_merge_cache.insert(key);
-			merge_cache[key].insert(cell_name);
 		}
 
-		for (int phase = 0; phase < 2; phase++)
-		{
-			auto &queue = phase ? bwd_merge_cache : fwd_merge_cache;
-
-			for (auto &key : queue)
-			{
-				const char *strategy = nullptr;
-				vector<Cell*> gold_cells, gate_cells, other_cells;
-				vector<pair<Cell*, Cell*>> cell_pairs;
-				IdString cells_type;
-
-				for (auto cell_name : merge_cache[key]) {
-					Cell *c = module->cell(cell_name);
-					if (c != nullptr) {
-						string n = cell_name.str();
-						cells_type = c->type;
-						if (GetSize(n) > 5 && n.substr(GetSize(n)-5) == "_gold")
-							gold_cells.push_back(c);
-						else if (GetSize(n) > 5 && n.substr(GetSize(n)-5) == "_gate")
-							gate_cells.push_back(c);
-						else
-							other_cells.push_back(c);
-					}
-				}
-
-				if (phase && fwonly_cells.count(cells_type))
-					continue;
-
-				if (GetSize(gold_cells) > 1 || GetSize(gate_cells) > 1 || GetSize(other_cells) > 1)
-				{
-					strategy = "deduplicate";
-					for (int i = 0; i+1 < GetSize(gold_cells); i += 2)
-						cell_pairs.push_back(make_pair(gold_cells[i], gold_cells[i+1]));
-					for (int i = 0; i+1 < GetSize(gate_cells); i += 2)
-						cell_pairs.push_back(make_pair(gate_cells[i], gate_cells[i+1]));
-					for (int i = 0; i+1 < GetSize(other_cells); i += 2)
-						cell_pairs.push_back(make_pair(other_cells[i], other_cells[i+1]));
-					goto run_strategy;
-				}
-
-				if (GetSize(gold_cells) == 1 && GetSize(gate_cells) == 1)
-				{
-					strategy = "gold-gate-pairs";
-					cell_pairs.push_back(make_pair(gold_cells[0], gate_cells[0]));
-					goto run_strategy;
-				}
-
-				if (GetSize(gold_cells) == 1 && GetSize(other_cells) == 1)
-				{
-					strategy = "gold-guess";
-					cell_pairs.push_back(make_pair(gold_cells[0], other_cells[0]));
-					goto run_strategy;
-				}
-
-				if (GetSize(other_cells) == 1 && GetSize(gate_cells) == 1)
-				{
-					strategy = "gate-guess";
-					cell_pairs.push_back(make_pair(other_cells[0], gate_cells[0]));
-					goto run_strategy;
-				}
-
-				log_assert(GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells) < 2);
-				continue;
-
-			run_strategy:
-				int total_group_size = GetSize(gold_cells) + GetSize(gate_cells) + GetSize(other_cells);
-				log("    %s merging %d %s cells (from group of %d) using strategy %s:\n", phase ? "Bwd" : "Fwd",
-						2*GetSize(cell_pairs), log_id(cells_type), total_group_size, strategy);
-				for (auto it : cell_pairs) {
-					log("      Merging cells %s and %s.\n", log_id(it.first),  log_id(it.second));
-					merge_cell_pair(it.first, it.second);
-				}
-			}
-
-			if (merge_count > 0)
-				return;
-		}
+		for (auto &key : bwd_queue)
+			merge_group(bwd_groups.at(key), 1);
 
-		log("    Nothing to merge.\n");
+		if (merge_count == 0)
+			log("    Nothing to merge.\n");
+		return merge_count;
 	}
 };
 
@@ -348,15 +456,16 @@ struct EquivStructPass : public Pass {
 		for (auto module : design->selected_modules()) {
 			int module_merge_count = 0;
 			log("Running equiv_struct on module %s:\n", log_id(module));
+			EquivStructWorker worker(module, mode_fwd, mode_icells, fwonly_cells);
 			for (int iter = 0;; iter++) {
 				if (iter == max_iter) {
 					log("  Reached iteration limit of %d.\n", iter);
 					break;
 				}
-				EquivStructWorker worker(module, mode_fwd, mode_icells, fwonly_cells, iter+1);
-				if (worker.merge_count == 0)
+				int merge_count = worker.iterate(iter+1);
+				if (merge_count == 0)
 					break;
-				module_merge_count += worker.merge_count;
+				module_merge_count += merge_count;
 			}
 			if (module_merge_count)
 				log("  Performed a total of %d merges in module %s.\n", module_merge_count, log_id(module));
@@ -27,6 +27,12 @@ PRIVATE_NAMESPACE_BEGIN
 
 struct FsmPass : public Pass {
 	FsmPass() : Pass("fsm", "extract and optimize finite state machines") { }
+	virtual bool module_local(const std::vector<std::string> &args) {
+		for (auto &arg : args)
+			if (arg == "-encfile" || arg == "-fm_set_fsm_file")
+				return false;
+		return true;
+	}
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -163,12 +163,9 @@ struct FsmDetectPass : public Pass {
 		ct.setup_stdcells();
 		ct.setup_stdcells_mem();
 
-		for (auto &mod_it : design->modules_)
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod)
 		{
-			if (!design->selected(mod_it.second))
-				continue;
-
-			module = mod_it.second;
+			module = mod;
 			assign_map.set(module);
 
 			sig2driver.clear();
@@ -195,7 +192,7 @@ struct FsmDetectPass : public Pass {
 			for (auto &wire_it : module->wires_)
 				if (design->selected(module, wire_it.second))
 					detect_fsm(wire_it.second);
-		}
+		});
 
 		assign_map.clear();
 		sig2driver.clear();
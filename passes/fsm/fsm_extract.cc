@@ -27,6 +27,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/consteval.h"
 #include "kernel/celltypes.h"
+#include "kernel/satgen.h"
 #include "fsmdata.h"
 
 USING_YOSYS_NAMESPACE
@@ -37,6 +38,13 @@ static SigMap assign_map;
 typedef std::pair<RTLIL::IdString, RTLIL::IdString> sig2driver_entry_t;
 static SigSet<sig2driver_entry_t> sig2driver, sig2trigger;
 static std::map<RTLIL::SigBit, std::set<RTLIL::SigBit>> exclusive_ctrls;
+static CellTypes ct_comb;
+
+// limits for the transition enumeration, see help message
+static bool sat_mode;
+static int enum_budget, sat_budget;
+static int enum_splits;
+static bool enum_aborted;
 
 static bool find_states(RTLIL::SigSpec sig, const RTLIL::SigSpec &dff_out, RTLIL::SigSpec &ctrl, std::map<RTLIL::Const, int> &states, RTLIL::Const *reset_state = NULL)
 {
@@ -138,69 +146,77 @@ static RTLIL::Const sig2const(ConstEval &ce, RTLIL::SigSpec sig, RTLIL::State no
 	return sig.as_const();
 }
 
-static void find_transitions(ConstEval &ce, ConstEval &ce_nostop, FsmData &fsm_data, std::map<RTLIL::Const, int> &states, int state_in, RTLIL::SigSpec ctrl_in, RTLIL::SigSpec ctrl_out, RTLIL::SigSpec dff_in, RTLIL::SigSpec dont_care)
+static void add_transition(ConstEval &ce, FsmData &fsm_data, std::map<RTLIL::Const, int> &states, int state_in, RTLIL::SigSpec ctrl_in, RTLIL::SigSpec ctrl_out, RTLIL::SigSpec dff_in, RTLIL::SigSpec dont_care, bool undef_bit_in_next_state_mode)
 {
-	bool undef_bit_in_next_state_mode = false;
-	RTLIL::SigSpec undef, constval;
-
-	if (ce.eval(ctrl_out, undef) && ce.eval(dff_in, undef))
-	{
-		if (0) {
-undef_bit_in_next_state:
-			for (auto &bit : dff_in)
-				if (bit.wire != nullptr) bit = RTLIL::Sm;
-			for (auto &bit : ctrl_out)
-				if (bit.wire != nullptr) bit = RTLIL::Sm;
-			undef_bit_in_next_state_mode = true;
-		}
-
-		log_assert(ctrl_out.is_fully_const() && dff_in.is_fully_const());
-
-		FsmData::transition_t tr;
-		tr.ctrl_in = sig2const(ce, ctrl_in, RTLIL::State::Sa, dont_care);
-		tr.ctrl_out = sig2const(ce, ctrl_out, RTLIL::State::Sx);
+	log_assert(ctrl_out.is_fully_const() && dff_in.is_fully_const());
+
+	FsmData::transition_t tr;
+	tr.ctrl_in = sig2const(ce, ctrl_in, RTLIL::State::Sa, dont_care);
+	tr.ctrl_out = sig2const(ce, ctrl_out, RTLIL::State::Sx);
+
+	std::map<RTLIL::SigBit, int> ctrl_in_bit_indices;
+	for (int i = 0; i < GetSize(ctrl_in); i++)
+		ctrl_in_bit_indices[ctrl_in[i]] = i;
+
+	for (auto &it : ctrl_in_bit_indices)
+		if (tr.ctrl_in.bits.at(it.second) == RTLIL::S1 && exclusive_ctrls.count(it.first) != 0)
+			for (auto &dc_bit : exclusive_ctrls.at(it.first))
+				if (ctrl_in_bit_indices.count(dc_bit))
+					tr.ctrl_in.bits.at(ctrl_in_bit_indices.at(dc_bit)) = RTLIL::State::Sa;
+
+	RTLIL::Const log_state_in = RTLIL::Const(RTLIL::State::Sx, fsm_data.state_bits);
+	if (state_in >= 0)
+		log_state_in = fsm_data.state_table.at(state_in);
+
+	if (states.count(ce.values_map(ce.assign_map(dff_in)).as_const()) == 0) {
+		log("  transition: %10s %s -> INVALID_STATE(%s) %s  <ignored invalid transistion!>%s\n",
+				log_signal(log_state_in), log_signal(tr.ctrl_in),
+				log_signal(ce.values_map(ce.assign_map(dff_in))), log_signal(tr.ctrl_out),
+				undef_bit_in_next_state_mode ? " SHORTENED" : "");
+		return;
+	}
 
-		std::map<RTLIL::SigBit, int> ctrl_in_bit_indices;
-		for (int i = 0; i < GetSize(ctrl_in); i++)
-			ctrl_in_bit_indices[ctrl_in[i]] = i;
+	tr.state_in = state_in;
+	tr.state_out = states.at(ce.values_map(ce.assign_map(dff_in)).as_const());
+
+	if (dff_in.is_fully_def()) {
+		fsm_data.transition_table.push_back(tr);
+		log("  transition: %10s %s -> %10s %s\n",
+				log_signal(log_state_in), log_signal(tr.ctrl_in),
+				log_signal(fsm_data.state_table[tr.state_out]), log_signal(tr.ctrl_out));
+	} else {
+		log("  transition: %10s %s -> %10s %s  <ignored undef transistion!>\n",
+				log_signal(log_state_in), log_signal(tr.ctrl_in),
+				log_signal(fsm_data.state_table[tr.state_out]), log_signal(tr.ctrl_out));
+	}
+}
 
-		for (auto &it : ctrl_in_bit_indices)
-			if (tr.ctrl_in.bits.at(it.second) == RTLIL::S1 && exclusive_ctrls.count(it.first) != 0)
-				for (auto &dc_bit : exclusive_ctrls.at(it.first))
-					if (ctrl_in_bit_indices.count(dc_bit))
-						tr.ctrl_in.bits.at(ctrl_in_bit_indices.at(dc_bit)) = RTLIL::State::Sa;
+static void find_transitions(ConstEval &ce, ConstEval &ce_nostop, FsmData &fsm_data, std::map<RTLIL::Const, int> &states, int state_in, RTLIL::SigSpec ctrl_in, RTLIL::SigSpec ctrl_out, RTLIL::SigSpec dff_in, RTLIL::SigSpec dont_care)
+{
+	RTLIL::SigSpec undef, constval;
 
-		RTLIL::Const log_state_in = RTLIL::Const(RTLIL::State::Sx, fsm_data.state_bits);
-		if (state_in >= 0)
-			log_state_in = fsm_data.state_table.at(state_in);
+	if (enum_aborted)
+		return;
 
-		if (states.count(ce.values_map(ce.assign_map(dff_in)).as_const()) == 0) {
-			log("  transition: %10s %s -> INVALID_STATE(%s) %s  <ignored invalid transistion!>%s\n",
-					log_signal(log_state_in), log_signal(tr.ctrl_in),
-					log_signal(ce.values_map(ce.assign_map(dff_in))), log_signal(tr.ctrl_out),
-					undef_bit_in_next_state_mode ? " SHORTENED" : "");
-			return;
-		}
+	if (enum_budget > 0 && ++enum_splits > enum_budget) {
+		enum_aborted = true;
+		return;
+	}
 
-		tr.state_in = state_in;
-		tr.state_out = states.at(ce.values_map(ce.assign_map(dff_in)).as_const());
-
-		if (dff_in.is_fully_def()) {
-			fsm_data.transition_table.push_back(tr);
-			log("  transition: %10s %s -> %10s %s\n",
-					log_signal(log_state_in), log_signal(tr.ctrl_in),
-					log_signal(fsm_data.state_table[tr.state_out]), log_signal(tr.ctrl_out));
-		} else {
-			log("  transition: %10s %s -> %10s %s  <ignored undef transistion!>\n",
-					log_signal(log_state_in), log_signal(tr.ctrl_in),
-					log_signal(fsm_data.state_table[tr.state_out]), log_signal(tr.ctrl_out));
-		}
+	if (ce.eval(ctrl_out, undef) && ce.eval(dff_in, undef)) {
+		add_transition(ce, fsm_data, states, state_in, ctrl_in, ctrl_out, dff_in, dont_care, false);
 		return;
 	}
 
 	for (auto &bit : dff_in)
-		if (bit == RTLIL::Sx)
-			goto undef_bit_in_next_state;
+		if (bit == RTLIL::Sx) {
+			for (auto &bit : dff_in)
+				if (bit.wire != nullptr) bit = RTLIL::Sm;
+			for (auto &bit : ctrl_out)
+				if (bit.wire != nullptr) bit = RTLIL::Sm;
+			add_transition(ce, fsm_data, states, state_in, ctrl_in, ctrl_out, dff_in, dont_care, true);
+			return;
+		}
 
 	log_assert(undef.size() > 0);
 	log_assert(ce.stop_signals.check_all(undef));
@@ -250,6 +266,107 @@ undef_bit_in_next_state:
 	}
 }
 
+// Enumerate the transitions with a SAT solver instead of splitting on all
+// control inputs. Each model of the next state logic is generalized to an
+// input cube using ConstEval (only the ctrl inputs needed to evaluate the
+// next state and the ctrl outputs are fixed), and the cube is then blocked.
+// Returns false if the budget is exceeded.
+static bool find_transitions_sat(ConstEval &ce, FsmData &fsm_data, std::map<RTLIL::Const, int> &states,
+		RTLIL::SigSpec ctrl_in, RTLIL::SigSpec ctrl_out, RTLIL::SigSpec dff_out, RTLIL::SigSpec dff_in)
+{
+	ezSatPtr ez;
+	SatGen satgen(ez.get(), &assign_map);
+
+	pool<RTLIL::SigBit> stop_bits;
+	for (auto bit : ctrl_in)
+		stop_bits.insert(bit);
+	for (auto bit : dff_out)
+		stop_bits.insert(bit);
+
+	pool<RTLIL::SigBit> visited_bits;
+	pool<RTLIL::Cell*> imported_cells;
+	std::vector<RTLIL::SigBit> queue;
+	for (auto bit : dff_in)
+		queue.push_back(bit);
+	for (auto bit : ctrl_out)
+		queue.push_back(bit);
+
+	while (!queue.empty())
+	{
+		RTLIL::SigBit bit = queue.back();
+		queue.pop_back();
+
+		if (bit.wire == nullptr || stop_bits.count(bit) || visited_bits.count(bit))
+			continue;
+		visited_bits.insert(bit);
+
+		std::set<sig2driver_entry_t> cellport_list;
+		sig2driver.find(bit, cellport_list);
+		for (auto &cellport : cellport_list) {
+			RTLIL::Cell *cell = module->cells_.at(cellport.first);
+			if (!ct_comb.cell_known(cell->type) || imported_cells.count(cell))
+				continue;
+			if (!satgen.importCell(cell)) {
+				log("  SAT-based enumeration failed: unsupported cell %s (%s).\n", log_id(cell), log_id(cell->type));
+				return false;
+			}
+			imported_cells.insert(cell);
+			for (auto &conn : cell->connections())
+				if (ct_comb.cell_input(cell->type, conn.first))
+					for (auto in_bit : assign_map(conn.second))
+						queue.push_back(in_bit);
+		}
+	}
+
+	std::vector<int> ctrl_in_vec = satgen.importSigSpec(ctrl_in);
+	std::vector<int> dff_out_vec = satgen.importSigSpec(dff_out);
+
+	dict<RTLIL::SigBit, int> ctrl_in_index;
+	for (int i = 0; i < GetSize(ctrl_in); i++)
+		ctrl_in_index[ctrl_in[i]] = i;
+
+	int solver_calls = 0;
+	for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++)
+	{
+		std::vector<bool> state_bits;
+		for (auto bit : fsm_data.state_table[state_idx].bits)
+			state_bits.push_back(bit == RTLIL::State::S1);
+		int state_lit = ez->vec_eq(dff_out_vec, ez->vec_const(state_bits));
+
+		std::vector<bool> model;
+		while (ez->solve(ctrl_in_vec, model, state_lit))
+		{
+			if (sat_budget > 0 && ++solver_calls > sat_budget) {
+				log("  SAT-based enumeration exceeded the budget of %d transitions.\n", sat_budget);
+				return false;
+			}
+
+			ce.push();
+			ce.set(dff_out, fsm_data.state_table[state_idx]);
+
+			std::vector<int> cube;
+			RTLIL::SigSpec sig_out, sig_next;
+			while (1) {
+				RTLIL::SigSpec undef;
+				sig_out = ctrl_out, sig_next = dff_in;
+				if (ce.eval(sig_out, undef) && ce.eval(sig_next, undef))
+					break;
+				log_assert(undef.size() > 0 && ctrl_in_index.count(undef[0]));
+				int idx = ctrl_in_index.at(undef[0]);
+				ce.set(undef[0], model[idx] ? RTLIL::State::S1 : RTLIL::State::S0);
+				cube.push_back(model[idx] ? ctrl_in_vec[idx] : ez->NOT(ctrl_in_vec[idx]));
+			}
+
+			add_transition(ce, fsm_data, states, state_idx, ctrl_in, sig_out, sig_next, RTLIL::SigSpec(), false);
+			ce.pop();
+
+			ez->assume(ez->OR(ez->NOT(state_lit), ez->NOT(ez->expression(ezSAT::OpAnd, cube))));
+		}
+	}
+
+	return true;
+}
+
 static void extract_fsm(RTLIL::Wire *wire)
 {
 	log("Extracting FSM `%s' from module `%s'.\n", wire->name.c_str(), module->name.c_str());
@@ -355,12 +472,33 @@ static void extract_fsm(RTLIL::Wire *wire)
 
 	ConstEval ce(module), ce_nostop(module);
 	ce.stop(ctrl_in);
-	for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++) {
-		ce.push(), ce_nostop.push();
-		ce.set(dff_out, fsm_data.state_table[state_idx]);
-		ce_nostop.set(dff_out, fsm_data.state_table[state_idx]);
-		find_transitions(ce, ce_nostop, fsm_data, states, state_idx, ctrl_in, ctrl_out, dff_in, RTLIL::SigSpec());
-		ce.pop(), ce_nostop.pop();
+
+	enum_splits = 0;
+	enum_aborted = false;
+
+	if (!sat_mode)
+		for (int state_idx = 0; state_idx < int(fsm_data.state_table.size()); state_idx++) {
+			ce.push(), ce_nostop.push();
+			ce.set(dff_out, fsm_data.state_table[state_idx]);
+			ce_nostop.set(dff_out, fsm_data.state_table[state_idx]);
+			find_transitions(ce, ce_nostop, fsm_data, states, state_idx, ctrl_in, ctrl_out, dff_in, RTLIL::SigSpec());
+			ce.pop(), ce_nostop.pop();
+			if (enum_aborted)
+				break;
+		}
+
+	if (sat_mode || enum_aborted)
+	{
+		if (enum_aborted)
+			log("  transition enumeration exceeded the budget of %d case splits, falling back to SAT-based enumeration.\n", enum_budget);
+		else
+			log("  using SAT-based transition enumeration.\n");
+
+		fsm_data.transition_table.clear();
+		if (!find_transitions_sat(ce, fsm_data, states, ctrl_in, ctrl_out, dff_out, dff_in)) {
+			log("  fsm extraction failed: transition enumeration did not complete.\n");
+			return;
+		}
 	}
 
 	// create fsm cell
@@ -378,10 +516,8 @@ static void extract_fsm(RTLIL::Wire *wire)
 
 	// rename original state wire
 
-	module->wires_.erase(wire->name);
 	wire->attributes.erase("\\fsm_encoding");
-	wire->name = stringf("$fsm$oldstate%s", wire->name.c_str());
-	module->wires_[wire->name] = wire;
+	module->rename(wire, stringf("$fsm$oldstate%s", wire->name.c_str()));
 
 	// unconnect control outputs from old drivers
 
@@ -392,7 +528,9 @@ static void extract_fsm(RTLIL::Wire *wire)
 		RTLIL::SigSpec port_sig = assign_map(cell->getPort(cellport.second));
 		RTLIL::SigSpec unconn_sig = port_sig.extract(ctrl_out);
 		RTLIL::Wire *unconn_wire = module->addWire(stringf("$fsm_unconnect$%s$%d", log_signal(unconn_sig), autoidx++), unconn_sig.size());
-		port_sig.replace(unconn_sig, RTLIL::SigSpec(unconn_wire), &cell->connections_[cellport.second]);
+		RTLIL::SigSpec new_sig = cell->getPort(cellport.second);
+		port_sig.replace(unconn_sig, RTLIL::SigSpec(unconn_wire), &new_sig);
+		cell->setPort(cellport.second, new_sig);
 	}
 }
 
@@ -402,7 +540,7 @@ struct FsmExtractPass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    fsm_extract [selection]\n");
+		log("    fsm_extract [options] [selection]\n");
 		log("\n");
 		log("This pass operates on all signals marked as FSM state signals using the\n");
 		log("'fsm_encoding' attribute. It consumes the logic that creates the state signal\n");
@@ -413,11 +551,51 @@ struct FsmExtractPass : public Pass {
 		log("original encoding. The 'fsm_opt' pass can be used in combination with the\n");
 		log("'opt_clean' pass to eliminate this signal.\n");
 		log("\n");
+		log("The state transitions are enumerated by evaluating the next state logic with\n");
+		log("all combinations of the control inputs it depends on. This can take a very long\n");
+		log("time for FSMs with many control inputs. The following options limit it:\n");
+		log("\n");
+		log("    -budget <N>\n");
+		log("        give up the enumeration of an FSM after N case splits on control\n");
+		log("        inputs and enumerate the transitions with a SAT solver instead.\n");
+		log("        the SAT solver only visits input cubes that lead to a transition.\n");
+		log("\n");
+		log("    -sat\n");
+		log("        always use the SAT-based enumeration.\n");
+		log("\n");
+		log("    -sat_budget <N>\n");
+		log("        do not extract an FSM if the SAT-based enumeration finds more than\n");
+		log("        N transitions. (default: no limit)\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		log_header("Executing FSM_EXTRACT pass (extracting FSM from design).\n");
-		extra_args(args, 1, design);
+
+		sat_mode = false;
+		enum_budget = 0;
+		sat_budget = 0;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-budget" && argidx+1 < args.size()) {
+				enum_budget = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-sat") {
+				sat_mode = true;
+				continue;
+			}
+			if (args[argidx] == "-sat_budget" && argidx+1 < args.size()) {
+				sat_budget = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		ct_comb.setup_internals();
+		ct_comb.setup_stdcells();
 
 		CellTypes ct;
 		ct.setup_internals();
@@ -425,12 +603,11 @@ struct FsmExtractPass : public Pass {
 		ct.setup_stdcells();
 		ct.setup_stdcells_mem();
 
-		for (auto &mod_it : design->modules_)
+		// the FSMs of different modules are independent and are extracted in
+		// parallel with "yosys -j". the results are merged in module order.
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod)
 		{
-			if (!design->selected(mod_it.second))
-				continue;
-
-			module = mod_it.second;
+			module = mod;
 			assign_map.set(module);
 
 			sig2driver.clear();
@@ -466,11 +643,12 @@ struct FsmExtractPass : public Pass {
 						wire_list.push_back(wire_it.second);
 			for (auto wire : wire_list)
 				extract_fsm(wire);
-		}
+		});
 
 		assign_map.clear();
 		sig2driver.clear();
 		sig2trigger.clear();
+		ct_comb.clear();
 	}
 } FsmExtractPass;
 
@@ -42,17 +42,30 @@ static bool pattern_is_subset(const RTLIL::Const &super_pattern, const RTLIL::Co
 	return true;
 }
 
-static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const, std::set<int>> &pattern_cache, std::set<int> &fullstate_cache, int num_states, RTLIL::Wire *state_onehot, RTLIL::SigSpec &ctrl_in, RTLIL::SigSpec output)
+// input pattern comparators, state set decoders and the AND gates combining
+// them are created once per FSM and shared by all next-state and output bits
+struct FsmDecoderCache
 {
-	RTLIL::SigSpec cases_vector;
+	RTLIL::Module *module;
+	RTLIL::Wire *state_onehot;
+	RTLIL::SigSpec ctrl_in;
 
-	for (int in_state : fullstate_cache)
-		cases_vector.append(RTLIL::SigSpec(state_onehot, in_state));
+	std::map<RTLIL::Const, RTLIL::SigBit> pattern_decoders;
+	std::map<std::set<int>, RTLIL::SigBit> state_decoders;
+	std::map<std::pair<RTLIL::SigBit, RTLIL::SigBit>, RTLIL::SigBit> and_gates;
+	int reused;
 
-	for (auto &it : pattern_cache)
+	FsmDecoderCache(RTLIL::Module *module, RTLIL::Wire *state_onehot, RTLIL::SigSpec ctrl_in) :
+			module(module), state_onehot(state_onehot), ctrl_in(ctrl_in), reused(0) { }
+
+	RTLIL::SigBit pattern_decoder(const RTLIL::Const &pattern)
 	{
-		RTLIL::Const pattern = it.first;
-		RTLIL::SigSpec eq_sig_a, eq_sig_b, or_sig;
+		if (pattern_decoders.count(pattern)) {
+			reused++;
+			return pattern_decoders.at(pattern);
+		}
+
+		RTLIL::SigSpec eq_sig_a, eq_sig_b;
 
 		for (size_t j = 0; j < pattern.bits.size(); j++)
 			if (pattern.bits[j] == RTLIL::State::S0 || pattern.bits[j] == RTLIL::State::S1) {
@@ -60,19 +73,12 @@ static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const
 				eq_sig_b.append(RTLIL::SigSpec(pattern.bits[j]));
 			}
 
-		for (int in_state : it.second)
-			if (fullstate_cache.count(in_state) == 0)
-				or_sig.append(RTLIL::SigSpec(state_onehot, in_state));
-
-		if (or_sig.size() == 0)
-			continue;
-
-		RTLIL::SigSpec and_sig;
+		RTLIL::SigBit eq_bit = RTLIL::State::S1;
 
 		if (eq_sig_a.size() > 0)
 		{
 			RTLIL::Wire *eq_wire = module->addWire(NEW_ID);
-			and_sig.append(RTLIL::SigSpec(eq_wire));
+			eq_bit = RTLIL::SigBit(eq_wire);
 
 			RTLIL::Cell *eq_cell = module->addCell(NEW_ID, "$eq");
 			eq_cell->setPort("\\A", eq_sig_a);
@@ -85,6 +91,88 @@ static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const
 			eq_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
 		}
 
+		return pattern_decoders[pattern] = eq_bit;
+	}
+
+	RTLIL::SigBit state_decoder(const std::set<int> &states)
+	{
+		if (GetSize(states) == 1)
+			return RTLIL::SigBit(state_onehot, *states.begin());
+
+		if (state_decoders.count(states)) {
+			reused++;
+			return state_decoders.at(states);
+		}
+
+		RTLIL::SigSpec or_sig;
+		for (int in_state : states)
+			or_sig.append(RTLIL::SigSpec(state_onehot, in_state));
+
+		RTLIL::Wire *or_wire = module->addWire(NEW_ID);
+
+		RTLIL::Cell *or_cell = module->addCell(NEW_ID, "$reduce_or");
+		or_cell->setPort("\\A", or_sig);
+		or_cell->setPort("\\Y", RTLIL::SigSpec(or_wire));
+		or_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+		or_cell->parameters["\\A_WIDTH"] = RTLIL::Const(or_sig.size());
+		or_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+
+		return state_decoders[states] = RTLIL::SigBit(or_wire);
+	}
+
+	RTLIL::SigBit and_gate(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (a == RTLIL::State::S1)
+			return b;
+		if (b == RTLIL::State::S1)
+			return a;
+
+		std::pair<RTLIL::SigBit, RTLIL::SigBit> key(a, b);
+		if (and_gates.count(key)) {
+			reused++;
+			return and_gates.at(key);
+		}
+
+		RTLIL::Wire *and_wire = module->addWire(NEW_ID);
+
+		RTLIL::Cell *and_cell = module->addCell(NEW_ID, "$and");
+		and_cell->setPort("\\A", a);
+		and_cell->setPort("\\B", b);
+		and_cell->setPort("\\Y", RTLIL::SigSpec(and_wire));
+		and_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+		and_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
+		and_cell->parameters["\\A_WIDTH"] = RTLIL::Const(1);
+		and_cell->parameters["\\B_WIDTH"] = RTLIL::Const(1);
+		and_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+
+		return and_gates[key] = RTLIL::SigBit(and_wire);
+	}
+};
+
+static void implement_pattern_cache(FsmDecoderCache &decoders, std::map<RTLIL::Const, std::set<int>> &pattern_cache, std::set<int> &fullstate_cache, int num_states, RTLIL::SigSpec output)
+{
+	RTLIL::Module *module = decoders.module;
+	RTLIL::Wire *state_onehot = decoders.state_onehot;
+	RTLIL::SigSpec cases_vector;
+
+	for (int in_state : fullstate_cache)
+		cases_vector.append(RTLIL::SigSpec(state_onehot, in_state));
+
+	for (auto &it : pattern_cache)
+	{
+		RTLIL::Const pattern = it.first;
+		std::set<int> in_states;
+
+		for (int in_state : it.second)
+			if (fullstate_cache.count(in_state) == 0)
+				in_states.insert(in_state);
+
+		if (in_states.empty())
+			continue;
+
+		RTLIL::SigBit state_bit = RTLIL::State::S1;
+		RTLIL::SigBit pattern_bit = decoders.pattern_decoder(pattern);
+
 		std::set<int> complete_in_state_cache = it.second;
 
 		for (auto &it2 : pattern_cache)
@@ -92,52 +180,9 @@ static void implement_pattern_cache(RTLIL::Module *module, std::map<RTLIL::Const
 				complete_in_state_cache.insert(it2.second.begin(), it2.second.end());
 
 		if (GetSize(complete_in_state_cache) < num_states)
-		{
-			if (or_sig.size() == 1)
-			{
-				and_sig.append(or_sig);
-			}
-			else
-			{
-				RTLIL::Wire *or_wire = module->addWire(NEW_ID);
-				and_sig.append(RTLIL::SigSpec(or_wire));
-
-				RTLIL::Cell *or_cell = module->addCell(NEW_ID, "$reduce_or");
-				or_cell->setPort("\\A", or_sig);
-				or_cell->setPort("\\Y", RTLIL::SigSpec(or_wire));
-				or_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
-				or_cell->parameters["\\A_WIDTH"] = RTLIL::Const(or_sig.size());
-				or_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-			}
-		}
+			state_bit = decoders.state_decoder(in_states);
 
-		switch (and_sig.size())
-		{
-		case 2:
-			{
-				RTLIL::Wire *and_wire = module->addWire(NEW_ID);
-				cases_vector.append(RTLIL::SigSpec(and_wire));
-
-				RTLIL::Cell *and_cell = module->addCell(NEW_ID, "$and");
-				and_cell->setPort("\\A", and_sig.extract(0, 1));
-				and_cell->setPort("\\B", and_sig.extract(1, 1));
-				and_cell->setPort("\\Y", RTLIL::SigSpec(and_wire));
-				and_cell->parameters["\\A_SIGNED"] = RTLIL::Const(false);
-				and_cell->parameters["\\B_SIGNED"] = RTLIL::Const(false);
-				and_cell->parameters["\\A_WIDTH"] = RTLIL::Const(1);
-				and_cell->parameters["\\B_WIDTH"] = RTLIL::Const(1);
-				and_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
-				break;
-			}
-		case 1:
-			cases_vector.append(and_sig);
-			break;
-		case 0:
-			cases_vector.append(RTLIL::SigSpec(1, 1));
-			break;
-		default:
-			log_abort();
-		}
+		cases_vector.append(decoders.and_gate(pattern_bit, state_bit));
 	}
 
 	if (cases_vector.size() > 1) {
@@ -229,6 +274,8 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 
 	// generate next_state signal
 
+	FsmDecoderCache decoders(module, state_onehot, ctrl_in);
+
 	if (GetSize(fsm_data.state_table) == 1)
 	{
 		module->connect(next_state_wire, fsm_data.state_table.front());
@@ -252,7 +299,7 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 					fullstate_cache.erase(tr.state_in);
 			}
 
-			implement_pattern_cache(module, pattern_cache, fullstate_cache, fsm_data.state_table.size(), state_onehot, ctrl_in, RTLIL::SigSpec(next_state_onehot, i));
+			implement_pattern_cache(decoders, pattern_cache, fullstate_cache, fsm_data.state_table.size(), RTLIL::SigSpec(next_state_onehot, i));
 		}
 
 		if (encoding_is_onehot)
@@ -314,9 +361,12 @@ static void map_fsm(RTLIL::Cell *fsm_cell, RTLIL::Module *module)
 				fullstate_cache.erase(tr.state_in);
 		}
 
-		implement_pattern_cache(module, pattern_cache, fullstate_cache, fsm_data.state_table.size(), state_onehot, ctrl_in, ctrl_out.extract(i, 1));
+		implement_pattern_cache(decoders, pattern_cache, fullstate_cache, fsm_data.state_table.size(), ctrl_out.extract(i, 1));
 	}
 
+	log("  created %d input pattern decoders, %d state set decoders and %d AND gates (%d reused).\n",
+			GetSize(decoders.pattern_decoders), GetSize(decoders.state_decoders), GetSize(decoders.and_gates), decoders.reused);
+
 	// Remove FSM cell
 
 	module->remove(fsm_cell);
@@ -330,7 +380,9 @@ struct FsmMapPass : public Pass {
 		log("\n");
 		log("    fsm_map [selection]\n");
 		log("\n");
-		log("This pass translates FSM cells to flip-flops and logic.\n");
+		log("This pass translates FSM cells to flip-flops and logic. The comparators for\n");
+		log("the input patterns and the decoders for sets of states are created once per\n");
+		log("FSM and shared by all next-state and output functions.\n");
 		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
@@ -338,16 +390,14 @@ struct FsmMapPass : public Pass {
 		log_header("Executing FSM_MAP pass (mapping FSMs to basic logic).\n");
 		extra_args(args, 1, design);
 
-		for (auto &mod_it : design->modules_) {
-			if (!design->selected(mod_it.second))
-				continue;
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *module) {
 			std::vector<RTLIL::Cell*> fsm_cells;
-			for (auto &cell_it : mod_it.second->cells_)
-				if (cell_it.second->type == "$fsm" && design->selected(mod_it.second, cell_it.second))
+			for (auto &cell_it : module->cells_)
+				if (cell_it.second->type == "$fsm" && design->selected(module, cell_it.second))
 					fsm_cells.push_back(cell_it.second);
 			for (auto cell : fsm_cells)
-					map_fsm(cell, mod_it.second);
-		}
+				map_fsm(cell, module);
+		});
 	}
 } FsmMapPass;
 
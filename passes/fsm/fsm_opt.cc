@@ -339,12 +339,11 @@ struct FsmOptPass : public Pass {
 		log_header("Executing FSM_OPT pass (simple optimizations of FSMs).\n");
 		extra_args(args, 1, design);
 
-		for (auto &mod_it : design->modules_) {
-			if (design->selected(mod_it.second))
-				for (auto &cell_it : mod_it.second->cells_)
-					if (cell_it.second->type == "$fsm" && design->selected(mod_it.second, cell_it.second))
-						FsmData::optimize_fsm(cell_it.second, mod_it.second);
-		}
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *module) {
+			for (auto &cell_it : module->cells_)
+				if (cell_it.second->type == "$fsm" && design->selected(module, cell_it.second))
+					FsmData::optimize_fsm(cell_it.second, module);
+		});
 	}
 } FsmOptPass;
 
@@ -181,11 +181,19 @@ struct FsmRecodePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto &mod_it : design->modules_)
-			if (design->selected(mod_it.second))
-				for (auto &cell_it : mod_it.second->cells_)
-					if (cell_it.second->type == "$fsm" && design->selected(mod_it.second, cell_it.second))
-						fsm_recode(cell_it.second, mod_it.second, fm_set_fsm_file, encfile, default_encoding);
+		auto recode_module = [&](RTLIL::Module *module) {
+			for (auto &cell_it : module->cells_)
+				if (cell_it.second->type == "$fsm" && design->selected(module, cell_it.second))
+					fsm_recode(cell_it.second, module, fm_set_fsm_file, encfile, default_encoding);
+		};
+
+		// the output files are written in module order, so only recode
+		// modules in parallel when there are none
+		if (fm_set_fsm_file == NULL && encfile == NULL)
+			run_module_jobs(design, design->selected_modules(), recode_module);
+		else
+			for (auto module : design->selected_modules())
+				recode_module(module);
 
 		if (fm_set_fsm_file != NULL)
 			fclose(fm_set_fsm_file);
@@ -18,6 +18,9 @@
  */
 
 #include "kernel/yosys.h"
+#include "frontends/ast/ast.h"
+#include "frontends/ilang/ilang_frontend.h"
+#include "backends/ilang/ilang_backend.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
@@ -26,6 +29,10 @@
 #  include <unistd.h>
 #endif
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <sys/wait.h>
+#endif
+
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -162,8 +169,14 @@ bool expand_module(RTLIL::Design *design, RTLIL::Module *module, bool flag_check
 		{
 			if (design->modules_.count("$abstract" + cell->type.str()))
 			{
-				cell->type = design->modules_.at("$abstract" + cell->type.str())->derive(design, cell->parameters);
-				cell->parameters.clear();
+				RTLIL::Module *abstract_mod = design->modules_.at("$abstract" + cell->type.str());
+				if (abstract_mod->get_bool_attribute("\\blackbox")) {
+					// library cells are elaborated once with default parameters, like without -defer
+					cell->type = abstract_mod->derive(design, dict<RTLIL::IdString, RTLIL::Const>());
+				} else {
+					cell->type = abstract_mod->derive(design, cell->parameters);
+					cell->parameters.clear();
+				}
 				did_something = true;
 				continue;
 			}
@@ -261,7 +274,152 @@ bool expand_module(RTLIL::Design *design, RTLIL::Module *module, bool flag_check
 	return did_something;
 }
 
-void hierarchy_worker(RTLIL::Design *design, std::set<RTLIL::Module*> &used, RTLIL::Module *mod, int indent)
+// Cache for 'hierarchy -incremental': remembers the modules for which
+// expand_module() found nothing to do, together with a fingerprint over
+// everything expand_module() looks at (cell names, types, parameter counts
+// and port names, plus existence, blackbox attribute and ports of the
+// instantiated modules) and the list of instantiated modules. The
+// fingerprint only hashes IdString indices and pointers, so checking an
+// unchanged module is much cheaper than expanding it again. (Cell types,
+// parameters and ports are frequently modified by direct writes that are
+// not reported to RTLIL::Monitor, so a monitor alone cannot track this.)
+
+struct HierarchyCache
+{
+	struct entry_t {
+		RTLIL::IdString name;
+		uint64_t fingerprint;
+		bool checked;
+		std::vector<RTLIL::IdString> children;
+	};
+
+	RTLIL::Design *design = nullptr;
+	dict<RTLIL::Module*, entry_t> entries;
+
+	// memoized for the current state of the design, see reset_memo()
+	dict<RTLIL::Module*, std::pair<uint64_t, bool>> module_memo;
+	dict<RTLIL::IdString, std::pair<uint64_t, bool>> type_memo;
+
+	static uint64_t mix(uint64_t a, uint64_t b)
+	{
+		uint64_t x = (a * 0x9e3779b97f4a7c15ull) ^ (b + 0x632be59bd9b4e019ull);
+		x ^= x >> 29;
+		x *= 0xbf58476d1ce4e5b9ull;
+		return x ^ (x >> 32);
+	}
+
+	void setup(RTLIL::Design *new_design)
+	{
+		if (design != new_design) {
+			design = new_design;
+			entries.clear();
+		}
+
+		std::vector<RTLIL::Module*> del_list;
+		for (auto &it : entries)
+			if (design->module(it.second.name) != it.first)
+				del_list.push_back(it.first);
+		for (auto mod : del_list)
+			entries.erase(mod);
+
+		reset_memo();
+	}
+
+	void reset_memo()
+	{
+		module_memo.clear();
+		type_memo.clear();
+	}
+
+	// second: false if the type is neither a module nor an internal cell type
+	const std::pair<uint64_t, bool> &type_fingerprint(RTLIL::IdString type)
+	{
+		auto it = type_memo.find(type);
+		if (it != type_memo.end())
+			return it->second;
+
+		RTLIL::Module *mod = design->module(type);
+		std::pair<uint64_t, bool> fp;
+
+		if (mod == nullptr) {
+			fp.first = mix(type.index_, design->module("$abstract" + type.str()) != nullptr);
+			fp.second = type[0] == '$';
+		} else {
+			fp.first = mix(type.index_, uintptr_t(mod));
+			fp.first = mix(fp.first, mod->get_bool_attribute("\\blackbox"));
+			for (auto port : mod->ports) {
+				RTLIL::Wire *wire = mod->wire(port);
+				fp.first = mix(fp.first, mix(port.index_, wire ? wire->port_id : -1));
+			}
+			fp.second = true;
+		}
+
+		return type_memo[type] = fp;
+	}
+
+	// second: false if expand_module() might load or derive modules
+	const std::pair<uint64_t, bool> &module_fingerprint(RTLIL::Module *module)
+	{
+		auto it = module_memo.find(module);
+		if (it != module_memo.end())
+			return it->second;
+
+		std::pair<uint64_t, bool> fp(mix(module->name.index_, GetSize(module->cells_)), true);
+
+		for (auto &cell_it : module->cells_) {
+			RTLIL::Cell *cell = cell_it.second;
+			const std::pair<uint64_t, bool> &type_fp = type_fingerprint(cell->type);
+			uint64_t cell_fp = mix(mix(cell->name.index_, type_fp.first), GetSize(cell->parameters));
+			for (auto &conn : cell->connections())
+				cell_fp += mix(conn.first.index_, 0);
+			fp.first += cell_fp;
+			if (!type_fp.second || !cell->parameters.empty() || strncmp(cell->type.c_str(), "$array:", 7) == 0)
+				fp.second = false;
+		}
+
+		return module_memo[module] = fp;
+	}
+
+	bool is_clean(RTLIL::Module *module, bool flag_check)
+	{
+		auto it = entries.find(module);
+		if (it == entries.end() || (flag_check && !it->second.checked))
+			return false;
+		return it->second.fingerprint == module_fingerprint(module).first;
+	}
+
+	void mark_clean(RTLIL::Module *module, bool flag_check)
+	{
+		module_memo.erase(module);
+		const std::pair<uint64_t, bool> &fp = module_fingerprint(module);
+		if (!fp.second) {
+			entries.erase(module);
+			return;
+		}
+
+		entry_t &entry = entries[module];
+		entry.name = module->name;
+		entry.fingerprint = fp.first;
+		entry.checked = flag_check;
+		entry.children.clear();
+
+		pool<RTLIL::IdString> seen;
+		for (auto cell : module->cells())
+			if (design->module(cell->type) && seen.insert(cell->type).second)
+				entry.children.push_back(cell->type);
+	}
+
+	const std::vector<RTLIL::IdString> *children(RTLIL::Module *module)
+	{
+		if (!is_clean(module, false))
+			return nullptr;
+		return &entries.at(module).children;
+	}
+};
+
+static HierarchyCache hierarchy_cache;
+
+void hierarchy_worker(RTLIL::Design *design, std::set<RTLIL::Module*> &used, RTLIL::Module *mod, int indent, HierarchyCache *cache = nullptr)
 {
 	if (used.count(mod) > 0)
 		return;
@@ -272,6 +430,13 @@ void hierarchy_worker(RTLIL::Design *design, std::set<RTLIL::Module*> &used, RTL
 		log("Used module: %*s%s\n", indent, "", mod->name.c_str());
 	used.insert(mod);
 
+	const std::vector<RTLIL::IdString> *children = cache ? cache->children(mod) : nullptr;
+	if (children != nullptr) {
+		for (auto child : *children)
+			hierarchy_worker(design, used, design->module(child), indent+4, cache);
+		return;
+	}
+
 	for (auto cell : mod->cells()) {
 		std::string celltype = cell->type.str();
 		if (celltype.substr(0, 7) == "$array:") {
@@ -281,14 +446,14 @@ void hierarchy_worker(RTLIL::Design *design, std::set<RTLIL::Module*> &used, RTL
 			celltype = celltype.substr(pos_type + 1);
 		}
 		if (design->module(celltype))
-			hierarchy_worker(design, used, design->module(celltype), indent+4);
+			hierarchy_worker(design, used, design->module(celltype), indent+4, cache);
 	}
 }
 
-void hierarchy_clean(RTLIL::Design *design, RTLIL::Module *top, bool purge_lib)
+void hierarchy_clean(RTLIL::Design *design, RTLIL::Module *top, bool purge_lib, HierarchyCache *cache = nullptr)
 {
 	std::set<RTLIL::Module*> used;
-	hierarchy_worker(design, used, top, 0);
+	hierarchy_worker(design, used, top, 0, cache);
 
 	std::vector<RTLIL::Module*> del_modules;
 	for (auto &it : design->modules_)
@@ -297,7 +462,7 @@ void hierarchy_clean(RTLIL::Design *design, RTLIL::Module *top, bool purge_lib)
 
 	int del_counter = 0;
 	for (auto mod : del_modules) {
-		if (!purge_lib && mod->get_bool_attribute("\\blackbox"))
+		if (!purge_lib && mod->get_bool_attribute("\\blackbox") && mod->name.substr(0, 9) != "$abstract")
 			continue;
 		log("Removing unused module `%s'.\n", mod->name.c_str());
 		design->modules_.erase(mod->name);
@@ -306,6 +471,9 @@ void hierarchy_clean(RTLIL::Design *design, RTLIL::Module *top, bool purge_lib)
 	}
 
 	log("Removed %d unused modules.\n", del_counter);
+
+	if (cache != nullptr && del_counter > 0)
+		cache->reset_memo();
 }
 
 bool set_keep_assert(std::map<RTLIL::Module*, bool> &cache, RTLIL::Module *mod)
@@ -330,6 +498,174 @@ int find_top_mod_score(Design *design, Module *module, dict<Module*, int> &db)
 	return db.at(module);
 }
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+// Derives the parametrized modules that expand_module() will need for the given
+// modules in worker processes, so that expand_module() then finds them in the
+// design. Each derivation only works on its own copy of the AST of the module.
+// The results are added to the design and the logs are replayed in the order
+// of the cells, so that the result does not depend on the number of workers.
+// Returns false if no module was added.
+bool parallel_derive(RTLIL::Design *design, const std::set<RTLIL::Module*> &modules)
+{
+	std::vector<std::pair<RTLIL::Module*, dict<RTLIL::IdString, RTLIL::Const>>> tasks;
+	pool<std::string> task_keys;
+
+	for (auto module : modules)
+	for (auto cell : module->cells())
+	{
+		RTLIL::Module *mod = design->module("$abstract" + cell->type.str());
+		dict<RTLIL::IdString, RTLIL::Const> parameters = cell->parameters;
+
+		if (design->module(cell->type) != nullptr) {
+			mod = design->module(cell->type);
+			if (parameters.empty() || mod->get_bool_attribute("\\blackbox"))
+				continue;
+		} else if (mod == nullptr)
+			continue;
+		else if (mod->get_bool_attribute("\\blackbox"))
+			parameters.clear();
+
+		// -dedup_paramod depends on the order in which the modules are derived
+		AST::AstModule *ast_mod = dynamic_cast<AST::AstModule*>(mod);
+		if (ast_mod == nullptr || ast_mod->dedup_paramod)
+			continue;
+
+		parameters.sort();
+		std::string key = mod->name.str();
+		for (auto &it : parameters)
+			key += stringf(" %s=%s%s", it.first.c_str(), it.second.as_string().c_str(), (it.second.flags & RTLIL::CONST_FLAG_SIGNED) ? "s" : "");
+
+		if (task_keys.count(key))
+			continue;
+		task_keys.insert(key);
+		tasks.push_back(std::make_pair(mod, parameters));
+	}
+
+	int num_workers = std::min(yosys_jobs, GetSize(tasks));
+	if (num_workers < 2)
+		return false;
+
+	log("Deriving %d parametrized modules using %d worker processes.\n", GetSize(tasks), num_workers);
+
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-derive-XXXXXX");
+	std::vector<pid_t> worker_pids;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_streams.clear();
+			log_cmd_error_throw = true;
+
+			pool<RTLIL::IdString> old_modules;
+			for (auto &it : design->modules_)
+				old_modules.insert(it.first);
+
+			std::ofstream nf(stringf("%s/worker_%d.names", tempdir_name.c_str(), w).c_str());
+			std::vector<RTLIL::IdString> new_modules;
+
+			try {
+				for (int i = w; i < GetSize(tasks); i += num_workers) {
+					FILE *f = fopen(stringf("%s/task_%d.log", tempdir_name.c_str(), i).c_str(), "w");
+					log_files.clear();
+					if (f != NULL)
+						log_files.push_back(f);
+					RTLIL::IdString modname = tasks[i].first->derive(design, tasks[i].second);
+					log_flush();
+					if (f != NULL)
+						fclose(f);
+					log_files.clear();
+					if (!old_modules.count(modname)) {
+						old_modules.insert(modname);
+						new_modules.push_back(modname);
+						nf << i << " " << modname.str() << "\n";
+					}
+				}
+			} catch (...) {
+				_exit(1);
+			}
+
+			std::ofstream f(stringf("%s/worker_%d.il", tempdir_name.c_str(), w).c_str());
+			f << stringf("autoidx %d\n", autoidx);
+			for (auto modname : new_modules)
+				ILANG_BACKEND::dump_module(f, "", design->module(modname), design, false);
+			f.close();
+			nf.close();
+			_exit(f.fail() || nf.fail() ? 1 : 0);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	RTLIL::Design *results = new RTLIL::Design;
+	dict<int, RTLIL::IdString> task_results;
+	pool<int> failed_workers;
+
+	for (int w = 0; w < GetSize(worker_pids); w++)
+	{
+		int status = 0;
+		if (waitpid(worker_pids[w], &status, 0) != worker_pids[w] || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			failed_workers.insert(w);
+			continue;
+		}
+
+		std::ifstream f(stringf("%s/worker_%d.il", tempdir_name.c_str(), w).c_str());
+		ILANG_FRONTEND::lexin = &f;
+		ILANG_FRONTEND::current_design = results;
+		rtlil_frontend_ilang_yydebug = false;
+		rtlil_frontend_ilang_yyrestart(NULL);
+		rtlil_frontend_ilang_yyparse();
+		rtlil_frontend_ilang_yylex_destroy();
+
+		std::ifstream nf(stringf("%s/worker_%d.names", tempdir_name.c_str(), w).c_str());
+		std::string line;
+		while (std::getline(nf, line)) {
+			size_t pos = line.find(' ');
+			if (pos != std::string::npos)
+				task_results[atoi(line.substr(0, pos).c_str())] = line.substr(pos+1);
+		}
+	}
+
+	// tasks of failed workers (e.g. because of an error in the module) are
+	// derived again by expand_module(), which then reports the error
+	bool did_something = false;
+	for (int i = 0; i < GetSize(tasks); i++)
+	{
+		if (i % num_workers >= GetSize(worker_pids) || failed_workers.count(i % num_workers))
+			continue;
+
+		std::ifstream f(stringf("%s/task_%d.log", tempdir_name.c_str(), i).c_str());
+		std::string line;
+		while (std::getline(f, line))
+			log("%s%s", line.c_str(), f.eof() ? "" : "\n");
+
+		if (task_results.count(i) == 0)
+			continue;
+
+		RTLIL::IdString modname = task_results.at(i);
+		RTLIL::Module *mod = results->module(modname);
+		if (mod == nullptr || design->module(modname) != nullptr)
+			continue;
+
+		results->modules_.erase(modname);
+		design->add(mod);
+		did_something = true;
+	}
+
+	delete results;
+	remove_directory(tempdir_name);
+	return did_something;
+}
+#endif
+
 struct HierarchyPass : public Pass {
 	HierarchyPass() : Pass("hierarchy", "check, expand and clean up design hierarchy") { }
 	virtual void help()
@@ -370,6 +706,10 @@ struct HierarchyPass : public Pass {
 		log("        use the specified top module to built a design hierarchy. modules\n");
 		log("        outside this tree (unused modules) are removed.\n");
 		log("\n");
+		log("        modules read with 'read_verilog -defer' are only elaborated when they\n");
+		log("        are used in this tree. (Modules read with -lib -defer are elaborated\n");
+		log("        once with default parameters, like blackbox modules without -defer.)\n");
+		log("\n");
 		log("        when the -top option is used, the 'top' attribute will be set on the\n");
 		log("        specified top module. otherwise a module with the 'top' attribute set\n");
 		log("        will implicitly be used as top module, if such a module exists.\n");
@@ -377,6 +717,15 @@ struct HierarchyPass : public Pass {
 		log("    -auto-top\n");
 		log("        automatically determine the top of the design hierarchy and mark it.\n");
 		log("\n");
+		log("    -incremental\n");
+		log("        remember the modules that needed no changes and skip them in later\n");
+		log("        'hierarchy -incremental' runs as long as neither their cells nor the\n");
+		log("        ports of the modules they instantiate have changed. the cached\n");
+		log("        instantiation graph is also used to find the used modules.\n");
+		log("\n");
+		log("When yosys runs with more than one job (-j), the parametrized modules that are\n");
+		log("needed on each level of the hierarchy are derived in parallel worker processes.\n");
+		log("\n");
 		log("In -generate mode this pass generates blackbox modules for the given cell\n");
 		log("types (wildcards supported). For this the design is searched for cells that\n");
 		log("match the given types and then the given port declarations are used to\n");
@@ -407,6 +756,7 @@ struct HierarchyPass : public Pass {
 		bool generate_mode = false;
 		bool keep_positionals = false;
 		bool nokeep_asserts = false;
+		bool incremental = false;
 		std::vector<std::string> generate_cells;
 		std::vector<generate_port_decl_t> generate_ports;
 
@@ -489,6 +839,10 @@ struct HierarchyPass : public Pass {
 				auto_top_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-incremental") {
+				incremental = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design, false);
@@ -509,6 +863,8 @@ struct HierarchyPass : public Pass {
 			log_header("Finding top of design hierarchy..\n");
 			dict<Module*, int> db;
 			for (Module *mod : design->selected_modules()) {
+				if (mod->name.substr(0, 9) == "$abstract")
+					continue;
 				int score = find_top_mod_score(design, mod, db);
 				log("root of %3d design levels: %-20s\n", score, log_id(mod));
 				if (!top_mod || score > db[top_mod])
@@ -518,6 +874,12 @@ struct HierarchyPass : public Pass {
 				log("Automatically selected %s as design top module.\n", log_id(top_mod));
 		}
 
+		HierarchyCache *cache = nullptr;
+		if (incremental) {
+			cache = &hierarchy_cache;
+			cache->setup(design);
+		}
+
 		bool did_something = true;
 		while (did_something)
 		{
@@ -526,21 +888,38 @@ struct HierarchyPass : public Pass {
 			std::set<RTLIL::Module*> used_modules;
 			if (top_mod != NULL) {
 				log_header("Analyzing design hierarchy..\n");
-				hierarchy_worker(design, used_modules, top_mod, 0);
+				hierarchy_worker(design, used_modules, top_mod, 0, cache);
 			} else {
 				for (auto mod : design->modules())
 					used_modules.insert(mod);
 			}
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+			if (yosys_jobs > 1 && parallel_derive(design, used_modules) && cache != nullptr)
+				cache->reset_memo();
+#endif
+
+			int skipped_modules = 0;
 			for (auto module : used_modules) {
-				if (expand_module(design, module, flag_check, libdirs))
+				if (cache != nullptr && cache->is_clean(module, flag_check)) {
+					skipped_modules++;
+					continue;
+				}
+				if (expand_module(design, module, flag_check, libdirs)) {
 					did_something = true;
+					if (cache != nullptr)
+						cache->reset_memo();
+				} else if (cache != nullptr)
+					cache->mark_clean(module, flag_check);
 			}
+
+			if (skipped_modules > 0)
+				log("Skipped %d unchanged modules.\n", skipped_modules);
 		}
 
 		if (top_mod != NULL) {
 			log_header("Analyzing design hierarchy..\n");
-			hierarchy_clean(design, top_mod, purge_lib);
+			hierarchy_clean(design, top_mod, purge_lib, cache);
 		}
 
 		if (top_mod != NULL) {
@@ -0,0 +1,561 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// [[CITE]] Fiduccia-Mattheyses partitioning heuristic
+// C. M. Fiduccia and R. M. Mattheyses, "A linear-time heuristic for improving network partitions",
+// 19th Design Automation Conference, 1982, pp. 175-181, doi:10.1109/DAC.1982.1585498
+//
+// [[CITE]] Multilevel hypergraph partitioning
+// G. Karypis, R. Aggarwal, V. Kumar and S. Shekhar, "Multilevel hypergraph partitioning: applications
+// in VLSI domain", IEEE Transactions on VLSI Systems 7 (1), 1999, pp. 69-79, doi:10.1109/92.748202
+
+#include "kernel/yosys.h"
+#include "kernel/modtools.h"
+#include <climits>
+#include <queue>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// nets with more pins than this (clocks, resets, enables) are ignored when
+// clusters are formed, they are cut in almost every partitioning anyway
+static const int large_net_size = 1000;
+
+// the coarsening stops at this number of nodes
+static const int coarsest_size = 200;
+
+struct Hypergraph
+{
+	std::vector<int> node_weight;
+	std::vector<std::vector<int>> nets;
+	std::vector<int> net_weight;
+	std::vector<std::vector<int>> node_nets;
+
+	int size() const { return GetSize(node_weight); }
+
+	int add_node(int weight)
+	{
+		node_weight.push_back(weight);
+		return GetSize(node_weight)-1;
+	}
+
+	// the pins must be unique
+	void add_net(const std::vector<int> &pins, int weight)
+	{
+		if (GetSize(pins) < 2)
+			return;
+		nets.push_back(pins);
+		net_weight.push_back(weight);
+	}
+
+	void build_node_nets()
+	{
+		node_nets.clear();
+		node_nets.resize(size());
+		for (int n = 0; n < GetSize(nets); n++)
+			for (int v : nets[n])
+				node_nets[v].push_back(n);
+	}
+
+	int total_weight() const
+	{
+		int sum = 0;
+		for (int w : node_weight)
+			sum += w;
+		return sum;
+	}
+
+	int cut(const std::vector<int> &side) const
+	{
+		int sum = 0;
+		for (int n = 0; n < GetSize(nets); n++)
+			for (int v : nets[n])
+				if (side[v] != side[nets[n].front()]) {
+					sum += net_weight[n];
+					break;
+				}
+		return sum;
+	}
+};
+
+struct Bisection
+{
+	const Hypergraph &graph;
+	int max_weight[2];
+	uint32_t &rng_state;
+
+	Bisection(const Hypergraph &graph, int target0, int tolerance, uint32_t &rng_state) : graph(graph), rng_state(rng_state)
+	{
+		max_weight[0] = target0 + tolerance;
+		max_weight[1] = graph.total_weight() - target0 + tolerance;
+	}
+
+	uint32_t rng()
+	{
+		rng_state ^= rng_state << 13;
+		rng_state ^= rng_state >> 17;
+		rng_state ^= rng_state << 5;
+		return rng_state;
+	}
+
+	// Fiduccia-Mattheyses passes with lazy gain updates in a priority queue.
+	// Each pass moves every node at most once and keeps the best balanced
+	// prefix of the moves.
+	static void refine(const Hypergraph &g, std::vector<int> &side, const int *max_weight)
+	{
+		int num_nodes = g.size(), num_nets = GetSize(g.nets);
+		std::vector<int> count(2*num_nets);
+		int weight[2] = {0, 0};
+
+		for (int v = 0; v < num_nodes; v++)
+			weight[side[v]] += g.node_weight[v];
+		for (int n = 0; n < num_nets; n++)
+			for (int v : g.nets[n])
+				count[2*n + side[v]]++;
+
+		for (int pass = 0; pass < 8; pass++)
+		{
+			std::vector<int> gain(num_nodes);
+			std::vector<bool> locked(num_nodes);
+			std::priority_queue<std::pair<int, int>> queue;
+
+			for (int v = 0; v < num_nodes; v++) {
+				for (int n : g.node_nets[v]) {
+					if (count[2*n + side[v]] == 1)
+						gain[v] += g.net_weight[n];
+					if (count[2*n + 1-side[v]] == 0)
+						gain[v] -= g.net_weight[n];
+				}
+				queue.push(std::make_pair(gain[v], v));
+			}
+
+			auto update = [&](int v, int delta) {
+				if (locked[v])
+					return;
+				gain[v] += delta;
+				queue.push(std::make_pair(gain[v], v));
+			};
+
+			auto balanced = [&]() { return weight[0] <= max_weight[0] && weight[1] <= max_weight[1]; };
+
+			std::vector<int> moves;
+			int delta = 0, best_delta = balanced() ? 0 : INT_MAX, best_moves = 0;
+
+			while (!queue.empty())
+			{
+				int v = queue.top().second, g_v = queue.top().first;
+				queue.pop();
+
+				if (locked[v] || gain[v] != g_v)
+					continue;
+				locked[v] = true;
+
+				int from = side[v], to = 1-from;
+				if (weight[to] + g.node_weight[v] > max_weight[to])
+					continue;
+
+				for (int n : g.node_nets[v]) {
+					int w = g.net_weight[n];
+					if (count[2*n + to] == 0) {
+						for (int u : g.nets[n])
+							update(u, w);
+					} else if (count[2*n + to] == 1) {
+						for (int u : g.nets[n])
+							if (side[u] == to)
+								update(u, -w);
+					}
+					count[2*n + from]--;
+					count[2*n + to]++;
+					if (count[2*n + from] == 0) {
+						for (int u : g.nets[n])
+							update(u, -w);
+					} else if (count[2*n + from] == 1) {
+						for (int u : g.nets[n])
+							if (side[u] == from && u != v)
+								update(u, w);
+					}
+				}
+
+				side[v] = to;
+				weight[from] -= g.node_weight[v];
+				weight[to] += g.node_weight[v];
+				delta -= g_v;
+				moves.push_back(v);
+
+				if (balanced() && delta < best_delta) {
+					best_delta = delta;
+					best_moves = GetSize(moves);
+				}
+
+				// give up on the pass when it doesn't find anything better
+				if (GetSize(moves) - best_moves > 500)
+					break;
+			}
+
+			for (int i = GetSize(moves)-1; i >= best_moves; i--) {
+				int v = moves[i], from = side[v], to = 1-from;
+				for (int n : g.node_nets[v]) {
+					count[2*n + from]--;
+					count[2*n + to]++;
+				}
+				side[v] = to;
+				weight[from] -= g.node_weight[v];
+				weight[to] += g.node_weight[v];
+			}
+
+			if (best_moves == 0 || best_delta == 0)
+				break;
+		}
+	}
+
+	// heavy edge matching: every node is merged with the unmatched neighbor
+	// that shares the most nets with it, relative to the size of these nets
+	bool coarsen(const Hypergraph &g, Hypergraph &coarse, std::vector<int> &node_map)
+	{
+		int num_nodes = g.size();
+		int limit = std::max(1, g.total_weight() / coarsest_size);
+
+		std::vector<int> order(num_nodes);
+		for (int v = 0; v < num_nodes; v++)
+			order[v] = v;
+		for (int i = num_nodes-1; i > 0; i--)
+			std::swap(order[i], order[rng() % (i+1)]);
+
+		std::vector<int> match(num_nodes, -1);
+		std::vector<double> score(num_nodes);
+		std::vector<int> touched;
+
+		for (int v : order)
+		{
+			if (match[v] >= 0)
+				continue;
+
+			for (int n : g.node_nets[v]) {
+				int size = GetSize(g.nets[n]);
+				if (size > large_net_size)
+					continue;
+				double w = double(g.net_weight[n]) / (size-1);
+				for (int u : g.nets[n])
+					if (u != v && match[u] < 0 && g.node_weight[u] + g.node_weight[v] <= limit) {
+						if (score[u] == 0)
+							touched.push_back(u);
+						score[u] += w;
+					}
+			}
+
+			int best = v;
+			for (int u : touched) {
+				if (best == v || score[u] > score[best])
+					best = u;
+				score[u] = 0;
+			}
+			touched.clear();
+
+			match[v] = best;
+			match[best] = v;
+		}
+
+		node_map.assign(num_nodes, -1);
+		for (int v = 0; v < num_nodes; v++)
+			if (node_map[v] < 0) {
+				int weight = g.node_weight[v] + (match[v] != v ? g.node_weight[match[v]] : 0);
+				node_map[v] = node_map[match[v]] = coarse.add_node(weight);
+			}
+
+		if (coarse.size() > num_nodes - num_nodes / 10)
+			return false;
+
+		std::vector<int> pins;
+		for (int n = 0; n < GetSize(g.nets); n++) {
+			pins.clear();
+			for (int v : g.nets[n])
+				pins.push_back(node_map[v]);
+			std::sort(pins.begin(), pins.end());
+			pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+			coarse.add_net(pins, g.net_weight[n]);
+		}
+		coarse.build_node_nets();
+		return true;
+	}
+
+	// grow side 0 from a few random seeds and keep the best refined result
+	void initial(const Hypergraph &g, std::vector<int> &side, const int *max_w)
+	{
+		int num_nodes = g.size();
+		int target0 = max_w[0] - (max_w[0] + max_w[1] - g.total_weight()) / 2;
+		int best_cut = INT_MAX;
+
+		for (int attempt = 0; attempt < 8; attempt++)
+		{
+			std::vector<int> s(num_nodes, 1);
+			std::vector<int> queue;
+			int weight0 = 0;
+
+			for (int i = 0; weight0 < target0 && i <= num_nodes; i++) {
+				int seed = i == 0 ? rng() % num_nodes : i-1;
+				if (s[seed] == 0)
+					continue;
+				queue.push_back(seed);
+				s[seed] = 0;
+				weight0 += g.node_weight[seed];
+				for (int k = GetSize(queue)-1; k < GetSize(queue) && weight0 < target0; k++)
+					for (int n : g.node_nets[queue[k]])
+						for (int u : g.nets[n])
+							if (s[u] == 1 && weight0 < target0) {
+								s[u] = 0;
+								weight0 += g.node_weight[u];
+								queue.push_back(u);
+							}
+			}
+
+			refine(g, s, max_w);
+			int c = g.cut(s);
+			if (c < best_cut) {
+				best_cut = c;
+				side.swap(s);
+			}
+		}
+	}
+
+	void run(const Hypergraph &g, std::vector<int> &side, const int *max_w)
+	{
+		Hypergraph coarse;
+		std::vector<int> node_map;
+
+		if (g.size() <= coarsest_size || !coarsen(g, coarse, node_map)) {
+			initial(g, side, max_w);
+			return;
+		}
+
+		std::vector<int> coarse_side;
+		run(coarse, coarse_side, max_w);
+
+		side.resize(g.size());
+		for (int v = 0; v < g.size(); v++)
+			side[v] = coarse_side[node_map[v]];
+		refine(g, side, max_w);
+	}
+
+	void run(std::vector<int> &side)
+	{
+		if (graph.size() == 0)
+			return;
+		run(graph, side, max_weight);
+	}
+};
+
+struct PartitionWorker
+{
+	Hypergraph graph;
+	double imbalance;
+	uint32_t rng_state;
+	std::vector<int> part;
+
+	// recursive bisection of the given nodes into the parts first_part to
+	// first_part+num_parts-1
+	void split(const std::vector<int> &nodes, int first_part, int num_parts, double level_imbalance)
+	{
+		if (num_parts == 1 || nodes.empty()) {
+			for (int v : nodes)
+				part[v] = first_part;
+			return;
+		}
+
+		dict<int, int> local;
+		Hypergraph sub;
+		for (int v : nodes)
+			local[v] = sub.add_node(graph.node_weight[v]);
+
+		pool<int> nets;
+		for (int v : nodes)
+			for (int n : graph.node_nets[v])
+				nets.insert(n);
+
+		std::vector<int> pins;
+		for (int n : nets) {
+			pins.clear();
+			for (int v : graph.nets[n]) {
+				auto it = local.find(v);
+				if (it != local.end())
+					pins.push_back(it->second);
+			}
+			sub.add_net(pins, graph.net_weight[n]);
+		}
+		sub.build_node_nets();
+
+		int parts0 = num_parts / 2;
+		int total = sub.total_weight();
+		int target0 = int64_t(total) * parts0 / num_parts;
+		int max_node = *std::max_element(sub.node_weight.begin(), sub.node_weight.end());
+		int tolerance = std::max(int(target0 * level_imbalance), max_node);
+
+		std::vector<int> side;
+		Bisection bisection(sub, target0, tolerance, rng_state);
+		bisection.run(side);
+
+		std::vector<int> nodes0, nodes1;
+		for (int i = 0; i < GetSize(nodes); i++)
+			(side[i] == 0 ? nodes0 : nodes1).push_back(nodes[i]);
+
+		split(nodes0, first_part, parts0, level_imbalance);
+		split(nodes1, first_part + parts0, num_parts - parts0, level_imbalance);
+	}
+
+	void run(int num_parts)
+	{
+		int levels = 0;
+		while ((1 << levels) < num_parts)
+			levels++;
+
+		std::vector<int> nodes;
+		for (int v = 0; v < graph.size(); v++)
+			nodes.push_back(v);
+
+		part.assign(graph.size(), 0);
+		split(nodes, 0, num_parts, imbalance / std::max(levels, 1));
+	}
+};
+
+struct PartitionPass : public Pass {
+	PartitionPass() : Pass("partition", "split a module into balanced submodules") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    partition [options] [selection]\n");
+		log("\n");
+		log("This pass splits the selected cells of a module into a number of parts with\n");
+		log("about the same number of cells, so that as few nets as possible connect two\n");
+		log("parts. It uses multilevel recursive bisection: the cells are merged into\n");
+		log("clusters along the nets they share, the coarsest graph is split and the\n");
+		log("result is improved with Fiduccia-Mattheyses refinement on every level.\n");
+		log("\n");
+		log("The cells of each part are then moved to a new submodule with the 'submod'\n");
+		log("command. The submodules can be processed in parallel with 'yosys -j' (for\n");
+		log("example by 'abc' or 'opt') and merged again with 'flatten'.\n");
+		log("\n");
+		log("Only one module may be selected.\n");
+		log("\n");
+		log("    -parts <N>\n");
+		log("        the number of parts (default: 2)\n");
+		log("\n");
+		log("    -imbalance <percent>\n");
+		log("        the max. deviation of the size of a part from the average size\n");
+		log("        (default: 5)\n");
+		log("\n");
+		log("    -seed <N>\n");
+		log("        seed for the random choices of the partitioner (default: 1)\n");
+		log("\n");
+		log("    -nosubmod\n");
+		log("        only set the 'submod' attribute on the cells to part<N> and don't\n");
+		log("        call 'submod'\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		int num_parts = 2;
+		double imbalance = 5;
+		uint32_t seed = 1;
+		bool nosubmod = false;
+
+		log_header("Executing PARTITION pass (splitting module into balanced parts).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-parts" && argidx+1 < args.size()) {
+				num_parts = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-imbalance" && argidx+1 < args.size()) {
+				imbalance = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-nosubmod") {
+				nosubmod = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (num_parts < 1)
+			log_cmd_error("Invalid number of parts: %d\n", num_parts);
+
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+		if (modules.empty()) {
+			log("Nothing selected -> do nothing.\n");
+			return;
+		}
+		if (GetSize(modules) > 1)
+			log_cmd_error("More than one module selected: %s %s\n", log_id(modules[0]), log_id(modules[1]));
+
+		RTLIL::Module *module = modules.front();
+		std::vector<RTLIL::Cell*> cells = module->selected_cells();
+
+		PartitionWorker worker;
+		worker.imbalance = imbalance / 100;
+		worker.rng_state = seed ? seed : 1;
+
+		dict<RTLIL::Cell*, int> cell_node;
+		for (auto cell : cells)
+			cell_node[cell] = worker.graph.add_node(1);
+
+		ModIndex &index = module->modindex();
+		if (index.auto_reload_module)
+			index.reload_module();
+
+		std::vector<int> pins;
+		for (auto &it : index.database) {
+			pins.clear();
+			for (auto &port : it.second.ports) {
+				auto node_it = cell_node.find(port.cell);
+				if (node_it != cell_node.end())
+					pins.push_back(node_it->second);
+			}
+			std::sort(pins.begin(), pins.end());
+			pins.erase(std::unique(pins.begin(), pins.end()), pins.end());
+			worker.graph.add_net(pins, 1);
+		}
+		worker.graph.build_node_nets();
+
+		log("Partitioning %d cells with %d nets of module %s into %d parts.\n",
+				worker.graph.size(), GetSize(worker.graph.nets), log_id(module), num_parts);
+
+		worker.run(num_parts);
+
+		std::vector<int> part_size(num_parts);
+		for (int v = 0; v < worker.graph.size(); v++)
+			part_size[worker.part[v]]++;
+		for (int i = 0; i < num_parts; i++)
+			log("  part%d: %d cells\n", i, part_size[i]);
+		log("  %d nets are connected to more than one part.\n", worker.graph.cut(worker.part));
+
+		for (auto cell : cells)
+			cell->attributes["\\submod"] = RTLIL::Const(stringf("part%d", worker.part[cell_node.at(cell)]));
+
+		if (!nosubmod)
+			Pass::call_on_module(design, module, "submod");
+	}
+} PartitionPass;
+
+PRIVATE_NAMESPACE_END
@@ -39,104 +39,126 @@ struct SubmodWorker
 	struct SubModule
 	{
 		std::string name, full_name;
-		std::set<RTLIL::Cell*> cells;
+		std::vector<RTLIL::Cell*> cells;
+		std::vector<RTLIL::Wire*> wires;
 	};
 
 	std::map<std::string, SubModule> submodules;
 
-	struct wire_flags_t {
-		RTLIL::Wire *new_wire;
-		bool is_int_driven, is_int_used, is_ext_driven, is_ext_used;
-		wire_flags_t() : new_wire(NULL), is_int_driven(false), is_int_used(false), is_ext_driven(false), is_ext_used(false) { }
+	// the submodules (by index, -1 for the cells that stay in the module)
+	// with cells that are connected to, drive or use a wire
+	struct wire_info_t {
+		std::vector<int> connected, driven_by, used_by;
 	};
-	std::map<RTLIL::Wire*, wire_flags_t> wire_flags;
-	bool flag_found_something;
+	dict<RTLIL::Wire*, wire_info_t> wire_info;
 
-	void flag_wire(RTLIL::Wire *wire, bool create, bool set_int_driven, bool set_int_used, bool set_ext_driven, bool set_ext_used)
+	static bool add_index(std::vector<int> &vec, int idx)
 	{
-		if (wire_flags.count(wire) == 0) {
-			if (!create)
-				return;
-			wire_flags[wire] = wire_flags_t();
-		}
-		if (set_int_driven)
-			wire_flags[wire].is_int_driven = true;
-		if (set_int_used)
-			wire_flags[wire].is_int_used = true;
-		if (set_ext_driven)
-			wire_flags[wire].is_ext_driven = true;
-		if (set_ext_used)
-			wire_flags[wire].is_ext_used = true;
-		flag_found_something = true;
+		if (std::find(vec.begin(), vec.end(), idx) != vec.end())
+			return false;
+		vec.push_back(idx);
+		return true;
 	}
 
-	void flag_signal(const RTLIL::SigSpec &sig, bool create, bool set_int_driven, bool set_int_used, bool set_ext_driven, bool set_ext_used)
+	static bool has_other_index(const std::vector<int> &vec, int idx)
 	{
-		for (auto &c : sig.chunks())
-			if (c.wire != NULL)
-				flag_wire(c.wire, create, set_int_driven, set_int_used, set_ext_driven, set_ext_used);
+		for (int i : vec)
+			if (i != idx)
+				return true;
+		return false;
 	}
 
-	void handle_submodule(SubModule &submod)
+	// All cells and wires are classified in a single pass over the module,
+	// before any of the submodules is created. The directions of the ports of
+	// a submodule are derived from the cells in all other submodules and in
+	// the remaining module.
+	void classify_wires(std::vector<SubModule*> &submod_list)
 	{
-		log("Creating submodule %s (%s) of module %s.\n", submod.name.c_str(), submod.full_name.c_str(), module->name.c_str());
+		dict<RTLIL::Cell*, int> cell_submod;
+		std::vector<RTLIL::Cell*> unknown_ext_cells;
+		for (int i = 0; i < GetSize(submod_list); i++)
+			for (auto cell : submod_list[i]->cells)
+				cell_submod[cell] = i;
 
-		wire_flags.clear();
-		for (RTLIL::Cell *cell : submod.cells) {
-			if (ct.cell_known(cell->type)) {
-				for (auto &conn : cell->connections())
-					flag_signal(conn.second, true, ct.cell_output(cell->type, conn.first), ct.cell_input(cell->type, conn.first), false, false);
-			} else {
-				log_warning("Port directions for cell %s (%s) are unknown. Assuming inout for all ports.\n", cell->name.c_str(), cell->type.c_str());
-				for (auto &conn : cell->connections())
-					flag_signal(conn.second, true, true, true, false, false);
-			}
-		}
-		for (auto &it : module->cells_) {
+		for (auto &it : module->cells_)
+		{
 			RTLIL::Cell *cell = it.second;
-			if (submod.cells.count(cell) > 0)
-				continue;
-			if (ct.cell_known(cell->type)) {
-				for (auto &conn : cell->connections())
-					flag_signal(conn.second, false, false, false, ct.cell_output(cell->type, conn.first), ct.cell_input(cell->type, conn.first));
-			} else {
-				flag_found_something = false;
-				for (auto &conn : cell->connections())
-					flag_signal(conn.second, false, false, false, true, true);
-				if (flag_found_something)
-					log_warning("Port directions for cell %s (%s) are unknown. Assuming inout for all ports.\n", cell->name.c_str(), cell->type.c_str());
+			auto submod_it = cell_submod.find(cell);
+			int idx = submod_it == cell_submod.end() ? -1 : submod_it->second;
+			bool known = ct.cell_known(cell->type);
+
+			for (auto &conn : cell->connections())
+			{
+				bool is_driver = !known || ct.cell_output(cell->type, conn.first);
+				bool is_user = !known || ct.cell_input(cell->type, conn.first);
+
+				for (auto &c : conn.second.chunks())
+				{
+					if (c.wire == NULL)
+						continue;
+
+					wire_info_t &info = wire_info[c.wire];
+					if (add_index(info.connected, idx) && idx >= 0)
+						submod_list[idx]->wires.push_back(c.wire);
+					if (is_driver)
+						add_index(info.driven_by, idx);
+					if (is_user)
+						add_index(info.used_by, idx);
+				}
 			}
+
+			if (!known && idx >= 0)
+				log_warning("Port directions for cell %s (%s) are unknown. Assuming inout for all ports.\n", cell->name.c_str(), cell->type.c_str());
+			if (!known && idx < 0)
+				unknown_ext_cells.push_back(cell);
 		}
 
+		// only warn about the cells outside of the submodules that are connected to one
+		for (auto cell : unknown_ext_cells)
+		{
+			bool found_something = false;
+			for (auto &conn : cell->connections())
+				for (auto &c : conn.second.chunks())
+					if (c.wire != NULL && has_other_index(wire_info.at(c.wire).connected, -1))
+						found_something = true;
+			if (found_something)
+				log_warning("Port directions for cell %s (%s) are unknown. Assuming inout for all ports.\n", cell->name.c_str(), cell->type.c_str());
+		}
+	}
+
+	void handle_submodule(SubModule &submod, int idx)
+	{
+		log("Creating submodule %s (%s) of module %s.\n", submod.name.c_str(), submod.full_name.c_str(), module->name.c_str());
+
 		RTLIL::Module *new_mod = new RTLIL::Module;
 		new_mod->name = submod.full_name;
 		design->add(new_mod);
 		int auto_name_counter = 1;
 
 		std::set<RTLIL::IdString> all_wire_names;
-		for (auto &it : wire_flags) {
-			all_wire_names.insert(it.first->name);
-		}
+		for (auto wire : submod.wires)
+			all_wire_names.insert(wire->name);
+
+		dict<RTLIL::Wire*, RTLIL::Wire*> new_wires;
 
-		for (auto &it : wire_flags)
+		for (auto wire : submod.wires)
 		{
-			RTLIL::Wire *wire = it.first;
-			wire_flags_t &flags = it.second;
+			wire_info_t &info = wire_info.at(wire);
 
-			if (wire->port_input)
-				flags.is_ext_driven = true;
-			if (wire->port_output)
-				flags.is_ext_used = true;
+			bool is_int_driven = std::find(info.driven_by.begin(), info.driven_by.end(), idx) != info.driven_by.end();
+			bool is_int_used = std::find(info.used_by.begin(), info.used_by.end(), idx) != info.used_by.end();
+			bool is_ext_driven = wire->port_input || has_other_index(info.driven_by, idx);
+			bool is_ext_used = wire->port_output || has_other_index(info.used_by, idx);
 
 			bool new_wire_port_input = false;
 			bool new_wire_port_output = false;
 
-			if (flags.is_int_driven && flags.is_ext_used)
+			if (is_int_driven && is_ext_used)
 				new_wire_port_output = true;
-			if (flags.is_ext_driven && flags.is_int_used)
+			if (is_ext_driven && is_int_used)
 				new_wire_port_input = true;
 
-			if (flags.is_int_driven && flags.is_ext_driven)
+			if (is_int_driven && is_ext_driven)
 				new_wire_port_input = true, new_wire_port_output = true;
 
 			std::string new_wire_name = wire->name.str();
@@ -165,7 +187,7 @@ struct SubmodWorker
 			else
 				log("  signal %s: internal\n", wire->name.c_str());
 
-			flags.new_wire = new_wire;
+			new_wires[wire] = new_wire;
 		}
 
 		new_mod->fixup_ports();
@@ -174,10 +196,8 @@ struct SubmodWorker
 			RTLIL::Cell *new_cell = new_mod->addCell(cell->name, cell);
 			for (auto &conn : new_cell->connections_)
 				for (auto &bit : conn.second)
-					if (bit.wire != NULL) {
-						log_assert(wire_flags.count(bit.wire) > 0);
-						bit.wire = wire_flags[bit.wire].new_wire;
-					}
+					if (bit.wire != NULL)
+						bit.wire = new_wires.at(bit.wire);
 			log("  cell %s (%s)\n", new_cell->name.c_str(), new_cell->type.c_str());
 			if (!copy_mode)
 				module->remove(cell);
@@ -186,12 +206,11 @@ struct SubmodWorker
 
 		if (!copy_mode) {
 			RTLIL::Cell *new_cell = module->addCell(submod.full_name, submod.full_name);
-			for (auto &it : wire_flags)
+			for (auto wire : submod.wires)
 			{
-				RTLIL::Wire *old_wire = it.first;
-				RTLIL::Wire *new_wire = it.second.new_wire;
+				RTLIL::Wire *new_wire = new_wires.at(wire);
 				if (new_wire->port_id > 0)
-					new_cell->setPort(new_wire->name, RTLIL::SigSpec(old_wire));
+					new_cell->setPort(new_wire->name, RTLIL::SigSpec(wire));
 			}
 		}
 	}
@@ -242,7 +261,7 @@ struct SubmodWorker
 						submodules[submod_str].full_name += "_";
 				}
 
-				submodules[submod_str].cells.insert(cell);
+				submodules[submod_str].cells.push_back(cell);
 			}
 		}
 		else
@@ -254,15 +273,21 @@ struct SubmodWorker
 					continue;
 				submodules[opt_name].name = opt_name;
 				submodules[opt_name].full_name = RTLIL::escape_id(opt_name);
-				submodules[opt_name].cells.insert(cell);
+				submodules[opt_name].cells.push_back(cell);
 			}
 
 			if (submodules.size() == 0)
 				log("Nothing selected -> do nothing.\n");
 		}
 
+		std::vector<SubModule*> submod_list;
 		for (auto &it : submodules)
-			handle_submodule(it.second);
+			submod_list.push_back(&it.second);
+
+		classify_wires(submod_list);
+
+		for (int i = 0; i < GetSize(submod_list); i++)
+			handle_submodule(*submod_list[i], i);
 	}
 };
 
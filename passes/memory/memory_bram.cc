@@ -43,6 +43,10 @@ struct rules_t
 		int groups, abits, dbits, init;
 		vector<int> ports, wrmode, enable, transp, clocks, clkpol;
 
+		// set by rules_t::prepare()
+		int avail_rd_ports, avail_wr_ports;
+		dict<IdString, Const> variant_params;
+
 		void dump_config() const
 		{
 			log("      bram %s # variant %d\n", log_id(name), variant);
@@ -355,6 +359,29 @@ struct rules_t
 		}
 
 		infile.close();
+		prepare();
+	}
+
+	// derive everything that only depends on the rules file once, instead of
+	// re-computing it for each bram variant and $mem cell in handle_cell()
+	void prepare()
+	{
+		for (auto &it : brams)
+		for (auto &bram : it.second)
+		{
+			bram.avail_rd_ports = 0;
+			bram.avail_wr_ports = 0;
+			for (int j = 0; j < bram.groups; j++) {
+				if (GetSize(bram.wrmode) < j || bram.wrmode.at(j) == 0)
+					bram.avail_rd_ports += GetSize(bram.ports) < j ? bram.ports.at(j) : 0;
+				if (GetSize(bram.wrmode) < j || bram.wrmode.at(j) != 0)
+					bram.avail_wr_ports += GetSize(bram.ports) < j ? bram.ports.at(j) : 0;
+			}
+
+			bram.variant_params.clear();
+			for (auto &other_bram : it.second)
+				bram.find_variant_params(bram.variant_params, other_bram);
+		}
 	}
 };
 
@@ -784,11 +811,7 @@ grow_read_ports:;
 			return true;
 	}
 
-	// prepare variant parameters
-
-	dict<IdString, Const> variant_params;
-	for (auto &other_bram : rules.brams.at(bram.name))
-		bram.find_variant_params(variant_params, other_bram);
+	const dict<IdString, Const> &variant_params = bram.variant_params;
 
 	// actually replace that memory cell
 
@@ -956,7 +979,66 @@ grow_read_ports:;
 	return true;
 }
 
-void handle_cell(Cell *cell, const rules_t &rules)
+struct match_cache_t {
+	IdString module, cell;
+	int rule, variant, mode;
+};
+
+// everything in a $mem cell that replace_cell() looks at when deciding if a
+// bram variant can be used. signal bits are replaced by their index of first
+// occurrence, so cells that only differ in the actual nets get the same string.
+string memory_signature(Cell *cell)
+{
+	string signature;
+
+	for (auto param : {"\\SIZE", "\\ABITS", "\\WIDTH", "\\WR_PORTS", "\\RD_PORTS", "\\WR_CLK_ENABLE",
+			"\\WR_CLK_POLARITY", "\\RD_CLK_ENABLE", "\\RD_CLK_POLARITY", "\\RD_TRANSPARENT"})
+		signature += stringf("%s=%s ", param + 1, cell->getParam(param).as_string().c_str());
+
+	signature += SigSpec(cell->getParam("\\INIT")).is_fully_undef() ? "noinit" : "init";
+
+	dict<SigBit, int> bit_ids;
+	for (auto port : {"\\WR_CLK", "\\WR_EN", "\\RD_CLK", "\\RD_EN"}) {
+		signature += stringf(" %s=", port + 1);
+		for (auto bit : cell->getPort(port)) {
+			if (bit.wire == nullptr) {
+				signature += stringf("c%d,", bit.data);
+				continue;
+			}
+			if (!bit_ids.count(bit))
+				bit_ids[bit] = GetSize(bit_ids);
+			signature += stringf("%d,", bit_ids.at(bit));
+		}
+	}
+
+	return signature;
+}
+
+void estimate_properties(dict<string, int> &match_properties, const rules_t::bram_t &bram)
+{
+	int dups = bram.avail_rd_ports ? (match_properties["rports"] + bram.avail_rd_ports - 1) / bram.avail_rd_ports : 1;
+	match_properties["dups"] = dups;
+
+	int aover = match_properties["words"] % (1 << bram.abits);
+	int awaste = aover ? (1 << bram.abits) - aover : 0;
+	match_properties["awaste"] = awaste;
+
+	int dover = match_properties["dbits"] % bram.dbits;
+	int dwaste = dover ? bram.dbits - dover : 0;
+	match_properties["dwaste"] = dwaste;
+
+	int bwaste = awaste * bram.dbits + dwaste * (1 << bram.abits) - awaste * dwaste;
+	match_properties["bwaste"] = bwaste;
+
+	int waste = match_properties["dups"] * bwaste;
+	match_properties["waste"] = waste;
+
+	int cells = ((match_properties["dbits"] + bram.dbits - 1) / bram.dbits) * ((match_properties["words"] + (1 << bram.abits) - 1) / (1 << bram.abits));
+	int efficiency = (100 * match_properties["bits"]) / (dups * cells * bram.dbits * (1 << bram.abits));
+	match_properties["efficiency"] = efficiency;
+}
+
+void handle_cell(Cell *cell, const rules_t &rules, dict<string, match_cache_t> &match_cache)
 {
 	log("Processing %s.%s:\n", log_id(cell->module), log_id(cell));
 
@@ -976,6 +1058,34 @@ void handle_cell(Cell *cell, const rules_t &rules)
 		log(" %s=%d", it.first.c_str(), it.second);
 	log("\n");
 
+	string signature = memory_signature(cell);
+	match_cache_t *cached = match_cache.count(signature) ? &match_cache.at(signature) : nullptr;
+
+	if (cached != nullptr)
+	{
+		log("  Re-using match result from identical memory %s.%s.\n", log_id(cached->module), log_id(cached->cell));
+
+		if (cached->rule < 0) {
+			log("  No acceptable bram resources found.\n");
+			return;
+		}
+
+		auto &match = rules.matches.at(cached->rule);
+		auto &bram = rules.brams.at(match.name).at(cached->variant);
+
+		if (cached->mode == 0)
+			estimate_properties(match_properties, bram);
+
+		if (!replace_cell(cell, rules, bram, match, match_properties, cached->mode))
+			log_error("Mapping to bram type %s (variant %d) failed for identical memory.\n", log_id(bram.name), bram.variant);
+		return;
+	}
+
+	match_cache_t &result = match_cache[signature];
+	result.module = cell->module->name;
+	result.cell = cell->name;
+	result.rule = -1;
+
 	pool<pair<IdString, int>> failed_brams;
 	dict<pair<int, int>, tuple<int, int, int>> best_rule_cache;
 
@@ -994,43 +1104,15 @@ void handle_cell(Cell *cell, const rules_t &rules)
 			if (failed_brams.count(pair<IdString, int>(bram.name, bram.variant)))
 				continue;
 
-			int avail_rd_ports = 0;
-			int avail_wr_ports = 0;
-			for (int j = 0; j < bram.groups; j++) {
-				if (GetSize(bram.wrmode) < j || bram.wrmode.at(j) == 0)
-					avail_rd_ports += GetSize(bram.ports) < j ? bram.ports.at(j) : 0;
-				if (GetSize(bram.wrmode) < j || bram.wrmode.at(j) != 0)
-					avail_wr_ports += GetSize(bram.ports) < j ? bram.ports.at(j) : 0;
-			}
-
 			log("  Checking rule #%d for bram type %s (variant %d):\n", i+1, log_id(bram.name), bram.variant);
-			log("    Bram geometry: abits=%d dbits=%d wports=%d rports=%d\n", bram.abits, bram.dbits, avail_wr_ports, avail_rd_ports);
+			log("    Bram geometry: abits=%d dbits=%d wports=%d rports=%d\n", bram.abits, bram.dbits, bram.avail_wr_ports, bram.avail_rd_ports);
 
-			int dups = avail_rd_ports ? (match_properties["rports"] + avail_rd_ports - 1) / avail_rd_ports : 1;
-			match_properties["dups"] = dups;
+			estimate_properties(match_properties, bram);
 
 			log("    Estimated number of duplicates for more read ports: dups=%d\n", match_properties["dups"]);
-
-			int aover = match_properties["words"] % (1 << bram.abits);
-			int awaste = aover ? (1 << bram.abits) - aover : 0;
-			match_properties["awaste"] = awaste;
-
-			int dover = match_properties["dbits"] % bram.dbits;
-			int dwaste = dover ? bram.dbits - dover : 0;
-			match_properties["dwaste"] = dwaste;
-
-			int bwaste = awaste * bram.dbits + dwaste * (1 << bram.abits) - awaste * dwaste;
-			match_properties["bwaste"] = bwaste;
-
-			int waste = match_properties["dups"] * bwaste;
-			match_properties["waste"] = waste;
-
-			int cells = ((match_properties["dbits"] + bram.dbits - 1) / bram.dbits) * ((match_properties["words"] + (1 << bram.abits) - 1) / (1 << bram.abits));
-			int efficiency = (100 * match_properties["bits"]) / (dups * cells * bram.dbits * (1 << bram.abits));
-			match_properties["efficiency"] = efficiency;
-
 			log("    Metrics for %s: awaste=%d dwaste=%d bwaste=%d waste=%d efficiency=%d\n",
-					log_id(match.name), awaste, dwaste, bwaste, waste, efficiency);
+					log_id(match.name), match_properties["awaste"], match_properties["dwaste"],
+					match_properties["bwaste"], match_properties["waste"], match_properties["efficiency"]);
 
 			if (cell_init && bram.init == 0) {
 				log("    Rule #%d for bram type %s (variant %d) rejected: cannot be initialized.\n",
@@ -1100,6 +1182,9 @@ void handle_cell(Cell *cell, const rules_t &rules)
 				auto &best_bram = rules.brams.at(rules.matches.at(best_rule.first).name).at(best_rule.second);
 				if (!replace_cell(cell, rules, best_bram, rules.matches.at(best_rule.first), match_properties, 2))
 					log_error("Mapping to bram type %s (variant %d) after pre-selection failed.\n", log_id(best_bram.name), best_bram.variant);
+				result.rule = best_rule.first;
+				result.variant = best_rule.second;
+				result.mode = 2;
 				return;
 			}
 
@@ -1108,6 +1193,9 @@ void handle_cell(Cell *cell, const rules_t &rules)
 				failed_brams.insert(pair<IdString, int>(bram.name, bram.variant));
 				goto next_match_rule;
 			}
+			result.rule = i;
+			result.variant = vi;
+			result.mode = 0;
 			return;
 		}
 	}
@@ -1117,6 +1205,7 @@ void handle_cell(Cell *cell, const rules_t &rules)
 
 struct MemoryBramPass : public Pass {
 	MemoryBramPass() : Pass("memory_bram", "map memories to block rams") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1223,10 +1312,12 @@ struct MemoryBramPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
+		dict<string, match_cache_t> match_cache;
+
 		for (auto mod : design->selected_modules())
 		for (auto cell : mod->selected_cells())
 			if (cell->type == "$mem")
-				handle_cell(cell, rules);
+				handle_cell(cell, rules, match_cache);
 	}
 } MemoryBramPass;
 
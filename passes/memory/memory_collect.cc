@@ -32,7 +32,7 @@ bool memcells_cmp(Cell *a, Cell *b)
 	return a->parameters.at("\\PRIORITY").as_int() < b->parameters.at("\\PRIORITY").as_int();
 }
 
-Cell *handle_memory(Module *module, RTLIL::Memory *memory)
+Cell *handle_memory(Module *module, SigMap &sigmap, RTLIL::Memory *memory, std::vector<Cell*> &memcells)
 {
 	log("Collecting $memrd, $memwr and $meminit for memory `%s' in module `%s':\n",
 			memory->name.c_str(), module->name.c_str());
@@ -40,7 +40,6 @@ Cell *handle_memory(Module *module, RTLIL::Memory *memory)
 	int addr_bits = 0;
 
 	Const init_data(State::Sx, memory->size * memory->width);
-	SigMap sigmap(module);
 
 	int wr_ports = 0;
 	SigSpec sig_wr_clk;
@@ -59,15 +58,10 @@ Cell *handle_memory(Module *module, RTLIL::Memory *memory)
 	SigSpec sig_rd_data;
 	SigSpec sig_rd_en;
 
-	std::vector<Cell*> memcells;
+	int meminit_cells = 0, meminit_words = 0;
 
-	for (auto &cell_it : module->cells_) {
-		Cell *cell = cell_it.second;
-		if (cell->type.in("$memrd", "$memwr", "$meminit") && memory->name == cell->parameters["\\MEMID"].decode_string()) {
-			addr_bits = max(addr_bits, cell->getParam("\\ABITS").as_int());
-			memcells.push_back(cell);
-		}
-	}
+	for (auto cell : memcells)
+		addr_bits = max(addr_bits, cell->getParam("\\ABITS").as_int());
 
 	if (memcells.empty()) {
 		log("  no cells found. removing memory.\n");
@@ -78,8 +72,6 @@ Cell *handle_memory(Module *module, RTLIL::Memory *memory)
 
 	for (auto cell : memcells)
 	{
-		log("  %s (%s)\n", log_id(cell), log_id(cell->type));
-
 		if (cell->type == "$meminit")
 		{
 			SigSpec addr = sigmap(cell->getPort("\\ADDR"));
@@ -91,17 +83,23 @@ Cell *handle_memory(Module *module, RTLIL::Memory *memory)
 				log_error("Non-constant data %s in memory initialization %s.\n", log_signal(data), log_id(cell));
 
 			int offset = (addr.as_int() - memory->start_offset) * memory->width;
+			Const data_bits = data.as_const();
 
-			if (offset < 0 || offset + GetSize(data) > GetSize(init_data))
+			if (offset < 0 || offset + GetSize(data_bits) > GetSize(init_data))
 				log_warning("Address %s in memory initialization %s is out-of-bounds.\n", log_signal(addr), log_id(cell));
 
-			for (int i = 0; i < GetSize(data); i++)
-				if (0 <= i+offset && i+offset < GetSize(init_data))
-					init_data.bits[i+offset] = data[i].data;
+			// copy the bits of the whole block of words at once
+			int begin = max(0, -offset), end = min(GetSize(data_bits), GetSize(init_data) - offset);
+			if (begin < end)
+				std::copy(data_bits.bits.begin() + begin, data_bits.bits.begin() + end, init_data.bits.begin() + offset + begin);
 
+			meminit_cells++;
+			meminit_words += GetSize(data_bits) / max(memory->width, 1);
 			continue;
 		}
 
+		log("  %s (%s)\n", log_id(cell), log_id(cell->type));
+
 		if (cell->type == "$memwr")
 		{
 			SigSpec clk = sigmap(cell->getPort("\\CLK"));
@@ -165,6 +163,9 @@ Cell *handle_memory(Module *module, RTLIL::Memory *memory)
 		}
 	}
 
+	if (meminit_cells > 0)
+		log("  %d $meminit cells with %d words.\n", meminit_cells, meminit_words);
+
 	std::stringstream sstr;
 	sstr << "$mem$" << memory->name.str() << "$" << (autoidx++);
 
@@ -221,9 +222,23 @@ static void handle_module(Design *design, Module *module)
 {
 	std::vector<pair<Cell*, IdString>> finqueue;
 
+	// the memory cells of all memories are found in a single pass over the module
+	dict<IdString, std::vector<Cell*>> memcells;
+	for (auto cell : module->cells())
+		if (cell->type.in("$memrd", "$memwr", "$meminit"))
+			memcells[cell->parameters["\\MEMID"].decode_string()].push_back(cell);
+
+	// one SigMap for all memories, building it costs as much as the scan above
+	SigMap sigmap;
+	bool sigmap_built = false;
+
 	for (auto &mem_it : module->memories)
 		if (design->selected(module, mem_it.second)) {
-			Cell *c = handle_memory(module, mem_it.second);
+			if (!sigmap_built) {
+				sigmap.set(module);
+				sigmap_built = true;
+			}
+			Cell *c = handle_memory(module, sigmap, mem_it.second, memcells[mem_it.first]);
 			finqueue.push_back(pair<Cell*, IdString>(c, mem_it.first));
 		}
 	for (auto &it : finqueue) {
@@ -236,6 +251,7 @@ static void handle_module(Design *design, Module *module)
 
 struct MemoryCollectPass : public Pass {
 	MemoryCollectPass() : Pass("memory_collect", "creating multi-port memory cells") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
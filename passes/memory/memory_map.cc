@@ -30,11 +30,15 @@ struct MemoryMapWorker
 {
 	RTLIL::Design *design;
 	RTLIL::Module *module;
+	bool compact;
 
-	std::map<std::pair<RTLIL::SigSpec, RTLIL::SigSpec>, RTLIL::SigBit> decoder_cache;
+	dict<std::pair<RTLIL::SigSpec, RTLIL::SigSpec>, RTLIL::SigBit> decoder_cache;
 
 	std::string genid(RTLIL::IdString name, std::string token1 = "", int i = -1, std::string token2 = "", int j = -1, std::string token3 = "", int k = -1, std::string token4 = "")
 	{
+		if (compact)
+			return stringf("$memory$%d", autoidx++);
+
 		std::stringstream sstr;
 		sstr << "$memory" << name.str() << token1;
 
@@ -140,8 +144,15 @@ struct MemoryMapWorker
 
 		log("Mapping memory cell %s in module %s:\n", cell->name.c_str(), module->name.c_str());
 
+		// one $dff per word, a read mux per word and read port, and up to
+		// two cells per word and write port (plus the wires between them)
+		module->cells_.reserve(GetSize(module->cells_) + mem_size * (1 + rd_ports + 2*wr_ports));
+		module->wires_.reserve(GetSize(module->wires_) + mem_size * (2 + 2*rd_ports + 2*wr_ports));
+
 		std::vector<RTLIL::SigSpec> data_reg_in;
 		std::vector<RTLIL::SigSpec> data_reg_out;
+		data_reg_in.reserve(mem_size);
+		data_reg_out.reserve(mem_size);
 
 		int count_static = 0;
 
@@ -188,6 +199,9 @@ struct MemoryMapWorker
 
 		int count_dff = 0, count_mux = 0, count_wrmux = 0;
 
+		// read ports with the same (effective) address share one mux tree
+		dict<RTLIL::SigSpec, RTLIL::SigSpec> rdmux_cache;
+
 		for (int i = 0; i < cell->parameters["\\RD_PORTS"].as_int(); i++)
 		{
 			RTLIL::SigSpec rd_addr = cell->getPort("\\RD_ADDR").extract(i*mem_abits, mem_abits);
@@ -240,6 +254,12 @@ struct MemoryMapWorker
 				}
 			}
 
+			if (rdmux_cache.count(rd_addr)) {
+				module->connect(RTLIL::SigSig(rd_signals.back(), rdmux_cache.at(rd_addr)));
+				continue;
+			}
+			rdmux_cache[rd_addr] = rd_signals.back();
+
 			for (int j = 0; j < mem_abits; j++)
 			{
 				std::vector<RTLIL::SigSpec> next_rd_signals;
@@ -268,6 +288,22 @@ struct MemoryMapWorker
 
 		log("  read interface: %d $dff and %d $mux cells.\n", count_dff, count_mux);
 
+		// the write port signals (and the address offset logic) are the same
+		// for all words, so that the address decoders are shared as well
+		std::vector<RTLIL::SigSpec> wr_addr_sigs, wr_data_sigs, wr_en_sigs;
+
+		for (int j = 0; j < wr_ports; j++)
+		{
+			RTLIL::SigSpec wr_addr = cell->getPort("\\WR_ADDR").extract(j*mem_abits, mem_abits);
+
+			if (mem_offset)
+				wr_addr = module->Sub(NEW_ID, wr_addr, SigSpec(mem_offset, GetSize(wr_addr)));
+
+			wr_addr_sigs.push_back(wr_addr);
+			wr_data_sigs.push_back(cell->getPort("\\WR_DATA").extract(j*mem_width, mem_width));
+			wr_en_sigs.push_back(cell->getPort("\\WR_EN").extract(j*mem_width, mem_width));
+		}
+
 		for (int i = 0; i < mem_size; i++)
 		{
 			if (static_cells_map.count(i) > 0)
@@ -275,14 +311,11 @@ struct MemoryMapWorker
 
 			RTLIL::SigSpec sig = data_reg_out[i];
 
-			for (int j = 0; j < cell->parameters["\\WR_PORTS"].as_int(); j++)
+			for (int j = 0; j < wr_ports; j++)
 			{
-				RTLIL::SigSpec wr_addr = cell->getPort("\\WR_ADDR").extract(j*mem_abits, mem_abits);
-				RTLIL::SigSpec wr_data = cell->getPort("\\WR_DATA").extract(j*mem_width, mem_width);
-				RTLIL::SigSpec wr_en = cell->getPort("\\WR_EN").extract(j*mem_width, mem_width);
-
-				if (mem_offset)
-					wr_addr = module->Sub(NEW_ID, wr_addr, SigSpec(mem_offset, GetSize(wr_addr)));
+				const RTLIL::SigSpec &wr_addr = wr_addr_sigs[j];
+				const RTLIL::SigSpec &wr_data = wr_data_sigs[j];
+				const RTLIL::SigSpec &wr_en = wr_en_sigs[j];
 
 				RTLIL::Wire *w_seladdr = addr_decode(wr_addr, RTLIL::SigSpec(i, mem_abits));
 
@@ -339,7 +372,7 @@ struct MemoryMapWorker
 		module->remove(cell);
 	}
 
-	MemoryMapWorker(RTLIL::Design *design, RTLIL::Module *module) : design(design), module(module)
+	MemoryMapWorker(RTLIL::Design *design, RTLIL::Module *module, bool compact) : design(design), module(module), compact(compact)
 	{
 		std::vector<RTLIL::Cell*> cells;
 		for (auto cell : module->selected_cells())
@@ -352,21 +385,39 @@ struct MemoryMapWorker
 
 struct MemoryMapPass : public Pass {
 	MemoryMapPass() : Pass("memory_map", "translate multiport memories to basic cells") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    memory_map [selection]\n");
+		log("    memory_map [options] [selection]\n");
 		log("\n");
 		log("This pass converts multiport memory cells as generated by the memory_collect\n");
 		log("pass to word-wide DFFs and address decoders.\n");
 		log("\n");
+		log("    -compact\n");
+		log("        use short auto-generated names for the created cells and wires\n");
+		log("        instead of names that contain the memory name and word index.\n");
+		log("        This is much faster for very deep memories.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design) {
+		bool compact = false;
+
 		log_header("Executing MEMORY_MAP pass (converting $mem cells to logic and flip-flops).\n");
-		extra_args(args, 1, design);
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-compact") {
+				compact = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
 		for (auto mod : design->selected_modules())
-			MemoryMapWorker(design, mod);
+			MemoryMapWorker(design, mod, compact);
 	}
 } MemoryMapPass;
 
@@ -42,6 +42,14 @@ struct MemoryShareWorker
 	ModWalker modwalker;
 	CellTypes cone_ct;
 
+	// one SAT problem for all memories in the module: the input cones of the EN
+	// signals are only encoded once, even if they are shared between memories
+	ezSatPtr ez;
+	SatGen satgen;
+	pool<RTLIL::Cell*> sat_imported_cells;
+	dict<RTLIL::Wire*, int> sat_onehot_cache;
+	dict<std::tuple<int, int, int>, bool> sat_solve_cache;
+
 	std::map<RTLIL::SigBit, std::pair<RTLIL::Cell*, int>> sig_to_mux;
 	std::map<std::set<std::map<RTLIL::SigBit, bool>>, RTLIL::SigBit> conditions_logic_cache;
 
@@ -492,9 +500,6 @@ struct MemoryShareWorker
 		if (wr_ports.size() <= 1)
 			return;
 
-		ezSatPtr ez;
-		SatGen satgen(ez.get(), &modwalker.sigmap);
-
 		// find list of considered ports and port pairs
 
 		std::set<int> considered_ports;
@@ -580,19 +585,36 @@ struct MemoryShareWorker
 				}
 		}
 
+		// the one-hot constraints only hold for this memory's queries: they are
+		// passed to the solver as an assumption and not added to the shared problem
+
+		std::vector<int> one_hot_constraints;
+
 		for (auto wire : one_hot_wires) {
 			log("  Adding one-hot constraint for wire %s.\n", log_id(wire));
-			vector<int> ez_wire_bits = satgen.importSigSpec(wire);
-			for (int i : ez_wire_bits)
-			for (int j : ez_wire_bits)
-				if (i != j) ez->assume(ez->NOT(i), j);
+			if (!sat_onehot_cache.count(wire)) {
+				std::vector<int> ez_wire_bits = satgen.importSigSpec(wire);
+				std::vector<int> pair_constraints;
+				for (int i : ez_wire_bits)
+				for (int j : ez_wire_bits)
+					if (i != j) pair_constraints.push_back(ez->OR(ez->NOT(i), ez->NOT(j)));
+				sat_onehot_cache[wire] = ez->expression(ez->OpAnd, pair_constraints);
+			}
+			one_hot_constraints.push_back(sat_onehot_cache.at(wire));
 		}
 
-		log("  Common input cone for all EN signals: %d cells.\n", int(sat_cells.size()));
+		int one_hot_assumption = one_hot_constraints.empty() ? 0 : ez->expression(ez->OpAnd, one_hot_constraints);
 
+		int new_sat_cells = 0;
 		for (auto cell : sat_cells)
-			satgen.importCell(cell);
+			if (!sat_imported_cells.count(cell)) {
+				satgen.importCell(cell);
+				sat_imported_cells.insert(cell);
+				new_sat_cells++;
+			}
 
+		log("  Common input cone for all EN signals: %d cells (%d already encoded for other memories).\n",
+				int(sat_cells.size()), int(sat_cells.size()) - new_sat_cells);
 		log("  Size of unconstrained SAT problem: %d variables, %d clauses\n", ez->numCnfVariables(), ez->numCnfClauses());
 
 		// merge subsequent ports if possible
@@ -602,7 +624,12 @@ struct MemoryShareWorker
 			if (!considered_port_pairs.count(i))
 				continue;
 
-			if (ez->solve(port_to_sat_variable.at(i-1), port_to_sat_variable.at(i))) {
+			std::tuple<int, int, int> query(port_to_sat_variable.at(i-1), port_to_sat_variable.at(i), one_hot_assumption);
+
+			if (!sat_solve_cache.count(query))
+				sat_solve_cache[query] = ez->solve(std::get<0>(query), std::get<1>(query), std::get<2>(query));
+
+			if (sat_solve_cache.at(query)) {
 				log("  According to SAT solver sharing of port %d with port %d is not possible.\n", i-1, i);
 				continue;
 			}
@@ -661,7 +688,7 @@ struct MemoryShareWorker
 	// -------------
 
 	MemoryShareWorker(RTLIL::Design *design, RTLIL::Module *module) :
-			design(design), module(module), sigmap(module)
+			design(design), module(module), sigmap(module->sigmap()), satgen(ez.get(), &modwalker.sigmap)
 	{
 		std::map<std::string, std::pair<std::vector<RTLIL::Cell*>, std::vector<RTLIL::Cell*>>> memindex;
 
@@ -723,6 +750,7 @@ struct MemoryShareWorker
 
 struct MemorySharePass : public Pass {
 	MemorySharePass() : Pass("memory_share", "consolidate memory ports") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -52,7 +52,7 @@ struct keep_cache_t
 			return cache.at(module);
 
 		cache[module] = true;
-		if (!module->get_bool_attribute("\\keep")) {
+		if (!module->get_bool_attribute(ID::keep)) {
 			bool found_keep = false;
 			for (auto cell : module->cells())
 				if (query(cell)) found_keep = true;
@@ -81,71 +81,168 @@ keep_cache_t keep_cache;
 CellTypes ct_reg, ct_all;
 int count_rm_cells, count_rm_wires;
 
-void rmunused_module_cells(Module *module, bool verbose)
+// assigns each wire bit of a module a contiguous integer index, so that the
+// liveness sweeps below can run on flat arrays instead of hashed SigBit sets.
+// the indices are only valid as long as no wires are added or removed.
+struct dense_bits_t
 {
-	SigMap sigmap(module);
-	pool<Cell*> queue, unused;
-	dict<SigBit, pool<Cell*>> wire2driver;
+	dict<RTLIL::Wire*, int> wire_offset;
+	int total_bits;
 
-	for (auto &it : module->cells_) {
-		Cell *cell = it.second;
+	dense_bits_t(RTLIL::Module *module) : total_bits(0)
+	{
+		wire_offset.reserve(GetSize(module->wires_));
+		for (auto &it : module->wires_) {
+			wire_offset[it.second] = total_bits;
+			total_bits += it.second->width;
+		}
+	}
+
+	int operator()(const RTLIL::SigBit &bit) const
+	{
+		if (bit.wire == nullptr)
+			return -1;
+		return wire_offset.at(bit.wire) + bit.offset;
+	}
+};
+
+// a SigPool replacement on top of dense_bits_t
+struct dense_pool_t
+{
+	const dense_bits_t &index;
+	std::vector<bool> bits;
+
+	dense_pool_t(const dense_bits_t &index) : index(index), bits(index.total_bits) { }
+
+	void add(const RTLIL::SigSpec &sig)
+	{
+		for (auto &bit : sig)
+			if (bit.wire != nullptr)
+				bits[index(bit)] = true;
+	}
+
+	bool check(const RTLIL::SigBit &bit) const
+	{
+		return bit.wire != nullptr && bits[index(bit)];
+	}
+
+	bool check_any(const RTLIL::SigSpec &sig) const
+	{
+		for (auto &bit : sig)
+			if (check(bit))
+				return true;
+		return false;
+	}
+};
+
+void rmunused_module_cells(Module *module, bool verbose)
+{
+	const SigMap &sigmap = module->sigmap();
+	dense_bits_t bitidx(module);
+
+	std::vector<Cell*> cells;
+	cells.reserve(GetSize(module->cells_));
+	for (auto &it : module->cells_)
+		cells.push_back(it.second);
+
+	// (bit, cell) pairs for all driven bits and the input bits of all cells,
+	// converted to compressed adjacency arrays below
+	std::vector<std::pair<int, int>> driver_edges;
+	std::vector<int> cell_inputs_start, cell_inputs;
+	std::vector<int> queue;
+	std::vector<bool> cell_used(GetSize(cells));
+
+	for (int cell_idx = 0; cell_idx < GetSize(cells); cell_idx++) {
+		Cell *cell = cells[cell_idx];
+		bool known = ct_all.cell_known(cell->type);
+		cell_inputs_start.push_back(GetSize(cell_inputs));
 		for (auto &it2 : cell->connections()) {
-			if (!ct_all.cell_known(cell->type) || ct_all.cell_output(cell->type, it2.first))
-				for (auto bit : sigmap(it2.second))
-					if (bit.wire != nullptr)
-						wire2driver[bit].insert(cell);
+			bool is_output = !known || ct_all.cell_output(cell->type, it2.first);
+			bool is_input = !known || ct_all.cell_input(cell->type, it2.first);
+			if (!is_output && !is_input)
+				continue;
+			for (auto bit : sigmap(it2.second)) {
+				int idx = bitidx(bit);
+				if (idx < 0)
+					continue;
+				if (is_output)
+					driver_edges.push_back(std::make_pair(idx, cell_idx));
+				if (is_input)
+					cell_inputs.push_back(idx);
+			}
 		}
 		if (keep_cache.query(cell))
-			queue.insert(cell);
-		else
-			unused.insert(cell);
+			cell_used[cell_idx] = true, queue.push_back(cell_idx);
 	}
+	cell_inputs_start.push_back(GetSize(cell_inputs));
+
+	std::vector<int> drivers_start(bitidx.total_bits + 1), drivers(GetSize(driver_edges));
+	for (auto &e : driver_edges)
+		drivers_start[e.first + 1]++;
+	for (int i = 0; i < bitidx.total_bits; i++)
+		drivers_start[i + 1] += drivers_start[i];
+	{
+		std::vector<int> fill(drivers_start.begin(), drivers_start.end() - 1);
+		for (auto &e : driver_edges)
+			drivers[fill[e.first]++] = e.second;
+	}
+	driver_edges.clear();
+	driver_edges.shrink_to_fit();
+
+	std::vector<bool> bit_visited(bitidx.total_bits);
+	auto mark_bit = [&](int idx) {
+		if (bit_visited[idx])
+			return;
+		bit_visited[idx] = true;
+		for (int i = drivers_start[idx]; i < drivers_start[idx + 1]; i++)
+			if (!cell_used[drivers[i]])
+				cell_used[drivers[i]] = true, queue.push_back(drivers[i]);
+	};
 
 	for (auto &it : module->wires_) {
 		Wire *wire = it.second;
-		if (wire->port_output || wire->get_bool_attribute("\\keep")) {
+		if (wire->port_output || wire->get_bool_attribute(ID::keep)) {
 			for (auto bit : sigmap(wire))
-			for (auto c : wire2driver[bit])
-				queue.insert(c), unused.erase(c);
+				if (bit.wire != nullptr)
+					mark_bit(bitidx(bit));
 		}
 	}
 
 	while (!queue.empty())
 	{
-		pool<SigBit> bits;
-		for (auto cell : queue)
-		for (auto &it : cell->connections())
-			if (!ct_all.cell_known(cell->type) || ct_all.cell_input(cell->type, it.first))
-				for (auto bit : sigmap(it.second))
-					bits.insert(bit);
-
-		queue.clear();
-		for (auto bit : bits)
-		for (auto c : wire2driver[bit])
-			if (unused.count(c))
-				queue.insert(c), unused.erase(c);
+		int cell_idx = queue.back();
+		queue.pop_back();
+		for (int i = cell_inputs_start[cell_idx]; i < cell_inputs_start[cell_idx + 1]; i++)
+			mark_bit(cell_inputs[i]);
 	}
 
-	unused.sort(RTLIL::sort_by_name_id<RTLIL::Cell>());
+	std::vector<Cell*> unused;
+	for (int cell_idx = 0; cell_idx < GetSize(cells); cell_idx++)
+		if (!cell_used[cell_idx])
+			unused.push_back(cells[cell_idx]);
+
+	std::sort(unused.begin(), unused.end(), RTLIL::sort_by_name_id<RTLIL::Cell>());
 
-	for (auto cell : unused) {
-		if (verbose)
+	if (verbose)
+		for (auto cell : unused)
 			log("  removing unused `%s' cell `%s'.\n", cell->type.c_str(), cell->name.c_str());
+
+	if (!unused.empty()) {
 		module->design->scratchpad_set_bool("opt.did_something", true);
-		module->remove(cell);
-		count_rm_cells++;
+		module->remove_batch(pool<Cell*>(unused.begin(), unused.end()));
+		count_rm_cells += GetSize(unused);
 	}
 }
 
 int count_nontrivial_wire_attrs(RTLIL::Wire *w)
 {
 	int count = w->attributes.size();
-	count -= w->attributes.count("\\src");
-	count -= w->attributes.count("\\unused_bits");
+	count -= w->attributes.count(ID::src);
+	count -= w->attributes.count(ID::unused_bits);
 	return count;
 }
 
-bool compare_signals(RTLIL::SigBit &s1, RTLIL::SigBit &s2, SigPool &regs, SigPool &conns, pool<RTLIL::Wire*> &direct_wires)
+bool compare_signals(RTLIL::SigBit &s1, RTLIL::SigBit &s2, const dense_pool_t &regs, const dense_pool_t &conns, pool<RTLIL::Wire*> &direct_wires)
 {
 	RTLIL::Wire *w1 = s1.wire;
 	RTLIL::Wire *w2 = s2.wire;
@@ -194,8 +291,9 @@ bool check_public_name(RTLIL::IdString id)
 
 void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbose)
 {
-	SigPool register_signals;
-	SigPool connected_signals;
+	dense_bits_t bitidx(module);
+	dense_pool_t register_signals(bitidx);
+	dense_pool_t connected_signals(bitidx);
 
 	if (!purge_mode)
 		for (auto &it : module->cells_) {
@@ -208,7 +306,7 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 				connected_signals.add(it2.second);
 		}
 
-	SigMap assign_map(module);
+	SigMap assign_map(module->sigmap());
 	pool<RTLIL::SigSpec> direct_sigs;
 	pool<RTLIL::Wire*> direct_wires;
 	for (auto &it : module->cells_) {
@@ -232,10 +330,10 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 		}
 	}
 
-	module->connections_.clear();
+	module->new_connections(std::vector<RTLIL::SigSig>());
 
-	SigPool used_signals;
-	SigPool used_signals_nodrivers;
+	dense_pool_t used_signals(bitidx);
+	dense_pool_t used_signals_nodrivers(bitidx);
 	for (auto &it : module->cells_) {
 		RTLIL::Cell *cell = it.second;
 		for (auto &it2 : cell->connections_) {
@@ -254,7 +352,7 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 			if (!wire->port_input)
 				used_signals_nodrivers.add(sig);
 		}
-		if (wire->get_bool_attribute("\\keep")) {
+		if (wire->get_bool_attribute(ID::keep)) {
 			RTLIL::SigSpec sig = RTLIL::SigSpec(wire);
 			assign_map.apply(sig);
 			used_signals.add(sig);
@@ -264,10 +362,10 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 	std::vector<RTLIL::Wire*> maybe_del_wires;
 	for (auto wire : module->wires())
 	{
-		if ((!purge_mode && check_public_name(wire->name)) || wire->port_id != 0 || wire->get_bool_attribute("\\keep") || wire->attributes.count("\\init")) {
+		if ((!purge_mode && check_public_name(wire->name)) || wire->port_id != 0 || wire->get_bool_attribute(ID::keep) || wire->attributes.count(ID::init)) {
 			RTLIL::SigSpec s1 = RTLIL::SigSpec(wire), s2 = s1;
 			assign_map.apply(s2);
-			if (!used_signals.check_any(s2) && wire->port_id == 0 && !wire->get_bool_attribute("\\keep")) {
+			if (!used_signals.check_any(s2) && wire->port_id == 0 && !wire->get_bool_attribute(ID::keep)) {
 				maybe_del_wires.push_back(wire);
 			} else {
 				log_assert(GetSize(s1) == GetSize(s2));
@@ -301,11 +399,11 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 				}
 			}
 			if (unused_bits.empty() || wire->port_id != 0)
-				wire->attributes.erase("\\unused_bits");
+				wire->attributes.erase(ID::unused_bits);
 			else
-				wire->attributes["\\unused_bits"] = RTLIL::Const(unused_bits);
+				wire->attributes[ID::unused_bits] = RTLIL::Const(unused_bits);
 		} else {
-			wire->attributes.erase("\\unused_bits");
+			wire->attributes.erase(ID::unused_bits);
 		}
 	}
 
@@ -322,7 +420,7 @@ void rmunused_module_signals(RTLIL::Module *module, bool purge_mode, bool verbos
 			del_wires.insert(wire);
 		}
 
-	module->remove(del_wires);
+	module->remove_batch(pool<RTLIL::Cell*>(), del_wires);
 	count_rm_wires += del_wires.size();;
 
 	if (del_wires_count > 0)
@@ -337,19 +435,18 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose)
 	std::vector<RTLIL::Cell*> delcells;
 	for (auto cell : module->cells())
 		if (cell->type.in("$pos", "$_BUF_")) {
-			bool is_signed = cell->type == "$pos" && cell->getParam("\\A_SIGNED").as_bool();
-			RTLIL::SigSpec a = cell->getPort("\\A");
-			RTLIL::SigSpec y = cell->getPort("\\Y");
+			bool is_signed = cell->type == "$pos" && cell->getParam(ID::A_SIGNED).as_bool();
+			RTLIL::SigSpec a = cell->getPort(ID::A);
+			RTLIL::SigSpec y = cell->getPort(ID::Y);
 			a.extend_u0(GetSize(y), is_signed);
 			module->connect(y, a);
 			delcells.push_back(cell);
 		}
-	for (auto cell : delcells) {
-		if (verbose)
+	if (verbose)
+		for (auto cell : delcells)
 			log("  removing buffer cell `%s': %s = %s\n", cell->name.c_str(),
-					log_signal(cell->getPort("\\Y")), log_signal(cell->getPort("\\A")));
-		module->remove(cell);
-	}
+					log_signal(cell->getPort(ID::Y)), log_signal(cell->getPort(ID::A)));
+	module->remove_batch(pool<RTLIL::Cell*>(delcells.begin(), delcells.end()));
 	if (!delcells.empty())
 		module->design->scratchpad_set_bool("opt.did_something", true);
 
@@ -359,6 +456,7 @@ void rmunused_module(RTLIL::Module *module, bool purge_mode, bool verbose)
 
 struct OptCleanPass : public Pass {
 	OptCleanPass() : Pass("opt_clean", "remove unused cells and wires") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -419,6 +517,7 @@ struct OptCleanPass : public Pass {
 
 struct CleanPass : public Pass {
 	CleanPass() : Pass("clean", "remove unused cells and wires") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
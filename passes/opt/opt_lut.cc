@@ -0,0 +1,190 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/truthtable.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct OptLutWorker
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+	dict<std::pair<RTLIL::SigSpec, TruthTable>, RTLIL::Cell*> known_luts;
+	int simplified_count = 0;
+	int removed_count = 0;
+	int merged_count = 0;
+
+	OptLutWorker(RTLIL::Module *module) : module(module), sigmap(module)
+	{
+	}
+
+	// reduce the LUT to the inputs it actually depends on, returns false if
+	// the LUT uses features that this pass does not handle (x bits, >16 inputs)
+	static bool reduce(RTLIL::SigSpec &sig_a, TruthTable &tt, const RTLIL::Const &lut)
+	{
+		int width = GetSize(sig_a);
+		if (width > 16 || GetSize(lut) < (1 << width))
+			return false;
+		for (int i = 0; i < (1 << width); i++)
+			if (lut.bits[i] != RTLIL::State::S0 && lut.bits[i] != RTLIL::State::S1)
+				return false;
+
+		tt = TruthTable(lut, width);
+
+		for (int i = GetSize(sig_a)-1; i >= 0; i--)
+		{
+			RTLIL::SigBit bit = sig_a[i];
+
+			if (bit == RTLIL::State::S0 || bit == RTLIL::State::S1) {
+				tt = tt.cofactor(i, bit == RTLIL::State::S1).remove_var(i);
+				sig_a.remove(i);
+				continue;
+			}
+
+			int j = 0;
+			while (j < i && sig_a[j] != bit)
+				j++;
+
+			if (j < i) {
+				TruthTable var_j = TruthTable::variable(tt.width, j);
+				tt = ((~var_j & tt.cofactor(i, false)) | (var_j & tt.cofactor(i, true))).remove_var(i);
+				sig_a.remove(i);
+				continue;
+			}
+
+			if (!tt.depends_on(i)) {
+				tt = tt.remove_var(i);
+				sig_a.remove(i);
+			}
+		}
+
+		return true;
+	}
+
+	void run_cell(RTLIL::Cell *cell)
+	{
+		RTLIL::SigSpec orig_a = sigmap(cell->getPort(ID::A));
+		RTLIL::SigSpec sig_y = cell->getPort(ID::Y);
+		RTLIL::SigSpec sig_a = orig_a;
+		TruthTable tt;
+
+		if (!reduce(sig_a, tt, cell->getParam(ID::LUT)))
+			return;
+
+		if (GetSize(sig_a) == 0 || (GetSize(sig_a) == 1 && tt == TruthTable::variable(1, 0))) {
+			RTLIL::SigSpec value = GetSize(sig_a) == 0 ? RTLIL::SigSpec(tt.get(0) ? RTLIL::State::S1 : RTLIL::State::S0) : sig_a;
+			log("  Replacing %s cell `%s' in module `%s' with %s.\n", log_id(cell->type), log_id(cell),
+					log_id(module), log_signal(value));
+			module->connect(sig_y, value);
+			module->remove(cell);
+			removed_count++;
+			return;
+		}
+
+		// LUT inputs are named signals, so sorting them gives a canonical form
+		// for the purpose of finding identical LUTs
+		std::vector<int> perm(GetSize(sig_a));
+		for (int i = 0; i < GetSize(perm); i++)
+			perm[i] = i;
+		std::sort(perm.begin(), perm.end(), [&](int a, int b) { return sig_a[a] < sig_a[b]; });
+
+		RTLIL::SigSpec sorted_a;
+		for (int i : perm)
+			sorted_a.append(sig_a[i]);
+		tt = tt.permute(perm);
+
+		auto key = std::make_pair(sorted_a, tt);
+		if (known_luts.count(key)) {
+			RTLIL::Cell *other = known_luts.at(key);
+			log("  Merging %s cell `%s' into `%s' in module `%s'.\n", log_id(cell->type), log_id(cell),
+					log_id(other), log_id(module));
+			module->connect(sig_y, other->getPort(ID::Y));
+			module->remove(cell);
+			merged_count++;
+			return;
+		}
+		known_luts[key] = cell;
+
+		if (sorted_a != orig_a) {
+			log("  Reducing %s cell `%s' in module `%s' from %d to %d inputs.\n", log_id(cell->type), log_id(cell),
+					log_id(module), GetSize(orig_a), GetSize(sorted_a));
+			cell->setPort(ID::A, sorted_a);
+			cell->setParam(ID::WIDTH, GetSize(sorted_a));
+			cell->setParam(ID::LUT, tt.as_const());
+			simplified_count++;
+		}
+	}
+
+	void run()
+	{
+		std::vector<RTLIL::Cell*> luts;
+		for (auto cell : module->selected_cells())
+			if (cell->type == "$lut")
+				luts.push_back(cell);
+
+		for (auto cell : luts)
+			run_cell(cell);
+	}
+};
+
+struct OptLutPass : public Pass {
+	OptLutPass() : Pass("opt_lut", "simplify and merge $lut cells") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    opt_lut [selection]\n");
+		log("\n");
+		log("This pass removes constant, duplicate and unused inputs from $lut cells,\n");
+		log("replaces $lut cells that implement constants or buffers with connections and\n");
+		log("merges $lut cells that implement the same function of the same inputs.\n");
+		log("\n");
+		log("The inputs of the remaining $lut cells are sorted, so that identical LUTs are\n");
+		log("found regardless of their input order.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing OPT_LUT pass (simplify and merge LUTs).\n");
+
+		extra_args(args, 1, design);
+
+		int simplified_count = 0, removed_count = 0, merged_count = 0;
+
+		for (auto module : design->selected_modules())
+		{
+			OptLutWorker worker(module);
+			worker.run();
+
+			simplified_count += worker.simplified_count;
+			removed_count += worker.removed_count;
+			merged_count += worker.merged_count;
+		}
+
+		if (simplified_count || removed_count || merged_count)
+			design->scratchpad_set_bool("opt.did_something", true);
+
+		log("Simplified %d, removed %d and merged %d $lut cells.\n", simplified_count, removed_count, merged_count);
+	}
+} OptLutPass;
+
+PRIVATE_NAMESPACE_END
@@ -21,13 +21,10 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/celltypes.h"
-#include "libs/sha1/sha1.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <set>
 
-#define USE_CELL_HASH_CACHE
-
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
@@ -41,14 +38,11 @@ struct OptMergeWorker
 
 	CellTypes ct;
 	int total_count;
-#ifdef USE_CELL_HASH_CACHE
-	dict<const RTLIL::Cell*, std::string> cell_hash_cache;
-#endif
 
 	static void sort_pmux_conn(dict<RTLIL::IdString, RTLIL::SigSpec> &conn)
 	{
-		SigSpec sig_s = conn.at("\\S");
-		SigSpec sig_b = conn.at("\\B");
+		SigSpec sig_s = conn.at(ID::S);
+		SigSpec sig_b = conn.at(ID::B);
 
 		int s_width = GetSize(sig_s);
 		int width = GetSize(sig_b) / s_width;
@@ -59,118 +53,66 @@ struct OptMergeWorker
 
 		std::sort(sb_pairs.begin(), sb_pairs.end());
 
-		conn["\\S"] = SigSpec();
-		conn["\\B"] = SigSpec();
+		conn[ID::S] = SigSpec();
+		conn[ID::B] = SigSpec();
 
 		for (auto &it : sb_pairs) {
-			conn["\\S"].append(it.first);
-			conn["\\B"].append(it.second);
+			conn[ID::S].append(it.first);
+			conn[ID::B].append(it.second);
 		}
 	}
 
-#ifdef USE_CELL_HASH_CACHE
-	std::string int_to_hash_string(unsigned int v)
+	static bool is_commutative(const RTLIL::Cell *cell)
 	{
-		if (v == 0)
-			return "0";
-		std::string str = "";
-		while (v > 0) {
-			str += 'a' + (v & 15);
-			v = v >> 4;
-		}
-		return str;
+		return cell->type == "$and" || cell->type == "$or" || cell->type == "$xor" || cell->type == "$xnor" || cell->type == "$add" || cell->type == "$mul" ||
+				cell->type == "$logic_and" || cell->type == "$logic_or" || cell->type == "$_AND_" || cell->type == "$_OR_" || cell->type == "$_XOR_";
 	}
 
-	std::string hash_cell_parameters_and_connections(const RTLIL::Cell *cell)
+	unsigned int hash_cell_parameters_and_connections(const RTLIL::Cell *cell)
 	{
-		if (cell_hash_cache.count(cell) > 0)
-			return cell_hash_cache[cell];
-
-		std::string hash_string = cell->type.str() + "\n";
+		unsigned int h = mkhash_add(mkhash_init, cell->type.hash());
 
+		// parameters and connections are dicts, combine them in an
+		// order-independent way
+		unsigned int hp = 0;
 		for (auto &it : cell->parameters)
-			hash_string += "P " + it.first.str() + "=" + it.second.as_string() + "\n";
+			hp += mkhash(it.first.hash(), it.second.hash());
+		h = mkhash(h, hp);
+
+		if (is_commutative(cell)) {
+			unsigned int ha = assign_map(cell->getPort(ID::A)).hash();
+			unsigned int hb = assign_map(cell->getPort(ID::B)).hash();
+			h = mkhash(h, mkhash(std::min(ha, hb), std::max(ha, hb)));
+			for (auto &it : cell->connections())
+				if (it.first != ID::A && it.first != ID::B && !cell->output(it.first))
+					h += mkhash(it.first.hash(), assign_map(it.second).hash());
+			return h;
+		}
 
-		const dict<RTLIL::IdString, RTLIL::SigSpec> *conn = &cell->connections();
-		dict<RTLIL::IdString, RTLIL::SigSpec> alt_conn;
+		dict<RTLIL::IdString, RTLIL::SigSpec> conn;
+		for (auto &it : cell->connections())
+			if (!cell->output(it.first))
+				conn[it.first] = assign_map(it.second);
 
-		if (cell->type == "$and" || cell->type == "$or" || cell->type == "$xor" || cell->type == "$xnor" || cell->type == "$add" || cell->type == "$mul" ||
-				cell->type == "$logic_and" || cell->type == "$logic_or" || cell->type == "$_AND_" || cell->type == "$_OR_" || cell->type == "$_XOR_") {
-			alt_conn = *conn;
-			if (assign_map(alt_conn.at("\\A")) < assign_map(alt_conn.at("\\B"))) {
-				alt_conn["\\A"] = conn->at("\\B");
-				alt_conn["\\B"] = conn->at("\\A");
-			}
-			conn = &alt_conn;
-		} else
 		if (cell->type == "$reduce_xor" || cell->type == "$reduce_xnor") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			alt_conn.at("\\A").sort();
-			conn = &alt_conn;
+			conn.at(ID::A).sort();
 		} else
 		if (cell->type == "$reduce_and" || cell->type == "$reduce_or" || cell->type == "$reduce_bool") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			alt_conn.at("\\A").sort_and_unify();
-			conn = &alt_conn;
+			conn.at(ID::A).sort_and_unify();
 		} else
 		if (cell->type == "$pmux") {
-			alt_conn = *conn;
-			assign_map.apply(alt_conn.at("\\A"));
-			assign_map.apply(alt_conn.at("\\B"));
-			assign_map.apply(alt_conn.at("\\S"));
-			sort_pmux_conn(alt_conn);
-			conn = &alt_conn;
-		}
-
-		vector<string> hash_conn_strings;
-
-		for (auto &it : *conn) {
-			if (cell->output(it.first))
-				continue;
-			RTLIL::SigSpec sig = it.second;
-			assign_map.apply(sig);
-			string s = "C " + it.first.str() + "=";
-			for (auto &chunk : sig.chunks()) {
-				if (chunk.wire)
-					s += "{" + chunk.wire->name.str() + " " +
-							int_to_hash_string(chunk.offset) + " " +
-							int_to_hash_string(chunk.width) + "}";
-				else
-					s += RTLIL::Const(chunk.data).as_string();
-			}
-			hash_conn_strings.push_back(s + "\n");
+			sort_pmux_conn(conn);
 		}
 
-		std::sort(hash_conn_strings.begin(), hash_conn_strings.end());
-
-		for (auto it : hash_conn_strings)
-			hash_string += it;
-
-		cell_hash_cache[cell] = sha1(hash_string);
-		return cell_hash_cache[cell];
+		for (auto &it : conn)
+			h += mkhash(it.first.hash(), it.second.hash());
+		return h;
 	}
-#endif
 
-	bool compare_cell_parameters_and_connections(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2, bool &lt)
+	bool compare_cell_parameters_and_connections(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2)
 	{
-#ifdef USE_CELL_HASH_CACHE
-		std::string hash1 = hash_cell_parameters_and_connections(cell1);
-		std::string hash2 = hash_cell_parameters_and_connections(cell2);
-
-		if (hash1 != hash2) {
-			lt = hash1 < hash2;
-			return true;
-		}
-#endif
-
-		if (cell1->parameters != cell2->parameters) {
-			std::map<RTLIL::IdString, RTLIL::Const> p1(cell1->parameters.begin(), cell1->parameters.end());
-			std::map<RTLIL::IdString, RTLIL::Const> p2(cell2->parameters.begin(), cell2->parameters.end());
-			lt = p1 < p2;
-			return true;
-		}
+		if (cell1->parameters != cell2->parameters)
+			return false;
 
 		dict<RTLIL::IdString, RTLIL::SigSpec> conn1 = cell1->connections();
 		dict<RTLIL::IdString, RTLIL::SigSpec> conn2 = cell2->connections();
@@ -189,80 +131,139 @@ struct OptMergeWorker
 				assign_map.apply(it.second);
 		}
 
-		if (cell1->type == "$and" || cell1->type == "$or" || cell1->type == "$xor" || cell1->type == "$xnor" || cell1->type == "$add" || cell1->type == "$mul" ||
-				cell1->type == "$logic_and" || cell1->type == "$logic_or" || cell1->type == "$_AND_" || cell1->type == "$_OR_" || cell1->type == "$_XOR_") {
-			if (conn1.at("\\A") < conn1.at("\\B")) {
-				RTLIL::SigSpec tmp = conn1["\\A"];
-				conn1["\\A"] = conn1["\\B"];
-				conn1["\\B"] = tmp;
+		if (is_commutative(cell1)) {
+			if (conn1.at(ID::A) < conn1.at(ID::B)) {
+				RTLIL::SigSpec tmp = conn1[ID::A];
+				conn1[ID::A] = conn1[ID::B];
+				conn1[ID::B] = tmp;
 			}
-			if (conn2.at("\\A") < conn2.at("\\B")) {
-				RTLIL::SigSpec tmp = conn2["\\A"];
-				conn2["\\A"] = conn2["\\B"];
-				conn2["\\B"] = tmp;
+			if (conn2.at(ID::A) < conn2.at(ID::B)) {
+				RTLIL::SigSpec tmp = conn2[ID::A];
+				conn2[ID::A] = conn2[ID::B];
+				conn2[ID::B] = tmp;
 			}
 		} else
 		if (cell1->type == "$reduce_xor" || cell1->type == "$reduce_xnor") {
-			conn1["\\A"].sort();
-			conn2["\\A"].sort();
+			conn1[ID::A].sort();
+			conn2[ID::A].sort();
 		} else
 		if (cell1->type == "$reduce_and" || cell1->type == "$reduce_or" || cell1->type == "$reduce_bool") {
-			conn1["\\A"].sort_and_unify();
-			conn2["\\A"].sort_and_unify();
+			conn1[ID::A].sort_and_unify();
+			conn2[ID::A].sort_and_unify();
 		} else
 		if (cell1->type == "$pmux") {
 			sort_pmux_conn(conn1);
 			sort_pmux_conn(conn2);
 		}
 
-		if (conn1 != conn2) {
-			std::map<RTLIL::IdString, RTLIL::SigSpec> c1(conn1.begin(), conn1.end());
-			std::map<RTLIL::IdString, RTLIL::SigSpec> c2(conn2.begin(), conn2.end());
-			lt = c1 < c2;
-			return true;
-		}
+		if (conn1 != conn2)
+			return false;
 
-		if (cell1->type.substr(0, 1) == "$" && conn1.count("\\Q") != 0) {
-			std::vector<RTLIL::SigBit> q1 = dff_init_map(cell1->getPort("\\Q")).to_sigbit_vector();
-			std::vector<RTLIL::SigBit> q2 = dff_init_map(cell2->getPort("\\Q")).to_sigbit_vector();
+		if (cell1->type.substr(0, 1) == "$" && conn1.count(ID::Q) != 0) {
+			std::vector<RTLIL::SigBit> q1 = dff_init_map(cell1->getPort(ID::Q)).to_sigbit_vector();
+			std::vector<RTLIL::SigBit> q2 = dff_init_map(cell2->getPort(ID::Q)).to_sigbit_vector();
 			for (size_t i = 0; i < q1.size(); i++)
-				if ((q1.at(i).wire == NULL || q2.at(i).wire == NULL) && q1.at(i) != q2.at(i)) {
-					lt = q1.at(i) < q2.at(i);
-					return true;
-				}
+				if ((q1.at(i).wire == NULL || q2.at(i).wire == NULL) && q1.at(i) != q2.at(i))
+					return false;
 		}
 
-		return false;
+		return true;
 	}
 
 	bool compare_cells(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2)
 	{
 		if (cell1->type != cell2->type)
-			return cell1->type < cell2->type;
+			return false;
 
 		if ((!mode_share_all && !ct.cell_known(cell1->type)) || !cell1->known())
-			return cell1 < cell2;
+			return false;
 
 		if (cell1->has_keep_attr() || cell2->has_keep_attr())
-			return cell1 < cell2;
+			return false;
+
+		return compare_cell_parameters_and_connections(cell1, cell2);
+	}
 
-		bool lt;
-		if (compare_cell_parameters_and_connections(cell1, cell2, lt))
-			return lt;
+	void add_fanout(RTLIL::Cell *cell)
+	{
+		for (auto &it : cell->connections())
+			if (!cell->output(it.first))
+				for (auto bit : assign_map(it.second))
+					if (bit.wire != nullptr)
+						fanout[bit].insert(cell);
+	}
 
-		return false;
+	void del_fanout(RTLIL::Cell *cell)
+	{
+		for (auto &it : cell->connections())
+			if (!cell->output(it.first))
+				for (auto bit : assign_map(it.second))
+					if (bit.wire != nullptr && fanout.count(bit))
+						fanout.at(bit).erase(cell);
 	}
 
-	struct CompareCells {
-		OptMergeWorker *that;
-		CompareCells(OptMergeWorker *that) : that(that) {}
-		bool operator()(const RTLIL::Cell *cell1, const RTLIL::Cell *cell2) const {
-			return that->compare_cells(cell1, cell2);
+	// Connect the outputs of 'cell' to those of 'other_cell', and mark all
+	// cells that read one of the redirected signals as dirty.
+	void redirect_outputs(RTLIL::Cell *cell, RTLIL::Cell *other_cell)
+	{
+		for (auto &it : cell->connections()) {
+			if (!cell->output(it.first))
+				continue;
+
+			RTLIL::SigSpec other_sig = other_cell->getPort(it.first);
+			if (log_active())
+				log("    Redirecting output %s: %s = %s\n", it.first.c_str(),
+						log_signal(it.second), log_signal(other_sig));
+
+			std::vector<RTLIL::SigBit> old_bits = assign_map(it.second).to_sigbit_vector();
+			std::vector<RTLIL::SigBit> other_bits = assign_map(other_sig).to_sigbit_vector();
+
+			module->connect(RTLIL::SigSig(it.second, other_sig));
+			assign_map.add(it.second, other_sig);
+
+			for (int i = 0; i < GetSize(old_bits); i++)
+			for (auto old_bit : {old_bits[i], other_bits[i]})
+			{
+				RTLIL::SigBit new_bit = assign_map(old_bit);
+				if (old_bit.wire == nullptr || old_bit == new_bit || !fanout.count(old_bit))
+					continue;
+
+				pool<RTLIL::Cell*> old_fanout;
+				old_fanout.swap(fanout.at(old_bit));
+				fanout.erase(old_bit);
+
+				for (auto c : old_fanout)
+					dirty.insert(c);
+				if (new_bit.wire != nullptr)
+					fanout[new_bit].insert(old_fanout.begin(), old_fanout.end());
+			}
 		}
-	};
+	}
+
+	dict<RTLIL::SigBit, pool<RTLIL::Cell*>> fanout;
+	dict<int, std::vector<RTLIL::Cell*>> buckets;
+	dict<RTLIL::Cell*, int> cell_hash;
+	pool<RTLIL::Cell*> dirty;
+
+	void bucket_del(RTLIL::Cell *cell)
+	{
+		auto it = cell_hash.find(cell);
+		if (it == cell_hash.end())
+			return;
+
+		std::vector<RTLIL::Cell*> &bucket = buckets.at(it->second);
+		for (int i = 0; i < GetSize(bucket); i++)
+			if (bucket[i] == cell) {
+				bucket.erase(bucket.begin() + i);
+				break;
+			}
+		if (bucket.empty())
+			buckets.erase(it->second);
+		cell_hash.erase(it);
+	}
 
 	OptMergeWorker(RTLIL::Design *design, RTLIL::Module *module, bool mode_nomux, bool mode_share_all) :
-		design(design), module(module), assign_map(module), mode_share_all(mode_share_all)
+		design(design), module(module), assign_map(module->sigmap()), mode_share_all(mode_share_all)
 	{
 		total_count = 0;
 		ct.setup_internals();
@@ -276,60 +277,84 @@ struct OptMergeWorker
 		}
 
 		log("Finding identical cells in module `%s'.\n", module->name.c_str());
-		assign_map.set(module);
 
-		dff_init_map.set(module);
+		dff_init_map = module->sigmap();
 		for (auto &it : module->wires_)
-			if (it.second->attributes.count("\\init") != 0)
-				dff_init_map.add(it.second, it.second->attributes.at("\\init"));
-
-		bool did_something = true;
-		while (did_something)
-		{
-#ifdef USE_CELL_HASH_CACHE
-			cell_hash_cache.clear();
-#endif
-			std::vector<RTLIL::Cell*> cells;
-			cells.reserve(module->cells_.size());
-			for (auto &it : module->cells_) {
-				if (!design->selected(module, it.second))
-					continue;
-				if (ct.cell_known(it.second->type) || (mode_share_all && it.second->known()))
-					cells.push_back(it.second);
+			if (it.second->attributes.count(ID::init) != 0)
+				dff_init_map.add(it.second, it.second->attributes.at(ID::init));
+
+		// Cells are put in buckets by their structural hash. Only cells in
+		// the same bucket are compared. When a cell is merged, all cells
+		// reading its outputs are marked dirty and are re-hashed in the next
+		// round, instead of re-scanning the whole module.
+
+		std::vector<RTLIL::Cell*> cells;
+		dict<RTLIL::Cell*, int> cell_index;
+		cells.reserve(module->cells_.size());
+		for (auto &it : module->cells_) {
+			if (!design->selected(module, it.second))
+				continue;
+			if (ct.cell_known(it.second->type) || (mode_share_all && it.second->known())) {
+				cell_index[it.second] = GetSize(cells);
+				cells.push_back(it.second);
 			}
+		}
 
-			did_something = false;
-			std::map<RTLIL::Cell*, RTLIL::Cell*, CompareCells> sharemap(CompareCells(this));
-			for (auto cell : cells)
+		for (auto cell : cells)
+			add_fanout(cell);
+
+		std::vector<RTLIL::Cell*> worklist = cells;
+		pool<RTLIL::Cell*> removed_cells;
+
+		while (!worklist.empty())
+		{
+			for (auto cell : worklist)
 			{
-				if (sharemap.count(cell) > 0) {
-					did_something = true;
-					log("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), sharemap[cell]->name.c_str());
-					for (auto &it : cell->connections()) {
-						if (cell->output(it.first)) {
-							RTLIL::SigSpec other_sig = sharemap[cell]->getPort(it.first);
-							log("    Redirecting output %s: %s = %s\n", it.first.c_str(),
-									log_signal(it.second), log_signal(other_sig));
-							module->connect(RTLIL::SigSig(it.second, other_sig));
-							assign_map.add(it.second, other_sig);
+				bucket_del(cell);
+				int h = hash_cell_parameters_and_connections(cell);
+
+				RTLIL::Cell *other_cell = nullptr;
+				if (buckets.count(h))
+					for (auto c : buckets.at(h))
+						if (compare_cells(cell, c)) {
+							other_cell = c;
+							break;
 						}
-					}
-					log("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
-#ifdef USE_CELL_HASH_CACHE
-					cell_hash_cache.erase(cell);
-#endif
-					module->remove(cell);
-					total_count++;
-				} else {
-					sharemap[cell] = cell;
+
+				if (other_cell == nullptr) {
+					buckets[h].push_back(cell);
+					cell_hash[cell] = h;
+					continue;
 				}
+
+				log("  Cell `%s' is identical to cell `%s'.\n", cell->name.c_str(), other_cell->name.c_str());
+				del_fanout(cell);
+				redirect_outputs(cell, other_cell);
+				log("    Removing %s cell `%s' from module `%s'.\n", cell->type.c_str(), cell->name.c_str(), module->name.c_str());
+				dirty.erase(cell);
+				cell_index.erase(cell);
+				removed_cells.insert(cell);
+				total_count++;
 			}
+
+			worklist.clear();
+			for (auto cell : dirty)
+				if (cell_index.count(cell))
+					worklist.push_back(cell);
+			dirty.clear();
+
+			std::sort(worklist.begin(), worklist.end(), [&](RTLIL::Cell *a, RTLIL::Cell *b) {
+				return cell_index.at(a) < cell_index.at(b);
+			});
 		}
+
+		module->remove_batch(removed_cells);
 	}
 };
 
 struct OptMergePass : public Pass {
 	OptMergePass() : Pass("opt_merge", "consolidate identical cells") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
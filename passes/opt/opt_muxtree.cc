@@ -65,8 +65,14 @@ struct OptMuxtreeWorker
 	vector<bool> root_enable_muxes;
 	pool<int> root_mux_rerun;
 
+	// ctrl2ports[bit] lists the (mux, port) pairs that use bit as control signal
+	vector<vector<pair<int, int>>> ctrl2ports;
+
+	int eval_mux_count, eval_port_count, max_depth, depth;
+
 	OptMuxtreeWorker(RTLIL::Design *design, RTLIL::Module *module) :
-			design(design), module(module), assign_map(module), removed_count(0)
+			design(design), module(module), assign_map(module->sigmap()), removed_count(0),
+			eval_mux_count(0), eval_port_count(0), max_depth(0), depth(0)
 	{
 		log("Running muxtree optimizer on module %s..\n", module->name.c_str());
 
@@ -85,10 +91,10 @@ struct OptMuxtreeWorker
 		{
 			if (cell->type == "$mux" || cell->type == "$pmux")
 			{
-				RTLIL::SigSpec sig_a = cell->getPort("\\A");
-				RTLIL::SigSpec sig_b = cell->getPort("\\B");
-				RTLIL::SigSpec sig_s = cell->getPort("\\S");
-				RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+				RTLIL::SigSpec sig_a = cell->getPort(ID::A);
+				RTLIL::SigSpec sig_b = cell->getPort(ID::B);
+				RTLIL::SigSpec sig_s = cell->getPort(ID::S);
+				RTLIL::SigSpec sig_y = cell->getPort(ID::Y);
 
 				muxinfo_t muxinfo;
 				muxinfo.cell = cell;
@@ -136,7 +142,7 @@ struct OptMuxtreeWorker
 			}
 		}
 		for (auto wire : module->wires()) {
-			if (wire->port_output || wire->get_bool_attribute("\\keep"))
+			if (wire->port_output || wire->get_bool_attribute(ID::keep))
 				for (int idx : sig2bits(RTLIL::SigSpec(wire)))
 					bit2info[idx].seen_non_mux = true;
 		}
@@ -178,6 +184,18 @@ struct OptMuxtreeWorker
 			if (GetSize(it.second) > 1)
 				root_muxes.at(it.first) = true;
 
+		ctrl2ports.resize(GetSize(bit2info));
+		for (int mux_idx = 0; mux_idx < GetSize(mux2info); mux_idx++)
+		for (int port_idx = 0; port_idx < GetSize(mux2info[mux_idx].ports); port_idx++) {
+			int ctrl_sig = mux2info[mux_idx].ports[port_idx].ctrl_sig;
+			if (ctrl_sig >= 0)
+				ctrl2ports[ctrl_sig].push_back(make_pair(mux_idx, port_idx));
+		}
+
+		knowledge.known_active.resize((GetSize(bit2info) + 63) / 64);
+		knowledge.active_port.resize(GetSize(mux2info), -1);
+		knowledge.visited_muxes.resize(GetSize(mux2info));
+
 		for (int mux_idx = 0; mux_idx < GetSize(root_muxes); mux_idx++)
 			if (root_muxes.at(mux_idx)) {
 				log("    Root of a mux tree: %s%s\n", log_id(mux2info[mux_idx].cell), root_enable_muxes.at(mux_idx) ? " (pure)" : "");
@@ -193,6 +211,9 @@ struct OptMuxtreeWorker
 			eval_root_mux(mux_idx);
 		}
 
+		log("  Evaluated %d mux ports in %d mux evaluations (max. depth %d).\n",
+				eval_port_count, eval_mux_count, max_depth);
+
 		log("  Analyzing evaluation results.\n");
 
 		for (auto &mi : mux2info)
@@ -217,10 +238,10 @@ struct OptMuxtreeWorker
 				continue;
 			}
 
-			RTLIL::SigSpec sig_a = mi.cell->getPort("\\A");
-			RTLIL::SigSpec sig_b = mi.cell->getPort("\\B");
-			RTLIL::SigSpec sig_s = mi.cell->getPort("\\S");
-			RTLIL::SigSpec sig_y = mi.cell->getPort("\\Y");
+			RTLIL::SigSpec sig_a = mi.cell->getPort(ID::A);
+			RTLIL::SigSpec sig_b = mi.cell->getPort(ID::B);
+			RTLIL::SigSpec sig_s = mi.cell->getPort(ID::S);
+			RTLIL::SigSpec sig_y = mi.cell->getPort(ID::Y);
 
 			RTLIL::SigSpec sig_ports = sig_b;
 			sig_ports.append(sig_a);
@@ -245,14 +266,14 @@ struct OptMuxtreeWorker
 					}
 				}
 
-				mi.cell->setPort("\\A", new_sig_a);
-				mi.cell->setPort("\\B", new_sig_b);
-				mi.cell->setPort("\\S", new_sig_s);
+				mi.cell->setPort(ID::A, new_sig_a);
+				mi.cell->setPort(ID::B, new_sig_b);
+				mi.cell->setPort(ID::S, new_sig_s);
 				if (GetSize(new_sig_s) == 1) {
 					mi.cell->type = "$mux";
-					mi.cell->parameters.erase("\\S_WIDTH");
+					mi.cell->parameters.erase(ID::S_WIDTH);
 				} else {
-					mi.cell->parameters["\\S_WIDTH"] = RTLIL::Const(GetSize(new_sig_s));
+					mi.cell->parameters[ID::S_WIDTH] = RTLIL::Const(GetSize(new_sig_s));
 				}
 			}
 		}
@@ -278,35 +299,77 @@ struct OptMuxtreeWorker
 
 	struct knowledge_t
 	{
-		// database of known inactive signals
-		// the payload is a reference counter used to manage the
-		// list. when it is non-zero the signal in known to be inactive
-		vector<int> known_inactive;
+		// dense bitset of known active signals. bits are set when descending
+		// into a mux port and the undo log records the bits that were newly
+		// set, so backtracking clears exactly those bits.
+		vector<uint64_t> known_active;
+		vector<int> undo_log;
 
-		// database of known active signals
-		vector<int> known_active;
+		// the port of each mux that is currently being evaluated, or -1. the
+		// control signals of all other ports of such a mux are known inactive.
+		vector<int> active_port;
 
 		// this is just used to keep track of visited muxes in order to prohibit
 		// endless recursion in mux loops
 		vector<bool> visited_muxes;
 	};
 
-	void eval_mux_port(knowledge_t &knowledge, int mux_idx, int port_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
+	// allocated once per module and reused for all mux trees
+	knowledge_t knowledge;
+
+	bool is_known_active(int bit) const
+	{
+		if (bit < 0 || bit/64 >= GetSize(knowledge.known_active))
+			return false;
+		return (knowledge.known_active[bit/64] >> (bit%64)) & 1;
+	}
+
+	bool is_known_inactive(int bit) const
+	{
+		if (bit < 0 || bit >= GetSize(ctrl2ports))
+			return false;
+		for (auto &it : ctrl2ports[bit]) {
+			int p = knowledge.active_port[it.first];
+			if (p >= 0 && p != it.second)
+				return true;
+		}
+		return false;
+	}
+
+	void set_known_active(int bit)
+	{
+		if (is_known_active(bit))
+			return;
+		knowledge.known_active[bit/64] |= uint64_t(1) << (bit%64);
+		knowledge.undo_log.push_back(bit);
+	}
+
+	void undo_known_active(int mark)
+	{
+		while (GetSize(knowledge.undo_log) > mark) {
+			int bit = knowledge.undo_log.back();
+			knowledge.known_active[bit/64] &= ~(uint64_t(1) << (bit%64));
+			knowledge.undo_log.pop_back();
+		}
+	}
+
+	void eval_mux_port(int mux_idx, int port_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
 	{
 		muxinfo_t &muxinfo = mux2info[mux_idx];
 
 		if (do_enable_ports)
 			muxinfo.ports[port_idx].enabled = true;
 
-		for (int i = 0; i < GetSize(muxinfo.ports); i++) {
-			if (i == port_idx)
-				continue;
-			if (muxinfo.ports[i].ctrl_sig >= 0)
-				knowledge.known_inactive.at(muxinfo.ports[i].ctrl_sig)++;
-		}
+		eval_port_count++;
+		max_depth = std::max(max_depth, ++depth);
+
+		int old_active_port = knowledge.active_port[mux_idx];
+		int undo_mark = GetSize(knowledge.undo_log);
+
+		knowledge.active_port[mux_idx] = port_idx;
 
 		if (port_idx < GetSize(muxinfo.ports)-1 && !muxinfo.ports[port_idx].const_activated)
-			knowledge.known_active.at(muxinfo.ports[port_idx].ctrl_sig)++;
+			set_known_active(muxinfo.ports[port_idx].ctrl_sig);
 
 		vector<int> parent_muxes;
 		for (int m : muxinfo.ports[port_idx].input_muxes) {
@@ -321,36 +384,31 @@ struct OptMuxtreeWorker
 			else if (root_muxes.at(m)) {
 				if (abort_count == 0) {
 					root_mux_rerun.insert(m);
+					log_count("opt_muxtree.rerun_push", 1);
 					root_enable_muxes.at(m) = true;
 					log("      Removing pure flag from root mux %s.\n", log_id(mux2info[m].cell));
 				} else
-					eval_mux(knowledge, m, false, do_enable_ports, abort_count - 1);
+					eval_mux(m, false, do_enable_ports, abort_count - 1);
 			} else
-				eval_mux(knowledge, m, do_replace_known, do_enable_ports, abort_count);
+				eval_mux(m, do_replace_known, do_enable_ports, abort_count);
 		for (int m : parent_muxes)
 			knowledge.visited_muxes[m] = false;
 
-		if (port_idx < GetSize(muxinfo.ports)-1 && !muxinfo.ports[port_idx].const_activated)
-			knowledge.known_active.at(muxinfo.ports[port_idx].ctrl_sig)--;
-
-		for (int i = 0; i < GetSize(muxinfo.ports); i++) {
-			if (i == port_idx)
-				continue;
-			if (muxinfo.ports[i].ctrl_sig >= 0)
-				knowledge.known_inactive.at(muxinfo.ports[i].ctrl_sig)--;
-		}
+		undo_known_active(undo_mark);
+		knowledge.active_port[mux_idx] = old_active_port;
+		depth--;
 	}
 
-	void replace_known(knowledge_t &knowledge, muxinfo_t &muxinfo, IdString portname)
+	void replace_known(muxinfo_t &muxinfo, IdString portname)
 	{
 		SigSpec sig = muxinfo.cell->getPort(portname);
 		bool did_something = false;
 
 		int width = 0;
 		idict<int> ctrl_bits;
-		if (portname == "\\B")
-			width = GetSize(muxinfo.cell->getPort("\\A"));
-		for (int bit : sig2bits(muxinfo.cell->getPort("\\S"), false))
+		if (portname == ID::B)
+			width = GetSize(muxinfo.cell->getPort(ID::A));
+		for (int bit : sig2bits(muxinfo.cell->getPort(ID::S), false))
 			ctrl_bits(bit);
 
 		int port_idx = 0, port_off = 0;
@@ -358,11 +416,11 @@ struct OptMuxtreeWorker
 		for (int i = 0; i < GetSize(bits); i++) {
 			if (bits[i] < 0)
 				continue;
-			if (knowledge.known_inactive.at(bits[i])) {
+			if (is_known_inactive(bits[i])) {
 				sig[i] = State::S0;
 				did_something = true;
 			} else
-			if (knowledge.known_active.at(bits[i])) {
+			if (is_known_active(bits[i])) {
 				sig[i] = State::S1;
 				did_something = true;
 			}
@@ -388,14 +446,16 @@ struct OptMuxtreeWorker
 		}
 	}
 
-	void eval_mux(knowledge_t &knowledge, int mux_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
+	void eval_mux(int mux_idx, bool do_replace_known, bool do_enable_ports, int abort_count)
 	{
 		muxinfo_t &muxinfo = mux2info[mux_idx];
+		eval_mux_count++;
+		log_count("opt_muxtree.eval_mux", 1);
 
 		// set input ports to constants if we find known active or inactive signals
 		if (do_replace_known) {
-			replace_known(knowledge, muxinfo, "\\A");
-			replace_known(knowledge, muxinfo, "\\B");
+			replace_known(muxinfo, ID::A);
+			replace_known(muxinfo, ID::B);
 		}
 
 		// if there is a constant activated port we just use it
@@ -403,7 +463,7 @@ struct OptMuxtreeWorker
 		{
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			if (portinfo.const_activated) {
-				eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
+				eval_mux_port(mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
 				return;
 			}
 		}
@@ -416,8 +476,8 @@ struct OptMuxtreeWorker
 			portinfo_t &portinfo = muxinfo.ports[port_idx];
 			if (portinfo.const_deactivated)
 				continue;
-			if (knowledge.known_active.at(portinfo.ctrl_sig)) {
-				eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
+			if (is_known_active(portinfo.ctrl_sig)) {
+				eval_mux_port(mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
 				return;
 			}
 		}
@@ -430,25 +490,23 @@ struct OptMuxtreeWorker
 			if (portinfo.const_deactivated)
 				continue;
 			if (port_idx < GetSize(muxinfo.ports)-1)
-				if (knowledge.known_inactive.at(portinfo.ctrl_sig))
+				if (is_known_inactive(portinfo.ctrl_sig))
 					continue;
-			eval_mux_port(knowledge, mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
+			eval_mux_port(mux_idx, port_idx, do_replace_known, do_enable_ports, abort_count);
 		}
 	}
 
 	void eval_root_mux(int mux_idx)
 	{
-		knowledge_t knowledge;
-		knowledge.known_inactive.resize(GetSize(bit2info));
-		knowledge.known_active.resize(GetSize(bit2info));
-		knowledge.visited_muxes.resize(GetSize(mux2info));
 		knowledge.visited_muxes[mux_idx] = true;
-		eval_mux(knowledge, mux_idx, true, root_enable_muxes.at(mux_idx), 3);
+		eval_mux(mux_idx, true, root_enable_muxes.at(mux_idx), 3);
+		knowledge.visited_muxes[mux_idx] = false;
 	}
 };
 
 struct OptMuxtreePass : public Pass {
 	OptMuxtreePass() : Pass("opt_muxtree", "eliminate dead trees in multiplexer trees") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -37,13 +37,13 @@ struct OptReduceWorker
 	int total_count;
 	bool did_something;
 
-	void opt_reduce(pool<RTLIL::Cell*> &cells, SigSet<RTLIL::Cell*> &drivers, RTLIL::Cell *cell)
+	void opt_reduce(pool<RTLIL::Cell*> &cells, const dict<RTLIL::SigBit, RTLIL::Cell*> &drivers, RTLIL::Cell *cell)
 	{
 		if (cells.count(cell) == 0)
 			return;
 		cells.erase(cell);
 
-		RTLIL::SigSpec sig_a = assign_map(cell->getPort("\\A"));
+		RTLIL::SigSpec sig_a = assign_map(cell->getPort(ID::A));
 		pool<RTLIL::SigBit> new_sig_a_bits;
 
 		for (auto &bit : sig_a.to_sigbit_set())
@@ -69,74 +69,82 @@ struct OptReduceWorker
 				continue;
 			}
 
-			bool imported_children = false;
-			for (auto child_cell : drivers.find(bit)) {
-				if (child_cell->type == cell->type) {
-					opt_reduce(cells, drivers, child_cell);
-					if (child_cell->getPort("\\Y")[0] == bit) {
-						pool<RTLIL::SigBit> child_sig_a_bits = assign_map(child_cell->getPort("\\A")).to_sigbit_pool();
-						new_sig_a_bits.insert(child_sig_a_bits.begin(), child_sig_a_bits.end());
-					} else
-						new_sig_a_bits.insert(RTLIL::State::S0);
-					imported_children = true;
-				}
-			}
-			if (!imported_children)
+			auto it = drivers.find(bit);
+			if (it == drivers.end()) {
 				new_sig_a_bits.insert(bit);
+				continue;
+			}
+
+			RTLIL::Cell *child_cell = it->second;
+			opt_reduce(cells, drivers, child_cell);
+			if (assign_map(child_cell->getPort(ID::Y)[0]) == bit) {
+				for (auto child_bit : assign_map(child_cell->getPort(ID::A)))
+					new_sig_a_bits.insert(child_bit);
+			} else
+				new_sig_a_bits.insert(RTLIL::State::S0);
 		}
 
 		RTLIL::SigSpec new_sig_a(new_sig_a_bits);
 
-		if (new_sig_a != sig_a || sig_a.size() != cell->getPort("\\A").size()) {
+		if (new_sig_a != sig_a || sig_a.size() != cell->getPort(ID::A).size()) {
 			log("    New input vector for %s cell %s: %s\n", cell->type.c_str(), cell->name.c_str(), log_signal(new_sig_a));
 			did_something = true;
 			total_count++;
 		}
 
-		cell->setPort("\\A", new_sig_a);
-		cell->parameters["\\A_WIDTH"] = RTLIL::Const(new_sig_a.size());
+		cell->setPort(ID::A, new_sig_a);
+		cell->parameters[ID::A_WIDTH] = RTLIL::Const(new_sig_a.size());
 		return;
 	}
 
 	void opt_mux(RTLIL::Cell *cell)
 	{
-		RTLIL::SigSpec sig_a = assign_map(cell->getPort("\\A"));
-		RTLIL::SigSpec sig_b = assign_map(cell->getPort("\\B"));
-		RTLIL::SigSpec sig_s = assign_map(cell->getPort("\\S"));
+		RTLIL::SigSpec sig_a = assign_map(cell->getPort(ID::A));
+		RTLIL::SigSpec sig_b = assign_map(cell->getPort(ID::B));
+		RTLIL::SigSpec sig_s = assign_map(cell->getPort(ID::S));
 
-		RTLIL::SigSpec new_sig_b, new_sig_s;
-		pool<RTLIL::SigSpec> handled_sig;
+		// group the B inputs by value, in the order of their first occurrence
+		dict<RTLIL::SigSpec, int> b_index;
+		std::vector<RTLIL::SigSpec> b_groups, s_groups;
 
-		handled_sig.insert(sig_a);
 		for (int i = 0; i < sig_s.size(); i++)
 		{
 			RTLIL::SigSpec this_b = sig_b.extract(i*sig_a.size(), sig_a.size());
-			if (handled_sig.count(this_b) > 0)
+			if (this_b == sig_a)
 				continue;
 
-			RTLIL::SigSpec this_s = sig_s.extract(i, 1);
-			for (int j = i+1; j < sig_s.size(); j++) {
-				RTLIL::SigSpec that_b = sig_b.extract(j*sig_a.size(), sig_a.size());
-				if (this_b == that_b)
-					this_s.append(sig_s.extract(j, 1));
+			auto it = b_index.find(this_b);
+			if (it != b_index.end()) {
+				s_groups[it->second].append(sig_s[i]);
+				continue;
 			}
 
+			b_index[this_b] = GetSize(b_groups);
+			b_groups.push_back(this_b);
+			s_groups.push_back(sig_s[i]);
+		}
+
+		RTLIL::SigSpec new_sig_b, new_sig_s;
+
+		for (int i = 0; i < GetSize(b_groups); i++)
+		{
+			RTLIL::SigSpec this_s = s_groups[i];
+
 			if (this_s.size() > 1)
 			{
 				RTLIL::Cell *reduce_or_cell = module->addCell(NEW_ID, "$reduce_or");
-				reduce_or_cell->setPort("\\A", this_s);
-				reduce_or_cell->parameters["\\A_SIGNED"] = RTLIL::Const(0);
-				reduce_or_cell->parameters["\\A_WIDTH"] = RTLIL::Const(this_s.size());
-				reduce_or_cell->parameters["\\Y_WIDTH"] = RTLIL::Const(1);
+				reduce_or_cell->setPort(ID::A, this_s);
+				reduce_or_cell->parameters[ID::A_SIGNED] = RTLIL::Const(0);
+				reduce_or_cell->parameters[ID::A_WIDTH] = RTLIL::Const(this_s.size());
+				reduce_or_cell->parameters[ID::Y_WIDTH] = RTLIL::Const(1);
 
 				RTLIL::Wire *reduce_or_wire = module->addWire(NEW_ID);
 				this_s = RTLIL::SigSpec(reduce_or_wire);
-				reduce_or_cell->setPort("\\Y", this_s);
+				reduce_or_cell->setPort(ID::Y, this_s);
 			}
 
-			new_sig_b.append(this_b);
+			new_sig_b.append(b_groups[i]);
 			new_sig_s.append(this_s);
-			handled_sig.insert(this_b);
 		}
 
 		if (new_sig_s.size() != sig_s.size()) {
@@ -147,34 +155,34 @@ struct OptReduceWorker
 
 		if (new_sig_s.size() == 0)
 		{
-			module->connect(RTLIL::SigSig(cell->getPort("\\Y"), cell->getPort("\\A")));
-			assign_map.add(cell->getPort("\\Y"), cell->getPort("\\A"));
+			module->connect(RTLIL::SigSig(cell->getPort(ID::Y), cell->getPort(ID::A)));
+			assign_map.add(cell->getPort(ID::Y), cell->getPort(ID::A));
 			module->remove(cell);
 		}
 		else
 		{
-			cell->setPort("\\B", new_sig_b);
-			cell->setPort("\\S", new_sig_s);
+			cell->setPort(ID::B, new_sig_b);
+			cell->setPort(ID::S, new_sig_s);
 			if (new_sig_s.size() > 1) {
-				cell->parameters["\\S_WIDTH"] = RTLIL::Const(new_sig_s.size());
+				cell->parameters[ID::S_WIDTH] = RTLIL::Const(new_sig_s.size());
 			} else {
 				cell->type = "$mux";
-				cell->parameters.erase("\\S_WIDTH");
+				cell->parameters.erase(ID::S_WIDTH);
 			}
 		}
 	}
 
 	void opt_mux_bits(RTLIL::Cell *cell)
 	{
-		std::vector<RTLIL::SigBit> sig_a = assign_map(cell->getPort("\\A")).to_sigbit_vector();
-		std::vector<RTLIL::SigBit> sig_b = assign_map(cell->getPort("\\B")).to_sigbit_vector();
-		std::vector<RTLIL::SigBit> sig_y = assign_map(cell->getPort("\\Y")).to_sigbit_vector();
+		std::vector<RTLIL::SigBit> sig_a = assign_map(cell->getPort(ID::A)).to_sigbit_vector();
+		std::vector<RTLIL::SigBit> sig_b = assign_map(cell->getPort(ID::B)).to_sigbit_vector();
+		std::vector<RTLIL::SigBit> sig_y = assign_map(cell->getPort(ID::Y)).to_sigbit_vector();
 
 		std::vector<RTLIL::SigBit> new_sig_y;
 		RTLIL::SigSig old_sig_conn;
 
 		std::vector<std::vector<RTLIL::SigBit>> consolidated_in_tuples;
-		std::map<std::vector<RTLIL::SigBit>, RTLIL::SigBit> consolidated_in_tuples_map;
+		dict<std::vector<RTLIL::SigBit>, RTLIL::SigBit> consolidated_in_tuples_map;
 
 		for (int i = 0; i < int(sig_y.size()); i++)
 		{
@@ -193,45 +201,41 @@ struct OptReduceWorker
 				old_sig_conn.first.append_bit(sig_y.at(i));
 				old_sig_conn.second.append_bit(sig_a.at(i));
 			}
-			else if (consolidated_in_tuples_map.count(in_tuple))
-			{
-				old_sig_conn.first.append_bit(sig_y.at(i));
-				old_sig_conn.second.append_bit(consolidated_in_tuples_map.at(in_tuple));
-			}
 			else
 			{
-				consolidated_in_tuples_map[in_tuple] = sig_y.at(i);
-				consolidated_in_tuples.push_back(in_tuple);
-				new_sig_y.push_back(sig_y.at(i));
+				auto it = consolidated_in_tuples_map.find(in_tuple);
+				if (it != consolidated_in_tuples_map.end()) {
+					old_sig_conn.first.append_bit(sig_y.at(i));
+					old_sig_conn.second.append_bit(it->second);
+				} else {
+					consolidated_in_tuples_map[in_tuple] = sig_y.at(i);
+					consolidated_in_tuples.push_back(in_tuple);
+					new_sig_y.push_back(sig_y.at(i));
+				}
 			}
 		}
 
 		if (new_sig_y.size() != sig_y.size())
 		{
 			log("    Consolidated identical input bits for %s cell %s:\n", cell->type.c_str(), cell->name.c_str());
-			log("      Old ports: A=%s, B=%s, Y=%s\n", log_signal(cell->getPort("\\A")),
-					log_signal(cell->getPort("\\B")), log_signal(cell->getPort("\\Y")));
+			log("      Old ports: A=%s, B=%s, Y=%s\n", log_signal(cell->getPort(ID::A)),
+					log_signal(cell->getPort(ID::B)), log_signal(cell->getPort(ID::Y)));
 
-			cell->setPort("\\A", RTLIL::SigSpec());
-			for (auto &in_tuple : consolidated_in_tuples) {
-				RTLIL::SigSpec new_a = cell->getPort("\\A");
+			RTLIL::SigSpec new_a, new_b;
+			for (auto &in_tuple : consolidated_in_tuples)
 				new_a.append(in_tuple.at(0));
-				cell->setPort("\\A", new_a);
-			}
-
-			cell->setPort("\\B", RTLIL::SigSpec());
-			for (int i = 1; i <= cell->getPort("\\S").size(); i++)
-				for (auto &in_tuple : consolidated_in_tuples) {
-					RTLIL::SigSpec new_b = cell->getPort("\\B");
+			for (int i = 1; i <= cell->getPort(ID::S).size(); i++)
+				for (auto &in_tuple : consolidated_in_tuples)
 					new_b.append(in_tuple.at(i));
-					cell->setPort("\\B", new_b);
-				}
 
-			cell->parameters["\\WIDTH"] = RTLIL::Const(new_sig_y.size());
-			cell->setPort("\\Y", new_sig_y);
+			cell->setPort(ID::A, new_a);
+			cell->setPort(ID::B, new_b);
+
+			cell->parameters[ID::WIDTH] = RTLIL::Const(new_sig_y.size());
+			cell->setPort(ID::Y, new_sig_y);
 
-			log("      New ports: A=%s, B=%s, Y=%s\n", log_signal(cell->getPort("\\A")),
-					log_signal(cell->getPort("\\B")), log_signal(cell->getPort("\\Y")));
+			log("      New ports: A=%s, B=%s, Y=%s\n", log_signal(cell->getPort(ID::A)),
+					log_signal(cell->getPort(ID::B)), log_signal(cell->getPort(ID::Y)));
 			log("      New connections: %s = %s\n", log_signal(old_sig_conn.first), log_signal(old_sig_conn.second));
 
 			module->connect(old_sig_conn);
@@ -243,7 +247,7 @@ struct OptReduceWorker
 	}
 
 	OptReduceWorker(RTLIL::Design *design, RTLIL::Module *module, bool do_fine) :
-			design(design), module(module), assign_map(module)
+			design(design), module(module), assign_map(module->sigmap())
 	{
 		log("  Optimizing cells in module %s.\n", module->name.c_str());
 
@@ -254,14 +258,14 @@ struct OptReduceWorker
 		for (auto &cell_it : module->cells_) {
 			RTLIL::Cell *cell = cell_it.second;
 			if (cell->type == "$mem")
-				mem_wren_sigs.add(assign_map(cell->getPort("\\WR_EN")));
+				mem_wren_sigs.add(assign_map(cell->getPort(ID::WR_EN)));
 			if (cell->type == "$memwr")
-				mem_wren_sigs.add(assign_map(cell->getPort("\\EN")));
+				mem_wren_sigs.add(assign_map(cell->getPort(ID::EN)));
 		}
 		for (auto &cell_it : module->cells_) {
 			RTLIL::Cell *cell = cell_it.second;
-			if (cell->type == "$dff" && mem_wren_sigs.check_any(assign_map(cell->getPort("\\Q"))))
-				mem_wren_sigs.add(assign_map(cell->getPort("\\D")));
+			if (cell->type == "$dff" && mem_wren_sigs.check_any(assign_map(cell->getPort(ID::Q))))
+				mem_wren_sigs.add(assign_map(cell->getPort(ID::D)));
 		}
 
 		bool keep_expanding_mem_wren_sigs = true;
@@ -269,12 +273,12 @@ struct OptReduceWorker
 			keep_expanding_mem_wren_sigs = false;
 			for (auto &cell_it : module->cells_) {
 				RTLIL::Cell *cell = cell_it.second;
-				if (cell->type == "$mux" && mem_wren_sigs.check_any(assign_map(cell->getPort("\\Y")))) {
-					if (!mem_wren_sigs.check_all(assign_map(cell->getPort("\\A"))) ||
-							!mem_wren_sigs.check_all(assign_map(cell->getPort("\\B"))))
+				if (cell->type == "$mux" && mem_wren_sigs.check_any(assign_map(cell->getPort(ID::Y)))) {
+					if (!mem_wren_sigs.check_all(assign_map(cell->getPort(ID::A))) ||
+							!mem_wren_sigs.check_all(assign_map(cell->getPort(ID::B))))
 						keep_expanding_mem_wren_sigs = true;
-					mem_wren_sigs.add(assign_map(cell->getPort("\\A")));
-					mem_wren_sigs.add(assign_map(cell->getPort("\\B")));
+					mem_wren_sigs.add(assign_map(cell->getPort(ID::A)));
+					mem_wren_sigs.add(assign_map(cell->getPort(ID::B)));
 				}
 			}
 		}
@@ -289,14 +293,16 @@ struct OptReduceWorker
 			const char *type_list[] = { "$reduce_or", "$reduce_and" };
 			for (auto type : type_list)
 			{
-				SigSet<RTLIL::Cell*> drivers;
+				dict<RTLIL::SigBit, RTLIL::Cell*> drivers;
 				pool<RTLIL::Cell*> cells;
 
 				for (auto &cell_it : module->cells_) {
 					RTLIL::Cell *cell = cell_it.second;
 					if (cell->type != type || !design->selected(module, cell))
 						continue;
-					drivers.insert(assign_map(cell->getPort("\\Y")), cell);
+					for (auto bit : assign_map(cell->getPort(ID::Y)))
+						if (bit.wire != nullptr)
+							drivers[bit] = cell;
 					cells.insert(cell);
 				}
 
@@ -318,7 +324,7 @@ struct OptReduceWorker
 			{
 				// this optimization is to aggressive for most coarse-grain applications.
 				// but we always want it for multiplexers driving write enable ports.
-				if (do_fine || mem_wren_sigs.check_any(assign_map(cell->getPort("\\Y"))))
+				if (do_fine || mem_wren_sigs.check_any(assign_map(cell->getPort(ID::Y))))
 					opt_mux_bits(cell);
 
 				opt_mux(cell);
@@ -329,6 +335,7 @@ struct OptReduceWorker
 
 struct OptReducePass : public Pass {
 	OptReducePass() : Pass("opt_reduce", "simplify large MUXes and AND/OR gates") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -19,6 +19,7 @@
 
 #include "kernel/register.h"
 #include "kernel/sigtools.h"
+#include "kernel/modtools.h"
 #include "kernel/log.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -27,33 +28,156 @@ USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 SigMap assign_map, dff_init_map;
-SigSet<RTLIL::Cell*> mux_drivers;
+ModIndex *mod_index;
 dict<SigBit, pool<SigBit>> init_attributes;
 
+bool is_dff_type(RTLIL::IdString type)
+{
+	static pool<RTLIL::IdString> dff_types = {
+		"$_DFF_N_", "$_DFF_P_",
+		"$_DFF_NN0_", "$_DFF_NN1_", "$_DFF_NP0_", "$_DFF_NP1_",
+		"$_DFF_PN0_", "$_DFF_PN1_", "$_DFF_PP0_", "$_DFF_PP1_",
+		"$dff", "$adff"
+	};
+	return dff_types.count(type) != 0;
+}
+
+bool is_mux_type(RTLIL::IdString type)
+{
+	return type == "$mux" || type == "$pmux";
+}
+
+// "opt" calls this pass over and over again. For each module a monitor
+// collects the cells that must be looked at by the next run: DFFs and latches
+// whose ports changed, muxes whose ports changed (the DFFs they drive are
+// affected) and the wire bits of new module connections (everything on those
+// nets is affected). Changes that are not reported to monitors (new init
+// attributes, invalidate_caches()) make the next run scan the whole module.
+struct RmdffWatch : public RTLIL::Monitor
+{
+	RTLIL::Module *module;
+	bool full_scan;
+	unsigned int init_hash;
+	pool<RTLIL::IdString> pending_cells, dirty_muxes;
+	pool<std::pair<RTLIL::IdString, int>> dirty_bits;
+
+	RmdffWatch(RTLIL::Module *module) : module(module), full_scan(true), init_hash(0)
+	{
+		module->monitors.insert(this);
+	}
+
+	virtual void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString&, const RTLIL::SigSpec&, RTLIL::SigSpec&) YS_OVERRIDE
+	{
+		if (is_dff_type(cell->type) || cell->type == "$dlatch")
+			pending_cells.insert(cell->name);
+		else if (is_mux_type(cell->type))
+			dirty_muxes.insert(cell->name);
+	}
+
+	virtual void notify_connect(RTLIL::Module*, const RTLIL::SigSig &sigsig) YS_OVERRIDE
+	{
+		for (auto &sig : {sigsig.first, sigsig.second})
+			for (auto &chunk : sig.chunks())
+				if (chunk.wire != nullptr)
+					for (int i = 0; i < chunk.width; i++)
+						dirty_bits.insert(std::make_pair(chunk.wire->name, chunk.offset + i));
+	}
+
+	virtual void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) YS_OVERRIDE
+	{
+		full_scan = true;
+	}
+
+	virtual void notify_blackout(RTLIL::Module*) YS_OVERRIDE
+	{
+		full_scan = true;
+	}
+
+	virtual void notify_remove(RTLIL::Module*, const pool<RTLIL::Cell*>&) YS_OVERRIDE
+	{
+		// removing cells never makes a DFF removable
+	}
+};
+
+// Owns the RmdffWatch objects. It is registered as design monitor so that the
+// watch of a module is released when the module is removed from the design.
+struct RmdffCache : public RTLIL::Monitor
+{
+	dict<RTLIL::Module*, RmdffWatch*> watches;
+
+	RmdffWatch *watch(RTLIL::Module *module)
+	{
+		if (module->design)
+			module->design->monitors.insert(this);
+
+		auto it = watches.find(module);
+		if (it != watches.end()) {
+			if (module->monitors.count(it->second))
+				return it->second;
+			// the old module was deleted without notification and the new
+			// module happens to use the same address
+			delete it->second;
+			watches.erase(it);
+		}
+
+		RmdffWatch *w = new RmdffWatch(module);
+		watches[module] = w;
+		return w;
+	}
+
+	virtual void notify_module_del(RTLIL::Module *module) YS_OVERRIDE
+	{
+		auto it = watches.find(module);
+		if (it != watches.end()) {
+			module->monitors.erase(it->second);
+			delete it->second;
+			watches.erase(it);
+		}
+	}
+};
+
+RmdffCache rmdff_cache;
+
+unsigned int hash_init_attributes(RTLIL::Module *mod, std::vector<RTLIL::Wire*> *init_wires = nullptr)
+{
+	unsigned int h = mkhash_init;
+	for (auto &it : mod->wires_) {
+		auto attr = it.second->attributes.find(ID::init);
+		if (attr == it.second->attributes.end())
+			continue;
+		h = mkhash(h, it.second->name.index_);
+		for (auto bit : attr->second.bits)
+			h = mkhash(h, bit);
+		if (init_wires)
+			init_wires->push_back(it.second);
+	}
+	return h;
+}
+
 void remove_init_attr(SigSpec sig)
 {
 	for (auto bit : assign_map(sig))
 		if (init_attributes.count(bit))
 			for (auto wbit : init_attributes.at(bit))
-				wbit.wire->attributes.at("\\init")[wbit.offset] = State::Sx;
+				wbit.wire->attributes.at(ID::init)[wbit.offset] = State::Sx;
 }
 
 bool handle_dlatch(RTLIL::Module *mod, RTLIL::Cell *dlatch)
 {
-	SigSpec sig_e = dlatch->getPort("\\EN");
+	SigSpec sig_e = dlatch->getPort(ID::EN);
 
 	if (sig_e == State::S0)
 	{
 		RTLIL::Const val_init;
-		for (auto bit : dff_init_map(dlatch->getPort("\\Q")))
+		for (auto bit : dff_init_map(dlatch->getPort(ID::Q)))
 			val_init.bits.push_back(bit.wire == NULL ? bit.data : State::Sx);
-		mod->connect(dlatch->getPort("\\Q"), val_init);
+		mod->connect(dlatch->getPort(ID::Q), val_init);
 		goto delete_dlatch;
 	}
 
 	if (sig_e == State::S1)
 	{
-		mod->connect(dlatch->getPort("\\Q"), dlatch->getPort("\\D"));
+		mod->connect(dlatch->getPort(ID::Q), dlatch->getPort(ID::D));
 		goto delete_dlatch;
 	}
 
@@ -61,7 +185,7 @@ bool handle_dlatch(RTLIL::Module *mod, RTLIL::Cell *dlatch)
 
 delete_dlatch:
 	log("Removing %s (%s) from module %s.\n", dlatch->name.c_str(), dlatch->type.c_str(), mod->name.c_str());
-	remove_init_attr(dlatch->getPort("\\Q"));
+	remove_init_attr(dlatch->getPort(ID::Q));
 	mod->remove(dlatch);
 	return true;
 }
@@ -72,37 +196,37 @@ bool handle_dff(RTLIL::Module *mod, RTLIL::Cell *dff)
 	RTLIL::Const val_cp, val_rp, val_rv;
 
 	if (dff->type == "$_DFF_N_" || dff->type == "$_DFF_P_") {
-		sig_d = dff->getPort("\\D");
-		sig_q = dff->getPort("\\Q");
-		sig_c = dff->getPort("\\C");
+		sig_d = dff->getPort(ID::D);
+		sig_q = dff->getPort(ID::Q);
+		sig_c = dff->getPort(ID::C);
 		val_cp = RTLIL::Const(dff->type == "$_DFF_P_", 1);
 	}
 	else if (dff->type.substr(0,6) == "$_DFF_" && dff->type.substr(9) == "_" &&
 			(dff->type[6] == 'N' || dff->type[6] == 'P') &&
 			(dff->type[7] == 'N' || dff->type[7] == 'P') &&
 			(dff->type[8] == '0' || dff->type[8] == '1')) {
-		sig_d = dff->getPort("\\D");
-		sig_q = dff->getPort("\\Q");
-		sig_c = dff->getPort("\\C");
-		sig_r = dff->getPort("\\R");
+		sig_d = dff->getPort(ID::D);
+		sig_q = dff->getPort(ID::Q);
+		sig_c = dff->getPort(ID::C);
+		sig_r = dff->getPort(ID::R);
 		val_cp = RTLIL::Const(dff->type[6] == 'P', 1);
 		val_rp = RTLIL::Const(dff->type[7] == 'P', 1);
 		val_rv = RTLIL::Const(dff->type[8] == '1', 1);
 	}
 	else if (dff->type == "$dff") {
-		sig_d = dff->getPort("\\D");
-		sig_q = dff->getPort("\\Q");
-		sig_c = dff->getPort("\\CLK");
-		val_cp = RTLIL::Const(dff->parameters["\\CLK_POLARITY"].as_bool(), 1);
+		sig_d = dff->getPort(ID::D);
+		sig_q = dff->getPort(ID::Q);
+		sig_c = dff->getPort(ID::CLK);
+		val_cp = RTLIL::Const(dff->parameters[ID::CLK_POLARITY].as_bool(), 1);
 	}
 	else if (dff->type == "$adff") {
-		sig_d = dff->getPort("\\D");
-		sig_q = dff->getPort("\\Q");
-		sig_c = dff->getPort("\\CLK");
-		sig_r = dff->getPort("\\ARST");
-		val_cp = RTLIL::Const(dff->parameters["\\CLK_POLARITY"].as_bool(), 1);
-		val_rp = RTLIL::Const(dff->parameters["\\ARST_POLARITY"].as_bool(), 1);
-		val_rv = dff->parameters["\\ARST_VALUE"];
+		sig_d = dff->getPort(ID::D);
+		sig_q = dff->getPort(ID::Q);
+		sig_c = dff->getPort(ID::CLK);
+		sig_r = dff->getPort(ID::ARST);
+		val_cp = RTLIL::Const(dff->parameters[ID::CLK_POLARITY].as_bool(), 1);
+		val_rp = RTLIL::Const(dff->parameters[ID::ARST_POLARITY].as_bool(), 1);
+		val_rv = dff->parameters[ID::ARST_VALUE];
 	}
 	else
 		log_abort();
@@ -120,12 +244,16 @@ bool handle_dff(RTLIL::Module *mod, RTLIL::Cell *dff)
 		val_init.bits.push_back(bit.wire == NULL ? bit.data : RTLIL::State::Sx);
 	}
 
-	if (dff->type == "$dff" && mux_drivers.has(sig_d)) {
+	if (dff->type == "$dff") {
 		std::set<RTLIL::Cell*> muxes;
-		mux_drivers.find(sig_d, muxes);
+		for (auto bit : sig_d)
+			for (auto &port : mod_index->query_ports(bit))
+				if (port.port == ID::Y && is_mux_type(port.cell->type) &&
+						port.cell->getPort(ID::A).size() == port.cell->getPort(ID::B).size())
+					muxes.insert(port.cell);
 		for (auto mux : muxes) {
-			RTLIL::SigSpec sig_a = assign_map(mux->getPort("\\A"));
-			RTLIL::SigSpec sig_b = assign_map(mux->getPort("\\B"));
+			RTLIL::SigSpec sig_a = assign_map(mux->getPort(ID::A));
+			RTLIL::SigSpec sig_b = assign_map(mux->getPort(ID::B));
 			if (sig_a == sig_q && sig_b.is_fully_const() && (!has_init || val_init == sig_b.as_const())) {
 				mod->connect(sig_q, sig_b);
 				goto delete_dff;
@@ -171,13 +299,14 @@ bool handle_dff(RTLIL::Module *mod, RTLIL::Cell *dff)
 
 delete_dff:
 	log("Removing %s (%s) from module %s.\n", dff->name.c_str(), dff->type.c_str(), mod->name.c_str());
-	remove_init_attr(dff->getPort("\\Q"));
+	remove_init_attr(dff->getPort(ID::Q));
 	mod->remove(dff);
 	return true;
 }
 
 struct OptRmdffPass : public Pass {
 	OptRmdffPass() : Pass("opt_rmdff", "remove DFFs with constant inputs") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -187,6 +316,10 @@ struct OptRmdffPass : public Pass {
 		log("This pass identifies flip-flops with constant inputs and replaces them with\n");
 		log("a constant driver.\n");
 		log("\n");
+		log("The pass remembers which cells it has already looked at. When it is run again\n");
+		log("on the same module, only the flip-flops whose ports, mux drivers or connected\n");
+		log("nets have changed since the last run are examined.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
@@ -195,64 +328,114 @@ struct OptRmdffPass : public Pass {
 
 		extra_args(args, 1, design);
 
-		for (auto &mod_it : design->modules_)
+		for (auto module : design->selected_modules())
 		{
-			if (!design->selected(mod_it.second))
-				continue;
+			RmdffWatch *watch = rmdff_cache.watch(module);
+
+			mod_index = &module->modindex();
+			if (mod_index->auto_reload_module)
+				mod_index->reload_module();
+
+			std::vector<RTLIL::Wire*> init_wires;
+			if (hash_init_attributes(module, &init_wires) != watch->init_hash)
+				watch->full_scan = true;
+
+			std::vector<RTLIL::IdString> candidates;
+
+			if (watch->full_scan)
+			{
+				for (auto &it : module->cells_)
+					candidates.push_back(it.first);
+				watch->pending_cells.clear();
+			}
+			else
+			{
+				pool<RTLIL::IdString> marked;
+				marked.swap(watch->pending_cells);
+
+				auto mark_mux_fanout = [&](RTLIL::Cell *mux) {
+					for (auto bit : mux->getPort(ID::Y))
+						for (auto &port : mod_index->query_ports(bit))
+							marked.insert(port.cell->name);
+				};
 
-			assign_map.set(mod_it.second);
-			dff_init_map.set(mod_it.second);
-			for (auto &it : mod_it.second->wires_)
-				if (it.second->attributes.count("\\init") != 0) {
-					dff_init_map.add(it.second, it.second->attributes.at("\\init"));
-					for (int i = 0; i < GetSize(it.second); i++) {
-						SigBit wire_bit(it.second, i), mapped_bit = assign_map(wire_bit);
-						if (mapped_bit.wire)
-							init_attributes[mapped_bit].insert(wire_bit);
+				for (auto &it : watch->dirty_bits) {
+					RTLIL::Wire *wire = module->wire(it.first);
+					if (wire == nullptr || it.second >= GetSize(wire))
+						continue;
+					for (auto &port : mod_index->query_ports(RTLIL::SigBit(wire, it.second))) {
+						marked.insert(port.cell->name);
+						if (is_mux_type(port.cell->type) && port.port != ID::Y)
+							mark_mux_fanout(port.cell);
 					}
 				}
-			mux_drivers.clear();
+
+				for (auto &name : watch->dirty_muxes) {
+					RTLIL::Cell *mux = module->cell(name);
+					if (mux != nullptr && is_mux_type(mux->type))
+						mark_mux_fanout(mux);
+				}
+
+				candidates.insert(candidates.end(), marked.begin(), marked.end());
+			}
+
+			watch->full_scan = false;
+			watch->dirty_bits.clear();
+			watch->dirty_muxes.clear();
 
 			std::vector<RTLIL::IdString> dff_list;
 			std::vector<RTLIL::IdString> dlatch_list;
-			for (auto &it : mod_it.second->cells_) {
-				if (it.second->type == "$mux" || it.second->type == "$pmux") {
-					if (it.second->getPort("\\A").size() == it.second->getPort("\\B").size())
-						mux_drivers.insert(assign_map(it.second->getPort("\\Y")), it.second);
+			for (auto &name : candidates) {
+				RTLIL::Cell *cell = module->cell(name);
+				if (cell == nullptr || (!is_dff_type(cell->type) && cell->type != "$dlatch"))
 					continue;
-				}
-				if (!design->selected(mod_it.second, it.second))
+				if (!design->selected(module, cell)) {
+					watch->pending_cells.insert(name);
 					continue;
-				if (it.second->type == "$_DFF_N_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_P_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_NN0_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_NN1_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_NP0_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_NP1_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_PN0_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_PN1_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_PP0_") dff_list.push_back(it.first);
-				if (it.second->type == "$_DFF_PP1_") dff_list.push_back(it.first);
-				if (it.second->type == "$dff") dff_list.push_back(it.first);
-				if (it.second->type == "$adff") dff_list.push_back(it.first);
-				if (it.second->type == "$dlatch") dlatch_list.push_back(it.first);
+				}
+				if (cell->type == "$dlatch")
+					dlatch_list.push_back(name);
+				else
+					dff_list.push_back(name);
+			}
+
+			if (dff_list.empty() && dlatch_list.empty()) {
+				watch->init_hash = hash_init_attributes(module);
+				continue;
+			}
+
+			assign_map = mod_index->sigmap;
+			dff_init_map = assign_map;
+			init_attributes.clear();
+			for (auto wire : init_wires) {
+				dff_init_map.add(wire, wire->attributes.at(ID::init));
+				for (int i = 0; i < GetSize(wire); i++) {
+					SigBit wire_bit(wire, i), mapped_bit = assign_map(wire_bit);
+					if (mapped_bit.wire)
+						init_attributes[mapped_bit].insert(wire_bit);
+				}
 			}
 
 			for (auto &id : dff_list) {
-				if (mod_it.second->cells_.count(id) > 0 &&
-						handle_dff(mod_it.second, mod_it.second->cells_[id]))
+				if (module->cells_.count(id) > 0 &&
+						handle_dff(module, module->cells_[id]))
 					total_count++;
 			}
 
 			for (auto &id : dlatch_list) {
-				if (mod_it.second->cells_.count(id) > 0 &&
-						handle_dlatch(mod_it.second, mod_it.second->cells_[id]))
+				if (module->cells_.count(id) > 0 &&
+						handle_dlatch(module, module->cells_[id]))
 					total_count++;
 			}
+
+			// remove_init_attr() may have changed init attributes
+			watch->init_hash = hash_init_attributes(module);
 		}
 
 		assign_map.clear();
-		mux_drivers.clear();
+		dff_init_map.clear();
+		init_attributes.clear();
+		mod_index = nullptr;
 
 		if (total_count)
 			design->scratchpad_set_bool("opt.did_something", true);
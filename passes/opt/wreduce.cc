@@ -47,23 +47,54 @@ struct WreduceWorker
 {
 	WreduceConfig *config;
 	Module *module;
-	ModIndex mi;
-
-	std::set<Cell*, IdString::compare_ptr_by_name<Cell>> work_queue_cells;
-	std::set<SigBit> work_queue_bits;
+	ModIndex &mi;
+
+	// Cells are (re-)visited from a worklist: when a cell gives up some of its
+	// input or output bits, the other cells on those bits are queued, so a
+	// reduction propagates forward and backward through the netlist until
+	// nothing changes anymore.
+	std::vector<Cell*> work_queue;
+	pool<Cell*> work_queue_pending;
+	Cell *current_cell;
 	pool<SigBit> keep_bits;
 
+	int count_cell_visits;
+
 	WreduceWorker(WreduceConfig *config, Module *module) :
-			config(config), module(module), mi(module) { }
+			config(config), module(module), mi(module->modindex()), current_cell(nullptr), count_cell_visits(0) { }
+
+	void queue_cell(Cell *cell)
+	{
+		if (cell == current_cell || work_queue_pending.count(cell) || !module->selected(cell))
+			return;
+		work_queue_pending.insert(cell);
+		work_queue.push_back(cell);
+	}
+
+	// queue the cells connected to bit. this must be called before the bit is
+	// connected to something else, as that changes its entry in the ModIndex.
+	void queue_bit(SigBit bit)
+	{
+		if (bit.wire == nullptr)
+			return;
+		for (auto &port : mi.query_ports(bit))
+			queue_cell(port.cell);
+	}
+
+	void queue_bits(const SigSpec &sig)
+	{
+		for (auto bit : sig)
+			queue_bit(bit);
+	}
 
 	void run_cell_mux(Cell *cell)
 	{
 		// Reduce size of MUX if inputs agree on a value for a bit or a output bit is unused
 
-		SigSpec sig_a = mi.sigmap(cell->getPort("\\A"));
-		SigSpec sig_b = mi.sigmap(cell->getPort("\\B"));
-		SigSpec sig_s = mi.sigmap(cell->getPort("\\S"));
-		SigSpec sig_y = mi.sigmap(cell->getPort("\\Y"));
+		SigSpec sig_a = mi.sigmap(cell->getPort(ID::A));
+		SigSpec sig_b = mi.sigmap(cell->getPort(ID::B));
+		SigSpec sig_s = mi.sigmap(cell->getPort(ID::S));
+		SigSpec sig_y = mi.sigmap(cell->getPort(ID::Y));
 		std::vector<SigBit> bits_removed;
 
 		if (sig_y.has_const())
@@ -99,6 +130,10 @@ struct WreduceWorker
 
 		if (GetSize(bits_removed) == GetSize(sig_y)) {
 			log("Removed cell %s.%s (%s).\n", log_id(module), log_id(cell), log_id(cell->type));
+			queue_bits(sig_a);
+			queue_bits(sig_b);
+			queue_bits(sig_s);
+			queue_bits(sig_y);
 			module->connect(sig_y, sig_removed);
 			module->remove(cell);
 			return;
@@ -123,12 +158,11 @@ struct WreduceWorker
 			new_work_queue_bits.append(sig_b.extract(k*GetSize(sig_a) + n_kept, n_removed));
 		}
 
-		for (auto bit : new_work_queue_bits)
-			work_queue_bits.insert(bit);
+		queue_bits(new_work_queue_bits);
 
-		cell->setPort("\\A", new_sig_a);
-		cell->setPort("\\B", new_sig_b);
-		cell->setPort("\\Y", new_sig_y);
+		cell->setPort(ID::A, new_sig_a);
+		cell->setPort(ID::B, new_sig_b);
+		cell->setPort(ID::Y, new_sig_y);
 		cell->fixup_parameters();
 
 		module->connect(sig_y.extract(n_kept, n_removed), sig_removed);
@@ -145,17 +179,16 @@ struct WreduceWorker
 		int bits_removed = 0;
 		if (GetSize(sig) > max_port_size) {
 			bits_removed = GetSize(sig) - max_port_size;
-			for (auto bit : sig.extract(max_port_size, bits_removed))
-				work_queue_bits.insert(bit);
+			queue_bits(sig.extract(max_port_size, bits_removed));
 			sig = sig.extract(0, max_port_size);
 		}
 
 		if (port_signed) {
 			while (GetSize(sig) > 1 && sig[GetSize(sig)-1] == sig[GetSize(sig)-2])
-				work_queue_bits.insert(sig[GetSize(sig)-1]), sig.remove(GetSize(sig)-1), bits_removed++;
+				queue_bit(sig[GetSize(sig)-1]), sig.remove(GetSize(sig)-1), bits_removed++;
 		} else {
 			while (GetSize(sig) > 1 && sig[GetSize(sig)-1] == S0)
-				work_queue_bits.insert(sig[GetSize(sig)-1]), sig.remove(GetSize(sig)-1), bits_removed++;
+				queue_bit(sig[GetSize(sig)-1]), sig.remove(GetSize(sig)-1), bits_removed++;
 		}
 
 		if (bits_removed) {
@@ -176,7 +209,7 @@ struct WreduceWorker
 		if (cell->type.in("$mux", "$pmux"))
 			return run_cell_mux(cell);
 
-		SigSpec sig = mi.sigmap(cell->getPort("\\Y"));
+		SigSpec sig = mi.sigmap(cell->getPort(ID::Y));
 
 		if (sig.has_const())
 			return;
@@ -184,8 +217,8 @@ struct WreduceWorker
 
 		// Reduce size of ports A and B based on constant input bits and size of output port
 
-		int max_port_a_size = cell->hasPort("\\A") ? GetSize(cell->getPort("\\A")) : -1;
-		int max_port_b_size = cell->hasPort("\\B") ? GetSize(cell->getPort("\\B")) : -1;
+		int max_port_a_size = cell->hasPort(ID::A) ? GetSize(cell->getPort(ID::A)) : -1;
+		int max_port_b_size = cell->hasPort(ID::B) ? GetSize(cell->getPort(ID::B)) : -1;
 
 		if (cell->type.in("$not", "$pos", "$neg", "$and", "$or", "$xor", "$add", "$sub")) {
 			max_port_a_size = min(max_port_a_size, GetSize(sig));
@@ -201,26 +234,26 @@ struct WreduceWorker
 		if (max_port_b_size >= 0)
 			run_reduce_inport(cell, 'B', max_port_b_size, port_b_signed, did_something);
 
-		if (cell->hasPort("\\A") && cell->hasPort("\\B") && port_a_signed && port_b_signed) {
-			SigSpec sig_a = mi.sigmap(cell->getPort("\\A")), sig_b = mi.sigmap(cell->getPort("\\B"));
+		if (cell->hasPort(ID::A) && cell->hasPort(ID::B) && port_a_signed && port_b_signed) {
+			SigSpec sig_a = mi.sigmap(cell->getPort(ID::A)), sig_b = mi.sigmap(cell->getPort(ID::B));
 			if (GetSize(sig_a) > 0 && sig_a[GetSize(sig_a)-1] == State::S0 &&
 					GetSize(sig_b) > 0 && sig_b[GetSize(sig_b)-1] == State::S0) {
 				log("Converting cell %s.%s (%s) from signed to unsigned.\n",
 						log_id(module), log_id(cell), log_id(cell->type));
-				cell->setParam("\\A_SIGNED", 0);
-				cell->setParam("\\B_SIGNED", 0);
+				cell->setParam(ID::A_SIGNED, 0);
+				cell->setParam(ID::B_SIGNED, 0);
 				port_a_signed = false;
 				port_b_signed = false;
 				did_something = true;
 			}
 		}
 
-		if (cell->hasPort("\\A") && !cell->hasPort("\\B") && port_a_signed) {
-			SigSpec sig_a = mi.sigmap(cell->getPort("\\A"));
+		if (cell->hasPort(ID::A) && !cell->hasPort(ID::B) && port_a_signed) {
+			SigSpec sig_a = mi.sigmap(cell->getPort(ID::A));
 			if (GetSize(sig_a) > 0 && sig_a[GetSize(sig_a)-1] == State::S0) {
 				log("Converting cell %s.%s (%s) from signed to unsigned.\n",
 						log_id(module), log_id(cell), log_id(cell->type));
-				cell->setParam("\\A_SIGNED", 0);
+				cell->setParam(ID::A_SIGNED, 0);
 				port_a_signed = false;
 				did_something = true;
 			}
@@ -247,11 +280,11 @@ struct WreduceWorker
 
 		if (cell->type.in("$pos", "$add", "$mul", "$and", "$or", "$xor"))
 		{
-			bool is_signed = cell->getParam("\\A_SIGNED").as_bool();
+			bool is_signed = cell->getParam(ID::A_SIGNED).as_bool();
 
 			int a_size = 0, b_size = 0;
-			if (cell->hasPort("\\A")) a_size = GetSize(cell->getPort("\\A"));
-			if (cell->hasPort("\\B")) b_size = GetSize(cell->getPort("\\B"));
+			if (cell->hasPort(ID::A)) a_size = GetSize(cell->getPort(ID::A));
+			if (cell->hasPort(ID::B)) b_size = GetSize(cell->getPort(ID::B));
 
 			int max_y_size = max(a_size, b_size);
 
@@ -262,6 +295,7 @@ struct WreduceWorker
 				max_y_size = a_size + b_size;
 
 			while (GetSize(sig) > 1 && GetSize(sig) > max_y_size) {
+				queue_bit(sig[GetSize(sig)-1]);
 				module->connect(sig[GetSize(sig)-1], is_signed ? sig[GetSize(sig)-2] : S0);
 				sig.remove(GetSize(sig)-1);
 				bits_removed++;
@@ -270,6 +304,8 @@ struct WreduceWorker
 
 		if (GetSize(sig) == 0) {
 			log("Removed cell %s.%s (%s).\n", log_id(module), log_id(cell), log_id(cell->type));
+			for (auto &conn : cell->connections())
+				queue_bits(conn.second);
 			module->remove(cell);
 			return;
 		}
@@ -277,7 +313,7 @@ struct WreduceWorker
 		if (bits_removed) {
 			log("Removed top %d bits (of %d) from port Y of cell %s.%s (%s).\n",
 					bits_removed, GetSize(sig) + bits_removed, log_id(module), log_id(cell), log_id(cell->type));
-			cell->setPort("\\Y", sig);
+			cell->setPort(ID::Y, sig);
 			did_something = true;
 		}
 
@@ -290,38 +326,42 @@ struct WreduceWorker
 	static int count_nontrivial_wire_attrs(RTLIL::Wire *w)
 	{
 		int count = w->attributes.size();
-		count -= w->attributes.count("\\src");
-		count -= w->attributes.count("\\unused_bits");
+		count -= w->attributes.count(ID::src);
+		count -= w->attributes.count(ID::unused_bits);
 		return count;
 	}
 
 	void run()
 	{
 		for (auto w : module->wires())
-			if (w->get_bool_attribute("\\keep"))
+			if (w->get_bool_attribute(ID::keep))
 				for (auto bit : mi.sigmap(w))
 					keep_bits.insert(bit);
 
-		for (auto c : module->selected_cells())
-			work_queue_cells.insert(c);
+		std::vector<Cell*> initial_cells = module->selected_cells();
+		std::sort(initial_cells.begin(), initial_cells.end(), IdString::compare_ptr_by_name<Cell>());
+		for (auto c : initial_cells)
+			queue_cell(c);
 
-		while (!work_queue_cells.empty())
-		{
-			work_queue_bits.clear();
-			for (auto c : work_queue_cells)
-				run_cell(c);
-
-			work_queue_cells.clear();
-			for (auto bit : work_queue_bits)
-			for (auto port : mi.query_ports(bit))
-				if (module->selected(port.cell))
-					work_queue_cells.insert(port.cell);
+		for (int i = 0; i < GetSize(work_queue); i++) {
+			current_cell = work_queue[i];
+			work_queue_pending.erase(current_cell);
+			run_cell(current_cell);
+			count_cell_visits++;
 		}
+		current_cell = nullptr;
+
+		log("Visited %d cells in module %s (%d initially queued).\n",
+				count_cell_visits, log_id(module), GetSize(initial_cells));
 
 		pool<SigSpec> complete_wires;
 		for (auto w : module->wires())
 			complete_wires.insert(mi.sigmap(w));
 
+		// the wires are only replaced after the loop: renaming a wire
+		// invalidates the ModIndex.
+		std::vector<std::pair<Wire*, int>> shrink_wires;
+
 		for (auto w : module->selected_wires())
 		{
 			int unused_top_bits = 0;
@@ -344,15 +384,20 @@ struct WreduceWorker
 				continue;
 
 			log("Removed top %d bits (of %d) from wire %s.%s.\n", unused_top_bits, GetSize(w), log_id(module), log_id(w));
-			Wire *nw = module->addWire(NEW_ID, GetSize(w) - unused_top_bits);
-			module->connect(nw, SigSpec(w).extract(0, GetSize(nw)));
-			module->swap_names(w, nw);
+			shrink_wires.push_back(std::make_pair(w, GetSize(w) - unused_top_bits));
+		}
+
+		for (auto &it : shrink_wires) {
+			Wire *nw = module->addWire(NEW_ID, it.second);
+			module->connect(nw, SigSpec(it.first).extract(0, GetSize(nw)));
+			module->swap_names(it.first, nw);
 		}
 	}
 };
 
 struct WreducePass : public Pass {
 	WreducePass() : Pass("wreduce", "reduce the word size of operations if possible") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -379,19 +424,19 @@ struct WreducePass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto module : design->selected_modules())
+		run_module_jobs(design, design->selected_modules(), [&](Module *module)
 		{
 			if (module->has_processes_warn())
-				continue;
+				return;
 
 			for (auto c : module->selected_cells())
 				if (c->type.in("$reduce_and", "$reduce_or", "$reduce_xor", "$reduce_xnor", "$reduce_bool",
 						"$lt", "$le", "$eq", "$ne", "$eqx", "$nex", "$ge", "$gt",
-						"$logic_not", "$logic_and", "$logic_or") && GetSize(c->getPort("\\Y")) > 1) {
-					SigSpec sig = c->getPort("\\Y");
+						"$logic_not", "$logic_and", "$logic_or") && GetSize(c->getPort(ID::Y)) > 1) {
+					SigSpec sig = c->getPort(ID::Y);
 					if (!sig.has_const()) {
-						c->setPort("\\Y", sig[0]);
-						c->setParam("\\Y_WIDTH", 1);
+						c->setPort(ID::Y, sig[0]);
+						c->setParam(ID::Y_WIDTH, 1);
 						sig.remove(0);
 						module->connect(sig, Const(0, GetSize(sig)));
 					}
@@ -399,7 +444,7 @@ struct WreducePass : public Pass {
 
 			WreduceWorker worker(&config, module);
 			worker.run();
-		}
+		});
 	}
 } WreducePass;
 
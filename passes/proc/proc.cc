@@ -27,6 +27,7 @@ PRIVATE_NAMESPACE_BEGIN
 
 struct ProcPass : public Pass {
 	ProcPass() : Pass("proc", "translate processes to netlists") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -47,6 +48,10 @@ struct ProcPass : public Pass {
 		log("This replaces the processes in the design with multiplexers,\n");
 		log("flip-flops and latches.\n");
 		log("\n");
+		log("When more than one job is enabled (yosys -j), the complete sequence is run\n");
+		log("for each selected module in one worker process, instead of distributing\n");
+		log("the modules to workers separately for each of the passes above.\n");
+		log("\n");
 		log("The following options are supported:\n");
 		log("\n");
 		log("    -global_arst [!]<netname>\n");
@@ -71,6 +76,30 @@ struct ProcPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
+		std::vector<RTLIL::Module*> modules = design->selected_modules();
+
+		if (yosys_jobs > 1 && GetSize(modules) > 1)
+		{
+			// processes only ever emit cells into their own module, so each
+			// module can be lowered completely in one worker
+			run_module_jobs(design, modules, [&](RTLIL::Module *mod) {
+				RTLIL::Selection sel(false);
+				if (design->selected_whole_module(mod->name))
+					sel.selected_modules.insert(mod->name);
+				else
+					sel.selected_members[mod->name] = design->selection_stack.back().selected_members.at(mod->name);
+				design->selection_stack.push_back(sel);
+				run_passes(design, global_arst);
+				design->selection_stack.pop_back();
+			});
+		}
+		else
+			run_passes(design, global_arst);
+
+		log_pop();
+	}
+	void run_passes(RTLIL::Design *design, std::string global_arst)
+	{
 		Pass::call(design, "proc_clean");
 		Pass::call(design, "proc_rmdead");
 		Pass::call(design, "proc_init");
@@ -82,8 +111,6 @@ struct ProcPass : public Pass {
 		Pass::call(design, "proc_dlatch");
 		Pass::call(design, "proc_dff");
 		Pass::call(design, "proc_clean");
-
-		log_pop();
 	}
 } ProcPass;
 
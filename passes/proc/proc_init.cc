@@ -87,6 +87,7 @@ void proc_init(RTLIL::Module *mod, RTLIL::Process *proc)
 
 struct ProcInitPass : public Pass {
 	ProcInitPass() : Pass("proc_init", "convert initial block to init attributes") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -104,11 +105,11 @@ struct ProcInitPass : public Pass {
 
 		extra_args(args, 1, design);
 
-		for (auto mod : design->modules())
-			if (design->selected(mod))
-				for (auto &proc_it : mod->processes)
-					if (design->selected(mod, proc_it.second))
-						proc_init(mod, proc_it.second);
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod) {
+			for (auto &proc_it : mod->processes)
+				if (design->selected(mod, proc_it.second))
+					proc_init(mod, proc_it.second);
+		});
 	}
 } ProcInitPass;
 
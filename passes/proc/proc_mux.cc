@@ -109,6 +109,7 @@ struct SigSnippets
 struct SnippetSwCache
 {
 	dict<RTLIL::SwitchRule*, pool<int>, hash_ptr_ops> cache;
+	dict<const RTLIL::CaseRule*, dict<int, vector<int>>, hash_ptr_ops> case_actions;
 	const SigSnippets *snippets;
 	int current_snippet;
 
@@ -117,13 +118,26 @@ struct SnippetSwCache
 		return cache[sw].count(current_snippet) != 0;
 	}
 
+	// indices of the actions in the case rule that assign the current snippet
+	const vector<int> &actions(const RTLIL::CaseRule *cs)
+	{
+		static const vector<int> empty;
+		auto it = case_actions.find(cs);
+		if (it == case_actions.end() || it->second.count(current_snippet) == 0)
+			return empty;
+		return it->second.at(current_snippet);
+	}
+
 	void insert(const RTLIL::CaseRule *cs, vector<RTLIL::SwitchRule*> &sw_stack)
 	{
-		for (auto &action : cs->actions)
-		for (auto bit : action.first) {
+		for (int i = 0; i < GetSize(cs->actions); i++)
+		for (auto bit : cs->actions[i].first) {
 			int sn = snippets->bit2snippet.at(bit, -1);
 			if (sn < 0)
 				continue;
+			vector<int> &action_list = case_actions[cs][sn];
+			if (action_list.empty() || action_list.back() != i)
+				action_list.push_back(i);
 			for (auto sw : sw_stack)
 				cache[sw].insert(sn);
 		}
@@ -211,7 +225,22 @@ RTLIL::SigSpec gen_cmp(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const s
 	return RTLIL::SigSpec(ctrl_wire);
 }
 
-RTLIL::SigSpec gen_mux(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const std::vector<RTLIL::SigSpec> &compare, RTLIL::SigSpec when_signal, RTLIL::SigSpec else_signal, RTLIL::Cell *&last_mux_cell, RTLIL::SwitchRule *sw)
+// the compare logic for a case rule only depends on the case rule, so it is
+// created once and shared by the multiplexers for all signals in the switch
+typedef dict<RTLIL::CaseRule*, RTLIL::SigSpec, hash_ptr_ops> cmp_cache_t;
+
+RTLIL::SigSpec gen_cmp(RTLIL::Module *mod, cmp_cache_t &cmp_cache, RTLIL::CaseRule *cs, RTLIL::SwitchRule *sw)
+{
+	auto it = cmp_cache.find(cs);
+	if (it != cmp_cache.end())
+		return it->second;
+
+	RTLIL::SigSpec ctrl_sig = gen_cmp(mod, sw->signal, cs->compare, sw);
+	cmp_cache[cs] = ctrl_sig;
+	return ctrl_sig;
+}
+
+RTLIL::SigSpec gen_mux(RTLIL::Module *mod, cmp_cache_t &cmp_cache, RTLIL::CaseRule *cs, RTLIL::SigSpec when_signal, RTLIL::SigSpec else_signal, RTLIL::Cell *&last_mux_cell, RTLIL::SwitchRule *sw)
 {
 	log_assert(when_signal.size() == else_signal.size());
 
@@ -219,11 +248,11 @@ RTLIL::SigSpec gen_mux(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const s
 	sstr << "$procmux$" << (autoidx++);
 
 	// the trivial cases
-	if (compare.size() == 0 || when_signal == else_signal)
+	if (cs->compare.size() == 0 || when_signal == else_signal)
 		return when_signal;
 
 	// compare results
-	RTLIL::SigSpec ctrl_sig = gen_cmp(mod, signal, compare, sw);
+	RTLIL::SigSpec ctrl_sig = gen_cmp(mod, cmp_cache, cs, sw);
 	if (ctrl_sig.size() == 0)
 		return when_signal;
 	log_assert(ctrl_sig.size() == 1);
@@ -245,12 +274,12 @@ RTLIL::SigSpec gen_mux(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const s
 	return RTLIL::SigSpec(result_wire);
 }
 
-void append_pmux(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const std::vector<RTLIL::SigSpec> &compare, RTLIL::SigSpec when_signal, RTLIL::Cell *last_mux_cell, RTLIL::SwitchRule *sw)
+void append_pmux(RTLIL::Module *mod, cmp_cache_t &cmp_cache, RTLIL::CaseRule *cs, RTLIL::SigSpec when_signal, RTLIL::Cell *last_mux_cell, RTLIL::SwitchRule *sw)
 {
 	log_assert(last_mux_cell != NULL);
 	log_assert(when_signal.size() == last_mux_cell->getPort("\\A").size());
 
-	RTLIL::SigSpec ctrl_sig = gen_cmp(mod, signal, compare, sw);
+	RTLIL::SigSpec ctrl_sig = gen_cmp(mod, cmp_cache, cs, sw);
 	log_assert(ctrl_sig.size() == 1);
 	last_mux_cell->type = "$pmux";
 
@@ -266,11 +295,12 @@ void append_pmux(RTLIL::Module *mod, const RTLIL::SigSpec &signal, const std::ve
 }
 
 RTLIL::SigSpec signal_to_mux_tree(RTLIL::Module *mod, SnippetSwCache &swcache, dict<RTLIL::SwitchRule*, bool, hash_ptr_ops> &swpara,
-		RTLIL::CaseRule *cs, const RTLIL::SigSpec &sig, const RTLIL::SigSpec &defval)
+		cmp_cache_t &cmp_cache, RTLIL::CaseRule *cs, const RTLIL::SigSpec &sig, const RTLIL::SigSpec &defval)
 {
 	RTLIL::SigSpec result = defval;
 
-	for (auto &action : cs->actions) {
+	for (int action_idx : swcache.actions(cs)) {
+		auto &action = cs->actions[action_idx];
 		sig.replace(action.first, action.second, &result);
 		action.first.remove2(sig, &action.second);
 	}
@@ -340,11 +370,11 @@ RTLIL::SigSpec signal_to_mux_tree(RTLIL::Module *mod, SnippetSwCache &swcache, d
 		for (size_t i = 0; i < sw->cases.size(); i++) {
 			int case_idx = sw->cases.size() - i - 1;
 			RTLIL::CaseRule *cs2 = sw->cases[case_idx];
-			RTLIL::SigSpec value = signal_to_mux_tree(mod, swcache, swpara, cs2, sig, initial_val);
+			RTLIL::SigSpec value = signal_to_mux_tree(mod, swcache, swpara, cmp_cache, cs2, sig, initial_val);
 			if (last_mux_cell && pgroups[case_idx] == pgroups[case_idx+1])
-				append_pmux(mod, sw->signal, cs2->compare, value, last_mux_cell, sw);
+				append_pmux(mod, cmp_cache, cs2, value, last_mux_cell, sw);
 			else
-				result = gen_mux(mod, sw->signal, cs2->compare, value, result, last_mux_cell, sw);
+				result = gen_mux(mod, cmp_cache, cs2, value, result, last_mux_cell, sw);
 		}
 	}
 
@@ -363,6 +393,7 @@ void proc_mux(RTLIL::Module *mod, RTLIL::Process *proc)
 	swcache.insert(&proc->root_case);
 
 	dict<RTLIL::SwitchRule*, bool, hash_ptr_ops> swpara;
+	cmp_cache_t cmp_cache;
 
 	int cnt = 0;
 	for (int idx : sigsnip.snippets)
@@ -372,13 +403,14 @@ void proc_mux(RTLIL::Module *mod, RTLIL::Process *proc)
 
 		log("%6d/%d: %s\n", ++cnt, GetSize(sigsnip.snippets), log_signal(sig));
 
-		RTLIL::SigSpec value = signal_to_mux_tree(mod, swcache, swpara, &proc->root_case, sig, RTLIL::SigSpec(RTLIL::State::Sx, sig.size()));
+		RTLIL::SigSpec value = signal_to_mux_tree(mod, swcache, swpara, cmp_cache, &proc->root_case, sig, RTLIL::SigSpec(RTLIL::State::Sx, sig.size()));
 		mod->connect(RTLIL::SigSig(sig, value));
 	}
 }
 
 struct ProcMuxPass : public Pass {
 	ProcMuxPass() : Pass("proc_mux", "convert decision trees to multiplexers") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -395,11 +427,11 @@ struct ProcMuxPass : public Pass {
 
 		extra_args(args, 1, design);
 
-		for (auto mod : design->modules())
-			if (design->selected(mod))
-				for (auto &proc_it : mod->processes)
-					if (design->selected(mod, proc_it.second))
-						proc_mux(mod, proc_it.second);
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod) {
+			for (auto &proc_it : mod->processes)
+				if (design->selected(mod, proc_it.second))
+					proc_mux(mod, proc_it.second);
+		});
 	}
 } ProcMuxPass;
 
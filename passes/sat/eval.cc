@@ -25,6 +25,7 @@
 #include "kernel/consteval.h"
 #include "kernel/sigtools.h"
 #include "kernel/satgen.h"
+#include "kernel/bitsim.h"
 #include "kernel/log.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -358,6 +359,148 @@ struct VlogHammerReporter
 	}
 };
 
+struct EvalVectorsWorker
+{
+	RTLIL::Module *module;
+	std::vector<RTLIL::SigSpec> columns, shows;
+	std::vector<std::pair<RTLIL::SigSpec, RTLIL::Const>> sets;
+	bool set_undef;
+
+	std::vector<std::vector<RTLIL::Const>> vectors, expected;
+	std::vector<int> line_numbers;
+
+	EvalVectorsWorker(RTLIL::Module *module) : module(module), set_undef(false) { }
+
+	RTLIL::Const parse_value(RTLIL::SigSpec sig, std::string str, std::string filename, int line_nr)
+	{
+		RTLIL::SigSpec value;
+		if (!RTLIL::SigSpec::parse_rhs(sig, value, module, str) || !value.is_fully_const())
+			log_cmd_error("Can't parse value `%s' for %s in line %d of %s.\n", str.c_str(), log_signal(sig), line_nr, filename.c_str());
+		if (GetSize(value) != GetSize(sig))
+			log_cmd_error("Value `%s' in line %d of %s has %d bits, but %s has %d bits.\n", str.c_str(),
+					line_nr, filename.c_str(), GetSize(value), log_signal(sig), GetSize(sig));
+		return value.as_const();
+	}
+
+	void read_vectors(std::string filename)
+	{
+		std::ifstream f(filename.c_str());
+		if (f.fail())
+			log_cmd_error("Can't open vectors file `%s'.\n", filename.c_str());
+
+		std::string line;
+		for (int line_nr = 1; std::getline(f, line); line_nr++)
+		{
+			std::string::size_type comment = line.find('#');
+			if (comment != std::string::npos)
+				line = line.substr(0, comment);
+
+			std::vector<std::string> tokens = split_tokens(line);
+			if (tokens.empty())
+				continue;
+
+			if (GetSize(tokens) != GetSize(columns) && GetSize(tokens) != GetSize(columns) + GetSize(shows))
+				log_cmd_error("Expected %d input values (or %d input and expected output values) in line %d of %s, but found %d.\n",
+						GetSize(columns), GetSize(columns) + GetSize(shows), line_nr, filename.c_str(), GetSize(tokens));
+
+			vectors.push_back(std::vector<RTLIL::Const>());
+			expected.push_back(std::vector<RTLIL::Const>());
+			line_numbers.push_back(line_nr);
+
+			for (int i = 0; i < GetSize(columns); i++)
+				vectors.back().push_back(parse_value(columns[i], tokens[i], filename, line_nr));
+			for (int i = GetSize(columns); i < GetSize(tokens); i++)
+				expected.back().push_back(parse_value(shows[i - GetSize(columns)], tokens[i], filename, line_nr));
+		}
+	}
+
+	// x bits in the expected values are don't-care
+	static bool match(const RTLIL::Const &value, const RTLIL::Const &expected)
+	{
+		for (int i = 0; i < GetSize(value); i++)
+			if ((expected.bits[i] == RTLIL::State::S0 || expected.bits[i] == RTLIL::State::S1) && value.bits[i] != expected.bits[i])
+				return false;
+		return true;
+	}
+
+	void run()
+	{
+		int64_t start_ns = PerformanceTimer::query();
+		BitSim sim(module);
+
+		RTLIL::SigSpec show_sig, undef;
+		for (auto &it : sets)
+			sim.add_source(it.first);
+		for (auto &sig : columns)
+			sim.add_source(sig);
+		for (auto &sig : shows)
+			show_sig.append(sig);
+
+		sim.compile(show_sig, undef);
+
+		if (!undef.empty()) {
+			undef.sort_and_unify();
+			if (!set_undef)
+				log_cmd_error("Failed to evaluate signal %s: Missing value for %s.\n", log_signal(show_sig), log_signal(undef));
+			log("Assumed undef (x) value for the following signals: %s\n", log_signal(undef));
+		}
+
+		for (auto &it : sets)
+			sim.set_all(it.first, it.second);
+
+		log("Compiled %d fine-grained and %d coarse cells for %s.\n", sim.num_fine_cells, sim.num_coarse_cells, log_signal(show_sig));
+
+		std::string header;
+		for (auto &sig : columns)
+			header += stringf(" %s", log_signal(sig));
+		header += " |";
+		for (auto &sig : shows)
+			header += stringf(" %s", log_signal(sig));
+		log("\n%s\n", header.c_str());
+
+		int mismatches = 0;
+		for (int block = 0; block < GetSize(vectors); block += 64)
+		{
+			int num_lanes = min(GetSize(vectors) - block, 64);
+
+			for (int lane = 0; lane < num_lanes; lane++)
+				for (int i = 0; i < GetSize(columns); i++)
+					sim.set(columns[i], lane, vectors[block + lane][i]);
+
+			sim.run(num_lanes);
+
+			for (int lane = 0; lane < num_lanes; lane++)
+			{
+				int idx = block + lane;
+				std::string line;
+				bool ok = true;
+
+				for (int i = 0; i < GetSize(columns); i++)
+					line += stringf(" %s", log_signal(vectors[idx][i]));
+				line += " |";
+				for (int i = 0; i < GetSize(shows); i++) {
+					RTLIL::Const value = sim.get(shows[i], lane);
+					line += stringf(" %s", log_signal(value));
+					if (!expected[idx].empty() && !match(value, expected[idx][i])) {
+						line += stringf(" (expected %s)", log_signal(expected[idx][i]));
+						ok = false;
+					}
+				}
+
+				if (expected[idx].empty() || !ok)
+					log("%s%s\n", line.c_str(), ok ? "" : stringf("  <- mismatch in line %d", line_numbers[idx]).c_str());
+				if (!ok)
+					mismatches++;
+			}
+		}
+
+		log("\nSimulated %d vectors in %.2f ms.\n", GetSize(vectors), (PerformanceTimer::query() - start_ns) * 1e-6);
+
+		if (mismatches > 0)
+			log_cmd_error("Found %d mismatches against the expected values.\n", mismatches);
+	}
+};
+
 struct EvalPass : public Pass {
 	EvalPass() : Pass("eval", "evaluate the circuit given an input") { }
 	virtual void help()
@@ -382,11 +525,25 @@ struct EvalPass : public Pass {
 		log("        show the value for the specified signal. if no -show option is passed\n");
 		log("        then all output ports of the current module are used.\n");
 		log("\n");
+		log("    -vectors <filename>\n");
+		log("        evaluate all input vectors from the specified file. each line has one\n");
+		log("        value for each -table signal (default: all input ports, in port order),\n");
+		log("        optionally followed by the expected values for the -show signals. x\n");
+		log("        bits in expected values are don't-care. lines with expected values\n");
+		log("        are only printed on mismatch, and the command fails if there are any\n");
+		log("        mismatches. '#' starts a comment.\n");
+		log("\n");
+		log("The -vectors mode compiles the input cone of the -show signals to a levelized\n");
+		log("list of cells and evaluates 64 vectors at once for fine-grained cells. Coarse\n");
+		log("cells are evaluated for one vector at a time. The results are the same as the\n");
+		log("results of the other eval modes.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		std::vector<std::pair<std::string, std::string>> sets;
 		std::vector<std::string> shows, tables;
+		std::string vectors_file;
 		bool set_undef = false;
 
 		log_header("Executing EVAL pass (evaluate the circuit given an input).\n");
@@ -411,6 +568,10 @@ struct EvalPass : public Pass {
 				tables.push_back(args[++argidx]);
 				continue;
 			}
+			if (args[argidx] == "-vectors" && argidx+1 < args.size()) {
+				vectors_file = args[++argidx];
+				continue;
+			}
 			if ((args[argidx] == "-brute_force_equiv_checker" || args[argidx] == "-brute_force_equiv_checker_x") && argidx+3 == args.size()) {
 				/* this should only be used for regression testing of ConstEval -- see vloghammer */
 				std::string mod1_name = RTLIL::escape_id(args[++argidx]);
@@ -452,6 +613,7 @@ struct EvalPass : public Pass {
 			log_cmd_error("Can't perform EVAL on an empty selection!\n");
 
 		ConstEval ce(module);
+		EvalVectorsWorker vectors_worker(module);
 
 		for (auto &it : sets) {
 			RTLIL::SigSpec lhs, rhs;
@@ -465,6 +627,7 @@ struct EvalPass : public Pass {
 				log_cmd_error("Set expression with different lhs and rhs sizes: %s (%s, %d bits) vs. %s (%s, %d bits)\n",
 						it.first.c_str(), log_signal(lhs), lhs.size(), it.second.c_str(), log_signal(rhs), rhs.size());
 			ce.set(lhs, rhs.as_const());
+			vectors_worker.sets.push_back(std::pair<RTLIL::SigSpec, RTLIL::Const>(lhs, rhs.as_const()));
 		}
 
 		if (shows.size() == 0) {
@@ -473,6 +636,35 @@ struct EvalPass : public Pass {
 					shows.push_back(it.second->name.str());
 		}
 
+		if (!vectors_file.empty())
+		{
+			for (auto &it : shows) {
+				RTLIL::SigSpec sig;
+				if (!RTLIL::SigSpec::parse_sel(sig, design, module, it))
+					log_cmd_error("Failed to parse show expression `%s'.\n", it.c_str());
+				vectors_worker.shows.push_back(sig);
+			}
+
+			for (auto &it : tables) {
+				RTLIL::SigSpec sig;
+				if (!RTLIL::SigSpec::parse_sel(sig, design, module, it))
+					log_cmd_error("Failed to parse table expression `%s'.\n", it.c_str());
+				vectors_worker.columns.push_back(sig);
+			}
+
+			if (tables.empty()) {
+				module->fixup_ports();
+				for (auto &port : module->ports)
+					if (module->wire(port)->port_input)
+						vectors_worker.columns.push_back(module->wire(port));
+			}
+
+			vectors_worker.set_undef = set_undef;
+			vectors_worker.read_vectors(vectors_file);
+			vectors_worker.run();
+			return;
+		}
+
 		if (tables.empty())
 		{
 			for (auto &it : shows) {
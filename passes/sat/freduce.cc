@@ -23,6 +23,7 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/satgen.h"
+#include "kernel/aigsim.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -31,8 +32,9 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-bool inv_mode;
+bool inv_mode, sim_mode;
 int verbose_level, reduce_counter, reduce_stop_at;
+int sim_buckets_in, sim_buckets_out;
 typedef std::map<RTLIL::SigBit, std::pair<RTLIL::Cell*, std::set<RTLIL::SigBit>>> drivers_t;
 std::string dump_prefix;
 
@@ -229,6 +231,7 @@ struct PerformReduction
 	SigMap &sigmap;
 	drivers_t &drivers;
 	std::set<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &inv_pairs;
+	const AigSim *sim;
 	pool<SigBit> recursion_guard;
 
 	ezSatPtr ez;
@@ -278,8 +281,8 @@ struct PerformReduction
 		return sigdepth.at(out);
 	}
 
-	PerformReduction(SigMap &sigmap, drivers_t &drivers, std::set<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &inv_pairs, std::vector<RTLIL::SigBit> &bits, int cone_size) :
-			sigmap(sigmap), drivers(drivers), inv_pairs(inv_pairs), satgen(ez.get(), &sigmap), out_bits(bits), cone_size(cone_size)
+	PerformReduction(SigMap &sigmap, drivers_t &drivers, std::set<std::pair<RTLIL::SigBit, RTLIL::SigBit>> &inv_pairs, const AigSim *sim, std::vector<RTLIL::SigBit> &bits, int cone_size) :
+			sigmap(sigmap), drivers(drivers), inv_pairs(inv_pairs), sim(sim), satgen(ez.get(), &sigmap), out_bits(bits), cone_size(cone_size)
 	{
 		satgen.model_undef = true;
 
@@ -487,15 +490,57 @@ struct PerformReduction
 		}
 	}
 
+	// split the bucket by the values in the random simulation before using SAT. signals
+	// without simulation values (e.g. driven by a $mul cell) go into all the new buckets.
+	void sim_split(std::vector<std::vector<int>> &new_buckets, std::vector<int> &bucket)
+	{
+		std::map<std::vector<uint64_t>, std::vector<int>> sim_buckets;
+		std::vector<int> unknown_bits;
+
+		for (int idx : bucket) {
+			const uint64_t *value = sim->value(out_bits[idx]);
+			if (value == NULL) {
+				unknown_bits.push_back(idx);
+				continue;
+			}
+			std::vector<uint64_t> key(value, value + sim->num_words);
+			if (out_inverted[idx])
+				for (auto &word : key)
+					word = ~word;
+			sim_buckets[key].push_back(idx);
+		}
+
+		for (auto &it : sim_buckets) {
+			new_buckets.push_back(it.second);
+			new_buckets.back().insert(new_buckets.back().end(), unknown_bits.begin(), unknown_bits.end());
+		}
+		if (sim_buckets.empty())
+			new_buckets.push_back(unknown_bits);
+
+		if (verbose_level >= 1)
+			log("  Random simulation split bucket with %d signals (%d without simulation value) into %d buckets.\n",
+					GetSize(bucket), GetSize(unknown_bits), GetSize(new_buckets));
+
+		sim_buckets_in++;
+		sim_buckets_out += GetSize(new_buckets);
+	}
+
 	void analyze(std::vector<std::vector<equiv_bit_t>> &results, int perc)
 	{
 		std::vector<int> bucket;
 		for (size_t i = 0; i < sat_out.size(); i++)
 			bucket.push_back(i);
 
+		std::vector<std::vector<int>> buckets;
+		if (sim != NULL)
+			sim_split(buckets, bucket);
+		else
+			buckets.push_back(bucket);
+
 		std::vector<std::set<int>> results_buf;
 		std::map<int, int> results_map;
-		analyze(results_buf, results_map, bucket, stringf("[%2d%%] %d ", perc, cone_size), "");
+		for (auto &b : buckets)
+			analyze(results_buf, results_map, b, stringf("[%2d%%] %d ", perc, cone_size), "");
 
 		for (auto &r : results_buf)
 		{
@@ -665,6 +710,18 @@ struct FreduceWorker
 		}
 		log("  Sorted %d signal bits into %d buckets.\n", bits_count, int(buckets.size()));
 
+		AigSim *sim = NULL;
+		if (sim_mode) {
+			sim = new AigSim(sigmap);
+			for (auto &it : module->cells_)
+				if (ct.cell_known(it.second->type))
+					sim->add_cell(it.second);
+			sim->run();
+			if (verbose_level >= 1)
+				log("  Simulated %d random patterns on %d cells (%d AIG nodes, %d cells without AIG model).\n",
+						sim->num_patterns(), sim->num_simulated_cells, int(sim->num_aig_nodes), sim->num_unsupported_cells);
+		}
+
 		int bucket_count = 0;
 		std::vector<std::vector<equiv_bit_t>> equiv;
 		for (auto &bucket : buckets)
@@ -676,16 +733,18 @@ struct FreduceWorker
 
 			if (bucket.first.size() == 0) {
 				log("  Finding const values for bucket %s%c\n", log_signal(bucket.second), verbose_level ? ':' : '.');
-				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.second, bucket.first.size());
+				PerformReduction worker(sigmap, drivers, inv_pairs, sim, bucket.second, bucket.first.size());
 				for (size_t idx = 0; idx < bucket.second.size(); idx++)
 					worker.analyze_const(equiv, idx);
 			} else {
 				log("  Trying to shatter bucket %s%c\n", log_signal(bucket.second), verbose_level ? ':' : '.');
-				PerformReduction worker(sigmap, drivers, inv_pairs, bucket.second, bucket.first.size());
+				PerformReduction worker(sigmap, drivers, inv_pairs, sim, bucket.second, bucket.first.size());
 				worker.analyze(equiv, 100 * bucket_count / (buckets.size() + 1));
 			}
 		}
 
+		delete sim;
+
 		std::map<RTLIL::SigBit, int> bitusage;
 		module->rewrite_sigspecs(CountBitUsage(sigmap, bitusage));
 
@@ -723,6 +782,7 @@ struct FreduceWorker
 				for (auto &port : drv->connections_)
 					if (ct.cell_output(drv->type, port.first))
 						sigmap(port.second).replace(grp[i].bit, dummy_wire, &port.second);
+				module->invalidate_caches();
 
 				if (grp[i].inverted)
 				{
@@ -779,6 +839,10 @@ struct FreducePass : public Pass {
 		log("        stop after <n> reduction operations. this is mostly used for\n");
 		log("        debugging the freduce command itself.\n");
 		log("\n");
+		log("    -nosim\n");
+		log("        don't split the candidate groups using random simulation (of 256\n");
+		log("        patterns) before using the SAT solver.\n");
+		log("\n");
 		log("    -dump <prefix>\n");
 		log("        dump the design to <prefix>_<module>_<num>.il after each reduction\n");
 		log("        operation. this is mostly used for debugging the freduce command.\n");
@@ -796,6 +860,9 @@ struct FreducePass : public Pass {
 		reduce_stop_at = 0;
 		verbose_level = 0;
 		inv_mode = false;
+		sim_mode = true;
+		sim_buckets_in = 0;
+		sim_buckets_out = 0;
 		dump_prefix = std::string();
 
 		log_header("Executing FREDUCE pass (perform functional reduction).\n");
@@ -814,6 +881,10 @@ struct FreducePass : public Pass {
 				inv_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-nosim") {
+				sim_mode = false;
+				continue;
+			}
 			if (args[argidx] == "-stop" && argidx+1 < args.size()) {
 				reduce_stop_at = atoi(args[++argidx].c_str());
 				continue;
@@ -833,6 +904,8 @@ struct FreducePass : public Pass {
 				bitcount += FreduceWorker(design, module).run();
 		}
 
+		if (verbose_level >= 1 && sim_mode)
+			log("Random simulation split %d buckets into %d buckets.\n", sim_buckets_in, sim_buckets_out);
 		log("Rewired a total of %d signal bits.\n", bitcount);
 	}
 } FreducePass;
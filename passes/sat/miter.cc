@@ -24,13 +24,330 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+struct MiterEquivWorker
+{
+	RTLIL::Design *design;
+	bool flag_ignore_gold_x, flag_make_outputs, flag_make_outcmp, flag_make_assert, flag_flatten;
+
+	// miters created by create_hier_miter() for pairs of gold/gate modules,
+	// in the order they were created (bottom-up)
+	dict<std::pair<RTLIL::IdString, RTLIL::IdString>, RTLIL::IdString> pair_miters;
+	std::vector<RTLIL::IdString> miter_order;
+
+	MiterEquivWorker(RTLIL::Design *design) : design(design), flag_ignore_gold_x(false), flag_make_outputs(false),
+			flag_make_outcmp(false), flag_make_assert(false), flag_flatten(false) { }
+
+	RTLIL::Module *create_miter(RTLIL::Module *gold_module, RTLIL::Module *gate_module, RTLIL::IdString miter_name)
+	{
+		RTLIL::IdString gold_name = gold_module->name;
+		RTLIL::IdString gate_name = gate_module->name;
+
+		for (auto &it : gold_module->wires_) {
+			RTLIL::Wire *w1 = it.second, *w2;
+			if (w1->port_id == 0)
+				continue;
+			if (gate_module->wires_.count(it.second->name) == 0)
+				goto match_gold_port_error;
+			w2 = gate_module->wires_.at(it.second->name);
+			if (w1->port_input != w2->port_input)
+				goto match_gold_port_error;
+			if (w1->port_output != w2->port_output)
+				goto match_gold_port_error;
+			if (w1->width != w2->width)
+				goto match_gold_port_error;
+			continue;
+		match_gold_port_error:
+			log_cmd_error("No matching port in gate module was found for %s!\n", it.second->name.c_str());
+		}
+
+		for (auto &it : gate_module->wires_) {
+			RTLIL::Wire *w1 = it.second, *w2;
+			if (w1->port_id == 0)
+				continue;
+			if (gold_module->wires_.count(it.second->name) == 0)
+				goto match_gate_port_error;
+			w2 = gold_module->wires_.at(it.second->name);
+			if (w1->port_input != w2->port_input)
+				goto match_gate_port_error;
+			if (w1->port_output != w2->port_output)
+				goto match_gate_port_error;
+			if (w1->width != w2->width)
+				goto match_gate_port_error;
+			continue;
+		match_gate_port_error:
+			log_cmd_error("No matching port in gold module was found for %s!\n", it.second->name.c_str());
+		}
+
+		log("Creating miter cell \"%s\" with gold cell \"%s\" and gate cell \"%s\".\n", RTLIL::id2cstr(miter_name), RTLIL::id2cstr(gold_name), RTLIL::id2cstr(gate_name));
+
+		RTLIL::Module *miter_module = new RTLIL::Module;
+		miter_module->name = miter_name;
+		design->add(miter_module);
+
+		RTLIL::Cell *gold_cell = miter_module->addCell("\\gold", gold_name);
+		RTLIL::Cell *gate_cell = miter_module->addCell("\\gate", gate_name);
+
+		RTLIL::SigSpec all_conditions;
+
+		for (auto &it : gold_module->wires_)
+		{
+			RTLIL::Wire *w1 = it.second;
+
+			if (w1->port_input)
+			{
+				RTLIL::Wire *w2 = miter_module->addWire("\\in_" + RTLIL::unescape_id(w1->name), w1->width);
+				w2->port_input = true;
+
+				gold_cell->setPort(w1->name, w2);
+				gate_cell->setPort(w1->name, w2);
+			}
+
+			if (w1->port_output)
+			{
+				RTLIL::Wire *w2_gold = miter_module->addWire("\\gold_" + RTLIL::unescape_id(w1->name), w1->width);
+				w2_gold->port_output = flag_make_outputs;
+
+				RTLIL::Wire *w2_gate = miter_module->addWire("\\gate_" + RTLIL::unescape_id(w1->name), w1->width);
+				w2_gate->port_output = flag_make_outputs;
+
+				gold_cell->setPort(w1->name, w2_gold);
+				gate_cell->setPort(w1->name, w2_gate);
+
+				RTLIL::SigSpec this_condition;
+
+				if (flag_ignore_gold_x)
+				{
+					RTLIL::SigSpec gold_x = miter_module->addWire(NEW_ID, w2_gold->width);
+					for (int i = 0; i < w2_gold->width; i++) {
+						RTLIL::Cell *eqx_cell = miter_module->addCell(NEW_ID, "$eqx");
+						eqx_cell->parameters["\\A_WIDTH"] = 1;
+						eqx_cell->parameters["\\B_WIDTH"] = 1;
+						eqx_cell->parameters["\\Y_WIDTH"] = 1;
+						eqx_cell->parameters["\\A_SIGNED"] = 0;
+						eqx_cell->parameters["\\B_SIGNED"] = 0;
+						eqx_cell->setPort("\\A", RTLIL::SigSpec(w2_gold, i));
+						eqx_cell->setPort("\\B", RTLIL::State::Sx);
+						eqx_cell->setPort("\\Y", gold_x.extract(i, 1));
+					}
+
+					RTLIL::SigSpec gold_masked = miter_module->addWire(NEW_ID, w2_gold->width);
+					RTLIL::SigSpec gate_masked = miter_module->addWire(NEW_ID, w2_gate->width);
+
+					RTLIL::Cell *or_gold_cell = miter_module->addCell(NEW_ID, "$or");
+					or_gold_cell->parameters["\\A_WIDTH"] = w2_gold->width;
+					or_gold_cell->parameters["\\B_WIDTH"] = w2_gold->width;
+					or_gold_cell->parameters["\\Y_WIDTH"] = w2_gold->width;
+					or_gold_cell->parameters["\\A_SIGNED"] = 0;
+					or_gold_cell->parameters["\\B_SIGNED"] = 0;
+					or_gold_cell->setPort("\\A", w2_gold);
+					or_gold_cell->setPort("\\B", gold_x);
+					or_gold_cell->setPort("\\Y", gold_masked);
+
+					RTLIL::Cell *or_gate_cell = miter_module->addCell(NEW_ID, "$or");
+					or_gate_cell->parameters["\\A_WIDTH"] = w2_gate->width;
+					or_gate_cell->parameters["\\B_WIDTH"] = w2_gate->width;
+					or_gate_cell->parameters["\\Y_WIDTH"] = w2_gate->width;
+					or_gate_cell->parameters["\\A_SIGNED"] = 0;
+					or_gate_cell->parameters["\\B_SIGNED"] = 0;
+					or_gate_cell->setPort("\\A", w2_gate);
+					or_gate_cell->setPort("\\B", gold_x);
+					or_gate_cell->setPort("\\Y", gate_masked);
+
+					RTLIL::Cell *eq_cell = miter_module->addCell(NEW_ID, "$eqx");
+					eq_cell->parameters["\\A_WIDTH"] = w2_gold->width;
+					eq_cell->parameters["\\B_WIDTH"] = w2_gate->width;
+					eq_cell->parameters["\\Y_WIDTH"] = 1;
+					eq_cell->parameters["\\A_SIGNED"] = 0;
+					eq_cell->parameters["\\B_SIGNED"] = 0;
+					eq_cell->setPort("\\A", gold_masked);
+					eq_cell->setPort("\\B", gate_masked);
+					eq_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
+					this_condition = eq_cell->getPort("\\Y");
+				}
+				else
+				{
+					RTLIL::Cell *eq_cell = miter_module->addCell(NEW_ID, "$eqx");
+					eq_cell->parameters["\\A_WIDTH"] = w2_gold->width;
+					eq_cell->parameters["\\B_WIDTH"] = w2_gate->width;
+					eq_cell->parameters["\\Y_WIDTH"] = 1;
+					eq_cell->parameters["\\A_SIGNED"] = 0;
+					eq_cell->parameters["\\B_SIGNED"] = 0;
+					eq_cell->setPort("\\A", w2_gold);
+					eq_cell->setPort("\\B", w2_gate);
+					eq_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
+					this_condition = eq_cell->getPort("\\Y");
+				}
+
+				if (flag_make_outcmp)
+				{
+					RTLIL::Wire *w_cmp = miter_module->addWire("\\cmp_" + RTLIL::unescape_id(w1->name));
+					w_cmp->port_output = true;
+					miter_module->connect(RTLIL::SigSig(w_cmp, this_condition));
+				}
+
+				all_conditions.append(this_condition);
+			}
+		}
+
+		if (all_conditions.size() != 1) {
+			RTLIL::Cell *reduce_cell = miter_module->addCell(NEW_ID, "$reduce_and");
+			reduce_cell->parameters["\\A_WIDTH"] = all_conditions.size();
+			reduce_cell->parameters["\\Y_WIDTH"] = 1;
+			reduce_cell->parameters["\\A_SIGNED"] = 0;
+			reduce_cell->setPort("\\A", all_conditions);
+			reduce_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
+			all_conditions = reduce_cell->getPort("\\Y");
+		}
+
+		if (flag_make_assert) {
+			RTLIL::Cell *assert_cell = miter_module->addCell(NEW_ID, "$assert");
+			assert_cell->setPort("\\A", all_conditions);
+			assert_cell->setPort("\\EN", RTLIL::SigSpec(1, 1));
+		}
+
+		RTLIL::Wire *w_trigger = miter_module->addWire("\\trigger");
+		w_trigger->port_output = true;
+
+		RTLIL::Cell *not_cell = miter_module->addCell(NEW_ID, "$not");
+		not_cell->parameters["\\A_WIDTH"] = all_conditions.size();
+		not_cell->parameters["\\A_WIDTH"] = all_conditions.size();
+		not_cell->parameters["\\Y_WIDTH"] = w_trigger->width;
+		not_cell->parameters["\\A_SIGNED"] = 0;
+		not_cell->setPort("\\A", all_conditions);
+		not_cell->setPort("\\Y", w_trigger);
+
+		miter_module->fixup_ports();
+
+		if (flag_flatten) {
+			log_push();
+			Pass::call_on_module(design, miter_module, "flatten; opt_expr -keepdc -undriven;;");
+			log_pop();
+		}
+
+		return miter_module;
+	}
+
+	bool ports_match(RTLIL::Module *gold_module, RTLIL::Module *gate_module)
+	{
+		if (GetSize(gold_module->ports) != GetSize(gate_module->ports))
+			return false;
+		for (auto port : gold_module->ports) {
+			RTLIL::Wire *w1 = gold_module->wire(port);
+			RTLIL::Wire *w2 = gate_module->wire(port);
+			if (w2 == nullptr || w1->port_input != w2->port_input || w1->port_output != w2->port_output || w1->width != w2->width)
+				return false;
+		}
+		return true;
+	}
+
+	// Replace a submodule instance by ports of the module: the instance's
+	// inputs become outputs of the module (compared by the miter) and its
+	// outputs become inputs (shared by gold and gate).
+	void cut_instance(RTLIL::Module *module, RTLIL::Cell *cell)
+	{
+		RTLIL::Module *submod = design->module(cell->type);
+
+		for (auto port : submod->ports)
+		{
+			RTLIL::Wire *port_wire = submod->wire(port);
+			RTLIL::Wire *w = module->addWire(stringf("\\%s.%s", RTLIL::unescape_id(cell->name).c_str(),
+					RTLIL::unescape_id(port).c_str()), port_wire->width);
+
+			RTLIL::SigSpec sig;
+			if (cell->hasPort(port))
+				sig = cell->getPort(port);
+
+			if (port_wire->port_input) {
+				sig.extend_u0(port_wire->width);
+				w->port_output = true;
+				module->connect(w, sig);
+			} else {
+				if (GetSize(sig) > port_wire->width)
+					sig = sig.extract(0, port_wire->width);
+				w->port_input = true;
+				module->connect(sig, RTLIL::SigSpec(w).extract(0, GetSize(sig)));
+			}
+		}
+
+		module->remove(cell);
+	}
+
+	// Build a miter for the pair of modules without flattening the instances
+	// that correspond in both: instances with the same name in gold and gate
+	// whose modules have the same interface are cut out of the miter. A miter
+	// for the pair of submodules is created first (unless both instantiate
+	// the same module) and is reused for every further instance of the pair.
+	// Everything else is flattened.
+	RTLIL::IdString create_hier_miter(RTLIL::Module *gold_module, RTLIL::Module *gate_module, RTLIL::IdString miter_name)
+	{
+		std::vector<RTLIL::IdString> cut_cells;
+
+		if (design->module(miter_name) != nullptr)
+			log_cmd_error("There is already a module %s!\n", miter_name.c_str());
+
+		for (auto gold_cell : gold_module->cells())
+		{
+			RTLIL::Cell *gate_cell = gate_module->cell(gold_cell->name);
+			if (gate_cell == nullptr)
+				continue;
+
+			RTLIL::Module *gold_submod = design->module(gold_cell->type);
+			RTLIL::Module *gate_submod = design->module(gate_cell->type);
+			if (gold_submod == nullptr || gate_submod == nullptr)
+				continue;
+			if (gold_submod->get_bool_attribute("\\blackbox") || gate_submod->get_bool_attribute("\\blackbox"))
+				continue;
+			if (!ports_match(gold_submod, gate_submod))
+				continue;
+
+			auto key = std::make_pair(gold_submod->name, gate_submod->name);
+			if (gold_submod != gate_submod && pair_miters.count(key) == 0) {
+				RTLIL::IdString submiter_name = stringf("%s_%s", miter_name.c_str(), RTLIL::unescape_id(gold_submod->name).c_str());
+				if (design->module(submiter_name) != nullptr)
+					submiter_name = stringf("%s_%s", submiter_name.c_str(), RTLIL::unescape_id(gate_submod->name).c_str());
+				pair_miters[key] = create_hier_miter(gold_submod, gate_submod, submiter_name);
+			}
+
+			cut_cells.push_back(gold_cell->name);
+		}
+
+		if (cut_cells.empty()) {
+			create_miter(gold_module, gate_module, miter_name);
+		} else {
+			log("Cutting %d corresponding submodule instances from %s and %s.\n", GetSize(cut_cells), log_id(gold_module), log_id(gate_module));
+
+			RTLIL::Module *gold_copy = gold_module->clone();
+			RTLIL::Module *gate_copy = gate_module->clone();
+			gold_copy->name = NEW_ID;
+			gate_copy->name = NEW_ID;
+			design->add(gold_copy);
+			design->add(gate_copy);
+
+			for (auto name : cut_cells) {
+				cut_instance(gold_copy, gold_copy->cell(name));
+				cut_instance(gate_copy, gate_copy->cell(name));
+			}
+			gold_copy->fixup_ports();
+			gate_copy->fixup_ports();
+
+			bool orig_flatten = flag_flatten;
+			flag_flatten = true;
+			create_miter(gold_copy, gate_copy, miter_name);
+			flag_flatten = orig_flatten;
+
+			design->remove(gold_copy);
+			design->remove(gate_copy);
+		}
+
+		miter_order.push_back(miter_name);
+		return miter_name;
+	}
+};
+
 void create_miter_equiv(struct Pass *that, std::vector<std::string> args, RTLIL::Design *design)
 {
-	bool flag_ignore_gold_x = false;
-	bool flag_make_outputs = false;
-	bool flag_make_outcmp = false;
-	bool flag_make_assert = false;
-	bool flag_flatten = false;
+	MiterEquivWorker worker(design);
+	bool flag_hier = false;
 
 	log_header("Executing MITER pass (creating miter circuit).\n");
 
@@ -38,23 +355,27 @@ void create_miter_equiv(struct Pass *that, std::vector<std::string> args, RTLIL:
 	for (argidx = 2; argidx < args.size(); argidx++)
 	{
 		if (args[argidx] == "-ignore_gold_x") {
-			flag_ignore_gold_x = true;
+			worker.flag_ignore_gold_x = true;
 			continue;
 		}
 		if (args[argidx] == "-make_outputs") {
-			flag_make_outputs = true;
+			worker.flag_make_outputs = true;
 			continue;
 		}
 		if (args[argidx] == "-make_outcmp") {
-			flag_make_outcmp = true;
+			worker.flag_make_outcmp = true;
 			continue;
 		}
 		if (args[argidx] == "-make_assert") {
-			flag_make_assert = true;
+			worker.flag_make_assert = true;
 			continue;
 		}
 		if (args[argidx] == "-flatten") {
-			flag_flatten = true;
+			worker.flag_flatten = true;
+			continue;
+		}
+		if (args[argidx] == "-hier") {
+			flag_hier = true;
 			continue;
 		}
 		break;
@@ -76,187 +397,15 @@ void create_miter_equiv(struct Pass *that, std::vector<std::string> args, RTLIL:
 	RTLIL::Module *gold_module = design->modules_.at(gold_name);
 	RTLIL::Module *gate_module = design->modules_.at(gate_name);
 
-	for (auto &it : gold_module->wires_) {
-		RTLIL::Wire *w1 = it.second, *w2;
-		if (w1->port_id == 0)
-			continue;
-		if (gate_module->wires_.count(it.second->name) == 0)
-			goto match_gold_port_error;
-		w2 = gate_module->wires_.at(it.second->name);
-		if (w1->port_input != w2->port_input)
-			goto match_gold_port_error;
-		if (w1->port_output != w2->port_output)
-			goto match_gold_port_error;
-		if (w1->width != w2->width)
-			goto match_gold_port_error;
-		continue;
-	match_gold_port_error:
-		log_cmd_error("No matching port in gate module was found for %s!\n", it.second->name.c_str());
-	}
-
-	for (auto &it : gate_module->wires_) {
-		RTLIL::Wire *w1 = it.second, *w2;
-		if (w1->port_id == 0)
-			continue;
-		if (gold_module->wires_.count(it.second->name) == 0)
-			goto match_gate_port_error;
-		w2 = gold_module->wires_.at(it.second->name);
-		if (w1->port_input != w2->port_input)
-			goto match_gate_port_error;
-		if (w1->port_output != w2->port_output)
-			goto match_gate_port_error;
-		if (w1->width != w2->width)
-			goto match_gate_port_error;
-		continue;
-	match_gate_port_error:
-		log_cmd_error("No matching port in gold module was found for %s!\n", it.second->name.c_str());
-	}
-
-	log("Creating miter cell \"%s\" with gold cell \"%s\" and gate cell \"%s\".\n", RTLIL::id2cstr(miter_name), RTLIL::id2cstr(gold_name), RTLIL::id2cstr(gate_name));
-
-	RTLIL::Module *miter_module = new RTLIL::Module;
-	miter_module->name = miter_name;
-	design->add(miter_module);
-
-	RTLIL::Cell *gold_cell = miter_module->addCell("\\gold", gold_name);
-	RTLIL::Cell *gate_cell = miter_module->addCell("\\gate", gate_name);
-
-	RTLIL::SigSpec all_conditions;
-
-	for (auto &it : gold_module->wires_)
-	{
-		RTLIL::Wire *w1 = it.second;
-
-		if (w1->port_input)
-		{
-			RTLIL::Wire *w2 = miter_module->addWire("\\in_" + RTLIL::unescape_id(w1->name), w1->width);
-			w2->port_input = true;
-
-			gold_cell->setPort(w1->name, w2);
-			gate_cell->setPort(w1->name, w2);
-		}
-
-		if (w1->port_output)
-		{
-			RTLIL::Wire *w2_gold = miter_module->addWire("\\gold_" + RTLIL::unescape_id(w1->name), w1->width);
-			w2_gold->port_output = flag_make_outputs;
-
-			RTLIL::Wire *w2_gate = miter_module->addWire("\\gate_" + RTLIL::unescape_id(w1->name), w1->width);
-			w2_gate->port_output = flag_make_outputs;
-
-			gold_cell->setPort(w1->name, w2_gold);
-			gate_cell->setPort(w1->name, w2_gate);
-
-			RTLIL::SigSpec this_condition;
-
-			if (flag_ignore_gold_x)
-			{
-				RTLIL::SigSpec gold_x = miter_module->addWire(NEW_ID, w2_gold->width);
-				for (int i = 0; i < w2_gold->width; i++) {
-					RTLIL::Cell *eqx_cell = miter_module->addCell(NEW_ID, "$eqx");
-					eqx_cell->parameters["\\A_WIDTH"] = 1;
-					eqx_cell->parameters["\\B_WIDTH"] = 1;
-					eqx_cell->parameters["\\Y_WIDTH"] = 1;
-					eqx_cell->parameters["\\A_SIGNED"] = 0;
-					eqx_cell->parameters["\\B_SIGNED"] = 0;
-					eqx_cell->setPort("\\A", RTLIL::SigSpec(w2_gold, i));
-					eqx_cell->setPort("\\B", RTLIL::State::Sx);
-					eqx_cell->setPort("\\Y", gold_x.extract(i, 1));
-				}
-
-				RTLIL::SigSpec gold_masked = miter_module->addWire(NEW_ID, w2_gold->width);
-				RTLIL::SigSpec gate_masked = miter_module->addWire(NEW_ID, w2_gate->width);
-
-				RTLIL::Cell *or_gold_cell = miter_module->addCell(NEW_ID, "$or");
-				or_gold_cell->parameters["\\A_WIDTH"] = w2_gold->width;
-				or_gold_cell->parameters["\\B_WIDTH"] = w2_gold->width;
-				or_gold_cell->parameters["\\Y_WIDTH"] = w2_gold->width;
-				or_gold_cell->parameters["\\A_SIGNED"] = 0;
-				or_gold_cell->parameters["\\B_SIGNED"] = 0;
-				or_gold_cell->setPort("\\A", w2_gold);
-				or_gold_cell->setPort("\\B", gold_x);
-				or_gold_cell->setPort("\\Y", gold_masked);
-
-				RTLIL::Cell *or_gate_cell = miter_module->addCell(NEW_ID, "$or");
-				or_gate_cell->parameters["\\A_WIDTH"] = w2_gate->width;
-				or_gate_cell->parameters["\\B_WIDTH"] = w2_gate->width;
-				or_gate_cell->parameters["\\Y_WIDTH"] = w2_gate->width;
-				or_gate_cell->parameters["\\A_SIGNED"] = 0;
-				or_gate_cell->parameters["\\B_SIGNED"] = 0;
-				or_gate_cell->setPort("\\A", w2_gate);
-				or_gate_cell->setPort("\\B", gold_x);
-				or_gate_cell->setPort("\\Y", gate_masked);
-
-				RTLIL::Cell *eq_cell = miter_module->addCell(NEW_ID, "$eqx");
-				eq_cell->parameters["\\A_WIDTH"] = w2_gold->width;
-				eq_cell->parameters["\\B_WIDTH"] = w2_gate->width;
-				eq_cell->parameters["\\Y_WIDTH"] = 1;
-				eq_cell->parameters["\\A_SIGNED"] = 0;
-				eq_cell->parameters["\\B_SIGNED"] = 0;
-				eq_cell->setPort("\\A", gold_masked);
-				eq_cell->setPort("\\B", gate_masked);
-				eq_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
-				this_condition = eq_cell->getPort("\\Y");
-			}
-			else
-			{
-				RTLIL::Cell *eq_cell = miter_module->addCell(NEW_ID, "$eqx");
-				eq_cell->parameters["\\A_WIDTH"] = w2_gold->width;
-				eq_cell->parameters["\\B_WIDTH"] = w2_gate->width;
-				eq_cell->parameters["\\Y_WIDTH"] = 1;
-				eq_cell->parameters["\\A_SIGNED"] = 0;
-				eq_cell->parameters["\\B_SIGNED"] = 0;
-				eq_cell->setPort("\\A", w2_gold);
-				eq_cell->setPort("\\B", w2_gate);
-				eq_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
-				this_condition = eq_cell->getPort("\\Y");
-			}
-
-			if (flag_make_outcmp)
-			{
-				RTLIL::Wire *w_cmp = miter_module->addWire("\\cmp_" + RTLIL::unescape_id(w1->name));
-				w_cmp->port_output = true;
-				miter_module->connect(RTLIL::SigSig(w_cmp, this_condition));
-			}
-
-			all_conditions.append(this_condition);
+	if (flag_hier) {
+		worker.create_hier_miter(gold_module, gate_module, miter_name);
+		if (GetSize(worker.miter_order) > 1) {
+			log("Created %d miter circuits, to be proven in this order:\n", GetSize(worker.miter_order));
+			for (auto name : worker.miter_order)
+				log("  %s\n", log_id(name));
 		}
-	}
-
-	if (all_conditions.size() != 1) {
-		RTLIL::Cell *reduce_cell = miter_module->addCell(NEW_ID, "$reduce_and");
-		reduce_cell->parameters["\\A_WIDTH"] = all_conditions.size();
-		reduce_cell->parameters["\\Y_WIDTH"] = 1;
-		reduce_cell->parameters["\\A_SIGNED"] = 0;
-		reduce_cell->setPort("\\A", all_conditions);
-		reduce_cell->setPort("\\Y", miter_module->addWire(NEW_ID));
-		all_conditions = reduce_cell->getPort("\\Y");
-	}
-
-	if (flag_make_assert) {
-		RTLIL::Cell *assert_cell = miter_module->addCell(NEW_ID, "$assert");
-		assert_cell->setPort("\\A", all_conditions);
-		assert_cell->setPort("\\EN", RTLIL::SigSpec(1, 1));
-	}
-
-	RTLIL::Wire *w_trigger = miter_module->addWire("\\trigger");
-	w_trigger->port_output = true;
-
-	RTLIL::Cell *not_cell = miter_module->addCell(NEW_ID, "$not");
-	not_cell->parameters["\\A_WIDTH"] = all_conditions.size();
-	not_cell->parameters["\\A_WIDTH"] = all_conditions.size();
-	not_cell->parameters["\\Y_WIDTH"] = w_trigger->width;
-	not_cell->parameters["\\A_SIGNED"] = 0;
-	not_cell->setPort("\\A", all_conditions);
-	not_cell->setPort("\\Y", w_trigger);
-
-	miter_module->fixup_ports();
-
-	if (flag_flatten) {
-		log_push();
-		Pass::call_on_module(design, miter_module, "flatten; opt_expr -keepdc -undriven;;");
-		log_pop();
-	}
+	} else
+		worker.create_miter(gold_module, gate_module, miter_name);
 }
 
 void create_miter_assert(struct Pass *that, std::vector<std::string> args, RTLIL::Design *design)
@@ -363,6 +512,15 @@ struct MiterPass : public Pass {
 		log("    -flatten\n");
 		log("        call 'flatten; opt_expr -keepdc -undriven;;' on the miter circuit.\n");
 		log("\n");
+		log("    -hier\n");
+		log("        do not flatten submodule instances that correspond in gold and gate.\n");
+		log("        Instances with the same name whose modules have the same interface\n");
+		log("        are cut from the miter: their inputs are compared like outputs and\n");
+		log("        their outputs become shared inputs. A separate miter is created for\n");
+		log("        each distinct pair of such modules (named <miter_name>_<module>),\n");
+		log("        recursively. If all these miters are proven, gold and gate are\n");
+		log("        equivalent. Everything else is flattened as with -flatten.\n");
+		log("\n");
 		log("\n");
 		log("    miter -assert [options] module [miter_name]\n");
 		log("\n");
@@ -27,15 +27,118 @@
 #include "kernel/sigtools.h"
 #include "kernel/log.h"
 #include "kernel/satgen.h"
+#include "kernel/vcdwriter.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <algorithm>
 #include <errno.h>
 #include <string.h>
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <sys/wait.h>
+#  define SAT_PROCESS_JOBS 1
+#endif
+
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+#ifdef SAT_PROCESS_JOBS
+// runs a solver call in a forked child process that reports a small result
+// code back through a pipe, so that the main process can work on another
+// solver instance at the same time
+struct SatProcessJob
+{
+	pid_t pid;
+	int fd, result;
+
+	SatProcessJob() : pid(-1), fd(-1), result(-1) { }
+
+	bool running() const {
+		return pid >= 0;
+	}
+
+	void start(std::function<int()> job)
+	{
+		int pipefd[2];
+		if (pipe(pipefd) != 0)
+			log_error("Failed to create pipe: %s\n", strerror(errno));
+
+		log_flush();
+		fflush(NULL);
+
+		pid = fork();
+		if (pid < 0)
+			log_error("Failed to fork worker process: %s\n", strerror(errno));
+
+		if (pid == 0)
+		{
+			close(pipefd[0]);
+			log_errfile = NULL;
+			log_files.clear();
+			log_streams.clear();
+
+			char status = 0;
+			try {
+				status = job();
+			} catch (...) {
+				_exit(1);
+			}
+			if (write(pipefd[1], &status, 1) != 1)
+				_exit(1);
+			_exit(0);
+		}
+
+		close(pipefd[1]);
+		fd = pipefd[0];
+	}
+
+	// returns the result code of the job, or -1 if it is still running (or
+	// if the child process failed without reporting a result)
+	int poll_result(bool block)
+	{
+		if (fd < 0)
+			return result;
+
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		int ret;
+		while ((ret = poll(&pfd, 1, block ? -1 : 0)) < 0 && errno == EINTR) { }
+		if (ret <= 0)
+			return -1;
+
+		char status;
+		if (read(fd, &status, 1) == 1)
+			result = status;
+		close(fd);
+		fd = -1;
+		return result;
+	}
+
+	int wait()
+	{
+		poll_result(true);
+		if (pid >= 0)
+			waitpid(pid, NULL, 0);
+		pid = -1;
+		return result;
+	}
+
+	~SatProcessJob()
+	{
+		if (pid >= 0) {
+			kill(pid, SIGKILL);
+			waitpid(pid, NULL, 0);
+		}
+		if (fd >= 0)
+			close(fd);
+	}
+};
+#endif
+
 struct SatHelper
 {
 	RTLIL::Design *design;
@@ -53,8 +156,12 @@ struct SatHelper
 	std::map<int, std::vector<std::string>> unsets_at;
 	bool prove_asserts, set_assumes;
 
+	// cone of influence pruning
+	bool prune_coi, coi_done;
+	pool<RTLIL::Cell*> coi_cells;
+
 	// undef constraints
-	bool enable_undef, set_init_def, set_init_undef, set_init_zero, ignore_unknown_cells;
+	bool enable_undef, set_init_def, set_init_undef, set_init_zero, ignore_unknown_cells, defined_bits_done;
 	std::vector<std::string> sets_def, sets_any_undef, sets_all_undef;
 	std::map<int, std::vector<std::string>> sets_def_at, sets_any_undef_at, sets_all_undef_at;
 
@@ -65,6 +172,9 @@ struct SatHelper
 	int max_timestep, timeout;
 	bool gotTimeout;
 
+	// pairs of time steps for which force_unique_state() has been called
+	std::set<std::pair<int, int>> unique_state_pairs;
+
 	SatHelper(RTLIL::Design *design, RTLIL::Module *module, bool enable_undef) :
 		design(design), module(module), sigmap(module), ct(design), satgen(ez.get(), &sigmap)
 	{
@@ -74,6 +184,9 @@ struct SatHelper
 		set_init_undef = false;
 		set_init_zero = false;
 		ignore_unknown_cells = false;
+		defined_bits_done = false;
+		prune_coi = false;
+		coi_done = false;
 		max_timestep = -1;
 		timeout = 0;
 		gotTimeout = false;
@@ -183,6 +296,85 @@ struct SatHelper
 		ez->assume(satgen.signals_eq(big_lhs, big_rhs, 1));
 	}
 
+	// Find the selected cells in the input cone of the constrained, proved
+	// and shown signals (and of the $assert and $assume cells when used).
+	// The other cells can't change the result and are not imported.
+	void setup_coi()
+	{
+		std::vector<RTLIL::SigBit> queue;
+		pool<RTLIL::SigBit> queued_bits;
+
+		auto add_sig = [&](const RTLIL::SigSpec &sig) {
+			for (auto bit : sigmap(sig))
+				if (bit.wire != nullptr && queued_bits.insert(bit).second)
+					queue.push_back(bit);
+		};
+		auto add_expr = [&](const std::string &s) {
+			RTLIL::SigSpec sig;
+			if (RTLIL::SigSpec::parse_sel(sig, design, module, s))
+				add_sig(sig);
+		};
+		auto add_pair = [&](const std::pair<std::string, std::string> &p) {
+			RTLIL::SigSpec lhs, rhs;
+			if (!RTLIL::SigSpec::parse_sel(lhs, design, module, p.first))
+				return;
+			add_sig(lhs);
+			if (RTLIL::SigSpec::parse_rhs(lhs, rhs, module, p.second))
+				add_sig(rhs);
+		};
+
+		for (auto &p : sets) add_pair(p);
+		for (auto &p : prove) add_pair(p);
+		for (auto &p : prove_x) add_pair(p);
+		for (auto &p : sets_init) add_pair(p);
+		for (auto &it : sets_at)
+			for (auto &p : it.second) add_pair(p);
+		for (auto &s : sets_def) add_expr(s);
+		for (auto &s : sets_any_undef) add_expr(s);
+		for (auto &s : sets_all_undef) add_expr(s);
+		for (auto &it : sets_def_at)
+			for (auto &s : it.second) add_expr(s);
+		for (auto &it : sets_any_undef_at)
+			for (auto &s : it.second) add_expr(s);
+		for (auto &it : sets_all_undef_at)
+			for (auto &s : it.second) add_expr(s);
+		for (auto &s : shows) add_expr(s);
+
+		dict<RTLIL::SigBit, std::vector<RTLIL::Cell*>> drivers;
+		int selected_cells = 0;
+
+		for (auto cell : module->cells()) {
+			if (!design->selected(module, cell))
+				continue;
+			selected_cells++;
+			if ((prove_asserts && cell->type == "$assert") || (set_assumes && cell->type == "$assume")) {
+				coi_cells.insert(cell);
+				for (auto &conn : cell->connections())
+					add_sig(conn.second);
+			}
+			for (auto &conn : cell->connections())
+				if (ct.cell_output(cell->type, conn.first))
+					for (auto bit : sigmap(conn.second))
+						drivers[bit].push_back(cell);
+		}
+
+		while (!queue.empty()) {
+			RTLIL::SigBit bit = queue.back();
+			queue.pop_back();
+			if (!drivers.count(bit))
+				continue;
+			for (auto cell : drivers.at(bit))
+				if (coi_cells.insert(cell).second)
+					for (auto &conn : cell->connections())
+						if (!ct.cell_output(cell->type, conn.first))
+							add_sig(conn.second);
+		}
+
+		coi_done = true;
+		log("Pruned %d of %d selected cells outside the cone of influence.\n",
+				selected_cells - GetSize(coi_cells), selected_cells);
+	}
+
 	void setup(int timestep = -1)
 	{
 		if (timestep > 0)
@@ -253,6 +445,32 @@ struct SatHelper
 		check_undef_enabled(big_lhs), check_undef_enabled(big_rhs);
 		ez->assume(satgen.signals_eq(big_lhs, big_rhs, timestep));
 
+		if (prune_coi && !coi_done)
+			setup_coi();
+
+		// the -set-def signals are defined in all time steps, unless a
+		// per-timestep undef constraint says otherwise
+		if (enable_undef && !defined_bits_done && sets_any_undef_at.empty() && sets_all_undef_at.empty())
+		{
+			pool<RTLIL::SigBit> sources;
+			for (auto &s : sets_def) {
+				RTLIL::SigSpec sig;
+				if (!RTLIL::SigSpec::parse_sel(sig, design, module, s))
+					log_cmd_error("Failed to parse set-def expression `%s'.\n", s.c_str());
+				for (auto bit : sigmap(sig))
+					sources.insert(bit);
+			}
+
+			std::vector<RTLIL::Cell*> cells;
+			for (auto cell : module->cells())
+				if (design->selected(module, cell) && (!prune_coi || coi_cells.count(cell)))
+					cells.push_back(cell);
+
+			satgen.setDefinedBits(cells, sources, set_init_def && timestep > 0);
+			defined_bits_done = true;
+			log("Found %d signal bits that are never undef.\n", GetSize(satgen.defined_bits));
+		}
+
 		// 0 = sets_def
 		// 1 = sets_any_undef
 		// 2 = sets_all_undef
@@ -320,7 +538,7 @@ struct SatHelper
 
 		int import_cell_counter = 0;
 		for (auto cell : module->cells())
-			if (design->selected(module, cell)) {
+			if (design->selected(module, cell) && (!prune_coi || coi_cells.count(cell))) {
 				// log("Import cell: %s\n", RTLIL::id2cstr(cell->name));
 				if (satgen.importCell(cell, timestep)) {
 					for (auto &p : cell->connections())
@@ -428,16 +646,97 @@ struct SatHelper
 	{
 		RTLIL::SigSpec state_signals = satgen.initial_state.export_all();
 		for (int i = timestep_from; i < timestep_to; i++)
-			ez->assume(ez->NOT(satgen.signals_eq(state_signals, state_signals, i, timestep_to)));
+			if (unique_state_pairs.insert(std::pair<int, int>(i, timestep_to)).second)
+				ez->assume(ez->NOT(satgen.signals_eq(state_signals, state_signals, i, timestep_to)));
+	}
+
+	void force_unique_state_all(int timestep_from, int timestep_to)
+	{
+		for (int i = timestep_from+1; i <= timestep_to; i++)
+			force_unique_state(timestep_from, i);
+	}
+
+	// Like solve(), with the states in the time steps timestep_from .. timestep_to
+	// forced to be different from each other. Instead of adding the constraints for
+	// all pairs of time steps (quadratic in the number of time steps), only the
+	// constraints violated by a model are added, followed by solving again.
+	bool solve_unique_state(int timestep_from, int timestep_to, int assumption)
+	{
+		RTLIL::SigSpec state_signals = satgen.initial_state.export_all();
+		int state_width = GetSize(state_signals);
+		int model_size = GetSize(modelExpressions);
+
+		for (int t = timestep_from; t <= timestep_to; t++) {
+			std::vector<int> vec = satgen.importSigSpec(state_signals, t);
+			modelExpressions.insert(modelExpressions.end(), vec.begin(), vec.end());
+			if (enable_undef) {
+				std::vector<int> undef_vec = satgen.importUndefSigSpec(state_signals, t);
+				modelExpressions.insert(modelExpressions.end(), undef_vec.begin(), undef_vec.end());
+			}
+		}
+
+		int num_added = 0;
+		bool success;
+
+		while (1)
+		{
+			success = solve(assumption);
+			if (!success)
+				break;
+
+			// same as satgen.signals_eq(): undef bits are equal regardless of their value
+			std::map<std::vector<bool>, int> state_timesteps;
+			bool found_repeated_state = false;
+			int idx = model_size;
+
+			for (int t = timestep_from; t <= timestep_to; t++)
+			{
+				std::vector<bool> state(modelValues.begin() + idx, modelValues.begin() + idx + state_width);
+				idx += state_width;
+
+				if (enable_undef) {
+					for (int i = 0; i < state_width; i++)
+						if (modelValues.at(idx + i))
+							state[i] = true;
+					state.insert(state.end(), modelValues.begin() + idx, modelValues.begin() + idx + state_width);
+					idx += state_width;
+				}
+
+				auto it = state_timesteps.find(state);
+				if (it == state_timesteps.end()) {
+					state_timesteps[state] = t;
+					continue;
+				}
+
+				log_assert(unique_state_pairs.count(std::pair<int, int>(it->second, t)) == 0);
+				force_unique_state(it->second, t);
+				found_repeated_state = true;
+				num_added++;
+			}
+
+			if (!found_repeated_state)
+				break;
+		}
+
+		if (num_added > 0)
+			log("Added %d unique state constraints (%d in total).\n", num_added, GetSize(unique_state_pairs));
+
+		modelExpressions.resize(model_size);
+		modelValues.resize(model_size);
+		return success;
 	}
 
 	bool solve(const std::vector<int> &assumptions)
 	{
 		log_assert(gotTimeout == false);
 		ez->setSolverTimeout(timeout);
+		log_count("sat.solve", 1);
 		bool success = ez->solve(modelExpressions, modelValues, assumptions);
-		if (ez->getSolverTimoutStatus())
+		if (ez->getSolverTimoutStatus()) {
+			log("SAT solver stopped after %lld conflicts and %lld propagations.\n",
+					(long long)ez->solverConflicts, (long long)ez->solverPropagations);
 			gotTimeout = true;
+		}
 		return success;
 	}
 
@@ -445,9 +744,13 @@ struct SatHelper
 	{
 		log_assert(gotTimeout == false);
 		ez->setSolverTimeout(timeout);
+		log_count("sat.solve", 1);
 		bool success = ez->solve(modelExpressions, modelValues, a, b, c, d, e, f);
-		if (ez->getSolverTimoutStatus())
+		if (ez->getSolverTimoutStatus()) {
+			log("SAT solver stopped after %lld conflicts and %lld propagations.\n",
+					(long long)ez->solverConflicts, (long long)ez->solverPropagations);
 			gotTimeout = true;
+		}
 		return success;
 	}
 
@@ -664,67 +967,34 @@ struct SatHelper
 
 		log("Dumping SAT model to VCD file %s\n", vcd_file_name.c_str());
 
-		time_t timestamp;
-		struct tm* now;
-		char stime[128] = {};
-		time(&timestamp);
-		now = localtime(&timestamp);
-		strftime(stime, sizeof(stime), "%c", now);
-
 		std::string module_fname = "unknown";
 		auto apos = module->attributes.find("\\src");
 		if(apos != module->attributes.end())
 			module_fname = module->attributes["\\src"].decode_string();
 
-		fprintf(f, "$date\n");
-		fprintf(f, "    %s\n", stime);
-		fprintf(f, "$end\n");
-		fprintf(f, "$version\n");
-		fprintf(f, "    Generated by %s\n", yosys_version_str);
-		fprintf(f, "$end\n");
-		fprintf(f, "$comment\n");
-		fprintf(f, "    Generated from SAT problem in module %s (declared at %s)\n",
-			module->name.c_str(), module_fname.c_str());
-		fprintf(f, "$end\n");
-
-		// VCD has some limits on internal (non-display) identifier names, so make legal ones
-		std::map<std::string, std::string> vcdnames;
-
-		fprintf(f, "$timescale 1ns\n"); // arbitrary time scale since actual clock period is unknown/unimportant
-		fprintf(f, "$scope module %s $end\n", module->name.c_str());
-		for (auto &info : modelInfo)
-		{
-			if (vcdnames.find(info.description) != vcdnames.end())
-				continue;
+		// arbitrary time scale since actual clock period is unknown/unimportant
+		VcdWriter vcd(f);
+		vcd.header(stringf("Generated from SAT problem in module %s (declared at %s)",
+				module->name.c_str(), module_fname.c_str()));
 
-			char namebuf[16];
-			snprintf(namebuf, sizeof(namebuf), "v%d", static_cast<int>(vcdnames.size()));
-			vcdnames[info.description] = namebuf;
-
-			// Even display identifiers can't use some special characters
-			std::string legal_desc = info.description.c_str();
-			for (auto &c : legal_desc) {
-				if(c == '$')
-					c = '_';
-				if(c == ':')
-					c = '_';
-			}
-
-			fprintf(f, "$var wire %d %s %s $end\n", info.width, namebuf, legal_desc.c_str());
+		dict<std::string, int> vcd_vars;
 
+		vcd.push_scope(module->name.str());
+		for (auto &info : modelInfo)
+		{
 			// Need to look at first *two* cycles!
 			// We need to put a name on all variables but those without an initialization clause
 			// have no value at timestep 0
-			if(info.timestep > 1)
+			if (info.timestep > 1)
 				break;
+			if (vcd_vars.count(info.description) == 0)
+				vcd_vars[info.description] = vcd.add_var(info.description, info.width);
 		}
-		fprintf(f, "$upscope $end\n");
-		fprintf(f, "$enddefinitions $end\n");
-		fprintf(f, "$dumpvars\n");
+		vcd.pop_scope();
+		vcd.end_definitions();
 
-		static const char bitvals[] = "01xzxx";
-
-		int last_timestep = -2;
+		// the values are written as they are extracted from the model, the
+		// initial state (timestep 0) and a combinational model are at time 0
 		for (auto &info : modelInfo)
 		{
 			RTLIL::Const value;
@@ -735,27 +1005,14 @@ struct SatHelper
 					value.bits.back() = RTLIL::State::Sx;
 			}
 
-			if (info.timestep != last_timestep) {
-				if(last_timestep == 0)
-					fprintf(f, "$end\n");
-				else
-					fprintf(f, "#%d\n", info.timestep);
-				last_timestep = info.timestep;
-			}
-
-			if(info.width == 1) {
-				fprintf(f, "%c%s\n", bitvals[value.bits[0]], vcdnames[info.description].c_str());
-			} else {
-				fprintf(f, "b");
-				for(int k=info.width-1; k >= 0; k --)	//need to flip bit ordering for VCD
-					fprintf(f, "%c", bitvals[value.bits[k]]);
-				fprintf(f, " %s\n", vcdnames[info.description].c_str());
-			}
+			vcd.timestep(std::max(info.timestep, 0));
+			vcd.value(vcd_vars.at(info.description), value);
 		}
 
-		if (last_timestep == -2)
+		if (modelInfo.empty())
 			log("  no model variables selected for display.\n");
 
+		vcd.flush();
 		fclose(f);
 	}
 
@@ -945,6 +1202,11 @@ struct SatPass : public Pass {
 		log("    -ignore_unknown_cells\n");
 		log("        ignore all cells that can not be matched to a SAT model\n");
 		log("\n");
+		log("    -prune\n");
+		log("        only import the cells in the input cone of the signals used in -set,\n");
+		log("        -prove, -show and similar options (and of the $assert and $assume cells\n");
+		log("        with -prove-asserts and -set-assumes)\n");
+		log("\n");
 		log("The following options can be used to set up a sequential problem:\n");
 		log("\n");
 		log("    -seq <N>\n");
@@ -997,6 +1259,10 @@ struct SatPass : public Pass {
 		log("        proven that the condition holds forever after the number of time steps\n");
 		log("        specified using -seq.\n");
 		log("\n");
+		log("        When yosys runs with more than one job (-j), the base case for each\n");
+		log("        induction length is solved in a separate process at the same time as\n");
+		log("        the induction step.\n");
+		log("\n");
 		log("    -tempinduct-def\n");
 		log("        Perform a temporal induction proof. Assume an initial state with all\n");
 		log("        registers set to defined values for the induction step.\n");
@@ -1069,7 +1335,7 @@ struct SatPass : public Pass {
 		bool tempinduct = false, prove_asserts = false, show_inputs = false, show_outputs = false;
 		bool show_regs = false, show_public = false, show_all = false;
 		bool ignore_unknown_cells = false, falsify = false, tempinduct_def = false, set_init_def = false;
-		bool tempinduct_baseonly = false, tempinduct_inductonly = false, set_assumes = false;
+		bool tempinduct_baseonly = false, tempinduct_inductonly = false, set_assumes = false, prune_coi = false;
 		int tempinduct_skip = 0, stepsize = 1;
 		std::string vcd_file_name, json_file_name, cnf_file_name;
 
@@ -1292,6 +1558,10 @@ struct SatPass : public Pass {
 				ignore_unknown_cells = true;
 				continue;
 			}
+			if (args[argidx] == "-prune") {
+				prune_coi = true;
+				continue;
+			}
 			if (args[argidx] == "-dump_vcd" && argidx+1 < args.size()) {
 				vcd_file_name = args[++argidx];
 				continue;
@@ -1400,6 +1670,7 @@ struct SatPass : public Pass {
 			basecase.set_init_zero = set_init_zero;
 			basecase.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			basecase.ignore_unknown_cells = ignore_unknown_cells;
+			basecase.prune_coi = prune_coi;
 
 			for (int timestep = 1; timestep <= seq_len; timestep++)
 				if (!tempinduct_inductonly)
@@ -1417,6 +1688,7 @@ struct SatPass : public Pass {
 			inductstep.sets_all_undef = sets_all_undef;
 			inductstep.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			inductstep.ignore_unknown_cells = ignore_unknown_cells;
+			inductstep.prune_coi = prune_coi;
 
 			if (!tempinduct_baseonly) {
 				inductstep.setup(1);
@@ -1432,12 +1704,18 @@ struct SatPass : public Pass {
 			{
 				log("\n** Trying induction with length %d **\n", inductlen);
 
+				bool induction_solved = !tempinduct_baseonly && !(inductlen <= tempinduct_skip || inductlen <= initsteps || inductlen % stepsize != 0);
+				int base_property = 0;
+#ifdef SAT_PROCESS_JOBS
+				SatProcessJob base_job;
+#endif
+
 				// phase 1: proving base case
 
 				if (!tempinduct_inductonly)
 				{
 					basecase.setup(seq_len + inductlen);
-					int property = basecase.setup_proof(seq_len + inductlen);
+					base_property = basecase.setup_proof(seq_len + inductlen);
 					basecase.generate_model();
 
 					if (basecase_setup_init) {
@@ -1445,24 +1723,28 @@ struct SatPass : public Pass {
 						basecase_setup_init = false;
 					}
 
-					if (inductlen > 1)
-						basecase.force_unique_state(seq_len + 1, seq_len + inductlen);
-
 					if (tempinduct_skip < inductlen)
 					{
 						log("\n[base case %d] Solving problem with %d variables and %d clauses..\n",
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
 
-						if (basecase.solve(basecase.ez->NOT(property))) {
-							log("SAT temporal induction proof finished - model found for base case: FAIL!\n");
-							print_proof_failed();
-							basecase.print_model();
-							if(!vcd_file_name.empty())
-								basecase.dump_model_to_vcd(vcd_file_name);
-							if(!json_file_name.empty())
-								basecase.dump_model_to_json(json_file_name);
-							goto tip_failed;
+#ifdef SAT_PROCESS_JOBS
+						// the base case and the induction step are independent problems: with
+						// -j the base case is solved in a child process, the result is checked
+						// after the induction step (see below)
+						if (yosys_jobs > 1 && induction_solved) {
+							log("[base case %d] Solving in a separate process while proving the induction step.\n", inductlen);
+							base_job.start([&]() {
+								if (basecase.solve_unique_state(seq_len + 1, seq_len + inductlen, basecase.ez->NOT(base_property)))
+									return 1;
+								return basecase.gotTimeout ? 2 : 0;
+							});
+							goto base_case_started;
 						}
+#endif
+
+						if (basecase.solve_unique_state(seq_len + 1, seq_len + inductlen, basecase.ez->NOT(base_property)))
+							goto base_failed;
 
 						if (basecase.gotTimeout)
 							goto timeout;
@@ -1476,9 +1758,10 @@ struct SatPass : public Pass {
 						log("\n[base case %d] Problem size so far: %d variables and %d clauses.\n",
 								inductlen, basecase.ez->numCnfVariables(), basecase.ez->numCnfClauses());
 					}
-					basecase.ez->assume(property);
+					basecase.ez->assume(base_property);
 				}
 
+			base_case_started:
 				// phase 2: proving induction step
 
 				if (!tempinduct_baseonly)
@@ -1487,10 +1770,7 @@ struct SatPass : public Pass {
 					int property = inductstep.setup_proof(inductlen + 1);
 					inductstep.generate_model();
 
-					if (inductlen > 1)
-						inductstep.force_unique_state(1, inductlen + 1);
-
-					if (inductlen <= tempinduct_skip || inductlen <= initsteps || inductlen % stepsize != 0)
+					if (!induction_solved)
 					{
 						if (inductlen < tempinduct_skip)
 							log("\n[induction step %d] Skipping prove for this step (-tempinduct-skip %d).",
@@ -1516,6 +1796,8 @@ struct SatPass : public Pass {
 							log("Dumping CNF to file `%s'.\n", cnf_file_name.c_str());
 							cnf_file_name.clear();
 
+							inductstep.force_unique_state_all(1, inductlen + 1);
+
 							inductstep.ez->printDIMACS(f, false);
 							fclose(f);
 						}
@@ -1523,7 +1805,50 @@ struct SatPass : public Pass {
 						log("\n[induction step %d] Solving problem with %d variables and %d clauses..\n",
 								inductlen, inductstep.ez->numCnfVariables(), inductstep.ez->numCnfClauses());
 
-						if (!inductstep.solve(inductstep.ez->NOT(property))) {
+#ifdef SAT_PROCESS_JOBS
+						// a failed (or timed out) base case makes the induction step
+						// unnecessary, so its solver is stopped as soon as the child
+						// process reports it
+						if (base_job.running())
+							inductstep.ez->solverInterrupt = [&]() { return base_job.poll_result(false) > 0; };
+#endif
+
+						bool induction_failed = inductstep.solve_unique_state(1, inductlen + 1, inductstep.ez->NOT(property));
+
+#ifdef SAT_PROCESS_JOBS
+						if (base_job.running())
+						{
+							inductstep.ez->solverInterrupt = nullptr;
+							bool induction_interrupted = inductstep.gotTimeout && base_job.poll_result(false) > 0;
+							int base_result = base_job.wait();
+
+							if (base_result == 2) {
+								log("\n[base case %d] SAT solver stopped in the separate process.\n", inductlen);
+								goto timeout;
+							}
+
+							// the model for a failed base case is found again in this process,
+							// as well as the answer when the child process died
+							if (base_result != 0) {
+								log("\n[base case %d] %s, solving again..\n", inductlen, base_result == 1 ?
+										"Model found in the separate process" : "Separate process failed");
+								if (basecase.solve_unique_state(seq_len + 1, seq_len + inductlen, basecase.ez->NOT(base_property)))
+									goto base_failed;
+								if (basecase.gotTimeout)
+									goto timeout;
+							}
+
+							log("Base case for induction length %d proven.\n", inductlen);
+							basecase.ez->assume(base_property);
+
+							if (induction_interrupted) {
+								inductstep.gotTimeout = false;
+								induction_failed = inductstep.solve_unique_state(1, inductlen + 1, inductstep.ez->NOT(property));
+							}
+						}
+#endif
+
+						if (!induction_failed) {
 							if (inductstep.gotTimeout)
 								goto timeout;
 							log("Induction step proven: SUCCESS!\n");
@@ -1550,7 +1875,17 @@ struct SatPass : public Pass {
 				inductstep.dump_model_to_json(json_file_name);
 			print_proof_failed();
 
-		tip_failed:
+			if (0) {
+		base_failed:
+				log("SAT temporal induction proof finished - model found for base case: FAIL!\n");
+				print_proof_failed();
+				basecase.print_model();
+				if(!vcd_file_name.empty())
+					basecase.dump_model_to_vcd(vcd_file_name);
+				if(!json_file_name.empty())
+					basecase.dump_model_to_json(json_file_name);
+			}
+
 			if (verify) {
 				log("\n");
 				log_error("Called with -verify and proof did fail!\n");
@@ -1570,6 +1905,12 @@ struct SatPass : public Pass {
 
 			SatHelper sathelper(design, module, enable_undef);
 
+			// a single solver call: don't freeze the variables of the model,
+			// so that the SimpSolver can eliminate them before solving
+			bool one_shot = (prove.size() || prove_x.size() || prove_asserts) && loopcount == 0 && !max_undef;
+			if (one_shot)
+				sathelper.ez->non_incremental();
+
 			sathelper.sets = sets;
 			sathelper.set_assumes = set_assumes;
 			sathelper.prove = prove;
@@ -1591,6 +1932,7 @@ struct SatPass : public Pass {
 			sathelper.set_init_zero = set_init_zero;
 			sathelper.satgen.ignore_div_by_zero = ignore_div_by_zero;
 			sathelper.ignore_unknown_cells = ignore_unknown_cells;
+			sathelper.prune_coi = prune_coi;
 
 			if (seq_len == 0) {
 				sathelper.setup();
@@ -1629,7 +1971,17 @@ struct SatPass : public Pass {
 			log("\nSolving problem with %d variables and %d clauses..\n",
 					sathelper.ez->numCnfVariables(), sathelper.ez->numCnfClauses());
 
-			if (sathelper.solve())
+			bool solved = sathelper.solve();
+
+			if (one_shot) {
+				int eliminated_vars = 0;
+				for (int idx = 1; idx <= sathelper.ez->numCnfVariables(); idx++)
+					if (sathelper.ez->eliminated(idx))
+						eliminated_vars++;
+				log("Variable elimination removed %d of %d variables.\n", eliminated_vars, sathelper.ez->numCnfVariables());
+			}
+
+			if (solved)
 			{
 				if (max_undef) {
 					log("SAT model found. maximizing number of undefs.\n");
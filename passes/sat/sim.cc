@@ -0,0 +1,794 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include "kernel/celltypes.h"
+#include "kernel/bitsim.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct SimFlipFlop
+{
+	RTLIL::Cell *cell;
+	RTLIL::SigSpec clk, en, arst, set, clr, d, q;
+	bool clk_pol, en_pol, arst_pol, set_pol, clr_pol, is_latch;
+	RTLIL::Const arst_value, state;
+	RTLIL::State last_clk;
+};
+
+struct SimMemory
+{
+	struct port_t {
+		bool clk_enable, clk_pol, transparent;
+		RTLIL::SigSpec clk, en, addr, data;
+		RTLIL::State last_clk;
+	};
+
+	RTLIL::Cell *cell;
+	int size, offset, abits, width;
+	std::vector<RTLIL::Const> words;
+	std::vector<port_t> rd_ports, wr_ports;
+};
+
+struct SimWorker
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+	BitSim sim;
+
+	std::vector<SimFlipFlop> ffs;
+	std::vector<SimMemory> mems;
+
+	bool zinit, zinput;
+	int num_cycles;
+	std::vector<RTLIL::SigSpec> clocks, clocks_n, resets, resets_n;
+	int reset_cycles;
+	std::vector<std::pair<RTLIL::SigSpec, RTLIL::Const>> sets;
+	dict<int, std::vector<std::pair<RTLIL::SigSpec, RTLIL::Const>>> sets_at;
+	std::vector<RTLIL::SigSpec> shows;
+
+	FILE *vcd_file;
+	std::vector<std::pair<RTLIL::Wire*, std::string>> vcd_wires;
+	std::vector<std::string> vcd_values;
+
+	SimWorker(RTLIL::Module *module) : module(module), sigmap(module), sim(module)
+	{
+		zinit = false;
+		zinput = false;
+		num_cycles = 20;
+		reset_cycles = 1;
+		vcd_file = NULL;
+	}
+
+	static RTLIL::State bool2state(bool value)
+	{
+		return value ? RTLIL::State::S1 : RTLIL::State::S0;
+	}
+
+	static bool is_active(RTLIL::State value, bool polarity)
+	{
+		return value == bool2state(polarity);
+	}
+
+	static bool is_edge(RTLIL::State last_value, RTLIL::State value, bool polarity)
+	{
+		return last_value == bool2state(!polarity) && value == bool2state(polarity);
+	}
+
+	RTLIL::Const get(RTLIL::SigSpec sig)
+	{
+		return sim.get(sig, 0);
+	}
+
+	void add_ff(RTLIL::Cell *cell)
+	{
+		SimFlipFlop ff;
+		ff.cell = cell;
+		ff.clk_pol = ff.en_pol = ff.arst_pol = ff.set_pol = ff.clr_pol = true;
+		ff.is_latch = false;
+		ff.last_clk = RTLIL::State::Sx;
+
+		std::string type = cell->type.str();
+
+		if (type.substr(0, 2) == "$_")
+		{
+			// fine-grained cells, the polarities are encoded in the type name
+			auto pol = [&](std::string prefix, int idx) -> char { return type.at(prefix.size() + idx); };
+
+			ff.d = cell->hasPort("\\D") ? sigmap(cell->getPort("\\D")) : RTLIL::SigSpec();
+			ff.q = sigmap(cell->getPort("\\Q"));
+
+			if (type.substr(0, 6) == "$_DFF_") {
+				ff.clk = sigmap(cell->getPort("\\C")), ff.clk_pol = pol("$_DFF_", 0) == 'P';
+				if (cell->hasPort("\\R")) {
+					ff.arst = sigmap(cell->getPort("\\R")), ff.arst_pol = pol("$_DFF_", 1) == 'P';
+					ff.arst_value = RTLIL::Const(bool2state(pol("$_DFF_", 2) == '1'), 1);
+				}
+			} else if (type.substr(0, 7) == "$_DFFE_") {
+				ff.clk = sigmap(cell->getPort("\\C")), ff.clk_pol = pol("$_DFFE_", 0) == 'P';
+				ff.en = sigmap(cell->getPort("\\E")), ff.en_pol = pol("$_DFFE_", 1) == 'P';
+			} else if (type.substr(0, 8) == "$_DFFSR_") {
+				ff.clk = sigmap(cell->getPort("\\C")), ff.clk_pol = pol("$_DFFSR_", 0) == 'P';
+				ff.set = sigmap(cell->getPort("\\S")), ff.set_pol = pol("$_DFFSR_", 1) == 'P';
+				ff.clr = sigmap(cell->getPort("\\R")), ff.clr_pol = pol("$_DFFSR_", 2) == 'P';
+			} else if (type.substr(0, 11) == "$_DLATCHSR_") {
+				ff.en = sigmap(cell->getPort("\\E")), ff.en_pol = pol("$_DLATCHSR_", 0) == 'P';
+				ff.set = sigmap(cell->getPort("\\S")), ff.set_pol = pol("$_DLATCHSR_", 1) == 'P';
+				ff.clr = sigmap(cell->getPort("\\R")), ff.clr_pol = pol("$_DLATCHSR_", 2) == 'P';
+				ff.is_latch = true;
+			} else if (type.substr(0, 9) == "$_DLATCH_") {
+				ff.en = sigmap(cell->getPort("\\E")), ff.en_pol = pol("$_DLATCH_", 0) == 'P';
+				ff.is_latch = true;
+			} else if (type.substr(0, 5) == "$_SR_") {
+				ff.set = sigmap(cell->getPort("\\S")), ff.set_pol = pol("$_SR_", 0) == 'P';
+				ff.clr = sigmap(cell->getPort("\\R")), ff.clr_pol = pol("$_SR_", 1) == 'P';
+			} else
+				log_abort();
+		}
+		else
+		{
+			ff.q = sigmap(cell->getPort("\\Q"));
+			if (cell->hasPort("\\D"))
+				ff.d = sigmap(cell->getPort("\\D"));
+			if (cell->hasPort("\\CLK"))
+				ff.clk = sigmap(cell->getPort("\\CLK")), ff.clk_pol = cell->getParam("\\CLK_POLARITY").as_bool();
+			if (cell->hasPort("\\EN"))
+				ff.en = sigmap(cell->getPort("\\EN")), ff.en_pol = cell->getParam("\\EN_POLARITY").as_bool();
+			if (cell->hasPort("\\ARST"))
+				ff.arst = sigmap(cell->getPort("\\ARST")), ff.arst_pol = cell->getParam("\\ARST_POLARITY").as_bool(),
+						ff.arst_value = cell->getParam("\\ARST_VALUE");
+			if (cell->hasPort("\\SET"))
+				ff.set = sigmap(cell->getPort("\\SET")), ff.set_pol = cell->getParam("\\SET_POLARITY").as_bool();
+			if (cell->hasPort("\\CLR"))
+				ff.clr = sigmap(cell->getPort("\\CLR")), ff.clr_pol = cell->getParam("\\CLR_POLARITY").as_bool();
+			ff.is_latch = cell->type.in("$dlatch", "$dlatchsr");
+		}
+
+		ff.state = RTLIL::Const(zinit ? RTLIL::State::S0 : RTLIL::State::Sx, GetSize(ff.q));
+		ffs.push_back(ff);
+	}
+
+	void add_mem(RTLIL::Cell *cell)
+	{
+		SimMemory mem;
+		mem.cell = cell;
+		mem.size = cell->getParam("\\SIZE").as_int();
+		mem.offset = cell->getParam("\\OFFSET").as_int();
+		mem.abits = cell->getParam("\\ABITS").as_int();
+		mem.width = cell->getParam("\\WIDTH").as_int();
+
+		RTLIL::Const init = cell->getParam("\\INIT");
+		for (int i = 0; i < mem.size; i++) {
+			RTLIL::Const word(zinit ? RTLIL::State::S0 : RTLIL::State::Sx, mem.width);
+			for (int j = 0; j < mem.width; j++)
+				if (i*mem.width + j < GetSize(init) && init.bits[i*mem.width + j] != RTLIL::State::Sx)
+					word.bits[j] = init.bits[i*mem.width + j];
+			mem.words.push_back(word);
+		}
+
+		for (int i = 0; i < cell->getParam("\\RD_PORTS").as_int(); i++) {
+			SimMemory::port_t port;
+			port.clk_enable = cell->getParam("\\RD_CLK_ENABLE").bits.at(i) == RTLIL::State::S1;
+			port.clk_pol = cell->getParam("\\RD_CLK_POLARITY").bits.at(i) == RTLIL::State::S1;
+			port.transparent = cell->getParam("\\RD_TRANSPARENT").bits.at(i) == RTLIL::State::S1;
+			port.clk = sigmap(cell->getPort("\\RD_CLK").extract(i));
+			port.en = sigmap(cell->getPort("\\RD_EN").extract(i));
+			port.addr = sigmap(cell->getPort("\\RD_ADDR").extract(i*mem.abits, mem.abits));
+			port.data = sigmap(cell->getPort("\\RD_DATA").extract(i*mem.width, mem.width));
+			port.last_clk = RTLIL::State::Sx;
+			mem.rd_ports.push_back(port);
+		}
+
+		for (int i = 0; i < cell->getParam("\\WR_PORTS").as_int(); i++) {
+			SimMemory::port_t port;
+			port.clk_enable = cell->getParam("\\WR_CLK_ENABLE").bits.at(i) == RTLIL::State::S1;
+			port.clk_pol = cell->getParam("\\WR_CLK_POLARITY").bits.at(i) == RTLIL::State::S1;
+			port.transparent = false;
+			port.clk = sigmap(cell->getPort("\\WR_CLK").extract(i));
+			port.en = sigmap(cell->getPort("\\WR_EN").extract(i*mem.width, mem.width));
+			port.addr = sigmap(cell->getPort("\\WR_ADDR").extract(i*mem.abits, mem.abits));
+			port.data = sigmap(cell->getPort("\\WR_DATA").extract(i*mem.width, mem.width));
+			port.last_clk = RTLIL::State::Sx;
+			mem.wr_ports.push_back(port);
+		}
+
+		mems.push_back(mem);
+	}
+
+	void setup()
+	{
+		CellTypes ct_comb;
+		ct_comb.setup_internals();
+		ct_comb.setup_stdcells();
+
+		CellTypes ct_stdcells_mem;
+		ct_stdcells_mem.setup_stdcells_mem();
+
+		for (auto cell : module->cells())
+		{
+			if (ct_comb.cell_known(cell->type))
+				continue;
+			if (cell->type.in("$dff", "$dffe", "$adff", "$dffsr", "$dlatch", "$dlatchsr", "$sr") ||
+					ct_stdcells_mem.cell_known(cell->type)) {
+				add_ff(cell);
+				continue;
+			}
+			if (cell->type == "$mem") {
+				add_mem(cell);
+				continue;
+			}
+			if (cell->type.in("$memrd", "$memwr", "$meminit"))
+				log_cmd_error("Unsupported cell %s (type %s) in module %s. Run 'memory_collect' first.\n",
+						log_id(cell), log_id(cell->type), log_id(module));
+			log_cmd_error("Unsupported cell %s (type %s) in module %s. Flatten the design or map the cell to supported cells first.\n",
+					log_id(cell), log_id(cell->type), log_id(module));
+		}
+
+		// initial values of FFs from the init attributes
+		dict<RTLIL::SigBit, RTLIL::State> init_bits;
+		for (auto wire : module->wires())
+			if (wire->attributes.count("\\init")) {
+				RTLIL::Const value = wire->attributes.at("\\init");
+				for (int i = 0; i < GetSize(wire) && i < GetSize(value); i++)
+					if (value.bits[i] == RTLIL::State::S0 || value.bits[i] == RTLIL::State::S1)
+						init_bits[sigmap(RTLIL::SigBit(wire, i))] = value.bits[i];
+			}
+
+		RTLIL::SigSpec targets, undef;
+
+		for (auto wire : module->wires())
+			if (wire->port_input)
+				sim.add_source(wire);
+			else if (wire->name[0] == '\\')
+				targets.append(wire);
+
+		for (auto &ff : ffs) {
+			for (int i = 0; i < GetSize(ff.q); i++)
+				if (init_bits.count(ff.q[i]))
+					ff.state.bits[i] = init_bits.at(ff.q[i]);
+			sim.add_source(ff.q);
+			targets.append(ff.clk);
+			targets.append(ff.en);
+			targets.append(ff.arst);
+			targets.append(ff.set);
+			targets.append(ff.clr);
+			targets.append(ff.d);
+		}
+
+		for (auto &mem : mems) {
+			for (auto &port : mem.rd_ports) {
+				sim.add_source(port.data);
+				targets.append(port.clk);
+				targets.append(port.en);
+				targets.append(port.addr);
+			}
+			for (auto &port : mem.wr_ports) {
+				targets.append(port.clk);
+				targets.append(port.en);
+				targets.append(port.addr);
+				targets.append(port.data);
+			}
+		}
+
+		for (auto &sig : shows)
+			targets.append(sig);
+
+		sim.compile(targets, undef);
+
+		if (!undef.empty()) {
+			undef.sort_and_unify();
+			log("Assuming undef (x) value for undriven signals: %s\n", log_signal(undef));
+		}
+
+		for (auto &ff : ffs)
+			sim.set(ff.q, 0, ff.state);
+		for (auto &mem : mems)
+			for (auto &port : mem.rd_ports)
+				sim.set(port.data, 0, RTLIL::Const(zinit ? RTLIL::State::S0 : RTLIL::State::Sx, GetSize(port.data)));
+
+		log("Compiled %d fine-grained and %d coarse combinational cells, found %d FFs and %d memories.\n",
+				sim.num_fine_cells, sim.num_coarse_cells, GetSize(ffs), GetSize(mems));
+	}
+
+	// returns -1 for addresses that are undefined or out of range
+	int mem_index(const SimMemory &mem, RTLIL::SigSpec addr)
+	{
+		RTLIL::Const value = get(addr);
+		if (!RTLIL::SigSpec(value).is_fully_def())
+			return -1;
+		int index = value.as_int() - mem.offset;
+		return 0 <= index && index < mem.size ? index : -1;
+	}
+
+	bool read_port(SimMemory &mem, SimMemory::port_t &port)
+	{
+		int index = mem_index(mem, port.addr);
+		RTLIL::Const data = index < 0 ? RTLIL::Const(RTLIL::State::Sx, mem.width) : mem.words[index];
+		if (get(port.data) == data)
+			return false;
+		sim.set(port.data, 0, data);
+		return true;
+	}
+
+	bool update_ff(SimFlipFlop &ff, const RTLIL::Const &value)
+	{
+		if (ff.state == value)
+			return false;
+		ff.state = value;
+		sim.set(ff.q, 0, value);
+		return true;
+	}
+
+	// merge the old and new value of a state element with an undefined enable
+	static RTLIL::Const merge_undef(RTLIL::Const old_value, const RTLIL::Const &new_value)
+	{
+		for (int i = 0; i < GetSize(old_value); i++)
+			if (old_value.bits[i] != new_value.bits[i])
+				old_value.bits[i] = RTLIL::State::Sx;
+		return old_value;
+	}
+
+	// evaluate the combinational logic and update the state elements until
+	// nothing changes anymore
+	void settle()
+	{
+		for (int iter = 0;; iter++)
+		{
+			if (iter == 1000)
+				log_error("Simulation of module %s does not settle (oscillating latches or asynchronous memory loops?).\n", log_id(module));
+
+			sim.run(1);
+
+			bool changed = false;
+			for (auto &mem : mems)
+				for (auto &port : mem.rd_ports)
+					if (!port.clk_enable && read_port(mem, port))
+						changed = true;
+			if (changed)
+				continue;
+
+			// clock edges: all updates use the values before any of the updates
+			std::vector<std::pair<SimFlipFlop*, RTLIL::Const>> ff_updates;
+
+			for (auto &ff : ffs) {
+				if (ff.clk.empty())
+					continue;
+				RTLIL::State clk = get(ff.clk).bits.at(0);
+				if (is_edge(ff.last_clk, clk, ff.clk_pol)) {
+					RTLIL::State en = ff.en.empty() ? bool2state(ff.en_pol) : get(ff.en).bits.at(0);
+					if (is_active(en, ff.en_pol))
+						ff_updates.push_back(std::make_pair(&ff, get(ff.d)));
+					else if (en != bool2state(!ff.en_pol))
+						ff_updates.push_back(std::make_pair(&ff, merge_undef(ff.state, get(ff.d))));
+				}
+				ff.last_clk = clk;
+			}
+
+			for (auto &mem : mems)
+			{
+				std::vector<bool> rd_active;
+				for (auto &port : mem.rd_ports) {
+					RTLIL::State clk = port.clk_enable ? get(port.clk).bits.at(0) : RTLIL::State::Sx;
+					rd_active.push_back(port.clk_enable && is_edge(port.last_clk, clk, port.clk_pol));
+					port.last_clk = clk;
+				}
+
+				for (int i = 0; i < GetSize(mem.rd_ports); i++)
+					if (rd_active[i] && !mem.rd_ports[i].transparent && get(mem.rd_ports[i].en).as_bool())
+						changed |= read_port(mem, mem.rd_ports[i]);
+
+				for (auto &port : mem.wr_ports) {
+					RTLIL::State clk = port.clk_enable ? get(port.clk).bits.at(0) : RTLIL::State::Sx;
+					bool active = !port.clk_enable || is_edge(port.last_clk, clk, port.clk_pol);
+					port.last_clk = clk;
+					if (!active)
+						continue;
+					int index = mem_index(mem, port.addr);
+					if (index < 0)
+						continue;
+					RTLIL::Const en = get(port.en), data = get(port.data);
+					for (int j = 0; j < mem.width; j++)
+						if (en.bits[j] == RTLIL::State::S1 && mem.words[index].bits[j] != data.bits[j]) {
+							mem.words[index].bits[j] = data.bits[j];
+							changed = true;
+						}
+				}
+
+				for (int i = 0; i < GetSize(mem.rd_ports); i++)
+					if (rd_active[i] && mem.rd_ports[i].transparent)
+						changed |= read_port(mem, mem.rd_ports[i]);
+			}
+
+			for (auto &it : ff_updates)
+				changed |= update_ff(*it.first, it.second);
+
+			// level-sensitive state: latches, asynchronous resets, set and clear
+			for (auto &ff : ffs)
+			{
+				RTLIL::Const value = ff.state;
+
+				if (ff.is_latch) {
+					RTLIL::State en = get(ff.en).bits.at(0);
+					if (is_active(en, ff.en_pol))
+						value = get(ff.d);
+					else if (en != bool2state(!ff.en_pol))
+						value = merge_undef(value, get(ff.d));
+				}
+
+				if (!ff.arst.empty() && is_active(get(ff.arst).bits.at(0), ff.arst_pol))
+					value = ff.arst_value;
+
+				if (!ff.set.empty()) {
+					RTLIL::Const set = get(ff.set), clr = get(ff.clr);
+					for (int i = 0; i < GetSize(value); i++) {
+						if (is_active(set.bits[i], ff.set_pol))
+							value.bits[i] = RTLIL::State::S1;
+						if (is_active(clr.bits[i], ff.clr_pol))
+							value.bits[i] = RTLIL::State::S0;
+					}
+				}
+
+				changed |= update_ff(ff, value);
+			}
+
+			if (!changed)
+				break;
+		}
+	}
+
+	// inputs keep their values until they are set again, so -set values are
+	// only applied once and -set-at values are kept for the following cycles
+	void set_inputs(int cycle, bool clock_value)
+	{
+		if (cycle == 1 && !clock_value) {
+			if (zinput)
+				for (auto wire : module->wires())
+					if (wire->port_input)
+						sim.set(wire, 0, RTLIL::Const(RTLIL::State::S0, GetSize(wire)));
+			for (auto &it : sets)
+				sim.set(it.first, 0, it.second);
+		}
+
+		for (auto &sig : clocks)
+			sim.set(sig, 0, RTLIL::Const(bool2state(clock_value), GetSize(sig)));
+		for (auto &sig : clocks_n)
+			sim.set(sig, 0, RTLIL::Const(bool2state(!clock_value), GetSize(sig)));
+		for (auto &sig : resets)
+			sim.set(sig, 0, RTLIL::Const(bool2state(cycle <= reset_cycles), GetSize(sig)));
+		for (auto &sig : resets_n)
+			sim.set(sig, 0, RTLIL::Const(bool2state(cycle > reset_cycles), GetSize(sig)));
+
+		if (!clock_value && sets_at.count(cycle))
+			for (auto &it : sets_at.at(cycle))
+				sim.set(it.first, 0, it.second);
+	}
+
+	void vcd_begin(std::string filename)
+	{
+		vcd_file = fopen(filename.c_str(), "w");
+		if (vcd_file == NULL)
+			log_cmd_error("Can't open output file `%s' for writing: %s\n", filename.c_str(), strerror(errno));
+
+		time_t timestamp;
+		char stime[128] = {};
+		time(&timestamp);
+		strftime(stime, sizeof(stime), "%c", localtime(&timestamp));
+
+		fprintf(vcd_file, "$date\n    %s\n$end\n", stime);
+		fprintf(vcd_file, "$version\n    Generated by %s\n$end\n", yosys_version_str);
+		fprintf(vcd_file, "$timescale 1ns $end\n");
+		fprintf(vcd_file, "$scope module %s $end\n", log_id(module));
+
+		std::vector<RTLIL::Wire*> wires;
+		for (auto wire : module->wires())
+			if (wire->name[0] == '\\')
+				wires.push_back(wire);
+		std::sort(wires.begin(), wires.end(), RTLIL::sort_by_name_str<RTLIL::Wire>());
+
+		// short identifiers from the printable ASCII characters
+		for (int i = 0; i < GetSize(wires); i++) {
+			std::string id;
+			for (int k = i; id.empty() || k > 0; k /= 94)
+				id += char('!' + k % 94);
+			fprintf(vcd_file, "$var wire %d %s %s $end\n", GetSize(wires[i]), id.c_str(), log_id(wires[i]));
+			vcd_wires.push_back(std::make_pair(wires[i], id));
+		}
+
+		fprintf(vcd_file, "$upscope $end\n$enddefinitions $end\n");
+		vcd_values.resize(GetSize(vcd_wires));
+	}
+
+	void vcd_dump(int timestamp)
+	{
+		if (vcd_file == NULL)
+			return;
+
+		fprintf(vcd_file, "#%d\n", timestamp);
+		for (int i = 0; i < GetSize(vcd_wires); i++)
+		{
+			RTLIL::Const value = get(vcd_wires[i].first);
+			std::string str;
+			for (int k = GetSize(value)-1; k >= 0; k--)
+				str += value.bits[k] == RTLIL::State::S0 ? '0' : value.bits[k] == RTLIL::State::S1 ? '1' :
+						value.bits[k] == RTLIL::State::Sz ? 'z' : 'x';
+
+			if (str == vcd_values[i])
+				continue;
+			vcd_values[i] = str;
+
+			if (GetSize(value) == 1)
+				fprintf(vcd_file, "%s%s\n", str.c_str(), vcd_wires[i].second.c_str());
+			else
+				fprintf(vcd_file, "b%s %s\n", str.c_str(), vcd_wires[i].second.c_str());
+		}
+	}
+
+	void vcd_end()
+	{
+		if (vcd_file != NULL)
+			fclose(vcd_file);
+		vcd_file = NULL;
+	}
+
+	void show(int cycle)
+	{
+		if (shows.empty())
+			return;
+		std::string line = stringf("%6d:", cycle);
+		for (auto &sig : shows)
+			line += stringf(" %s", log_signal(get(sig)));
+		log("%s\n", line.c_str());
+	}
+
+	void run()
+	{
+		int64_t start_ns = PerformanceTimer::query();
+
+		if (!shows.empty()) {
+			std::string header = "cycle:";
+			for (auto &sig : shows)
+				header += stringf(" %s", log_signal(sig));
+			log("\n%s\n", header.c_str());
+		}
+
+		// every cycle has a rising clock edge at 10*cycle-5 and a falling
+		// clock edge at 10*cycle, the inputs for the next cycle change with
+		// the falling edge.
+		set_inputs(1, false);
+		settle();
+		vcd_dump(0);
+
+		for (int cycle = 1; cycle <= num_cycles; cycle++)
+		{
+			set_inputs(cycle, true);
+			settle();
+			vcd_dump(10*cycle - 5);
+			show(cycle);
+
+			set_inputs(cycle + 1, false);
+			settle();
+			vcd_dump(10*cycle);
+		}
+
+		if (vcd_file != NULL)
+			fprintf(vcd_file, "#%d\n", 10*num_cycles + 5);
+
+		log("\nSimulated %d cycles in %.2f ms.\n", num_cycles, (PerformanceTimer::query() - start_ns) * 1e-6);
+	}
+};
+
+struct SimPass : public Pass {
+	SimPass() : Pass("sim", "simulate the circuit") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    sim [options] [selection]\n");
+		log("\n");
+		log("This command simulates the selected module for a number of clock cycles. The\n");
+		log("combinational logic is compiled once to a levelized list of cells (see 'help\n");
+		log("eval' for the -vectors option, which uses the same engine). Supported state\n");
+		log("elements are the internal FF and latch cells ($dff, $adff, $_DFF_P_, ...) and\n");
+		log("$mem cells (run 'memory_collect' for $memrd and $memwr cells).\n");
+		log("\n");
+		log("Each cycle has a rising edge of the clock signals at time 10*cycle-5 and a\n");
+		log("falling edge at 10*cycle. All other inputs change with the falling edge.\n");
+		log("\n");
+		log("    -clock <signal>\n");
+		log("    -clockn <signal>\n");
+		log("        the specified signal is a clock with a rising (falling) edge in the\n");
+		log("        middle of each cycle. this option can be used multiple times.\n");
+		log("\n");
+		log("    -reset <signal>\n");
+		log("    -resetn <signal>\n");
+		log("        the specified signal is an active-high (active-low) reset that is\n");
+		log("        asserted during the first cycles.\n");
+		log("\n");
+		log("    -rstlen <N>\n");
+		log("        number of reset cycles (default = 1).\n");
+		log("\n");
+		log("    -n <N>\n");
+		log("        number of cycles to simulate (default = 20).\n");
+		log("\n");
+		log("    -set <signal> <value>\n");
+		log("        set the specified input signal to the specified value in all cycles.\n");
+		log("\n");
+		log("    -set-at <N> <signal> <value>\n");
+		log("        set the specified input signal to the specified value in cycle N.\n");
+		log("        the value is kept in the following cycles unless it is set again.\n");
+		log("\n");
+		log("    -zinput\n");
+		log("        use 0 instead of x as the value of inputs that are not set.\n");
+		log("\n");
+		log("    -zinit\n");
+		log("        use 0 instead of x as the initial value of FFs and memory words that\n");
+		log("        have no init attribute or INIT parameter.\n");
+		log("\n");
+		log("    -show <signal>\n");
+		log("        print the value of the specified signal after the clock edge of\n");
+		log("        each cycle. this option can be used multiple times.\n");
+		log("\n");
+		log("    -vcd <filename>\n");
+		log("        write the values of all public wires to the specified VCD file. the\n");
+		log("        file is written while the simulation runs.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		std::vector<std::string> clocks, clocks_n, resets, resets_n, shows;
+		std::vector<std::pair<std::string, std::string>> sets;
+		std::vector<std::pair<int, std::pair<std::string, std::string>>> sets_at;
+		std::string vcd_filename;
+		bool zinit = false, zinput = false;
+		int num_cycles = 20, reset_cycles = 1;
+
+		log_header("Executing SIM pass (simulate the circuit).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-clock" && argidx+1 < args.size()) {
+				clocks.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-clockn" && argidx+1 < args.size()) {
+				clocks_n.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-reset" && argidx+1 < args.size()) {
+				resets.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-resetn" && argidx+1 < args.size()) {
+				resets_n.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-rstlen" && argidx+1 < args.size()) {
+				reset_cycles = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				num_cycles = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-set" && argidx+2 < args.size()) {
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				sets.push_back(std::make_pair(lhs, rhs));
+				continue;
+			}
+			if (args[argidx] == "-set-at" && argidx+3 < args.size()) {
+				int cycle = atoi(args[++argidx].c_str());
+				std::string lhs = args[++argidx];
+				std::string rhs = args[++argidx];
+				sets_at.push_back(std::make_pair(cycle, std::make_pair(lhs, rhs)));
+				continue;
+			}
+			if (args[argidx] == "-zinput") {
+				zinput = true;
+				continue;
+			}
+			if (args[argidx] == "-zinit") {
+				zinit = true;
+				continue;
+			}
+			if (args[argidx] == "-show" && argidx+1 < args.size()) {
+				shows.push_back(args[++argidx]);
+				continue;
+			}
+			if (args[argidx] == "-vcd" && argidx+1 < args.size()) {
+				vcd_filename = args[++argidx];
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		RTLIL::Module *module = NULL;
+		for (auto mod : design->selected_modules()) {
+			if (module)
+				log_cmd_error("Only one module must be selected for the SIM pass! (selected: %s and %s)\n",
+						log_id(module), log_id(mod));
+			module = mod;
+		}
+		if (module == NULL)
+			log_cmd_error("Can't perform SIM on an empty selection!\n");
+
+		SimWorker worker(module);
+		worker.zinit = zinit;
+		worker.zinput = zinput;
+		worker.num_cycles = num_cycles;
+		worker.reset_cycles = reset_cycles;
+
+		auto parse_sig = [&](std::string str, const char *what) -> RTLIL::SigSpec {
+			RTLIL::SigSpec sig;
+			if (!RTLIL::SigSpec::parse_sel(sig, design, module, str))
+				log_cmd_error("Failed to parse %s expression `%s'.\n", what, str.c_str());
+			return sig;
+		};
+
+		auto parse_value = [&](RTLIL::SigSpec lhs, std::string str) -> RTLIL::Const {
+			RTLIL::SigSpec rhs;
+			if (!RTLIL::SigSpec::parse_rhs(lhs, rhs, module, str) || !rhs.is_fully_const())
+				log_cmd_error("Failed to parse constant rhs set expression `%s'.\n", str.c_str());
+			if (lhs.size() != rhs.size())
+				log_cmd_error("Set expression with different lhs and rhs sizes: %s (%d bits) vs. %s (%d bits)\n",
+						log_signal(lhs), lhs.size(), str.c_str(), rhs.size());
+			return rhs.as_const();
+		};
+
+		for (auto &it : clocks)
+			worker.clocks.push_back(parse_sig(it, "clock"));
+		for (auto &it : clocks_n)
+			worker.clocks_n.push_back(parse_sig(it, "clock"));
+		for (auto &it : resets)
+			worker.resets.push_back(parse_sig(it, "reset"));
+		for (auto &it : resets_n)
+			worker.resets_n.push_back(parse_sig(it, "reset"));
+		for (auto &it : shows)
+			worker.shows.push_back(parse_sig(it, "show"));
+
+		for (auto &it : sets) {
+			RTLIL::SigSpec lhs = parse_sig(it.first, "lhs set");
+			worker.sets.push_back(std::make_pair(lhs, parse_value(lhs, it.second)));
+		}
+
+		for (auto &it : sets_at) {
+			RTLIL::SigSpec lhs = parse_sig(it.second.first, "lhs set");
+			worker.sets_at[it.first].push_back(std::make_pair(lhs, parse_value(lhs, it.second.second)));
+		}
+
+		worker.setup();
+
+		if (!vcd_filename.empty()) {
+			log("Writing VCD file %s.\n", vcd_filename.c_str());
+			worker.vcd_begin(vcd_filename);
+		}
+
+		worker.run();
+		worker.vcd_end();
+	}
+} SimPass;
+
+PRIVATE_NAMESPACE_END
@@ -44,6 +44,7 @@
 #include "kernel/celltypes.h"
 #include "kernel/cost.h"
 #include "kernel/log.h"
+#include "kernel/utils.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -54,9 +55,24 @@
 #ifndef _WIN32
 #  include <unistd.h>
 #  include <dirent.h>
+#  include <fcntl.h>
+#  include <signal.h>
+#  include <sys/wait.h>
+#endif
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  define ABC_PERSISTENT_SUPPORTED
 #endif
 
 #include "frontends/blif/blifparse.h"
+#include "libs/sha1/sha1.h"
+
+#ifdef YOSYS_LINK_ABC
+#  ifdef _WIN32
+#    error "LINK_ABC is not supported on Windows."
+#  endif
+extern "C" int Abc_RealMain(int argc, char *argv[]);
+#endif
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -95,387 +111,8 @@ bool map_mux8;
 bool map_mux16;
 
 bool markgroups;
-int map_autoidx;
-SigMap assign_map;
-RTLIL::Module *module;
-std::vector<gate_t> signal_list;
-std::map<RTLIL::SigBit, int> signal_map;
 pool<std::string> enabled_gates;
 
-bool clk_polarity, en_polarity;
-RTLIL::SigSpec clk_sig, en_sig;
-
-int map_signal(RTLIL::SigBit bit, gate_type_t gate_type = G(NONE), int in1 = -1, int in2 = -1, int in3 = -1, int in4 = -1)
-{
-	assign_map.apply(bit);
-
-	if (signal_map.count(bit) == 0) {
-		gate_t gate;
-		gate.id = signal_list.size();
-		gate.type = G(NONE);
-		gate.in1 = -1;
-		gate.in2 = -1;
-		gate.in3 = -1;
-		gate.in4 = -1;
-		gate.is_port = false;
-		gate.bit = bit;
-		signal_list.push_back(gate);
-		signal_map[bit] = gate.id;
-	}
-
-	gate_t &gate = signal_list[signal_map[bit]];
-
-	if (gate_type != G(NONE))
-		gate.type = gate_type;
-	if (in1 >= 0)
-		gate.in1 = in1;
-	if (in2 >= 0)
-		gate.in2 = in2;
-	if (in3 >= 0)
-		gate.in3 = in3;
-	if (in4 >= 0)
-		gate.in4 = in4;
-
-	return gate.id;
-}
-
-void mark_port(RTLIL::SigSpec sig)
-{
-	for (auto &bit : assign_map(sig))
-		if (bit.wire != NULL && signal_map.count(bit) > 0)
-			signal_list[signal_map[bit]].is_port = true;
-}
-
-void extract_cell(RTLIL::Cell *cell, bool keepff)
-{
-	if (cell->type == "$_DFF_N_" || cell->type == "$_DFF_P_")
-	{
-		if (clk_polarity != (cell->type == "$_DFF_P_"))
-			return;
-		if (clk_sig != assign_map(cell->getPort("\\C")))
-			return;
-		if (GetSize(en_sig) != 0)
-			return;
-		goto matching_dff;
-	}
-
-	if (cell->type == "$_DFFE_NN_" || cell->type == "$_DFFE_NP_" || cell->type == "$_DFFE_PN_" || cell->type == "$_DFFE_PP_")
-	{
-		if (clk_polarity != (cell->type == "$_DFFE_PN_" || cell->type == "$_DFFE_PP_"))
-			return;
-		if (en_polarity != (cell->type == "$_DFFE_NP_" || cell->type == "$_DFFE_PP_"))
-			return;
-		if (clk_sig != assign_map(cell->getPort("\\C")))
-			return;
-		if (en_sig != assign_map(cell->getPort("\\E")))
-			return;
-		goto matching_dff;
-	}
-
-	if (0) {
-	matching_dff:
-		RTLIL::SigSpec sig_d = cell->getPort("\\D");
-		RTLIL::SigSpec sig_q = cell->getPort("\\Q");
-
-		if (keepff)
-			for (auto &c : sig_q.chunks())
-				if (c.wire != NULL)
-					c.wire->attributes["\\keep"] = 1;
-
-		assign_map.apply(sig_d);
-		assign_map.apply(sig_q);
-
-		map_signal(sig_q, G(FF), map_signal(sig_d));
-
-		module->remove(cell);
-		return;
-	}
-
-	if (cell->type.in("$_BUF_", "$_NOT_"))
-	{
-		RTLIL::SigSpec sig_a = cell->getPort("\\A");
-		RTLIL::SigSpec sig_y = cell->getPort("\\Y");
-
-		assign_map.apply(sig_a);
-		assign_map.apply(sig_y);
-
-		map_signal(sig_y, cell->type == "$_BUF_" ? G(BUF) : G(NOT), map_signal(sig_a));
-
-		module->remove(cell);
-		return;
-	}
-
-	if (cell->type.in("$_AND_", "$_NAND_", "$_OR_", "$_NOR_", "$_XOR_", "$_XNOR_"))
-	{
-		RTLIL::SigSpec sig_a = cell->getPort("\\A");
-		RTLIL::SigSpec sig_b = cell->getPort("\\B");
-		RTLIL::SigSpec sig_y = cell->getPort("\\Y");
-
-		assign_map.apply(sig_a);
-		assign_map.apply(sig_b);
-		assign_map.apply(sig_y);
-
-		int mapped_a = map_signal(sig_a);
-		int mapped_b = map_signal(sig_b);
-
-		if (cell->type == "$_AND_")
-			map_signal(sig_y, G(AND), mapped_a, mapped_b);
-		else if (cell->type == "$_NAND_")
-			map_signal(sig_y, G(NAND), mapped_a, mapped_b);
-		else if (cell->type == "$_OR_")
-			map_signal(sig_y, G(OR), mapped_a, mapped_b);
-		else if (cell->type == "$_NOR_")
-			map_signal(sig_y, G(NOR), mapped_a, mapped_b);
-		else if (cell->type == "$_XOR_")
-			map_signal(sig_y, G(XOR), mapped_a, mapped_b);
-		else if (cell->type == "$_XNOR_")
-			map_signal(sig_y, G(XNOR), mapped_a, mapped_b);
-		else
-			log_abort();
-
-		module->remove(cell);
-		return;
-	}
-
-	if (cell->type == "$_MUX_")
-	{
-		RTLIL::SigSpec sig_a = cell->getPort("\\A");
-		RTLIL::SigSpec sig_b = cell->getPort("\\B");
-		RTLIL::SigSpec sig_s = cell->getPort("\\S");
-		RTLIL::SigSpec sig_y = cell->getPort("\\Y");
-
-		assign_map.apply(sig_a);
-		assign_map.apply(sig_b);
-		assign_map.apply(sig_s);
-		assign_map.apply(sig_y);
-
-		int mapped_a = map_signal(sig_a);
-		int mapped_b = map_signal(sig_b);
-		int mapped_s = map_signal(sig_s);
-
-		map_signal(sig_y, G(MUX), mapped_a, mapped_b, mapped_s);
-
-		module->remove(cell);
-		return;
-	}
-
-	if (cell->type.in("$_AOI3_", "$_OAI3_"))
-	{
-		RTLIL::SigSpec sig_a = cell->getPort("\\A");
-		RTLIL::SigSpec sig_b = cell->getPort("\\B");
-		RTLIL::SigSpec sig_c = cell->getPort("\\C");
-		RTLIL::SigSpec sig_y = cell->getPort("\\Y");
-
-		assign_map.apply(sig_a);
-		assign_map.apply(sig_b);
-		assign_map.apply(sig_c);
-		assign_map.apply(sig_y);
-
-		int mapped_a = map_signal(sig_a);
-		int mapped_b = map_signal(sig_b);
-		int mapped_c = map_signal(sig_c);
-
-		map_signal(sig_y, cell->type == "$_AOI3_" ? G(AOI3) : G(OAI3), mapped_a, mapped_b, mapped_c);
-
-		module->remove(cell);
-		return;
-	}
-
-	if (cell->type.in("$_AOI4_", "$_OAI4_"))
-	{
-		RTLIL::SigSpec sig_a = cell->getPort("\\A");
-		RTLIL::SigSpec sig_b = cell->getPort("\\B");
-		RTLIL::SigSpec sig_c = cell->getPort("\\C");
-		RTLIL::SigSpec sig_d = cell->getPort("\\D");
-		RTLIL::SigSpec sig_y = cell->getPort("\\Y");
-
-		assign_map.apply(sig_a);
-		assign_map.apply(sig_b);
-		assign_map.apply(sig_c);
-		assign_map.apply(sig_d);
-		assign_map.apply(sig_y);
-
-		int mapped_a = map_signal(sig_a);
-		int mapped_b = map_signal(sig_b);
-		int mapped_c = map_signal(sig_c);
-		int mapped_d = map_signal(sig_d);
-
-		map_signal(sig_y, cell->type == "$_AOI4_" ? G(AOI4) : G(OAI4), mapped_a, mapped_b, mapped_c, mapped_d);
-
-		module->remove(cell);
-		return;
-	}
-}
-
-std::string remap_name(RTLIL::IdString abc_name)
-{
-	std::stringstream sstr;
-	sstr << "$abc$" << map_autoidx << "$" << abc_name.substr(1);
-	return sstr.str();
-}
-
-void dump_loop_graph(FILE *f, int &nr, std::map<int, std::set<int>> &edges, std::set<int> &workpool, std::vector<int> &in_counts)
-{
-	if (f == NULL)
-		return;
-
-	log("Dumping loop state graph to slide %d.\n", ++nr);
-
-	fprintf(f, "digraph \"slide%d\" {\n", nr);
-	fprintf(f, "  label=\"slide%d\";\n", nr);
-	fprintf(f, "  rankdir=\"TD\";\n");
-
-	std::set<int> nodes;
-	for (auto &e : edges) {
-		nodes.insert(e.first);
-		for (auto n : e.second)
-			nodes.insert(n);
-	}
-
-	for (auto n : nodes)
-		fprintf(f, "  n%d [label=\"%s\\nid=%d, count=%d\"%s];\n", n, log_signal(signal_list[n].bit),
-				n, in_counts[n], workpool.count(n) ? ", shape=box" : "");
-
-	for (auto &e : edges)
-	for (auto n : e.second)
-		fprintf(f, "  n%d -> n%d;\n", e.first, n);
-
-	fprintf(f, "}\n");
-}
-
-void handle_loops()
-{
-	// http://en.wikipedia.org/wiki/Topological_sorting
-	// (Kahn, Arthur B. (1962), "Topological sorting of large networks")
-
-	std::map<int, std::set<int>> edges;
-	std::vector<int> in_edges_count(signal_list.size());
-	std::set<int> workpool;
-
-	FILE *dot_f = NULL;
-	int dot_nr = 0;
-
-	// uncomment for troubleshooting the loop detection code
-	// dot_f = fopen("test.dot", "w");
-
-	for (auto &g : signal_list) {
-		if (g.type == G(NONE) || g.type == G(FF)) {
-			workpool.insert(g.id);
-		} else {
-			if (g.in1 >= 0) {
-				edges[g.in1].insert(g.id);
-				in_edges_count[g.id]++;
-			}
-			if (g.in2 >= 0 && g.in2 != g.in1) {
-				edges[g.in2].insert(g.id);
-				in_edges_count[g.id]++;
-			}
-			if (g.in3 >= 0 && g.in3 != g.in2 && g.in3 != g.in1) {
-				edges[g.in3].insert(g.id);
-				in_edges_count[g.id]++;
-			}
-			if (g.in4 >= 0 && g.in4 != g.in3 && g.in4 != g.in2 && g.in4 != g.in1) {
-				edges[g.in4].insert(g.id);
-				in_edges_count[g.id]++;
-			}
-		}
-	}
-
-	dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
-
-	while (workpool.size() > 0)
-	{
-		int id = *workpool.begin();
-		workpool.erase(id);
-
-		// log("Removing non-loop node %d from graph: %s\n", id, log_signal(signal_list[id].bit));
-
-		for (int id2 : edges[id]) {
-			log_assert(in_edges_count[id2] > 0);
-			if (--in_edges_count[id2] == 0)
-				workpool.insert(id2);
-		}
-		edges.erase(id);
-
-		dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
-
-		while (workpool.size() == 0)
-		{
-			if (edges.size() == 0)
-				break;
-
-			int id1 = edges.begin()->first;
-
-			for (auto &edge_it : edges) {
-				int id2 = edge_it.first;
-				RTLIL::Wire *w1 = signal_list[id1].bit.wire;
-				RTLIL::Wire *w2 = signal_list[id2].bit.wire;
-				if (w1 == NULL)
-					id1 = id2;
-				else if (w2 == NULL)
-					continue;
-				else if (w1->name[0] == '$' && w2->name[0] == '\\')
-					id1 = id2;
-				else if (w1->name[0] == '\\' && w2->name[0] == '$')
-					continue;
-				else if (edges[id1].size() < edges[id2].size())
-					id1 = id2;
-				else if (edges[id1].size() > edges[id2].size())
-					continue;
-				else if (w2->name.str() < w1->name.str())
-					id1 = id2;
-			}
-
-			if (edges[id1].size() == 0) {
-				edges.erase(id1);
-				continue;
-			}
-
-			log_assert(signal_list[id1].bit.wire != NULL);
-
-			std::stringstream sstr;
-			sstr << "$abcloop$" << (autoidx++);
-			RTLIL::Wire *wire = module->addWire(sstr.str());
-
-			bool first_line = true;
-			for (int id2 : edges[id1]) {
-				if (first_line)
-					log("Breaking loop using new signal %s: %s -> %s\n", log_signal(RTLIL::SigSpec(wire)),
-							log_signal(signal_list[id1].bit), log_signal(signal_list[id2].bit));
-				else
-					log("                               %*s  %s -> %s\n", int(strlen(log_signal(RTLIL::SigSpec(wire)))), "",
-							log_signal(signal_list[id1].bit), log_signal(signal_list[id2].bit));
-				first_line = false;
-			}
-
-			int id3 = map_signal(RTLIL::SigSpec(wire));
-			signal_list[id1].is_port = true;
-			signal_list[id3].is_port = true;
-			log_assert(id3 == int(in_edges_count.size()));
-			in_edges_count.push_back(0);
-			workpool.insert(id3);
-
-			for (int id2 : edges[id1]) {
-				if (signal_list[id2].in1 == id1)
-					signal_list[id2].in1 = id3;
-				if (signal_list[id2].in2 == id1)
-					signal_list[id2].in2 = id3;
-				if (signal_list[id2].in3 == id1)
-					signal_list[id2].in3 = id3;
-				if (signal_list[id2].in4 == id1)
-					signal_list[id2].in4 = id3;
-			}
-			edges[id1].swap(edges[id3]);
-
-			module->connect(RTLIL::SigSig(signal_list[id3].bit, signal_list[id1].bit));
-			dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
-		}
-	}
-
-	if (dot_f != NULL)
-		fclose(dot_f);
-}
-
 std::string add_echos_to_abc_cmd(std::string str)
 {
 	std::string new_str, token;
@@ -591,250 +228,828 @@ struct abc_output_filter
 	}
 };
 
-void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::string script_file, std::string exe_file,
-		std::string liberty_file, std::string constr_file, bool cleanup, vector<int> lut_costs, bool dff_mode, std::string clk_str,
-		bool keepff, std::string delay_target, bool fast_mode, const std::vector<RTLIL::Cell*> &cells, bool show_tempdir)
+#ifdef ABC_PERSISTENT_SUPPORTED
+// an ABC process that stays alive for the whole abc command (-persistent) and
+// runs the scripts of many workers. Commands are sent to the interactive ABC
+// prompt over a pipe. The output is read from a pseudo terminal, so that ABC
+// writes it line by line instead of keeping it in its stdio buffer, and each
+// job ends with the output of an echo command with a unique marker.
+struct AbcServer
 {
-	module = current_module;
-	map_autoidx = autoidx++;
-
-	signal_map.clear();
-	signal_list.clear();
+	int id, pid, to_abc_fd, from_abc_fd, job_count;
+	bool lib_loaded;
 
-	if (clk_str != "$")
+	AbcServer(int id, std::string exe_file) : id(id), pid(-1), to_abc_fd(-1), from_abc_fd(-1), job_count(0), lib_loaded(false)
 	{
-		assign_map.set(module);
+		int master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+		if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0)
+			log_error("ABC: creating pseudo terminal for persistent ABC process failed: %s\n", strerror(errno));
+		std::string slave_name = ptsname(master_fd);
+
+		int pipefd[2];
+		if (pipe(pipefd) != 0)
+			log_error("ABC: creating pipe for persistent ABC process failed: %s\n", strerror(errno));
+
+		fflush(stdout);
+		fflush(stderr);
+
+		pid = fork();
+		if (pid < 0)
+			log_error("ABC: fork() failed: %s\n", strerror(errno));
+
+		if (pid == 0) {
+			int slave_fd = open(slave_name.c_str(), O_RDWR | O_NOCTTY);
+			if (slave_fd < 0)
+				_exit(1);
+			dup2(pipefd[0], 0);
+			dup2(slave_fd, 1);
+			dup2(slave_fd, 2);
+			close(pipefd[0]);
+			close(pipefd[1]);
+			close(slave_fd);
+			close(master_fd);
+#ifdef YOSYS_LINK_ABC
+			if (exe_file.empty()) {
+				char *abc_argv[3] = { strdup("yosys-abc"), strdup("-s"), nullptr };
+				_exit(Abc_RealMain(2, abc_argv));
+			}
+#endif
+			std::string command = exe_file + " -s";
+			execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+			_exit(127);
+		}
 
-		clk_polarity = true;
-		clk_sig = RTLIL::SigSpec();
+		close(pipefd[0]);
+		to_abc_fd = pipefd[1];
+		from_abc_fd = master_fd;
+		log("Started persistent ABC process %d.\n", id);
+	}
 
-		en_polarity = true;
-		en_sig = RTLIL::SigSpec();
+	~AbcServer()
+	{
+		if (to_abc_fd >= 0) {
+			send("quit\n");
+			close(to_abc_fd);
+		}
+		if (from_abc_fd >= 0)
+			close(from_abc_fd);
+		if (pid >= 0)
+			waitpid(pid, NULL, 0);
 	}
 
-	std::string tempdir_name = "/tmp/yosys-abc-XXXXXX";
-	if (!cleanup)
-		tempdir_name[0] = tempdir_name[4] = '_';
-	tempdir_name = make_temp_dir(tempdir_name);
-	log_header("Extracting gate netlist of module `%s' to `%s/input.blif'..\n",
-			module->name.c_str(), replace_tempdir(tempdir_name, tempdir_name, show_tempdir).c_str());
-
-	std::string abc_script = stringf("read_blif %s/input.blif; ", tempdir_name.c_str());
-
-	if (!liberty_file.empty()) {
-		abc_script += stringf("read_lib -w %s; ", liberty_file.c_str());
-		if (!constr_file.empty())
-			abc_script += stringf("read_constr -v %s; ", constr_file.c_str());
-	} else
-	if (!lut_costs.empty())
-		abc_script += stringf("read_lut %s/lutdefs.txt; ", tempdir_name.c_str());
-	else
-		abc_script += stringf("read_library %s/stdcells.genlib; ", tempdir_name.c_str());
-
-	if (!script_file.empty()) {
-		if (script_file[0] == '+') {
-			for (size_t i = 1; i < script_file.size(); i++)
-				if (script_file[i] == '\'')
-					abc_script += "'\\''";
-				else if (script_file[i] == ',')
-					abc_script += " ";
-				else
-					abc_script += script_file[i];
-		} else
-			abc_script += stringf("source %s", script_file.c_str());
-	} else if (!lut_costs.empty()) {
-		bool all_luts_cost_same = true;
-		for (int this_cost : lut_costs)
-			if (this_cost != lut_costs.front())
-				all_luts_cost_same = false;
-		abc_script += fast_mode ? ABC_FAST_COMMAND_LUT : ABC_COMMAND_LUT;
-		if (all_luts_cost_same && !fast_mode)
-			abc_script += "; lutpack";
-	} else if (!liberty_file.empty())
-		abc_script += constr_file.empty() ? (fast_mode ? ABC_FAST_COMMAND_LIB : ABC_COMMAND_LIB) : (fast_mode ? ABC_FAST_COMMAND_CTR : ABC_COMMAND_CTR);
-	else
-		abc_script += fast_mode ? ABC_FAST_COMMAND_DFL : ABC_COMMAND_DFL;
-
-	for (size_t pos = abc_script.find("{D}"); pos != std::string::npos; pos = abc_script.find("{D}", pos))
-		abc_script = abc_script.substr(0, pos) + delay_target + abc_script.substr(pos+3);
-
-	abc_script += stringf("; write_blif %s/output.blif", tempdir_name.c_str());
-	abc_script = add_echos_to_abc_cmd(abc_script);
-
-	for (size_t i = 0; i+1 < abc_script.size(); i++)
-		if (abc_script[i] == ';' && abc_script[i+1] == ' ')
-			abc_script[i+1] = '\n';
-
-	FILE *f = fopen(stringf("%s/abc.script", tempdir_name.c_str()).c_str(), "wt");
-	fprintf(f, "%s\n", abc_script.c_str());
-	fclose(f);
-
-	if (!clk_str.empty() && clk_str != "$")
+	bool send(const std::string &text)
 	{
-		if (clk_str.find(',') != std::string::npos) {
-			int pos = clk_str.find(',');
-			std::string en_str = clk_str.substr(pos+1);
-			clk_str = clk_str.substr(0, pos);
-			if (en_str[0] == '!') {
-				en_polarity = false;
-				en_str = en_str.substr(1);
-			}
-			if (module->wires_.count(RTLIL::escape_id(en_str)) != 0)
-				en_sig = assign_map(RTLIL::SigSpec(module->wires_.at(RTLIL::escape_id(en_str)), 0));
+		// a terminated ABC process must not terminate yosys with SIGPIPE
+		void (*old_handler)(int) = signal(SIGPIPE, SIG_IGN);
+
+		const char *data = text.c_str();
+		size_t size = text.size();
+		while (size > 0) {
+			ssize_t n = write(to_abc_fd, data, size);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0)
+				break;
+			data += n, size -= n;
 		}
-		if (clk_str[0] == '!') {
-			clk_polarity = false;
-			clk_str = clk_str.substr(1);
+
+		signal(SIGPIPE, old_handler);
+		return size == 0;
+	}
+
+	// removes the prompts that ABC prints before reading a command
+	static std::string strip_prompts(std::string text)
+	{
+		for (size_t pos = text.find("abc "); pos != std::string::npos; pos = text.find("abc ", pos)) {
+			size_t end = pos + 4;
+			while (end < text.size() && '0' <= text[end] && text[end] <= '9')
+				end++;
+			if (end > pos + 4 && text.compare(end, 2, "> ") == 0)
+				text.erase(pos, end + 2 - pos);
+			else
+				pos++;
 		}
-		if (module->wires_.count(RTLIL::escape_id(clk_str)) != 0)
-			clk_sig = assign_map(RTLIL::SigSpec(module->wires_.at(RTLIL::escape_id(clk_str)), 0));
+		return text;
+	}
+
+	std::string marker()
+	{
+		return stringf("YOSYS_ABC_JOB_%d_DONE", job_count);
 	}
 
-	if (dff_mode && clk_sig.empty())
-		log_error("Clock domain %s not found.\n", clk_str.c_str());
+	bool start_job(const std::string &script_name)
+	{
+		job_count++;
+		return send(stringf("source %s\necho %s\n", script_name.c_str(), marker().c_str()));
+	}
 
-	if (dff_mode || !clk_str.empty())
+	// passes the output of the current job to the filter and returns false
+	// if the ABC process terminated before the job was finished
+	bool finish_job(abc_output_filter &filt)
 	{
-		if (clk_sig.size() == 0)
-			log("No%s clock domain found. Not extracting any FF cells.\n", clk_str.empty() ? "" : " matching");
-		else {
-			log("Found%s %s clock domain: %s", clk_str.empty() ? "" : " matching", clk_polarity ? "posedge" : "negedge", log_signal(clk_sig));
-			if (en_sig.size() != 0)
-				log(", enabled by %s%s", en_polarity ? "" : "!", log_signal(en_sig));
-			log("\n");
+		std::string done = marker(), buffer;
+		char chunk[4096];
+
+		while (1)
+		{
+			size_t pos = buffer.find(done);
+			if (pos != std::string::npos) {
+				size_t eol = buffer.find('\n', pos);
+				if (eol != std::string::npos) {
+					filt.next_line(strip_prompts(buffer.substr(0, pos)));
+					return true;
+				}
+			}
+
+			ssize_t n = read(from_abc_fd, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n <= 0) {
+				// reading from the pseudo terminal fails with EIO when ABC exited
+				filt.next_line(strip_prompts(buffer) + "\n");
+				return false;
+			}
+			buffer.append(chunk, n);
+
+			// forward complete lines that can't be a part of the marker
+			size_t last_eol = buffer.rfind('\n');
+			if (last_eol != std::string::npos && buffer.find(done) == std::string::npos) {
+				filt.next_line(strip_prompts(buffer.substr(0, last_eol+1)));
+				buffer = buffer.substr(last_eol+1);
+			}
 		}
 	}
+};
+#else
+struct AbcServer;
+#endif
+
+struct AbcWorker
+{
+	RTLIL::Module *module;
+	SigMap &assign_map;
+	int map_autoidx;
+
+	std::vector<gate_t> signal_list;
+	std::map<RTLIL::SigBit, int> signal_map;
+
+	bool clk_polarity, en_polarity;
+	RTLIL::SigSpec clk_sig, en_sig;
+
+	// signals used by other workers on the same module that have been
+	// extracted but not re-integrated yet (only used with -j)
+	const pool<RTLIL::SigBit> *pending_ports;
+
+	std::string tempdir_name, abc_command;
+	bool cleanup, show_tempdir, builtin_lib, linked_abc;
+	int count_output;
+	FILE *abc_pipe;
+	int abc_pid;
+
+	// with -persistent the script runs in this ABC process. The script
+	// without the commands that load the library is used when the process
+	// has loaded the library already.
+	AbcServer *server;
+	std::string abc_script_nolib;
+	bool server_job_started;
+
+	// with -cache the ABC result is stored in (or loaded from) cache_file.
+	// cache_salt is a hash of the inputs that are the same for all workers.
+	std::string cache_dir, cache_salt, cache_file;
+	bool cache_hit;
+
+	AbcWorker(RTLIL::Module *module, SigMap &assign_map, bool cleanup, bool show_tempdir) :
+			module(module), assign_map(assign_map), map_autoidx(autoidx++), clk_polarity(true), en_polarity(true),
+			pending_ports(nullptr), cleanup(cleanup), show_tempdir(show_tempdir), builtin_lib(false), linked_abc(false),
+			count_output(0), abc_pipe(nullptr), abc_pid(-1), server(nullptr), server_job_started(false), cache_hit(false)
+	{
+	}
+
+	int map_signal(RTLIL::SigBit bit, gate_type_t gate_type = G(NONE), int in1 = -1, int in2 = -1, int in3 = -1, int in4 = -1)
+	{
+		assign_map.apply(bit);
+
+		if (signal_map.count(bit) == 0) {
+			gate_t gate;
+			gate.id = signal_list.size();
+			gate.type = G(NONE);
+			gate.in1 = -1;
+			gate.in2 = -1;
+			gate.in3 = -1;
+			gate.in4 = -1;
+			gate.is_port = false;
+			gate.bit = bit;
+			signal_list.push_back(gate);
+			signal_map[bit] = gate.id;
+		}
+
+		gate_t &gate = signal_list[signal_map[bit]];
 
-	for (auto c : cells)
-		extract_cell(c, keepff);
+		if (gate_type != G(NONE))
+			gate.type = gate_type;
+		if (in1 >= 0)
+			gate.in1 = in1;
+		if (in2 >= 0)
+			gate.in2 = in2;
+		if (in3 >= 0)
+			gate.in3 = in3;
+		if (in4 >= 0)
+			gate.in4 = in4;
 
-	for (auto &wire_it : module->wires_) {
-		if (wire_it.second->port_id > 0 || wire_it.second->get_bool_attribute("\\keep"))
-			mark_port(RTLIL::SigSpec(wire_it.second));
+		return gate.id;
 	}
 
-	for (auto &cell_it : module->cells_)
-	for (auto &port_it : cell_it.second->connections())
-		mark_port(port_it.second);
+	void mark_port(RTLIL::SigSpec sig)
+	{
+		for (auto &bit : assign_map(sig))
+			if (bit.wire != NULL && signal_map.count(bit) > 0)
+				signal_list[signal_map[bit]].is_port = true;
+	}
+
+	void extract_cell(RTLIL::Cell *cell, bool keepff)
+	{
+		if (cell->type == "$_DFF_N_" || cell->type == "$_DFF_P_")
+		{
+			if (clk_polarity != (cell->type == "$_DFF_P_"))
+				return;
+			if (clk_sig != assign_map(cell->getPort("\\C")))
+				return;
+			if (GetSize(en_sig) != 0)
+				return;
+			goto matching_dff;
+		}
+
+		if (cell->type == "$_DFFE_NN_" || cell->type == "$_DFFE_NP_" || cell->type == "$_DFFE_PN_" || cell->type == "$_DFFE_PP_")
+		{
+			if (clk_polarity != (cell->type == "$_DFFE_PN_" || cell->type == "$_DFFE_PP_"))
+				return;
+			if (en_polarity != (cell->type == "$_DFFE_NP_" || cell->type == "$_DFFE_PP_"))
+				return;
+			if (clk_sig != assign_map(cell->getPort("\\C")))
+				return;
+			if (en_sig != assign_map(cell->getPort("\\E")))
+				return;
+			goto matching_dff;
+		}
+
+		if (0) {
+		matching_dff:
+			RTLIL::SigSpec sig_d = cell->getPort("\\D");
+			RTLIL::SigSpec sig_q = cell->getPort("\\Q");
+
+			if (keepff)
+				for (auto &c : sig_q.chunks())
+					if (c.wire != NULL)
+						c.wire->attributes["\\keep"] = 1;
+
+			assign_map.apply(sig_d);
+			assign_map.apply(sig_q);
+
+			map_signal(sig_q, G(FF), map_signal(sig_d));
+
+			module->remove(cell);
+			return;
+		}
 
-	if (clk_sig.size() != 0)
-		mark_port(clk_sig);
+		if (cell->type.in("$_BUF_", "$_NOT_"))
+		{
+			RTLIL::SigSpec sig_a = cell->getPort("\\A");
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+			assign_map.apply(sig_a);
+			assign_map.apply(sig_y);
+
+			map_signal(sig_y, cell->type == "$_BUF_" ? G(BUF) : G(NOT), map_signal(sig_a));
+
+			module->remove(cell);
+			return;
+		}
+
+		if (cell->type.in("$_AND_", "$_NAND_", "$_OR_", "$_NOR_", "$_XOR_", "$_XNOR_"))
+		{
+			RTLIL::SigSpec sig_a = cell->getPort("\\A");
+			RTLIL::SigSpec sig_b = cell->getPort("\\B");
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+			assign_map.apply(sig_a);
+			assign_map.apply(sig_b);
+			assign_map.apply(sig_y);
+
+			int mapped_a = map_signal(sig_a);
+			int mapped_b = map_signal(sig_b);
+
+			if (cell->type == "$_AND_")
+				map_signal(sig_y, G(AND), mapped_a, mapped_b);
+			else if (cell->type == "$_NAND_")
+				map_signal(sig_y, G(NAND), mapped_a, mapped_b);
+			else if (cell->type == "$_OR_")
+				map_signal(sig_y, G(OR), mapped_a, mapped_b);
+			else if (cell->type == "$_NOR_")
+				map_signal(sig_y, G(NOR), mapped_a, mapped_b);
+			else if (cell->type == "$_XOR_")
+				map_signal(sig_y, G(XOR), mapped_a, mapped_b);
+			else if (cell->type == "$_XNOR_")
+				map_signal(sig_y, G(XNOR), mapped_a, mapped_b);
+			else
+				log_abort();
+
+			module->remove(cell);
+			return;
+		}
 
-	if (en_sig.size() != 0)
-		mark_port(en_sig);
+		if (cell->type == "$_MUX_")
+		{
+			RTLIL::SigSpec sig_a = cell->getPort("\\A");
+			RTLIL::SigSpec sig_b = cell->getPort("\\B");
+			RTLIL::SigSpec sig_s = cell->getPort("\\S");
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
 
-	handle_loops();
+			assign_map.apply(sig_a);
+			assign_map.apply(sig_b);
+			assign_map.apply(sig_s);
+			assign_map.apply(sig_y);
 
-	std::string buffer = stringf("%s/input.blif", tempdir_name.c_str());
-	f = fopen(buffer.c_str(), "wt");
-	if (f == NULL)
-		log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
+			int mapped_a = map_signal(sig_a);
+			int mapped_b = map_signal(sig_b);
+			int mapped_s = map_signal(sig_s);
 
-	fprintf(f, ".model netlist\n");
+			map_signal(sig_y, G(MUX), mapped_a, mapped_b, mapped_s);
 
-	int count_input = 0;
-	fprintf(f, ".inputs");
-	for (auto &si : signal_list) {
-		if (!si.is_port || si.type != G(NONE))
-			continue;
-		fprintf(f, " n%d", si.id);
-		count_input++;
+			module->remove(cell);
+			return;
+		}
+
+		if (cell->type.in("$_AOI3_", "$_OAI3_"))
+		{
+			RTLIL::SigSpec sig_a = cell->getPort("\\A");
+			RTLIL::SigSpec sig_b = cell->getPort("\\B");
+			RTLIL::SigSpec sig_c = cell->getPort("\\C");
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+			assign_map.apply(sig_a);
+			assign_map.apply(sig_b);
+			assign_map.apply(sig_c);
+			assign_map.apply(sig_y);
+
+			int mapped_a = map_signal(sig_a);
+			int mapped_b = map_signal(sig_b);
+			int mapped_c = map_signal(sig_c);
+
+			map_signal(sig_y, cell->type == "$_AOI3_" ? G(AOI3) : G(OAI3), mapped_a, mapped_b, mapped_c);
+
+			module->remove(cell);
+			return;
+		}
+
+		if (cell->type.in("$_AOI4_", "$_OAI4_"))
+		{
+			RTLIL::SigSpec sig_a = cell->getPort("\\A");
+			RTLIL::SigSpec sig_b = cell->getPort("\\B");
+			RTLIL::SigSpec sig_c = cell->getPort("\\C");
+			RTLIL::SigSpec sig_d = cell->getPort("\\D");
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+			assign_map.apply(sig_a);
+			assign_map.apply(sig_b);
+			assign_map.apply(sig_c);
+			assign_map.apply(sig_d);
+			assign_map.apply(sig_y);
+
+			int mapped_a = map_signal(sig_a);
+			int mapped_b = map_signal(sig_b);
+			int mapped_c = map_signal(sig_c);
+			int mapped_d = map_signal(sig_d);
+
+			map_signal(sig_y, cell->type == "$_AOI4_" ? G(AOI4) : G(OAI4), mapped_a, mapped_b, mapped_c, mapped_d);
+
+			module->remove(cell);
+			return;
+		}
 	}
-	if (count_input == 0)
-		fprintf(f, " dummy_input\n");
-	fprintf(f, "\n");
-
-	int count_output = 0;
-	fprintf(f, ".outputs");
-	for (auto &si : signal_list) {
-		if (!si.is_port || si.type == G(NONE))
-			continue;
-		fprintf(f, " n%d", si.id);
-		count_output++;
+
+
+	std::string remap_name(RTLIL::IdString abc_name)
+	{
+		std::stringstream sstr;
+		sstr << "$abc$" << map_autoidx << "$" << abc_name.substr(1);
+		return sstr.str();
 	}
-	fprintf(f, "\n");
 
-	for (auto &si : signal_list)
-		fprintf(f, "# n%-5d %s\n", si.id, log_signal(si.bit));
+	void dump_loop_graph(FILE *f, int &nr, std::map<int, std::set<int>> &edges, std::set<int> &workpool, std::vector<int> &in_counts)
+	{
+		if (f == NULL)
+			return;
+
+		log("Dumping loop state graph to slide %d.\n", ++nr);
+
+		fprintf(f, "digraph \"slide%d\" {\n", nr);
+		fprintf(f, "  label=\"slide%d\";\n", nr);
+		fprintf(f, "  rankdir=\"TD\";\n");
 
-	for (auto &si : signal_list) {
-		if (si.bit.wire == NULL) {
-			fprintf(f, ".names n%d\n", si.id);
-			if (si.bit == RTLIL::State::S1)
-				fprintf(f, "1\n");
+		std::set<int> nodes;
+		for (auto &e : edges) {
+			nodes.insert(e.first);
+			for (auto n : e.second)
+				nodes.insert(n);
 		}
-	}
 
-	int count_gates = 0;
-	for (auto &si : signal_list) {
-		if (si.type == G(BUF)) {
-			fprintf(f, ".names n%d n%d\n", si.in1, si.id);
-			fprintf(f, "1 1\n");
-		} else if (si.type == G(NOT)) {
-			fprintf(f, ".names n%d n%d\n", si.in1, si.id);
-			fprintf(f, "0 1\n");
-		} else if (si.type == G(AND)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "11 1\n");
-		} else if (si.type == G(NAND)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "0- 1\n");
-			fprintf(f, "-0 1\n");
-		} else if (si.type == G(OR)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "-1 1\n");
-			fprintf(f, "1- 1\n");
-		} else if (si.type == G(NOR)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "00 1\n");
-		} else if (si.type == G(XOR)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "01 1\n");
-			fprintf(f, "10 1\n");
-		} else if (si.type == G(XNOR)) {
-			fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
-			fprintf(f, "00 1\n");
-			fprintf(f, "11 1\n");
-		} else if (si.type == G(MUX)) {
-			fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "1-0 1\n");
-			fprintf(f, "-11 1\n");
-		} else if (si.type == G(AOI3)) {
-			fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "-00 1\n");
-			fprintf(f, "0-0 1\n");
-		} else if (si.type == G(OAI3)) {
-			fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
-			fprintf(f, "00- 1\n");
-			fprintf(f, "--0 1\n");
-		} else if (si.type == G(AOI4)) {
-			fprintf(f, ".names n%d n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
-			fprintf(f, "-0-0 1\n");
-			fprintf(f, "-00- 1\n");
-			fprintf(f, "0--0 1\n");
-			fprintf(f, "0-0- 1\n");
-		} else if (si.type == G(OAI4)) {
-			fprintf(f, ".names n%d n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
-			fprintf(f, "00-- 1\n");
-			fprintf(f, "--00 1\n");
-		} else if (si.type == G(FF)) {
-			fprintf(f, ".latch n%d n%d\n", si.in1, si.id);
-		} else if (si.type != G(NONE))
-			log_abort();
-		if (si.type != G(NONE))
-			count_gates++;
+		for (auto n : nodes)
+			fprintf(f, "  n%d [label=\"%s\\nid=%d, count=%d\"%s];\n", n, log_signal(signal_list[n].bit),
+					n, in_counts[n], workpool.count(n) ? ", shape=box" : "");
+
+		for (auto &e : edges)
+		for (auto n : e.second)
+			fprintf(f, "  n%d -> n%d;\n", e.first, n);
+
+		fprintf(f, "}\n");
 	}
 
-	fprintf(f, ".end\n");
-	fclose(f);
+	void handle_loops()
+	{
+		// most gate netlists have no loops, and finding that out with the dense
+		// SCC engine is much cheaper than the loop breaking below
+		SccGraph graph;
+		graph.resize(GetSize(signal_list));
+		for (auto &g : signal_list) {
+			if (g.type == G(NONE) || g.type == G(FF))
+				continue;
+			for (int in : {g.in1, g.in2, g.in3, g.in4})
+				if (in >= 0)
+					graph.add_edge(in, g.id);
+		}
+		if (graph.find_sccs().empty())
+			return;
+
+		// http://en.wikipedia.org/wiki/Topological_sorting
+		// (Kahn, Arthur B. (1962), "Topological sorting of large networks")
+
+		std::map<int, std::set<int>> edges;
+		std::vector<int> in_edges_count(signal_list.size());
+		std::set<int> workpool;
+
+		FILE *dot_f = NULL;
+		int dot_nr = 0;
+
+		// uncomment for troubleshooting the loop detection code
+		// dot_f = fopen("test.dot", "w");
+
+		for (auto &g : signal_list) {
+			if (g.type == G(NONE) || g.type == G(FF)) {
+				workpool.insert(g.id);
+			} else {
+				if (g.in1 >= 0) {
+					edges[g.in1].insert(g.id);
+					in_edges_count[g.id]++;
+				}
+				if (g.in2 >= 0 && g.in2 != g.in1) {
+					edges[g.in2].insert(g.id);
+					in_edges_count[g.id]++;
+				}
+				if (g.in3 >= 0 && g.in3 != g.in2 && g.in3 != g.in1) {
+					edges[g.in3].insert(g.id);
+					in_edges_count[g.id]++;
+				}
+				if (g.in4 >= 0 && g.in4 != g.in3 && g.in4 != g.in2 && g.in4 != g.in1) {
+					edges[g.in4].insert(g.id);
+					in_edges_count[g.id]++;
+				}
+			}
+		}
+
+		dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
+
+		while (workpool.size() > 0)
+		{
+			int id = *workpool.begin();
+			workpool.erase(id);
+
+			// log("Removing non-loop node %d from graph: %s\n", id, log_signal(signal_list[id].bit));
+
+			for (int id2 : edges[id]) {
+				log_assert(in_edges_count[id2] > 0);
+				if (--in_edges_count[id2] == 0)
+					workpool.insert(id2);
+			}
+			edges.erase(id);
+
+			dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
+
+			while (workpool.size() == 0)
+			{
+				if (edges.size() == 0)
+					break;
+
+				int id1 = edges.begin()->first;
+
+				for (auto &edge_it : edges) {
+					int id2 = edge_it.first;
+					RTLIL::Wire *w1 = signal_list[id1].bit.wire;
+					RTLIL::Wire *w2 = signal_list[id2].bit.wire;
+					if (w1 == NULL)
+						id1 = id2;
+					else if (w2 == NULL)
+						continue;
+					else if (w1->name[0] == '$' && w2->name[0] == '\\')
+						id1 = id2;
+					else if (w1->name[0] == '\\' && w2->name[0] == '$')
+						continue;
+					else if (edges[id1].size() < edges[id2].size())
+						id1 = id2;
+					else if (edges[id1].size() > edges[id2].size())
+						continue;
+					else if (w2->name.str() < w1->name.str())
+						id1 = id2;
+				}
+
+				if (edges[id1].size() == 0) {
+					edges.erase(id1);
+					continue;
+				}
+
+				log_assert(signal_list[id1].bit.wire != NULL);
+
+				std::stringstream sstr;
+				sstr << "$abcloop$" << (autoidx++);
+				RTLIL::Wire *wire = module->addWire(sstr.str());
+
+				bool first_line = true;
+				for (int id2 : edges[id1]) {
+					if (first_line)
+						log("Breaking loop using new signal %s: %s -> %s\n", log_signal(RTLIL::SigSpec(wire)),
+								log_signal(signal_list[id1].bit), log_signal(signal_list[id2].bit));
+					else
+						log("                               %*s  %s -> %s\n", int(strlen(log_signal(RTLIL::SigSpec(wire)))), "",
+								log_signal(signal_list[id1].bit), log_signal(signal_list[id2].bit));
+					first_line = false;
+				}
+
+				int id3 = map_signal(RTLIL::SigSpec(wire));
+				signal_list[id1].is_port = true;
+				signal_list[id3].is_port = true;
+				log_assert(id3 == int(in_edges_count.size()));
+				in_edges_count.push_back(0);
+				workpool.insert(id3);
+
+				for (int id2 : edges[id1]) {
+					if (signal_list[id2].in1 == id1)
+						signal_list[id2].in1 = id3;
+					if (signal_list[id2].in2 == id1)
+						signal_list[id2].in2 = id3;
+					if (signal_list[id2].in3 == id1)
+						signal_list[id2].in3 = id3;
+					if (signal_list[id2].in4 == id1)
+						signal_list[id2].in4 = id3;
+				}
+				edges[id1].swap(edges[id3]);
+
+				module->connect(RTLIL::SigSig(signal_list[id3].bit, signal_list[id1].bit));
+				dump_loop_graph(dot_f, dot_nr, edges, workpool, in_edges_count);
+			}
+		}
+
+		if (dot_f != NULL)
+			fclose(dot_f);
+	}
 
-	log("Extracted %d gates and %d wires to a netlist network with %d inputs and %d outputs.\n",
-			count_gates, GetSize(signal_list), count_input, count_output);
-	log_push();
 
-	if (count_output > 0)
+	void extract(std::string script_file, std::string exe_file, std::string liberty_file, std::string constr_file,
+			vector<int> lut_costs, bool dff_mode, std::string clk_str, bool keepff, std::string delay_target, bool fast_mode,
+			const std::vector<RTLIL::Cell*> &cells)
 	{
-		log_header("Executing ABC.\n");
+		tempdir_name = "/tmp/yosys-abc-XXXXXX";
+		if (!cleanup)
+			tempdir_name[0] = tempdir_name[4] = '_';
+		tempdir_name = make_temp_dir(tempdir_name);
+		log_header("Extracting gate netlist of module `%s' to `%s/input.blif'..\n",
+				module->name.c_str(), replace_tempdir(tempdir_name, tempdir_name, show_tempdir).c_str());
+
+		std::string abc_script_read = stringf("read_blif %s/input.blif; ", tempdir_name.c_str());
+		std::string abc_script_lib, abc_script_main;
+
+		if (!liberty_file.empty()) {
+			abc_script_lib += stringf("read_lib -w %s; ", liberty_file.c_str());
+			if (!constr_file.empty())
+				abc_script_lib += stringf("read_constr -v %s; ", constr_file.c_str());
+		} else
+		if (!lut_costs.empty())
+			abc_script_lib += stringf("read_lut %s/lutdefs.txt; ", tempdir_name.c_str());
+		else
+			abc_script_lib += stringf("read_library %s/stdcells.genlib; ", tempdir_name.c_str());
+
+		if (!script_file.empty()) {
+			if (script_file[0] == '+') {
+				for (size_t i = 1; i < script_file.size(); i++)
+					if (script_file[i] == '\'')
+						abc_script_main += "'\\''";
+					else if (script_file[i] == ',')
+						abc_script_main += " ";
+					else
+						abc_script_main += script_file[i];
+			} else
+				abc_script_main += stringf("source %s", script_file.c_str());
+		} else if (!lut_costs.empty()) {
+			bool all_luts_cost_same = true;
+			for (int this_cost : lut_costs)
+				if (this_cost != lut_costs.front())
+					all_luts_cost_same = false;
+			abc_script_main += fast_mode ? ABC_FAST_COMMAND_LUT : ABC_COMMAND_LUT;
+			if (all_luts_cost_same && !fast_mode)
+				abc_script_main += "; lutpack";
+		} else if (!liberty_file.empty())
+			abc_script_main += constr_file.empty() ? (fast_mode ? ABC_FAST_COMMAND_LIB : ABC_COMMAND_LIB) : (fast_mode ? ABC_FAST_COMMAND_CTR : ABC_COMMAND_CTR);
+		else
+			abc_script_main += fast_mode ? ABC_FAST_COMMAND_DFL : ABC_COMMAND_DFL;
+
+		abc_script_main += stringf("; write_blif %s/output.blif", tempdir_name.c_str());
+
+		auto finalize_script = [&](std::string abc_script) {
+			for (size_t pos = abc_script.find("{D}"); pos != std::string::npos; pos = abc_script.find("{D}", pos))
+				abc_script = abc_script.substr(0, pos) + delay_target + abc_script.substr(pos+3);
+
+			abc_script = add_echos_to_abc_cmd(abc_script);
+
+			for (size_t i = 0; i+1 < abc_script.size(); i++)
+				if (abc_script[i] == ';' && abc_script[i+1] == ' ')
+					abc_script[i+1] = '\n';
+			return abc_script;
+		};
+
+		std::string abc_script = finalize_script(abc_script_read + abc_script_lib + abc_script_main);
+		abc_script_nolib = finalize_script(abc_script_read + abc_script_main);
+		cache_file = abc_script;
+
+		FILE *f = fopen(stringf("%s/abc.script", tempdir_name.c_str()).c_str(), "wt");
+		fprintf(f, "%s\n", abc_script.c_str());
+		fclose(f);
+
+		if (!clk_str.empty() && clk_str != "$")
+		{
+			if (clk_str.find(',') != std::string::npos) {
+				int pos = clk_str.find(',');
+				std::string en_str = clk_str.substr(pos+1);
+				clk_str = clk_str.substr(0, pos);
+				if (en_str[0] == '!') {
+					en_polarity = false;
+					en_str = en_str.substr(1);
+				}
+				if (module->wires_.count(RTLIL::escape_id(en_str)) != 0)
+					en_sig = assign_map(RTLIL::SigSpec(module->wires_.at(RTLIL::escape_id(en_str)), 0));
+			}
+			if (clk_str[0] == '!') {
+				clk_polarity = false;
+				clk_str = clk_str.substr(1);
+			}
+			if (module->wires_.count(RTLIL::escape_id(clk_str)) != 0)
+				clk_sig = assign_map(RTLIL::SigSpec(module->wires_.at(RTLIL::escape_id(clk_str)), 0));
+		}
+
+		if (dff_mode && clk_sig.empty())
+			log_error("Clock domain %s not found.\n", clk_str.c_str());
+
+		if (dff_mode || !clk_str.empty())
+		{
+			if (clk_sig.size() == 0)
+				log("No%s clock domain found. Not extracting any FF cells.\n", clk_str.empty() ? "" : " matching");
+			else {
+				log("Found%s %s clock domain: %s", clk_str.empty() ? "" : " matching", clk_polarity ? "posedge" : "negedge", log_signal(clk_sig));
+				if (en_sig.size() != 0)
+					log(", enabled by %s%s", en_polarity ? "" : "!", log_signal(en_sig));
+				log("\n");
+			}
+		}
+
+		for (auto c : cells)
+			extract_cell(c, keepff);
+
+		for (auto &wire_it : module->wires_) {
+			if (wire_it.second->port_id > 0 || wire_it.second->get_bool_attribute("\\keep"))
+				mark_port(RTLIL::SigSpec(wire_it.second));
+		}
+
+		for (auto &cell_it : module->cells_)
+		for (auto &port_it : cell_it.second->connections())
+			mark_port(port_it.second);
+
+		if (clk_sig.size() != 0)
+			mark_port(clk_sig);
+
+		if (en_sig.size() != 0)
+			mark_port(en_sig);
+
+		if (pending_ports != nullptr)
+			for (auto bit : *pending_ports)
+				mark_port(bit);
+
+		handle_loops();
+
+		std::string buffer = stringf("%s/input.blif", tempdir_name.c_str());
+		f = fopen(buffer.c_str(), "wt");
+		if (f == NULL)
+			log_error("Opening %s for writing failed: %s\n", buffer.c_str(), strerror(errno));
+
+		fprintf(f, ".model netlist\n");
+
+		int count_input = 0;
+		fprintf(f, ".inputs");
+		for (auto &si : signal_list) {
+			if (!si.is_port || si.type != G(NONE))
+				continue;
+			fprintf(f, " n%d", si.id);
+			count_input++;
+		}
+		if (count_input == 0)
+			fprintf(f, " dummy_input\n");
+		fprintf(f, "\n");
+
+		int count_output = 0;
+		fprintf(f, ".outputs");
+		for (auto &si : signal_list) {
+			if (!si.is_port || si.type == G(NONE))
+				continue;
+			fprintf(f, " n%d", si.id);
+			count_output++;
+		}
+		fprintf(f, "\n");
+
+		for (auto &si : signal_list)
+			fprintf(f, "# n%-5d %s\n", si.id, log_signal(si.bit));
+
+		for (auto &si : signal_list) {
+			if (si.bit.wire == NULL) {
+				fprintf(f, ".names n%d\n", si.id);
+				if (si.bit == RTLIL::State::S1)
+					fprintf(f, "1\n");
+			}
+		}
+
+		int count_gates = 0;
+		for (auto &si : signal_list) {
+			if (si.type == G(BUF)) {
+				fprintf(f, ".names n%d n%d\n", si.in1, si.id);
+				fprintf(f, "1 1\n");
+			} else if (si.type == G(NOT)) {
+				fprintf(f, ".names n%d n%d\n", si.in1, si.id);
+				fprintf(f, "0 1\n");
+			} else if (si.type == G(AND)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "11 1\n");
+			} else if (si.type == G(NAND)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "0- 1\n");
+				fprintf(f, "-0 1\n");
+			} else if (si.type == G(OR)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "-1 1\n");
+				fprintf(f, "1- 1\n");
+			} else if (si.type == G(NOR)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "00 1\n");
+			} else if (si.type == G(XOR)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "01 1\n");
+				fprintf(f, "10 1\n");
+			} else if (si.type == G(XNOR)) {
+				fprintf(f, ".names n%d n%d n%d\n", si.in1, si.in2, si.id);
+				fprintf(f, "00 1\n");
+				fprintf(f, "11 1\n");
+			} else if (si.type == G(MUX)) {
+				fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
+				fprintf(f, "1-0 1\n");
+				fprintf(f, "-11 1\n");
+			} else if (si.type == G(AOI3)) {
+				fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
+				fprintf(f, "-00 1\n");
+				fprintf(f, "0-0 1\n");
+			} else if (si.type == G(OAI3)) {
+				fprintf(f, ".names n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.id);
+				fprintf(f, "00- 1\n");
+				fprintf(f, "--0 1\n");
+			} else if (si.type == G(AOI4)) {
+				fprintf(f, ".names n%d n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
+				fprintf(f, "-0-0 1\n");
+				fprintf(f, "-00- 1\n");
+				fprintf(f, "0--0 1\n");
+				fprintf(f, "0-0- 1\n");
+			} else if (si.type == G(OAI4)) {
+				fprintf(f, ".names n%d n%d n%d n%d n%d\n", si.in1, si.in2, si.in3, si.in4, si.id);
+				fprintf(f, "00-- 1\n");
+				fprintf(f, "--00 1\n");
+			} else if (si.type == G(FF)) {
+				fprintf(f, ".latch n%d n%d\n", si.in1, si.id);
+			} else if (si.type != G(NONE))
+				log_abort();
+			if (si.type != G(NONE))
+				count_gates++;
+		}
+
+		fprintf(f, ".end\n");
+		fclose(f);
+
+		log("Extracted %d gates and %d wires to a netlist network with %d inputs and %d outputs.\n",
+				count_gates, GetSize(signal_list), count_input, count_output);
+
+		if (count_output == 0)
+			return;
 
 		buffer = stringf("%s/stdcells.genlib", tempdir_name.c_str());
 		f = fopen(buffer.c_str(), "wt");
@@ -884,285 +1099,474 @@ void abc_module(RTLIL::Design *design, RTLIL::Module *current_module, std::strin
 			fclose(f);
 		}
 
-		buffer = stringf("%s -s -f %s/abc.script 2>&1", exe_file.c_str(), tempdir_name.c_str());
-		log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
-
-		abc_output_filter filt(tempdir_name, show_tempdir);
-		int ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
-		if (ret != 0)
-			log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
-
-		buffer = stringf("%s/%s", tempdir_name.c_str(), "output.blif");
-		std::ifstream ifs;
-		ifs.open(buffer);
-		if (ifs.fail())
-			log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
-
-		bool builtin_lib = liberty_file.empty() && script_file.empty() && lut_costs.empty();
-		RTLIL::Design *mapped_design = new RTLIL::Design;
-		parse_blif(mapped_design, ifs, builtin_lib ? "\\DFF" : "\\_dff_");
-
-		ifs.close();
-
-		log_header("Re-integrating ABC results.\n");
-		RTLIL::Module *mapped_mod = mapped_design->modules_["\\netlist"];
-		if (mapped_mod == NULL)
-			log_error("ABC output file does not contain a module `netlist'.\n");
-		for (auto &it : mapped_mod->wires_) {
-			RTLIL::Wire *w = it.second;
-			RTLIL::Wire *wire = module->addWire(remap_name(w->name));
-			if (markgroups) wire->attributes["\\abcgroup"] = map_autoidx;
-			design->select(module, wire);
+		builtin_lib = liberty_file.empty() && script_file.empty() && lut_costs.empty();
+		linked_abc = exe_file.empty();
+		abc_command = stringf("%s -s -f %s/abc.script", linked_abc ? "<linked-abc>" : exe_file.c_str(), tempdir_name.c_str());
+
+		if (!cache_dir.empty() && count_output > 0)
+			lookup_cache(cache_file);
+		else
+			cache_file.clear();
+	}
+
+	// the key is a hash of the script (with the temp dir name replaced) and
+	// of the files that ABC reads from the temp dir
+	void lookup_cache(std::string abc_script)
+	{
+		SHA1 hasher;
+		hasher.update(cache_salt);
+		hasher.update(replace_tempdir(abc_script, tempdir_name, false));
+		for (auto name : {"input.blif", "stdcells.genlib", "lutdefs.txt"}) {
+			std::ifstream f(stringf("%s/%s", tempdir_name.c_str(), name).c_str(), std::ios::binary);
+			hasher.update(stringf("\n%s\n", name));
+			if (!f.fail())
+				hasher.update(f);
 		}
 
-		std::map<std::string, int> cell_stats;
-		if (builtin_lib)
+		cache_file = stringf("%s/abc-%s.blif", cache_dir.c_str(), hasher.final().c_str());
+		cache_hit = check_file_exists(cache_file);
+	}
+
+	void store_cache()
+	{
+		std::string output_file = stringf("%s/output.blif", tempdir_name.c_str());
+		std::string tmp_file = make_temp_file(cache_file + ".XXXXXX");
 		{
-			for (auto &it : mapped_mod->cells_) {
-				RTLIL::Cell *c = it.second;
-				cell_stats[RTLIL::unescape_id(c->type)]++;
-				if (c->type == "\\ZERO" || c->type == "\\ONE") {
-					RTLIL::SigSig conn;
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
-					conn.second = RTLIL::SigSpec(c->type == "\\ZERO" ? 0 : 1, 1);
-					module->connect(conn);
-					continue;
-				}
-				if (c->type == "\\BUF") {
-					RTLIL::SigSig conn;
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
-					conn.second = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]);
-					module->connect(conn);
-					continue;
-				}
-				if (c->type == "\\NOT") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_NOT_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\AND" || c->type == "\\OR" || c->type == "\\XOR" || c->type == "\\NAND" || c->type == "\\NOR" || c->type == "\\XNOR") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX4") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX4_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX8") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX8_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
-					cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
-					cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
-					cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\MUX16") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX16_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
-					cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
-					cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
-					cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
-					cell->setPort("\\I", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\I").as_wire()->name)]));
-					cell->setPort("\\J", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\J").as_wire()->name)]));
-					cell->setPort("\\K", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\K").as_wire()->name)]));
-					cell->setPort("\\L", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\L").as_wire()->name)]));
-					cell->setPort("\\M", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\M").as_wire()->name)]));
-					cell->setPort("\\N", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\N").as_wire()->name)]));
-					cell->setPort("\\O", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\O").as_wire()->name)]));
-					cell->setPort("\\P", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\P").as_wire()->name)]));
-					cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
-					cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
-					cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
-					cell->setPort("\\V", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\V").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "\\AOI3" || c->type == "\\OAI3") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
+			std::ifstream src(output_file.c_str(), std::ios::binary);
+			std::ofstream dst(tmp_file.c_str(), std::ios::binary);
+			dst << src.rdbuf();
+			dst.close();
+			if (!src.fail() && !dst.fail() && rename(tmp_file.c_str(), cache_file.c_str()) == 0)
+				return;
+		}
+		log_warning("Can't write ABC cache file `%s'.\n", cache_file.c_str());
+		remove(tmp_file.c_str());
+	}
+
+#ifdef YOSYS_LINK_ABC
+	// run the ABC that is linked into this binary, with stdout and stderr
+	// redirected to abc.log in the temp directory
+	int run_linked_abc()
+	{
+		std::string script_name = stringf("%s/abc.script", tempdir_name.c_str());
+		std::string log_name = stringf("%s/abc.log", tempdir_name.c_str());
+
+		fflush(stdout);
+		fflush(stderr);
+
+		int log_fd = open(log_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (log_fd < 0)
+			log_error("Opening %s for writing failed: %s\n", log_name.c_str(), strerror(errno));
+		int saved_stdout = dup(1), saved_stderr = dup(2);
+		dup2(log_fd, 1);
+		dup2(log_fd, 2);
+		close(log_fd);
+
+		// ABC parses its arguments with getopt, so they must be writable
+		char *abc_argv[5] = { strdup("yosys-abc"), strdup("-s"), strdup("-f"), strdup(script_name.c_str()), nullptr };
+		int ret = Abc_RealMain(4, abc_argv);
+		for (int i = 0; i < 4; i++)
+			free(abc_argv[i]);
+
+		fflush(stdout);
+		fflush(stderr);
+		dup2(saved_stdout, 1);
+		dup2(saved_stderr, 2);
+		close(saved_stdout);
+		close(saved_stderr);
+		return ret;
+	}
+#endif
+
+	void start()
+	{
+		if (count_output == 0 || abc_pipe != nullptr || abc_pid >= 0 || server_job_started || cache_hit)
+			return;
+
+#ifdef ABC_PERSISTENT_SUPPORTED
+		if (server != nullptr) {
+			std::string script_name = stringf("%s/abc.script", tempdir_name.c_str());
+			if (server->lib_loaded) {
+				FILE *f = fopen(script_name.c_str(), "wt");
+				fprintf(f, "%s\n", abc_script_nolib.c_str());
+				fclose(f);
+			}
+			server->lib_loaded = true;
+			abc_command = stringf("<persistent-abc-%d> source %s", server->id, script_name.c_str());
+			if (!server->start_job(script_name))
+				log_error("ABC: sending script to persistent ABC process %d failed.\n", server->id);
+			server_job_started = true;
+			return;
+		}
+#endif
+
+#ifdef YOSYS_LINK_ABC
+		if (linked_abc) {
+			fflush(stdout);
+			fflush(stderr);
+			abc_pid = fork();
+			if (abc_pid < 0)
+				log_error("ABC: fork() failed: %s\n", strerror(errno));
+			if (abc_pid == 0)
+				_exit(run_linked_abc());
+			return;
+		}
+#endif
+
+		std::string buffer = stringf("%s > %s/abc.log 2>&1", abc_command.c_str(), tempdir_name.c_str());
+		abc_pipe = popen(buffer.c_str(), "r");
+		if (abc_pipe == nullptr)
+			log_error("ABC: starting command \"%s\" failed: %s\n", buffer.c_str(), strerror(errno));
+	}
+
+	int wait_for_abc()
+	{
+#ifdef YOSYS_LINK_ABC
+		if (abc_pid >= 0) {
+			int status;
+			if (waitpid(abc_pid, &status, 0) < 0)
+				status = -1;
+			abc_pid = -1;
+			if (status < 0 || !WIFEXITED(status))
+				return -1;
+			return WEXITSTATUS(status);
+		}
+#endif
+		int ret = pclose(abc_pipe);
+		abc_pipe = nullptr;
+		if (ret < 0)
+			return -1;
+#ifdef _WIN32
+		return ret;
+#else
+		return WEXITSTATUS(ret);
+#endif
+	}
+
+	void finish(RTLIL::Design *design)
+	{
+		log_push();
+
+		if (count_output > 0)
+		{
+			log_header("Executing ABC.\n");
+
+			if (cache_hit)
+				log("Using cached ABC result `%s'.\n", cache_file.c_str());
+			else
+			{
+				if (server != nullptr)
+					start();
+
+				std::string buffer = abc_command + " 2>&1";
+				log("Running ABC command: %s\n", replace_tempdir(buffer, tempdir_name, show_tempdir).c_str());
+
+				abc_output_filter filt(tempdir_name, show_tempdir);
+				int ret;
+				bool from_log = true;
+#ifdef ABC_PERSISTENT_SUPPORTED
+				if (server_job_started) {
+					ret = server->finish_job(filt) ? 0 : -1;
+					from_log = false;
+				} else
+#endif
+				if (abc_pipe != nullptr || abc_pid >= 0)
+					ret = wait_for_abc();
+#ifdef YOSYS_LINK_ABC
+				else if (linked_abc)
+					ret = run_linked_abc();
+#endif
+				else {
+					ret = run_command(buffer, std::bind(&abc_output_filter::next_line, filt, std::placeholders::_1));
+					from_log = false;
 				}
-				if (c->type == "\\AOI4" || c->type == "\\OAI4") {
-					RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
-					cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
-					cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
-					design->select(module, cell);
-					continue;
+				if (from_log) {
+					std::ifstream abc_log(stringf("%s/abc.log", tempdir_name.c_str()));
+					std::string line;
+					while (std::getline(abc_log, line))
+						filt.next_line(line + "\n");
 				}
-				if (c->type == "\\DFF") {
-					log_assert(clk_sig.size() == 1);
-					RTLIL::Cell *cell;
-					if (en_sig.size() == 0) {
-						cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
-					} else {
-						log_assert(en_sig.size() == 1);
-						cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
-						cell->setPort("\\E", en_sig);
+				if (ret != 0)
+					log_error("ABC: execution of command \"%s\" failed: return code %d.\n", buffer.c_str(), ret);
+			}
+
+			std::string buffer = cache_hit ? cache_file : stringf("%s/%s", tempdir_name.c_str(), "output.blif");
+			std::ifstream ifs;
+			ifs.open(buffer);
+			if (ifs.fail())
+				log_error("Can't open ABC output file `%s'.\n", buffer.c_str());
+
+			RTLIL::Design *mapped_design = new RTLIL::Design;
+			{
+				MappedFile file(ifs, buffer);
+				parse_blif(mapped_design, file.data, file.size, builtin_lib ? "\\DFF" : "\\_dff_");
+			}
+
+			ifs.close();
+
+			log_header("Re-integrating ABC results.\n");
+			RTLIL::Module *mapped_mod = mapped_design->modules_["\\netlist"];
+			if (mapped_mod == NULL)
+				log_error("ABC output file does not contain a module `netlist'.\n");
+			if (!cache_file.empty() && !cache_hit)
+				store_cache();
+			for (auto &it : mapped_mod->wires_) {
+				RTLIL::Wire *w = it.second;
+				RTLIL::Wire *wire = module->addWire(remap_name(w->name));
+				if (markgroups) wire->attributes["\\abcgroup"] = map_autoidx;
+				design->select(module, wire);
+			}
+
+			std::map<std::string, int> cell_stats;
+			if (builtin_lib)
+			{
+				for (auto &it : mapped_mod->cells_) {
+					RTLIL::Cell *c = it.second;
+					cell_stats[RTLIL::unescape_id(c->type)]++;
+					if (c->type == "\\ZERO" || c->type == "\\ONE") {
+						RTLIL::SigSig conn;
+						conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
+						conn.second = RTLIL::SigSpec(c->type == "\\ZERO" ? 0 : 1, 1);
+						module->connect(conn);
+						continue;
 					}
-					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
-					cell->setPort("\\C", clk_sig);
-					design->select(module, cell);
-					continue;
+					if (c->type == "\\BUF") {
+						RTLIL::SigSig conn;
+						conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]);
+						conn.second = RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]);
+						module->connect(conn);
+						continue;
+					}
+					if (c->type == "\\NOT") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_NOT_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\AND" || c->type == "\\OR" || c->type == "\\XOR" || c->type == "\\NAND" || c->type == "\\NOR" || c->type == "\\XNOR") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\MUX") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\MUX4") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX4_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+						cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\MUX8") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX8_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
+						cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
+						cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
+						cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
+						cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+						cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+						cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\MUX16") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_MUX16_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\E", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\E").as_wire()->name)]));
+						cell->setPort("\\F", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\F").as_wire()->name)]));
+						cell->setPort("\\G", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\G").as_wire()->name)]));
+						cell->setPort("\\H", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\H").as_wire()->name)]));
+						cell->setPort("\\I", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\I").as_wire()->name)]));
+						cell->setPort("\\J", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\J").as_wire()->name)]));
+						cell->setPort("\\K", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\K").as_wire()->name)]));
+						cell->setPort("\\L", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\L").as_wire()->name)]));
+						cell->setPort("\\M", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\M").as_wire()->name)]));
+						cell->setPort("\\N", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\N").as_wire()->name)]));
+						cell->setPort("\\O", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\O").as_wire()->name)]));
+						cell->setPort("\\P", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\P").as_wire()->name)]));
+						cell->setPort("\\S", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\S").as_wire()->name)]));
+						cell->setPort("\\T", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\T").as_wire()->name)]));
+						cell->setPort("\\U", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\U").as_wire()->name)]));
+						cell->setPort("\\V", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\V").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\AOI3" || c->type == "\\OAI3") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\AOI4" || c->type == "\\OAI4") {
+						RTLIL::Cell *cell = module->addCell(remap_name(c->name), "$_" + c->type.substr(1) + "_");
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\A", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\A").as_wire()->name)]));
+						cell->setPort("\\B", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\B").as_wire()->name)]));
+						cell->setPort("\\C", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\C").as_wire()->name)]));
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\Y", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)]));
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "\\DFF") {
+						log_assert(clk_sig.size() == 1);
+						RTLIL::Cell *cell;
+						if (en_sig.size() == 0) {
+							cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
+						} else {
+							log_assert(en_sig.size() == 1);
+							cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
+							cell->setPort("\\E", en_sig);
+						}
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
+						cell->setPort("\\C", clk_sig);
+						design->select(module, cell);
+						continue;
+					}
+					log_abort();
 				}
-				log_abort();
 			}
-		}
-		else
-		{
-			for (auto &it : mapped_mod->cells_)
+			else
 			{
-				RTLIL::Cell *c = it.second;
-				cell_stats[RTLIL::unescape_id(c->type)]++;
-				if (c->type == "\\_const0_" || c->type == "\\_const1_") {
-					RTLIL::SigSig conn;
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->connections().begin()->second.as_wire()->name)]);
-					conn.second = RTLIL::SigSpec(c->type == "\\_const0_" ? 0 : 1, 1);
-					module->connect(conn);
-					continue;
-				}
-				if (c->type == "\\_dff_") {
-					log_assert(clk_sig.size() == 1);
-					RTLIL::Cell *cell;
-					if (en_sig.size() == 0) {
-						cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
-					} else {
-						log_assert(en_sig.size() == 1);
-						cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
-						cell->setPort("\\E", en_sig);
+				for (auto &it : mapped_mod->cells_)
+				{
+					RTLIL::Cell *c = it.second;
+					cell_stats[RTLIL::unescape_id(c->type)]++;
+					if (c->type == "\\_const0_" || c->type == "\\_const1_") {
+						RTLIL::SigSig conn;
+						conn.first = RTLIL::SigSpec(module->wires_[remap_name(c->connections().begin()->second.as_wire()->name)]);
+						conn.second = RTLIL::SigSpec(c->type == "\\_const0_" ? 0 : 1, 1);
+						module->connect(conn);
+						continue;
 					}
+					if (c->type == "\\_dff_") {
+						log_assert(clk_sig.size() == 1);
+						RTLIL::Cell *cell;
+						if (en_sig.size() == 0) {
+							cell = module->addCell(remap_name(c->name), clk_polarity ? "$_DFF_P_" : "$_DFF_N_");
+						} else {
+							log_assert(en_sig.size() == 1);
+							cell = module->addCell(remap_name(c->name), stringf("$_DFFE_%c%c_", clk_polarity ? 'P' : 'N', en_polarity ? 'P' : 'N'));
+							cell->setPort("\\E", en_sig);
+						}
+						if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
+						cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
+						cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
+						cell->setPort("\\C", clk_sig);
+						design->select(module, cell);
+						continue;
+					}
+					if (c->type == "$lut" && GetSize(c->getPort("\\A")) == 1 && c->getParam("\\LUT").as_int() == 2) {
+						SigSpec my_a = module->wires_[remap_name(c->getPort("\\A").as_wire()->name)];
+						SigSpec my_y = module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)];
+						module->connect(my_y, my_a);
+						continue;
+					}
+					RTLIL::Cell *cell = module->addCell(remap_name(c->name), c->type);
 					if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-					cell->setPort("\\D", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\D").as_wire()->name)]));
-					cell->setPort("\\Q", RTLIL::SigSpec(module->wires_[remap_name(c->getPort("\\Q").as_wire()->name)]));
-					cell->setPort("\\C", clk_sig);
-					design->select(module, cell);
-					continue;
-				}
-				if (c->type == "$lut" && GetSize(c->getPort("\\A")) == 1 && c->getParam("\\LUT").as_int() == 2) {
-					SigSpec my_a = module->wires_[remap_name(c->getPort("\\A").as_wire()->name)];
-					SigSpec my_y = module->wires_[remap_name(c->getPort("\\Y").as_wire()->name)];
-					module->connect(my_y, my_a);
-					continue;
-				}
-				RTLIL::Cell *cell = module->addCell(remap_name(c->name), c->type);
-				if (markgroups) cell->attributes["\\abcgroup"] = map_autoidx;
-				cell->parameters = c->parameters;
-				for (auto &conn : c->connections()) {
-					RTLIL::SigSpec newsig;
-					for (auto &c : conn.second.chunks()) {
-						if (c.width == 0)
-							continue;
-						log_assert(c.width == 1);
-						newsig.append(module->wires_[remap_name(c.wire->name)]);
+					cell->parameters = c->parameters;
+					for (auto &conn : c->connections()) {
+						RTLIL::SigSpec newsig;
+						for (auto &c : conn.second.chunks()) {
+							if (c.width == 0)
+								continue;
+							log_assert(c.width == 1);
+							newsig.append(module->wires_[remap_name(c.wire->name)]);
+						}
+						cell->setPort(conn.first, newsig);
 					}
-					cell->setPort(conn.first, newsig);
+					design->select(module, cell);
 				}
-				design->select(module, cell);
 			}
-		}
-
-		for (auto conn : mapped_mod->connections()) {
-			if (!conn.first.is_fully_const())
-				conn.first = RTLIL::SigSpec(module->wires_[remap_name(conn.first.as_wire()->name)]);
-			if (!conn.second.is_fully_const())
-				conn.second = RTLIL::SigSpec(module->wires_[remap_name(conn.second.as_wire()->name)]);
-			module->connect(conn);
-		}
 
-		for (auto &it : cell_stats)
-			log("ABC RESULTS:   %15s cells: %8d\n", it.first.c_str(), it.second);
-		int in_wires = 0, out_wires = 0;
-		for (auto &si : signal_list)
-			if (si.is_port) {
-				char buffer[100];
-				snprintf(buffer, 100, "\\n%d", si.id);
-				RTLIL::SigSig conn;
-				if (si.type != G(NONE)) {
-					conn.first = si.bit;
-					conn.second = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
-					out_wires++;
-				} else {
-					conn.first = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
-					conn.second = si.bit;
-					in_wires++;
-				}
+			for (auto conn : mapped_mod->connections()) {
+				if (!conn.first.is_fully_const())
+					conn.first = RTLIL::SigSpec(module->wires_[remap_name(conn.first.as_wire()->name)]);
+				if (!conn.second.is_fully_const())
+					conn.second = RTLIL::SigSpec(module->wires_[remap_name(conn.second.as_wire()->name)]);
 				module->connect(conn);
 			}
-		log("ABC RESULTS:        internal signals: %8d\n", int(signal_list.size()) - in_wires - out_wires);
-		log("ABC RESULTS:           input signals: %8d\n", in_wires);
-		log("ABC RESULTS:          output signals: %8d\n", out_wires);
 
-		delete mapped_design;
-	}
-	else
-	{
-		log("Don't call ABC as there is nothing to map.\n");
-	}
+			for (auto &it : cell_stats)
+				log("ABC RESULTS:   %15s cells: %8d\n", it.first.c_str(), it.second);
+			int in_wires = 0, out_wires = 0;
+			for (auto &si : signal_list)
+				if (si.is_port) {
+					char buffer[100];
+					snprintf(buffer, 100, "\\n%d", si.id);
+					RTLIL::SigSig conn;
+					if (si.type != G(NONE)) {
+						conn.first = si.bit;
+						conn.second = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
+						out_wires++;
+					} else {
+						conn.first = RTLIL::SigSpec(module->wires_[remap_name(buffer)]);
+						conn.second = si.bit;
+						in_wires++;
+					}
+					module->connect(conn);
+				}
+			log("ABC RESULTS:        internal signals: %8d\n", int(signal_list.size()) - in_wires - out_wires);
+			log("ABC RESULTS:           input signals: %8d\n", in_wires);
+			log("ABC RESULTS:          output signals: %8d\n", out_wires);
 
-	if (cleanup)
-	{
-		log("Removing temp directory.\n");
-		remove_directory(tempdir_name);
-	}
+			delete mapped_design;
+		}
+		else
+		{
+			log("Don't call ABC as there is nothing to map.\n");
+		}
 
-	log_pop();
-}
+		if (cleanup)
+		{
+			log("Removing temp directory.\n");
+			remove_directory(tempdir_name);
+		}
+
+		log_pop();
+	}
+};
 
 struct AbcPass : public Pass {
 	AbcPass() : Pass("abc", "use ABC for technology mapping") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -1173,7 +1577,10 @@ struct AbcPass : public Pass {
 		log("library to a target architecture.\n");
 		log("\n");
 		log("    -exe <command>\n");
-#ifdef ABCEXTERNAL
+#if defined(YOSYS_LINK_ABC)
+		log("        use the specified command to execute ABC instead of the copy of ABC\n");
+		log("        that is linked into this yosys binary.\n");
+#elif defined(ABCEXTERNAL)
 		log("        use the specified command instead of \"" ABCEXTERNAL "\" to execute ABC.\n");
 #else
 		log("        use the specified command instead of \"<yosys-bindir>/yosys-abc\" to execute ABC.\n");
@@ -1288,6 +1695,27 @@ struct AbcPass : public Pass {
 		log("        this attribute is a unique integer for each ABC process started. This\n");
 		log("        is useful for debugging the partitioning of clock domains.\n");
 		log("\n");
+		log("    -j <N>\n");
+		log("        run up to N ABC processes in parallel. All modules (and all clock\n");
+		log("        domains of a module with -dff) are extracted first, and the ABC\n");
+		log("        results are re-integrated in the same order afterwards, so the\n");
+		log("        result does not depend on the timing of the ABC processes.\n");
+		log("\n");
+		log("    -persistent\n");
+		log("        start one ABC process (or N with -j N) for the whole command and run\n");
+		log("        the scripts for all modules and clock domains in it, instead of\n");
+		log("        starting a new ABC process for each of them. The library (-liberty,\n");
+		log("        -lut or the built-in one) is only loaded once by each ABC process.\n");
+		log("        This is faster for designs with many small modules. (Not supported\n");
+		log("        on Windows.)\n");
+		log("\n");
+		log("    -cache <dir>\n");
+		log("        store the ABC results in the given directory and reuse them when ABC\n");
+		log("        is run again for the same netlist. The results are looked up by a\n");
+		log("        hash of the netlist passed to ABC, the ABC script, the library files\n");
+		log("        and the ABC executable. By default the module cache directory set\n");
+		log("        with 'yosys -C <dir>' is used (if any).\n");
+		log("\n");
 		log("When neither -liberty nor -lut is used, the Yosys standard cell library is\n");
 		log("loaded into ABC before the ABC script is executed.\n");
 		log("\n");
@@ -1302,14 +1730,18 @@ struct AbcPass : public Pass {
 		log_header("Executing ABC pass (technology mapping using ABC).\n");
 		log_push();
 
-#ifdef ABCEXTERNAL
+#if defined(YOSYS_LINK_ABC)
+		std::string exe_file;
+#elif defined(ABCEXTERNAL)
 		std::string exe_file = ABCEXTERNAL;
 #else
 		std::string exe_file = proc_self_dirname() + "yosys-abc";
 #endif
 		std::string script_file, liberty_file, constr_file, clk_str, delay_target;
 		bool fast_mode = false, dff_mode = false, keepff = false, cleanup = true;
-		bool show_tempdir = false;
+		bool show_tempdir = false, persistent = false;
+		std::string cache_dir = yosys_module_cache_dir;
+		int num_jobs = 1;
 		vector<int> lut_costs;
 		markgroups = false;
 
@@ -1453,6 +1885,20 @@ struct AbcPass : public Pass {
 				markgroups = true;
 				continue;
 			}
+			if (arg == "-j" && argidx+1 < args.size()) {
+				num_jobs = atoi(args[++argidx].c_str());
+				if (num_jobs < 1)
+					log_cmd_error("Invalid number of ABC jobs: %s\n", args[argidx].c_str());
+				continue;
+			}
+			if (arg == "-persistent") {
+				persistent = true;
+				continue;
+			}
+			if (arg == "-cache" && argidx+1 < args.size()) {
+				cache_dir = args[++argidx];
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -1462,14 +1908,81 @@ struct AbcPass : public Pass {
 		if (!constr_file.empty() && liberty_file.empty())
 			log_cmd_error("Got -constr but no -liberty!\n");
 
+		// the workers started and not finished yet are consecutive and at
+		// most num_jobs, so worker i can use server i % num_jobs
+		std::vector<AbcServer*> servers;
+		if (persistent) {
+#ifdef ABC_PERSISTENT_SUPPORTED
+			servers.resize(num_jobs, nullptr);
+#else
+			log_cmd_error("Option -persistent is not supported on this platform.\n");
+#endif
+		}
+
+		// the cache key of each worker also covers the files that ABC reads
+		// from outside the temp dir
+		std::string cache_salt;
+		if (!cache_dir.empty()) {
+			SHA1 hasher;
+			hasher.update(yosys_version_str);
+			hasher.update(exe_file.empty() ? "<linked-abc>" : check_file_exists(exe_file) ? SHA1::from_file(exe_file) : exe_file);
+			for (auto &file : {liberty_file, constr_file, script_file})
+				hasher.update("\n" + (file.empty() || file[0] == '+' ? file : SHA1::from_file(file)));
+			cache_salt = hasher.final();
+		}
+
+		SigMap assign_map;
+		std::vector<AbcWorker*> workers;
+		int workers_started = 0, workers_finished = 0;
+
+		auto new_worker = [&](RTLIL::Module *mod) {
+			AbcWorker *worker = new AbcWorker(mod, assign_map, cleanup, show_tempdir);
+			worker->cache_dir = cache_dir;
+			worker->cache_salt = cache_salt;
+			return worker;
+		};
+
+		auto add_worker = [&](AbcWorker *worker) {
+#ifdef ABC_PERSISTENT_SUPPORTED
+			if (persistent) {
+				AbcServer *&server = servers[GetSize(workers) % num_jobs];
+				if (server == nullptr)
+					server = new AbcServer(GetSize(workers) % num_jobs, exe_file);
+				worker->server = server;
+			}
+#endif
+			workers.push_back(worker);
+		};
+
+		// with -j, workers are started as soon as they are extracted (up to
+		// num_jobs running at once) and are finished in extraction order
+		auto finish_workers = [&](int keep_pending) {
+			while (GetSize(workers) - workers_finished > keep_pending) {
+				while (workers_started < GetSize(workers) && workers_started - workers_finished < num_jobs)
+					workers[workers_started++]->start();
+				AbcWorker *worker = workers[workers_finished];
+				worker->finish(design);
+				workers[workers_finished++] = nullptr;
+				delete worker;
+			}
+			while (workers_started < GetSize(workers) && workers_started - workers_finished < num_jobs)
+				workers[workers_started++]->start();
+		};
+
 		for (auto mod : design->selected_modules())
 			if (mod->processes.size() > 0)
 				log("Skipping module %s as it contains processes.\n", log_id(mod));
 			else if (!dff_mode || !clk_str.empty())
-				abc_module(design, mod, script_file, exe_file, liberty_file, constr_file, cleanup, lut_costs, dff_mode, clk_str, keepff, delay_target, fast_mode, mod->selected_cells(), show_tempdir);
+			{
+				assign_map = mod->sigmap();
+				AbcWorker *worker = new_worker(mod);
+				worker->extract(script_file, exe_file, liberty_file, constr_file, lut_costs, dff_mode, clk_str, keepff, delay_target, fast_mode, mod->selected_cells());
+				add_worker(worker);
+				finish_workers(num_jobs > 1 ? INT_MAX : 0);
+			}
 			else
 			{
-				assign_map.set(mod);
+				assign_map = mod->sigmap();
 				CellTypes ct(design);
 
 				std::vector<RTLIL::Cell*> all_cells = mod->selected_cells();
@@ -1605,20 +2118,37 @@ struct AbcPass : public Pass {
 							std::get<0>(it.first) ? "" : "!", log_signal(std::get<1>(it.first)),
 							std::get<2>(it.first) ? "" : "!", log_signal(std::get<3>(it.first)));
 
+				pool<RTLIL::SigBit> pending_ports;
+
 				for (auto &it : assigned_cells) {
-					clk_polarity = std::get<0>(it.first);
-					clk_sig = assign_map(std::get<1>(it.first));
-					en_polarity = std::get<2>(it.first);
-					en_sig = assign_map(std::get<3>(it.first));
-					abc_module(design, mod, script_file, exe_file, liberty_file, constr_file, cleanup, lut_costs,
-							!clk_sig.empty(), "$", keepff, delay_target, fast_mode, it.second, show_tempdir);
-					assign_map.set(mod);
+					AbcWorker *worker = new_worker(mod);
+					worker->clk_polarity = std::get<0>(it.first);
+					worker->clk_sig = assign_map(std::get<1>(it.first));
+					worker->en_polarity = std::get<2>(it.first);
+					worker->en_sig = assign_map(std::get<3>(it.first));
+					worker->pending_ports = &pending_ports;
+					worker->extract(script_file, exe_file, liberty_file, constr_file, lut_costs,
+							!worker->clk_sig.empty(), "$", keepff, delay_target, fast_mode, it.second);
+					worker->pending_ports = nullptr;
+					add_worker(worker);
+					if (num_jobs > 1) {
+						for (auto &si : worker->signal_list)
+							if (si.is_port)
+								pending_ports.insert(si.bit);
+						finish_workers(INT_MAX);
+					} else
+						finish_workers(0);
+					assign_map = mod->sigmap();
 				}
 			}
 
+		finish_workers(0);
 		assign_map.clear();
-		signal_list.clear();
-		signal_map.clear();
+
+#ifdef ABC_PERSISTENT_SUPPORTED
+		for (auto server : servers)
+			delete server;
+#endif
 
 		log_pop();
 	}
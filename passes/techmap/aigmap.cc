@@ -23,6 +23,67 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// create the gates for an AIG literal and all literals it depends on,
+// without recursion as AIGs of e.g. wide adders are deep
+SigBit lit_to_bit(Module *module, const AigManager &mgr, dict<int, SigBit> &lit_bits, int root_lit, bool nand_mode)
+{
+	vector<int> stack;
+	stack.push_back(root_lit);
+
+	while (!stack.empty())
+	{
+		int lit = stack.back();
+
+		if (lit_bits.count(lit)) {
+			stack.pop_back();
+			continue;
+		}
+
+		if (mgr.is_const(lit)) {
+			lit_bits[lit] = lit == AigManager::lit_const(true) ? State::S1 : State::S0;
+			stack.pop_back();
+			continue;
+		}
+
+		auto &node = mgr.nodes[lit >> 1];
+		bool inverted = (lit & 1) != 0;
+
+		if (!inverted && mgr.is_input(lit)) {
+			lit_bits[lit] = node.bit;
+			stack.pop_back();
+			continue;
+		}
+
+		vector<int> deps;
+		if (mgr.is_and(lit) && (!inverted || nand_mode)) {
+			deps.push_back(node.left);
+			deps.push_back(node.right);
+		} else {
+			deps.push_back(AigManager::lit_not(lit));
+		}
+
+		bool ready = true;
+		for (auto dep : deps)
+			if (!lit_bits.count(dep)) {
+				stack.push_back(dep);
+				ready = false;
+			}
+		if (!ready)
+			continue;
+
+		stack.pop_back();
+
+		if (GetSize(deps) == 1)
+			lit_bits[lit] = module->NotGate(NEW_ID, lit_bits.at(deps[0]));
+		else if (inverted)
+			lit_bits[lit] = module->NandGate(NEW_ID, lit_bits.at(deps[0]), lit_bits.at(deps[1]));
+		else
+			lit_bits[lit] = module->AndGate(NEW_ID, lit_bits.at(deps[0]), lit_bits.at(deps[1]));
+	}
+
+	return lit_bits.at(root_lit);
+}
+
 struct AigmapPass : public Pass {
 	AigmapPass() : Pass("aigmap", "map logic to and-inverter-graph circuit") { }
 	virtual void help()
@@ -56,6 +117,9 @@ struct AigmapPass : public Pass {
 
 		for (auto module : design->selected_modules())
 		{
+			SigMap sigmap(module);
+			AigManager mgr(sigmap);
+			vector<pair<SigBit, int>> outputs;
 			vector<Cell*> replaced_cells;
 			int not_replaced_count = 0;
 			dict<IdString, int> stat_replaced;
@@ -78,44 +142,7 @@ struct AigmapPass : public Pass {
 					continue;
 				}
 
-				vector<SigBit> sigs;
-				dict<pair<int, int>, SigBit> and_cache;
-
-				for (int node_idx = 0; node_idx < GetSize(aig.nodes); node_idx++)
-				{
-					SigBit bit;
-					auto &node = aig.nodes[node_idx];
-
-					if (node.portbit >= 0) {
-						bit = cell->getPort(node.portname)[node.portbit];
-					} else if (node.left_parent < 0 && node.right_parent < 0) {
-						bit = node.inverter ? State::S1 : State::S0;
-						goto skip_inverter;
-					} else {
-						SigBit A = sigs.at(node.left_parent);
-						SigBit B = sigs.at(node.right_parent);
-						if (nand_mode && node.inverter) {
-							bit = module->NandGate(NEW_ID, A, B);
-							goto skip_inverter;
-						} else {
-							pair<int, int> key(node.left_parent, node.right_parent);
-							if (and_cache.count(key))
-								bit = and_cache.at(key);
-							else
-								bit = module->AndGate(NEW_ID, A, B);
-						}
-					}
-
-					if (node.inverter)
-						bit = module->NotGate(NEW_ID, bit);
-
-				skip_inverter:
-					for (auto &op : node.outports)
-						module->connect(cell->getPort(op.first)[op.second], bit);
-
-					sigs.push_back(bit);
-				}
-
+				mgr.add_cell(cell, aig, outputs);
 				replaced_cells.push_back(cell);
 				stat_replaced[cell->type]++;
 			}
@@ -123,6 +150,10 @@ struct AigmapPass : public Pass {
 			if (not_replaced_count == 0 && replaced_cells.empty())
 				continue;
 
+			dict<int, SigBit> lit_bits;
+			for (auto &it : outputs)
+				module->connect(it.first, lit_to_bit(module, mgr, lit_bits, it.second, nand_mode));
+
 			log("Module %s: replaced %d cells with %d new cells, skipped %d cells.\n", log_id(module),
 					GetSize(replaced_cells), GetSize(module->cells()) - orig_num_cells, not_replaced_count);
 
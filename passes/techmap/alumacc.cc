@@ -98,7 +98,11 @@ struct AlumaccWorker
 		}
 	};
 
-	dict<RTLIL::SigBit, int> bit_users;
+	// users of the output bits of $macc candidate cells, the only bits
+	// for which the number of users is needed
+	idict<RTLIL::SigBit> user_bits;
+	std::vector<int> bit_users;
+	std::vector<RTLIL::Cell*> macc_cells;
 	dict<RTLIL::SigSpec, maccnode_t*> sig_macc;
 	dict<RTLIL::SigSig, pool<alunode_t*, hash_ptr_ops>> sig_alu;
 	int macc_counter, alu_counter;
@@ -111,23 +115,35 @@ struct AlumaccWorker
 
 	void count_bit_users()
 	{
+		for (auto cell : module->selected_cells())
+			if (cell->type.in("$pos", "$neg", "$add", "$sub", "$mul")) {
+				macc_cells.push_back(cell);
+				for (auto bit : sigmap(cell->getPort("\\Y")))
+					user_bits(bit);
+			}
+
+		bit_users.resize(GetSize(user_bits));
+
 		for (auto port : module->ports)
-			for (auto bit : sigmap(module->wire(port)))
-				bit_users[bit]++;
+			for (auto bit : sigmap(module->wire(port))) {
+				int idx = user_bits.at(bit, -1);
+				if (idx >= 0)
+					bit_users[idx]++;
+			}
 
 		for (auto cell : module->cells())
 		for (auto &conn : cell->connections())
-			for (auto bit : sigmap(conn.second))
-				bit_users[bit]++;
+			for (auto bit : sigmap(conn.second)) {
+				int idx = user_bits.at(bit, -1);
+				if (idx >= 0)
+					bit_users[idx]++;
+			}
 	}
 
 	void extract_macc()
 	{
-		for (auto cell : module->selected_cells())
+		for (auto cell : macc_cells)
 		{
-			if (!cell->type.in("$pos", "$neg", "$add", "$sub", "$mul"))
-				continue;
-
 			log("  creating $macc model for %s (%s).\n", log_id(cell), log_id(cell->type));
 
 			maccnode_t *n = new maccnode_t;
@@ -138,7 +154,7 @@ struct AlumaccWorker
 			n->users = 0;
 
 			for (auto bit : n->y)
-				n->users = max(n->users, bit_users.at(bit) - 1);
+				n->users = max(n->users, bit_users[user_bits.at(bit)] - 1);
 
 			if (cell->type.in("$pos", "$neg"))
 			{
@@ -532,6 +548,7 @@ struct AlumaccWorker
 
 struct AlumaccPass : public Pass {
 	AlumaccPass() : Pass("alumacc", "extract ALU and MACC cells") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -556,11 +573,12 @@ struct AlumaccPass : public Pass {
 		}
 		extra_args(args, argidx, design);
 
-		for (auto mod : design->selected_modules())
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod) {
 			if (!mod->has_processes_warn()) {
 				AlumaccWorker worker(mod);
 				worker.run();
 			}
+		});
 	}
 } AlumaccPass;
 
@@ -33,10 +33,20 @@ struct Dff2dffeWorker
 	SigMap sigmap;
 	CellTypes ct;
 
-	typedef std::pair<RTLIL::Cell*, int> cell_int_t;
-	std::map<RTLIL::SigBit, cell_int_t> bit2mux;
+	// the mux ports are mapped once, the feedback bits that are replaced by x
+	// are collected in port_a/port_b and written back at the end of run()
+	struct mux_t {
+		RTLIL::Cell *cell;
+		RTLIL::SigSpec sig_a, sig_b, sig_s;
+		RTLIL::SigSpec port_a, port_b;
+		bool modified;
+	};
+
+	typedef std::pair<int, int> mux_int_t;
+	std::vector<mux_t> muxes;
+	dict<RTLIL::SigBit, mux_int_t> bit2mux;
 	std::vector<RTLIL::Cell*> dff_cells;
-	std::map<RTLIL::SigBit, int> bitusers;
+	dict<RTLIL::SigBit, int> bitusers;
 
 	typedef std::map<RTLIL::SigBit, bool> pattern_t;
 	typedef std::set<pattern_t> patterns_t;
@@ -53,9 +63,18 @@ struct Dff2dffeWorker
 
 		for (auto cell : module->cells()) {
 			if (cell->type == "$mux" || cell->type == "$pmux" || cell->type == "$_MUX_") {
+				mux_t mux;
+				mux.cell = cell;
+				mux.port_a = cell->getPort("\\A");
+				mux.port_b = cell->getPort("\\B");
+				mux.sig_a = sigmap(mux.port_a);
+				mux.sig_b = sigmap(mux.port_b);
+				mux.sig_s = sigmap(cell->getPort("\\S"));
+				mux.modified = false;
 				RTLIL::SigSpec sig_y = sigmap(cell->getPort("\\Y"));
 				for (int i = 0; i < GetSize(sig_y); i++)
-					bit2mux[sig_y[i]] = cell_int_t(cell, i);
+					bit2mux[sig_y[i]] = mux_int_t(GetSize(muxes), i);
+				muxes.push_back(mux);
 			}
 			if (direct_dict.empty()) {
 				if (cell->type == "$dff" || cell->type == "$_DFF_N_" || cell->type == "$_DFF_P_")
@@ -82,14 +101,17 @@ struct Dff2dffeWorker
 			return ret;
 		}
 
-		if (bit2mux.count(d) == 0 || bitusers[d] > 1)
+		auto mux_it = bit2mux.find(d);
+		if (mux_it == bit2mux.end() || bitusers.at(d, 0) > 1)
 			return ret;
 
-		cell_int_t mux_cell_int = bit2mux.at(d);
-		RTLIL::SigSpec sig_a = sigmap(mux_cell_int.first->getPort("\\A"));
-		RTLIL::SigSpec sig_b = sigmap(mux_cell_int.first->getPort("\\B"));
-		RTLIL::SigSpec sig_s = sigmap(mux_cell_int.first->getPort("\\S"));
-		int width = GetSize(sig_a), index = mux_cell_int.second;
+		// each mux output bit has only one user, so no bit of a mux is ever
+		// visited twice and the cached signals stay valid
+		mux_t &mux = muxes[mux_it->second.first];
+		const RTLIL::SigSpec &sig_a = mux.sig_a;
+		const RTLIL::SigSpec &sig_b = mux.sig_b;
+		const RTLIL::SigSpec &sig_s = mux.sig_s;
+		int width = GetSize(sig_a), index = mux_it->second.second;
 
 		for (int i = 0; i < GetSize(sig_s); i++)
 			if (path.count(sig_s[i]) && path.at(sig_s[i]))
@@ -97,9 +119,8 @@ struct Dff2dffeWorker
 				ret = find_muxtree_feedback_patterns(sig_b[i*width + index], q, path);
 
 				if (sig_b[i*width + index] == q) {
-					RTLIL::SigSpec s = mux_cell_int.first->getPort("\\B");
-					s[i*width + index] = RTLIL::Sx;
-					mux_cell_int.first->setPort("\\B", s);
+					mux.port_b[i*width + index] = RTLIL::Sx;
+					mux.modified = true;
 				}
 
 				return ret;
@@ -120,9 +141,8 @@ struct Dff2dffeWorker
 				ret.insert(pat);
 
 			if (sig_b[i*width + index] == q) {
-				RTLIL::SigSpec s = mux_cell_int.first->getPort("\\B");
-				s[i*width + index] = RTLIL::Sx;
-				mux_cell_int.first->setPort("\\B", s);
+				mux.port_b[i*width + index] = RTLIL::Sx;
+				mux.modified = true;
 			}
 		}
 
@@ -130,9 +150,8 @@ struct Dff2dffeWorker
 			ret.insert(pat);
 
 		if (sig_a[index] == q) {
-			RTLIL::SigSpec s = mux_cell_int.first->getPort("\\A");
-			s[index] = RTLIL::Sx;
-			mux_cell_int.first->setPort("\\A", s);
+			mux.port_a[index] = RTLIL::Sx;
+			mux.modified = true;
 		}
 
 		return ret;
@@ -248,11 +267,18 @@ struct Dff2dffeWorker
 			// log("Handling candidate %s:\n", log_id(dff_cell));
 			handle_dff_cell(dff_cell);
 		}
+
+		for (auto &mux : muxes)
+			if (mux.modified) {
+				mux.cell->setPort("\\A", mux.port_a);
+				mux.cell->setPort("\\B", mux.port_b);
+			}
 	}
 };
 
 struct Dff2dffePass : public Pass {
 	Dff2dffePass() : Pass("dff2dffe", "transform $dff cells to $dffe cells") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -76,249 +76,121 @@ static void logmap_all()
 	logmap("$_DFFSR_PPP_");
 }
 
-static bool parse_pin(LibertyAst *cell, LibertyAst *attr, std::string &pin_name, bool &pin_pol)
+// the port map of a library cell for an internal FF cell type: the pins for
+// the ports named in 'ports' must be the only inputs. returns false if the
+// cell can't be used.
+static bool match_ff_cell(const LibertyFfCell &cell, std::map<std::string, char> &ports, int &num_pins)
 {
-	if (cell == NULL || attr == NULL || attr->value.empty())
-		return false;
+	num_pins = 0;
+	bool found_output = false;
+	for (auto &pin : cell.pins)
+	{
+		num_pins++;
 
-	std::string value = attr->value;
+		if (pin.second == 'i' && ports.count(pin.first) == 0)
+			return false;
 
-	for (size_t pos = value.find_first_of("\" \t()"); pos != std::string::npos; pos = value.find_first_of("\" \t()"))
-		value.erase(pos, 1);
+		if (pin.second == 'Q' || pin.second == 'q') {
+			ports[pin.first] = (pin.second == 'Q') == cell.next_pol ? 'Q' : 'q';
+			found_output = true;
+		}
 
-	if (value[value.size()-1] == '\'') {
-		pin_name = value.substr(0, value.size()-1);
-		pin_pol = false;
-	} else if (value[0] == '!') {
-		pin_name = value.substr(1, value.size()-1);
-		pin_pol = false;
-	} else {
-		pin_name = value;
-		pin_pol = true;
+		if (ports.count(pin.first) == 0)
+			ports[pin.first] = 0;
 	}
+	return found_output;
+}
+
+static void add_best_cell(const LibertyFfCell *best_cell, int best_cell_pins, std::map<std::string, char> &best_cell_ports,
+		std::string cell_type, std::string ports, bool prepare_mode)
+{
+	if (best_cell == NULL)
+		return;
 
-	for (auto child : cell->children)
-		if (child->id == "pin" && child->args.size() == 1 && child->args[0] == pin_name)
-			return true;
-	return false;
+	log("  cell %s (pins=%d, area=%.2f) is a direct match for cell type %s.\n", best_cell->name.c_str(), best_cell_pins, best_cell->area, cell_type.c_str());
+	if (prepare_mode) {
+		cell_mappings[cell_type].cell_name = cell_type;
+		for (char port : ports)
+			cell_mappings[cell_type].ports[std::string(1, port)] = port;
+	} else {
+		cell_mappings[cell_type].cell_name = best_cell->name;
+		cell_mappings[cell_type].ports.swap(best_cell_ports);
+	}
 }
 
-static void find_cell(LibertyAst *ast, std::string cell_type, bool clkpol, bool has_reset, bool rstpol, bool rstval, bool prepare_mode)
+static void find_cell(const std::vector<LibertyFfCell> &ff_cells, std::string cell_type, bool clkpol, bool has_reset, bool rstpol, bool rstval, bool prepare_mode)
 {
-	LibertyAst *best_cell = NULL;
+	const LibertyFfCell *best_cell = NULL;
 	std::map<std::string, char> best_cell_ports;
 	int best_cell_pins = 0;
-	double best_cell_area = 0;
-
-	if (ast->id != "library")
-		log_error("Format error in liberty file.\n");
 
-	for (auto cell : ast->children)
+	for (auto &cell : ff_cells)
 	{
-		if (cell->id != "cell" || cell->args.size() != 1)
+		if (cell.dont_use)
 			continue;
 
-		LibertyAst *dn = cell->find("dont_use");
-		if (dn != NULL && dn->value == "true")
+		if (cell.clk_pin.empty() || cell.clk_pol != clkpol || cell.next_pin.empty())
 			continue;
 
-		LibertyAst *ff = cell->find("ff");
-		if (ff == NULL)
-			continue;
-
-		std::string cell_clk_pin, cell_rst_pin, cell_next_pin;
-		bool cell_clk_pol, cell_rst_pol, cell_next_pol;
-
-		if (!parse_pin(cell, ff->find("clocked_on"), cell_clk_pin, cell_clk_pol) || cell_clk_pol != clkpol)
+		const std::string &cell_rst_pin = rstval ? cell.preset_pin : cell.clear_pin;
+		if (has_reset && (cell_rst_pin.empty() || (rstval ? cell.preset_pol : cell.clear_pol) != rstpol))
 			continue;
-		if (!parse_pin(cell, ff->find("next_state"), cell_next_pin, cell_next_pol))
-			continue;
-		if (has_reset && rstval == false) {
-			if (!parse_pin(cell, ff->find("clear"), cell_rst_pin, cell_rst_pol) || cell_rst_pol != rstpol)
-				continue;
-		}
-		if (has_reset && rstval == true) {
-			if (!parse_pin(cell, ff->find("preset"), cell_rst_pin, cell_rst_pol) || cell_rst_pol != rstpol)
-				continue;
-		}
 
 		std::map<std::string, char> this_cell_ports;
-		this_cell_ports[cell_clk_pin] = 'C';
+		this_cell_ports[cell.clk_pin] = 'C';
 		if (has_reset)
 			this_cell_ports[cell_rst_pin] = 'R';
-		this_cell_ports[cell_next_pin] = 'D';
-
-		double area = 0;
-		LibertyAst *ar = cell->find("area");
-		if (ar != NULL && !ar->value.empty())
-			area = atof(ar->value.c_str());
-
-		int num_pins = 0;
-		bool found_output = false;
-		for (auto pin : cell->children)
-		{
-			if (pin->id != "pin" || pin->args.size() != 1)
-				continue;
-
-			LibertyAst *dir = pin->find("direction");
-			if (dir == NULL || dir->value == "internal")
-				continue;
-			num_pins++;
-
-			if (dir->value == "input" && this_cell_ports.count(pin->args[0]) == 0)
-				goto continue_cell_loop;
-
-			LibertyAst *func = pin->find("function");
-			if (dir->value == "output" && func != NULL) {
-				std::string value = func->value;
-				for (size_t pos = value.find_first_of("\" \t"); pos != std::string::npos; pos = value.find_first_of("\" \t"))
-					value.erase(pos, 1);
-				if (value == ff->args[0]) {
-					this_cell_ports[pin->args[0]] = cell_next_pol ? 'Q' : 'q';
-					found_output = true;
-				} else
-				if (value == ff->args[1]) {
-					this_cell_ports[pin->args[0]] = cell_next_pol ? 'q' : 'Q';
-					found_output = true;
-				}
-			}
-
-			if (this_cell_ports.count(pin->args[0]) == 0)
-				this_cell_ports[pin->args[0]] = 0;
-		}
+		this_cell_ports[cell.next_pin] = 'D';
 
-		if (!found_output || (best_cell != NULL && num_pins > best_cell_pins))
+		int num_pins;
+		if (!match_ff_cell(cell, this_cell_ports, num_pins) || (best_cell != NULL && num_pins > best_cell_pins))
 			continue;
 
-		if (best_cell != NULL && num_pins == best_cell_pins && area > best_cell_area)
+		if (best_cell != NULL && num_pins == best_cell_pins && cell.area > best_cell->area)
 			continue;
 
-		best_cell = cell;
+		best_cell = &cell;
 		best_cell_pins = num_pins;
-		best_cell_area = area;
 		best_cell_ports.swap(this_cell_ports);
-	continue_cell_loop:;
 	}
 
-	if (best_cell != NULL) {
-		log("  cell %s (pins=%d, area=%.2f) is a direct match for cell type %s.\n", best_cell->args[0].c_str(), best_cell_pins, best_cell_area, cell_type.c_str());
-		if (prepare_mode) {
-			cell_mappings[cell_type].cell_name = cell_type;
-			cell_mappings[cell_type].ports["C"] = 'C';
-			if (has_reset)
-				cell_mappings[cell_type].ports["R"] = 'R';
-			cell_mappings[cell_type].ports["D"] = 'D';
-			cell_mappings[cell_type].ports["Q"] = 'Q';
-		} else {
-			cell_mappings[cell_type].cell_name = best_cell->args[0];
-			cell_mappings[cell_type].ports = best_cell_ports;
-		}
-	}
+	add_best_cell(best_cell, best_cell_pins, best_cell_ports, cell_type, has_reset ? "CRDQ" : "CDQ", prepare_mode);
 }
 
-static void find_cell_sr(LibertyAst *ast, std::string cell_type, bool clkpol, bool setpol, bool clrpol, bool prepare_mode)
+static void find_cell_sr(const std::vector<LibertyFfCell> &ff_cells, std::string cell_type, bool clkpol, bool setpol, bool clrpol, bool prepare_mode)
 {
-	LibertyAst *best_cell = NULL;
+	const LibertyFfCell *best_cell = NULL;
 	std::map<std::string, char> best_cell_ports;
 	int best_cell_pins = 0;
-	double best_cell_area = 0;
-
-	if (ast->id != "library")
-		log_error("Format error in liberty file.\n");
 
-	for (auto cell : ast->children)
+	for (auto &cell : ff_cells)
 	{
-		if (cell->id != "cell" || cell->args.size() != 1)
-			continue;
-
-		LibertyAst *ff = cell->find("ff");
-		if (ff == NULL)
-			continue;
-
-		std::string cell_clk_pin, cell_set_pin, cell_clr_pin, cell_next_pin;
-		bool cell_clk_pol, cell_set_pol, cell_clr_pol, cell_next_pol;
-
-		if (!parse_pin(cell, ff->find("clocked_on"), cell_clk_pin, cell_clk_pol) || cell_clk_pol != clkpol)
+		if (cell.clk_pin.empty() || cell.clk_pol != clkpol || cell.next_pin.empty())
 			continue;
-		if (!parse_pin(cell, ff->find("next_state"), cell_next_pin, cell_next_pol))
+		if (cell.preset_pin.empty() || cell.preset_pol != setpol)
 			continue;
-		if (!parse_pin(cell, ff->find("preset"), cell_set_pin, cell_set_pol) || cell_set_pol != setpol)
-			continue;
-		if (!parse_pin(cell, ff->find("clear"), cell_clr_pin, cell_clr_pol) || cell_clr_pol != clrpol)
+		if (cell.clear_pin.empty() || cell.clear_pol != clrpol)
 			continue;
 
 		std::map<std::string, char> this_cell_ports;
-		this_cell_ports[cell_clk_pin] = 'C';
-		this_cell_ports[cell_set_pin] = 'S';
-		this_cell_ports[cell_clr_pin] = 'R';
-		this_cell_ports[cell_next_pin] = 'D';
-
-		double area = 0;
-		LibertyAst *ar = cell->find("area");
-		if (ar != NULL && !ar->value.empty())
-			area = atof(ar->value.c_str());
-
-		int num_pins = 0;
-		bool found_output = false;
-		for (auto pin : cell->children)
-		{
-			if (pin->id != "pin" || pin->args.size() != 1)
-				continue;
-
-			LibertyAst *dir = pin->find("direction");
-			if (dir == NULL || dir->value == "internal")
-				continue;
-			num_pins++;
-
-			if (dir->value == "input" && this_cell_ports.count(pin->args[0]) == 0)
-				goto continue_cell_loop;
-
-			LibertyAst *func = pin->find("function");
-			if (dir->value == "output" && func != NULL) {
-				std::string value = func->value;
-				for (size_t pos = value.find_first_of("\" \t"); pos != std::string::npos; pos = value.find_first_of("\" \t"))
-					value.erase(pos, 1);
-				if (value == ff->args[0]) {
-					this_cell_ports[pin->args[0]] = cell_next_pol ? 'Q' : 'q';
-					found_output = true;
-				} else
-				if (value == ff->args[1]) {
-					this_cell_ports[pin->args[0]] = cell_next_pol ? 'q' : 'Q';
-					found_output = true;
-				}
-			}
-
-			if (this_cell_ports.count(pin->args[0]) == 0)
-				this_cell_ports[pin->args[0]] = 0;
-		}
+		this_cell_ports[cell.clk_pin] = 'C';
+		this_cell_ports[cell.preset_pin] = 'S';
+		this_cell_ports[cell.clear_pin] = 'R';
+		this_cell_ports[cell.next_pin] = 'D';
 
-		if (!found_output || (best_cell != NULL && num_pins > best_cell_pins))
+		int num_pins;
+		if (!match_ff_cell(cell, this_cell_ports, num_pins) || (best_cell != NULL && num_pins > best_cell_pins))
 			continue;
 
-		if (best_cell != NULL && num_pins == best_cell_pins && area > best_cell_area)
+		if (best_cell != NULL && num_pins == best_cell_pins && cell.area > best_cell->area)
 			continue;
 
-		best_cell = cell;
+		best_cell = &cell;
 		best_cell_pins = num_pins;
-		best_cell_area = area;
 		best_cell_ports.swap(this_cell_ports);
-	continue_cell_loop:;
 	}
 
-	if (best_cell != NULL) {
-		log("  cell %s (pins=%d, area=%.2f) is a direct match for cell type %s.\n", best_cell->args[0].c_str(), best_cell_pins, best_cell_area, cell_type.c_str());
-		if (prepare_mode) {
-			cell_mappings[cell_type].cell_name = cell_type;
-			cell_mappings[cell_type].ports["C"] = 'C';
-			cell_mappings[cell_type].ports["S"] = 'S';
-			cell_mappings[cell_type].ports["R"] = 'R';
-			cell_mappings[cell_type].ports["D"] = 'D';
-			cell_mappings[cell_type].ports["Q"] = 'Q';
-		} else {
-			cell_mappings[cell_type].cell_name = best_cell->args[0];
-			cell_mappings[cell_type].ports = best_cell_ports;
-		}
-	}
+	add_best_cell(best_cell, best_cell_pins, best_cell_ports, cell_type, "CSRDQ", prepare_mode);
 }
 
 static bool expand_cellmap_worker(std::string from, std::string to, std::string inv)
@@ -441,6 +313,15 @@ static void map_adff_to_dff(const char *from, const char *to)
 	}
 }
 
+// the port connections of a mapped cell, derived once per FF cell type from
+// its cell_mapping: kind is the cell_mapping character, source the port of
+// the internal FF cell that drives (or is driven by) the library cell port
+struct cell_plan {
+	RTLIL::IdString type;
+	std::vector<std::tuple<RTLIL::IdString, char, RTLIL::IdString>> ports;
+	bool has_q, has_qn;
+};
+
 static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module, bool prepare_mode)
 {
 	log("Mapping DFF cells in module `%s':\n", module->name.c_str());
@@ -448,15 +329,29 @@ static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module, bool prepare
 	dict<SigBit, pool<Cell*>> notmap;
 	SigMap sigmap(module);
 
+	dict<RTLIL::IdString, cell_plan> plans;
+	for (auto &it : cell_mappings) {
+		cell_plan &plan = plans[it.first];
+		plan.type = prepare_mode ? it.second.cell_name : "\\" + it.second.cell_name;
+		plan.has_q = plan.has_qn = false;
+		for (auto &port : it.second.ports) {
+			char kind = port.second, source = 'a' <= kind && kind <= 'z' ? kind - ('a' - 'A') : kind;
+			plan.ports.push_back(std::make_tuple(RTLIL::IdString("\\" + port.first), kind,
+					'A' <= source && source <= 'Z' ? RTLIL::IdString(std::string("\\") + source) : RTLIL::IdString()));
+			if (kind == 'Q') plan.has_q = true;
+			if (kind == 'q') plan.has_qn = true;
+		}
+	}
+
 	std::vector<RTLIL::Cell*> cell_list;
 	for (auto &it : module->cells_) {
-		if (design->selected(module, it.second) && cell_mappings.count(it.second->type) > 0)
+		if (design->selected(module, it.second) && plans.count(it.second->type) > 0)
 			cell_list.push_back(it.second);
 		if (it.second->type == "$_NOT_")
 			notmap[sigmap(it.second->getPort("\\A"))].insert(it.second);
 	}
 
-	std::map<std::string, int> stats;
+	dict<std::pair<RTLIL::IdString, RTLIL::IdString>, int> stats;
 	for (auto cell : cell_list)
 	{
 		auto cell_type = cell->type;
@@ -464,24 +359,19 @@ static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module, bool prepare
 		auto cell_connections = cell->connections();
 		module->remove(cell);
 
-		cell_mapping &cm = cell_mappings[cell_type];
-		RTLIL::Cell *new_cell = module->addCell(cell_name, prepare_mode ? cm.cell_name : "\\" + cm.cell_name);
-
-		bool has_q = false, has_qn = false;
-		for (auto &port : cm.ports) {
-			if (port.second == 'Q') has_q = true;
-			if (port.second == 'q') has_qn = true;
-		}
+		const cell_plan &plan = plans.at(cell_type);
+		RTLIL::Cell *new_cell = module->addCell(cell_name, plan.type);
 
-		for (auto &port : cm.ports) {
+		for (auto &port : plan.ports) {
 			RTLIL::SigSpec sig;
-			if ('A' <= port.second && port.second <= 'Z') {
-				sig = cell_connections[std::string("\\") + port.second];
+			char kind = std::get<1>(port);
+			if ('A' <= kind && kind <= 'Z') {
+				sig = cell_connections[std::get<2>(port)];
 			} else
-			if (port.second == 'q') {
-				RTLIL::SigSpec old_sig = cell_connections[std::string("\\") + char(port.second - ('a' - 'A'))];
+			if (kind == 'q') {
+				RTLIL::SigSpec old_sig = cell_connections[std::get<2>(port)];
 				sig = module->addWire(NEW_ID, GetSize(old_sig));
-				if (has_q && has_qn) {
+				if (plan.has_q && plan.has_qn) {
 					for (auto &it : notmap[sigmap(old_sig)]) {
 						module->connect(it->getPort("\\Y"), sig);
 						it->setPort("\\Y", module->addWire(NEW_ID, GetSize(old_sig)));
@@ -490,24 +380,27 @@ static void dfflibmap(RTLIL::Design *design, RTLIL::Module *module, bool prepare
 					module->addNotGate(NEW_ID, sig, old_sig);
 				}
 			} else
-			if ('a' <= port.second && port.second <= 'z') {
-				sig = cell_connections[std::string("\\") + char(port.second - ('a' - 'A'))];
+			if ('a' <= kind && kind <= 'z') {
+				sig = cell_connections[std::get<2>(port)];
 				sig = module->NotGate(NEW_ID, sig);
 			} else
-			if (port.second == '0' || port.second == '1') {
-				sig = RTLIL::SigSpec(port.second == '0' ? 0 : 1, 1);
+			if (kind == '0' || kind == '1') {
+				sig = RTLIL::SigSpec(kind == '0' ? 0 : 1, 1);
 			} else
-			if (port.second == 0) {
+			if (kind == 0) {
 				sig = module->addWire(NEW_ID);
 			} else
 				log_abort();
-			new_cell->setPort("\\" + port.first, sig);
+			new_cell->setPort(std::get<0>(port), sig);
 		}
 
-		stats[stringf("  mapped %%d %s cells to %s cells.\n", cell_type.c_str(), new_cell->type.c_str())]++;
+		stats[std::make_pair(cell_type, plan.type)]++;
 	}
 
-	for (auto &stat: stats)
+	std::map<std::string, int> stats_text;
+	for (auto &stat : stats)
+		stats_text[stringf("  mapped %%d %s cells to %s cells.\n", stat.first.first.c_str(), stat.first.second.c_str())] = stat.second;
+	for (auto &stat : stats_text)
 		log(stat.first.c_str(), stat.second);
 }
 
@@ -556,33 +449,28 @@ struct DfflibmapPass : public Pass {
 		if (liberty_file.empty())
 			log_cmd_error("Missing `-liberty liberty_file' option!\n");
 
-		std::ifstream f;
-		f.open(liberty_file.c_str());
-		if (f.fail())
-			log_cmd_error("Can't open liberty file `%s': %s\n", liberty_file.c_str(), strerror(errno));
-		LibertyParser libparser(f);
-		f.close();
-
-		find_cell(libparser.ast, "$_DFF_N_", false, false, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_P_", true, false, false, false, prepare_mode);
-
-		find_cell(libparser.ast, "$_DFF_NN0_", false, true, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NN1_", false, true, false, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NP0_", false, true, true, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_NP1_", false, true, true, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PN0_", true, true, false, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PN1_", true, true, false, true, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PP0_", true, true, true, false, prepare_mode);
-		find_cell(libparser.ast, "$_DFF_PP1_", true, true, true, true, prepare_mode);
-
-		find_cell_sr(libparser.ast, "$_DFFSR_NNN_", false, false, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NNP_", false, false, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPN_", false, true, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_NPP_", false, true, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNN_", true, false, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PNP_", true, false, true, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPN_", true, true, false, prepare_mode);
-		find_cell_sr(libparser.ast, "$_DFFSR_PPP_", true, true, true, prepare_mode);
+		const std::vector<LibertyFfCell> &ff_cells = LibertyCache::get_ff_cells(liberty_file);
+
+		find_cell(ff_cells, "$_DFF_N_", false, false, false, false, prepare_mode);
+		find_cell(ff_cells, "$_DFF_P_", true, false, false, false, prepare_mode);
+
+		find_cell(ff_cells, "$_DFF_NN0_", false, true, false, false, prepare_mode);
+		find_cell(ff_cells, "$_DFF_NN1_", false, true, false, true, prepare_mode);
+		find_cell(ff_cells, "$_DFF_NP0_", false, true, true, false, prepare_mode);
+		find_cell(ff_cells, "$_DFF_NP1_", false, true, true, true, prepare_mode);
+		find_cell(ff_cells, "$_DFF_PN0_", true, true, false, false, prepare_mode);
+		find_cell(ff_cells, "$_DFF_PN1_", true, true, false, true, prepare_mode);
+		find_cell(ff_cells, "$_DFF_PP0_", true, true, true, false, prepare_mode);
+		find_cell(ff_cells, "$_DFF_PP1_", true, true, true, true, prepare_mode);
+
+		find_cell_sr(ff_cells, "$_DFFSR_NNN_", false, false, false, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_NNP_", false, false, true, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_NPN_", false, true, false, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_NPP_", false, true, true, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_PNN_", true, false, false, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_PNP_", true, false, true, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_PPN_", true, true, false, prepare_mode);
+		find_cell_sr(ff_cells, "$_DFFSR_PPP_", true, true, true, prepare_mode);
 
 		// try to implement as many cells as possible just by inverting
 		// the SET and RESET pins. If necessary, implement cell types
@@ -26,6 +26,11 @@
 #include <stdio.h>
 #include <string.h>
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
+
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
@@ -350,6 +355,184 @@ bool compareSortNeedleList(RTLIL::Module *left, RTLIL::Module *right)
 	return left->name < right->name;
 }
 
+void solve_pair(SubCircuitSolver &solver, std::vector<SubCircuit::Solver::Result> &results, const std::string &needle, const std::string &haystack)
+{
+	log("Solving for %s in %s.\n", needle.c_str(), haystack.c_str());
+	solver.solve(results, needle, haystack, false);
+}
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+void write_result_string(std::ostream &f, const std::string &str)
+{
+	f << GetSize(str) << " " << str << "\n";
+}
+
+bool read_result_string(std::istream &f, std::string &str)
+{
+	int len;
+	if (!(f >> len) || len < 0 || f.get() != ' ')
+		return false;
+	str.resize(len);
+	f.read(&str[0], len);
+	return f.get() == '\n';
+}
+
+void write_results(std::ostream &f, const std::vector<SubCircuit::Solver::Result> &results)
+{
+	f << GetSize(results) << "\n";
+	for (auto &result : results) {
+		write_result_string(f, result.needleGraphId);
+		write_result_string(f, result.haystackGraphId);
+		f << GetSize(result.mappings) << "\n";
+		for (auto &it : result.mappings) {
+			write_result_string(f, it.first);
+			write_result_string(f, it.second.needleNodeId);
+			write_result_string(f, it.second.haystackNodeId);
+			f << uintptr_t(it.second.needleUserData) << " " << uintptr_t(it.second.haystackUserData) << " ";
+			f << GetSize(it.second.portMapping) << "\n";
+			for (auto &it2 : it.second.portMapping) {
+				write_result_string(f, it2.first);
+				write_result_string(f, it2.second);
+			}
+		}
+	}
+}
+
+bool read_results(std::istream &f, std::vector<SubCircuit::Solver::Result> &results)
+{
+	int num_results;
+	if (!(f >> num_results) || f.get() != '\n')
+		return false;
+	results.resize(num_results);
+	for (auto &result : results) {
+		int num_mappings;
+		if (!read_result_string(f, result.needleGraphId) || !read_result_string(f, result.haystackGraphId))
+			return false;
+		if (!(f >> num_mappings) || f.get() != '\n')
+			return false;
+		for (int i = 0; i < num_mappings; i++) {
+			std::string key;
+			SubCircuit::Solver::ResultNodeMapping mapping;
+			uintptr_t needle_data, haystack_data;
+			int num_ports;
+			if (!read_result_string(f, key) || !read_result_string(f, mapping.needleNodeId) || !read_result_string(f, mapping.haystackNodeId))
+				return false;
+			if (!(f >> needle_data >> haystack_data >> num_ports) || f.get() != '\n')
+				return false;
+			mapping.needleUserData = (void*)needle_data;
+			mapping.haystackUserData = (void*)haystack_data;
+			for (int j = 0; j < num_ports; j++) {
+				std::string from, to;
+				if (!read_result_string(f, from) || !read_result_string(f, to))
+					return false;
+				mapping.portMapping[from] = to;
+			}
+			result.mappings[key] = mapping;
+		}
+	}
+	return true;
+}
+#endif
+
+// Solve all needles for each haystack in worker processes. Haystacks don't share
+// any nodes, so the matches in one haystack only depend on the needles that were
+// solved before in the same haystack. The workers are forked from this process,
+// so the cell pointers in the matches stay valid. For every (needle, haystack)
+// pair the log and the matches are returned, haystacks without result file
+// (e.g. because the worker failed) are left for the main process.
+void parallel_extract_solve(SubCircuitSolver &solver, const std::vector<std::string> &needles, const std::vector<std::string> &haystacks, int num_jobs,
+		std::vector<std::vector<std::vector<SubCircuit::Solver::Result>>> &pair_results, std::vector<std::vector<std::string>> &pair_logs, std::vector<bool> &haystacks_done)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	int num_workers = std::min(num_jobs, GetSize(haystacks));
+	if (num_workers < 2)
+		return;
+
+	log("Solving %d haystacks using %d worker processes.\n", GetSize(haystacks), num_workers);
+
+	std::string tempdir_name = make_temp_dir("/tmp/yosys-extract-XXXXXX");
+	std::vector<pid_t> worker_pids;
+
+	log_flush();
+	fflush(NULL);
+
+	for (int w = 0; w < num_workers; w++)
+	{
+		pid_t pid = fork();
+		if (pid < 0)
+			break;
+
+		if (pid == 0)
+		{
+			log_errfile = NULL;
+			log_streams.clear();
+			log_cmd_error_throw = true;
+
+			for (int h = w; h < GetSize(haystacks); h += num_workers) {
+				std::string out_name = stringf("%s/haystack_%d", tempdir_name.c_str(), h);
+				std::ofstream out(out_name + ".part");
+				for (int n = 0; n < GetSize(needles); n++) {
+					FILE *f = fopen(stringf("%s_%d.log", out_name.c_str(), n).c_str(), "w");
+					log_files.clear();
+					if (f != NULL)
+						log_files.push_back(f);
+					std::vector<SubCircuit::Solver::Result> results;
+					try {
+						solve_pair(solver, results, needles[n], haystacks[h]);
+					} catch (...) {
+						log_flush();
+						_exit(1);
+					}
+					log_flush();
+					if (f != NULL)
+						fclose(f);
+					log_files.clear();
+					write_results(out, results);
+				}
+				out.close();
+				if (!out.fail())
+					rename((out_name + ".part").c_str(), (out_name + ".res").c_str());
+			}
+			_exit(0);
+		}
+
+		worker_pids.push_back(pid);
+	}
+
+	for (auto pid : worker_pids) {
+		int status = 0;
+		waitpid(pid, &status, 0);
+	}
+
+	for (int h = 0; h < GetSize(haystacks); h++)
+	{
+		std::string out_name = stringf("%s/haystack_%d", tempdir_name.c_str(), h);
+		std::ifstream f((out_name + ".res").c_str(), std::ios::binary);
+		if (f.fail())
+			continue;
+
+		bool ok = true;
+		for (int n = 0; ok && n < GetSize(needles); n++)
+			ok = read_results(f, pair_results[h][n]);
+		if (!ok) {
+			for (auto &results : pair_results[h])
+				results.clear();
+			continue;
+		}
+
+		for (int n = 0; n < GetSize(needles); n++) {
+			std::ifstream logf(stringf("%s_%d.log", out_name.c_str(), n).c_str());
+			std::stringstream buf;
+			buf << logf.rdbuf();
+			pair_logs[h][n] = buf.str();
+		}
+		haystacks_done[h] = true;
+	}
+
+	remove_directory(tempdir_name);
+#endif
+}
+
 struct ExtractPass : public Pass {
 	ExtractPass() : Pass("extract", "find subcircuits and replace them with cells") { }
 	virtual void help()
@@ -409,6 +592,13 @@ struct ExtractPass : public Pass {
 		log("    -ignore_param <cell_type> <parameter_name>\n");
 		log("        Do not use this parameter when matching cells.\n");
 		log("\n");
+		log("    -j <N>\n");
+		log("        search for the needles in the different modules of the design in N\n");
+		log("        worker processes. The matches and the log output are merged in the\n");
+		log("        original order afterwards, so the result is the same as with -j 1.\n");
+		log("        The default is the value given with 'yosys -j'. (Mining with -mine\n");
+		log("        always runs in a single process.)\n");
+		log("\n");
 		log("This pass does not operate on modules with unprocessed processes in it.\n");
 		log("(I.e. the 'proc' pass should be used first to convert processes to netlists.)\n");
 		log("\n");
@@ -451,6 +641,7 @@ struct ExtractPass : public Pass {
 		std::string mine_outfile;
 		bool constports = false;
 		bool nodefaultswaps = false;
+		int num_jobs = yosys_jobs;
 
 		bool mine_mode = false;
 		int mine_cells_min = 3;
@@ -557,6 +748,10 @@ struct ExtractPass : public Pass {
 				solver.ignore_parameters = true;
 				continue;
 			}
+			if (args[argidx] == "-j" && argidx+1 < args.size()) {
+				num_jobs = atoi(args[++argidx].c_str());
+				continue;
+			}
 			if (args[argidx] == "-ignore_param" && argidx+2 < args.size()) {
 				solver.ignored_parameters.insert(std::pair<RTLIL::IdString, RTLIL::IdString>(RTLIL::escape_id(args[argidx+1]), RTLIL::escape_id(args[argidx+2])));
 				argidx += 2;
@@ -658,10 +853,26 @@ struct ExtractPass : public Pass {
 
 			std::sort(needle_list.begin(), needle_list.end(), compareSortNeedleList);
 
+			std::vector<std::string> needles, haystacks;
 			for (auto needle : needle_list)
-			for (auto &haystack_it : haystack_map) {
-				log("Solving for %s in %s.\n", ("needle_" + RTLIL::unescape_id(needle->name)).c_str(), haystack_it.first.c_str());
-				solver.solve(results, "needle_" + RTLIL::unescape_id(needle->name), haystack_it.first, false);
+				needles.push_back("needle_" + RTLIL::unescape_id(needle->name));
+			for (auto &haystack_it : haystack_map)
+				haystacks.push_back(haystack_it.first);
+
+			std::vector<std::vector<std::vector<SubCircuit::Solver::Result>>> pair_results(GetSize(haystacks),
+					std::vector<std::vector<SubCircuit::Solver::Result>>(GetSize(needles)));
+			std::vector<std::vector<std::string>> pair_logs(GetSize(haystacks), std::vector<std::string>(GetSize(needles)));
+			std::vector<bool> haystacks_done(GetSize(haystacks));
+
+			parallel_extract_solve(solver, needles, haystacks, num_jobs, pair_results, pair_logs, haystacks_done);
+
+			for (int n = 0; n < GetSize(needles); n++)
+			for (int h = 0; h < GetSize(haystacks); h++) {
+				if (haystacks_done[h])
+					log("%s", pair_logs[h][n].c_str());
+				else
+					solve_pair(solver, pair_results[h][n], needles[n], haystacks[h]);
+				results.insert(results.end(), pair_results[h][n].begin(), pair_results[h][n].end());
 			}
 			log("Found %d matches.\n", GetSize(results));
 
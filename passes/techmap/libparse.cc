@@ -20,10 +20,23 @@
 #include "libparse.h"
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 
+#include <algorithm>
 #include <istream>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#endif
 
 #ifndef FILTERLIB
 #include "kernel/log.h"
@@ -82,71 +95,137 @@ void LibertyAst::dump(FILE *f, std::string indent, std::string path, bool path_o
 		fprintf(f, " ;\n");
 }
 
+LibertyParser::LibertyParser(std::istream &f, const std::set<std::string> *filter) :
+		mapped_data(nullptr), mapped_size(0), filter(filter), line(1)
+{
+	std::stringstream buf;
+	buf << f.rdbuf();
+	buffer = buf.str();
+	pos = buffer.data();
+	end = pos + buffer.size();
+	ast = parse(true);
+}
+
+LibertyParser::LibertyParser(std::string filename, const std::set<std::string> *filter) :
+		mapped_data(nullptr), mapped_size(0), filter(filter), line(1)
+{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd >= 0) {
+		struct stat st;
+		if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED) {
+				madvise(data, st.st_size, MADV_SEQUENTIAL);
+				mapped_data = data;
+				mapped_size = st.st_size;
+			}
+		}
+		close(fd);
+	}
+
+	if (mapped_data != nullptr) {
+		pos = (const char*)mapped_data;
+		end = pos + mapped_size;
+		ast = parse(true);
+		return;
+	}
+#endif
+
+	std::ifstream f(filename.c_str(), std::ios::binary);
+	if (f.fail()) {
+#ifndef FILTERLIB
+		log_cmd_error("Can't open liberty file `%s': %s\n", filename.c_str(), strerror(errno));
+#else
+		fprintf(stderr, "Can't open liberty file `%s'.\n", filename.c_str());
+		exit(1);
+#endif
+	}
+
+	std::stringstream buf;
+	buf << f.rdbuf();
+	buffer = buf.str();
+	pos = buffer.data();
+	end = pos + buffer.size();
+	ast = parse(true);
+}
+
+LibertyParser::~LibertyParser()
+{
+	if (ast)
+		delete ast;
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	if (mapped_data != nullptr)
+		munmap(mapped_data, mapped_size);
+#endif
+}
+
+static inline bool is_id_char(int c)
+{
+	return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.';
+}
+
 int LibertyParser::lexer(std::string &str)
 {
 	int c;
 
 	do {
-		c = f.get();
+		c = pos < end ? (unsigned char)*pos++ : EOF;
 	} while (c == ' ' || c == '\t' || c == '\r');
 
-	if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.') {
-		str = c;
-		while (1) {
-			c = f.get();
-			if (('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') || c == '_' || c == '-' || c == '+' || c == '.')
-				str += c;
-			else
-				break;
-		}
-		f.unget();
+	if (is_id_char(c)) {
+		const char *start = pos-1;
+		while (pos < end && is_id_char((unsigned char)*pos))
+			pos++;
+		str.assign(start, pos);
 		// fprintf(stderr, "LEX: identifier >>%s<<\n", str.c_str());
 		return 'v';
 	}
 
 	if (c == '"') {
-		str = "";
-		while (1) {
-			c = f.get();
-			if (c == '\n')
+		const char *start = pos;
+		while (pos < end && *pos != '"') {
+			if (*pos == '\n')
 				line++;
-			if (c == '"')
-				break;
-			str += c;
+			pos++;
 		}
+		str.assign(start, pos);
+		if (pos < end)
+			pos++;
 		// fprintf(stderr, "LEX: string >>%s<<\n", str.c_str());
 		return 'v';
 	}
 
 	if (c == '/') {
-		c = f.get();
-		if (c == '*') {
-			int last_c = 0;
-			while (c > 0 && (last_c != '*' || c != '/')) {
-				last_c = c;
-				c = f.get();
-				if (c == '\n')
+		if (pos < end && *pos == '*') {
+			// the '*' of "/*" may also start the closing "*/"
+			while (pos < end && (pos[0] != '*' || pos+1 == end || pos[1] != '/')) {
+				if (*pos == '\n')
 					line++;
+				pos++;
 			}
+			pos = std::min(pos+2, end);
 			return lexer(str);
-		} else if (c == '/') {
-			while (c > 0 && c != '\n')
-				c = f.get();
+		} else if (pos < end && *pos == '/') {
+			while (pos < end && *pos != '\n')
+				pos++;
+			if (pos < end)
+				pos++;
 			line++;
 			return lexer(str);
 		}
-		f.unget();
 		// fprintf(stderr, "LEX: char >>/<<\n");
 		return '/';
 	}
 
 	if (c == '\\') {
-		c = f.get();
-		if (c == '\r')
-			c = f.get();
-		if (c == '\n')
+		const char *p = pos;
+		if (p < end && *p == '\r')
+			p++;
+		if (p < end && *p == '\n') {
+			pos = p+1;
 			return lexer(str);
-		f.unget();
+		}
 		return '\\';
 	}
 
@@ -162,27 +241,105 @@ int LibertyParser::lexer(std::string &str)
 	return c;
 }
 
-LibertyAst *LibertyParser::parse()
+// skip the rest of a statement that is not in the filter, this follows the
+// same rules for comments, strings and line continuations as lexer()
+void LibertyParser::skip_statement()
+{
+	int depth = 0;
+
+	while (pos < end)
+	{
+		char c = *pos++;
+
+		if (c == '\n') {
+			line++;
+			if (depth == 0)
+				return;
+			continue;
+		}
+
+		if (c == ';' && depth == 0)
+			return;
+
+		if (c == '"') {
+			while (pos < end && *pos != '"') {
+				if (*pos == '\n')
+					line++;
+				pos++;
+			}
+			if (pos < end)
+				pos++;
+			continue;
+		}
+
+		if (c == '/' && pos < end && *pos == '*') {
+			while (pos < end && (pos[0] != '*' || pos+1 == end || pos[1] != '/')) {
+				if (*pos == '\n')
+					line++;
+				pos++;
+			}
+			pos = std::min(pos+2, end);
+			continue;
+		}
+
+		if (c == '/' && pos < end && *pos == '/') {
+			while (pos < end && *pos != '\n')
+				pos++;
+			if (pos < end)
+				pos++;
+			line++;
+			continue;
+		}
+
+		if (c == '\\') {
+			if (pos < end && *pos == '\r')
+				pos++;
+			if (pos < end && *pos == '\n')
+				pos++;
+			continue;
+		}
+
+		if (c == '{')
+			depth++;
+
+		if (c == '}') {
+			if (depth == 0)
+				error();
+			if (--depth == 0)
+				return;
+		}
+	}
+}
+
+LibertyAst *LibertyParser::parse(bool toplevel)
 {
 	std::string str;
 
-	int tok = lexer(str);
+	while (1)
+	{
+		int tok = lexer(str);
 
-	while (tok == ';')
-		tok = lexer(str);
+		while (tok == ';')
+			tok = lexer(str);
 
-	if (tok == '}' || tok < 0)
-		return NULL;
+		if (tok == '}' || tok < 0)
+			return NULL;
 
-	if (tok != 'v')
-		error();
+		if (tok != 'v')
+			error();
+
+		if (toplevel || filter == nullptr || filter->count(str) > 0)
+			break;
+
+		skip_statement();
+	}
 
 	LibertyAst *ast = new LibertyAst;
 	ast->id = str;
 
 	while (1)
 	{
-		tok = lexer(str);
+		int tok = lexer(str);
 
 		if (tok == ';')
 			break;
@@ -232,6 +389,150 @@ void LibertyParser::error()
 	log_error("Syntax error in line %d.\n", line);
 }
 
+struct LibertyCacheEntry
+{
+	long long size, mtime;
+	LibertyParser *parser;
+	std::vector<LibertyFfCell> *ff_cells;
+};
+
+static std::map<std::string, LibertyCacheEntry> liberty_cache;
+
+LibertyAst *LibertyCache::get(std::string filename)
+{
+	// the union of everything that is used by the passes sharing the cache
+	static const std::set<std::string> filter = { "cell", "dont_use", "area", "pin", "direction", "function",
+			"ff", "latch", "clocked_on", "next_state", "enable", "data_in", "clear", "preset" };
+
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0)
+		log_cmd_error("Can't open liberty file `%s': %s\n", filename.c_str(), strerror(errno));
+
+	auto it = liberty_cache.find(filename);
+	if (it != liberty_cache.end()) {
+		if (it->second.size == (long long)st.st_size && it->second.mtime == (long long)st.st_mtime) {
+			log("Using cached liberty file `%s'.\n", filename.c_str());
+			return it->second.parser->ast;
+		}
+		delete it->second.parser;
+		delete it->second.ff_cells;
+		liberty_cache.erase(it);
+	}
+
+	LibertyCacheEntry entry;
+	entry.size = st.st_size;
+	entry.mtime = st.st_mtime;
+	entry.ff_cells = nullptr;
+	entry.parser = new LibertyParser(filename, &filter);
+	if (entry.parser->ast == NULL) {
+		delete entry.parser;
+		log_cmd_error("Liberty file `%s' is empty.\n", filename.c_str());
+	}
+	liberty_cache[filename] = entry;
+	return entry.parser->ast;
+}
+
+static bool parse_ff_pin(LibertyAst *cell, LibertyAst *attr, std::string &pin_name, bool &pin_pol)
+{
+	pin_name.clear();
+	pin_pol = true;
+
+	if (attr == NULL || attr->value.empty())
+		return false;
+
+	std::string value = attr->value;
+
+	for (size_t pos = value.find_first_of("\" \t()"); pos != std::string::npos; pos = value.find_first_of("\" \t()"))
+		value.erase(pos, 1);
+
+	if (value.empty())
+		return false;
+
+	std::string name = value;
+	if (value[value.size()-1] == '\'') {
+		name = value.substr(0, value.size()-1);
+		pin_pol = false;
+	} else if (value[0] == '!') {
+		name = value.substr(1, value.size()-1);
+		pin_pol = false;
+	}
+
+	for (auto child : cell->children)
+		if (child->id == "pin" && child->args.size() == 1 && child->args[0] == name) {
+			pin_name = name;
+			return true;
+		}
+	return false;
+}
+
+const std::vector<LibertyFfCell> &LibertyCache::get_ff_cells(std::string filename)
+{
+	LibertyAst *ast = get(filename);
+	LibertyCacheEntry &entry = liberty_cache.at(filename);
+	if (entry.ff_cells != nullptr)
+		return *entry.ff_cells;
+
+	entry.ff_cells = new std::vector<LibertyFfCell>;
+
+	if (ast->id != "library")
+		log_error("Format error in liberty file.\n");
+
+	for (auto cell : ast->children)
+	{
+		if (cell->id != "cell" || cell->args.size() != 1)
+			continue;
+
+		LibertyAst *ff = cell->find("ff");
+		if (ff == NULL || ff->args.size() < 2)
+			continue;
+
+		LibertyFfCell info;
+		info.name = cell->args[0];
+
+		LibertyAst *dn = cell->find("dont_use");
+		info.dont_use = dn != NULL && dn->value == "true";
+
+		info.area = 0;
+		LibertyAst *ar = cell->find("area");
+		if (ar != NULL && !ar->value.empty())
+			info.area = atof(ar->value.c_str());
+
+		parse_ff_pin(cell, ff->find("clocked_on"), info.clk_pin, info.clk_pol);
+		parse_ff_pin(cell, ff->find("next_state"), info.next_pin, info.next_pol);
+		parse_ff_pin(cell, ff->find("clear"), info.clear_pin, info.clear_pol);
+		parse_ff_pin(cell, ff->find("preset"), info.preset_pin, info.preset_pol);
+
+		for (auto pin : cell->children)
+		{
+			if (pin->id != "pin" || pin->args.size() != 1)
+				continue;
+
+			LibertyAst *dir = pin->find("direction");
+			if (dir == NULL || dir->value == "internal")
+				continue;
+
+			char kind = 0;
+			LibertyAst *func = pin->find("function");
+			if (dir->value == "input")
+				kind = 'i';
+			else if (dir->value == "output" && func != NULL) {
+				std::string value = func->value;
+				for (size_t pos = value.find_first_of("\" \t"); pos != std::string::npos; pos = value.find_first_of("\" \t"))
+					value.erase(pos, 1);
+				if (value == ff->args[0])
+					kind = 'Q';
+				else if (value == ff->args[1])
+					kind = 'q';
+			}
+			info.pins.push_back(std::make_pair(pin->args[0], kind));
+		}
+
+		entry.ff_cells->push_back(info);
+	}
+
+	return *entry.ff_cells;
+}
+
 #else
 
 void LibertyParser::error()
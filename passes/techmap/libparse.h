@@ -39,17 +39,62 @@ namespace Yosys
 		static std::set<std::string> whitelist;
 	};
 
+	// The whole input is parsed from memory: a file given by name is mapped
+	// with mmap() where available, a stream is read into a buffer first.
+	//
+	// If a filter is given then only the statements with an id in the filter
+	// (and the top-level library group) are turned into LibertyAst nodes. All
+	// other statements, including whole groups such as timing tables, are
+	// skipped without building strings for their contents.
 	struct LibertyParser
 	{
-		std::istream &f;
+		const char *pos, *end;
+		std::string buffer;
+		void *mapped_data;
+		size_t mapped_size;
+		const std::set<std::string> *filter;
 		int line;
 		LibertyAst *ast;
-		LibertyParser(std::istream &f) : f(f), line(1), ast(parse()) {}
-		~LibertyParser() { if (ast) delete ast; }
+		LibertyParser(std::istream &f, const std::set<std::string> *filter = nullptr);
+		LibertyParser(std::string filename, const std::set<std::string> *filter = nullptr);
+		~LibertyParser();
 		int lexer(std::string &str);
-		LibertyAst *parse();
+		LibertyAst *parse(bool toplevel = false);
+		void skip_statement();
 		void error();
 	};
+
+#ifndef FILTERLIB
+	// The characteristics of a cell with an 'ff' group, with the pin names
+	// and polarities of the ff group already parsed. A pin name is empty when
+	// the attribute is missing or does not name a pin of the cell.
+	struct LibertyFfCell
+	{
+		std::string name;
+		bool dont_use;
+		double area;
+		std::string clk_pin, next_pin, clear_pin, preset_pin;
+		bool clk_pol, next_pol, clear_pol, preset_pol;
+
+		// all pins except internal ones, with kind 'i' for inputs, 'Q' or
+		// 'q' for outputs with the ff state or its inverse as function, and
+		// 0 for the other pins
+		std::vector<std::pair<std::string, char>> pins;
+	};
+
+	// Liberty files that are parsed only once per session and shared by the
+	// passes that read them (dfflibmap, stat -liberty and read_liberty). An
+	// entry is parsed again when the size or modification time of the file
+	// changes. Only the groups and attributes used by these passes are kept.
+	struct LibertyCache
+	{
+		static LibertyAst *get(std::string filename);
+
+		// the cells of the library with an 'ff' group, in library order.
+		// the table is built once per (cached) library.
+		static const std::vector<LibertyFfCell> &get_ff_cells(std::string filename);
+	};
+#endif
 }
 
 #endif
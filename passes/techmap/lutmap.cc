@@ -0,0 +1,641 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+#include <climits>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+#define LUTMAP_MAX_K 6
+
+struct LutmapConfig
+{
+	int lut_size;
+	int max_cuts;
+	bool area_recovery;
+
+	LutmapConfig() : lut_size(4), max_cuts(8), area_recovery(true) { }
+};
+
+struct LutmapWorker
+{
+	// a cut of a node: a set of at most lut_size nodes (the leaves) so that
+	// every path from the primary inputs to the node passes through a leaf
+	struct cut_t
+	{
+		int size;
+		int leaves[LUTMAP_MAX_K];
+		uint64_t sign;
+		int depth;
+		float flow;
+
+		cut_t() : size(0), sign(0), depth(0), flow(0) { }
+
+		bool contains(const cut_t &other) const {
+			if ((sign & other.sign) != other.sign)
+				return false;
+			for (int i = 0, j = 0; j < other.size; j++) {
+				while (i < size && leaves[i] < other.leaves[j])
+					i++;
+				if (i == size || leaves[i] != other.leaves[j])
+					return false;
+			}
+			return true;
+		}
+
+		bool operator==(const cut_t &other) const {
+			if (size != other.size || sign != other.sign)
+				return false;
+			for (int i = 0; i < size; i++)
+				if (leaves[i] != other.leaves[i])
+					return false;
+			return true;
+		}
+	};
+
+	// gate nodes have a cell and fanins, all other nodes (primary inputs,
+	// outputs of other cells and the two constants) are leaves of the mapping
+	struct node_t
+	{
+		RTLIL::SigBit bit;
+		RTLIL::Cell *cell;
+		std::vector<int> fanins;
+		int fanout;
+		bool is_root;
+	};
+
+	enum mode_t { MODE_DEPTH, MODE_FLOW };
+
+	const LutmapConfig &config;
+	RTLIL::Module *module;
+	SigMap sigmap;
+
+	std::vector<node_t> nodes;
+	dict<RTLIL::SigBit, int> bit_nodes;
+	std::vector<int> order;
+
+	std::vector<std::vector<cut_t>> cuts;
+	std::vector<cut_t> best;
+	std::vector<int> arrival, required, refs;
+	std::vector<float> flow;
+
+	LutmapWorker(const LutmapConfig &config, RTLIL::Module *module) : config(config), module(module), sigmap(module) { }
+
+	bool is_gate(int n) const {
+		return nodes[n].cell != nullptr;
+	}
+
+	int bit_node(RTLIL::SigBit bit)
+	{
+		bit = sigmap(bit);
+		if (bit.wire == nullptr && bit != RTLIL::State::S1)
+			bit = RTLIL::State::S0;
+
+		auto it = bit_nodes.find(bit);
+		if (it != bit_nodes.end())
+			return it->second;
+
+		node_t node;
+		node.bit = bit;
+		node.cell = nullptr;
+		node.fanout = 0;
+		node.is_root = false;
+		nodes.push_back(node);
+		bit_nodes[bit] = GetSize(nodes)-1;
+		return GetSize(nodes)-1;
+	}
+
+	static bool is_gate_type(RTLIL::IdString type)
+	{
+		return type.in("$_BUF_", "$_NOT_", "$_AND_", "$_NAND_", "$_OR_", "$_NOR_", "$_XOR_", "$_XNOR_",
+				"$_MUX_", "$_AOI3_", "$_OAI3_", "$_AOI4_", "$_OAI4_");
+	}
+
+	static uint64_t eval_gate(RTLIL::IdString type, const std::vector<uint64_t> &in)
+	{
+		if (type == "$_BUF_")  return in[0];
+		if (type == "$_NOT_")  return ~in[0];
+		if (type == "$_AND_")  return in[0] & in[1];
+		if (type == "$_NAND_") return ~(in[0] & in[1]);
+		if (type == "$_OR_")   return in[0] | in[1];
+		if (type == "$_NOR_")  return ~(in[0] | in[1]);
+		if (type == "$_XOR_")  return in[0] ^ in[1];
+		if (type == "$_XNOR_") return ~(in[0] ^ in[1]);
+		if (type == "$_MUX_")  return (in[2] & in[1]) | (~in[2] & in[0]);
+		if (type == "$_AOI3_") return ~((in[0] & in[1]) | in[2]);
+		if (type == "$_OAI3_") return ~((in[0] | in[1]) & in[2]);
+		if (type == "$_AOI4_") return ~((in[0] & in[1]) | (in[2] & in[3]));
+		if (type == "$_OAI4_") return ~((in[0] | in[1]) & (in[2] | in[3]));
+		log_abort();
+	}
+
+	static std::vector<RTLIL::IdString> gate_inputs(RTLIL::IdString type)
+	{
+		if (type.in("$_BUF_", "$_NOT_"))
+			return {"\\A"};
+		if (type == "$_MUX_")
+			return {"\\A", "\\B", "\\S"};
+		if (type.in("$_AOI3_", "$_OAI3_"))
+			return {"\\A", "\\B", "\\C"};
+		if (type.in("$_AOI4_", "$_OAI4_"))
+			return {"\\A", "\\B", "\\C", "\\D"};
+		return {"\\A", "\\B"};
+	}
+
+	// builds the node graph from the selected gates, returns false if the
+	// gates contain a combinational loop
+	bool build_graph()
+	{
+		bit_node(RTLIL::State::S0);
+		bit_node(RTLIL::State::S1);
+
+		pool<RTLIL::Cell*> gates;
+		for (auto cell : module->selected_cells()) {
+			if (!is_gate_type(cell->type) || cell->get_bool_attribute("\\keep"))
+				continue;
+			RTLIL::SigBit y = sigmap(cell->getPort("\\Y"));
+			if (y.wire == nullptr)
+				continue;
+			int n = bit_node(y);
+			if (nodes[n].cell != nullptr)
+				continue;
+			nodes[n].cell = cell;
+			gates.insert(cell);
+		}
+
+		for (int n = 0; n < GetSize(nodes); n++) {
+			if (!is_gate(n))
+				continue;
+			for (auto port : gate_inputs(nodes[n].cell->type)) {
+				int f = bit_node(nodes[n].cell->getPort(port));
+				nodes[n].fanins.push_back(f);
+				nodes[f].fanout++;
+			}
+		}
+
+		auto mark_root = [&](RTLIL::SigSpec sig) {
+			for (auto bit : sigmap(sig)) {
+				auto it = bit_nodes.find(bit);
+				if (it != bit_nodes.end() && is_gate(it->second) && !nodes[it->second].is_root) {
+					nodes[it->second].is_root = true;
+					nodes[it->second].fanout++;
+				}
+			}
+		};
+
+		for (auto cell : module->cells())
+			if (gates.count(cell) == 0)
+				for (auto &conn : cell->connections())
+					mark_root(conn.second);
+
+		for (auto wire : module->wires())
+			if (wire->port_output || wire->get_bool_attribute("\\keep"))
+				mark_root(wire);
+
+		// depth first search for a topological order of the gates
+		std::vector<int> state(GetSize(nodes));
+		for (int root = 0; root < GetSize(nodes); root++)
+		{
+			if (!is_gate(root) || state[root] != 0)
+				continue;
+
+			std::vector<std::pair<int, int>> stack;
+			stack.push_back(std::make_pair(root, 0));
+			state[root] = 1;
+
+			while (!stack.empty())
+			{
+				int n = stack.back().first;
+				int &idx = stack.back().second;
+
+				if (idx == GetSize(nodes[n].fanins)) {
+					state[n] = 2;
+					order.push_back(n);
+					stack.pop_back();
+					continue;
+				}
+
+				int f = nodes[n].fanins[idx++];
+				if (!is_gate(f) || state[f] == 2)
+					continue;
+				if (state[f] == 1) {
+					log_warning("Found combinational loop through %s in module %s, not mapping it to LUTs.\n",
+							log_signal(nodes[f].bit), log_id(module));
+					return false;
+				}
+				state[f] = 1;
+				stack.push_back(std::make_pair(f, 0));
+			}
+		}
+
+		return true;
+	}
+
+	bool merge_cuts(const cut_t &a, const cut_t &b, cut_t &result) const
+	{
+		int i = 0, j = 0, k = 0;
+		while (i < a.size || j < b.size) {
+			if (k == config.lut_size)
+				return false;
+			if (j == b.size || (i < a.size && a.leaves[i] < b.leaves[j]))
+				result.leaves[k++] = a.leaves[i++];
+			else if (i == a.size || b.leaves[j] < a.leaves[i])
+				result.leaves[k++] = b.leaves[j++];
+			else
+				result.leaves[k++] = a.leaves[i++], j++;
+		}
+		result.size = k;
+		result.sign = a.sign | b.sign;
+		return true;
+	}
+
+	cut_t trivial_cut(int n) const
+	{
+		cut_t cut;
+		if (!nodes[n].bit.wire)
+			return cut;
+		cut.size = 1;
+		cut.leaves[0] = n;
+		cut.sign = uint64_t(1) << (n % 64);
+		return cut;
+	}
+
+	void eval_cut(cut_t &cut) const
+	{
+		cut.depth = 0;
+		cut.flow = 1;
+		for (int i = 0; i < cut.size; i++) {
+			int l = cut.leaves[i];
+			if (!is_gate(l))
+				continue;
+			cut.depth = std::max(cut.depth, arrival[l]);
+			cut.flow += flow[l];
+		}
+		cut.depth += 1;
+	}
+
+	bool cut_better(const cut_t &a, const cut_t &b, mode_t mode) const
+	{
+		if (mode == MODE_DEPTH) {
+			if (a.depth != b.depth)
+				return a.depth < b.depth;
+			if (a.flow != b.flow)
+				return a.flow < b.flow;
+		} else {
+			if (a.flow != b.flow)
+				return a.flow < b.flow;
+			if (a.depth != b.depth)
+				return a.depth < b.depth;
+		}
+		return a.size < b.size;
+	}
+
+	void set_best(int n, const cut_t &cut)
+	{
+		best[n] = cut;
+		arrival[n] = cut.depth;
+		flow[n] = cut.flow / std::max(1, nodes[n].fanout);
+	}
+
+	// computes the priority cuts of a node from the cuts of its fanins and
+	// selects the best one according to the mode
+	void enumerate_cuts(int n, mode_t mode)
+	{
+		std::vector<cut_t> candidates(1);
+
+		for (int f : nodes[n].fanins)
+		{
+			std::vector<cut_t> fanin_cuts;
+			if (is_gate(f))
+				fanin_cuts = cuts[f];
+			fanin_cuts.push_back(trivial_cut(f));
+
+			std::vector<cut_t> new_candidates;
+			for (auto &a : candidates)
+			for (auto &b : fanin_cuts) {
+				cut_t cut;
+				if (!merge_cuts(a, b, cut))
+					continue;
+				bool found = false;
+				for (auto &other : new_candidates)
+					if (other == cut) {
+						found = true;
+						break;
+					}
+				if (!found)
+					new_candidates.push_back(cut);
+			}
+			candidates.swap(new_candidates);
+		}
+
+		for (auto &cut : candidates)
+			eval_cut(cut);
+
+		std::sort(candidates.begin(), candidates.end(), [&](const cut_t &a, const cut_t &b) {
+			return cut_better(a, b, mode);
+		});
+
+		std::vector<cut_t> &node_cuts = cuts[n];
+		node_cuts.clear();
+
+		for (auto &cut : candidates)
+		{
+			if (GetSize(node_cuts) == config.max_cuts)
+				break;
+			if (mode == MODE_FLOW && cut.depth > required[n])
+				continue;
+
+			bool dominated = false;
+			for (auto &other : node_cuts)
+				if (cut.contains(other)) {
+					dominated = true;
+					break;
+				}
+			if (!dominated)
+				node_cuts.push_back(cut);
+		}
+
+		// there always is a cut within the required time: the one that was
+		// selected in the depth oriented pass
+		if (node_cuts.empty()) {
+			node_cuts.push_back(best[n]);
+			eval_cut(node_cuts.back());
+		}
+
+		set_best(n, node_cuts.front());
+	}
+
+	int ref_node(int n)
+	{
+		int area = 1;
+		const cut_t &cut = best[n];
+		for (int i = 0; i < cut.size; i++) {
+			int l = cut.leaves[i];
+			if (is_gate(l) && refs[l]++ == 0)
+				area += ref_node(l);
+		}
+		return area;
+	}
+
+	int deref_node(int n)
+	{
+		int area = 1;
+		const cut_t &cut = best[n];
+		for (int i = 0; i < cut.size; i++) {
+			int l = cut.leaves[i];
+			if (is_gate(l) && --refs[l] == 0)
+				area += deref_node(l);
+		}
+		return area;
+	}
+
+	int max_depth() const
+	{
+		int depth = 0;
+		for (int n : order)
+			if (nodes[n].is_root)
+				depth = std::max(depth, arrival[n]);
+		return depth;
+	}
+
+	// reference counts and required times of the current cover
+	void update_cover()
+	{
+		int depth = max_depth();
+		refs.assign(GetSize(nodes), 0);
+		required.assign(GetSize(nodes), INT_MAX);
+		for (int n : order)
+			if (nodes[n].is_root) {
+				refs[n]++;
+				required[n] = depth;
+			}
+
+		for (int i = GetSize(order)-1; i >= 0; i--) {
+			int n = order[i];
+			if (refs[n] == 0)
+				continue;
+			const cut_t &cut = best[n];
+			for (int j = 0; j < cut.size; j++) {
+				int l = cut.leaves[j];
+				if (!is_gate(l))
+					continue;
+				refs[l]++;
+				required[l] = std::min(required[l], required[n]-1);
+			}
+		}
+	}
+
+	// exact area recovery: chooses the cut that adds the fewest LUTs to the
+	// current cover, counted by referencing the cut's cone
+	void exact_area()
+	{
+		for (int n : order)
+		{
+			if (refs[n] == 0)
+				continue;
+
+			deref_node(n);
+
+			cut_t best_cut = best[n];
+			int best_area = INT_MAX;
+
+			for (auto &cut : cuts[n]) {
+				cut_t c = cut;
+				eval_cut(c);
+				if (c.depth > required[n])
+					continue;
+				best[n] = c;
+				int area = ref_node(n);
+				deref_node(n);
+				if (area < best_area || (area == best_area && c.depth < best_cut.depth)) {
+					best_cut = c;
+					best_area = area;
+				}
+			}
+
+			set_best(n, best_cut);
+			ref_node(n);
+		}
+	}
+
+	uint64_t cut_function(int n, const cut_t &cut, dict<int, uint64_t> &cache)
+	{
+		static const uint64_t var_masks[LUTMAP_MAX_K] = {
+			0xaaaaaaaaaaaaaaaaULL, 0xccccccccccccccccULL, 0xf0f0f0f0f0f0f0f0ULL,
+			0xff00ff00ff00ff00ULL, 0xffff0000ffff0000ULL, 0xffffffff00000000ULL
+		};
+
+		auto it = cache.find(n);
+		if (it != cache.end())
+			return it->second;
+
+		uint64_t value;
+		int leaf_idx = -1;
+		for (int i = 0; i < cut.size; i++)
+			if (cut.leaves[i] == n)
+				leaf_idx = i;
+
+		if (leaf_idx >= 0)
+			value = var_masks[leaf_idx];
+		else if (!is_gate(n))
+			value = nodes[n].bit == RTLIL::State::S1 ? ~uint64_t(0) : 0;
+		else {
+			std::vector<uint64_t> in;
+			for (int f : nodes[n].fanins)
+				in.push_back(cut_function(f, cut, cache));
+			value = eval_gate(nodes[n].cell->type, in);
+		}
+
+		cache[n] = value;
+		return value;
+	}
+
+	void run()
+	{
+		if (!build_graph() || order.empty())
+			return;
+
+		cuts.resize(GetSize(nodes));
+		best.resize(GetSize(nodes));
+		arrival.assign(GetSize(nodes), 0);
+		flow.assign(GetSize(nodes), 0);
+
+		for (int n : order)
+			enumerate_cuts(n, MODE_DEPTH);
+		update_cover();
+
+		if (config.area_recovery) {
+			for (int n : order)
+				enumerate_cuts(n, MODE_FLOW);
+			update_cover();
+			exact_area();
+		}
+
+		int count_gates = 0, count_luts = 0;
+		for (int n : order) {
+			module->remove(nodes[n].cell);
+			count_gates++;
+		}
+
+		for (int n : order)
+		{
+			if (refs[n] == 0)
+				continue;
+
+			const cut_t &cut = best[n];
+			dict<int, uint64_t> cache;
+			uint64_t func = cut_function(n, cut, cache);
+
+			if (cut.size == 0) {
+				module->connect(nodes[n].bit, func & 1 ? RTLIL::State::S1 : RTLIL::State::S0);
+				continue;
+			}
+
+			RTLIL::SigSpec sig_a;
+			for (int i = 0; i < cut.size; i++)
+				sig_a.append(nodes[cut.leaves[i]].bit);
+
+			RTLIL::Const lut(RTLIL::State::S0, 1 << cut.size);
+			for (int i = 0; i < GetSize(lut); i++)
+				if ((func >> i) & 1)
+					lut.bits[i] = RTLIL::State::S1;
+
+			RTLIL::Cell *cell = module->addCell(NEW_ID, "$lut");
+			cell->parameters["\\WIDTH"] = cut.size;
+			cell->parameters["\\LUT"] = lut;
+			cell->setPort("\\A", sig_a);
+			cell->setPort("\\Y", nodes[n].bit);
+			count_luts++;
+		}
+
+		log("Mapped %d gates in module %s to %d LUTs with a depth of %d levels.\n",
+				count_gates, log_id(module), count_luts, max_depth());
+	}
+};
+
+struct LutmapPass : public Pass {
+	LutmapPass() : Pass("lutmap", "map gates to LUTs with priority cuts") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    lutmap [options] [selection]\n");
+		log("\n");
+		log("This pass maps the fine-grain gate cells ($_AND_, $_OR_, $_XOR_, $_MUX_, ...) to\n");
+		log("$lut cells, without calling an external tool. It enumerates the k-feasible cuts\n");
+		log("of every gate, keeps the best few of them (priority cuts) and selects a cover\n");
+		log("with the minimal number of logic levels. Then the cover is improved for area\n");
+		log("with area flow and exact area recovery, without increasing the depth.\n");
+		log("\n");
+		log("Gates with the 'keep' attribute, other cells and module ports are boundaries\n");
+		log("of the mapping. Modules are mapped in parallel when yosys runs with -j.\n");
+		log("\n");
+		log("    -k <int>\n");
+		log("        the number of LUT inputs (at most %d, default: 4)\n", LUTMAP_MAX_K);
+		log("\n");
+		log("    -cuts <int>\n");
+		log("        the number of priority cuts that are kept per gate (default: 8)\n");
+		log("\n");
+		log("    -noarea\n");
+		log("        only optimize for depth, skip the area recovery\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing LUTMAP pass (map gates to LUTs with priority cuts).\n");
+
+		LutmapConfig config;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-k" && argidx+1 < args.size()) {
+				config.lut_size = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-cuts" && argidx+1 < args.size()) {
+				config.max_cuts = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-noarea") {
+				config.area_recovery = false;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		if (config.lut_size < 2 || config.lut_size > LUTMAP_MAX_K)
+			log_cmd_error("The LUT size must be between 2 and %d.\n", LUTMAP_MAX_K);
+		if (config.max_cuts < 1)
+			log_cmd_error("At least one cut per gate must be kept.\n");
+
+		run_module_jobs(design, design->selected_modules(), [&](RTLIL::Module *mod) {
+			if (!mod->has_processes_warn()) {
+				LutmapWorker worker(config, mod);
+				worker.run();
+			}
+		});
+	}
+} LutmapPass;
+
+PRIVATE_NAMESPACE_END
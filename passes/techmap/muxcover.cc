@@ -40,10 +40,16 @@ struct MuxcoverWorker
 		newmux_t() : cost(0) {}
 	};
 
+	struct muxnode_t
+	{
+		SigBit a, b, s;
+	};
+
 	struct tree_t
 	{
 		SigBit root;
 		dict<SigBit, Cell*> muxes;
+		dict<SigBit, muxnode_t> nodes;
 		dict<SigBit, newmux_t> newmuxes;
 	};
 
@@ -109,9 +115,13 @@ struct MuxcoverWorker
 				SigBit bit = wavefront.pop();
 				if (sig_to_mux.count(bit) && (bit == rootsig || !roots.count(bit))) {
 					Cell *c = sig_to_mux.at(bit);
+					muxnode_t &node = tree.nodes[bit];
+					node.a = sigmap(c->getPort("\\A"));
+					node.b = sigmap(c->getPort("\\B"));
+					node.s = sigmap(c->getPort("\\S"));
 					tree.muxes[bit] = c;
-					wavefront.insert(sigmap(c->getPort("\\A")));
-					wavefront.insert(sigmap(c->getPort("\\B")));
+					wavefront.insert(node.a);
+					wavefront.insert(node.b);
 				}
 			}
 
@@ -126,15 +136,14 @@ struct MuxcoverWorker
 
 	bool follow_muxtree(SigBit &ret_bit, tree_t &tree, SigBit bit, const char *path)
 	{
-		if (*path) {
-			if (tree.muxes.count(bit) == 0)
+		for (; *path; path++) {
+			auto it = tree.nodes.find(bit);
+			if (it == tree.nodes.end())
 				return false;
-			char port_name[3] = {'\\', *path, 0};
-			return follow_muxtree(ret_bit, tree, sigmap(tree.muxes.at(bit)->getPort(port_name)), path+1);
-		} else {
-			ret_bit = bit;
-			return true;
+			bit = *path == 'A' ? it->second.a : *path == 'B' ? it->second.b : it->second.s;
 		}
+		ret_bit = bit;
+		return true;
 	}
 
 	int prepare_decode_mux(SigBit &A, SigBit B, SigBit sel, SigBit bit)
@@ -179,12 +188,14 @@ struct MuxcoverWorker
 		decode_mux_counter++;
 	}
 
-	int find_best_cover(tree_t &tree, SigBit bit)
+	// the cover cost of a node whose inputs have been covered already
+	int cover_cost(tree_t &tree, SigBit bit)
 	{
-		if (tree.newmuxes.count(bit)) {
-			return tree.newmuxes.at(bit).cost;
-		}
+		return tree.newmuxes.at(bit).cost;
+	}
 
+	void find_node_cover(tree_t &tree, SigBit bit)
+	{
 		SigBit A, B, C, D, E, F, G, H, I, J, K, L, M, N, O, P;
 		SigBit S1, S2, S3, S4, S5, S6, S7, S8;
 		SigBit T1, T2, T3, T4;
@@ -210,8 +221,8 @@ struct MuxcoverWorker
 			mux.selects.push_back(S1);
 
 			mux.cost += COST_MUX2;
-			mux.cost += find_best_cover(tree, A);
-			mux.cost += find_best_cover(tree, B);
+			mux.cost += cover_cost(tree, A);
+			mux.cost += cover_cost(tree, B);
 
 			best_mux = mux;
 		}
@@ -248,10 +259,10 @@ struct MuxcoverWorker
 				mux.selects.push_back(T1);
 
 				mux.cost += COST_MUX4;
-				mux.cost += find_best_cover(tree, A);
-				mux.cost += find_best_cover(tree, B);
-				mux.cost += find_best_cover(tree, C);
-				mux.cost += find_best_cover(tree, D);
+				mux.cost += cover_cost(tree, A);
+				mux.cost += cover_cost(tree, B);
+				mux.cost += cover_cost(tree, C);
+				mux.cost += cover_cost(tree, D);
 
 				if (best_mux.cost > mux.cost)
 					best_mux = mux;
@@ -311,14 +322,14 @@ struct MuxcoverWorker
 				mux.selects.push_back(U1);
 
 				mux.cost += COST_MUX8;
-				mux.cost += find_best_cover(tree, A);
-				mux.cost += find_best_cover(tree, B);
-				mux.cost += find_best_cover(tree, C);
-				mux.cost += find_best_cover(tree, D);
-				mux.cost += find_best_cover(tree, E);
-				mux.cost += find_best_cover(tree, F);
-				mux.cost += find_best_cover(tree, G);
-				mux.cost += find_best_cover(tree, H);
+				mux.cost += cover_cost(tree, A);
+				mux.cost += cover_cost(tree, B);
+				mux.cost += cover_cost(tree, C);
+				mux.cost += cover_cost(tree, D);
+				mux.cost += cover_cost(tree, E);
+				mux.cost += cover_cost(tree, F);
+				mux.cost += cover_cost(tree, G);
+				mux.cost += cover_cost(tree, H);
 
 				if (best_mux.cost > mux.cost)
 					best_mux = mux;
@@ -415,22 +426,22 @@ struct MuxcoverWorker
 				mux.selects.push_back(V1);
 
 				mux.cost += COST_MUX16;
-				mux.cost += find_best_cover(tree, A);
-				mux.cost += find_best_cover(tree, B);
-				mux.cost += find_best_cover(tree, C);
-				mux.cost += find_best_cover(tree, D);
-				mux.cost += find_best_cover(tree, E);
-				mux.cost += find_best_cover(tree, F);
-				mux.cost += find_best_cover(tree, G);
-				mux.cost += find_best_cover(tree, H);
-				mux.cost += find_best_cover(tree, I);
-				mux.cost += find_best_cover(tree, J);
-				mux.cost += find_best_cover(tree, K);
-				mux.cost += find_best_cover(tree, L);
-				mux.cost += find_best_cover(tree, M);
-				mux.cost += find_best_cover(tree, N);
-				mux.cost += find_best_cover(tree, O);
-				mux.cost += find_best_cover(tree, P);
+				mux.cost += cover_cost(tree, A);
+				mux.cost += cover_cost(tree, B);
+				mux.cost += cover_cost(tree, C);
+				mux.cost += cover_cost(tree, D);
+				mux.cost += cover_cost(tree, E);
+				mux.cost += cover_cost(tree, F);
+				mux.cost += cover_cost(tree, G);
+				mux.cost += cover_cost(tree, H);
+				mux.cost += cover_cost(tree, I);
+				mux.cost += cover_cost(tree, J);
+				mux.cost += cover_cost(tree, K);
+				mux.cost += cover_cost(tree, L);
+				mux.cost += cover_cost(tree, M);
+				mux.cost += cover_cost(tree, N);
+				mux.cost += cover_cost(tree, O);
+				mux.cost += cover_cost(tree, P);
 
 				if (best_mux.cost > mux.cost)
 					best_mux = mux;
@@ -438,16 +449,65 @@ struct MuxcoverWorker
 		}
 
 		tree.newmuxes[bit] = best_mux;
-		return best_mux.cost;
 	}
 
-	void implement_best_cover(tree_t &tree, SigBit bit, int count_muxes_by_type[4])
+	// evaluate the nodes bottom-up (A before B, as the decoder mux sharing
+	// depends on the order of evaluation) so that every node is visited once
+	// and deep trees do not exhaust the stack
+	int find_best_cover(tree_t &tree, SigBit root)
+	{
+		vector<pair<SigBit, bool>> stack;
+		stack.push_back(make_pair(root, false));
+
+		while (!stack.empty())
+		{
+			SigBit bit = stack.back().first;
+			bool expanded = stack.back().second;
+			stack.pop_back();
+
+			if (tree.newmuxes.count(bit))
+				continue;
+
+			auto it = tree.nodes.find(bit);
+			if (!expanded && it != tree.nodes.end()) {
+				stack.push_back(make_pair(bit, true));
+				stack.push_back(make_pair(it->second.b, false));
+				stack.push_back(make_pair(it->second.a, false));
+				continue;
+			}
+
+			find_node_cover(tree, bit);
+		}
+
+		return tree.newmuxes.at(root).cost;
+	}
+
+	void implement_best_cover(tree_t &tree, SigBit root, int count_muxes_by_type[4])
 	{
-		newmux_t mux = tree.newmuxes.at(bit);
+		vector<pair<SigBit, bool>> stack;
+		stack.push_back(make_pair(root, false));
+
+		while (!stack.empty())
+		{
+			SigBit bit = stack.back().first;
+			bool expanded = stack.back().second;
+			stack.pop_back();
 
-		for (auto inbit : mux.inputs)
-			implement_best_cover(tree, inbit, count_muxes_by_type);
+			const newmux_t &mux = tree.newmuxes.at(bit);
 
+			if (!expanded) {
+				stack.push_back(make_pair(bit, true));
+				for (int i = GetSize(mux.inputs)-1; i >= 0; i--)
+					stack.push_back(make_pair(mux.inputs[i], false));
+				continue;
+			}
+
+			implement_mux(tree, bit, mux, count_muxes_by_type);
+		}
+	}
+
+	void implement_mux(tree_t &tree, SigBit bit, const newmux_t &mux, int count_muxes_by_type[4])
+	{
 		for (auto selbit : mux.selects)
 			implement_decode_mux(selbit);
 
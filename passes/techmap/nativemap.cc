@@ -0,0 +1,357 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "nativemap.h"
+#include "simplemap.h"
+
+USING_YOSYS_NAMESPACE
+YOSYS_NAMESPACE_BEGIN
+
+// Creates the gates for one cell. Constant inputs are folded, like the
+// 'opt' commands in the _TECHMAP_DO_ wires of the templates would do.
+struct NativemapGates
+{
+	RTLIL::Module *module;
+	SimplemapSrc gate_src;
+
+	// remove undef inputs from muxes (opt_expr -mux_undef)
+	bool mux_undef;
+
+	NativemapGates(RTLIL::Module *module, RTLIL::Cell *cell) : module(module), gate_src(cell), mux_undef(false) { }
+
+	RTLIL::SigBit add_gate(RTLIL::IdString type, RTLIL::SigBit a, RTLIL::SigBit b = RTLIL::State::Sx, RTLIL::SigBit s = RTLIL::State::Sx)
+	{
+		RTLIL::SigBit y = module->addWire(NEW_ID);
+		RTLIL::Cell *gate = module->addCell(NEW_ID, type);
+		gate_src.apply(gate);
+		gate->setPort(ID("\\A"), a);
+		if (type != ID("$_NOT_"))
+			gate->setPort(ID("\\B"), b);
+		if (type == ID("$_MUX_"))
+			gate->setPort(ID("\\S"), s);
+		gate->setPort(ID("\\Y"), y);
+		return y;
+	}
+
+	RTLIL::SigBit NOT(RTLIL::SigBit a)
+	{
+		if (a == RTLIL::State::S0) return RTLIL::State::S1;
+		if (a == RTLIL::State::S1) return RTLIL::State::S0;
+		return add_gate(ID("$_NOT_"), a);
+	}
+
+	RTLIL::SigBit AND(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (a == RTLIL::State::S0 || b == RTLIL::State::S0) return RTLIL::State::S0;
+		if (a == RTLIL::State::S1) return b;
+		if (b == RTLIL::State::S1) return a;
+		return add_gate(ID("$_AND_"), a, b);
+	}
+
+	RTLIL::SigBit OR(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (a == RTLIL::State::S1 || b == RTLIL::State::S1) return RTLIL::State::S1;
+		if (a == RTLIL::State::S0) return b;
+		if (b == RTLIL::State::S0) return a;
+		return add_gate(ID("$_OR_"), a, b);
+	}
+
+	RTLIL::SigBit XOR(RTLIL::SigBit a, RTLIL::SigBit b)
+	{
+		if (a == RTLIL::State::S0) return b;
+		if (b == RTLIL::State::S0) return a;
+		if (a == RTLIL::State::S1) return NOT(b);
+		if (b == RTLIL::State::S1) return NOT(a);
+		return add_gate(ID("$_XOR_"), a, b);
+	}
+
+	RTLIL::SigBit MUX(RTLIL::SigBit a, RTLIL::SigBit b, RTLIL::SigBit s)
+	{
+		if (s == RTLIL::State::S0 || a == b) return a;
+		if (s == RTLIL::State::S1) return b;
+		if (mux_undef && a == RTLIL::State::Sx) return b;
+		if (mux_undef && b == RTLIL::State::Sx) return a;
+		return add_gate(ID("$_MUX_"), a, b, s);
+	}
+
+	// balanced tree, like simplemap_reduce()
+	RTLIL::SigBit REDUCE_OR(std::vector<RTLIL::SigBit> bits)
+	{
+		if (bits.empty())
+			return RTLIL::State::S0;
+		while (GetSize(bits) > 1) {
+			std::vector<RTLIL::SigBit> next_bits;
+			for (int i = 0; i+1 < GetSize(bits); i += 2)
+				next_bits.push_back(OR(bits[i], bits[i+1]));
+			if (GetSize(bits) % 2 == 1)
+				next_bits.push_back(bits.back());
+			bits.swap(next_bits);
+		}
+		return bits.front();
+	}
+};
+
+static int nativemap_clog2(int n)
+{
+	int k = 0;
+	while ((1 << k) < n)
+		k++;
+	return k;
+}
+
+// _90_fa
+void nativemap_fa(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	RTLIL::SigSpec sig_a = cell->getPort("\\A");
+	RTLIL::SigSpec sig_b = cell->getPort("\\B");
+	RTLIL::SigSpec sig_c = cell->getPort("\\C");
+	RTLIL::SigSpec sig_x, sig_y;
+
+	for (int i = 0; i < GetSize(sig_a); i++) {
+		RTLIL::SigBit t1 = gates.XOR(sig_a[i], sig_b[i]);
+		RTLIL::SigBit t2 = gates.AND(sig_a[i], sig_b[i]);
+		RTLIL::SigBit t3 = gates.AND(sig_c[i], t1);
+		sig_y.append(gates.XOR(t1, sig_c[i]));
+		sig_x.append(gates.OR(t2, t3));
+	}
+
+	module->connect(cell->getPort("\\X"), sig_x);
+	module->connect(cell->getPort("\\Y"), sig_y);
+}
+
+// _90_lcu: Brent-Kung carry lookahead
+void nativemap_lcu(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	std::vector<RTLIL::SigBit> p = cell->getPort("\\P").bits();
+	std::vector<RTLIL::SigBit> g = cell->getPort("\\G").bits();
+	RTLIL::SigBit ci = cell->getPort("\\CI").as_bit();
+	int width = GetSize(p);
+
+	if (width == 0)
+		return;
+
+	g[0] = gates.OR(g[0], gates.AND(p[0], ci));
+
+	int levels = nativemap_clog2(width);
+
+	for (int i = 1; i <= levels; i++)
+		for (int j = (1 << i) - 1; j < width; j += 1 << i) {
+			g[j] = gates.OR(g[j], gates.AND(p[j], g[j - (1 << (i-1))]));
+			p[j] = gates.AND(p[j], p[j - (1 << (i-1))]);
+		}
+
+	for (int i = levels; i > 0; i--)
+		for (int j = (1 << i) + (1 << (i-1)) - 1; j < width; j += 1 << i) {
+			g[j] = gates.OR(g[j], gates.AND(p[j], g[j - (1 << (i-1))]));
+			p[j] = gates.AND(p[j], p[j - (1 << (i-1))]);
+		}
+
+	module->connect(cell->getPort("\\CO"), g);
+}
+
+// _90_alu: the carry chain is left to an $lcu cell
+void nativemap_alu(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	int width = cell->getParam("\\Y_WIDTH").as_int();
+
+	RTLIL::SigSpec sig_a = cell->getPort("\\A");
+	RTLIL::SigSpec sig_b = cell->getPort("\\B");
+	sig_a.extend_u0(width, cell->getParam("\\A_SIGNED").as_bool());
+	sig_b.extend_u0(width, cell->getParam("\\B_SIGNED").as_bool());
+
+	RTLIL::SigBit ci = cell->getPort("\\CI").as_bit();
+	RTLIL::SigBit bi = cell->getPort("\\BI").as_bit();
+	RTLIL::SigSpec sig_co = cell->getPort("\\CO");
+	RTLIL::SigSpec sig_x, sig_g, sig_y;
+
+	for (int i = 0; i < width; i++) {
+		RTLIL::SigBit bb = gates.XOR(sig_b[i], bi);
+		sig_x.append(gates.XOR(sig_a[i], bb));
+		sig_g.append(gates.AND(sig_a[i], bb));
+	}
+
+	RTLIL::Cell *lcu = module->addCell(NEW_ID, ID("$lcu"));
+	gates.gate_src.apply(lcu);
+	lcu->setParam("\\WIDTH", width);
+	lcu->setPort("\\P", sig_x);
+	lcu->setPort("\\G", sig_g);
+	lcu->setPort("\\CI", ci);
+	lcu->setPort("\\CO", sig_co);
+
+	for (int i = 0; i < width; i++)
+		sig_y.append(gates.XOR(sig_x[i], i == 0 ? ci : sig_co[i-1]));
+
+	module->connect(cell->getPort("\\X"), sig_x);
+	module->connect(cell->getPort("\\Y"), sig_y);
+}
+
+// _90_shift_ops_shr_shl_sshl_sshr: logarithmic shifter
+void nativemap_shift_ops(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	bool shift_left = cell->type.in("$shl", "$sshl");
+	bool a_signed = cell->getParam("\\A_SIGNED").as_bool();
+	bool sign_extend = a_signed && cell->type == "$sshr";
+
+	RTLIL::SigSpec sig_a = cell->getPort("\\A");
+	RTLIL::SigSpec sig_b = cell->getPort("\\B");
+	RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+	int a_width = GetSize(sig_a), b_width = GetSize(sig_b), y_width = GetSize(sig_y);
+	int width = std::max(a_width, y_width);
+	int bb_width = std::min(nativemap_clog2(shift_left ? y_width : a_signed ? width : a_width) + 1, b_width);
+
+	RTLIL::SigBit overflow = RTLIL::State::S0;
+	if (b_width > bb_width)
+		overflow = gates.REDUCE_OR(sig_b.extract(bb_width, b_width - bb_width).bits());
+
+	RTLIL::SigBit a_msb = a_width > 0 ? sig_a[a_width-1] : RTLIL::State::S0;
+	RTLIL::SigBit fill = sign_extend ? a_msb : RTLIL::State::S0;
+
+	std::vector<RTLIL::SigBit> buffer = sig_a.bits();
+	buffer.resize(width, a_signed ? a_msb : RTLIL::State::S0);
+	for (auto &bit : buffer)
+		bit = gates.MUX(bit, fill, overflow);
+
+	for (int i = 0; i < bb_width; i++)
+	{
+		int dist = 1 << i;
+		std::vector<RTLIL::SigBit> shifted(width);
+		RTLIL::SigBit right_fill = sign_extend ? buffer[width-1] : RTLIL::State::S0;
+
+		for (int k = 0; k < width; k++) {
+			if (shift_left)
+				shifted[k] = k < dist ? RTLIL::SigBit(RTLIL::State::S0) : buffer[k - dist];
+			else
+				shifted[k] = k + dist < width ? buffer[k + dist] : right_fill;
+		}
+
+		for (int k = 0; k < width; k++)
+			buffer[k] = gates.MUX(buffer[k], shifted[k], sig_b[i]);
+	}
+
+	buffer.resize(y_width);
+	module->connect(sig_y, buffer);
+}
+
+// _90_shift_shiftx: logarithmic shifter with signed or unsigned shift amount
+void nativemap_shift_shiftx(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	bool b_signed = cell->getParam("\\B_SIGNED").as_bool();
+	RTLIL::SigBit extbit = cell->type == "$shift" ? RTLIL::State::S0 : RTLIL::State::Sx;
+	gates.mux_undef = cell->type == "$shiftx";
+
+	RTLIL::SigSpec sig_a = cell->getPort("\\A");
+	RTLIL::SigSpec sig_b = cell->getPort("\\B");
+	RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+	int a_width = GetSize(sig_a), b_width = GetSize(sig_b), y_width = GetSize(sig_y);
+	int ay_width = std::max(a_width, y_width);
+	int bb_width = std::min(nativemap_clog2(ay_width) + (b_signed ? 2 : 1), b_width);
+	int width = ay_width + (b_signed && bb_width > 0 ? 1 << (bb_width-1) : 0);
+
+	RTLIL::SigBit overflow = RTLIL::State::S0;
+	if (b_width > bb_width) {
+		std::vector<RTLIL::SigBit> overflow_bits;
+		for (int i = bb_width; i < b_width; i++)
+			overflow_bits.push_back(b_signed ? gates.XOR(sig_b[i], sig_b[bb_width-1]) : sig_b[i]);
+		overflow = gates.REDUCE_OR(overflow_bits);
+	}
+
+	std::vector<RTLIL::SigBit> buffer = sig_a.bits();
+	buffer.resize(ay_width, RTLIL::State::S0);
+	buffer.resize(width, extbit);
+	for (auto &bit : buffer)
+		bit = gates.MUX(bit, extbit, overflow);
+
+	for (int i = bb_width-1; i >= 0; i--)
+	{
+		int dist = 1 << i;
+		std::vector<RTLIL::SigBit> shifted(width);
+
+		for (int k = 0; k < width; k++) {
+			if (b_signed && i == bb_width-1)
+				shifted[k] = k < dist ? extbit : buffer[k - dist];
+			else
+				shifted[k] = k + dist < width ? buffer[k + dist] : extbit;
+		}
+
+		for (int k = 0; k < width; k++)
+			buffer[k] = gates.MUX(buffer[k], shifted[k], sig_b[i]);
+	}
+
+	buffer.resize(y_width);
+	module->connect(sig_y, buffer);
+}
+
+// _90_pmux
+void nativemap_pmux(RTLIL::Module *module, RTLIL::Cell *cell)
+{
+	NativemapGates gates(module, cell);
+	RTLIL::SigSpec sig_a = cell->getPort("\\A");
+	RTLIL::SigSpec sig_b = cell->getPort("\\B");
+	RTLIL::SigSpec sig_s = cell->getPort("\\S");
+	RTLIL::SigSpec sig_y;
+	int width = GetSize(sig_a);
+
+	RTLIL::SigBit any_s = gates.REDUCE_OR(sig_s.bits());
+
+	for (int i = 0; i < width; i++) {
+		std::vector<RTLIL::SigBit> b_and_s;
+		for (int j = 0; j < GetSize(sig_s); j++)
+			b_and_s.push_back(gates.AND(sig_b[width*j + i], sig_s[j]));
+		sig_y.append(gates.MUX(sig_a[i], gates.REDUCE_OR(b_and_s), any_s));
+	}
+
+	module->connect(cell->getPort("\\Y"), sig_y);
+}
+
+static std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> &nativemap_registered_mappers()
+{
+	static std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> mappers;
+	return mappers;
+}
+
+void nativemap_register(RTLIL::IdString type, void(*mapper)(RTLIL::Module*, RTLIL::Cell*))
+{
+	nativemap_registered_mappers()[type] = mapper;
+}
+
+void nativemap_get_mappers(std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> &mappers)
+{
+	mappers["$fa"]     = nativemap_fa;
+	mappers["$lcu"]    = nativemap_lcu;
+	mappers["$alu"]    = nativemap_alu;
+	mappers["$shl"]    = nativemap_shift_ops;
+	mappers["$shr"]    = nativemap_shift_ops;
+	mappers["$sshl"]   = nativemap_shift_ops;
+	mappers["$sshr"]   = nativemap_shift_ops;
+	mappers["$shift"]  = nativemap_shift_shiftx;
+	mappers["$shiftx"] = nativemap_shift_shiftx;
+	mappers["$pmux"]   = nativemap_pmux;
+
+	for (auto &it : nativemap_registered_mappers())
+		mappers[it.first] = it.second;
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,49 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef NATIVEMAP_H
+#define NATIVEMAP_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// The nativemap rules replace a coarse-grain cell by the same logic as the
+// corresponding template in techlibs/common/techmap.v, but without deriving
+// and instantiating a template module. techmap uses them for map file modules
+// with the 'techmap_nativemap' attribute. The rules create fine-grain gates,
+// except that $alu creates an $lcu cell (that is then mapped on its own).
+
+extern void nativemap_fa(RTLIL::Module *module, RTLIL::Cell *cell);
+extern void nativemap_lcu(RTLIL::Module *module, RTLIL::Cell *cell);
+extern void nativemap_alu(RTLIL::Module *module, RTLIL::Cell *cell);
+extern void nativemap_shift_ops(RTLIL::Module *module, RTLIL::Cell *cell);
+extern void nativemap_shift_shiftx(RTLIL::Module *module, RTLIL::Cell *cell);
+extern void nativemap_pmux(RTLIL::Module *module, RTLIL::Cell *cell);
+
+// Target libraries and plugins can add rules for further cell types or
+// replace the built-in ones, for example from the constructor of a global
+// object. The rules registered last take precedence.
+extern void nativemap_register(RTLIL::IdString type, void(*mapper)(RTLIL::Module*, RTLIL::Cell*));
+
+extern void nativemap_get_mappers(std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> &mappers);
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -52,9 +52,10 @@ struct NlutmapWorker
 	{
 		Pass::call_on_selection(module->design, get_selection(), "lut2mux");
 
-		if (lut_size > 0)
+		if (lut_size > 0) {
 			Pass::call_on_selection(module->design, get_selection(), stringf("abc -lut 1:%d", lut_size));
-		else
+			Pass::call_on_selection(module->design, get_selection(), "opt_lut");
+		} else
 			Pass::call_on_selection(module->design, get_selection(), "abc");
 
 		Pass::call_on_module(module->design, module, "opt_clean");
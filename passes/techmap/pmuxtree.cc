@@ -23,47 +23,78 @@
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-static SigSpec or_generator(Module *module, const SigSpec &sig)
+struct PmuxtreeWorker
 {
-	switch (GetSize(sig))
+	Module *module;
+	SigMap sigmap;
+
+	// OR of a list of select bits, shared by all $pmux cells in the module
+	dict<SigSpec, SigBit> or_cache;
+
+	PmuxtreeWorker(Module *module) : module(module), sigmap(module) { }
+
+	// balanced tree of $or cells, split like the select bits in
+	// recursive_mux_generator() so that the ORs of the subtrees are reused
+	SigBit or_generator(const SigSpec &sig)
 	{
-	case 0:
-		return State::S0;
-	case 1:
-		return sig;
-	case 2:
-		return module->Or(NEW_ID, sig[0], sig[1]);
-	default:
-		return module->ReduceOr(NEW_ID, sig);
+		if (GetSize(sig) == 0)
+			return State::S0;
+		if (GetSize(sig) == 1)
+			return sig[0];
+
+		SigSpec key = sigmap(sig);
+		auto it = or_cache.find(key);
+		if (it != or_cache.end())
+			return it->second;
+
+		int left_size = GetSize(sig) / 2;
+		SigBit left_or = or_generator(sig.extract(0, left_size));
+		SigBit right_or = or_generator(sig.extract(left_size, GetSize(sig) - left_size));
+
+		SigBit result = module->Or(NEW_ID, left_or, right_or);
+		or_cache[key] = result;
+		return result;
 	}
-}
 
-static SigSpec recursive_mux_generator(Module *module, const SigSpec &sig_data, const SigSpec &sig_sel, SigSpec &sig_or)
-{
-	if (GetSize(sig_sel) == 1) {
-		sig_or.append(sig_sel);
-		return sig_data;
-	}
+	SigSpec recursive_mux_generator(const SigSpec &sig_data, const SigSpec &sig_sel)
+	{
+		if (GetSize(sig_sel) == 1)
+			return sig_data;
 
-	int left_size = GetSize(sig_sel) / 2;
-	int right_size = GetSize(sig_sel) - left_size;
-	int stride = GetSize(sig_data) / GetSize(sig_sel);
+		int left_size = GetSize(sig_sel) / 2;
+		int right_size = GetSize(sig_sel) - left_size;
+		int stride = GetSize(sig_data) / GetSize(sig_sel);
 
-	SigSpec left_data = sig_data.extract(0, stride*left_size);
-	SigSpec right_data = sig_data.extract(stride*left_size, stride*right_size);
+		SigSpec left_data = sig_data.extract(0, stride*left_size);
+		SigSpec right_data = sig_data.extract(stride*left_size, stride*right_size);
 
-	SigSpec left_sel = sig_sel.extract(0, left_size);
-	SigSpec right_sel = sig_sel.extract(left_size, right_size);
+		SigSpec left_sel = sig_sel.extract(0, left_size);
+		SigSpec right_sel = sig_sel.extract(left_size, right_size);
 
-	SigSpec left_or, left_result, right_result;
+		SigSpec left_result = recursive_mux_generator(left_data, left_sel);
+		SigSpec right_result = recursive_mux_generator(right_data, right_sel);
 
-	left_result = recursive_mux_generator(module, left_data, left_sel, left_or);
-	right_result = recursive_mux_generator(module, right_data, right_sel, sig_or);
-	left_or = or_generator(module, left_or);
-	sig_or.append(left_or);
+		return module->Mux(NEW_ID, right_result, left_result, or_generator(left_sel));
+	}
+
+	void run(Cell *cell)
+	{
+		SigSpec sig_data = cell->getPort("\\B");
+		SigSpec sig_sel = cell->getPort("\\S");
+		SigSpec result = cell->getPort("\\A");
+
+		if (GetSize(sig_sel) != 0) {
+			SigSpec tree_result = recursive_mux_generator(sig_data, sig_sel);
+			if (result.is_fully_undef())
+				result = tree_result;
+			else
+				result = module->Mux(NEW_ID, result, tree_result, or_generator(sig_sel));
+		}
 
-	return module->Mux(NEW_ID, right_result, left_result, left_or);
-}
+		module->connect(cell->getPort("\\Y"), result);
+		module->remove(cell);
+	}
+};
 
 struct PmuxtreePass : public Pass {
 	PmuxtreePass() : Pass("pmuxtree", "transform $pmux cells to trees of $mux cells") { }
@@ -75,6 +106,11 @@ struct PmuxtreePass : public Pass {
 		log("\n");
 		log("This pass transforms $pmux cells to a trees of $mux cells.\n");
 		log("\n");
+		log("The trees are balanced. The ORs of the select bits that control the $mux cells\n");
+		log("are created as balanced trees of $or cells that are shared by all $pmux cells\n");
+		log("in a module, so that $pmux cells with the same select signal (e.g. from the\n");
+		log("same case statement) use the same select logic.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
@@ -87,24 +123,11 @@ struct PmuxtreePass : public Pass {
 		extra_args(args, argidx, design);
 
 		for (auto module : design->selected_modules())
-		for (auto cell : module->selected_cells())
 		{
-			if (cell->type != "$pmux")
-				continue;
-
-			SigSpec sig_data = cell->getPort("\\B");
-			SigSpec sig_sel = cell->getPort("\\S");
-
-			if (!cell->getPort("\\A").is_fully_undef()) {
-				sig_data.append(cell->getPort("\\A"));
-				SigSpec sig_sel_or = module->ReduceOr(NEW_ID, sig_sel);
-				sig_sel.append(module->Not(NEW_ID, sig_sel_or));
-			}
-
-			SigSpec result, result_or;
-			result = recursive_mux_generator(module, sig_data, sig_sel, result_or);
-			module->connect(cell->getPort("\\Y"), result);
-			module->remove(cell);
+			PmuxtreeWorker worker(module);
+			for (auto cell : module->selected_cells())
+				if (cell->type == "$pmux")
+					worker.run(cell);
 		}
 	}
 } PmuxtreePass;
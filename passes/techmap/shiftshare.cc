@@ -0,0 +1,227 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct ShiftshareWorker
+{
+	RTLIL::Module *module;
+	SigMap sigmap;
+
+	// cells that can share one shifter: same direction (or $shift/$shiftx
+	// semantics), same shift amount and same lane width
+	struct group_key_t
+	{
+		RTLIL::IdString type;
+		RTLIL::SigSpec b;
+		bool b_signed;
+		int width;
+
+		bool operator==(const group_key_t &other) const {
+			return type == other.type && b == other.b && b_signed == other.b_signed && width == other.width;
+		}
+		unsigned int hash() const {
+			return mkhash(mkhash(type.hash(), b.hash()), mkhash(b_signed, width));
+		}
+	};
+
+	dict<group_key_t, std::vector<RTLIL::Cell*>> groups;
+	int count_groups, count_cells;
+
+	ShiftshareWorker(RTLIL::Module *module) : module(module), sigmap(module), count_groups(0), count_cells(0) { }
+
+	// the merged cell type for a shift cell, or an empty id for cells that
+	// can't be merged ($sshr with signed A needs its own sign bit as fill)
+	static RTLIL::IdString merged_type(RTLIL::Cell *cell)
+	{
+		if (cell->type.in("$shl", "$sshl"))
+			return "$shl";
+		if (cell->type == "$shr")
+			return "$shr";
+		if (cell->type == "$sshr")
+			return cell->getParam("\\A_SIGNED").as_bool() ? RTLIL::IdString() : RTLIL::IdString("$shr");
+		if (cell->type.in("$shift", "$shiftx"))
+			return cell->type;
+		return RTLIL::IdString();
+	}
+
+	// the lane data of a cell: A extended like the cell type does it, padded
+	// with the bits that the cell shifts in
+	RTLIL::SigSpec lane_data(RTLIL::Cell *cell, RTLIL::IdString type, int width)
+	{
+		RTLIL::SigSpec sig_a = sigmap(cell->getPort("\\A"));
+		bool a_signed = cell->getParam("\\A_SIGNED").as_bool();
+		int y_width = GetSize(cell->getPort("\\Y"));
+
+		if (type == "$shl")
+			sig_a.extend_u0(width, a_signed);
+		else if (type == "$shr") {
+			sig_a.extend_u0(std::max(GetSize(sig_a), y_width), a_signed);
+			sig_a.extend_u0(width);
+		} else
+			sig_a.append(RTLIL::SigSpec(type == "$shiftx" ? RTLIL::State::Sx : RTLIL::State::S0, width - GetSize(sig_a)));
+
+		return sig_a;
+	}
+
+	void add_cell(RTLIL::Cell *cell)
+	{
+		group_key_t key;
+		key.type = merged_type(cell);
+		if (key.type.empty())
+			return;
+
+		key.b = sigmap(cell->getPort("\\B"));
+		key.b_signed = key.type.in("$shift", "$shiftx") && cell->getParam("\\B_SIGNED").as_bool();
+		key.width = std::max(GetSize(cell->getPort("\\A")), GetSize(cell->getPort("\\Y")));
+
+		// 'a << s' and 'b << {1'b0, s}' use the same shift amount
+		if (!key.b_signed)
+			while (GetSize(key.b) > 0 && key.b[GetSize(key.b)-1] == RTLIL::State::S0)
+				key.b.remove(GetSize(key.b)-1);
+
+		if (key.b.is_fully_const())
+			return;
+
+		groups[key].push_back(cell);
+	}
+
+	void merge_group(const group_key_t &key, const std::vector<RTLIL::Cell*> &cells)
+	{
+		int lanes_log2 = ceil_log2(GetSize(cells));
+		int lanes = 1 << lanes_log2;
+		int width = key.width;
+
+		// bits of an unsigned shift amount above ceil_log2(width) only tell if
+		// the whole lane is shifted out, so they are reduced to one bit that
+		// is shared by all lanes
+		RTLIL::SigSpec sig_b = key.b;
+		int low_width = ceil_log2(width);
+		if (!key.b_signed && GetSize(sig_b) > low_width+1) {
+			RTLIL::SigBit overflow = module->ReduceOr(NEW_ID, sig_b.extract(low_width, GetSize(sig_b) - low_width));
+			sig_b = sig_b.extract(0, low_width);
+			sig_b.append(overflow);
+		}
+
+		std::vector<RTLIL::SigSpec> lane_a;
+		for (auto cell : cells)
+			lane_a.push_back(lane_data(cell, key.type, width));
+
+		RTLIL::State unused = key.type == "$shiftx" ? RTLIL::State::Sx : RTLIL::State::S0;
+		while (GetSize(lane_a) < lanes)
+			lane_a.push_back(RTLIL::SigSpec(unused, width));
+
+		RTLIL::SigSpec merged_a, merged_b, merged_y = module->addWire(NEW_ID, lanes * width);
+		for (int i = 0; i < width; i++)
+			for (int k = 0; k < lanes; k++)
+				merged_a.append(lane_a[k][i]);
+
+		merged_b.append(RTLIL::SigSpec(RTLIL::State::S0, lanes_log2));
+		merged_b.append(sig_b);
+
+		RTLIL::Cell *merged = module->addCell(NEW_ID, key.type);
+		merged->parameters["\\A_SIGNED"] = RTLIL::Const(false);
+		merged->parameters["\\B_SIGNED"] = RTLIL::Const(key.b_signed);
+		merged->parameters["\\A_WIDTH"] = RTLIL::Const(GetSize(merged_a));
+		merged->parameters["\\B_WIDTH"] = RTLIL::Const(GetSize(merged_b));
+		merged->parameters["\\Y_WIDTH"] = RTLIL::Const(GetSize(merged_y));
+		merged->setPort("\\A", merged_a);
+		merged->setPort("\\B", merged_b);
+		merged->setPort("\\Y", merged_y);
+
+		log("  creating %s cell %s for %d cells with shift amount %s:\n", log_id(key.type), log_id(merged),
+				GetSize(cells), log_signal(key.b));
+
+		for (int k = 0; k < GetSize(cells); k++)
+		{
+			RTLIL::Cell *cell = cells[k];
+			RTLIL::SigSpec sig_y = cell->getPort("\\Y");
+
+			RTLIL::SigSpec lane_y;
+			for (int i = 0; i < GetSize(sig_y); i++)
+				lane_y.append(merged_y[i * lanes + k]);
+
+			log("    %s (%s)\n", log_id(cell), log_id(cell->type));
+			module->connect(sig_y, lane_y);
+			module->remove(cell);
+		}
+
+		count_groups++;
+		count_cells += GetSize(cells);
+	}
+
+	void run()
+	{
+		for (auto cell : module->selected_cells())
+			if (cell->type.in("$shl", "$shr", "$sshl", "$sshr", "$shift", "$shiftx"))
+				add_cell(cell);
+
+		for (auto &it : groups)
+			if (GetSize(it.second) > 1)
+				merge_group(it.first, it.second);
+
+		if (count_groups > 0)
+			log("Merged %d shift cells into %d cells in module %s.\n", count_cells, count_groups, log_id(module));
+	}
+};
+
+struct ShiftsharePass : public Pass {
+	ShiftsharePass() : Pass("shiftshare", "merge shift cells with the same shift amount") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    shiftshare [selection]\n");
+		log("\n");
+		log("This pass merges $shl, $shr, $sshl, $sshr, $shift and $shiftx cells that shift\n");
+		log("in the same direction by the same shift amount signal into one cell. The data\n");
+		log("inputs of the merged cells are interleaved bit by bit and the shift amount is\n");
+		log("scaled accordingly, so that the merged cell is mapped to a single barrel\n");
+		log("shifter. The logic for the shift amount is then created only once: when the\n");
+		log("shift amount has more bits than needed to shift out the whole data word, the\n");
+		log("upper bits are reduced to one bit with a single $reduce_or cell.\n");
+		log("\n");
+		log("Only cells with the same data width (the larger one of the A and Y ports) are\n");
+		log("merged. $sshr cells with a signed A input are not merged. This pass should run\n");
+		log("after 'alumacc' and before 'techmap'.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		log_header("Executing SHIFTSHARE pass (merge shift cells with the same shift amount).\n");
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			break;
+		}
+		extra_args(args, argidx, design);
+
+		for (auto mod : design->selected_modules())
+			if (!mod->has_processes_warn()) {
+				ShiftshareWorker worker(mod);
+				worker.run();
+			}
+	}
+} ShiftsharePass;
+
+PRIVATE_NAMESPACE_END
@@ -24,6 +24,29 @@
 
 YOSYS_NAMESPACE_BEGIN
 
+// All gates created for a cell get the same \src attribute, so it is built
+// once per cell instead of being parsed and joined again for every gate.
+struct SimplemapSrc
+{
+	bool has_src;
+	RTLIL::Const src;
+
+	SimplemapSrc(RTLIL::Cell *cell)
+	{
+		RTLIL::AttrObject gate_attrs;
+		gate_attrs.add_src_attribute(cell->attributes.at(ID("\\src"), RTLIL::Const()));
+		has_src = gate_attrs.attributes.count(ID("\\src")) != 0;
+		if (has_src)
+			src = gate_attrs.attributes.at(ID("\\src"));
+	}
+
+	void apply(RTLIL::Cell *gate) const
+	{
+		if (has_src)
+			gate->attributes[ID("\\src")] = src;
+	}
+};
+
 extern void simplemap_not(RTLIL::Module *module, RTLIL::Cell *cell);
 extern void simplemap_pos(RTLIL::Module *module, RTLIL::Cell *cell);
 extern void simplemap_bitop(RTLIL::Module *module, RTLIL::Cell *cell);
@@ -20,6 +20,7 @@
 #include "kernel/yosys.h"
 #include "kernel/utils.h"
 #include "kernel/sigtools.h"
+#include "kernel/celltypes.h"
 #include "libs/sha1/sha1.h"
 
 #include <stdlib.h>
@@ -27,6 +28,7 @@
 #include <string.h>
 
 #include "simplemap.h"
+#include "nativemap.h"
 #include "passes/techmap/techmap.inc"
 
 YOSYS_NAMESPACE_BEGIN
@@ -39,6 +41,13 @@ YOSYS_NAMESPACE_END
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
+// parsed map files, indexed by a hash of the file content and frontend command
+dict<std::string, RTLIL::Design*> techmap_library_cache;
+
+// the modules derived from the parametric templates of the cached map files
+// (before any _TECHMAP_DO_ commands are run on them), same index
+dict<std::string, RTLIL::Design*> techmap_derived_cache;
+
 void apply_prefix(std::string prefix, std::string &id)
 {
 	if (id[0] == '\\')
@@ -47,27 +56,18 @@ void apply_prefix(std::string prefix, std::string &id)
 		id = "$techmap" + prefix + "." + id;
 }
 
-void apply_prefix(std::string prefix, RTLIL::SigSpec &sig, RTLIL::Module *module)
-{
-	vector<SigChunk> chunks = sig;
-	for (auto &chunk : chunks)
-		if (chunk.wire != NULL) {
-			std::string wire_name = chunk.wire->name.str();
-			apply_prefix(prefix, wire_name);
-			log_assert(module->wires_.count(wire_name) > 0);
-			chunk.wire = module->wires_[wire_name];
-		}
-	sig = chunks;
-}
-
 struct TechmapWorker
 {
 	std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> simplemap_mappers;
+	std::map<RTLIL::IdString, void(*)(RTLIL::Module*, RTLIL::Cell*)> nativemap_mappers;
 	std::map<std::pair<RTLIL::IdString, std::map<RTLIL::IdString, RTLIL::Const>>, RTLIL::Module*> techmap_cache;
 	std::map<RTLIL::Module*, bool> techmap_do_cache;
 	std::set<RTLIL::Module*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Module>> module_queue;
 	dict<Module*, SigMap> sigmaps;
 
+	// where to store derived modules for reuse in later techmap calls
+	dict<RTLIL::IdString, RTLIL::Design*> derived_cache;
+
 	pool<IdString> flatten_do_list;
 	pool<IdString> flatten_done_list;
 	pool<Cell*> flatten_keep_list;
@@ -79,11 +79,50 @@ struct TechmapWorker
 
 	typedef std::map<std::string, std::vector<TechmapWireData>> TechmapWires;
 
+	// per-template data that does not depend on the cell that is mapped
+	struct TechmapTemplateData {
+		SigMap sigmap;
+		pool<SigBit> written_bits;
+		dict<RTLIL::IdString, RTLIL::IdString> positional_ports;
+	};
+
+	dict<RTLIL::Module*, TechmapTemplateData> template_data;
+
+	// state that is kept between the calls of techmap_module() in a loop over
+	// one module: only the cells created by the previous call can still need
+	// mapping, so after the first call only they are looked at. the monitor
+	// also keeps the sigmap up to date with the new connections.
+	struct TechmapWorklist : public RTLIL::Monitor
+	{
+		bool valid;
+		SigMap sigmap;
+		pool<RTLIL::IdString> cells;
+
+		TechmapWorklist() : valid(false) { }
+
+		void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString&, const RTLIL::SigSpec&, RTLIL::SigSpec&) YS_OVERRIDE {
+			cells.insert(cell->name);
+		}
+
+		void notify_connect(RTLIL::Module*, const RTLIL::SigSig &conn) YS_OVERRIDE {
+			sigmap.add(conn.first, conn.second);
+		}
+
+		void notify_connect(RTLIL::Module*, const std::vector<RTLIL::SigSig>&) YS_OVERRIDE {
+			valid = false;
+		}
+
+		void notify_blackout(RTLIL::Module*) YS_OVERRIDE {
+			valid = false;
+		}
+	};
+
 	bool extern_mode;
 	bool assert_mode;
 	bool flatten_mode;
 	bool recursive_mode;
 	bool autoproc_mode;
+	bool compact_names;
 
 	TechmapWorker()
 	{
@@ -92,6 +131,17 @@ struct TechmapWorker
 		flatten_mode = false;
 		recursive_mode = false;
 		autoproc_mode = false;
+		compact_names = false;
+	}
+
+	std::string prefixed_name(RTLIL::Cell *cell, RTLIL::IdString name)
+	{
+		if (compact_names && name[0] == '$')
+			return stringf("$flatten$%d", autoidx++);
+
+		std::string new_name = name.str();
+		apply_prefix(cell->name.str(), new_name);
+		return new_name;
 	}
 
 	std::string constmap_tpl_name(SigMap &sigmap, RTLIL::Module *tpl, RTLIL::Cell *cell, bool verbose)
@@ -156,6 +206,30 @@ struct TechmapWorker
 		return result;
 	}
 
+	TechmapTemplateData &get_template_data(RTLIL::Module *tpl)
+	{
+		if (template_data.count(tpl))
+			return template_data.at(tpl);
+
+		TechmapTemplateData &td = template_data[tpl];
+		td.sigmap.set(tpl);
+
+		for (auto &it : tpl->wires_)
+			if (it.second->port_id > 0)
+				td.positional_ports[stringf("$%d", it.second->port_id)] = it.first;
+
+		for (auto &it1 : tpl->cells_)
+		for (auto &it2 : it1.second->connections_)
+			if (it1.second->output(it2.first))
+				for (auto bit : td.sigmap(it2.second))
+					td.written_bits.insert(bit);
+		for (auto &it1 : tpl->connections_)
+			for (auto bit : td.sigmap(it1.first))
+				td.written_bits.insert(bit);
+
+		return td;
+	}
+
 	void techmap_module_worker(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Cell *cell, RTLIL::Module *tpl)
 	{
 		if (tpl->processes.size() != 0) {
@@ -166,12 +240,13 @@ struct TechmapWorker
 			if (autoproc_mode) {
 				Pass::call_on_module(tpl->design, tpl, "proc");
 				log_assert(GetSize(tpl->processes) == 0);
+				template_data.erase(tpl);
 			} else
 				log_error("Technology map yielded processes -> this is not supported (use -autoproc to run 'proc' automatically).\n");
 		}
 
 		std::string orig_cell_name;
-		pool<string> extra_src_attrs;
+		RTLIL::Const extra_src_attrs;
 
 		if (!flatten_mode)
 		{
@@ -182,14 +257,13 @@ struct TechmapWorker
 					break;
 				}
 
-			extra_src_attrs = cell->get_strpool_attribute("\\src");
+			extra_src_attrs = cell->attributes.at("\\src", RTLIL::Const());
 		}
 
 		dict<IdString, IdString> memory_renames;
 
 		for (auto &it : tpl->memories) {
-			std::string m_name = it.first.str();
-			apply_prefix(cell->name.str(), m_name);
+			std::string m_name = prefixed_name(cell, it.first);
 			RTLIL::Memory *m = new RTLIL::Memory;
 			m->name = m_name;
 			m->width = it.second->width;
@@ -197,48 +271,44 @@ struct TechmapWorker
 			m->size = it.second->size;
 			m->attributes = it.second->attributes;
 			if (m->attributes.count("\\src"))
-				m->add_strpool_attribute("\\src", extra_src_attrs);
+				m->add_src_attribute(extra_src_attrs);
 			module->memories[m->name] = m;
 			memory_renames[it.first] = m->name;
 			design->select(module, m);
 		}
 
-		std::map<RTLIL::IdString, RTLIL::IdString> positional_ports;
+		TechmapTemplateData &td = get_template_data(tpl);
+
+		// template wires are mapped to their copies with this map instead of looking
+		// up the prefixed name for every signal chunk
+		dict<RTLIL::Wire*, RTLIL::Wire*> wire_map;
+		auto map_sig = [&wire_map](RTLIL::SigSpec &sig) {
+			vector<SigChunk> chunks = sig;
+			for (auto &chunk : chunks)
+				if (chunk.wire != NULL)
+					chunk.wire = wire_map.at(chunk.wire);
+			sig = chunks;
+		};
 
 		for (auto &it : tpl->wires_) {
-			if (it.second->port_id > 0)
-				positional_ports[stringf("$%d", it.second->port_id)] = it.first;
-			std::string w_name = it.second->name.str();
-			apply_prefix(cell->name.str(), w_name);
-			RTLIL::Wire *w = module->addWire(w_name, it.second);
+			RTLIL::Wire *w = module->addWire(prefixed_name(cell, it.second->name), it.second);
+			wire_map[it.second] = w;
 			w->port_input = false;
 			w->port_output = false;
 			w->port_id = 0;
 			if (it.second->get_bool_attribute("\\_techmap_special_"))
 				w->attributes.clear();
 			if (w->attributes.count("\\src"))
-				w->add_strpool_attribute("\\src", extra_src_attrs);
+				w->add_src_attribute(extra_src_attrs);
 			design->select(module, w);
 		}
 
-		SigMap tpl_sigmap(tpl);
-		pool<SigBit> tpl_written_bits;
-
-		for (auto &it1 : tpl->cells_)
-		for (auto &it2 : it1.second->connections_)
-			if (it1.second->output(it2.first))
-				for (auto bit : tpl_sigmap(it2.second))
-					tpl_written_bits.insert(bit);
-		for (auto &it1 : tpl->connections_)
-			for (auto bit : tpl_sigmap(it1.first))
-				tpl_written_bits.insert(bit);
-
 		SigMap port_signal_map;
 
 		for (auto &it : cell->connections()) {
 			RTLIL::IdString portname = it.first;
-			if (positional_ports.count(portname) > 0)
-				portname = positional_ports.at(portname);
+			if (td.positional_ports.count(portname) > 0)
+				portname = td.positional_ports.at(portname);
 			if (tpl->wires_.count(portname) == 0 || tpl->wires_.at(portname)->port_id == 0) {
 				if (portname.substr(0, 1) == "$")
 					log_error("Can't map port `%s' of cell `%s' to template `%s'!\n", portname.c_str(), cell->name.c_str(), tpl->name.c_str());
@@ -249,16 +319,16 @@ struct TechmapWorker
 			if (w->port_output && !w->port_input) {
 				c.first = it.second;
 				c.second = RTLIL::SigSpec(w);
-				apply_prefix(cell->name.str(), c.second, module);
+				map_sig(c.second);
 			} else if (!w->port_output && w->port_input) {
 				c.first = RTLIL::SigSpec(w);
 				c.second = it.second;
-				apply_prefix(cell->name.str(), c.first, module);
+				map_sig(c.first);
 			} else {
 				SigSpec sig_tpl = w, sig_tpl_pf = w, sig_mod = it.second;
-				apply_prefix(cell->name.str(), sig_tpl_pf, module);
+				map_sig(sig_tpl_pf);
 				for (int i = 0; i < GetSize(sig_tpl) && i < GetSize(sig_mod); i++) {
-					if (tpl_written_bits.count(tpl_sigmap(sig_tpl[i]))) {
+					if (td.written_bits.count(td.sigmap(sig_tpl[i]))) {
 						c.first.append(sig_mod[i]);
 						c.second.append(sig_tpl_pf[i]);
 					} else {
@@ -291,14 +361,17 @@ struct TechmapWorker
 			}
 		}
 
+		// the monitors see each new cell port once, with its final signal
+		module->begin_batch();
+
 		for (auto &it : tpl->cells_)
 		{
-			std::string c_name = it.second->name.str();
+			std::string c_name;
 
-			if (!flatten_mode && c_name == "\\_TECHMAP_REPLACE_")
+			if (!flatten_mode && it.second->name == "\\_TECHMAP_REPLACE_")
 				c_name = orig_cell_name;
 			else
-				apply_prefix(cell->name.str(), c_name);
+				c_name = prefixed_name(cell, it.second->name);
 
 			RTLIL::Cell *c = module->addCell(c_name, it.second);
 			design->select(module, c);
@@ -306,10 +379,11 @@ struct TechmapWorker
 			if (!flatten_mode && c->type.substr(0, 2) == "\\$")
 				c->type = c->type.substr(1);
 
-			for (auto &it2 : c->connections_) {
-				apply_prefix(cell->name.str(), it2.second, module);
-				port_signal_map.apply(it2.second);
-			}
+			for (auto &it2 : it.second->connections())
+				c->rewritePort(it2.first, [&](RTLIL::SigSpec &sig) {
+					map_sig(sig);
+					port_signal_map.apply(sig);
+				});
 
 			if (c->type == "$memrd" || c->type == "$memwr" || c->type == "$meminit") {
 				IdString memid = c->getParam("\\MEMID").decode_string();
@@ -318,23 +392,26 @@ struct TechmapWorker
 			}
 
 			if (c->attributes.count("\\src"))
-				c->add_strpool_attribute("\\src", extra_src_attrs);
+				c->add_src_attribute(extra_src_attrs);
 		}
 
-		for (auto &it : tpl->connections()) {
-			RTLIL::SigSig c = it;
-			apply_prefix(cell->name.str(), c.first, module);
-			apply_prefix(cell->name.str(), c.second, module);
+		std::vector<RTLIL::SigSig> new_conns = tpl->connections();
+		for (auto &c : new_conns) {
+			map_sig(c.first);
+			map_sig(c.second);
 			port_signal_map.apply(c.first);
 			port_signal_map.apply(c.second);
-			module->connect(c);
 		}
+		module->connect_many(new_conns);
+		module->end_batch();
 
 		module->remove(cell);
+		template_data.erase(module);
 	}
 
 	bool techmap_module(RTLIL::Design *design, RTLIL::Module *module, RTLIL::Design *map, std::set<RTLIL::Cell*> &handled_cells,
-			const std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> &celltypeMap, bool in_recursion)
+			const std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> &celltypeMap, bool in_recursion,
+			TechmapWorklist *worklist = nullptr)
 	{
 		std::string mapmsg_prefix = in_recursion ? "Recursively mapping" : "Mapping";
 
@@ -344,15 +421,33 @@ struct TechmapWorker
 		bool log_continue = false;
 		bool did_something = false;
 
-		SigMap sigmap(module);
+		SigMap local_sigmap;
+		std::vector<RTLIL::Cell*> scan_cells;
+
+		if (worklist != nullptr && worklist->valid) {
+			for (auto name : worklist->cells)
+				if (module->cell(name) != nullptr)
+					scan_cells.push_back(module->cell(name));
+		} else {
+			if (worklist != nullptr)
+				worklist->sigmap.set(module);
+			else
+				local_sigmap.set(module);
+			for (auto cell : module->cells())
+				scan_cells.push_back(cell);
+		}
+
+		SigMap &sigmap = worklist != nullptr ? worklist->sigmap : local_sigmap;
 
 		TopoSort<RTLIL::Cell*, RTLIL::IdString::compare_ptr_by_name<RTLIL::Cell>> cells;
 		std::map<RTLIL::Cell*, std::set<RTLIL::SigBit>> cell_to_inbit;
 		std::map<RTLIL::SigBit, std::set<RTLIL::Cell*>> outbit_to_cell;
 
-		for (auto cell : module->cells())
+		RTLIL::ModuleSelection sel(design, module);
+
+		for (auto cell : scan_cells)
 		{
-			if (!design->selected(module, cell) || handled_cells.count(cell) > 0)
+			if (!sel.selected(cell) || handled_cells.count(cell) > 0)
 				continue;
 
 			std::string cell_type = cell->type.str();
@@ -410,6 +505,23 @@ struct TechmapWorker
 
 		cells.sort();
 
+		// the monitor is removed again when an error is thrown
+		struct worklist_guard_t {
+			RTLIL::Module *module;
+			TechmapWorklist *worklist;
+			worklist_guard_t(RTLIL::Module *module, TechmapWorklist *worklist) : module(module), worklist(worklist) {
+				if (worklist != nullptr) {
+					worklist->cells.clear();
+					worklist->valid = true;
+					module->monitors.insert(worklist);
+				}
+			}
+			~worklist_guard_t() {
+				if (worklist != nullptr)
+					module->monitors.erase(worklist);
+			}
+		} worklist_guard(module, worklist);
+
 		for (auto cell : cells.sorted)
 		{
 			log_assert(handled_cells.count(cell) == 0);
@@ -439,6 +551,9 @@ struct TechmapWorker
 					if (tpl->get_bool_attribute("\\techmap_maccmap"))
 						extmapper_name = "maccmap";
 
+					if (tpl->get_bool_attribute("\\techmap_nativemap"))
+						extmapper_name = "nativemap";
+
 					if (tpl->attributes.count("\\techmap_wrap"))
 						extmapper_name = "wrap";
 
@@ -467,7 +582,8 @@ struct TechmapWorker
 								int port_counter = 1;
 								for (auto &c : extmapper_cell->connections_) {
 									RTLIL::Wire *w = extmapper_module->addWire(c.first, GetSize(c.second));
-									if (w->name == "\\Y" || w->name == "\\Q")
+									if (yosys_get_celltypes().cell_known(extmapper_cell->type) ? yosys_get_celltypes().cell_output(extmapper_cell->type, w->name) :
+											w->name == "\\Y" || w->name == "\\Q")
 										w->port_output = true;
 									else
 										w->port_input = true;
@@ -486,6 +602,17 @@ struct TechmapWorker
 									extmapper_module->remove(extmapper_cell);
 								}
 
+								if (extmapper_name == "nativemap") {
+									log("Creating %s with nativemap.\n", log_id(extmapper_module));
+									if (nativemap_mappers.count(extmapper_cell->type) == 0)
+										log_error("No nativemap mapper for cell type %s found!\n", log_id(extmapper_cell->type));
+									nativemap_mappers.at(extmapper_cell->type)(extmapper_module, extmapper_cell);
+									extmapper_module->remove(extmapper_cell);
+									// the rules may create coarse-grain cells ($alu creates $lcu)
+									if (extmapper_design == design)
+										module_queue.insert(extmapper_module);
+								}
+
 								if (extmapper_name == "maccmap") {
 									log("Creating %s with maccmap.\n", log_id(extmapper_module));
 									if (extmapper_cell->type != "$macc")
@@ -522,6 +649,12 @@ struct TechmapWorker
 								simplemap_mappers.at(cell->type)(module, cell);
 							}
 
+							if (extmapper_name == "nativemap") {
+								if (nativemap_mappers.count(cell->type) == 0)
+									log_error("No nativemap mapper for cell type %s found!\n", RTLIL::id2cstr(cell->type));
+								nativemap_mappers.at(cell->type)(module, cell);
+							}
+
 							if (extmapper_name == "maccmap") {
 								if (cell->type != "$macc")
 									log_error("The maccmap mapper can only map $macc (not %s) cells!\n", log_id(cell->type));
@@ -612,8 +745,11 @@ struct TechmapWorker
 						tpl = techmap_cache[key];
 					} else {
 						if (cell->parameters.size() != 0) {
+							RTLIL::Design *derived_lib = derived_cache.count(tpl->name) ? derived_cache.at(tpl->name) : nullptr;
 							derived_name = tpl->derive(map, dict<RTLIL::IdString, RTLIL::Const>(parameters.begin(), parameters.end()));
 							tpl = map->module(derived_name);
+							if (derived_lib != nullptr && !derived_lib->has(derived_name) && techmap_do_cache.count(tpl) == 0)
+								derived_lib->add(tpl->clone());
 							log_continue = true;
 						}
 						techmap_cache[key] = tpl;
@@ -746,7 +882,8 @@ struct TechmapWorker
 							if (cmd_string.rfind("RECURSION; ", 0) == 0)
 							{
 								cmd_string = cmd_string.substr(strlen("RECURSION; "));
-								while (techmap_module(map, tpl, map, handled_cells, celltypeMap, true)) { }
+								TechmapWorklist worklist;
+								while (techmap_module(map, tpl, map, handled_cells, celltypeMap, true, &worklist)) { }
 								goto restart_eval_cmd_string;
 							}
 
@@ -777,12 +914,15 @@ struct TechmapWorker
 					for (auto &it : techmap_wire_names)
 						log_error("Techmap special wire %s disappeared. This is considered a fatal error.\n", RTLIL::id2cstr(it));
 
+					template_data.erase(tpl);
+
 					if (recursive_mode) {
 						if (log_continue) {
 							log_header("Continuing TECHMAP pass.\n");
 							log_continue = false;
 						}
-						while (techmap_module(map, tpl, map, handled_cells, celltypeMap, true)) { }
+						TechmapWorklist worklist;
+						while (techmap_module(map, tpl, map, handled_cells, celltypeMap, true, &worklist)) { }
 					}
 				}
 
@@ -843,6 +983,20 @@ struct TechmapWorker
 
 struct TechmapPass : public Pass {
 	TechmapPass() : Pass("techmap", "generic technology mapper") { }
+	virtual bool module_local(const std::vector<std::string> &args) {
+		for (auto &arg : args)
+			if (arg == "-extern")
+				return false;
+		return true;
+	}
+	virtual ~TechmapPass() {
+		for (auto &it : techmap_library_cache)
+			delete it.second;
+		for (auto &it : techmap_derived_cache)
+			delete it.second;
+		techmap_library_cache.clear();
+		techmap_derived_cache.clear();
+	}
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
@@ -887,6 +1041,12 @@ struct TechmapPass : public Pass {
 		log("        map file. Note that the Verilog frontend is also called with the\n");
 		log("        '-ignore_redef' option set.\n");
 		log("\n");
+		log("    -nocache\n");
+		log("        always re-read the map files. By default the parsed map files are kept\n");
+		log("        in memory and reused by later techmap calls when the content of the\n");
+		log("        file and the frontend options are unchanged. Use this option when a map\n");
+		log("        file includes other files that might have changed in the meantime.\n");
+		log("\n");
 		log("When a module in the map file has the 'techmap_celltype' attribute set, it will\n");
 		log("match cells with a type that match the text value of this attribute. Otherwise\n");
 		log("the module name will be used to match the cell.\n");
@@ -894,6 +1054,14 @@ struct TechmapPass : public Pass {
 		log("When a module in the map file has the 'techmap_simplemap' attribute set, techmap\n");
 		log("will use 'simplemap' (see 'help simplemap') to map cells matching the module.\n");
 		log("\n");
+		log("When a module in the map file has the 'techmap_nativemap' attribute set, techmap\n");
+		log("will map cells matching the module with a built-in C++ rule for the cell type\n");
+		log("instead of using the module as template. There are built-in rules for $fa,\n");
+		log("$lcu, $alu, $shl, $shr, $sshl, $sshr, $shift, $shiftx and $pmux that create the\n");
+		log("same logic as the templates in techmap.v ($alu creates an $lcu cell). The\n");
+		log("default map file uses these rules unless the macro NONATIVE is defined (for\n");
+		log("example with 'techmap -D NONATIVE').\n");
+		log("\n");
 		log("When a module in the map file has the 'techmap_maccmap' attribute set, techmap\n");
 		log("will use 'maccmap' (see 'help maccmap') to map cells matching the module.\n");
 		log("\n");
@@ -974,6 +1142,33 @@ struct TechmapPass : public Pass {
 		log("essentially techmap but using the design itself as map library).\n");
 		log("\n");
 	}
+	void load_map_file(TechmapWorker &worker, RTLIL::Design *map, std::string filename, std::string frontend, const std::string &content, bool nocache)
+	{
+		if (nocache) {
+			std::istringstream f(content);
+			Frontend::frontend_call(map, &f, filename, frontend);
+			return;
+		}
+
+		std::string key = sha1(frontend + "\n" + filename + "\n" + content);
+
+		if (techmap_library_cache.count(key) == 0) {
+			RTLIL::Design *lib = new RTLIL::Design;
+			std::istringstream f(content);
+			Frontend::frontend_call(lib, &f, filename, frontend);
+			techmap_library_cache[key] = lib;
+			techmap_derived_cache[key] = new RTLIL::Design;
+		} else
+			log("Using cached map file `%s'.\n", filename.c_str());
+
+		// the map design is modified by techmap (derived modules and _TECHMAP_DO_ commands),
+		// so we always work on a copy of the cached modules
+		for (auto mod : techmap_library_cache.at(key)->modules())
+			if (!map->has(mod->name)) {
+				map->add(mod->clone());
+				worker.derived_cache[mod->name] = techmap_derived_cache.at(key);
+			}
+	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		log_header("Executing TECHMAP pass (map to technology primitives).\n");
@@ -981,10 +1176,12 @@ struct TechmapPass : public Pass {
 
 		TechmapWorker worker;
 		simplemap_get_mappers(worker.simplemap_mappers);
+		nativemap_get_mappers(worker.nativemap_mappers);
 
 		std::vector<std::string> map_files;
 		std::string verilog_frontend = "verilog -ignore_redef";
 		int max_iter = -1;
+		bool nocache = false;
 
 		size_t argidx;
 		for (argidx = 1; argidx < args.size(); argidx++) {
@@ -1020,14 +1217,17 @@ struct TechmapPass : public Pass {
 				worker.autoproc_mode = true;
 				continue;
 			}
+			if (args[argidx] == "-nocache") {
+				nocache = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
 
 		RTLIL::Design *map = new RTLIL::Design;
 		if (map_files.empty()) {
-			std::istringstream f(stdcells_code);
-			Frontend::frontend_call(map, &f, "<techmap.v>", verilog_frontend);
+			load_map_file(worker, map, "<techmap.v>", verilog_frontend, stdcells_code, nocache);
 		} else
 			for (auto &fn : map_files)
 				if (fn.substr(0, 1) == "%") {
@@ -1044,7 +1244,8 @@ struct TechmapPass : public Pass {
 					f.open(fn.c_str());
 					if (f.fail())
 						log_cmd_error("Can't open map file `%s'\n", fn.c_str());
-					Frontend::frontend_call(map, &f, fn, (fn.size() > 3 && fn.substr(fn.size()-3) == ".il") ? "ilang" : verilog_frontend);
+					std::string content((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+					load_map_file(worker, map, fn, (fn.size() > 3 && fn.substr(fn.size()-3) == ".il") ? "ilang" : verilog_frontend, content, nocache);
 				}
 
 		std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> celltypeMap;
@@ -1062,6 +1263,16 @@ struct TechmapPass : public Pass {
 			}
 		}
 
+		// modules derived in earlier calls are only added now, so that they are not
+		// used as templates by themselves. derive() picks them up from the map design.
+		pool<RTLIL::Design*> derived_libs;
+		for (auto &it : worker.derived_cache)
+			derived_libs.insert(it.second);
+		for (auto lib : derived_libs)
+			for (auto mod : lib->modules())
+				if (!map->has(mod->name))
+					map->add(mod->clone());
+
 		for (auto module : design->modules())
 			worker.module_queue.insert(module);
 
@@ -1072,9 +1283,10 @@ struct TechmapPass : public Pass {
 
 			bool did_something = true;
 			std::set<RTLIL::Cell*> handled_cells;
+			TechmapWorker::TechmapWorklist worklist;
 			while (did_something) {
 				did_something = false;
-					if (worker.techmap_module(design, module, map, handled_cells, celltypeMap, false))
+					if (worker.techmap_module(design, module, map, handled_cells, celltypeMap, false, &worklist))
 						did_something = true;
 				if (did_something)
 					module->check();
@@ -1096,7 +1308,7 @@ struct FlattenPass : public Pass {
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
 		log("\n");
-		log("    flatten [selection]\n");
+		log("    flatten [options] [selection]\n");
 		log("\n");
 		log("This pass flattens the design by replacing cells by their implementation. This\n");
 		log("pass is very similar to the 'techmap' pass. The only difference is that this\n");
@@ -1105,17 +1317,31 @@ struct FlattenPass : public Pass {
 		log("Cells and/or modules with the 'keep_hierarchy' attribute set will not be\n");
 		log("flattened by this command.\n");
 		log("\n");
+		log("    -compact\n");
+		log("        do not create hierarchical names for wires, cells and memories with\n");
+		log("        private names (names starting with '$'). Instead they get short\n");
+		log("        auto-generated names. This reduces the memory used for names in large\n");
+		log("        flattened designs. Public names always get the hierarchical name.\n");
+		log("\n");
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
 	{
 		log_header("Executing FLATTEN pass (flatten design).\n");
 		log_push();
 
-		extra_args(args, 1, design);
-
 		TechmapWorker worker;
 		worker.flatten_mode = true;
 
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++) {
+			if (args[argidx] == "-compact") {
+				worker.compact_names = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, design);
+
 		std::map<RTLIL::IdString, std::set<RTLIL::IdString, RTLIL::sort_by_id_str>> celltypeMap;
 		for (auto module : design->modules())
 			celltypeMap[module->name].insert(module->name);
@@ -1131,13 +1357,16 @@ struct FlattenPass : public Pass {
 			worker.flatten_do_list.insert(top_mod->name);
 			while (!worker.flatten_do_list.empty()) {
 				auto mod = design->module(*worker.flatten_do_list.begin());
-				while (worker.techmap_module(design, mod, design, handled_cells, celltypeMap, false)) { }
+				TechmapWorker::TechmapWorklist worklist;
+				while (worker.techmap_module(design, mod, design, handled_cells, celltypeMap, false, &worklist)) { }
 				worker.flatten_done_list.insert(mod->name);
 				worker.flatten_do_list.erase(mod->name);
 			}
 		} else {
-			for (auto mod : vector<Module*>(design->modules()))
-				while (worker.techmap_module(design, mod, design, handled_cells, celltypeMap, false)) { }
+			for (auto mod : vector<Module*>(design->modules())) {
+				TechmapWorker::TechmapWorklist worklist;
+				while (worker.techmap_module(design, mod, design, handled_cells, celltypeMap, false, &worklist)) { }
+			}
 		}
 
 		log("No more expansions possible.\n");
@@ -24,6 +24,11 @@
 #include "kernel/macc.h"
 #include <algorithm>
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+#  include <unistd.h>
+#  include <sys/wait.h>
+#endif
+
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
@@ -36,6 +41,14 @@ static uint32_t xorshift32(uint32_t limit) {
 	return xorshift32_state % limit;
 }
 
+// every test case starts with its own rng state, so that a single case can be
+// repeated with the same -s value and -case
+static uint32_t test_case_seed(uint32_t seed, const std::string &cell_type, int index)
+{
+	uint32_t state = mkhash_finalize(mkhash(mkhash(seed, hash_ops<std::string>::hash(cell_type)), index));
+	return state != 0 ? state : 1;
+}
+
 static void create_gold_module(RTLIL::Design *design, RTLIL::IdString cell_type, std::string cell_type_flags, bool constmode, bool muxdiv)
 {
 	RTLIL::Module *module = design->addModule("\\gold");
@@ -270,7 +283,7 @@ static void create_gold_module(RTLIL::Design *design, RTLIL::IdString cell_type,
 	cell->check();
 }
 
-static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::string uut_name, std::ofstream &vlog_file)
+static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::string uut_name, std::ostream *vlog_file)
 {
 	log("Eval testing:%c", verbose ? '\n' : ' ');
 
@@ -290,33 +303,33 @@ static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::
 			satgen2.importCell(cell);
 		}
 
-	if (vlog_file.is_open())
+	if (vlog_file != nullptr)
 	{
-		vlog_file << stringf("\nmodule %s;\n", uut_name.c_str());
+		*vlog_file << stringf("\nmodule %s;\n", uut_name.c_str());
 
 		for (auto port : gold_mod->ports) {
 			RTLIL::Wire *wire = gold_mod->wire(port);
 			if (wire->port_input)
-				vlog_file << stringf("  reg [%d:0] %s;\n", GetSize(wire)-1, log_id(wire));
+				*vlog_file << stringf("  reg [%d:0] %s;\n", GetSize(wire)-1, log_id(wire));
 			else
-				vlog_file << stringf("  wire [%d:0] %s_expr, %s_noexpr;\n", GetSize(wire)-1, log_id(wire), log_id(wire));
+				*vlog_file << stringf("  wire [%d:0] %s_expr, %s_noexpr;\n", GetSize(wire)-1, log_id(wire), log_id(wire));
 		}
 
-		vlog_file << stringf("  %s_expr uut_expr(", uut_name.c_str());
+		*vlog_file << stringf("  %s_expr uut_expr(", uut_name.c_str());
 		for (int i = 0; i < GetSize(gold_mod->ports); i++)
-			vlog_file << stringf("%s.%s(%s%s)", i ? ", " : "", log_id(gold_mod->ports[i]), log_id(gold_mod->ports[i]),
+			*vlog_file << stringf("%s.%s(%s%s)", i ? ", " : "", log_id(gold_mod->ports[i]), log_id(gold_mod->ports[i]),
 					gold_mod->wire(gold_mod->ports[i])->port_input ? "" : "_expr");
-		vlog_file << stringf(");\n");
+		*vlog_file << stringf(");\n");
 
-		vlog_file << stringf("  %s_expr uut_noexpr(", uut_name.c_str());
+		*vlog_file << stringf("  %s_expr uut_noexpr(", uut_name.c_str());
 		for (int i = 0; i < GetSize(gold_mod->ports); i++)
-			vlog_file << stringf("%s.%s(%s%s)", i ? ", " : "", log_id(gold_mod->ports[i]), log_id(gold_mod->ports[i]),
+			*vlog_file << stringf("%s.%s(%s%s)", i ? ", " : "", log_id(gold_mod->ports[i]), log_id(gold_mod->ports[i]),
 					gold_mod->wire(gold_mod->ports[i])->port_input ? "" : "_noexpr");
-		vlog_file << stringf(");\n");
+		*vlog_file << stringf(");\n");
 
-		vlog_file << stringf("  task run;\n");
-		vlog_file << stringf("    begin\n");
-		vlog_file << stringf("      $display(\"%s\");\n", uut_name.c_str());
+		*vlog_file << stringf("  task run;\n");
+		*vlog_file << stringf("    begin\n");
+		*vlog_file << stringf("      $display(\"%s\");\n", uut_name.c_str());
 	}
 
 	for (int i = 0; i < 64; i++)
@@ -362,16 +375,16 @@ static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::
 			gold_ce.set(gold_wire, in_value);
 			gate_ce.set(gate_wire, in_value);
 
-			if (vlog_file.is_open() && GetSize(in_value) > 0) {
-				vlog_file << stringf("      %s = 'b%s;\n", log_id(gold_wire), in_value.as_string().c_str());
+			if (vlog_file != nullptr && GetSize(in_value) > 0) {
+				*vlog_file << stringf("      %s = 'b%s;\n", log_id(gold_wire), in_value.as_string().c_str());
 				if (!vlog_pattern_info.empty())
 					vlog_pattern_info += " ";
 				vlog_pattern_info += stringf("%s=%s", log_id(gold_wire), log_signal(in_value));
 			}
 		}
 
-		if (vlog_file.is_open())
-			vlog_file << stringf("      #1;\n");
+		if (vlog_file != nullptr)
+			*vlog_file << stringf("      #1;\n");
 
 		for (auto port : gold_mod->ports)
 		{
@@ -414,11 +427,11 @@ static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::
 			out_sig.append(gold_wire);
 			out_val.append(gold_outval);
 
-			if (vlog_file.is_open()) {
-				vlog_file << stringf("      $display(\"[%s] %s expected: %%b, expr: %%b, noexpr: %%b\", %d'b%s, %s_expr, %s_noexpr);\n",
+			if (vlog_file != nullptr) {
+				*vlog_file << stringf("      $display(\"[%s] %s expected: %%b, expr: %%b, noexpr: %%b\", %d'b%s, %s_expr, %s_noexpr);\n",
 						vlog_pattern_info.c_str(), log_id(gold_wire), GetSize(gold_outval), gold_outval.as_string().c_str(), log_id(gold_wire), log_id(gold_wire));
-				vlog_file << stringf("      if (%s_expr !== %d'b%s) begin $display(\"ERROR\"); $finish; end\n", log_id(gold_wire), GetSize(gold_outval), gold_outval.as_string().c_str());
-				vlog_file << stringf("      if (%s_noexpr !== %d'b%s) begin $display(\"ERROR\"); $finish; end\n", log_id(gold_wire), GetSize(gold_outval), gold_outval.as_string().c_str());
+				*vlog_file << stringf("      if (%s_expr !== %d'b%s) begin $display(\"ERROR\"); $finish; end\n", log_id(gold_wire), GetSize(gold_outval), gold_outval.as_string().c_str());
+				*vlog_file << stringf("      if (%s_noexpr !== %d'b%s) begin $display(\"ERROR\"); $finish; end\n", log_id(gold_wire), GetSize(gold_outval), gold_outval.as_string().c_str());
 			}
 		}
 
@@ -493,10 +506,10 @@ static void run_eval_test(RTLIL::Design *design, bool verbose, bool nosat, std::
 		}
 	}
 
-	if (vlog_file.is_open()) {
-		vlog_file << stringf("    end\n");
-		vlog_file << stringf("  endtask\n");
-		vlog_file << stringf("endmodule\n");
+	if (vlog_file != nullptr) {
+		*vlog_file << stringf("    end\n");
+		*vlog_file << stringf("  endtask\n");
+		*vlog_file << stringf("endmodule\n");
 	}
 
 	if (!verbose)
@@ -521,7 +534,17 @@ struct TestCellPass : public Pass {
 		log("        create this number of cell instances and test them (default = 100).\n");
 		log("\n");
 		log("    -s {positive_integer}\n");
-		log("        use this value as rng seed value (default = unix time).\n");
+		log("        use this value as rng seed value (default = unix time). each test case\n");
+		log("        gets its own rng seed derived from this value, the cell type and the\n");
+		log("        index of the test case.\n");
+		log("\n");
+		log("    -case {integer}\n");
+		log("        only run the test case with the given index (for each cell type). this\n");
+		log("        repeats a failed test case when used with the same -s value.\n");
+		log("\n");
+		log("    -j {integer}\n");
+		log("        run the test cases in this number of worker processes (default: the\n");
+		log("        -j value of yosys). the log output is the same as with one process.\n");
 		log("\n");
 		log("    -f {ilang_file}\n");
 		log("        don't generate circuits. instead load the specified ilang file.\n");
@@ -564,10 +587,10 @@ struct TestCellPass : public Pass {
 	}
 	virtual void execute(std::vector<std::string> args, RTLIL::Design*)
 	{
-		int num_iter = 100;
+		int num_iter = 100, only_case = -1, num_jobs = yosys_jobs;
 		std::string techmap_cmd = "techmap -assert";
 		std::string ilang_file, write_prefix;
-		xorshift32_state = 0;
+		uint32_t seed = 0;
 		std::ofstream vlog_file;
 		bool muxdiv = false;
 		bool verbose = false;
@@ -583,7 +606,17 @@ struct TestCellPass : public Pass {
 				continue;
 			}
 			if (args[argidx] == "-s" && argidx+1 < GetSize(args)) {
-				xorshift32_state = atoi(args[++argidx].c_str());
+				seed = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-case" && argidx+1 < GetSize(args)) {
+				only_case = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-j" && argidx+1 < GetSize(args)) {
+				num_jobs = atoi(args[++argidx].c_str());
+				if (num_jobs < 1)
+					log_cmd_error("Invalid number of jobs: %s\n", args[argidx].c_str());
 				continue;
 			}
 			if (args[argidx] == "-map" && argidx+1 < GetSize(args)) {
@@ -640,9 +673,9 @@ struct TestCellPass : public Pass {
 			break;
 		}
 
-		if (xorshift32_state == 0) {
-			xorshift32_state = time(NULL) & 0x7fffffff;
-			log("Rng seed value: %d\n", int(xorshift32_state));
+		if (seed == 0) {
+			seed = time(NULL) & 0x7fffffff;
+			log("Rng seed value: %d\n", int(seed));
 		}
 
 		std::map<std::string, std::string> cell_types;
@@ -751,41 +784,152 @@ struct TestCellPass : public Pass {
 		if (selected_cell_types.empty())
 			log_cmd_error("No cell type to test specified.\n");
 
-		std::vector<std::string> uut_names;
-
+		std::vector<std::pair<std::string, int>> test_cases;
 		for (auto cell_type : selected_cell_types)
 			for (int i = 0; i < num_iter; i++)
+				if (only_case < 0 || i == only_case)
+					test_cases.push_back(std::make_pair(cell_type, i));
+
+		if (only_case >= num_iter && ilang_file.empty())
+			log_cmd_error("Test case %d does not exist with -n %d.\n", only_case, num_iter);
+
+		auto run_test_case = [&](const std::string &cell_type, int i, std::ostream *vlog)
+		{
+			xorshift32_state = test_case_seed(seed, cell_type, i);
+
+			RTLIL::Design *design = new RTLIL::Design;
+			if (cell_type == "ilang")
+				Frontend::frontend_call(design, NULL, std::string(), "ilang " + ilang_file);
+			else
+				create_gold_module(design, cell_type, cell_types.at(cell_type), constmode, muxdiv);
+			if (!write_prefix.empty()) {
+				Pass::call(design, stringf("write_ilang %s_%s_%05d.il", write_prefix.c_str(), cell_type.c_str()+1, i));
+			} else {
+				Pass::call(design, stringf("copy gold gate; cd gate; %s; cd ..; opt -fast gate", techmap_cmd.c_str()));
+				if (!nosat)
+					Pass::call(design, "miter -equiv -flatten -make_outputs -ignore_gold_x gold gate miter");
+				if (verbose)
+					Pass::call(design, "dump gate");
+				Pass::call(design, "dump gold");
+				if (!nosat)
+					Pass::call(design, "sat -verify -enable_undef -prove trigger 0 -show-inputs -show-outputs miter");
+				std::string uut_name = stringf("uut_%s_%d", cell_type.substr(1).c_str(), i);
+				if (vlog != nullptr) {
+					Pass::call(design, stringf("copy gold %s_expr; select %s_expr", uut_name.c_str(), uut_name.c_str()));
+					Backend::backend_call(design, vlog, "<test_cell -vlog>", "verilog -selected");
+					Pass::call(design, stringf("copy gold %s_noexpr; select %s_noexpr", uut_name.c_str(), uut_name.c_str()));
+					Backend::backend_call(design, vlog, "<test_cell -vlog>", "verilog -selected -noexpr");
+				}
+				if (!noeval)
+					run_eval_test(design, verbose, nosat, uut_name, vlog);
+			}
+			delete design;
+		};
+
+		std::vector<std::string> uut_names;
+		if (vlog_file.is_open() && write_prefix.empty())
+			for (auto &it : test_cases)
+				uut_names.push_back(stringf("uut_%s_%d", it.first.substr(1).c_str(), it.second));
+
+		num_jobs = std::min(num_jobs, GetSize(test_cases));
+
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+		if (num_jobs > 1)
+		{
+			// worker w runs the test cases k with k % num_jobs == w and writes
+			// the log (and -vlog output) of each case to the temp dir. a
+			// worker stops at its first failed case. the logs are replayed in
+			// the original order, up to the first case that didn't pass.
+			std::string tempdir_name = make_temp_dir("/tmp/yosys-test-cell-XXXXXX");
+			std::vector<pid_t> worker_pids;
+
+			log_flush();
+			fflush(NULL);
+
+			for (int w = 0; w < num_jobs; w++)
 			{
-				RTLIL::Design *design = new RTLIL::Design;
-				if (cell_type == "ilang")
-					Frontend::frontend_call(design, NULL, std::string(), "ilang " + ilang_file);
-				else
-					create_gold_module(design, cell_type, cell_types.at(cell_type), constmode, muxdiv);
-				if (!write_prefix.empty()) {
-					Pass::call(design, stringf("write_ilang %s_%s_%05d.il", write_prefix.c_str(), cell_type.c_str()+1, i));
-				} else {
-					Pass::call(design, stringf("copy gold gate; cd gate; %s; cd ..; opt -fast gate", techmap_cmd.c_str()));
-					if (!nosat)
-						Pass::call(design, "miter -equiv -flatten -make_outputs -ignore_gold_x gold gate miter");
-					if (verbose)
-						Pass::call(design, "dump gate");
-					Pass::call(design, "dump gold");
-					if (!nosat)
-						Pass::call(design, "sat -verify -enable_undef -prove trigger 0 -show-inputs -show-outputs miter");
-					std::string uut_name = stringf("uut_%s_%d", cell_type.substr(1).c_str(), i);
-					if (vlog_file.is_open()) {
-						Pass::call(design, stringf("copy gold %s_expr; select %s_expr", uut_name.c_str(), uut_name.c_str()));
-						Backend::backend_call(design, &vlog_file, "<test_cell -vlog>", "verilog -selected");
-						Pass::call(design, stringf("copy gold %s_noexpr; select %s_noexpr", uut_name.c_str(), uut_name.c_str()));
-						Backend::backend_call(design, &vlog_file, "<test_cell -vlog>", "verilog -selected -noexpr");
-						uut_names.push_back(uut_name);
+				pid_t pid = fork();
+				if (pid < 0)
+					log_error("Failed to fork worker process: %s\n", strerror(errno));
+
+				if (pid == 0)
+				{
+					log_errfile = NULL;
+					log_streams.clear();
+					log_cmd_error_throw = true;
+					log_error_throw = true;
+
+					for (int k = w; k < GetSize(test_cases); k += num_jobs)
+					{
+						std::string case_prefix = stringf("%s/case_%d", tempdir_name.c_str(), k);
+						FILE *f = fopen((case_prefix + ".log").c_str(), "w");
+						log_files.clear();
+						if (f != NULL)
+							log_files.push_back(f);
+
+						bool ok = true;
+						try {
+							if (vlog_file.is_open()) {
+								std::ofstream vf(case_prefix + ".v");
+								run_test_case(test_cases[k].first, test_cases[k].second, &vf);
+							} else
+								run_test_case(test_cases[k].first, test_cases[k].second, nullptr);
+						} catch (...) {
+							ok = false;
+						}
+
+						log_flush();
+						if (f != NULL)
+							fclose(f);
+						log_files.clear();
+
+						if (!ok)
+							_exit(1);
+						std::ofstream(case_prefix + ".ok").close();
 					}
-					if (!noeval)
-						run_eval_test(design, verbose, nosat, uut_name, vlog_file);
+
+					_exit(0);
+				}
+
+				worker_pids.push_back(pid);
+			}
+
+			for (auto pid : worker_pids) {
+				int status = 0;
+				waitpid(pid, &status, 0);
+			}
+
+			for (int k = 0; k < GetSize(test_cases); k++)
+			{
+				std::string case_prefix = stringf("%s/case_%d", tempdir_name.c_str(), k);
+
+				std::ifstream f(case_prefix + ".log");
+				std::string line;
+				while (std::getline(f, line))
+					log("%s%s", line.c_str(), f.eof() ? "" : "\n");
+
+				if (!check_file_exists(case_prefix + ".ok")) {
+					remove_directory(tempdir_name);
+					log_error("Test case %d of cell type %s failed. Use 'test_cell -s %d -case %d %s' to repeat it.\n",
+							test_cases[k].second, test_cases[k].first.c_str(), int(seed), test_cases[k].second, test_cases[k].first.c_str());
+				}
+
+				if (vlog_file.is_open()) {
+					std::ifstream vf(case_prefix + ".v");
+					if (vf.peek() != std::ifstream::traits_type::eof())
+						vlog_file << vf.rdbuf();
 				}
-				delete design;
 			}
 
+			remove_directory(tempdir_name);
+		}
+		else
+#endif
+		{
+			for (auto &it : test_cases)
+				run_test_case(it.first, it.second, vlog_file.is_open() ? &vlog_file : nullptr);
+		}
+
 		if (vlog_file.is_open()) {
 			vlog_file << "\nmodule testbench;\n";
 			for (auto &uut : uut_names)
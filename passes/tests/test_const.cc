@@ -0,0 +1,180 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static uint32_t xorshift32_state = 123456789;
+
+static uint32_t xorshift32(uint32_t limit) {
+	xorshift32_state ^= xorshift32_state << 13;
+	xorshift32_state ^= xorshift32_state >> 17;
+	xorshift32_state ^= xorshift32_state << 5;
+	return xorshift32_state % limit;
+}
+
+typedef RTLIL::Const (*const_func_t)(const RTLIL::Const&, const RTLIL::Const&, bool, bool, int);
+
+struct TestConstOp {
+	const char *name;
+	const_func_t func;
+	bool shift;
+};
+
+static const TestConstOp test_const_ops[] = {
+	{ "$add",    RTLIL::const_add,    false },
+	{ "$sub",    RTLIL::const_sub,    false },
+	{ "$mul",    RTLIL::const_mul,    false },
+	{ "$div",    RTLIL::const_div,    false },
+	{ "$mod",    RTLIL::const_mod,    false },
+	{ "$lt",     RTLIL::const_lt,     false },
+	{ "$le",     RTLIL::const_le,     false },
+	{ "$ge",     RTLIL::const_ge,     false },
+	{ "$gt",     RTLIL::const_gt,     false },
+	{ "$shl",    RTLIL::const_shl,    true },
+	{ "$shr",    RTLIL::const_shr,    true },
+	{ "$sshl",   RTLIL::const_sshl,   true },
+	{ "$sshr",   RTLIL::const_sshr,   true },
+	{ "$shift",  RTLIL::const_shift,  true },
+	{ "$shiftx", RTLIL::const_shiftx, true },
+};
+
+static RTLIL::Const random_const(int width, bool undef)
+{
+	RTLIL::Const value(RTLIL::State::S0, width);
+	for (int i = 0; i < width; i++)
+		value.bits[i] = undef && xorshift32(8) == 0 ? RTLIL::State::Sx : xorshift32(2) ? RTLIL::State::S1 : RTLIL::State::S0;
+	return value;
+}
+
+// widen a constant without changing its value, so the BigInteger code path is used
+static RTLIL::Const widen_const(RTLIL::Const value, bool is_signed)
+{
+	RTLIL::State padding = is_signed && GetSize(value) > 0 ? value.bits.back() : RTLIL::State::S0;
+	value.bits.resize(100, padding);
+	return value;
+}
+
+struct TestConstPass : public Pass {
+	TestConstPass() : Pass("test_const", "test and benchmark constant arithmetic") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_const [options]\n");
+		log("\n");
+		log("Evaluate the constant arithmetic functions used by constant folding (const_add,\n");
+		log("const_shl, ...) for random narrow arguments and compare the results of the\n");
+		log("native integer code path with the results for the same values widened to\n");
+		log("100 bits (BigInteger code path). Prints the time spent in both code paths.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of random argument sets per function (default = 10000).\n");
+		log("\n");
+		log("    -s {positive_integer}\n");
+		log("        use this value as rng seed value (default = unix time).\n");
+		log("\n");
+		log("    -undef\n");
+		log("        also create arguments with undefined bits.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design*)
+	{
+		int num_iter = 10000;
+		bool undef = false;
+		xorshift32_state = 0;
+
+		int argidx;
+		for (argidx = 1; argidx < GetSize(args); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < GetSize(args)) {
+				num_iter = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-s" && argidx+1 < GetSize(args)) {
+				xorshift32_state = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-undef") {
+				undef = true;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		log_header("Executing TEST_CONST pass.\n");
+
+		if (xorshift32_state == 0) {
+			xorshift32_state = time(NULL) & 0x7fffffff;
+			log("Rng seed value: %d\n", int(xorshift32_state));
+		}
+
+		int64_t total_fast_ns = 0, total_big_ns = 0;
+
+		for (auto &op : test_const_ops)
+		{
+			std::vector<RTLIL::Const> args_a, args_b, args_a_wide, args_b_wide;
+			std::vector<bool> signed_a, signed_b;
+			std::vector<int> result_lens;
+
+			for (int i = 0; i < num_iter; i++) {
+				bool is_signed = xorshift32(2);
+				args_a.push_back(random_const(1 + xorshift32(32), undef));
+				args_b.push_back(random_const(1 + xorshift32(op.shift ? 6 : 32), undef));
+				signed_a.push_back(is_signed);
+				signed_b.push_back(is_signed);
+				result_lens.push_back(1 + xorshift32(64));
+				args_a_wide.push_back(op.shift ? args_a.back() : widen_const(args_a.back(), is_signed));
+				args_b_wide.push_back(widen_const(args_b.back(), is_signed && (op.func == RTLIL::const_shift || op.func == RTLIL::const_shiftx || !op.shift)));
+			}
+
+			std::vector<RTLIL::Const> results_fast, results_big;
+			results_fast.reserve(num_iter);
+			results_big.reserve(num_iter);
+
+			int64_t start_ns = PerformanceTimer::query();
+			for (int i = 0; i < num_iter; i++)
+				results_fast.push_back(op.func(args_a[i], args_b[i], signed_a[i], signed_b[i], result_lens[i]));
+
+			int64_t middle_ns = PerformanceTimer::query();
+			for (int i = 0; i < num_iter; i++)
+				results_big.push_back(op.func(args_a_wide[i], args_b_wide[i], signed_a[i], signed_b[i], result_lens[i]));
+
+			int64_t end_ns = PerformanceTimer::query();
+
+			for (int i = 0; i < num_iter; i++)
+				if (results_fast[i] != results_big[i])
+					log_error("Mismatch for %s(%s, %s, %s, %d): %s (native) vs. %s (BigInteger)\n", op.name,
+							log_signal(args_a[i]), log_signal(args_b[i]), signed_a[i] ? "signed" : "unsigned", result_lens[i],
+							log_signal(results_fast[i]), log_signal(results_big[i]));
+
+			log("%-8s %8.3f ms native, %8.3f ms BigInteger\n", op.name, (middle_ns - start_ns) * 1e-6, (end_ns - middle_ns) * 1e-6);
+			total_fast_ns += middle_ns - start_ns;
+			total_big_ns += end_ns - middle_ns;
+		}
+
+		log("%-8s %8.3f ms native, %8.3f ms BigInteger\n", "total", total_fast_ns * 1e-6, total_big_ns * 1e-6);
+		log("All results match.\n");
+	}
+} TestConstPass;
+
+PRIVATE_NAMESPACE_END
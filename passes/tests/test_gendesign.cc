@@ -0,0 +1,355 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include <math.h>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static uint32_t xorshift32_state = 123456789;
+
+static uint32_t xorshift32(uint32_t limit) {
+	xorshift32_state ^= xorshift32_state << 13;
+	xorshift32_state ^= xorshift32_state >> 17;
+	xorshift32_state ^= xorshift32_state << 5;
+	return xorshift32_state % limit;
+}
+
+struct GenDesignConfig
+{
+	int num_cells, depth, children, width, fsm_states;
+	double fanout, mem_density, fsm_density;
+};
+
+struct GenDesignWorker
+{
+	const GenDesignConfig &config;
+	RTLIL::Module *module;
+	RTLIL::SigSpec clk;
+
+	// all word-sized signals that cells can read, and how often each is read
+	std::vector<RTLIL::SigSpec> signals;
+	std::vector<int> readers;
+
+	GenDesignWorker(const GenDesignConfig &config, RTLIL::Module *module) : config(config), module(module) { }
+
+	// fanout > 1 prefers signals created early, so that a few nets drive
+	// many cells while most nets only have one or two readers
+	RTLIL::SigSpec pick()
+	{
+		double u = xorshift32(1 << 24) / double(1 << 24);
+		int idx = std::min(int(pow(u, config.fanout) * GetSize(signals)), GetSize(signals)-1);
+		readers[idx]++;
+		return signals[idx];
+	}
+
+	void add_signal(RTLIL::SigSpec sig)
+	{
+		signals.push_back(sig);
+		readers.push_back(0);
+	}
+
+	RTLIL::SigSpec new_signal(int width = -1)
+	{
+		return module->addWire(NEW_ID, width < 0 ? config.width : width);
+	}
+
+	int gen_logic()
+	{
+		RTLIL::SigSpec y = new_signal();
+		switch (xorshift32(8))
+		{
+		case 0: module->addAnd(NEW_ID, pick(), pick(), y); break;
+		case 1: module->addOr(NEW_ID, pick(), pick(), y); break;
+		case 2: module->addXor(NEW_ID, pick(), pick(), y); break;
+		case 3: module->addAdd(NEW_ID, pick(), pick(), y); break;
+		case 4: module->addSub(NEW_ID, pick(), pick(), y); break;
+		case 5: module->addMux(NEW_ID, pick(), pick(), pick()[0], y); break;
+		default: module->addDff(NEW_ID, clk, pick(), y); break;
+		}
+		add_signal(y);
+		return 1;
+	}
+
+	int gen_memory()
+	{
+		int abits = 6;
+		RTLIL::Memory *mem = new RTLIL::Memory;
+		mem->name = NEW_ID;
+		mem->width = config.width;
+		mem->start_offset = 0;
+		mem->size = 1 << abits;
+		module->memories[mem->name] = mem;
+
+		RTLIL::Cell *wr = module->addCell(NEW_ID, "$memwr");
+		wr->parameters["\\MEMID"] = RTLIL::Const(mem->name.str());
+		wr->parameters["\\ABITS"] = abits;
+		wr->parameters["\\WIDTH"] = mem->width;
+		wr->parameters["\\CLK_ENABLE"] = RTLIL::Const(1);
+		wr->parameters["\\CLK_POLARITY"] = RTLIL::Const(1);
+		wr->parameters["\\PRIORITY"] = RTLIL::Const(0);
+		wr->setPort("\\CLK", clk);
+		wr->setPort("\\EN", RTLIL::SigSpec(pick()[0], mem->width));
+		wr->setPort("\\ADDR", pick().extract(0, std::min(abits, config.width)));
+		wr->setPort("\\DATA", pick());
+
+		RTLIL::SigSpec data = new_signal();
+		RTLIL::Cell *rd = module->addCell(NEW_ID, "$memrd");
+		rd->parameters["\\MEMID"] = RTLIL::Const(mem->name.str());
+		rd->parameters["\\ABITS"] = abits;
+		rd->parameters["\\WIDTH"] = mem->width;
+		rd->parameters["\\CLK_ENABLE"] = RTLIL::Const(1);
+		rd->parameters["\\CLK_POLARITY"] = RTLIL::Const(1);
+		rd->parameters["\\TRANSPARENT"] = RTLIL::Const(0);
+		rd->setPort("\\CLK", clk);
+		rd->setPort("\\EN", RTLIL::State::S1);
+		rd->setPort("\\ADDR", pick().extract(0, std::min(abits, config.width)));
+		rd->setPort("\\DATA", data);
+		add_signal(data);
+		return 2;
+	}
+
+	// a state register with an $eq decoder per state and a $pmux that
+	// selects the next state, the structure fsm_detect looks for
+	int gen_fsm()
+	{
+		int num_states = config.fsm_states, state_bits = ceil_log2(num_states);
+		RTLIL::Wire *state = module->addWire(NEW_ID, state_bits);
+		RTLIL::SigSpec next_state = new_signal(state_bits);
+		RTLIL::SigSpec sel, cases;
+
+		for (int i = 0; i < num_states; i++) {
+			RTLIL::SigSpec is_state = new_signal(1);
+			RTLIL::SigSpec take = new_signal(1);
+			module->addEq(NEW_ID, state, RTLIL::Const(i, state_bits), is_state);
+			module->addAnd(NEW_ID, is_state, pick()[0], take);
+			sel.append(take);
+			cases.append(RTLIL::Const(xorshift32(num_states), state_bits));
+		}
+
+		module->addPmux(NEW_ID, state, cases, sel, next_state);
+		module->addDff(NEW_ID, clk, next_state, state);
+
+		RTLIL::SigSpec y = new_signal();
+		module->addMux(NEW_ID, pick(), pick(), sel[xorshift32(num_states)], y);
+		add_signal(y);
+		return 2*num_states + 3;
+	}
+
+	void run(RTLIL::Module *child)
+	{
+		RTLIL::Wire *clk_wire = module->addWire("\\clk");
+		RTLIL::Wire *in_wire = module->addWire("\\in", config.width);
+		RTLIL::Wire *out_wire = module->addWire("\\out", config.width);
+		clk_wire->port_input = true;
+		in_wire->port_input = true;
+		out_wire->port_output = true;
+		module->fixup_ports();
+
+		clk = clk_wire;
+		add_signal(in_wire);
+
+		if (child != nullptr)
+			for (int i = 0; i < config.children; i++) {
+				RTLIL::SigSpec y = new_signal();
+				RTLIL::Cell *cell = module->addCell(NEW_ID, child->name);
+				cell->setPort("\\clk", clk);
+				cell->setPort("\\in", pick());
+				cell->setPort("\\out", y);
+				add_signal(y);
+			}
+
+		int budget = config.num_cells / (config.depth + 1);
+		int mem_budget = budget * config.mem_density, fsm_budget = budget * config.fsm_density;
+
+		while (budget > 0) {
+			int r = xorshift32(budget);
+			if (r < mem_budget) {
+				int n = gen_memory();
+				mem_budget = std::max(mem_budget - n, 0), budget -= n;
+			} else if (r < mem_budget + fsm_budget) {
+				int n = gen_fsm();
+				fsm_budget = std::max(fsm_budget - n, 0), budget -= n;
+			} else
+				budget -= gen_logic();
+		}
+
+		// all signals nobody reads are combined into the output port, so
+		// that opt_clean does not simply remove the generated logic
+		RTLIL::SigSpec out;
+		for (int i = 0; i < GetSize(signals); i++) {
+			if (readers[i] != 0)
+				continue;
+			if (GetSize(out) == 0) {
+				out = signals[i];
+				continue;
+			}
+			RTLIL::SigSpec y = new_signal();
+			module->addXor(NEW_ID, out, signals[i], y);
+			out = y;
+		}
+		module->connect(out_wire, out);
+	}
+};
+
+struct TestGenDesignPass : public Pass {
+	TestGenDesignPass() : Pass("test_gendesign", "create large synthetic designs for scaling tests") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_gendesign [options]\n");
+		log("\n");
+		log("Create a random synthetic design directly in RTLIL, for measuring how passes\n");
+		log("scale with the design size. The design contains word-level logic cells, $dff\n");
+		log("cells, memories ($memrd/$memwr with a clock, as after memory_dff) and state\n");
+		log("machines in the form fsm_detect looks for.\n");
+		log("\n");
+		log("    -cells {integer}\n");
+		log("        approximate number of cells, not counting the cells in submodules\n");
+		log("        (default = 10000). The cells are distributed evenly over the levels\n");
+		log("        of the hierarchy.\n");
+		log("\n");
+		log("    -depth {integer}\n");
+		log("        number of hierarchy levels below the top module (default = 0). Each\n");
+		log("        level has one module. The flattened design has approximately\n");
+		log("        cells/(depth+1) * (1 + children + children^2 + .. children^depth)\n");
+		log("        cells.\n");
+		log("\n");
+		log("    -children {integer}\n");
+		log("        number of instances of the next level in each module (default = 2).\n");
+		log("\n");
+		log("    -width {integer}\n");
+		log("        width of the logic cells and memory words (default = 8).\n");
+		log("\n");
+		log("    -fanout {float}\n");
+		log("        skew of the fanout distribution (default = 1). With 1 every signal\n");
+		log("        is equally likely to be used as a cell input. Larger values prefer\n");
+		log("        older signals, creating a few nets with very high fanout.\n");
+		log("\n");
+		log("    -mem {float}\n");
+		log("        fraction of cells that are memory ports (default = 0.01).\n");
+		log("\n");
+		log("    -fsm {float}\n");
+		log("        fraction of cells that belong to state machines (default = 0.05).\n");
+		log("\n");
+		log("    -fsm_states {integer}\n");
+		log("        number of states per state machine (default = 8).\n");
+		log("\n");
+		log("    -seed {integer}\n");
+		log("        seed for the random number generator (default = 0).\n");
+		log("\n");
+		log("    -top {name}\n");
+		log("        name of the top module (default = top). Submodules are named\n");
+		log("        <top>_level<n>. Existing modules with these names are replaced.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		GenDesignConfig config;
+		config.num_cells = 10000;
+		config.depth = 0;
+		config.children = 2;
+		config.width = 8;
+		config.fsm_states = 8;
+		config.fanout = 1.0;
+		config.mem_density = 0.01;
+		config.fsm_density = 0.05;
+		std::string top_name = "top";
+		int seed = 0;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-cells" && argidx+1 < args.size()) {
+				config.num_cells = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-depth" && argidx+1 < args.size()) {
+				config.depth = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-children" && argidx+1 < args.size()) {
+				config.children = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-width" && argidx+1 < args.size()) {
+				config.width = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-fanout" && argidx+1 < args.size()) {
+				config.fanout = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-mem" && argidx+1 < args.size()) {
+				config.mem_density = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-fsm" && argidx+1 < args.size()) {
+				config.fsm_density = atof(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-fsm_states" && argidx+1 < args.size()) {
+				config.fsm_states = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-seed" && argidx+1 < args.size()) {
+				seed = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-top" && argidx+1 < args.size()) {
+				top_name = args[++argidx];
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		if (config.num_cells < 1 || config.depth < 0 || config.children < 1 || config.width < 1 || config.fsm_states < 2)
+			log_cmd_error("Invalid design size parameters.\n");
+		if (config.fanout <= 0 || config.mem_density < 0 || config.fsm_density < 0 || config.mem_density + config.fsm_density > 1)
+			log_cmd_error("Invalid fanout or density parameters.\n");
+
+		log_header("Executing TEST_GENDESIGN pass.\n");
+
+		xorshift32_state = 123456789 ^ (uint32_t(seed) * 2654435761u);
+		if (xorshift32_state == 0)
+			xorshift32_state = 1;
+
+		RTLIL::Module *child = nullptr;
+		for (int level = config.depth; level >= 0; level--)
+		{
+			RTLIL::IdString name = RTLIL::escape_id(level ? stringf("%s_level%d", top_name.c_str(), level) : top_name);
+			if (design->module(name) != nullptr)
+				design->remove(design->module(name));
+
+			RTLIL::Module *module = design->addModule(name);
+			GenDesignWorker worker(config, module);
+			worker.run(child);
+
+			log("Created module %s with %d cells and %d wires.\n", log_id(module), GetSize(module->cells_), GetSize(module->wires_));
+			child = module;
+		}
+
+		child->set_bool_attribute("\\top");
+	}
+} TestGenDesignPass;
+
+PRIVATE_NAMESPACE_END
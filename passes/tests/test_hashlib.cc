@@ -0,0 +1,212 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct TestHashlibWorker
+{
+	int num_keys, num_rounds;
+
+	TestHashlibWorker(int num_keys, int num_rounds) : num_keys(num_keys), num_rounds(num_rounds) { }
+
+	template<typename K>
+	void run(const char *key_type, const std::vector<K> &keys)
+	{
+		int n = GetSize(keys) / 2;
+		int64_t insert_ns = 0, lookup_ns = 0, miss_ns = 0, erase_ns = 0, pool_ns = 0, idict_ns = 0;
+		int64_t t;
+		int num_buckets = 0, used_buckets = 0, max_chain = 0;
+
+		for (int round = 0; round < num_rounds; round++)
+		{
+			// the first half of the keys is inserted, the second half is used for misses
+			dict<K, int> d;
+
+			t = PerformanceTimer::query();
+			for (int i = 0; i < n; i++)
+				d[keys[i]] = i;
+			insert_ns += PerformanceTimer::query() - t;
+
+#if !defined(NDEBUG) && !defined(HASHLIB_SWISSTABLE)
+			if (round == 0) {
+				d.count(keys[0]);
+				d.collision_stats(num_buckets, used_buckets, max_chain);
+			}
+#endif
+
+			int sum = 0;
+			t = PerformanceTimer::query();
+			for (int i = 0; i < n; i++)
+				sum += d.at(keys[i]);
+			lookup_ns += PerformanceTimer::query() - t;
+
+			if (sum != int(int64_t(n) * (n-1) / 2))
+				log_error("Lookup of %s keys returned wrong values.\n", key_type);
+
+			t = PerformanceTimer::query();
+			for (int i = n; i < 2*n; i++)
+				sum += d.count(keys[i]);
+			miss_ns += PerformanceTimer::query() - t;
+
+			if (sum != int(int64_t(n) * (n-1) / 2))
+				log_error("Lookup of missing %s keys found entries.\n", key_type);
+
+			int expected = n-1;
+			for (auto &it : d)
+				if (it.second != expected--)
+					log_error("Iteration over %s keys is not in reverse insertion order.\n", key_type);
+
+			t = PerformanceTimer::query();
+			for (int i = 0; i < n; i += 2)
+				d.erase(keys[i]);
+			erase_ns += PerformanceTimer::query() - t;
+
+			for (int i = 0; i < n; i++)
+				if (d.count(keys[i]) != i % 2 || (i % 2 && d.at(keys[i]) != i))
+					log_error("Wrong content after erasing %s keys.\n", key_type);
+
+			pool<K> p;
+			t = PerformanceTimer::query();
+			for (int i = 0; i < n; i++)
+				p.insert(keys[i]);
+			for (int i = 0; i < 2*n; i++)
+				sum += p.count(keys[i]);
+			pool_ns += PerformanceTimer::query() - t;
+
+			idict<K> id;
+			t = PerformanceTimer::query();
+			for (int i = 0; i < n; i++)
+				id(keys[i]);
+			for (int i = 0; i < n; i++)
+				sum += id.at(keys[i]);
+			idict_ns += PerformanceTimer::query() - t;
+
+			for (int i = 0; i < n; i++)
+				if (id[i] != keys[i])
+					log_error("Wrong idict index for %s key.\n", key_type);
+		}
+
+		log("%-10s insert %8.2f  lookup %8.2f  miss %8.2f  erase %8.2f  pool %8.2f  idict %8.2f\n", key_type,
+				insert_ns * 1e-6, lookup_ns * 1e-6, miss_ns * 1e-6, erase_ns * 1e-6, pool_ns * 1e-6, idict_ns * 1e-6);
+		if (num_buckets > 0)
+			log("%-10s %d buckets, %d used by %d keys, longest chain %d\n", "", num_buckets, used_buckets, n, max_chain);
+	}
+
+	void run()
+	{
+		RTLIL::Design *design = new RTLIL::Design;
+		RTLIL::Module *module = design->addModule(NEW_ID);
+		RTLIL::Wire *wire = module->addWire(NEW_ID, 2*num_keys);
+
+		std::vector<RTLIL::IdString> id_keys;
+		std::vector<RTLIL::SigBit> bit_keys;
+		std::vector<RTLIL::Cell*> cell_keys;
+		std::vector<RTLIL::SigBit> bus_keys;
+		std::vector<RTLIL::SigSpec> slice_keys;
+
+		for (int i = 0; i < 2*num_keys; i++) {
+			id_keys.push_back(stringf("$test_hashlib$%d", i));
+			bit_keys.push_back(RTLIL::SigBit(wire, i));
+			cell_keys.push_back(module->addCell(NEW_ID, "$test"));
+		}
+
+		// all bits of many 64 bit wires, and slices of wide wires
+		while (GetSize(bus_keys) < 2*num_keys) {
+			RTLIL::Wire *bus = module->addWire(NEW_ID, 64);
+			for (int i = 0; i < 64; i++)
+				bus_keys.push_back(RTLIL::SigBit(bus, i));
+		}
+		bus_keys.resize(2*num_keys);
+
+		while (GetSize(slice_keys) < 2*num_keys) {
+			RTLIL::Wire *bus = module->addWire(NEW_ID, 1024);
+			for (int width = 1; width <= 64; width++)
+				for (int offset = 0; offset + width <= 1024; offset += width)
+					slice_keys.push_back(RTLIL::SigSpec(bus, offset, width));
+		}
+		slice_keys.resize(2*num_keys);
+
+		log("Times for %d keys and %d rounds in ms:\n", num_keys, num_rounds);
+		run("IdString", id_keys);
+		run("SigBit", bit_keys);
+		run("Cell*", cell_keys);
+		run("bus bits", bus_keys);
+		run("slices", slice_keys);
+
+		delete design;
+	}
+};
+
+struct TestHashlibPass : public Pass {
+	TestHashlibPass() : Pass("test_hashlib", "test and benchmark the hashlib containers") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_hashlib [options]\n");
+		log("\n");
+		log("Check dict<>, pool<> and idict<> with IdString, SigBit, Cell* and SigSpec keys\n");
+		log("and print the time spent for inserting, looking up and erasing the keys. Run\n");
+		log("this with yosys builds with and without ENABLE_HASHLIB_SWISSTABLE to compare the\n");
+		log("hash table implementations. Builds without NDEBUG also print the number of used\n");
+		log("hash buckets and the longest collision chain for each key type.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of keys (default = 100000).\n");
+		log("\n");
+		log("    -r {integer}\n");
+		log("        number of rounds (default = 10).\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design*)
+	{
+		int num_keys = 100000;
+		int num_rounds = 10;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				num_keys = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-r" && argidx+1 < args.size()) {
+				num_rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		log_header("Executing TEST_HASHLIB pass.\n");
+#ifdef HASHLIB_SWISSTABLE
+		log("Hash table implementation: open addressing (HASHLIB_SWISSTABLE)\n");
+#else
+		log("Hash table implementation: chained\n");
+#endif
+
+		TestHashlibWorker worker(num_keys, num_rounds);
+		worker.run();
+	}
+} TestHashlibPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,242 @@
+/*
+ *  yosys -- Yosys Open SYnthesis Suite
+ *
+ *  Copyright (C) 2012  Clifford Wolf <clifford@clifford.at>
+ *
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "kernel/yosys.h"
+#include "kernel/sigtools.h"
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static uint32_t xorshift32_state = 123456789;
+
+static uint32_t xorshift32(uint32_t limit) {
+	xorshift32_state ^= xorshift32_state << 13;
+	xorshift32_state ^= xorshift32_state >> 17;
+	xorshift32_state ^= xorshift32_state << 5;
+	return xorshift32_state % limit;
+}
+
+struct TestKernelPerfWorker
+{
+	int num_items, num_rounds;
+	RTLIL::Design *design;
+	RTLIL::Module *module;
+	std::vector<RTLIL::Wire*> wires;
+	int64_t checksum;
+
+	TestKernelPerfWorker(int num_items, int num_rounds) : num_items(num_items), num_rounds(num_rounds), checksum(0)
+	{
+		design = new RTLIL::Design;
+		module = design->addModule("\\test_kernel_perf");
+		for (int i = 0; i < num_items / 16 + 1; i++)
+			wires.push_back(module->addWire(stringf("\\w%d", i), 32));
+	}
+
+	~TestKernelPerfWorker()
+	{
+		delete design;
+	}
+
+	RTLIL::SigSpec random_slice()
+	{
+		RTLIL::Wire *wire = wires[xorshift32(GetSize(wires))];
+		int width = xorshift32(8) + 1;
+		return RTLIL::SigSpec(wire, xorshift32(33 - width), width);
+	}
+
+	RTLIL::SigBit random_bit()
+	{
+		return RTLIL::SigBit(wires[xorshift32(GetSize(wires))], xorshift32(32));
+	}
+
+	template<typename F>
+	void measure(const char *name, F func)
+	{
+		xorshift32_state = 123456789;
+		int64_t total_ns = 0, min_ns = 0;
+		for (int round = 0; round < num_rounds; round++) {
+			int64_t t = PerformanceTimer::query();
+			func();
+			t = PerformanceTimer::query() - t;
+			total_ns += t;
+			if (round == 0 || t < min_ns)
+				min_ns = t;
+		}
+		log("%-24s %10.3f %10.3f %10.1f\n", name, total_ns * 1e-6 / num_rounds, min_ns * 1e-6,
+				1e9 * num_items / std::max(min_ns, int64_t(1)) * 1e-6);
+	}
+
+	void run()
+	{
+		log("Times for %d items and %d rounds in ms (average, best) and Mop/s (best):\n", num_items, num_rounds);
+
+		measure("IdString intern", [&]() {
+			std::vector<RTLIL::IdString> ids;
+			ids.reserve(num_items);
+			for (int i = 0; i < num_items; i++)
+				ids.push_back(stringf("$test_kernel_perf$%d", i));
+			checksum += GetSize(ids);
+		});
+
+		measure("IdString lookup", [&]() {
+			for (int i = 0; i < num_items; i++)
+				checksum += RTLIL::IdString(stringf("\\w%d", i % GetSize(wires))).index_;
+		});
+
+		measure("SigSpec append", [&]() {
+			RTLIL::SigSpec sig;
+			for (int i = 0; i < num_items; i++)
+				sig.append(random_slice());
+			checksum += GetSize(sig);
+		});
+
+		measure("SigSpec append_bit", [&]() {
+			RTLIL::SigSpec sig;
+			for (int i = 0; i < num_items; i++)
+				sig.append_bit(random_bit());
+			checksum += GetSize(sig);
+		});
+
+		RTLIL::SigSpec big_sig;
+		for (int i = 0; i < num_items; i++)
+			big_sig.append(random_slice());
+
+		measure("SigSpec extract", [&]() {
+			for (int i = 0; i < num_items; i++) {
+				int offset = xorshift32(GetSize(big_sig) - 64);
+				checksum += GetSize(big_sig.extract(offset, xorshift32(64) + 1));
+			}
+		});
+
+		measure("SigSpec replace", [&]() {
+			RTLIL::SigSpec sig = big_sig.extract(0, std::min(GetSize(big_sig), 4096));
+			dict<RTLIL::SigBit, RTLIL::SigBit> rules;
+			for (int i = 0; i < 256; i++)
+				rules[random_bit()] = random_bit();
+			for (int i = 0; i < num_items / 64; i++)
+				sig.replace(rules);
+			checksum += GetSize(sig);
+		});
+
+		measure("SigSpec sort_and_unify", [&]() {
+			RTLIL::SigSpec sig = big_sig;
+			sig.sort_and_unify();
+			checksum += GetSize(sig);
+		});
+
+		measure("SigSpec hash", [&]() {
+			for (int i = 0; i < num_items; i++)
+				checksum += random_slice().hash();
+		});
+
+		SigMap sigmap;
+		for (int i = 0; i < num_items; i++)
+			sigmap.add(random_bit(), random_bit());
+
+		measure("SigMap add", [&]() {
+			SigMap sm;
+			for (int i = 0; i < num_items; i++)
+				sm.add(random_bit(), random_bit());
+		});
+
+		measure("SigMap apply", [&]() {
+			for (int i = 0; i < num_items; i++) {
+				RTLIL::SigSpec sig = random_slice();
+				sigmap.apply(sig);
+				checksum += GetSize(sig);
+			}
+		});
+
+		measure("mfp merge/find", [&]() {
+			mfp<int> m;
+			for (int i = 0; i < num_items; i++)
+				m.merge(xorshift32(num_items), xorshift32(num_items));
+			for (int i = 0; i < num_items; i++)
+				checksum += m.find(xorshift32(num_items));
+		});
+
+		log("Checksum: %lld\n", (long long)checksum);
+	}
+};
+
+struct TestKernelPerfPass : public Pass {
+	TestKernelPerfPass() : Pass("test_kernel_perf", "benchmark kernel data structures") { }
+	virtual void help()
+	{
+		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+		log("\n");
+		log("    test_kernel_perf [options]\n");
+		log("\n");
+		log("Run fixed workloads on IdString interning, SigSpec operations (append, extract,\n");
+		log("replace, sort_and_unify, hash), SigMap and mfp<> and print the time spent on\n");
+		log("each. The random number generator is reset for every workload, so the numbers\n");
+		log("can be compared between yosys builds. The dict<>, pool<> and idict<> containers\n");
+		log("are measured by calling test_hashlib with the same options.\n");
+		log("\n");
+		log("    -n {integer}\n");
+		log("        number of items per workload (default = 100000).\n");
+		log("\n");
+		log("    -r {integer}\n");
+		log("        number of rounds (default = 10).\n");
+		log("\n");
+		log("    -nohashlib\n");
+		log("        do not call test_hashlib.\n");
+		log("\n");
+	}
+	virtual void execute(std::vector<std::string> args, RTLIL::Design *design)
+	{
+		int num_items = 100000;
+		int num_rounds = 10;
+		bool run_hashlib = true;
+
+		size_t argidx;
+		for (argidx = 1; argidx < args.size(); argidx++)
+		{
+			if (args[argidx] == "-n" && argidx+1 < args.size()) {
+				num_items = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-r" && argidx+1 < args.size()) {
+				num_rounds = atoi(args[++argidx].c_str());
+				continue;
+			}
+			if (args[argidx] == "-nohashlib") {
+				run_hashlib = false;
+				continue;
+			}
+			break;
+		}
+		extra_args(args, argidx, nullptr);
+
+		if (num_items < 128 || num_rounds < 1)
+			log_cmd_error("Invalid number of items or rounds.\n");
+
+		log_header("Executing TEST_KERNEL_PERF pass.\n");
+
+		{
+			TestKernelPerfWorker worker(num_items, num_rounds);
+			worker.run();
+		}
+
+		if (run_hashlib)
+			Pass::call(design, stringf("test_hashlib -n %d -r %d", num_items, num_rounds));
+	}
+} TestKernelPerfPass;
+
+PRIVATE_NAMESPACE_END
@@ -21,6 +21,8 @@
 #include "kernel/celltypes.h"
 #include "kernel/rtlil.h"
 #include "kernel/log.h"
+#include "backends/ilang/ilang_backend.h"
+#include "libs/sha1/sha1.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
@@ -57,6 +59,27 @@ struct SynthPass : public ScriptPass
 		log("    -nordff\n");
 		log("        passed to 'memory'. prohibits merging of FFs into memory read ports\n");
 		log("\n");
+		log("    -hier-cache <dir>\n");
+		log("        look up the result of the 'coarse' and 'fine' steps for each module\n");
+		log("        in the given directory before running them, and only synthesize the\n");
+		log("        modules that are not found. the key is a hash of the module, of the\n");
+		log("        interfaces of the modules it instantiates and of the options. new\n");
+		log("        results are stored in the directory after the 'fine' step.\n");
+		log("\n");
+		log("    -checkpoint <dir>\n");
+		log("        save the design in binary RTLIL format to the given directory at each\n");
+		log("        label. when the command is run again, the script is resumed at the\n");
+		log("        last label for which a checkpoint of the same input design and the\n");
+		log("        same commands up to that label exists in the directory.\n");
+		log("\n");
+		log("    -pipeline\n");
+		log("        when yosys runs with -j, take each module through consecutive\n");
+		log("        module-local commands (like 'opt' or 'techmap') on its own in a\n");
+		log("        worker process instead of running each command for all modules\n");
+		log("        before the next one. commands that need the whole design (like\n");
+		log("        'hierarchy') wait for all modules. the log output is grouped by\n");
+		log("        module, followed by a timeline of the stages of each module.\n");
+		log("\n");
 		log("    -run <from_label>[:<to_label>]\n");
 		log("        only run the commands between the labels (see below). an empty\n");
 		log("        from label is synonymous to 'begin', and empty to label is\n");
@@ -68,14 +91,20 @@ struct SynthPass : public ScriptPass
 		log("\n");
 	}
 
-	std::string top_module, fsm_opts, memory_opts;
+	std::string top_module, fsm_opts, memory_opts, hier_cache_dir;
 	bool noalumacc, nofsm, noabc;
 
+	std::vector<std::pair<RTLIL::IdString, std::string>> hier_cache_misses;
+	bool hier_cache_active, hier_cache_complete;
+
 	virtual void clear_flags() YS_OVERRIDE
 	{
 		top_module.clear();
 		fsm_opts.clear();
 		memory_opts.clear();
+		hier_cache_dir.clear();
+		checkpoint_dir.clear();
+		pipeline = false;
 
 		noalumacc = false;
 		nofsm = false;
@@ -98,6 +127,18 @@ struct SynthPass : public ScriptPass
 				fsm_opts = " -encfile " + args[++argidx];
 				continue;
 			}
+			if (args[argidx] == "-hier-cache" && argidx+1 < args.size()) {
+				hier_cache_dir = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-checkpoint" && argidx+1 < args.size()) {
+				checkpoint_dir = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-pipeline") {
+				pipeline = true;
+				continue;
+			}
 			if (args[argidx] == "-run" && argidx+1 < args.size()) {
 				size_t pos = args[argidx+1].find(':');
 				if (pos == std::string::npos) {
@@ -132,14 +173,98 @@ struct SynthPass : public ScriptPass
 		if (!design->full_selection())
 			log_cmd_error("This comannd only operates on fully selected designs!\n");
 
+		if (!hier_cache_dir.empty() && !checkpoint_dir.empty())
+			log_cmd_error("Options -hier-cache and -checkpoint can't be used together.\n");
+
+		if (!hier_cache_dir.empty() && pipeline)
+			log_cmd_error("Options -hier-cache and -pipeline can't be used together.\n");
+
+#if defined(_WIN32) || defined(EMSCRIPTEN)
+		if (!hier_cache_dir.empty())
+			log_cmd_error("Option -hier-cache is not supported on this platform.\n");
+#endif
+
 		log_header("Executing SYNTH pass.\n");
 		log_push();
 
+		hier_cache_active = false;
+		hier_cache_complete = false;
+
 		run_script(design, run_from, run_to);
 
 		log_pop();
 	}
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+	std::string hier_cache_file(RTLIL::Design *design, RTLIL::Module *module)
+	{
+		std::stringstream buf;
+		buf << yosys_version_str << "\n";
+		buf << "synth" << fsm_opts << memory_opts << (noalumacc ? " -noalumacc" : "") << (nofsm ? " -nofsm" : "") << (noabc ? " -noabc" : "") << "\n";
+
+		std::map<std::string, std::string> scratchpad(design->scratchpad.begin(), design->scratchpad.end());
+		for (auto &it : scratchpad)
+			buf << GetSize(it.first) << " " << GetSize(it.second) << "\n" << it.first << it.second << "\n";
+
+		// passes like opt_clean use the port directions of instantiated modules
+		std::set<RTLIL::IdString> celltypes;
+		for (auto cell : module->cells())
+			if (design->module(cell->type) != nullptr)
+				celltypes.insert(cell->type);
+		for (auto type : celltypes) {
+			RTLIL::Module *mod = design->module(type);
+			buf << "interface " << type.str();
+			for (auto port : mod->ports) {
+				RTLIL::Wire *wire = mod->wire(port);
+				buf << " " << port.str() << ":" << wire->width << ":" << wire->port_input << wire->port_output;
+			}
+			buf << "\n";
+		}
+
+		ILANG_BACKEND::dump_module(buf, "", module, design, false);
+		return stringf("%s/%s.il", hier_cache_dir.c_str(), sha1(buf.str()).c_str());
+	}
+
+	void hier_cache_begin(RTLIL::Design *design)
+	{
+		RTLIL::Selection sel(false);
+		int hits = 0;
+
+		hier_cache_misses.clear();
+		for (auto module : design->modules()) {
+			if (module->get_bool_attribute("\\blackbox"))
+				continue;
+			std::string filename = hier_cache_file(design, module);
+			if (load_cached_module(module, filename)) {
+				log("Using cached synthesis result for module %s.\n", log_id(module));
+				hits++;
+				continue;
+			}
+			hier_cache_misses.push_back(std::make_pair(module->name, filename));
+			sel.selected_modules.insert(module->name);
+		}
+
+		log("Found %d of %d modules in the hierarchy cache.\n", hits, hits + GetSize(hier_cache_misses));
+		design->selection_stack.push_back(sel);
+		hier_cache_active = true;
+	}
+
+	void hier_cache_end(RTLIL::Design *design)
+	{
+		design->selection_stack.pop_back();
+		hier_cache_active = false;
+
+		if (!hier_cache_complete)
+			return;
+
+		for (auto &it : hier_cache_misses) {
+			RTLIL::Module *module = design->module(it.first);
+			if (module != nullptr)
+				store_cached_module(design, module, it.second);
+		}
+	}
+#endif
+
 	virtual void script() YS_OVERRIDE
 	{
 		if (check_label("begin"))
@@ -156,6 +281,10 @@ struct SynthPass : public ScriptPass
 
 		if (check_label("coarse"))
 		{
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+			if (!hier_cache_dir.empty() && !help_mode)
+				hier_cache_begin(active_design);
+#endif
 			run("proc");
 			run("opt_expr");
 			run("opt_clean");
@@ -187,8 +316,15 @@ struct SynthPass : public ScriptPass
 				run("opt -fast");
 		#endif
 			}
+
+			hier_cache_complete = hier_cache_active;
 		}
 
+#if !defined(_WIN32) && !defined(EMSCRIPTEN)
+		if (hier_cache_active)
+			hier_cache_end(active_design);
+#endif
+
 		if (check_label("check"))
 		{
 			run("hierarchy -check");
@@ -73,6 +73,7 @@ endmodule
 // Shift operators
 // --------------------------------------------------------
 
+`ifdef NONATIVE
 (* techmap_celltype = "$shr $shl $sshl $sshr" *)
 module _90_shift_ops_shr_shl_sshl_sshr (A, B, Y);
 	parameter A_SIGNED = 0;
@@ -116,7 +117,14 @@ module _90_shift_ops_shr_shl_sshl_sshr (A, B, Y);
 
 	assign Y = buffer;
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$shr $shl $sshl $sshr" *)
+module _90_shift_ops_shr_shl_sshl_sshr;
+endmodule
+`endif
 
+`ifdef NONATIVE
 (* techmap_celltype = "$shift $shiftx" *)
 module _90_shift_shiftx (A, B, Y);
 	parameter A_SIGNED = 0;
@@ -171,12 +179,19 @@ module _90_shift_shiftx (A, B, Y);
 
 	assign Y = buffer;
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$shift $shiftx" *)
+module _90_shift_shiftx;
+endmodule
+`endif
 
 
 // --------------------------------------------------------
 // Arithmetic operators
 // --------------------------------------------------------
 
+`ifdef NONATIVE
 (* techmap_celltype = "$fa" *)
 module _90_fa (A, B, C, X, Y);
 	parameter WIDTH = 1;
@@ -189,7 +204,14 @@ module _90_fa (A, B, C, X, Y);
 	assign t1 = A ^ B, t2 = A & B, t3 = C & t1;
 	assign Y = t1 ^ C, X = t2 | t3;
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$fa" *)
+module _90_fa;
+endmodule
+`endif
 
+`ifdef NONATIVE
 (* techmap_celltype = "$lcu" *)
 module _90_lcu (P, G, CI, CO);
 	parameter WIDTH = 2;
@@ -234,7 +256,14 @@ module _90_lcu (P, G, CI, CO);
 
 	assign CO = g;
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$lcu" *)
+module _90_lcu;
+endmodule
+`endif
 
+`ifdef NONATIVE
 (* techmap_celltype = "$alu" *)
 module _90_alu (A, B, CI, BI, X, Y, CO);
 	parameter A_SIGNED = 0;
@@ -262,6 +291,12 @@ module _90_alu (A, B, CI, BI, X, Y, CO);
 	assign X = AA ^ BB;
 	assign Y = X ^ {CO, CI};
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$alu" *)
+module _90_alu;
+endmodule
+`endif
 
 (* techmap_maccmap *)
 (* techmap_celltype = "$macc" *)
@@ -415,6 +450,7 @@ endmodule
 // Parallel Multiplexers
 // --------------------------------------------------------
 
+`ifdef NONATIVE
 (* techmap_celltype = "$pmux" *)
 module _90_pmux (A, B, S, Y);
 	parameter WIDTH = 1;
@@ -444,6 +480,12 @@ module _90_pmux (A, B, S, Y);
 
 	assign Y = |S ? Y_B : A;
 endmodule
+`else
+(* techmap_nativemap *)
+(* techmap_celltype = "$pmux" *)
+module _90_pmux;
+endmodule
+`endif
 
 
 // --------------------------------------------------------
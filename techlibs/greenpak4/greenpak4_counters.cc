@@ -19,74 +19,11 @@
 
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
-#include "kernel/modtools.h"
+#include "kernel/cellmatch.h"
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-//get the list of cells hooked up to at least one bit of a given net
-pool<Cell*> get_other_cells(const RTLIL::SigSpec& port, ModIndex& index, Cell* src)
-{
-	pool<Cell*> rval;
-	for(auto b : port)
-	{
-		pool<ModIndex::PortInfo> ports = index.query_ports(b);
-		for(auto x : ports)
-		{
-			if(x.cell == src)
-				continue;
-			rval.insert(x.cell);
-		}
-	}
-	return rval;
-}
-
-//return true if there is a full-width bus connection from cell a port ap to cell b port bp
-//if other_conns_allowed is false, then we require a strict point to point connection (no other links)
-bool is_full_bus(
-	const RTLIL::SigSpec& sig,
-	ModIndex& index,
-	Cell* a,
-	RTLIL::IdString ap,
-	Cell* b,
-	RTLIL::IdString bp,
-	bool other_conns_allowed = false)
-{
-	for(auto s : sig)
-	{
-		pool<ModIndex::PortInfo> ports = index.query_ports(s);
-		bool found_a = false;
-		bool found_b = false;
-		for(auto x : ports)
-		{
-			if( (x.cell == a) && (x.port == ap) )
-				found_a = true;
-			else if( (x.cell == b) && (x.port == bp) )
-				found_b = true;
-			else if(!other_conns_allowed)
-				return false;
-		}
-		
-		if( (!found_a) || (!found_b) )
-			return false;
-	}
-	
-	return true;
-}
-
-//return true if the signal connects to one port only (nothing on the other end)
-bool is_unconnected(const RTLIL::SigSpec& port, ModIndex& index)
-{
-	for(auto b : port)
-	{
-		pool<ModIndex::PortInfo> ports = index.query_ports(b);
-		if(ports.size() > 1)
-			return false;
-	}
-	
-	return true;
-}
-
 struct CounterExtraction
 {
 	int width;					//counter width
@@ -102,9 +39,9 @@ struct CounterExtraction
 };
 
 //attempt to extract a counter centered on the given cell
-int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction& extract)
+int greenpak4_counters_tryextract(CellMatcher& matcher, Cell *cell, CounterExtraction& extract)
 {
-	SigMap& sigmap = index.sigmap;
+	SigMap& sigmap = matcher.sigmap;
 	
 	//GreenPak does not support counters larger than 14 bits so immediately skip anything bigger
 	int a_width = cell->getParam("\\A_WIDTH").as_int();
@@ -138,22 +75,22 @@ int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction
 		return 6;
 				
 	//CO and X must be unconnected (exactly one connection to each port)
-	if(!is_unconnected(sigmap(cell->getPort("\\CO")), index))
+	if(!matcher.is_unconnected(sigmap(cell->getPort("\\CO"))))
 		return 7;
-	if(!is_unconnected(sigmap(cell->getPort("\\X")), index))
+	if(!matcher.is_unconnected(sigmap(cell->getPort("\\X"))))
 		return 8;
 		
 	//Y must have exactly one connection, and it has to be a $mux cell.
 	//We must have a direct bus connection from our Y to their A.
 	const RTLIL::SigSpec aluy = sigmap(cell->getPort("\\Y"));
-	pool<Cell*> y_loads = get_other_cells(aluy, index, cell);
+	pool<Cell*> y_loads = matcher.other_cells(aluy, cell);
 	if(y_loads.size() != 1)
 		return 9;
 	Cell* count_mux = *y_loads.begin();
 	extract.count_mux = count_mux;
 	if(count_mux->type != "$mux")
 		return 10;
-	if(!is_full_bus(aluy, index, cell, "\\Y", count_mux, "\\A"))
+	if(!matcher.is_full_bus(aluy, cell, "\\Y", count_mux, "\\A"))
 		return 11;
 
 	//B connection of the mux is our underflow value
@@ -165,13 +102,13 @@ int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction
 	//S connection of the mux must come from an inverter (need not be the only load)
 	const RTLIL::SigSpec muxsel = sigmap(count_mux->getPort("\\S"));
 	extract.outsig = muxsel;
-	pool<Cell*> muxsel_conns = get_other_cells(muxsel, index, count_mux);
+	pool<Cell*> muxsel_conns = matcher.other_cells(muxsel, count_mux);
 	Cell* underflow_inv = NULL;
 	for(auto c : muxsel_conns)
 	{		
 		if(c->type != "$logic_not")
 			continue;
-		if(!is_full_bus(muxsel, index, c, "\\Y", count_mux, "\\S", true))
+		if(!matcher.is_full_bus(muxsel, c, "\\Y", count_mux, "\\S", true))
 			continue;
 	
 		underflow_inv = c;
@@ -183,7 +120,7 @@ int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction
 	
 	//Y connection of the mux must have exactly one load, the counter's internal register
 	const RTLIL::SigSpec muxy = sigmap(count_mux->getPort("\\Y"));
-	pool<Cell*> muxy_loads = get_other_cells(muxy, index, count_mux);
+	pool<Cell*> muxy_loads = matcher.other_cells(muxy, count_mux);
 	if(muxy_loads.size() != 1)
 		return 14;
 	Cell* count_reg = *muxy_loads.begin();
@@ -207,19 +144,19 @@ int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction
 	//TODO: support synchronous reset
 	else
 		return 15;
-	if(!is_full_bus(muxy, index, count_mux, "\\Y", count_reg, "\\D"))
+	if(!matcher.is_full_bus(muxy, count_mux, "\\Y", count_reg, "\\D"))
 		return 16;
 		
 	//TODO: Verify count_reg CLK_POLARITY is 1
 		
 	//Register output must have exactly two loads, the inverter and ALU
 	const RTLIL::SigSpec cnout = sigmap(count_reg->getPort("\\Q"));
-	pool<Cell*> cnout_loads = get_other_cells(cnout, index, count_reg);
+	pool<Cell*> cnout_loads = matcher.other_cells(cnout, count_reg);
 	if(cnout_loads.size() != 2)
 		return 17;
-	if(!is_full_bus(cnout, index, count_reg, "\\Q", underflow_inv, "\\A", true))
+	if(!matcher.is_full_bus(cnout, count_reg, "\\Q", underflow_inv, "\\A", true))
 		return 18;
-	if(!is_full_bus(cnout, index, count_reg, "\\Q", cell, "\\A", true))
+	if(!matcher.is_full_bus(cnout, count_reg, "\\Q", cell, "\\A", true))
 		return 19;
 		
 	//Look up the clock from the register
@@ -237,16 +174,12 @@ int greenpak4_counters_tryextract(ModIndex& index, Cell *cell, CounterExtraction
 }
 
 void greenpak4_counters_worker(
-	ModIndex& index,
+	CellMatcher& matcher,
 	Cell *cell,
 	unsigned int& total_counters,
 	pool<Cell*>& cells_to_remove)
 {
-	SigMap& sigmap = index.sigmap;
-	
-	//Core of the counter must be an ALU
-	if (cell->type != "$alu")
-		return;
+	SigMap& sigmap = matcher.sigmap;
 	
 	//A input is the count value. Check if it has COUNT_EXTRACT set
 	RTLIL::Wire* a_wire = sigmap(cell->getPort("\\A")).as_wire();
@@ -283,7 +216,7 @@ void greenpak4_counters_worker(
 	
 	//Attempt to extract a counter
 	CounterExtraction extract;
-	int reason = greenpak4_counters_tryextract(index, cell, extract);
+	int reason = greenpak4_counters_tryextract(matcher, cell, extract);
 	
 	//Nonzero code - we could not find a matchable counter.
 	//Do nothing, unless extraction was forced in which case give an error
@@ -422,12 +355,15 @@ struct Greenpak4CountersPass : public Pass {
 		{
 			pool<Cell*> cells_to_remove;
 			
-			ModIndex index(module);
-			for (auto cell : module->selected_cells())
-				greenpak4_counters_worker(index, cell, total_counters, cells_to_remove);
+			//The core of each counter is an ALU
+			CellMatcher matcher(module);
+			matcher.add_rule("$alu", [&](Cell *cell) {
+				greenpak4_counters_worker(matcher, cell, total_counters, cells_to_remove);
+			});
+			matcher.run();
 				
 			for(auto cell : cells_to_remove)
-				module->remove(cell);
+				matcher.remove(cell);
 		}
 		
 		if(total_counters)
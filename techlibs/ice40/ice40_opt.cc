@@ -19,6 +19,8 @@
 
 #include "kernel/yosys.h"
 #include "kernel/sigtools.h"
+#include "kernel/cellmatch.h"
+#include "kernel/truthtable.h"
 #include "passes/techmap/simplemap.h"
 #include <stdlib.h>
 #include <stdio.h>
@@ -28,53 +30,49 @@ PRIVATE_NAMESPACE_BEGIN
 
 static void run_ice40_opts(Module *module)
 {
-	pool<SigBit> optimized_co;
-	vector<Cell*> sb_lut_cells;
-	SigMap sigmap(module);
+	CellMatcher matcher(module);
+	SigMap &sigmap = matcher.sigmap;
+	pool<Cell*> carry_luts;
 
-	for (auto cell : module->selected_cells())
+	// the matcher's sigmap follows the connections made below, so a carry
+	// chain with a constant input is removed completely in one run
+	matcher.add_rule("\\SB_CARRY", [&](Cell *cell)
 	{
-		if (cell->type == "\\SB_LUT4")
-		{
-			sb_lut_cells.push_back(cell);
-			continue;
+		SigSpec non_const_inputs, replacement_output;
+		int count_zeros = 0, count_ones = 0;
+
+		SigBit inbit[3] = {sigmap(cell->getPort("\\I0")), sigmap(cell->getPort("\\I1")), sigmap(cell->getPort("\\CI"))};
+		for (int i = 0; i < 3; i++)
+			if (inbit[i].wire == nullptr) {
+				if (inbit[i] == State::S1)
+					count_ones++;
+				else
+					count_zeros++;
+			} else
+				non_const_inputs.append(inbit[i]);
+
+		if (count_zeros >= 2)
+			replacement_output = State::S0;
+		else if (count_ones >= 2)
+			replacement_output = State::S1;
+		else if (GetSize(non_const_inputs) == 1)
+			replacement_output = non_const_inputs;
+
+		if (GetSize(replacement_output)) {
+			SigSpec sig_co = cell->getPort("\\CO");
+			for (auto other : matcher.other_cells(sig_co, cell))
+				if (other->type == "\\SB_LUT4")
+					carry_luts.insert(other);
+			matcher.trigger(sig_co);
+			module->connect(sig_co, replacement_output);
+			module->design->scratchpad_set_bool("opt.did_something", true);
+			log("Optimized away SB_CARRY cell %s.%s: CO=%s\n",
+					log_id(module), log_id(cell), log_signal(replacement_output));
+			matcher.remove(cell);
 		}
+	});
 
-		if (cell->type == "\\SB_CARRY")
-		{
-			SigSpec non_const_inputs, replacement_output;
-			int count_zeros = 0, count_ones = 0;
-
-			SigBit inbit[3] = {cell->getPort("\\I0"), cell->getPort("\\I1"), cell->getPort("\\CI")};
-			for (int i = 0; i < 3; i++)
-				if (inbit[i].wire == nullptr) {
-					if (inbit[i] == State::S1)
-						count_ones++;
-					else
-						count_zeros++;
-				} else
-					non_const_inputs.append(inbit[i]);
-
-			if (count_zeros >= 2)
-				replacement_output = State::S0;
-			else if (count_ones >= 2)
-				replacement_output = State::S1;
-			else if (GetSize(non_const_inputs) == 1)
-				replacement_output = non_const_inputs;
-
-			if (GetSize(replacement_output)) {
-				optimized_co.insert(sigmap(cell->getPort("\\CO")));
-				module->connect(cell->getPort("\\CO"), replacement_output);
-				module->design->scratchpad_set_bool("opt.did_something", true);
-				log("Optimized away SB_CARRY cell %s.%s: CO=%s\n",
-						log_id(module), log_id(cell), log_signal(replacement_output));
-				module->remove(cell);
-			}
-			continue;
-		}
-	}
-
-	for (auto cell : sb_lut_cells)
+	matcher.add_rule("\\SB_LUT4", [&](Cell *cell)
 	{
 		SigSpec inbits;
 
@@ -84,24 +82,35 @@ static void run_ice40_opts(Module *module)
 		inbits.append(cell->getPort("\\I3"));
 		sigmap.apply(inbits);
 
-		if (optimized_co.count(inbits[0])) goto remap_lut;
-		if (optimized_co.count(inbits[1])) goto remap_lut;
-		if (optimized_co.count(inbits[2])) goto remap_lut;
-		if (optimized_co.count(inbits[3])) goto remap_lut;
-
-		if (!sigmap(inbits).is_fully_const())
-			continue;
+		if (!carry_luts.count(cell) && !inbits.is_fully_const())
+			return;
 
-	remap_lut:
 		module->design->scratchpad_set_bool("opt.did_something", true);
 		log("Mapping SB_LUT4 cell %s.%s back to logic.\n", log_id(module), log_id(cell));
 
+		// fold constant inputs into the table, so that only the remaining
+		// inputs end up in the mux tree
+		SigSpec lut_inputs = inbits;
+		TruthTable tt(cell->getParam("\\LUT_INIT"), 4);
+		for (int i = 3; i >= 0; i--)
+			if (lut_inputs[i].wire == nullptr) {
+				tt = tt.cofactor(i, lut_inputs[i] == State::S1).remove_var(i);
+				lut_inputs.remove(i);
+			}
+
+		if (tt.width == 0 || tt == TruthTable::variable(1, 0)) {
+			SigSpec value = tt.width == 0 ? SigSpec(tt.get(0) ? State::S1 : State::S0) : lut_inputs;
+			module->connect(cell->getPort("\\O"), value);
+			matcher.remove(cell);
+			return;
+		}
+
 		cell->type ="$lut";
-		cell->setParam("\\WIDTH", 4);
-		cell->setParam("\\LUT", cell->getParam("\\LUT_INIT"));
+		cell->setParam("\\WIDTH", tt.width);
+		cell->setParam("\\LUT", tt.as_const());
 		cell->unsetParam("\\LUT_INIT");
 
-		cell->setPort("\\A", SigSpec({cell->getPort("\\I0"), cell->getPort("\\I1"), cell->getPort("\\I2"), cell->getPort("\\I3")}));
+		cell->setPort("\\A", lut_inputs);
 		cell->setPort("\\Y", cell->getPort("\\O"));
 		cell->unsetPort("\\I0");
 		cell->unsetPort("\\I1");
@@ -111,12 +120,15 @@ static void run_ice40_opts(Module *module)
 
 		cell->check();
 		simplemap_lut(module, cell);
-		module->remove(cell);
-	}
+		matcher.remove(cell);
+	});
+
+	matcher.run();
 }
 
 struct Ice40OptPass : public Pass {
 	Ice40OptPass() : Pass("ice40_opt", "iCE40: perform simple optimizations") { }
+	virtual bool module_local(const std::vector<std::string>&) { return true; }
 	virtual void help()
 	{
 		//   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
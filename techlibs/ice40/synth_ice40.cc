@@ -48,6 +48,17 @@ struct SynthIce40Pass : public ScriptPass
 		log("        write the design to the specified edif file. writing of an output file\n");
 		log("        is omitted if this parameter is not specified.\n");
 		log("\n");
+		log("    -checkpoint <dir>\n");
+		log("        save the design in binary RTLIL format to the given directory at each\n");
+		log("        label. when the command is run again, the script is resumed at the\n");
+		log("        last label for which a checkpoint of the same input design and the\n");
+		log("        same commands up to that label exists in the directory.\n");
+		log("\n");
+		log("    -pipeline\n");
+		log("        when yosys runs with -j, take each module through consecutive\n");
+		log("        module-local commands on its own in a worker process (see 'help\n");
+		log("        synth'). this only has an effect together with -noflatten.\n");
+		log("\n");
 		log("    -run <from_label>:<to_label>\n");
 		log("        only run the commands between the labels (see below). an empty\n");
 		log("        from label is synonymous to 'begin', and empty to label is\n");
@@ -68,6 +79,9 @@ struct SynthIce40Pass : public ScriptPass
 		log("    -abc2\n");
 		log("        run two passes of 'abc' for slightly improved logic density\n");
 		log("\n");
+		log("    -native-lut\n");
+		log("        map to LUTs with the 'lutmap' pass instead of 'abc -lut 4'\n");
+		log("\n");
 		log("\n");
 		log("The following commands are executed by this synthesis command:\n");
 		help_script();
@@ -76,7 +90,7 @@ struct SynthIce40Pass : public ScriptPass
 
 	string top_opt = "-auto-top";
 	string blif_file, edif_file;
-	bool nocarry, nobram, flatten, retime, abc2;
+	bool nocarry, nobram, flatten, retime, abc2, native_lut;
 
 	virtual void clear_flags() YS_OVERRIDE
 	{
@@ -88,6 +102,9 @@ struct SynthIce40Pass : public ScriptPass
 		flatten = true;
 		retime = false;
 		abc2 = false;
+		native_lut = false;
+		checkpoint_dir.clear();
+		pipeline = false;
 	}
 
 	virtual void execute(std::vector<std::string> args, RTLIL::Design *design) YS_OVERRIDE
@@ -110,6 +127,14 @@ struct SynthIce40Pass : public ScriptPass
 				edif_file = args[++argidx];
 				continue;
 			}
+			if (args[argidx] == "-checkpoint" && argidx+1 < args.size()) {
+				checkpoint_dir = args[++argidx];
+				continue;
+			}
+			if (args[argidx] == "-pipeline") {
+				pipeline = true;
+				continue;
+			}
 			if (args[argidx] == "-run" && argidx+1 < args.size()) {
 				size_t pos = args[argidx+1].find(':');
 				if (pos == std::string::npos)
@@ -142,6 +167,10 @@ struct SynthIce40Pass : public ScriptPass
 				abc2 = true;
 				continue;
 			}
+			if (args[argidx] == "-native-lut") {
+				native_lut = true;
+				continue;
+			}
 			break;
 		}
 		extra_args(args, argidx, design);
@@ -174,7 +203,7 @@ struct SynthIce40Pass : public ScriptPass
 
 		if (check_label("coarse"))
 		{
-			run("synth -run coarse");
+			run(pipeline ? "synth -run coarse -pipeline" : "synth -run coarse");
 		}
 
 		if (!nobram && check_label("bram", "(skip if -nobram)"))
@@ -215,7 +244,10 @@ struct SynthIce40Pass : public ScriptPass
 				run("abc", "      (only if -abc2)");
 				run("ice40_opt", "(only if -abc2)");
 			}
-			run("abc -lut 4");
+			if (!native_lut || help_mode)
+				run("abc -lut 4", "(skip if -native-lut)");
+			if (native_lut || help_mode)
+				run("lutmap -k 4", "(only if -native-lut)");
 			run("clean");
 		}
 
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+
+# Generates the designs for the benchmark suite. The designs are
+# deterministic for a given scale factor, so timings can be compared
+# across commits. Usage: python3 generate.py [<scale>]
+
+import sys
+import random
+from contextlib import contextmanager
+
+@contextmanager
+def redirect_stdout(new_target):
+    old_target, sys.stdout = sys.stdout, new_target
+    try:
+        yield new_target
+    finally:
+        sys.stdout = old_target
+
+scale = int(sys.argv[1]) if len(sys.argv) > 1 else 1
+random.seed(42)
+
+# pipelined multiply-accumulate lanes with an adder tree
+def gen_datapath(lanes, width, stages):
+    print('module top(input clk, input [%d:0] a, b, c, output reg [%d:0] y);' % (lanes*width-1, 2*width+7))
+    for i in range(lanes):
+        print('  reg [%d:0] p%d_0;' % (2*width-1, i))
+        print('  always @(posedge clk) p%d_0 <= a[%d+:%d] * b[%d+:%d] + c[%d+:%d];' % (i, i*width, width, i*width, width, i*width, width))
+        for s in range(1, stages):
+            op = random.choice(['+', '-', '^'])
+            print('  reg [%d:0] p%d_%d;' % (2*width-1, i, s))
+            print('  always @(posedge clk) p%d_%d <= (p%d_%d %s {a[%d+:%d], b[%d+:%d]}) >> %d;' % (i, s, i, s-1, op,
+                    i*width, width, i*width, width, random.randint(0, 3)))
+    print('  always @(posedge clk) y <= %s;' % ' + '.join(['p%d_%d' % (i, stages-1) for i in range(lanes)]))
+    print('endmodule')
+
+# binary tree of module instances, each level adds some logic
+def gen_hierarchy(depth, width):
+    print('module leaf(input clk, input [%d:0] a, b, output reg [%d:0] y);' % (width-1, width-1))
+    print('  always @(posedge clk) y <= (a + b) ^ {a[0], b[%d:1]};' % (width-1))
+    print('endmodule')
+    for d in range(1, depth+1):
+        child = 'leaf' if d == 1 else 'level%d' % (d-1)
+        name = 'top' if d == depth else 'level%d' % d
+        print('module %s(input clk, input [%d:0] a, b, output reg [%d:0] y);' % (name, width-1, width-1))
+        print('  wire [%d:0] y0, y1;' % (width-1))
+        print('  %s c0 (.clk(clk), .a(a), .b(b), .y(y0));' % child)
+        print('  %s c1 (.clk(clk), .a(b), .b(a ^ b), .y(y1));' % child)
+        print('  always @(posedge clk) y <= y0 %s y1;' % random.choice(['+', '-', '&', '|', '^']))
+        print('endmodule')
+
+# several memories with registered read ports
+def gen_memories(count, abits, dbits):
+    print('module top(input clk, input [%d:0] we, input [%d:0] addr, input [%d:0] din, output [%d:0] dout);' % (count-1, abits-1, dbits-1, dbits-1))
+    for i in range(count):
+        print('  reg [%d:0] mem%d [0:%d];' % (dbits-1, i, 2**abits-1))
+        print('  reg [%d:0] rd%d;' % (dbits-1, i))
+        print('  always @(posedge clk) begin')
+        print('    if (we[%d]) mem%d[addr ^ %d] <= din + %d;' % (i, i, random.randint(0, 2**abits-1), i))
+        print('    rd%d <= mem%d[addr];' % (i, i))
+        print('  end')
+    print('  assign dout = %s;' % ' ^ '.join(['rd%d' % i for i in range(count)]))
+    print('endmodule')
+
+# many independent state machines
+def gen_fsms(count, states):
+    print('module top(input clk, rst, input [%d:0] in, output [%d:0] out);' % (count-1, count-1))
+    for i in range(count):
+        print('  reg [7:0] state%d;' % i)
+        print('  always @(posedge clk) begin')
+        print('    if (rst) state%d <= 0; else' % i)
+        print('    case (state%d)' % i)
+        for s in range(states):
+            print('      %d: state%d <= in[%d] ? %d : %d;' % (s, i, (i+s) % count, random.randint(0, states-1), random.randint(0, states-1)))
+        print('      default: state%d <= 0;' % i)
+        print('    endcase')
+        print('  end')
+        print('  assign out[%d] = state%d == %d;' % (i, i, random.randint(0, states-1)))
+    print('endmodule')
+
+designs = {
+    'datapath': lambda: gen_datapath(8*scale, 16, 4),
+    'hierarchy': lambda: gen_hierarchy(6+scale, 16),
+    'memories': lambda: gen_memories(4*scale, 8, 16),
+    'fsms': lambda: gen_fsms(32*scale, 12),
+}
+
+for name, gen in sorted(designs.items()):
+    with open('temp/%s.v' % name, 'w') as f:
+        with redirect_stdout(f):
+            gen()
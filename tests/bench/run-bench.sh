@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Runs all benchmark scripts on all generated designs and appends the
+# results to results.tsv (one line per run: commit, date, scale, design,
+# script, wall/user/system time in seconds). A Chrome trace with the time
+# spent in each pass is written to temp/<design>.<script>.json.
+#
+# usage: bash run-bench.sh [<scale>]
+
+set -e
+
+scale=${1:-1}
+commit=$( git rev-parse --short HEAD 2> /dev/null || echo unknown )
+date=$( date -u +%Y-%m-%dT%H:%M:%SZ )
+
+rm -rf temp
+mkdir -p temp
+echo "generating designs.."
+python3 generate.py $scale
+
+[ -f results.tsv ] || echo -e "commit\tdate\tscale\tdesign\tscript\twall\tuser\tsystem" > results.tsv
+
+TIMEFORMAT="%R %U %S"
+echo "running benchmarks.."
+for design in datapath fsms hierarchy memories; do
+	for script in synth synth_ice40 synth_xilinx equiv freduce; do
+		# memories are mapped to FFs by synth and cannot be proven with equiv_simple
+		[ $design = memories ] && [ $script = equiv ] && continue
+		# the SAT problems for the wide arithmetic in the other designs are too slow
+		[ $script = freduce ] && [ $design != fsms ] && continue
+		printf "%-10s %-13s " $design $script
+		t=$( { time ../../yosys -q -J temp/$design.$script.json -l temp/$design.$script.log \
+				temp/$design.v -s $script.ys > /dev/null; } 2>&1 )
+		echo "$t"
+		echo -e "$commit\t$date\t$scale\t$design\t$script\t${t// /\\t}" >> results.tsv
+	done
+done
+
+exit 0
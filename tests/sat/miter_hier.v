@@ -0,0 +1,19 @@
+module add_gold(input [3:0] a, b, output [3:0] y);
+	assign y = a + b;
+endmodule
+
+module add_gate(input [3:0] a, b, output [3:0] y);
+	assign y = b + a;
+endmodule
+
+module top_gold(input [3:0] a, b, c, output [3:0] y);
+	wire [3:0] t;
+	add_gold u1 (.a(a), .b(b), .y(t));
+	add_gold u2 (.a(t), .b(c), .y(y));
+endmodule
+
+module top_gate(input [3:0] a, b, c, output [3:0] y);
+	wire [3:0] t;
+	add_gate u1 (.a(a), .b(b), .y(t));
+	add_gate u2 (.a(t), .b(c), .y(y));
+endmodule
@@ -0,0 +1,38 @@
+#!/bin/bash
+set -e
+
+# the cache directory is local to the test, so that no stale results from
+# other runs are used
+rm -rf abc_cache.tmp
+mkdir abc_cache.tmp
+
+cat > abc_cache_script.tmp <<EOT
+read_verilog <<EOV
+module m1(input [3:0] a, b, output [4:0] y);
+	assign y = a + b;
+endmodule
+EOV
+proc
+techmap
+opt_clean
+copy m1 gold
+copy m1 m2
+copy m1 m3
+abc -cache abc_cache.tmp m1
+abc -cache abc_cache.tmp m2
+abc -cache abc_cache.tmp -j 2 m3
+miter -equiv -make_assert gold m1 miter1
+miter -equiv -make_assert gold m2 miter2
+miter -equiv -make_assert gold m3 miter3
+sat -verify -prove-asserts miter1
+sat -verify -prove-asserts miter2
+sat -verify -prove-asserts miter3
+EOT
+
+# the first run misses the cache for m1 and uses the result for m2 and m3
+../../yosys -ql abc_cache_1.log -s abc_cache_script.tmp
+test $(grep -c "^Using cached ABC result" abc_cache_1.log) -eq 2
+
+# the second run finds all three results in the cache
+../../yosys -ql abc_cache_2.log -s abc_cache_script.tmp
+test $(grep -c "^Using cached ABC result" abc_cache_2.log) -eq 3
@@ -0,0 +1,8 @@
+module gold(a0, a1, a2, a3, a4, a5, a6, a7, a8, a9, y1, y2, y3);
+	input a0, a1, a2, a3, a4, a5, a6, a7, a8, a9;
+	output y1, y2, y3;
+	wire [9:0] a = {a9, a8, a7, a6, a5, a4, a3, a2, a1, a0};
+	assign y1 = &a || !a || (a0 && !a2 && a7 && !a9);
+	assign y2 = !(a0 && a1);
+	assign y3 = (a0 && a9) || (!a0 && a1 && a9);
+endmodule
@@ -0,0 +1,31 @@
+#!/bin/bash
+set -e
+
+cat > read_json_design.tmp <<EOT
+module top(input [3:0] a, b, c, input s, output [4:0] y, output [3:0] z);
+	assign y = s ? a + b : a - c;
+	assign z = a * b;
+endmodule
+EOT
+
+# the json file contains names of the form \$...\$<num> from NEW_ID
+../../yosys -ql read_json_1.log -p 'read_verilog read_json_design.tmp; proc; opt; wreduce; alumacc; opt; write_json read_json.tmp'
+
+# a new session must not create these names again
+cat > read_json_script.tmp <<EOT
+read_json read_json.tmp
+write_ilang read_json_read.tmp
+techmap
+opt
+rename top gate
+read_verilog read_json_design.tmp
+proc
+rename top gold
+miter -equiv -flatten -make_assert gold gate miter
+sat -verify -prove-asserts miter
+EOT
+../../yosys -ql read_json_2.log -s read_json_script.tmp
+
+maxnum=$(grep -o '"\$[^"]*\$[0-9]*"' read_json.tmp | sed 's/.*\$\([0-9]*\)"$/\1/' | sort -n | tail -n 1)
+autoidx=$(sed -n 's/^autoidx //p' read_json_read.tmp)
+test "$autoidx" -gt "$maxnum"
@@ -4,3 +4,9 @@ for x in *.ys; do
 	echo "Running $x.."
 	../../yosys -ql ${x%.ys}.log $x
 done
+for x in *.sh; do
+	if [ "$x" != "run-test.sh" ]; then
+		echo "Running $x.."
+		bash $x
+	fi
+done
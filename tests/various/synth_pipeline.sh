@@ -0,0 +1,35 @@
+#!/bin/bash
+set -e
+
+cat > synth_pipeline.tmp <<EOT
+module sub (input [3:0] a, b, output [3:0] y);
+	assign y = a + b;
+endmodule
+module top (input [3:0] a, b, c, output [3:0] y, z);
+	sub s1 (.a(a), .b(b), .y(y));
+	assign z = a & c;
+endmodule
+EOT
+
+cat > synth_pipeline_script.tmp <<EOT
+read_verilog synth_pipeline.tmp
+synth -top top
+flatten
+rename top serial
+design -save serial
+design -reset
+read_verilog synth_pipeline.tmp
+synth -pipeline -top top
+flatten
+rename top pipelined
+design -copy-from serial -as serial serial
+miter -equiv -flatten -make_assert serial pipelined miter
+sat -verify -prove-asserts miter
+EOT
+
+# the pipeline only forks with more than one job
+../../yosys -ql synth_pipeline.log -j 2 -s synth_pipeline_script.tmp
+
+grep -q "^Stage timeline" synth_pipeline.log
+grep -q "^  module sub (worker [01]):" synth_pipeline.log
+grep -q "^  module top (worker [01]):" synth_pipeline.log